@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "DMAST.h"
+#include "TokenBuffer.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// On-disk cache of parsed top-level definitions, so a rebuild only parses
+/// the files whose preprocessed tokens changed.
+///
+/// The resolved token buffer is cut into segments: runs of top-level
+/// definitions (see ParallelParser::FindChunkStarts) that start in the same
+/// source file. Each segment is parsed on its own into a DMASTFile fragment
+/// and stored under a 64-bit hash of its tokens, covering their types, text,
+/// values and locations with file paths in place of registry IDs. Entries are
+/// stamped with the parser version and with whether proc bodies were
+/// deferred, since both change the tree that comes out, and end with a
+/// checksum of the rest: an entry that does not match is a miss.
+///
+/// Fragments are stored as parsed, before constant folding. A deferred proc
+/// body keeps its token range relative to the start of its segment.
+/// </summary>
+class ASTCache {
+public:
+    /// A run of top-level definitions cached as one entry
+    struct Segment {
+        size_t Begin = 0;   // Index of the segment's first token
+        size_t End = 0;     // Index past its last token
+        uint64_t Hash = 0;  // Hash of the tokens in between
+    };
+
+    /// @param directory Where entries are kept (created if missing)
+    /// @param deferredBodies True if fragments are parsed with DMParser::SetDeferProcBodies
+    ASTCache(std::string directory, bool deferredBodies);
+
+    /// Cut a resolved token buffer into segments and hash each of them
+    static std::vector<Segment> FindSegments(const TokenBuffer& tokens);
+
+    /// Get the cached fragment of a segment, or nullptr on a miss
+    std::unique_ptr<DMASTFile> Load(const Segment& segment) const;
+
+    /// Save the fragment parsed from a segment (best effort; failures and
+    /// nodes the format does not know are ignored)
+    void Store(const Segment& segment, const DMASTFile& fragment) const;
+
+    /// Hash of what a proc's parameters and body say, leaving out where they
+    /// are, so a proc that only moved keeps its hash (see ProcCache)
+    /// @param names If given, gets every name and text they hold, repeats included
+    /// @return false if they hold nodes the format does not know
+    static bool HashProc(const std::vector<DMASTDefinitionParameter*>& parameters, const DMASTProcBlockInner* body,
+                         uint64_t& hash, std::vector<std::string>* names = nullptr);
+
+    /// Hash of what an expression says, leaving out where it is
+    /// @return false if it holds nodes the format does not know
+    static bool HashExpression(const DMASTExpression* expression, uint64_t& hash);
+
+    const std::string& GetDirectory() const { return Directory_; }
+
+private:
+    std::string EntryPath(uint64_t hash) const;
+
+    std::string Directory_;
+    bool DeferredBodies_;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "DMCompiler.h"
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Compiles several targets in one process (dmcompiler --batch), such as the
+/// test, production and map-test builds of one .dme, concurrently and
+/// sharing what would otherwise be redone for each.
+///
+/// Targets are read from a JSON file:
+///   {"Targets": [{"Name": "tests", "Args": ["--define", "UNIT_TESTS", "--output", "tests.json", "tgstation.dme"]},
+///                {"Name": "production", "Args": ["tgstation.dme"]}]}
+/// Args are the command line each target would be compiled with; all run
+/// from the current directory. Two targets may not write the same output,
+/// so variants of one .dme name theirs with --output.
+///
+/// Every target gets its own DMCompiler, and they share one warm state: the
+/// token cache keeps each file's tokens in memory (lexed once, as a .dme's
+/// defines do not change its tokens), DMStandard is preprocessed by the first
+/// target and reused from its snapshot by the rest, and resources are hashed
+/// once for all the targets' manifests. Targets that do not name their own
+/// token cache or DMStandard snapshot use the batch's, in cacheDir; the
+/// builtin registry is shared by the process already.
+///
+/// Each target's console output is collected and printed in one piece when
+/// it finishes. Output from threads of a target's own (--lex-threads and the
+/// like) goes straight to the console, and --timings' memory and allocation
+/// figures count the whole process.
+/// </summary>
+class BatchCompiler {
+public:
+    /// Turn a target's command line into settings, printing any error
+    using ArgumentParser = std::function<bool(const std::vector<std::string>& args, DMCompilerSettings& settings)>;
+
+    struct Target {
+        std::string Name;
+        std::vector<std::string> Args;
+    };
+
+    struct Result {
+        std::string Name;
+        bool Success = false;
+        int Errors = 0;
+        int Warnings = 0;
+        double Ms = 0;
+        std::string Output;  // What the compile printed
+    };
+
+    BatchCompiler(std::string cacheDir, ArgumentParser parseArguments);
+
+    /// Read a batch file's targets; a target without a name is named after its last argument
+    /// @return false with error set if the file cannot be read or lists no targets
+    static bool LoadTargets(const std::string& path, std::vector<Target>& targets, std::string& error);
+
+    /// Compile targets on threadCount threads (0 = one per target, up to the
+    /// hardware's), printing each one's output to out as it finishes and a
+    /// summary at the end
+    /// @return Each target's result, in the order given
+    std::vector<Result> Compile(const std::vector<Target>& targets, unsigned threadCount, std::ostream& out);
+
+private:
+    std::string CacheDir_;
+    ArgumentParser ParseArguments_;
+    std::shared_ptr<DMCompilerWarmState> WarmState_;
+};
+
+} // namespace DMCompiler
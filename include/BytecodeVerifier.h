@@ -0,0 +1,52 @@
+#pragma once
+
+#include "OperandEncoding.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Checks a proc's finished bytecode for what a runtime loading it relies on
+/// (--verify), so bad code is caught by the compile rather than by loading
+/// the output.
+///
+/// Every instruction must be in the opcode table and end within the proc.
+/// Operands that index a table must be in range: strings and resources
+/// (resources are pushed by path, which is a string), types (or a string,
+/// for a bare new), procs, and the string or global a long reference names.
+/// Every jump must land on the start of an instruction or on the end of the
+/// proc, which returns.
+///
+/// The stack is followed from the first instruction as StackDepthAnalysis
+/// does, from the opcode table alone: no path may take more values than the
+/// stack holds, paths must meet at the same depth, and none may get deeper
+/// than the proc's max stack size. A path is followed only as far as the
+/// table says what each instruction does to the stack, so code the table
+/// cannot size is left unchecked rather than reported.
+/// </summary>
+class BytecodeVerifier {
+public:
+    /// Sizes of the tables operands index
+    struct Tables {
+        size_t Strings = 0;
+        size_t Types = 0;
+        size_t Procs = 0;
+        size_t Globals = 0;
+    };
+
+    BytecodeVerifier(Tables tables, OperandEncoding encoding) : Tables_(tables), Encoding_(encoding) {}
+
+    /// Check one proc's bytecode; safe on several threads
+    /// @param maxStackSize The proc's max stack size
+    /// @return What is wrong with it, or an empty string
+    std::string Verify(const std::vector<uint8_t>& bytecode, int maxStackSize) const;
+
+private:
+    Tables Tables_;
+    OperandEncoding Encoding_;
+};
+
+} // namespace DMCompiler
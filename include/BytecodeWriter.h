@@ -3,21 +3,30 @@
 #include "DreamProcOpcode.h"
 #include "DMReference.h"
 #include "Location.h"
+#include "ConcurrentStringInterner.h"
+#include "OperandBytes.h"
 #include <vector>
 #include <cstdint>
 #include <string>
+#include <string_view>
+#include <memory>
 #include <unordered_map>
 #include <optional>
 
 namespace DMCompiler {
 
+class DMObjectTree;
+struct BytecodeInstruction;
+
 /// <summary>
 /// Helper class for generating bytecode instructions for DM procedures.
 /// Provides methods for emitting opcodes and their operands, managing labels and jumps.
 /// </summary>
 class BytecodeWriter {
 public:
-    BytecodeWriter();
+    /// @param objectTree Tree whose string table string operands index into;
+    ///        without one the writer keeps a table of its own
+    explicit BytecodeWriter(DMObjectTree* objectTree = nullptr);
     
     /// <summary>
     /// Emit a simple opcode with no operands.
@@ -52,7 +61,7 @@ public:
     /// <summary>
     /// Emit an opcode with multiple operands.
     /// </summary>
-    void EmitMulti(DreamProcOpcode opcode, const std::vector<uint8_t>& operands);
+    void EmitMulti(DreamProcOpcode opcode, const OperandBytes& operands);
     
     /// <summary>
     /// Create a label at the current position.
@@ -66,6 +75,12 @@ public:
     /// </summary>
     void MarkLabel(int labelId);
     
+    /// <summary>
+    /// Hand out label IDs from where another writer's left off, so labels made
+    /// on a scratch writer can later be marked in this one without colliding.
+    /// </summary>
+    void ContinueLabelsFrom(const BytecodeWriter& other);
+    
     /// <summary>
     /// Emit a jump opcode that will be fixed up later when the label position is known.
     /// </summary>
@@ -75,7 +90,14 @@ public:
     /// Emit a jump opcode with reference bytes (for JumpIfTrueReference/JumpIfFalseReference).
     /// The reference bytes are emitted immediately after the opcode, followed by the jump offset.
     /// </summary>
-    void EmitJumpWithReference(DreamProcOpcode opcode, const std::vector<uint8_t>& refBytes, int labelId);
+    void EmitJumpWithReference(DreamProcOpcode opcode, const OperandBytes& refBytes, int labelId);
+    
+    /// <summary>
+    /// Emit a jump opcode that tests against a constant (for SwitchOnFloat/SwitchOnString).
+    /// The constant is emitted immediately after the opcode, followed by the jump offset.
+    /// </summary>
+    void EmitJumpWithFloat(DreamProcOpcode opcode, float value, int labelId);
+    void EmitJumpWithString(DreamProcOpcode opcode, const std::string& value, int labelId);
     
     /// <summary>
     /// Finalize the bytecode by resolving all jump labels.
@@ -83,11 +105,48 @@ public:
     /// </summary>
     void Finalize();
     
+    /// <summary>
+    /// Run the peephole pass over the bytecode emitted so far: fuses pushes that
+    /// are popped or returned straight away, threads jumps to jumps, drops
+    /// jumps to the next instruction and folds constant comparisons and
+    /// conditional jumps. Then, on the ControlFlowGraph of the result, drops
+    /// unreachable code and stores to locals nobody reads, and lowers the max
+    /// stack size to what is left. Must be called before Finalize().
+    /// Leaves the bytecode untouched if its instructions cannot be told apart.
+    /// </summary>
+    /// <param name="parameterCount">Locals below this ID are the proc's arguments</param>
+    /// <param name="superinstructions">Also fuse pairs the runtime has a single opcode
+    /// for, with both instructions' operands (--fused-opcodes)</param>
+    void Optimize(int parameterCount = 0, bool superinstructions = false);
+    
+    /// <summary>
+    /// Set the max stack size from the bytecode emitted so far instead of from
+    /// the ResizeStack() calls, by following every path through it with
+    /// StackDepthAnalysis. Keeps the counted size if the paths do not agree on
+    /// a depth. Must be called before Finalize().
+    /// </summary>
+    /// <returns>Where the analysis and the ResizeStack() calls disagree, for --verify-stack</returns>
+    std::vector<std::string> AnalyzeStack();
+    
+    /// <summary>
+    /// Rewrite the bytecode emitted so far with OperandEncoding::Leb128
+    /// (--compact-operands). Instructions whose bytes do not follow the opcode
+    /// table are left as they are. Optimize() and AnalyzeStack() only read the
+    /// fixed encoding, so this comes after them, and before Finalize().
+    /// </summary>
+    void CompactOperands();
+    
     /// <summary>
     /// Get the generated bytecode.
     /// </summary>
     const std::vector<uint8_t>& GetBytecode() const { return Bytecode_; }
     
+    /// <summary>
+    /// Move the generated bytecode out instead of copying it, leaving the
+    /// writer empty. Call Reset() before writing another proc with it.
+    /// </summary>
+    std::vector<uint8_t> TakeBytecode();
+    
     /// <summary>
     /// Get the current bytecode position.
     /// </summary>
@@ -107,10 +166,11 @@ public:
     /// <summary>
     /// Get or create a string table index for a string constant.
     /// </summary>
-    int GetStringId(const std::string& str);
+    int GetStringId(std::string_view str);
     
     /// <summary>
     /// Reset the writer for generating new bytecode.
+    /// Keeps the capacity of its buffers.
     /// </summary>
     void Reset();
     
@@ -138,6 +198,13 @@ public:
     /// <param name="reference">The reference to write</param>
     void WriteReference(const DMReference& reference);
     
+    /// <summary>
+    /// Store null in a local (PushNull, then AssignNoPush), for a local
+    /// declared without a value in a slot another local used before it.
+    /// </summary>
+    /// <param name="localId">The local's slot</param>
+    void EmitNullStore(int localId);
+    
     /// <summary>
     /// Create a list enumerator for for-in loops.
     /// Expects the list to be on the stack.
@@ -188,17 +255,25 @@ public:
     void DestroyEnumerator(int enumeratorId);
 
 private:
+    friend class PooledBytecodeWriter;
+    
     /// <summary>
     /// The generated bytecode stream.
     /// </summary>
     std::vector<uint8_t> Bytecode_;
     
     /// <summary>
-    /// String constant table.
-    /// Maps strings to their indices for bytecode references.
+    /// Size of the bytecode TakeBytecode() last moved out, which the next
+    /// proc written with this writer is given room for up front.
+    /// </summary>
+    size_t LastBytecodeSize_ = 0;
+    
+    /// <summary>
+    /// Tree holding the string table, if any.
+    /// Otherwise strings go in OwnStrings_, created on first use.
     /// </summary>
-    std::unordered_map<std::string, int> StringTable_;
-    std::vector<std::string> Strings_;
+    DMObjectTree* ObjectTree_;
+    std::unique_ptr<ConcurrentStringInterner> OwnStrings_;
     
     /// <summary>
     /// Label tracking for jump instructions.
@@ -217,6 +292,24 @@ private:
     };
     std::vector<PendingJump> PendingJumps_;
     
+    /// <summary>
+    /// Position of every opcode written, in order.
+    /// Lets Optimize() split the stream into instructions.
+    /// </summary>
+    std::vector<size_t> InstructionStarts_;
+    
+    /// <summary>
+    /// Deepest the stack got while each instruction was being emitted.
+    /// </summary>
+    std::vector<int> InstructionPeaks_;
+    
+    /// <summary>
+    /// Depth the ResizeStack() calls had reached when each instruction started,
+    /// and what the calls made while it was emitted changed it by.
+    /// </summary>
+    std::vector<int> InstructionDepths_;
+    std::vector<int> InstructionDeltas_;
+    
     /// <summary>
     /// Next label ID to assign.
     /// </summary>
@@ -232,6 +325,25 @@ private:
     /// </summary>
     int MaxStackSize_;
     
+    /// <summary>
+    /// Split the byte stream into instructions, with their labels and jumps.
+    /// </summary>
+    /// <param name="trailingLabels">Gets the labels marked after the last instruction</param>
+    /// <returns>False if the instructions, jumps and labels do not line up</returns>
+    bool LiftInstructions(std::vector<BytecodeInstruction>& instructions, std::vector<int>& trailingLabels) const;
+    
+    /// <summary>
+    /// Replace the byte stream with lifted instructions, along with their
+    /// labels, jumps and stack counts.
+    /// </summary>
+    /// <returns>Deepest the stack got while any of them was emitted</returns>
+    int StoreInstructions(const std::vector<BytecodeInstruction>& instructions, const std::vector<int>& trailingLabels);
+    
+    /// <summary>
+    /// Write the opcode that starts an instruction.
+    /// </summary>
+    void WriteOpcode(DreamProcOpcode opcode);
+    
     /// <summary>
     /// Write a byte to the bytecode stream.
     /// </summary>
@@ -253,4 +365,27 @@ private:
     void WriteFloat(float value);
 };
 
+/// <summary>
+/// A BytecodeWriter borrowed from this thread's pool, for writing one proc.
+///
+/// The writer goes back to the pool Reset() when this is destroyed, so its
+/// buffers keep the capacity they grew to and a thread compiling many procs
+/// (see ParallelProcCompiler) stops allocating for them after the first few.
+/// Procs compiled while another is being written get a writer of their own.
+/// </summary>
+class PooledBytecodeWriter {
+public:
+    explicit PooledBytecodeWriter(DMObjectTree* objectTree);
+    ~PooledBytecodeWriter();
+    
+    PooledBytecodeWriter(const PooledBytecodeWriter&) = delete;
+    PooledBytecodeWriter& operator=(const PooledBytecodeWriter&) = delete;
+    
+    BytecodeWriter& operator*() const { return *Writer_; }
+    BytecodeWriter* operator->() const { return Writer_.get(); }
+    
+private:
+    std::unique_ptr<BytecodeWriter> Writer_;
+};
+
 } // namespace DMCompiler
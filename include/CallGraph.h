@@ -0,0 +1,120 @@
+#pragma once
+
+#include "OperandEncoding.h"
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Which procs may call which, read from compiled bytecode, so dead procs and
+/// deep or recursive call paths can be found without running anything.
+///
+/// Procs are numbered as given, which is their ID in the output. A call names
+/// its callee in one of these ways, and gets edges to:
+///   - A GlobalProc reference (Call's) or a proc ID operand (PushProc's):
+///     that proc
+///   - Call on a SrcProc reference, or DereferenceCall right after pushing
+///     src: the definition the caller's type would run and every override of
+///     it on a subtype, since src may be one
+///   - Any other DereferenceCall: every proc with that name
+///   - CallStatement on a SuperProc reference (..()): the definition the
+///     caller overrides, the next lower one on its own type or else the
+///     closest on a parent
+///   - A type operand (PushType and the like): the New and __init__ that
+///     creating that type runs, since naming a type is how new gets one
+///
+/// Anything picked at run time (call()(), a path built from text, hooks the
+/// engine runs itself) has no edge, so a proc nothing reaches may still be
+/// called that way. Roots are the procs the caller marks, for the
+/// disassembler those on /world and every verb.
+/// </summary>
+class CallGraph {
+public:
+    struct Type {
+        std::string Path;
+        int ParentId = -1;
+    };
+
+    struct Proc {
+        std::string Name;
+        int OwnerTypeId = -1;
+        const std::vector<uint8_t>* Bytecode = nullptr;  // Only read while the graph is built
+        bool IsRoot = false;
+    };
+
+    /// @param stringAt Resolves a string ID operand
+    CallGraph(const std::vector<Type>& types, const std::vector<Proc>& procs,
+              const std::function<std::string(uint32_t)>& stringAt, OperandEncoding encoding);
+
+    size_t GetProcCount() const { return Callees_.size(); }
+
+    /// Procs a proc may call, by ID in ascending order
+    const std::vector<int>& GetCallees(int procId) const { return Callees_[procId]; }
+
+    /// The procs marked as roots, in ID order
+    const std::vector<int>& GetRoots() const { return Roots_; }
+
+    /// Procs whose bytes do not decode to their end (an opcode the table does
+    /// not list, an operand running past the end), so their calls may be missed
+    const std::vector<int>& GetUnreadable() const { return Unreadable_; }
+
+    /// The New and __init__ creating a type runs first, or none if it has neither
+    std::vector<int> Constructors(int typeId) const;
+
+    /// Whether each proc can be reached from any of roots
+    std::vector<bool> FindReachable(const std::vector<int>& roots) const;
+
+    /// Procs the roots do not reach, in ID order
+    std::vector<int> FindUnreachable() const;
+
+    /// Sets of procs that can call back into themselves, a proc calling
+    /// itself being a set of one; each set is in ID order, the sets by their first
+    std::vector<std::vector<int>> FindRecursiveGroups() const;
+
+    /// The longest chain of calls, caller first, counting each recursive set
+    /// as one step. It takes the shortest way through a set, so no proc is in
+    /// it twice.
+    std::vector<int> FindDeepestChain() const;
+
+    /// The proc as it reads in a report, "/mob/player/Login" or "/proc/helper"
+    const std::string& GetLabel(int procId) const { return Labels_[procId]; }
+
+    /// Write the graph in Graphviz DOT, roots boxed and unreachable procs grey
+    void WriteDot(std::ostream& out) const;
+
+    /// The graph as JSON: every proc with its callees and whether it is
+    /// reachable, the recursive sets and the deepest chain
+    std::string ToJson() const;
+
+    /// Point a proc's GlobalProc references and proc ID operands at new IDs,
+    /// in place. Every ID it names must map to one no larger, so a LEB128
+    /// operand is rewritten padded to the length it had.
+    /// @param newIds New ID of each old one
+    static void RenumberProcs(std::vector<uint8_t>& bytecode, const std::vector<int>& newIds, OperandEncoding encoding);
+
+private:
+    std::vector<std::string> Labels_;
+    std::vector<int> Owners_;
+    std::vector<int> Parents_;
+    std::vector<std::string> Names_;
+    std::vector<std::vector<int>> Callees_;
+    std::vector<int> Roots_;
+    std::vector<int> Unreadable_;
+    std::unordered_map<std::string, std::vector<int>> ProcsByName_;  // In ID order
+
+    /// The proc at or above a type that a call by name would run, or -1
+    /// @param before On typeId itself, only look at procs with a lower ID than this
+    int Resolve(int typeId, const std::string& name, int before = -1) const;
+
+    bool IsSubtypeOf(int typeId, int ancestorId) const;
+
+    /// Strongly connected component of each proc, numbered callees first
+    std::vector<int> FindComponents(size_t& componentCount) const;
+};
+
+} // namespace DMCompiler
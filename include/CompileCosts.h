@@ -0,0 +1,72 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+
+namespace DMCompiler {
+
+class DMProc;
+
+/// <summary>
+/// Time spent on each source file and each proc, collected with
+/// --compile-costs [N] to find the generated files and huge procs worth
+/// splitting. Every file and proc is timed, nothing is sampled.
+///
+/// A file is charged for the time it is the one being preprocessed, so not
+/// for the files it includes, and for parsing the top-level statements that
+/// start in it. Files lexed ahead on --lex-threads or served from the token
+/// cache are charged only for the preprocessing after lexing, and with
+/// --stream-tokens parsing includes waiting on the preprocessor. A proc is
+/// charged for compiling its body, in DMProc::Compile() or EmitBytecode(),
+/// on whichever thread does it; procs compiled again after a speculative
+/// attempt are charged for both. Safe to charge from any thread.
+/// </summary>
+class CompileCosts {
+public:
+    using Duration = std::chrono::steady_clock::duration;
+
+    enum class FileStage { Preprocess, Parse };
+
+    /// Charges a proc for the time from its creation to its destruction
+    class ProcTimer {
+    public:
+        /// @param costs nullptr when costs are not collected, which times nothing
+        ProcTimer(CompileCosts* costs, const DMProc* proc)
+            : Costs_(costs), Proc_(proc), Start_(costs ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+        ~ProcTimer() {
+            if (Costs_) {
+                Costs_->AddProcTime(Proc_, std::chrono::steady_clock::now() - Start_);
+            }
+        }
+        ProcTimer(const ProcTimer&) = delete;
+        ProcTimer& operator=(const ProcTimer&) = delete;
+
+    private:
+        CompileCosts* Costs_;
+        const DMProc* Proc_;
+        std::chrono::steady_clock::time_point Start_;
+    };
+
+    void AddFileTime(uint32_t fileId, FileStage stage, Duration time);
+    void AddProcTime(const DMProc* proc, Duration time);
+
+    /// Print the files and procs that cost the most. Procs are named through
+    /// their owners, so this runs while the object tree still holds them.
+    /// @param topCount Rows to show per table
+    void Report(std::ostream& out, size_t topCount) const;
+
+private:
+    struct FileCost {
+        Duration Preprocess{};
+        Duration Parse{};
+    };
+
+    mutable std::mutex Mutex_;
+    std::unordered_map<uint32_t, FileCost> Files_;  // By SourceFileRegistry ID
+    std::unordered_map<const DMProc*, Duration> Procs_;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "DMCompiler.h"
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Resident compiler (dmcompiler --server) that recompiles on request, so a
+/// rebuild during development does not start from cold caches each time.
+///
+/// Requests and replies are one JSON object per line, as for dmdisasm serve:
+///   {"id": 1, "method": "Compile", "params": {"args": ["tgstation.dme"], "directory": "/src/tg"}}
+///   {"id": 1, "result": {"Success": true, "Errors": 0, "Warnings": 3, "Ms": 812.4, "Output": "...", "Messages": [...]}}
+/// args are the command line a compile would be given and directory the one
+/// it would be run from. Methods are Compile, Stats and Reset (dropping what
+/// is kept).
+///
+/// Every compile gets a fresh DMCompiler: the object tree is built from the
+/// parsed definitions each time. What is kept is what makes that fast. The
+/// token cache holds its entries in memory, the last DMStandard snapshot is
+/// reused while DMStandard is unchanged, and compiles that do not name their
+/// own caches use the server's AST, map, proc and token caches in cacheDir, so
+/// only changed files are lexed and parsed, only changed maps converted and
+/// only changed procs compiled.
+/// Compiles run one at a time, their console output captured for the reply.
+/// </summary>
+class CompileServer {
+public:
+    /// Turn a compile's command line into settings, printing any error
+    using ArgumentParser = std::function<bool(const std::vector<std::string>& args, DMCompilerSettings& settings)>;
+
+    CompileServer(std::string cacheDir, ArgumentParser parseArguments);
+
+    /// Answer one request line
+    /// @return The reply line, without its newline
+    std::string Handle(const std::string& request);
+
+    /// Answer requests read from in until it ends, for an editor that runs the
+    /// server as a child process
+    void Serve(std::istream& in, std::ostream& out);
+
+    /// Answer requests from clients of a local (Unix domain) socket until the
+    /// process is stopped
+    /// @param socketPath Where to create the socket; a stale one is replaced
+    /// @return false if the socket cannot be set up
+    bool Listen(const std::string& socketPath);
+
+    /// Have the server at socketPath run a compile (dmcompiler --connect),
+    /// printing its output to out
+    /// @param args The compile's command line, run from the current directory
+    /// @return false if the compile failed or the server could not be asked
+    static bool CompileRemotely(const std::string& socketPath, const std::vector<std::string>& args, std::ostream& out);
+
+private:
+    std::string CacheDir_;
+    ArgumentParser ParseArguments_;
+    std::shared_ptr<DMCompilerWarmState> WarmState_;
+    int Compiles_ = 0;
+    std::mutex Mutex_;  // Held per request; compiles share the warm state and std::cout
+
+    /// Set up an empty warm state with the server's token cache
+    void ResetWarmState();
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Time, memory and allocations of each compile phase, collected with
+/// --timings=json or --timings=trace to track compile time across compiler
+/// versions.
+///
+/// A phase is timed from Time() until its scope ends, and one begun while
+/// another is running is nested in it (ConstantFolding in ParseFiles). CPU
+/// time is the whole process's, every thread included, so it exceeds wall
+/// time when phases run threaded. Peak RSS is the process's high-water mark
+/// when the phase ends, so the phase that raised it is the first showing the
+/// new figure. Allocations counts calls to the global operator new on any
+/// thread while timings exist, and AllocatedBytes what they asked for; AST
+/// nodes come from an arena and are counted only as its chunks. The figures
+/// are the same whichever allocator serves operator new (AllocatorName()).
+/// Report() prints a table, WriteJson() the figures as
+/// [name].timings.json and WriteTrace() Chrome trace events (chrome://tracing,
+/// Perfetto) as [name].trace.json.
+/// </summary>
+class CompileTimings {
+public:
+    struct Phase {
+        std::string Name;
+        int Depth = 0;              // Phases it runs inside
+        double StartMs = 0;         // From when the timings were created
+        double WallMs = 0;
+        double CpuMs = 0;
+        uint64_t PeakRssBytes = 0;  // 0 where the platform does not say
+        uint64_t Allocations = 0;
+        uint64_t AllocatedBytes = 0;
+    };
+
+    /// Ends its phase when destroyed, or when End() is called first
+    class Scope {
+    public:
+        Scope() = default;
+        Scope(Scope&& other) noexcept;
+        Scope& operator=(Scope&& other) noexcept;
+        ~Scope() { End(); }
+
+        void End();
+
+    private:
+        friend class CompileTimings;
+        Scope(CompileTimings* timings, size_t index) : Timings_(timings), Index_(index) {}
+
+        CompileTimings* Timings_ = nullptr;
+        size_t Index_ = 0;
+    };
+
+    CompileTimings();
+    ~CompileTimings();
+    CompileTimings(const CompileTimings&) = delete;
+    CompileTimings& operator=(const CompileTimings&) = delete;
+
+    /// Time a phase until the returned scope ends
+    /// @param timings Where to record it; nullptr when timings are off, which makes an empty scope
+    static Scope Time(CompileTimings* timings, std::string name);
+
+    /// The allocator under operator new: "mimalloc" or "jemalloc" when the
+    /// build links one (scons --allocator), else "system"
+    static const char* AllocatorName();
+
+    /// Phases in the order they began
+    const std::vector<Phase>& GetPhases() const { return Phases_; }
+
+    /// Print each phase, indented under the one it ran in
+    void Report(std::ostream& out) const;
+
+    /// Write every phase as JSON
+    bool WriteJson(const std::string& path) const;
+
+    /// Write every phase as a Chrome trace "complete" event, the figures in its args
+    bool WriteTrace(const std::string& path) const;
+
+private:
+    struct Start {
+        std::chrono::steady_clock::time_point Wall;
+        double CpuMs;
+        uint64_t Allocations;
+        uint64_t AllocatedBytes;
+    };
+
+    std::chrono::steady_clock::time_point Created_;
+    std::vector<Phase> Phases_;
+    std::vector<Start> Starts_;  // Of each phase
+    int OpenPhases_ = 0;
+
+    void EndPhase(size_t index);
+};
+
+} // namespace DMCompiler
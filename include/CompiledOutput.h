@@ -0,0 +1,369 @@
+#pragma once
+
+#include "FlatHashMap.h"
+#include "JsonWriter.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Binary form of the compiled output, written next to the JSON as
+/// [name].dmbc with --binary-output. It holds what the JSON does, but proc
+/// bytecode is kept as raw bytes instead of a decimal number per byte.
+///
+/// The layout is meant to be mapped into memory and read in place:
+/// - Everything is little-endian 32-bit words.
+/// - Sections start on 8-byte boundaries.
+/// - Records are fixed size.
+/// - Anything of variable length (text, bytecode, lists) sits in a pool,
+///   and records point into it by offset and count.
+///
+/// The file is a header, a section table, then the sections:
+///   Header         "DMBC", version, flags (CompiledOutputFlags), section count
+///   Section table  per section: id, 0, offset (low, high), size (low, high)
+///
+/// Sections, found by id; readers skip ids they do not know:
+///   STRS  the runtime's string table, as a string pool
+///   NAME  every other text (type paths, proc, var and verb names, string
+///         values), as a string pool
+///   RSRC  resource paths in resource ID order, as a string pool
+///   INTS  the u32 pool the records' lists point into
+///   VALS  CompiledValue records: var defaults, globals, map overrides
+///   TYPE  CompiledType records, in type ID order
+///   PROC  CompiledProc records, in proc ID order
+///   CODE  every distinct bytecode once, back to back; procs whose bytecode
+///         is the same share one range
+///   ROOT  one CompiledRoot record
+///   MAPS  CompiledMap records, in map order
+///   KEYS  CompiledCellKey records, each map's by key ID
+///   CELL  CompiledCell records, shared by every map: a cell's contents are
+///         stored once however many keys, maps and z-levels use them
+///   MOBJ  CompiledMapObject records, stored once each the same way
+///   BLKS  CompiledBlock records
+///   VERB  CompiledVerb records, one per verb in proc ID order, so verbs are
+///         registered by walking one table rather than every proc
+///   VIDX  indexes into VERB in the byte order of the verbs' names (by index
+///         where they tie), for finding a verb by name with a binary search
+///
+/// CODE comes last in the file, so when a rebuild changes one proc, only
+/// the records and the code after it move (see PatchBinaryFile).
+///
+/// A string pool is a count, count + 1 offsets from the end of the offsets
+/// table, then the bytes. A "pairs" list is count (a, b) pairs in INTS.
+/// </summary>
+namespace CompiledOutputFormat {
+
+constexpr char Magic[4] = {'D', 'M', 'B', 'C'};
+constexpr uint32_t Version = 3;
+constexpr uint32_t NoName = 0xFFFFFFFFu;
+constexpr uint32_t NoCell = 0xFFFFFFFFu;
+
+/// Section id from its four letters, as stored
+constexpr uint32_t SectionId(const char (&name)[5]) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 8 |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 16 |
+           static_cast<uint32_t>(static_cast<uint8_t>(name[3])) << 24;
+}
+
+} // namespace CompiledOutputFormat
+
+enum CompiledOutputFlags : uint32_t {
+    CompiledOutputLeb128Operands = 1u << 0,  // Operands are OperandEncoding::Leb128
+};
+
+enum class CompiledValueKind : uint32_t {
+    Null = 0,
+    Bool = 1,      // Low: 0 or 1
+    Int = 2,       // Low, High: int64
+    Double = 3,    // Low, High: the double's bits
+    String = 4,    // Low: name
+    Map = 5,       // Low: INTS offset of Count (key, value) name pairs
+    Resource = 6,  // Low: resource ID
+};
+
+struct CompiledValue {
+    CompiledValueKind Kind;
+    uint32_t Count;
+    uint32_t Low;
+    uint32_t High;
+};
+
+struct CompiledType {
+    uint32_t Path;            // Name
+    int32_t Parent;           // -1 for the root
+    int32_t InitProc;         // -1 for none
+    int32_t TreeIndex;        // -1 if not numbered
+    int32_t SubtreeEnd;
+    uint32_t ProcGroups;      // INTS offset of ProcGroupCount (offset, count) lists of proc IDs,
+    uint32_t ProcGroupCount;  // one per proc name in name order, base proc first
+    uint32_t Variables;       // Pairs (name, value), in the JSON's order
+    uint32_t VariableCount;
+    uint32_t ConstVariables;  // Names
+    uint32_t ConstVariableCount;
+    uint32_t TmpVariables;    // Names
+    uint32_t TmpVariableCount;
+};
+
+enum CompiledProcFlags : uint32_t {
+    CompiledProcIsVerb = 1u << 0,
+    CompiledProcHasVerbSource = 1u << 1,
+};
+
+struct CompiledProc {
+    int32_t OwningType;
+    uint32_t Name;
+    uint32_t Attributes;
+    uint32_t MaxStackSize;
+    uint32_t Arguments;       // Pairs (name, DMValueType flags)
+    uint32_t ArgumentCount;
+    uint32_t Line;
+    uint32_t Flags;           // CompiledProcFlags
+    uint32_t CodeOffset;      // Into CODE, maybe shared with other procs
+    uint32_t CodeSize;
+    int32_t VerbSource;
+    uint32_t VerbName;        // Names, NoName if unset
+    uint32_t VerbCategory;
+    uint32_t VerbDescription;
+    int32_t Invisibility;
+};
+
+enum CompiledVerbFlags : uint32_t {
+    CompiledVerbAttributes = 0xFFu,      // The proc's ProcAttributes
+    CompiledVerbHasSource = 1u << 8,
+    CompiledVerbNamedByProc = 1u << 9,   // No name was set, so Name is the proc's
+};
+
+struct CompiledVerb {
+    int32_t Type;             // The type it is defined on
+    uint32_t Proc;
+    uint32_t Name;            // Names
+    uint32_t Category;        // Names, NoName if unset
+    uint32_t Description;
+    uint32_t Flags;           // CompiledVerbFlags
+    int32_t Source;           // VerbSrc, -1 if unset
+    int32_t Invisibility;
+};
+
+struct CompiledRoot {
+    uint32_t GlobalProcs;     // Proc IDs in ID order
+    uint32_t GlobalProcCount;
+    uint32_t Globals;         // Pairs (name, value) in global ID order
+    uint32_t GlobalCount;
+    uint32_t OptionalErrors;  // Pairs (warning code, error level)
+    uint32_t OptionalErrorCount;
+};
+
+struct CompiledMap {
+    int32_t MaxX;
+    int32_t MaxY;
+    int32_t MaxZ;
+    uint32_t FirstKey;        // Into KEYS
+    uint32_t KeyCount;
+    uint32_t FirstBlock;      // Into BLKS
+    uint32_t BlockCount;
+};
+
+struct CompiledCellKey {
+    uint32_t Name;            // The key's text
+    uint32_t Cell;            // Into CELL, NoCell if the map does not define the key
+};
+
+struct CompiledCell {
+    int32_t Turf;             // Into MOBJ, -1 for none
+    int32_t Area;             // Into MOBJ, -1 for none
+    uint32_t Objects;         // Indexes into MOBJ
+    uint32_t ObjectCount;
+};
+
+struct CompiledMapObject {
+    int32_t Type;
+    uint32_t Overrides;       // Pairs (name, value)
+    uint32_t OverrideCount;
+};
+
+struct CompiledBlock {
+    int32_t X;
+    int32_t Y;
+    int32_t Z;
+    int32_t Width;
+    int32_t Height;
+    uint32_t Cells;           // Indexes into the map's keys, from its FirstKey
+    uint32_t CellCount;
+};
+
+/// <summary>
+/// Builds a file in the CompiledOutput format. Names, values, map objects
+/// and cells are pooled, so each distinct one is stored once.
+/// </summary>
+class CompiledOutputWriter {
+public:
+    void SetFlags(uint32_t flags) { Flags_ = flags; }
+    void SetStrings(const std::vector<std::string>& strings) { Strings_ = strings; }
+    void SetResources(const std::vector<std::string>& resources) { Resources_ = resources; }
+    void SetRoot(const CompiledRoot& root) { Root_ = root; }
+
+    uint32_t AddName(std::string_view name);
+    uint32_t AddValue(const JsonValue& value);
+
+    /// Append to INTS
+    /// @return The offset of the first one
+    uint32_t AddInts(const std::vector<uint32_t>& ints);
+
+    void AddType(const CompiledType& type) { Types_.push_back(type); }
+    /// Sets the proc's CodeOffset and CodeSize, pointing at an earlier proc's
+    /// copy if one had the same bytecode
+    void AddProc(CompiledProc proc, const std::vector<uint8_t>& bytecode);
+    /// Bytes of bytecode AddProc() did not store again
+    size_t SharedCodeBytes() const { return SharedCodeBytes_; }
+    /// Store bytecode before the procs it belongs to are added, so it comes
+    /// earlier in CODE; AddProc() points procs with the same bytecode at it
+    void PlaceCode(const std::vector<uint8_t>& bytecode);
+
+    /// @param overrides Pairs (name, value), sorted by name
+    uint32_t AddMapObject(int32_t type, const std::vector<uint32_t>& overrides);
+    /// @param objects Indexes into MOBJ, in the cell's order
+    uint32_t AddCell(int32_t turf, int32_t area, const std::vector<uint32_t>& objects);
+    void AddCellKey(const CompiledCellKey& key) { CellKeys_.push_back(key); }
+    uint32_t AddBlock(const CompiledBlock& block);
+    void AddMap(const CompiledMap& map) { Maps_.push_back(map); }
+    /// Verbs are added in proc ID order; Finish() sorts the name index
+    void AddVerb(const CompiledVerb& verb) { Verbs_.push_back(verb); }
+    uint32_t CellKeyCount() const { return static_cast<uint32_t>(CellKeys_.size()); }
+    uint32_t CellCount() const { return static_cast<uint32_t>(Cells_.size()); }
+    uint32_t BlockCount() const { return static_cast<uint32_t>(Blocks_.size()); }
+
+    /// The whole file
+    std::string Finish() const;
+
+private:
+    uint32_t Flags_ = 0;
+    std::vector<std::string> Strings_;
+    std::vector<std::string> Resources_;
+    std::vector<std::string> Names_;
+    FlatHashMap<uint32_t> NameIds_;
+    std::vector<uint32_t> Ints_;
+    std::vector<CompiledValue> Values_;
+    FlatHashMap<uint32_t> ValueIds_;  // By the value's record bytes
+    std::vector<CompiledType> Types_;
+    std::vector<CompiledProc> Procs_;
+    std::string Code_;
+    struct StoredCode {
+        uint32_t Offset;
+        uint32_t Size;
+        bool Used;  // By a proc, rather than only placed
+    };
+    std::unordered_map<size_t, std::vector<StoredCode>> CodeByHash_;  // Hash to the code stored with it
+    size_t SharedCodeBytes_ = 0;
+    CompiledRoot Root_{};
+    std::vector<CompiledMap> Maps_;
+    std::vector<CompiledCellKey> CellKeys_;
+    std::vector<CompiledCell> Cells_;
+    FlatHashMap<uint32_t> CellIds_;       // By the turf, area and object words
+    std::vector<CompiledMapObject> MapObjects_;
+    FlatHashMap<uint32_t> MapObjectIds_;  // By the type and override words
+    std::vector<CompiledBlock> Blocks_;
+    std::vector<CompiledVerb> Verbs_;
+
+    /// Offset of code in CODE, storing it unless it is there already
+    /// @param shared Set if a proc already uses the stored copy
+    uint32_t StoreCode(std::string_view code, bool use, bool& shared);
+};
+
+/// <summary>
+/// Reads a CompiledOutput file in place, from memory that outlives the view
+/// (a mapped file or a buffer). Open() checks the sections, the string pools
+/// and each proc's bytecode range. After that no accessor reads outside the
+/// file: an index out of range gives empty text or zeroed words. Records
+/// are copied out, since their words are read as little-endian. Text and
+/// bytecode come back as views into the file.
+/// </summary>
+class CompiledOutputView {
+public:
+    /// @return False if data is not a CompiledOutput file of this version, is cut short,
+    /// or has a record whose list runs past the end of INTS
+    bool Open(std::string_view data);
+
+    uint32_t Flags() const { return Flags_; }
+
+    size_t StringCount() const { return Strings_.Count; }
+    std::string_view GetString(size_t index) const { return Strings_.Get(Data_, index); }
+    size_t NameCount() const { return Names_.Count; }
+    std::string_view GetName(uint32_t name) const { return Names_.Get(Data_, name); }
+    size_t ResourceCount() const { return Resources_.Count; }
+    std::string_view GetResource(size_t index) const { return Resources_.Get(Data_, index); }
+
+    uint32_t GetInt(uint32_t offset) const { return ReadWord(Ints_.Offset + size_t(offset) * 4); }
+    CompiledValue GetValue(uint32_t index) const { return GetRecord<CompiledValue>(Values_, index); }
+
+    size_t TypeCount() const { return Types_.Size / sizeof(CompiledType); }
+    CompiledType GetType(size_t index) const { return GetRecord<CompiledType>(Types_, index); }
+    size_t ProcCount() const { return Procs_.Size / sizeof(CompiledProc); }
+    CompiledProc GetProc(size_t index) const { return GetRecord<CompiledProc>(Procs_, index); }
+    std::string_view GetBytecode(const CompiledProc& proc) const {
+        return Data_.substr(Code_.Offset + proc.CodeOffset, proc.CodeSize);
+    }
+
+    CompiledRoot GetRoot() const { return GetRecord<CompiledRoot>(Root_, 0); }
+    size_t MapCount() const { return Maps_.Size / sizeof(CompiledMap); }
+    CompiledMap GetMap(size_t index) const { return GetRecord<CompiledMap>(Maps_, index); }
+    CompiledCellKey GetCellKey(size_t index) const { return GetRecord<CompiledCellKey>(CellKeys_, index); }
+    CompiledCell GetCell(size_t index) const { return GetRecord<CompiledCell>(Cells_, index); }
+    CompiledMapObject GetMapObject(size_t index) const { return GetRecord<CompiledMapObject>(MapObjects_, index); }
+    CompiledBlock GetBlock(size_t index) const { return GetRecord<CompiledBlock>(Blocks_, index); }
+
+    size_t VerbCount() const { return Verbs_.Size / sizeof(CompiledVerb); }
+    CompiledVerb GetVerb(size_t index) const { return GetRecord<CompiledVerb>(Verbs_, index); }
+    /// The verb at position in name order
+    uint32_t GetVerbByName(size_t position) const { return ReadWord(VerbIndex_.Offset + position * 4); }
+    /// Positions in name order of the verbs with this name, as [first, last)
+    std::pair<size_t, size_t> FindVerbs(std::string_view name) const;
+
+private:
+    struct Section {
+        size_t Offset = 0;
+        size_t Size = 0;
+    };
+
+    struct StringPool {
+        size_t Count = 0;
+        size_t Offsets = 0;  // Of the offsets table
+        size_t Bytes = 0;    // Of the text
+
+        std::string_view Get(std::string_view data, size_t index) const;
+    };
+
+    std::string_view Data_;
+    uint32_t Flags_ = 0;
+    StringPool Strings_, Names_, Resources_;
+    Section Ints_, Values_, Types_, Procs_, Code_, Root_, Maps_, CellKeys_, Cells_, MapObjects_, Blocks_, Verbs_,
+        VerbIndex_;
+
+    uint32_t ReadWord(size_t offset) const;
+    bool OpenStringPool(const Section& section, StringPool& pool) const;
+    // Whether the count words from INTS offset are all in INTS
+    bool InInts(uint64_t offset, uint64_t count) const { return offset + count <= Ints_.Size / 4; }
+
+    template <typename Record>
+    Record GetRecord(const Section& section, size_t index) const {
+        static_assert(std::is_trivially_copyable_v<Record> && sizeof(Record) % 4 == 0, "records are u32 words");
+        uint32_t words[sizeof(Record) / 4];
+        size_t offset = section.Offset + index * sizeof(Record);
+        for (size_t i = 0; i < sizeof(Record) / 4; ++i) {
+            words[i] = ReadWord(offset + i * 4);
+        }
+        Record record;
+        std::memcpy(&record, words, sizeof(Record));
+        return record;
+    }
+};
+
+} // namespace DMCompiler
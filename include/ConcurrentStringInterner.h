@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Table of unique strings, each with a stable ID (its index in the table),
+/// that several threads can add to at once. Unlike the StringInterner of
+/// TokenBuffer, it backs the string table of the compiled output.
+///
+/// Lookups take a string_view and hash it once: the shard it lives in and its
+/// bucket both come from that hash, and nothing is copied unless the string
+/// is new. Shards have their own locks, so threads interning different
+/// strings rarely wait on each other. The strings themselves are kept in one
+/// list that only grows, so IDs and references to them never change.
+///
+/// Which ID a new string gets depends on the order strings are first
+/// interned in; callers that need the same IDs on every run intern in a
+/// fixed order (see ParallelProcCompiler).
+/// </summary>
+class ConcurrentStringInterner {
+public:
+    ConcurrentStringInterner();
+    ~ConcurrentStringInterner();
+
+    ConcurrentStringInterner(const ConcurrentStringInterner&) = delete;
+    ConcurrentStringInterner& operator=(const ConcurrentStringInterner&) = delete;
+
+    /// Get the ID of a string, adding it if it is new
+    int Intern(std::string_view value);
+
+    /// Get the ID of a string, or -1 if it was never interned
+    int Find(std::string_view value) const;
+
+    /// The string with an ID
+    const std::string& operator[](int id) const;
+
+    size_t Size() const;
+
+    /// Copy of every string, in ID order
+    std::vector<std::string> ToVector() const;
+
+private:
+    static constexpr int ShardBits = 4;
+    static constexpr size_t ShardCount = size_t(1) << ShardBits;
+
+    // A view of a stored string along with its hash, which buckets reuse
+    struct Key {
+        std::string_view Text;
+        size_t Hash;
+        bool operator==(const Key& other) const { return Text == other.Text; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return key.Hash; }
+    };
+
+    struct Shard {
+        mutable std::shared_mutex Mutex;
+        std::unordered_map<Key, int, KeyHash> Ids;
+    };
+
+    // Top bits, since buckets go by the low ones
+    Shard& ShardFor(size_t hash) const {
+        return *Shards_[hash >> (std::numeric_limits<size_t>::digits - ShardBits)];
+    }
+
+    std::array<std::unique_ptr<Shard>, ShardCount> Shards_;
+    mutable std::shared_mutex StringsMutex_;
+    std::deque<std::string> Strings_;  // A deque never moves what it holds
+};
+
+} // namespace DMCompiler
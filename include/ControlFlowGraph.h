@@ -0,0 +1,79 @@
+#pragma once
+
+#include "DreamProcOpcode.h"
+#include <bitset>
+#include <cstdint>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// An instruction lifted out of BytecodeWriter's byte stream, so passes can
+/// move and drop instructions without tracking byte offsets themselves.
+/// </summary>
+struct BytecodeInstruction {
+    DreamProcOpcode Opcode = DreamProcOpcode::Error;
+    std::vector<uint8_t> Bytes;  // The whole instruction, opcode included
+    int JumpLabel = -1;          // Label whose offset it holds, if any
+    size_t JumpOffset = 0;       // Where in Bytes that offset goes
+    std::vector<int> Labels;     // Labels marked right before it
+    int StackPeak = 0;           // Deepest the stack got while it was emitted
+    int StackDepth = 0;          // Depth the ResizeStack() calls had it start at
+    int StackDelta = 0;          // What those calls changed the depth by while it was emitted
+};
+
+/// <summary>
+/// Basic blocks of a proc's lifted bytecode, with local variable liveness.
+///
+/// A block starts at the first instruction, at every labeled instruction and
+/// after every jump or return. Its successors follow the jump table kept by
+/// BytecodeWriter: a Jump only goes to its label, a return goes nowhere and any
+/// other instruction holding a label may go to it as well as fall through.
+///
+/// Local variables are matched on the bytes a reference to them is written
+/// as, so anything that might read one counts as reading it. Only a plain
+/// Assign or AssignNoPush to a local counts as writing it.
+/// </summary>
+class ControlFlowGraph {
+public:
+    /// Locals are addressed with one byte
+    using LocalSet = std::bitset<256>;
+
+    struct BasicBlock {
+        size_t Begin = 0;  // Index of its first instruction
+        size_t End = 0;    // Index past its last instruction
+        std::vector<size_t> Successors;
+        bool Reachable = false;
+        LocalSet LiveIn;   // Locals read before being written from its start
+        LocalSet LiveOut;  // Locals some successor needs
+    };
+
+    explicit ControlFlowGraph(const std::vector<BytecodeInstruction>& instructions);
+
+    const std::vector<BasicBlock>& GetBlocks() const { return Blocks_; }
+
+    /// Index of the block holding an instruction
+    size_t BlockOf(size_t instruction) const { return InstructionBlocks_[instruction]; }
+
+    /// Fill in LiveIn and LiveOut of every block
+    void ComputeLiveness();
+
+    /// Locals live right after an instruction (ComputeLiveness must have run)
+    LocalSet LiveAfter(size_t instruction) const;
+
+    /// The local a plain Assign/AssignNoPush writes, or -1
+    static int WrittenLocal(const BytecodeInstruction& instruction);
+
+    /// Locals an instruction might read
+    static LocalSet ReadLocals(const BytecodeInstruction& instruction);
+
+    /// True if control never falls through to the next instruction
+    static bool EndsFlow(DreamProcOpcode opcode);
+
+private:
+    const std::vector<BytecodeInstruction>& Instructions_;
+    std::vector<BasicBlock> Blocks_;
+    std::vector<size_t> InstructionBlocks_;
+};
+
+} // namespace DMCompiler
@@ -3,10 +3,12 @@
 #include "Location.h"
 #include "DreamPath.h"
 #include "DMVariable.h"
+#include "DMASTArena.h"
 #include <memory>
 #include <vector>
 #include <string>
 #include <optional>
+#include <cstdint>
 
 namespace DMCompiler {
 
@@ -16,14 +18,49 @@ class DMASTStatement;
 class DMASTProcStatement;
 class DMASTObjectStatement;
 
+/// <summary>
+/// Concrete class of an AST node, so passes can switch on it instead of trying
+/// a dynamic_cast per class. Every concrete class declares its own StaticKind
+/// and hands it to the base constructor.
+/// </summary>
+enum class DMASTNodeKind : uint8_t {
+    File, BlockInner, ProcBlockInner, CallParameter, DefinitionParameter,
+
+    // Expressions
+    InvalidExpression, Void, Identifier, ConstantInteger, ConstantFloat, ConstantString, StringFormat,
+    ConstantResource, ConstantNull, ConstantPath, ExpressionBinary, ExpressionUnary, List, NewList,
+    NewPath, Call, Dereference, Ternary, Assign, SwitchCaseRange,
+
+    // Proc statements
+    ProcStatementExpression, ProcStatementVarDeclaration, ProcStatementReturn, ProcStatementBreak,
+    ProcStatementContinue, ProcStatementGoto, ProcStatementLabel, ProcStatementDel, ProcStatementSpawn,
+    ProcStatementIf, ProcStatementFor, ProcStatementForIn, ProcStatementForRange, ProcStatementWhile,
+    ProcStatementDoWhile, ProcStatementSwitch, ProcStatementTryCatch, ProcStatementThrow, ProcStatementSet,
+
+    // Object statements
+    ObjectVarDefinition, ObjectVarOverride, ObjectProcDefinition, ObjectDefinition
+};
+
+// Each group above is contiguous, so the abstract bases are kind ranges
+inline bool IsExpressionKind(DMASTNodeKind kind) {
+    return kind >= DMASTNodeKind::InvalidExpression && kind <= DMASTNodeKind::SwitchCaseRange;
+}
+inline bool IsProcStatementKind(DMASTNodeKind kind) {
+    return kind >= DMASTNodeKind::ProcStatementExpression && kind <= DMASTNodeKind::ProcStatementSet;
+}
+inline bool IsObjectStatementKind(DMASTNodeKind kind) {
+    return kind >= DMASTNodeKind::ObjectVarDefinition && kind <= DMASTNodeKind::ObjectDefinition;
+}
+
 /// <summary>
 /// Base class for all AST nodes
 /// </summary>
 class DMASTNode {
 public:
     Location Location_;
+    DMASTNodeKind Kind_;  // Concrete class of the node (see DMASTCast)
     
-    explicit DMASTNode(const Location& location) : Location_(location) {}
+    DMASTNode(DMASTNodeKind kind, const Location& location) : Location_(location), Kind_(kind) {}
     virtual ~DMASTNode() = default;
     
     // Prevent copying
@@ -35,13 +72,38 @@ public:
     DMASTNode& operator=(DMASTNode&&) = default;
     
     virtual std::string ToString() const;
+    
+    // Nodes live either on the heap or in a DMASTArena. A small header in
+    // front of each node records which, so deleting through std::unique_ptr
+    // works for both and leaves arena memory to the arena.
+    static void* operator new(size_t size);
+    static void* operator new(size_t size, DMASTArena& arena);
+    static void operator delete(void* ptr);
+    static void operator delete(void* ptr, DMASTArena& arena);
 };
 
+/// Cast a node to a concrete AST class by its kind; nullptr if it is null or
+/// another class. Only concrete classes have a StaticKind to compare against
+template <typename T>
+T* DMASTCast(DMASTNode* node) {
+    return node && node->Kind_ == T::StaticKind ? static_cast<T*>(node) : nullptr;
+}
+
+template <typename T>
+const T* DMASTCast(const DMASTNode* node) {
+    return node && node->Kind_ == T::StaticKind ? static_cast<const T*>(node) : nullptr;
+}
+
 /// <summary>
 /// Root node representing an entire DM file
 /// </summary>
 class DMASTFile : public DMASTNode {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::File;
+    
+    /// Memory of the nodes parsed for this file (null if built by hand).
+    /// Declared first so it is destroyed after the statements
+    std::unique_ptr<DMASTArena> Arena;
     std::vector<std::unique_ptr<DMASTStatement>> Statements;
     
     DMASTFile(const Location& location, std::vector<std::unique_ptr<DMASTStatement>> statements);
@@ -52,6 +114,8 @@ public:
 /// </summary>
 class DMASTBlockInner : public DMASTNode {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::BlockInner;
+    
     std::vector<std::unique_ptr<DMASTStatement>> Statements;
     
     DMASTBlockInner(const Location& location, std::vector<std::unique_ptr<DMASTStatement>> statements);
@@ -62,6 +126,8 @@ public:
 /// </summary>
 class DMASTProcBlockInner : public DMASTNode {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcBlockInner;
+    
     std::vector<std::unique_ptr<DMASTProcStatement>> Statements;
     std::vector<std::unique_ptr<DMASTProcStatement>> SetStatements; // Hoisted set statements
     
@@ -98,6 +164,8 @@ struct DMASTPath {
 /// </summary>
 class DMASTCallParameter : public DMASTNode {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::CallParameter;
+    
     std::unique_ptr<DMASTExpression> Value;
     std::unique_ptr<DMASTExpression> Key; // For named parameters
     
@@ -111,6 +179,8 @@ public:
 /// </summary>
 class DMASTDefinitionParameter : public DMASTNode {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::DefinitionParameter;
+    
     std::string Name;
     DreamPath TypePath;
     bool IsList;
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Bump-pointer allocator backing the AST nodes of one parsed file.
+///
+/// DMParser::ParseFile allocates every node it creates from an arena that the
+/// resulting DMASTFile then owns. Nodes are still held by std::unique_ptr and
+/// their destructors still run (they own strings and child vectors), but
+/// deleting one does not free its memory; the chunks are released together
+/// when the arena is reset or destroyed, after all of its nodes.
+/// </summary>
+class DMASTArena {
+public:
+    /// Size of the regular chunks; larger requests get a chunk of their own
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    /// Every allocation is aligned to this
+    static constexpr size_t Alignment = alignof(std::max_align_t);
+
+    DMASTArena() = default;
+
+    DMASTArena(const DMASTArena&) = delete;
+    DMASTArena& operator=(const DMASTArena&) = delete;
+
+    /// Get size bytes of uninitialized memory, valid until Reset()
+    void* Allocate(size_t size);
+
+    /// Release every chunk at once. Objects placed in the arena must already
+    /// have been destroyed
+    void Reset();
+
+    /// Take over the chunks of another arena (which is left empty), so nodes
+    /// allocated in either one live as long as this arena
+    void Adopt(DMASTArena& other);
+
+    /// Bytes handed out since construction or the last Reset()
+    size_t BytesUsed() const { return BytesUsed_; }
+
+    size_t ChunkCount() const { return Chunks_.size(); }
+
+private:
+    std::vector<std::unique_ptr<std::max_align_t[]>> Chunks_;
+    char* Next_ = nullptr;
+    char* End_ = nullptr;
+    size_t BytesUsed_ = 0;
+
+    char* NewChunk(size_t size);
+};
+
+} // namespace DMCompiler
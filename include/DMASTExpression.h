@@ -16,17 +16,15 @@ class DMCompiler;
 /// </summary>
 class DMASTExpression : public DMASTNode {
 public:
-    explicit DMASTExpression(const Location& location) : DMASTNode(location) {}
+    DMASTExpression(DMASTNodeKind kind, const Location& location) : DMASTNode(kind, location) {}
     virtual ~DMASTExpression() = default;
     
-    virtual std::vector<DMASTExpression*> GetLeaves() { return {}; }
-    
     /// <summary>
     /// Try to convert this expression to a JSON representation.
     /// Returns true if the expression can be serialized to JSON, false otherwise.
     /// Only constant expressions can be serialized.
     /// </summary>
-    virtual bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) { 
+    virtual bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants&, JsonValue& outJson) { 
         return false; // Default: expressions cannot be serialized
     }
 };
@@ -36,7 +34,9 @@ public:
 /// </summary>
 class DMASTInvalidExpression : public DMASTExpression {
 public:
-    explicit DMASTInvalidExpression(const Location& location) : DMASTExpression(location) {}
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::InvalidExpression;
+    
+    explicit DMASTInvalidExpression(const Location& location) : DMASTExpression(StaticKind, location) {}
 };
 
 /// <summary>
@@ -44,7 +44,9 @@ public:
 /// </summary>
 class DMASTVoid : public DMASTExpression {
 public:
-    explicit DMASTVoid(const Location& location) : DMASTExpression(location) {}
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Void;
+    
+    explicit DMASTVoid(const Location& location) : DMASTExpression(StaticKind, location) {}
 };
 
 /// <summary>
@@ -52,10 +54,12 @@ public:
 /// </summary>
 class DMASTIdentifier : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Identifier;
+    
     std::string Identifier;
     
     DMASTIdentifier(const Location& location, const std::string& identifier)
-        : DMASTExpression(location), Identifier(identifier) {}
+        : DMASTExpression(StaticKind, location), Identifier(identifier) {}
 };
 
 // ============================================================================
@@ -67,12 +71,14 @@ public:
 /// </summary>
 class DMASTConstantInteger : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantInteger;
+    
     int32_t Value;
     
     DMASTConstantInteger(const Location& location, int32_t value)
-        : DMASTExpression(location), Value(value) {}
+        : DMASTExpression(StaticKind, location), Value(value) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -80,12 +86,14 @@ public:
 /// </summary>
 class DMASTConstantFloat : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantFloat;
+    
     float Value;
     
     DMASTConstantFloat(const Location& location, float value)
-        : DMASTExpression(location), Value(value) {}
+        : DMASTExpression(StaticKind, location), Value(value) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -93,12 +101,14 @@ public:
 /// </summary>
 class DMASTConstantString : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantString;
+    
     std::string Value;
     
     DMASTConstantString(const Location& location, const std::string& value)
-        : DMASTExpression(location), Value(value) {}
+        : DMASTExpression(StaticKind, location), Value(value) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -107,6 +117,8 @@ public:
 /// </summary>
 class DMASTStringFormat : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::StringFormat;
+    
     // String parts (one more than expressions count, or same if string ends with expression)
     std::vector<std::string> StringParts;
     // Embedded expressions
@@ -115,11 +127,11 @@ public:
     DMASTStringFormat(const Location& location,
                       std::vector<std::string> stringParts,
                       std::vector<std::unique_ptr<DMASTExpression>> expressions)
-        : DMASTExpression(location)
+        : DMASTExpression(StaticKind, location)
         , StringParts(std::move(stringParts))
         , Expressions(std::move(expressions)) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -127,12 +139,14 @@ public:
 /// </summary>
 class DMASTConstantResource : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantResource;
+    
     std::string Path;
     
     DMASTConstantResource(const Location& location, const std::string& path)
-        : DMASTExpression(location), Path(path) {}
+        : DMASTExpression(StaticKind, location), Path(path) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -140,9 +154,11 @@ public:
 /// </summary>
 class DMASTConstantNull : public DMASTExpression {
 public:
-    explicit DMASTConstantNull(const Location& location) : DMASTExpression(location) {}
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantNull;
+    
+    explicit DMASTConstantNull(const Location& location) : DMASTExpression(StaticKind, location) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 /// <summary>
@@ -150,12 +166,14 @@ public:
 /// </summary>
 class DMASTConstantPath : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ConstantPath;
+    
     DMASTPath Path;
     
     DMASTConstantPath(const Location& location, const DMASTPath& path)
-        : DMASTExpression(location), Path(path) {}
+        : DMASTExpression(StaticKind, location), Path(path) {}
     
-    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) override;
+    bool TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) override;
 };
 
 // ============================================================================
@@ -187,6 +205,8 @@ enum class BinaryOperator {
 /// </summary>
 class DMASTExpressionBinary : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ExpressionBinary;
+    
     BinaryOperator Operator;
     std::unique_ptr<DMASTExpression> Left;
     std::unique_ptr<DMASTExpression> Right;
@@ -194,11 +214,10 @@ public:
     DMASTExpressionBinary(const Location& location, BinaryOperator op,
                          std::unique_ptr<DMASTExpression> left,
                          std::unique_ptr<DMASTExpression> right)
-        : DMASTExpression(location), Operator(op), Left(std::move(left)), Right(std::move(right)) {}
+        : DMASTExpression(StaticKind, location), Operator(op), Left(std::move(left)), Right(std::move(right)) {}
     
-    std::vector<DMASTExpression*> GetLeaves() override {
-        return {Left.get(), Right.get()};
-    }
+    // Frees a chain of operators nested down the left in a loop, not one call per term
+    ~DMASTExpressionBinary() override;
 };
 
 // ============================================================================
@@ -220,16 +239,14 @@ enum class UnaryOperator {
 /// </summary>
 class DMASTExpressionUnary : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ExpressionUnary;
+    
     UnaryOperator Operator;
     std::unique_ptr<DMASTExpression> Expression;
     
     DMASTExpressionUnary(const Location& location, UnaryOperator op,
                         std::unique_ptr<DMASTExpression> expr)
-        : DMASTExpression(location), Operator(op), Expression(std::move(expr)) {}
-    
-    std::vector<DMASTExpression*> GetLeaves() override {
-        return {Expression.get()};
-    }
+        : DMASTExpression(StaticKind, location), Operator(op), Expression(std::move(expr)) {}
 };
 
 // ============================================================================
@@ -241,13 +258,15 @@ public:
 /// </summary>
 class DMASTList : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::List;
+    
     std::vector<std::unique_ptr<DMASTCallParameter>> Values;
     bool IsAssociativeList; // list() vs alist()
     
     DMASTList(const Location& location,
              std::vector<std::unique_ptr<DMASTCallParameter>> values,
              bool isAssociativeList = false)
-        : DMASTExpression(location), Values(std::move(values)), IsAssociativeList(isAssociativeList) {}
+        : DMASTExpression(StaticKind, location), Values(std::move(values)), IsAssociativeList(isAssociativeList) {}
 };
 
 /// <summary>
@@ -255,11 +274,13 @@ public:
 /// </summary>
 class DMASTNewList : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::NewList;
+    
     std::vector<std::unique_ptr<DMASTCallParameter>> Parameters;
     
     DMASTNewList(const Location& location,
                 std::vector<std::unique_ptr<DMASTCallParameter>> parameters)
-        : DMASTExpression(location), Parameters(std::move(parameters)) {}
+        : DMASTExpression(StaticKind, location), Parameters(std::move(parameters)) {}
 };
 
 /// <summary>
@@ -267,13 +288,15 @@ public:
 /// </summary>
 class DMASTNewPath : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::NewPath;
+    
     std::unique_ptr<DMASTExpression> Path;
     std::vector<std::unique_ptr<DMASTCallParameter>> Parameters;
     
     DMASTNewPath(const Location& location,
                 std::unique_ptr<DMASTExpression> path,
                 std::vector<std::unique_ptr<DMASTCallParameter>> parameters = {})
-        : DMASTExpression(location), Path(std::move(path)), Parameters(std::move(parameters)) {}
+        : DMASTExpression(StaticKind, location), Path(std::move(path)), Parameters(std::move(parameters)) {}
 };
 
 /// <summary>
@@ -281,6 +304,8 @@ public:
 /// </summary>
 class DMASTCall : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Call;
+    
     std::unique_ptr<DMASTExpression> Target; // What we're calling (identifier, dereference, etc.)
     std::vector<std::unique_ptr<DMASTCallParameter>> Parameters;
     
@@ -292,7 +317,7 @@ public:
     DMASTCall(const Location& location,
              std::unique_ptr<DMASTExpression> target,
              std::vector<std::unique_ptr<DMASTCallParameter>> parameters)
-        : DMASTExpression(location), Target(std::move(target)), Parameters(std::move(parameters)) {}
+        : DMASTExpression(StaticKind, location), Target(std::move(target)), Parameters(std::move(parameters)) {}
 };
 
 /// <summary>
@@ -308,6 +333,8 @@ enum class DereferenceType {
 
 class DMASTDereference : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Dereference;
+    
     std::unique_ptr<DMASTExpression> Expression;
     DereferenceType Type;
     std::unique_ptr<DMASTExpression> Property; // Could be identifier or expression
@@ -316,7 +343,7 @@ public:
                     std::unique_ptr<DMASTExpression> expr,
                     DereferenceType type,
                     std::unique_ptr<DMASTExpression> property)
-        : DMASTExpression(location), Expression(std::move(expr)), Type(type), Property(std::move(property)) {}
+        : DMASTExpression(StaticKind, location), Expression(std::move(expr)), Type(type), Property(std::move(property)) {}
 };
 
 /// <summary>
@@ -324,6 +351,8 @@ public:
 /// </summary>
 class DMASTTernary : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Ternary;
+    
     std::unique_ptr<DMASTExpression> Condition;
     std::unique_ptr<DMASTExpression> TrueExpression;
     std::unique_ptr<DMASTExpression> FalseExpression;
@@ -332,7 +361,7 @@ public:
                 std::unique_ptr<DMASTExpression> condition,
                 std::unique_ptr<DMASTExpression> trueExpr,
                 std::unique_ptr<DMASTExpression> falseExpr)
-        : DMASTExpression(location), Condition(std::move(condition)),
+        : DMASTExpression(StaticKind, location), Condition(std::move(condition)),
           TrueExpression(std::move(trueExpr)), FalseExpression(std::move(falseExpr)) {}
 };
 
@@ -359,6 +388,8 @@ enum class AssignmentOperator {
 
 class DMASTAssign : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::Assign;
+    
     std::unique_ptr<DMASTExpression> LValue;
     AssignmentOperator Operator;
     std::unique_ptr<DMASTExpression> Value;
@@ -367,7 +398,7 @@ public:
                std::unique_ptr<DMASTExpression> lvalue,
                AssignmentOperator op,
                std::unique_ptr<DMASTExpression> value)
-        : DMASTExpression(location), LValue(std::move(lvalue)), Operator(op), Value(std::move(value)) {}
+        : DMASTExpression(StaticKind, location), LValue(std::move(lvalue)), Operator(op), Value(std::move(value)) {}
 };
 
 /// <summary>
@@ -376,17 +407,15 @@ public:
 /// </summary>
 class DMASTSwitchCaseRange : public DMASTExpression {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::SwitchCaseRange;
+    
     std::unique_ptr<DMASTExpression> RangeStart;
     std::unique_ptr<DMASTExpression> RangeEnd;
     
     DMASTSwitchCaseRange(const Location& location,
                         std::unique_ptr<DMASTExpression> rangeStart,
                         std::unique_ptr<DMASTExpression> rangeEnd)
-        : DMASTExpression(location), RangeStart(std::move(rangeStart)), RangeEnd(std::move(rangeEnd)) {}
-    
-    std::vector<DMASTExpression*> GetLeaves() override {
-        return {RangeStart.get(), RangeEnd.get()};
-    }
+        : DMASTExpression(StaticKind, location), RangeStart(std::move(rangeStart)), RangeEnd(std::move(rangeEnd)) {}
 };
 
 } // namespace DMCompiler
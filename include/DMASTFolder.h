@@ -3,9 +3,13 @@
 #include "DMAST.h"
 #include <memory>
 #include <optional>
+#include <string>
 
 namespace DMCompiler {
 
+class DMASTExpressionBinary;
+class DMASTExpressionUnary;
+
 /// <summary>
 /// AST post-processor that performs constant folding and expression simplification
 /// Walks the AST tree and attempts to fold constant expressions at compile time
@@ -20,17 +24,49 @@ public:
     /// </summary>
     void FoldAst(DMASTNode* ast);
 
-private:
     /// <summary>
-    /// Folds constant expressions, returns new folded expression or original
+    /// Evaluates a binary operation whose operands are already folded, with DM
+    /// semantics (numbers are float32). Returns nullptr if it has to be left to
+    /// the runtime
     /// </summary>
-    std::unique_ptr<DMASTExpression> FoldExpression(std::unique_ptr<DMASTExpression> expression);
+    static std::unique_ptr<DMASTExpression> FoldBinary(DMASTExpressionBinary* binary);
+
+    /// <summary>
+    /// Evaluates a unary operation whose operand is already folded; nullptr if
+    /// it has to be left to the runtime
+    /// </summary>
+    static std::unique_ptr<DMASTExpression> FoldUnary(DMASTExpressionUnary* unary);
 
     /// <summary>
     /// Determines if an expression can be evaluated to a simple boolean truth value
     /// Returns true, false, or nullopt if cannot be determined at compile time
     /// </summary>
     static std::optional<bool> SimpleTruth(DMASTExpression* expr);
+
+    /// <summary>
+    /// The text a constant embedded in a string format prints as, or nullopt
+    /// if the runtime has to format it (floats, paths, resources) or the text
+    /// has brackets, which FormatString would take for an argument marker
+    /// </summary>
+    static std::optional<std::string> EmbeddedText(DMASTExpression* expr);
+
+    /// <summary>
+    /// True if embedding text between these two literal parts of a format
+    /// keeps them from joining into a "[]" marker
+    /// </summary>
+    static bool CanEmbedText(const std::string& before, const std::string& text, const std::string& after);
+
+private:
+    /// <summary>
+    /// Folds constant expressions, returns new folded expression or original
+    /// </summary>
+    std::unique_ptr<DMASTExpression> FoldExpression(std::unique_ptr<DMASTExpression> expression);
+
+    /// <summary>
+    /// Folds a binary operator whose operands are already folded, returns the
+    /// replacement or the operator itself
+    /// </summary>
+    static std::unique_ptr<DMASTExpression> FoldOperands(std::unique_ptr<DMASTExpression> expression);
 };
 
 } // namespace DMCompiler
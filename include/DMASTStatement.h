@@ -13,7 +13,7 @@ namespace DMCompiler {
 /// </summary>
 class DMASTStatement : public DMASTNode {
 public:
-    explicit DMASTStatement(const Location& location) : DMASTNode(location) {}
+    DMASTStatement(DMASTNodeKind kind, const Location& location) : DMASTNode(kind, location) {}
     virtual ~DMASTStatement() = default;
 };
 
@@ -22,7 +22,7 @@ public:
 /// </summary>
 class DMASTProcStatement : public DMASTStatement {
 public:
-    explicit DMASTProcStatement(const Location& location) : DMASTStatement(location) {}
+    DMASTProcStatement(DMASTNodeKind kind, const Location& location) : DMASTStatement(kind, location) {}
 };
 
 /// <summary>
@@ -30,7 +30,7 @@ public:
 /// </summary>
 class DMASTObjectStatement : public DMASTStatement {
 public:
-    explicit DMASTObjectStatement(const Location& location) : DMASTStatement(location) {}
+    DMASTObjectStatement(DMASTNodeKind kind, const Location& location) : DMASTStatement(kind, location) {}
 };
 
 // ============================================================================
@@ -42,10 +42,12 @@ public:
 /// </summary>
 class DMASTProcStatementExpression : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementExpression;
+    
     std::unique_ptr<DMASTExpression> Expression;
     
     DMASTProcStatementExpression(const Location& location, std::unique_ptr<DMASTExpression> expr)
-        : DMASTProcStatement(location), Expression(std::move(expr)) {}
+        : DMASTProcStatement(StaticKind, location), Expression(std::move(expr)) {}
 };
 
 /// <summary>
@@ -53,6 +55,8 @@ public:
 /// </summary>
 class DMASTProcStatementVarDeclaration : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementVarDeclaration;
+    
     struct Decl {
         std::string Name;
         std::optional<DreamPath> TypePath;
@@ -70,7 +74,7 @@ public:
     std::vector<Decl> Decls;
     
     DMASTProcStatementVarDeclaration(const Location& location, std::vector<Decl> decls)
-        : DMASTProcStatement(location), Decls(std::move(decls)) {}
+        : DMASTProcStatement(StaticKind, location), Decls(std::move(decls)) {}
 };
 
 /// <summary>
@@ -78,11 +82,13 @@ public:
 /// </summary>
 class DMASTProcStatementReturn : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementReturn;
+    
     std::unique_ptr<DMASTExpression> Value;
     
     explicit DMASTProcStatementReturn(const Location& location, 
                                      std::unique_ptr<DMASTExpression> value = nullptr)
-        : DMASTProcStatement(location), Value(std::move(value)) {}
+        : DMASTProcStatement(StaticKind, location), Value(std::move(value)) {}
 };
 
 /// <summary>
@@ -90,11 +96,13 @@ public:
 /// </summary>
 class DMASTProcStatementBreak : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementBreak;
+    
     std::unique_ptr<DMASTIdentifier> Label; // Optional label
     
     explicit DMASTProcStatementBreak(const Location& location,
                                     std::unique_ptr<DMASTIdentifier> label = nullptr)
-        : DMASTProcStatement(location), Label(std::move(label)) {}
+        : DMASTProcStatement(StaticKind, location), Label(std::move(label)) {}
 };
 
 /// <summary>
@@ -102,11 +110,13 @@ public:
 /// </summary>
 class DMASTProcStatementContinue : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementContinue;
+    
     std::unique_ptr<DMASTIdentifier> Label; // Optional label
     
     explicit DMASTProcStatementContinue(const Location& location,
                                        std::unique_ptr<DMASTIdentifier> label = nullptr)
-        : DMASTProcStatement(location), Label(std::move(label)) {}
+        : DMASTProcStatement(StaticKind, location), Label(std::move(label)) {}
 };
 
 /// <summary>
@@ -114,10 +124,12 @@ public:
 /// </summary>
 class DMASTProcStatementGoto : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementGoto;
+    
     std::unique_ptr<DMASTIdentifier> Label;
     
     DMASTProcStatementGoto(const Location& location, std::unique_ptr<DMASTIdentifier> label)
-        : DMASTProcStatement(location), Label(std::move(label)) {}
+        : DMASTProcStatement(StaticKind, location), Label(std::move(label)) {}
 };
 
 /// <summary>
@@ -125,13 +137,15 @@ public:
 /// </summary>
 class DMASTProcStatementLabel : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementLabel;
+    
     std::string Name;
     std::unique_ptr<DMASTProcStatement> Body;
     
     DMASTProcStatementLabel(const Location& location, 
                            const std::string& name,
                            std::unique_ptr<DMASTProcStatement> body = nullptr)
-        : DMASTProcStatement(location), Name(name), Body(std::move(body)) {}
+        : DMASTProcStatement(StaticKind, location), Name(name), Body(std::move(body)) {}
 };
 
 /// <summary>
@@ -139,10 +153,12 @@ public:
 /// </summary>
 class DMASTProcStatementDel : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementDel;
+    
     std::unique_ptr<DMASTExpression> Value;
     
     DMASTProcStatementDel(const Location& location, std::unique_ptr<DMASTExpression> value)
-        : DMASTProcStatement(location), Value(std::move(value)) {}
+        : DMASTProcStatement(StaticKind, location), Value(std::move(value)) {}
 };
 
 /// <summary>
@@ -150,13 +166,15 @@ public:
 /// </summary>
 class DMASTProcStatementSpawn : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementSpawn;
+    
     std::unique_ptr<DMASTExpression> Delay; // nullptr means spawn(0)
     std::unique_ptr<DMASTProcBlockInner> Body;
     
     DMASTProcStatementSpawn(const Location& location,
                            std::unique_ptr<DMASTExpression> delay,
                            std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Delay(std::move(delay)), Body(std::move(body)) {}
+        : DMASTProcStatement(StaticKind, location), Delay(std::move(delay)), Body(std::move(body)) {}
 };
 
 /// <summary>
@@ -164,6 +182,8 @@ public:
 /// </summary>
 class DMASTProcStatementIf : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementIf;
+    
     std::unique_ptr<DMASTExpression> Condition;
     std::unique_ptr<DMASTProcBlockInner> Body;
     std::unique_ptr<DMASTProcBlockInner> ElseBody; // nullptr if no else
@@ -172,7 +192,7 @@ public:
                         std::unique_ptr<DMASTExpression> condition,
                         std::unique_ptr<DMASTProcBlockInner> body,
                         std::unique_ptr<DMASTProcBlockInner> elseBody = nullptr)
-        : DMASTProcStatement(location), Condition(std::move(condition)), 
+        : DMASTProcStatement(StaticKind, location), Condition(std::move(condition)), 
           Body(std::move(body)), ElseBody(std::move(elseBody)) {}
 };
 
@@ -181,6 +201,8 @@ public:
 /// </summary>
 class DMASTProcStatementFor : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementFor;
+    
     std::unique_ptr<DMASTProcStatement> Initializer; // var x = 0 or x = 0
     std::unique_ptr<DMASTExpression> Condition;
     std::unique_ptr<DMASTExpression> Increment;
@@ -191,7 +213,7 @@ public:
                          std::unique_ptr<DMASTExpression> condition,
                          std::unique_ptr<DMASTExpression> increment,
                          std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Initializer(std::move(initializer)),
+        : DMASTProcStatement(StaticKind, location), Initializer(std::move(initializer)),
           Condition(std::move(condition)), Increment(std::move(increment)), Body(std::move(body)) {}
 };
 
@@ -200,6 +222,8 @@ public:
 /// </summary>
 class DMASTProcStatementForIn : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementForIn;
+    
     /// <summary>
     /// Enhanced variable declaration information for for-in loops
     /// Captures variable name, type path, and type filter from declarations like:
@@ -232,7 +256,7 @@ public:
                            std::unique_ptr<DMASTExpression> variable,
                            std::unique_ptr<DMASTExpression> list,
                            std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Variable(std::move(variable)), 
+        : DMASTProcStatement(StaticKind, location), Variable(std::move(variable)), 
           VarDecl(), List(std::move(list)), Body(std::move(body)) {}
     
     DMASTProcStatementForIn(const Location& location,
@@ -240,7 +264,7 @@ public:
                            const VariableDeclaration& varDecl,
                            std::unique_ptr<DMASTExpression> list,
                            std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Variable(std::move(variable)), 
+        : DMASTProcStatement(StaticKind, location), Variable(std::move(variable)), 
           VarDecl(varDecl), List(std::move(list)), Body(std::move(body)) {}
 };
 
@@ -249,6 +273,8 @@ public:
 /// </summary>
 class DMASTProcStatementForRange : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementForRange;
+    
     std::unique_ptr<DMASTExpression> Initializer;  // The initializer expression (var/x = start)
     std::unique_ptr<DMASTExpression> End;          // Ending value
     std::unique_ptr<DMASTExpression> Step;         // Optional step value (nullptr means step of 1)
@@ -259,7 +285,7 @@ public:
                               std::unique_ptr<DMASTExpression> end,
                               std::unique_ptr<DMASTExpression> step,
                               std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Initializer(std::move(initializer)),
+        : DMASTProcStatement(StaticKind, location), Initializer(std::move(initializer)),
           End(std::move(end)), Step(std::move(step)), Body(std::move(body)) {}
 };
 
@@ -268,13 +294,15 @@ public:
 /// </summary>
 class DMASTProcStatementWhile : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementWhile;
+    
     std::unique_ptr<DMASTExpression> Condition;
     std::unique_ptr<DMASTProcBlockInner> Body;
     
     DMASTProcStatementWhile(const Location& location,
                            std::unique_ptr<DMASTExpression> condition,
                            std::unique_ptr<DMASTProcBlockInner> body)
-        : DMASTProcStatement(location), Condition(std::move(condition)), Body(std::move(body)) {}
+        : DMASTProcStatement(StaticKind, location), Condition(std::move(condition)), Body(std::move(body)) {}
 };
 
 /// <summary>
@@ -282,13 +310,15 @@ public:
 /// </summary>
 class DMASTProcStatementDoWhile : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementDoWhile;
+    
     std::unique_ptr<DMASTProcBlockInner> Body;
     std::unique_ptr<DMASTExpression> Condition;
     
     DMASTProcStatementDoWhile(const Location& location,
                              std::unique_ptr<DMASTProcBlockInner> body,
                              std::unique_ptr<DMASTExpression> condition)
-        : DMASTProcStatement(location), Body(std::move(body)), Condition(std::move(condition)) {}
+        : DMASTProcStatement(StaticKind, location), Body(std::move(body)), Condition(std::move(condition)) {}
 };
 
 /// <summary>
@@ -296,6 +326,8 @@ public:
 /// </summary>
 class DMASTProcStatementSwitch : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementSwitch;
+    
     struct SwitchCase {
         std::vector<std::unique_ptr<DMASTExpression>> Values; // Multiple values per case
         std::unique_ptr<DMASTProcBlockInner> Body;
@@ -307,7 +339,7 @@ public:
     DMASTProcStatementSwitch(const Location& location,
                             std::unique_ptr<DMASTExpression> value,
                             std::vector<SwitchCase> cases)
-        : DMASTProcStatement(location), Value(std::move(value)), Cases(std::move(cases)) {}
+        : DMASTProcStatement(StaticKind, location), Value(std::move(value)), Cases(std::move(cases)) {}
 };
 
 /// <summary>
@@ -315,6 +347,8 @@ public:
 /// </summary>
 class DMASTProcStatementTryCatch : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementTryCatch;
+    
     std::unique_ptr<DMASTProcBlockInner> TryBody;
     std::unique_ptr<DMASTIdentifier> CatchVariable; // Optional catch(e)
     std::unique_ptr<DMASTProcBlockInner> CatchBody;
@@ -323,7 +357,7 @@ public:
                               std::unique_ptr<DMASTProcBlockInner> tryBody,
                               std::unique_ptr<DMASTIdentifier> catchVariable,
                               std::unique_ptr<DMASTProcBlockInner> catchBody)
-        : DMASTProcStatement(location), TryBody(std::move(tryBody)),
+        : DMASTProcStatement(StaticKind, location), TryBody(std::move(tryBody)),
           CatchVariable(std::move(catchVariable)), CatchBody(std::move(catchBody)) {}
 };
 
@@ -332,10 +366,12 @@ public:
 /// </summary>
 class DMASTProcStatementThrow : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementThrow;
+    
     std::unique_ptr<DMASTExpression> Value;
     
     DMASTProcStatementThrow(const Location& location, std::unique_ptr<DMASTExpression> value)
-        : DMASTProcStatement(location), Value(std::move(value)) {}
+        : DMASTProcStatement(StaticKind, location), Value(std::move(value)) {}
 };
 
 /// <summary>
@@ -343,13 +379,15 @@ public:
 /// </summary>
 class DMASTProcStatementSet : public DMASTProcStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ProcStatementSet;
+    
     std::string Attribute;
     std::unique_ptr<DMASTExpression> Value;
     
     DMASTProcStatementSet(const Location& location,
                          const std::string& attribute,
                          std::unique_ptr<DMASTExpression> value)
-        : DMASTProcStatement(location), Attribute(attribute), Value(std::move(value)) {}
+        : DMASTProcStatement(StaticKind, location), Attribute(attribute), Value(std::move(value)) {}
 };
 
 // ============================================================================
@@ -361,6 +399,8 @@ public:
 /// </summary>
 class DMASTObjectVarDefinition : public DMASTObjectStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ObjectVarDefinition;
+    
     std::string Name;
     DMASTPath TypePath;
     std::unique_ptr<DMASTExpression> Value;
@@ -371,7 +411,7 @@ public:
                             const DMASTPath& typePath,
                             std::unique_ptr<DMASTExpression> value = nullptr,
                             std::optional<DMComplexValueType> explicitValueType = std::nullopt)
-        : DMASTObjectStatement(location), Name(name), TypePath(typePath), Value(std::move(value)),
+        : DMASTObjectStatement(StaticKind, location), Name(name), TypePath(typePath), Value(std::move(value)),
           ExplicitValueType(explicitValueType) {}
 };
 
@@ -380,13 +420,15 @@ public:
 /// </summary>
 class DMASTObjectVarOverride : public DMASTObjectStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ObjectVarOverride;
+    
     std::string VarName;
     std::unique_ptr<DMASTExpression> Value;
     
     DMASTObjectVarOverride(const Location& location,
                           const std::string& varName,
                           std::unique_ptr<DMASTExpression> value)
-        : DMASTObjectStatement(location), VarName(varName), Value(std::move(value)) {}
+        : DMASTObjectStatement(StaticKind, location), VarName(varName), Value(std::move(value)) {}
 };
 
 /// <summary>
@@ -394,11 +436,23 @@ public:
 /// </summary>
 class DMASTObjectProcDefinition : public DMASTObjectStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ObjectProcDefinition;
+    
+    /// Token range of a body the parser skipped (see DMParser::SetDeferProcBodies)
+    struct DeferredBodyRange {
+        size_t Begin = 0;    // Index of the body's first token in the parsed TokenBuffer
+        size_t End = 0;      // Index past its last token
+        int BaseIndent = 0;  // Column the body's lines must be indented past
+    };
+    
     DreamPath ObjectPath; // Path to the object this proc belongs to (e.g., /mob for /mob/proc/test)
     std::string Name;
     std::vector<std::unique_ptr<DMASTDefinitionParameter>> Parameters;
-    std::unique_ptr<DMASTProcBlockInner> Body;
+    std::unique_ptr<DMASTProcBlockInner> Body;  // Null while the body is deferred
     bool IsVerb; // true = verb, false = proc
+    DeferredBodyRange DeferredBody;
+    
+    bool HasDeferredBody() const { return DeferredBody.End > DeferredBody.Begin; }
     
     DMASTObjectProcDefinition(const Location& location,
                              const DreamPath& objectPath,
@@ -406,7 +460,7 @@ public:
                              std::vector<std::unique_ptr<DMASTDefinitionParameter>> parameters,
                              std::unique_ptr<DMASTProcBlockInner> body,
                              bool isVerb = false)
-        : DMASTObjectStatement(location), ObjectPath(objectPath), Name(name), Parameters(std::move(parameters)),
+        : DMASTObjectStatement(StaticKind, location), ObjectPath(objectPath), Name(name), Parameters(std::move(parameters)),
           Body(std::move(body)), IsVerb(isVerb) {}
 };
 
@@ -415,13 +469,15 @@ public:
 /// </summary>
 class DMASTObjectDefinition : public DMASTObjectStatement {
 public:
+    static constexpr DMASTNodeKind StaticKind = DMASTNodeKind::ObjectDefinition;
+    
     DMASTPath Path;
     std::vector<std::unique_ptr<DMASTObjectStatement>> InnerStatements;
     
     DMASTObjectDefinition(const Location& location,
                          const DMASTPath& path,
                          std::vector<std::unique_ptr<DMASTObjectStatement>> innerStatements)
-        : DMASTObjectStatement(location), Path(path), InnerStatements(std::move(innerStatements)) {}
+        : DMASTObjectStatement(StaticKind, location), Path(path), InnerStatements(std::move(innerStatements)) {}
 };
 
 } // namespace DMCompiler
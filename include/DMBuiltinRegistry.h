@@ -4,8 +4,6 @@
 #include "DMValueType.h"
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
 #include <optional>
 
 namespace DMCompiler {
@@ -29,6 +27,11 @@ struct ProcSignature {
 /// Singleton registry of built-in DM procs and variables.
 /// This allows the compiler to recognize built-in functions and variables
 /// without requiring DMStandard to be compiled.
+///
+/// The built-ins are constexpr tables in DMBuiltinRegistry.cpp, each with a
+/// perfect hash (PerfectHash.h) built by the compiler, so nothing is set up
+/// at startup and a lookup is a hash, two loads and one compare per type up
+/// the built-in hierarchy.
 /// </summary>
 class DMBuiltinRegistry {
 public:
@@ -88,48 +91,12 @@ public:
     bool TypeInheritsFrom(const DreamPath& derived, const DreamPath& base) const;
 
 private:
-    DMBuiltinRegistry();
+    DMBuiltinRegistry() = default;
     ~DMBuiltinRegistry() = default;
     
     // Non-copyable
     DMBuiltinRegistry(const DMBuiltinRegistry&) = delete;
     DMBuiltinRegistry& operator=(const DMBuiltinRegistry&) = delete;
-    
-    /// Initialize all built-in registrations
-    void InitializeBuiltins();
-    
-    /// Register global procs
-    void RegisterGlobalProcs();
-    
-    /// Register type-specific procs
-    void RegisterTypeProcs();
-    
-    /// Register built-in variables
-    void RegisterBuiltinVars();
-    
-    /// Helper to register procs for a type and all its subtypes
-    void RegisterProcForType(const std::string& typePath, const ProcSignature& sig);
-    
-    /// Helper to register a variable for a type and all its subtypes
-    void RegisterVarForType(const std::string& typePath, const std::string& name, DMValueType type);
-    
-    // Global procs (not on any type)
-    std::unordered_map<std::string, ProcSignature> GlobalProcs_;
-    
-    // Type-specific procs: type path -> proc name -> signature
-    std::unordered_map<std::string, std::unordered_map<std::string, ProcSignature>> TypeProcs_;
-    
-    // Type-specific variables: type path -> var name -> value type
-    std::unordered_map<std::string, std::unordered_map<std::string, DMValueType>> TypeVars_;
-    
-    // Context variables always available
-    std::unordered_set<std::string> ContextVars_;
-    
-    // Built-in type paths
-    std::unordered_set<std::string> BuiltinTypes_;
-    
-    // Type hierarchy for inheritance checking: type -> parent type
-    std::unordered_map<std::string, std::string> TypeHierarchy_;
 };
 
 } // namespace DMCompiler
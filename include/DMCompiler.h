@@ -3,17 +3,24 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 #include <set>
 #include <chrono>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <thread>
 #include "Location.h"
 #include "Token.h"
+#include "TokenBuffer.h"
 #include "DreamPath.h"
 
 namespace DMCompiler {
 
 // Forward declarations
 class DMObjectTree;
+class JsonConstants;
 class DMCodeTree;
 class DMProc;
 class DMObject;
@@ -23,14 +30,31 @@ class DMASTObjectDefinition;
 class DMASTObjectVarDefinition;
 class DMASTObjectVarOverride;
 class DMASTObjectProcDefinition;
+class DMASTProcBlockInner;
 class DMASTExpression;
+class PreprocessorPipeline;
+class DMPreprocessor;
+struct DMStandardSnapshot;
+class TokenCache;
+class ResourceHashIndex;
+class ProcCache;
+class ProcProfile;
+class CallGraph;
+struct DependencyGraph;
+struct PreprocessorStats;
+class CompileTimings;
+class CompileCosts;
 struct DreamMapJson;
+class JsonWriter;
+class CompiledOutputWriter;
+class DMVariableStore;
 
 /// <summary>
 /// Compiler settings
 /// </summary>
 struct DMCompilerSettings {
     std::vector<std::string> Files;
+    std::string OutputPath;  // Where to write [name].json and the files named after it (empty = next to the first file)
     std::unordered_map<std::string, std::string> MacroDefines;
     std::vector<std::string> LibraryPaths;  // Paths to search for external libraries (e.g., BYOND lib folder)
     bool SuppressUnimplementedWarnings = false;
@@ -41,6 +65,54 @@ struct DMCompilerSettings {
     bool Verbose = false;
     bool NoticesEnabled = false;
     bool NoOpts = false;
+    bool CheckOnly = false;  // Report diagnostics without optimizing procs or writing any output
+    bool FusedOpcodes = false;  // Emit the runtime's superinstructions for common opcode pairs
+    bool VerifyStack = false;   // Warn where the stack depth analysis and the ResizeStack() counts disagree
+    bool Verify = false;        // Check every proc's bytecode with BytecodeVerifier before writing the output
+    bool CompactOperands = false;  // Write ID and count operands as LEB128 (OperandEncoding::Leb128)
+    bool BinaryOutput = false;  // Also write the output in the CompiledOutput format, as [name].dmbc
+    bool LocalityLayout = false;  // Order the binary output's code by type and call graph rather than by proc ID
+    bool IncrementalOutput = false;  // Patch only the changed blocks of an existing [name].dmbc
+    bool CompressOutput = false;  // Write each output file compressed (OutputCompression), with .dmz appended
+    bool ResourceManifest = false;  // Also write [name].resources.json, listing each resource's file, size and content hash
+    bool StreamTokens = false;  // Parse while preprocessing instead of buffering every token
+    unsigned LexThreads = 0;    // Threads for lexing files ahead of preprocessing (0 = inline)
+    unsigned ParseThreads = 0;  // Threads for parsing top-level definitions of the buffered stream and scanning maps (0 = sequential; DMStandard parses while user files preprocess)
+    unsigned CompileThreads = 0;  // Threads for compiling procs (0 = sequential)
+    unsigned OutputThreads = 0;  // Threads for writing types and procs to the JSON output and compressing it (0 = sequential)
+    bool LazyProcBodies = false;  // Skip proc bodies while parsing and parse each one when its proc is compiled
+    std::string TokenCacheDir;  // Directory for the on-disk lexer token cache (empty = disabled)
+    std::string ASTCacheDir;    // Directory for the on-disk cache of parsed definitions (empty = disabled)
+    std::string MapCacheDir;    // Directory for the on-disk cache of converted maps (empty = disabled)
+    std::string StandardSnapshotPath;  // Precompiled DMStandard snapshot file (empty = disabled)
+    std::string ProcCacheDir;   // Directory for the on-disk cache of compiled procs (empty = disabled)
+    std::string ProfileDataPath;  // Runtime proc profile that sorts procs into hot and cold (ProcProfile; empty = disabled)
+    bool DependencyGraph = false;  // Also write [name].deps.json, listing what each file includes, defines, uses and declares
+    bool PreprocStats = false;  // Report per-file, per-macro and #if skipping statistics after preprocessing
+    bool MapStats = false;  // Report each map's tile, object and type counts, also written to [name].mapstats.json
+    std::string Timings;  // "json" or "trace": write each phase's time, memory and allocations to [name].timings.json or [name].trace.json (empty = disabled)
+    unsigned CompileCostsTop = 0;  // Print the N files slowest to preprocess and parse and the N procs slowest to compile (0 = disabled)
+    bool MemoryReport = false;  // Print each phase's memory high-water mark
+    unsigned MaxMemoryMB = 0;  // With MemoryReport, fail a compile whose peak exceeds this (0 = no limit)
+    bool StripUnused = false;  // Drop procs nothing reaches from the engine's entry points, listed in [name].stripped.json
+    std::string EmitPreprocessedPath;  // Write the preprocessed token stream to this file (empty = disabled)
+    std::string LoadPreprocessedPath;  // Parse this preprocessed token stream instead of preprocessing (empty = disabled)
+};
+
+/// <summary>
+/// What a resident compiler (dmcompiler --server) keeps from one compile to
+/// the next, or a batch (dmcompiler --batch) shares between its targets.
+/// Each compile still gets a fresh DMCompiler; this is handed to it with
+/// SetWarmState(). Compiles may share it concurrently: the token cache and
+/// resource index lock themselves, and Standard is only read or replaced
+/// under StandardMutex.
+/// </summary>
+struct DMCompilerWarmState {
+    std::shared_ptr<TokenCache> Tokens;  // Used in place of a new cache when its directory is TokenCacheDir
+    std::shared_ptr<ResourceHashIndex> Resources;  // Resource hashes for --resource-manifest, reused while the files are unchanged
+    std::mutex StandardMutex;  // Held while Standard is looked up or rebuilt, so concurrent compiles build it once
+    std::shared_ptr<const DMStandardSnapshot> Standard;  // Last good DMStandard snapshot, reused while its sources are unchanged
+    std::string StandardDir;  // Directory Standard was built from
 };
 
 /// <summary>
@@ -82,6 +154,50 @@ enum class ErrorLevel {
     Error
 };
 
+/// <summary>
+/// Diagnostics held back on the thread that reported them, to be reported
+/// later with DMCompiler::Report() in the order a sequential build gives.
+///
+/// While a thread holds a Capture, Emit(), ForcedWarning() and ForcedError()
+/// only add to the buffer, touching nothing another thread can see. Levels,
+/// pragmas, duplicate suppression and the error limit are applied when the
+/// buffer is reported, so they come out as if reported at that point.
+/// </summary>
+class DiagnosticBuffer {
+public:
+    struct Entry {
+        enum class Kind : uint8_t { Emitted, ForcedWarning, ForcedError };
+
+        Kind EntryKind;
+        WarningCode Code;  // Unknown for forced diagnostics
+        Location Loc;
+        std::string Message;
+        std::string Context;
+    };
+
+    /// Sends what this thread reports to a buffer while it lives
+    class Capture {
+    public:
+        explicit Capture(DiagnosticBuffer& buffer);
+        ~Capture();
+        Capture(const Capture&) = delete;
+        Capture& operator=(const Capture&) = delete;
+
+    private:
+        DiagnosticBuffer* Outer_;
+    };
+
+    /// Buffer this thread reports to, or nullptr if it reports directly
+    static DiagnosticBuffer* Current();
+
+    void Add(Entry entry) { Entries_.push_back(std::move(entry)); }
+    const std::vector<Entry>& GetEntries() const { return Entries_; }
+    bool Empty() const { return Entries_.empty(); }
+
+private:
+    std::vector<Entry> Entries_;
+};
+
 /// <summary>
 /// Main DM Compiler class
 /// </summary>
@@ -93,10 +209,15 @@ public:
     // Main compilation entry point
     bool Compile(const DMCompilerSettings& settings);
 
+    /// Reuse and update state kept from earlier compiles (call before Compile)
+    void SetWarmState(std::shared_ptr<DMCompilerWarmState> state) { WarmState_ = std::move(state); }
+
     // Error/warning reporting
     void Emit(WarningCode code, const Location& location, const std::string& message, const std::string& context = "");
     void ForcedWarning(const std::string& message);
     void ForcedError(const Location& location, const std::string& message);
+    /// Report buffered diagnostics, in their order, with one write to std::cerr
+    void Report(const DiagnosticBuffer& buffer);
     void SetPragma(WarningCode code, ErrorLevel level);
     
     // Error limits
@@ -115,18 +236,46 @@ public:
     /// Get the ID for a resource path (returns -1 if not found or map not built)
     int GetResourceId(const std::string& path) const;
     
+    // Proc bodies skipped by the parser (--lazy-proc-bodies)
+    
+    /// Parse and fold a deferred proc body into procDef->Body (no-op if it has none)
+    void ParseDeferredProcBody(DMASTObjectProcDefinition* procDef);
+    
+    /// Parse every deferred proc body on ParseThreads threads ahead of compiling
+    /// them. Bodies with syntax errors are left for ParseDeferredProcBody(), so
+    /// their diagnostics are reported in order
+    void ParseDeferredProcBodies();
+    
     // Accessors
     DMObjectTree* GetObjectTree() { return ObjectTree_.get(); }
     DMCodeTree* GetCodeTree() { return CodeTree_.get(); }
+    JsonConstants& GetJsonConstants() { return *JsonConstants_; }  // This compile's var and global default constants
     const DMCompilerSettings& GetSettings() const { return Settings_; }
+    CompileTimings* GetTimings() { return Timings_.get(); }  // nullptr unless Timings or MemoryReport is set
+    CompileCosts* GetCosts() { return Costs_.get(); }  // nullptr unless CompileCostsTop is set
+    ProcCache* GetProcCache() { return ProcCache_.get(); }  // nullptr unless ProcCacheDir is set and OpenProcCache() found the tree hashable
+    DependencyGraph* GetDependencyGraph() { return Dependencies_.get(); }  // nullptr unless DependencyGraph is set
+    
+    /// Open the proc cache for the frozen type tree, before procs are compiled
+    /// (no-op unless ProcCacheDir is set)
+    void OpenProcCache();
+    
+    /// Sort procs into hot and cold by the runtime profile, before procs are
+    /// compiled (no-op unless ProfileDataPath is set)
+    void ApplyProcProfile();
     
     const std::set<std::string>& GetResourceDirectories() const { return ResourceDirectories_; }
     const std::vector<std::string>& GetCompilerMessages() const { return CompilerMessages_; }
+    int GetErrorCount() const { return ErrorCount_; }
+    int GetWarningCount() const { return WarningCount_; }
+    /// What the outputs are named after: OutputPath, or else the first input file
+    const std::string& GetOutputPath() const { return Settings_.OutputPath.empty() ? Settings_.Files[0] : Settings_.OutputPath; }
 
 private:
     DMCompilerSettings Settings_;
     std::unique_ptr<DMObjectTree> ObjectTree_;
     std::unique_ptr<DMCodeTree> CodeTree_;
+    std::unique_ptr<JsonConstants> JsonConstants_;
     std::unique_ptr<DMProc> GlobalInitProc_;
     
     std::set<std::string> ResourceDirectories_;
@@ -135,12 +284,20 @@ private:
     
     /// Resource path to ID mapping (built during JSON output)
     std::unordered_map<std::string, int> ResourceIdMap_;
+    /// Resource paths in ID order, as the outputs list them (built with ResourceIdMap_)
+    std::vector<std::string> SortedResources_;
     
     std::set<WarningCode> UniqueEmissions_;
-    int ErrorCount_;
-    int WarningCount_;
+    std::atomic<int> ErrorCount_;  // Atomic so counts and ShouldAbort() are read without the lock
+    std::atomic<int> WarningCount_;
     int MaxErrors_ = 100; // Default limit
-    bool Aborted_ = false;
+    std::atomic<bool> Aborted_{false};
+    
+    /// Guards diagnostics and pragma state; the streaming preprocessor reports from its own thread
+    mutable std::mutex DiagnosticsMutex_;
+    
+    /// Count a diagnostic and append its text to output, under DiagnosticsMutex_
+    void RecordLocked(const DiagnosticBuffer::Entry& entry, std::string& output);
     
     std::string CodeDirectory_;
     
@@ -148,15 +305,61 @@ private:
     std::vector<std::string> IncludedMaps_;
     std::string IncludedInterface_;
     
-    // Parsed maps
-    std::vector<std::unique_ptr<DreamMapJson>> ParsedMaps_;
+    // DMStandard constants, read by InitializeDMStandard or loaded with preprocessed output
+    std::vector<std::pair<std::string, int>> StandardConstants_;
     
     // Internal compilation phases
     bool PreprocessFiles();
+    // Load the DMStandard snapshot, or preprocess _Standard.dm and write a fresh one
+    bool LoadStandardSnapshot(DMPreprocessor& preprocessor, const std::string& standardDir,
+                              const std::string& standardFile);
     bool ParseFiles();
+    // Parse the buffered stream, reusing cached fragments of unchanged segments
+    // (null if a re-parsed segment has syntax errors, so the caller parses normally)
+    std::unique_ptr<DMASTFile> ParseWithASTCache();
+    // Parse DMStandard's tokens on a thread of their own while user files are
+    // preprocessed (no-op unless ParseThreads > 1 and the whole stream is buffered)
+    void StartStandardParse(std::shared_ptr<const std::vector<Token>> tokens);
+    // Parse the user code after DMStandard and merge it with StartStandardParse()'s result
+    // (null if DMStandard has syntax errors or does not end where a definition can start)
+    std::unique_ptr<DMASTFile> ParseAfterStandard();
+    bool FinishPipeline();  // Join the streaming preprocessor and collect its results
+    // Binary preprocessed output (--emit-preprocessed / --load-preprocessed)
+    bool LoadPreprocessedOutput();
+    bool SavePreprocessedOutput();
     bool BuildObjectTree();
+    // Parse a deferred body's token range (null if suppressed diagnostics were hit)
+    std::unique_ptr<DMASTProcBlockInner> ParseProcBodyRange(const DMASTObjectProcDefinition& procDef, bool suppressDiagnostics);
     bool EmitBytecode();
+    // Run BytecodeVerifier over every proc (--verify), reporting what it finds in proc order
+    bool VerifyBytecode();
+    // What each phase leaves behind and no later phase reads: the preprocessed
+    // tokens once parsed (or with lazy bodies, once every body is compiled)
+    // and every proc's body once the procs are compiled
+    void ReleaseTokens();
+    void ReleaseProcBodies();
+    // Print each phase's high-water mark and fail a peak over MaxMemoryMB, if set
+    bool CheckMemoryBudget();
     bool OutputJson(const std::string& outputPath);
+    // One element of the output's "Types" and "Procs"; safe to call on several threads at once
+    void WriteTypeJson(JsonWriter& json, const DMObject& obj, const DMVariableStore& variableStore);
+    void WriteProcJson(JsonWriter& json, const DMProc& proc);
+    // One element of the output's "Maps"
+    void WriteMapJson(JsonWriter& json, const DreamMapJson& map);
+    // The same output as CompiledOutput, written to [name].dmbc; writer already holds the maps
+    bool OutputBinary(const std::string& outputPath, const DMVariableStore& variableStore, CompiledOutputWriter& writer);
+    // [name].resources.json (ResourceManifest), hashing on OutputThreads threads
+    bool OutputResourceManifest(const std::string& outputPath);
+    // Drop the procs the call graph does not reach (--strip-unused) and list them in [name].stripped.json
+    bool StripUnusedProcs(const std::unordered_set<int>& mappedTypes, const std::string& outputPath);
+    // The call graph of every proc in the tree, marking the procs isRoot picks
+    CallGraph BuildCallGraph(const std::function<bool(const DMProc&)>& isRoot) const;
+    // Proc IDs in the order LocalityLayout stores their code: by type, each caller followed by its callees
+    std::vector<int> LocalityCodeOrder() const;
+    // Write contents compressed, as [outputPath].dmz
+    bool WriteCompressedOutput(const std::string& outputPath, const std::string& contents);
+    // DMValueType flags of a proc argument, from its "as" type or its type path
+    uint32_t ParameterTypeFlags(const DMProc& proc, const std::string& paramName);
     
     // Progress tracking
     std::chrono::steady_clock::time_point StartTime_;
@@ -165,8 +368,11 @@ private:
     // DMStandard initialization
     bool InitializeDMStandard();
     
-    // Map conversion
-    std::vector<std::unique_ptr<struct DreamMapJson>> ConvertMaps(const std::vector<std::string>& mapPaths, int& zOffset);
+    // Map conversion (scanned on ParseThreads threads, offset in include order).
+    // Each map is passed to consume, with its path, in include order and freed
+    // after it. Returns how many were converted.
+    size_t ConvertMaps(const std::vector<std::string>& mapPaths, int& zOffset,
+                       const std::function<void(const std::string&, const DreamMapJson&)>& consume);
     
     // Helper methods for BuildObjectTree
     bool ProcessObjectStatement(DMASTStatement* statement, const DreamPath& currentPath);
@@ -186,8 +392,22 @@ private:
     bool UpdateVariableDefault(DMObject* obj, const std::string& varName, 
                                DMASTExpression* newValue, const Location& location);
     
-    std::vector<Token> PreprocessedTokens_;
+    TokenBuffer PreprocessedTokens_;
+    std::unique_ptr<PreprocessorPipeline> Pipeline_;  // Set when StreamTokens is enabled
+    std::shared_ptr<const DMStandardSnapshot> StandardSnapshot_;  // Set when StandardSnapshotPath is used
+    std::shared_ptr<DMCompilerWarmState> WarmState_;  // Set by a resident compiler
+    std::shared_ptr<PreprocessorStats> PreprocessorStats_;  // Set when PreprocStats is enabled
+    std::unique_ptr<CompileTimings> Timings_;  // Set when Timings is enabled
+    std::shared_ptr<CompileCosts> Costs_;  // Set when CompileCostsTop is enabled
+    std::unique_ptr<ProcCache> ProcCache_;  // Set by OpenProcCache() when ProcCacheDir is used
+    std::unique_ptr<ProcProfile> Profile_;  // Set by ApplyProcProfile() when ProfileDataPath is used
+    std::shared_ptr<DependencyGraph> Dependencies_;  // Set when DependencyGraph is enabled
     std::unique_ptr<DMASTFile> ParsedAST_;  // Parsed Abstract Syntax Tree
+    std::thread StandardParser_;  // Set by StartStandardParse(), joined by ParseAfterStandard()
+    TokenBuffer StandardTokens_;  // DMStandard's tokens on their own, for StandardParser_
+    std::unique_ptr<DMASTFile> StandardAST_;  // StandardParser_'s result, null if it reported a diagnostic
+    size_t ReleasedTokens_ = 0;      // Tokens ReleaseTokens() dropped
+    size_t ReleasedProcBodies_ = 0;  // Proc bodies ReleaseProcBodies() dropped
 };
 
 } // namespace DMCompiler
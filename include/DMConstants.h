@@ -19,4 +19,18 @@ namespace Limits {
     constexpr int MAX_IDENTIFIER_LENGTH = 1000;
 }
 
+namespace Versions {
+    /// Version of DMLexer's token output; bump whenever lexing rules change so
+    /// on-disk token caches written by older builds are ignored
+    constexpr int LEXER_VERSION = 1;
+
+    /// Version of DMParser's AST output; bump whenever parsing rules or AST
+    /// node fields change so on-disk AST caches written by older builds are ignored
+    constexpr int PARSER_VERSION = 1;
+
+    /// Version of the bytecode procs compile to; bump whenever proc compilation
+    /// or optimization changes so on-disk proc caches written by older builds are ignored
+    constexpr int BYTECODE_VERSION = 2;
+}
+
 } // namespace DMCompiler
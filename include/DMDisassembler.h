@@ -1,13 +1,20 @@
 #pragma once
 
+#include "CallGraph.h"
+#include "OperandEncoding.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
+#include <utility>
 #include <iostream>
+#include <memory>
 
 namespace DMCompiler {
 
+class SourceBuffer;
+
 /// Loaded type information for disassembly
 struct DisasmType {
     int Id;                                 ///< Type ID in the compiled output
@@ -27,9 +34,10 @@ struct DisasmProc {
     int OwnerTypeId;                        ///< Owner type ID
     std::vector<std::string> Parameters;    ///< Parameter names
     std::vector<uint8_t> Bytecode;          ///< Compiled bytecode
+    int MaxStackSize;                       ///< Deepest the stack gets, as the compiler worked it out
     bool IsVerb;                            ///< Whether this is a verb
     
-    DisasmProc() : Id(-1), OwnerTypeId(-1), IsVerb(false) {}
+    DisasmProc() : Id(-1), OwnerTypeId(-1), MaxStackSize(0), IsVerb(false) {}
 };
 
 /// Main disassembler class for inspecting compiled DM JSON output
@@ -43,17 +51,40 @@ public:
     /// @return true on success, false on parse error
     bool LoadJson(const std::string& jsonPath);
     
+    /// Load a compiled file in the binary CompiledOutput format (--binary-output)
+    /// @param binaryPath Path to the .dmbc file
+    /// @return true on success, false if the file is missing or malformed
+    bool LoadBinary(const std::string& binaryPath);
+    
+    /// Load either form, told apart by the binary format's magic, and
+    /// decompress it first if it was written with --compress-output
+    /// @param path Path to the .json, .dmbc or .dmz file
+    bool Load(const std::string& path);
+    
     /// Check if data has been loaded
     bool IsLoaded() const { return loaded_; }
     
     /// Get the loaded file path
     const std::string& GetFilePath() const { return filePath_; }
     
-    /// Search for types/procs by name (partial match)
+    /// How the loaded file's operands are laid out (Metadata.OperandEncoding)
+    OperandEncoding GetOperandEncoding() const { return operandEncoding_; }
+    
+    /// Search for types/procs by name (partial match, ignoring case)
     /// @param query Search string
-    /// @return List of matching type/proc paths
+    /// @return List of matching type/proc paths, types first
     std::vector<std::string> Search(const std::string& query) const;
     
+    /// Search the string table (partial match, ignoring case)
+    /// @param query Search string
+    /// @return Indices of matching strings, in table order
+    std::vector<size_t> SearchStrings(const std::string& query) const;
+    
+    /// Find the procs using a string: pushing it, or naming a field or proc with it
+    /// @param index String table index
+    /// @return Procs in ID order
+    std::vector<const DisasmProc*> GetProcsReferencingString(size_t index) const;
+    
     /// Get type by path
     /// @param path Full type path (e.g., "/mob/player")
     /// @return Pointer to type, or nullptr if not found
@@ -64,7 +95,7 @@ public:
     /// @return Pointer to type, or nullptr if not found
     const DisasmType* GetTypeById(int typeId) const;
     
-    /// Get proc by ID
+    /// Get proc by ID, reading its bytecode on first use
     /// @param procId Proc ID
     /// @return Pointer to proc, or nullptr if not found
     const DisasmProc* GetProc(int procId) const;
@@ -81,11 +112,13 @@ public:
     
     /// Dump all types and procs to output stream
     /// @param out Output stream (e.g., std::cout)
-    void DumpAll(std::ostream& out) const;
+    /// @param threadCount Threads formatting entries, written out in order (0 = this one)
+    void DumpAll(std::ostream& out, unsigned threadCount = 0) const;
     
     /// Test disassembly of all procs (for CI)
+    /// @param threadCount Threads decompiling procs (0 = this one)
     /// @return Number of failed procs
-    int TestAll() const;
+    int TestAll(unsigned threadCount = 0) const;
     
     /// Get statistics about loaded data
     struct Stats {
@@ -96,6 +129,54 @@ public:
     };
     Stats GetStats() const;
     
+    /// Build the static call graph of every proc, rooted at the procs on
+    /// /world and every verb
+    CallGraph BuildCallGraph() const;
+    
+    /// Count runs of consecutive opcodes within each proc, to find sequences
+    /// worth a superinstruction
+    /// @param length Opcodes per run
+    /// @param top How many of the most common runs to return
+    /// @return Opcode names joined by spaces and how often they occur, most common first
+    std::vector<std::pair<std::string, size_t>> TopOpcodeNGrams(size_t length, size_t top) const;
+    
+    /// Static figures over all bytecode, each list largest first
+    struct Profile {
+        size_t InstructionCount = 0;
+        std::vector<std::pair<std::string, size_t>> Opcodes;     ///< Every opcode used, with how often
+        std::vector<std::pair<std::string, size_t>> TypeSizes;   ///< Type path, bytecode bytes of its procs
+        std::vector<std::pair<std::string, size_t>> ProcSizes;   ///< Proc path, bytecode bytes
+        std::vector<std::pair<std::string, size_t>> StackSizes;  ///< Proc path, max stack size
+        std::vector<std::pair<std::string, size_t>> CallFanOut;  ///< Proc path, distinct procs it calls
+        std::vector<std::pair<std::string, size_t>> NGrams;      ///< As TopOpcodeNGrams() gives them
+    };
+    
+    /// Profile the loaded bytecode without running it, to find what is worth optimizing
+    /// @param top Entries to keep in each list but Opcodes
+    /// @param ngramLength Opcodes per run in NGrams
+    Profile GetProfile(size_t top, size_t ngramLength = 3) const;
+    
+    /// What changed between two outputs of the same code
+    struct DiffSummary {
+        size_t AddedTypes = 0;
+        size_t RemovedTypes = 0;
+        size_t MatchedProcs = 0;
+        size_t ChangedProcs = 0;  ///< Matched procs whose instructions or size differ
+        size_t AddedProcs = 0;
+        size_t RemovedProcs = 0;
+        size_t OldBytecodeSize = 0;
+        size_t NewBytecodeSize = 0;
+    };
+    
+    /// Compare with a newer output, matching types by path and procs by owner
+    /// path and name. Instructions are compared with operands resolved to
+    /// what they name and labels counted in instructions from the jump, so
+    /// renumbered strings and moved code elsewhere in the proc do not show.
+    /// @param newer The output to compare against
+    /// @param out Where each added, removed and changed proc is written, with
+    ///            its size change and removed and added instructions
+    DiffSummary Diff(const DMDisassembler& newer, std::ostream& out) const;
+    
     /// Get string from string table
     /// @param index String table index
     /// @return String value, or empty string if invalid index
@@ -104,19 +185,69 @@ public:
     /// Get all types
     const std::vector<DisasmType>& GetTypes() const { return types_; }
     
-    /// Get all procs
-    const std::vector<DisasmProc>& GetProcs() const { return procs_; }
+    /// Get all procs, filling in any bytecode not yet read
+    const std::vector<DisasmProc>& GetProcs() const {
+        LoadAllBytecode();
+        return procs_;
+    }
     
 private:
     bool loaded_;
     std::string filePath_;
+    OperandEncoding operandEncoding_;
     std::vector<DisasmType> types_;
-    std::vector<DisasmProc> procs_;
+    mutable std::vector<DisasmProc> procs_;  ///< Bytecode of a binary file's procs is filled in on first use
     std::unordered_map<std::string, int> pathToTypeId_;
     std::vector<std::string> stringTable_;
     
-    /// Helper to parse the JSON content
-    bool ParseJson(const std::string& content);
+    /// Lowercased type paths, proc names and strings, in that order, for
+    /// Search() and SearchStrings(). Each run of three characters maps to the
+    /// entries holding it, so a query of three or more characters only checks
+    /// the entries holding its rarest run.
+    std::vector<std::string> searchText_;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> trigrams_;
+    
+    /// Procs using each string, by string index. Built on first use, since it
+    /// reads every proc's bytecode.
+    mutable std::vector<std::vector<uint32_t>> stringUsers_;
+    mutable bool stringUsersBuilt_;
+    
+    /// A binary file's bytecode not yet copied out, by proc ID; cleared as each is
+    /// copied. Only the type and proc tables are read up front, so opening a
+    /// large file to look at a few procs does not read every proc's bytecode.
+    mutable std::vector<std::string_view> pendingBytecode_;
+    
+    /// What pendingBytecode_ points into: the mapped file, or its decompressed contents
+    std::shared_ptr<const SourceBuffer> source_;
+    std::string decompressed_;
+    
+    /// Helper to parse the JSON content, streamed into the tables without a document
+    bool ParseJson(std::string_view content);
+    
+    /// Helper to read the binary content (tables only; see pendingBytecode_)
+    bool ParseBinary(std::string_view content);
+    
+    /// Read a mapped file of either form, keeping it mapped if bytecode is pending
+    bool LoadFile(const std::string& path, bool allowJson);
+    
+    /// A proc, with or without its bytecode filled in
+    DisasmProc* FindProc(int procId) const;
+    
+    /// Fill in pending bytecode, of one proc or all of them
+    void LoadBytecode(DisasmProc& proc) const;
+    void LoadAllBytecode() const;
+    
+    /// A proc's bytecode size, without filling it in
+    size_t BytecodeSize(const DisasmProc& proc) const;
+    
+    /// Indices of searchText_ entries in [begin, end) containing query
+    std::vector<size_t> FindText(const std::string& query, size_t begin, size_t end) const;
+    
+    /// Fill in stringUsers_ from the bytecode
+    void BuildStringUsers() const;
+    
+    /// A proc's instructions in the form Diff() compares
+    std::vector<std::string> ComparableInstructions(const DisasmProc& proc) const;
     
     /// Build lookup tables after loading
     void BuildLookupTables();
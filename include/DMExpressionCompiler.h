@@ -37,12 +37,17 @@ public:
     /// </summary>
     /// <returns>true if compilation succeeded, false if unsupported</returns>
     bool CompileExpression(DMASTExpression* expr);
+    
+    /// <summary>
+    /// Write to another writer from now on (see DMStatementCompiler::CompileDiscarded).
+    /// </summary>
+    void SetWriter(BytecodeWriter* writer) { Writer_ = writer; }
 
     // Result of LValue analysis
     struct LValueInfo {
         enum class Kind { Local, Global, Field, Index, Invalid };
         Kind Type;
-        std::vector<uint8_t> ReferenceBytes;  // For Local/Global/Field
+        OperandBytes ReferenceBytes;  // For Local/Global/Field
         bool NeedsStackTarget;  // For Field/Index (target already on stack)
         bool IsConst = false;   // Is this LValue a const variable?
         std::optional<DreamPath> ResolvedType;  // The resolved type of this LValue (for type inference)
@@ -76,6 +81,20 @@ public:
     /// <returns>The expected type, or std::nullopt if not set</returns>
     std::optional<DreamPath> GetExpectedType() const;
     
+    /// <summary>
+    /// Evaluate an expression at compile time, reading const locals, const
+    /// fields and const globals the same way CompileIdentifier resolves them.
+    /// </summary>
+    /// <returns>A literal node, or nullptr if the value is only known at runtime</returns>
+    std::unique_ptr<DMASTExpression> TryEvaluateConstant(DMASTExpression* expr);
+    
+    /// <summary>
+    /// Convert between literal nodes and the Constant values const locals hold.
+    /// Both return nothing for values they cannot represent.
+    /// </summary>
+    static std::unique_ptr<DMASTExpression> ConstantToExpression(const Constant& value, const Location& location);
+    static std::optional<Constant> ExpressionToConstant(const DMASTExpression* expr);
+    
 private:
     DMCompiler* Compiler_;
     DMProc* Proc_;
@@ -90,6 +109,9 @@ private:
     bool CompileConstantNull(DMASTConstantNull* expr);
     bool CompileConstantPath(DMASTConstantPath* expr);
     
+    // Type a path constant refers to from this proc, or null if there is none
+    DMObject* ResolveConstantPathType(const DreamPath& dreamPath);
+    
     bool CompileBinaryOp(DMASTExpressionBinary* expr);
     bool CompileUnaryOp(DMASTExpressionUnary* expr);
     bool CompileIdentifier(DMASTIdentifier* expr);
@@ -121,6 +143,21 @@ private:
     CallArgumentsResult CompileCallArguments(
         const std::vector<std::unique_ptr<DMASTCallParameter>>& params);
 
+    /// <summary>
+    /// Compile a call to callee as what it returns, if its body is empty or
+    /// returns a constant or (when onSrc) a var of src. The arguments are
+    /// still evaluated and popped. Skipped with --no-opts.
+    /// The caller makes sure nothing overrides callee.
+    /// </summary>
+    /// <returns>False, with nothing emitted, if the call has to be made</returns>
+    bool TryInlineCall(DMProc* callee, DMASTCall* expr, bool onSrc);
+
+    /// <summary>
+    /// Compile a call to the global proc with this ID, referenced by ID so the
+    /// runtime does no name lookup, or inlined where TryInlineCall() can
+    /// </summary>
+    bool CompileGlobalProcCall(int procId, DMASTCall* expr);
+
     // Built-in functions
     bool CompileLocate(DMASTCall* expr);
     bool CompilePick(DMASTCall* expr);
@@ -134,6 +171,20 @@ private:
     bool CompileSqrt(DMASTCall* expr);
     bool CompileMathOp(DMASTCall* expr, DreamProcOpcode opcode);
     
+    // TryEvaluateConstant, also reporting whether a const variable was read
+    std::unique_ptr<DMASTExpression> TryEvaluateConstant(DMASTExpression* expr, bool& readConstant);
+    
+    // A binary operator and the operators nested down its left, outermost first
+    static std::vector<DMASTExpressionBinary*> LeftChain(DMASTExpressionBinary* expr);
+    
+    // TryEvaluateConstant of a chain's operators from the innermost out, as far
+    // as they stay constant; level is which one the value is of
+    std::unique_ptr<DMASTExpression> EvaluateChain(const std::vector<DMASTExpressionBinary*>& chain, size_t& level,
+                                                   bool& readConstant);
+    
+    // Literal value of a const variable the identifier refers to, if any
+    std::unique_ptr<DMASTExpression> LookupConstant(DMASTIdentifier* expr);
+    
     // Helper to get opcode for binary operator
     DreamProcOpcode GetBinaryOpcode(BinaryOperator op);
     
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <stack>
 #include <queue>
 #include "Lexer.h"
+#include "SourceBuffer.h"
 
 namespace DMCompiler {
 
@@ -15,12 +17,26 @@ namespace DMCompiler {
 class DMLexer : public Lexer<char> {
 public:
     DMLexer(const std::string& sourceName, const std::string& source, bool emitWhitespace = false);
+    
+    /// Scan a (typically memory-mapped) source buffer in place without copying it
+    DMLexer(const std::string& sourceName, std::shared_ptr<const SourceBuffer> source, bool emitWhitespace = false);
     ~DMLexer() override = default;
+    
+    /// Skip the body of an inactive conditional block without tokenizing it.
+    /// Only comments, strings and directives are recognized; everything else is stepped over.
+    /// @param depth Conditional nesting (1 = the block being skipped); nested #if/#endif pairs update it
+    /// @param stopAtElse Whether an #else or #elif at depth 1 ends the block
+    /// @return The consumed #endif/#else/#elif token that ends the block, or EndOfFile
+    virtual Token SkipConditionalBlock(int& depth, bool stopAtElse);
 
 protected:
     Token ParseNextToken() override;
+    
+    /// SkipConditionalBlock by pulling tokens (for lexers that do not scan source bytes)
+    Token SkipConditionalTokens(int& depth, bool stopAtElse);
 
 private:
+    std::shared_ptr<const SourceBuffer> Buffer_;  // Keeps the scanned bytes alive
     bool EmitWhitespace_;  // Whether to emit whitespace tokens (for preprocessing)
     
     Token ParseIdentifierOrKeyword();
@@ -42,7 +58,15 @@ private:
     void SkipLineComment();
     void SkipBlockComment();
     
-    TokenType GetKeywordType(const std::string& identifier) const;
+    // Raw skipping helpers for SkipConditionalBlock; they mirror the Parse* methods' scanning
+    void SkipString(char quote, bool allowInterpolation, bool continuation);
+    void SkipMultiLineString();
+    void SkipResource();
+    void AdvanceRun(size_t count);
+    // Advance to an index on the current line (no-op if already there)
+    void AdvanceTo(size_t index);
+    
+    TokenType GetKeywordType(std::string_view identifier) const;
     
     // Indentation tracking
     int CheckIndentation();
@@ -5,6 +5,8 @@
 #include "Token.h"
 #include "DreamPath.h"
 #include "JsonWriter.h"
+#include "FlatHashMap.h"
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -40,6 +42,7 @@ struct CellDefinitionJson {
     std::unique_ptr<MapObjectJson> Turf;
     std::unique_ptr<MapObjectJson> Area;
     std::vector<std::unique_ptr<MapObjectJson>> Objects;
+    uint32_t SkippedOverrides = 0;  // Var overrides written in the definition and not kept
     
     CellDefinitionJson(const std::string& name) : Name(name) {}
 };
@@ -54,7 +57,7 @@ struct MapBlockJson {
     int Z;
     int Width;
     int Height;
-    std::vector<std::string> Cells;
+    std::vector<uint32_t> Cells;  // Cell key IDs (DreamMapJson::GetCellKeyId), row by row
     
     MapBlockJson(int x, int y, int z) : X(x), Y(y), Z(z), Width(0), Height(0) {}
 };
@@ -62,15 +65,47 @@ struct MapBlockJson {
 /// <summary>
 /// JSON representation of an entire DMM map file.
 /// Contains all cell definitions and map blocks.
+///
+/// Cell keys ("aab") are numbered densely in the order they are first seen,
+/// so a grid is a flat array of key IDs rather than a string per tile.
 /// </summary>
 struct DreamMapJson {
     int MaxX;
     int MaxY;
     int MaxZ;
-    std::unordered_map<std::string, std::unique_ptr<CellDefinitionJson>> CellDefinitions;
+    std::vector<std::string> CellKeys;  // By key ID
+    std::vector<std::unique_ptr<CellDefinitionJson>> CellDefinitions;  // By key ID; null for a key only grids use
     std::vector<std::unique_ptr<MapBlockJson>> Blocks;
     
     DreamMapJson() : MaxX(0), MaxY(0), MaxZ(0) {}
+    
+    /// The ID of a cell key, numbering it on first use
+    uint32_t GetCellKeyId(std::string_view key) {
+        auto [it, inserted] = CellKeyIds_.try_emplace(key, static_cast<uint32_t>(CellKeys.size()));
+        if (inserted) {
+            CellKeys.emplace_back(key);
+            CellDefinitions.emplace_back();
+        }
+        return it->second;
+    }
+    
+    /// Move every block up by zOffset levels, as if it had been parsed with it
+    void OffsetZ(int zOffset) {
+        MaxZ = 0;
+        for (auto& block : Blocks) {
+            block->Z += zOffset;
+            MaxZ = std::max(MaxZ, block->Z);
+        }
+    }
+    
+    /// Define a key's cell, replacing any earlier definition of it
+    void SetCellDefinition(std::unique_ptr<CellDefinitionJson> cell) {
+        uint32_t id = GetCellKeyId(cell->Name);
+        CellDefinitions[id] = std::move(cell);
+    }
+    
+private:
+    FlatHashMap<uint32_t> CellKeyIds_;
 };
 
 /// <summary>
@@ -92,9 +127,9 @@ public:
     std::unique_ptr<CellDefinitionJson> ParseCellDefinition();
     
     /// <summary>
-    /// Parse a map block (e.g., (1,1,1) = {"aaaaabbbbb"})
+    /// Parse a map block (e.g., (1,1,1) = {"aaaaabbbbb"}), numbering its cell keys in map
     /// </summary>
-    std::unique_ptr<MapBlockJson> ParseMapBlock();
+    std::unique_ptr<MapBlockJson> ParseMapBlock(DreamMapJson& map);
 
 private:
     int ZOffset_;
@@ -121,6 +156,13 @@ private:
     /// Parse a constant value expression
     /// </summary>
     std::unique_ptr<DMASTExpression> ConstantExpression();
+    
+    /// <summary>
+    /// Step over a literal var override value (number, string, null or resource)
+    /// without building an expression for it, as overrides are not kept.
+    /// Returns false if the value is not a literal.
+    /// </summary>
+    bool SkipLiteral();
 };
 
 } // namespace DMCompiler
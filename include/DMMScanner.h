@@ -0,0 +1,84 @@
+#pragma once
+
+#include "DMMParser.h"
+#include "DreamPath.h"
+#include "Location.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+namespace DMCompiler {
+
+class DMCompiler;
+class DMObject;
+
+/// <summary>
+/// Single-pass scanner for .dmm files, reading the key table and the grids
+/// straight from the (mapped) file instead of going through the DM lexer.
+/// The DM lexer would turn each grid into one giant string token.
+///
+/// It handles the layout map editors write: keys like "aa" = (paths with
+/// optional {var overrides}), grids like (x,y,z) = {"rows"}, and comments.
+/// Like DMMParser it counts var overrides and skips them. Anything
+/// else (interpolated or escaped text, nested braces in an override, odd
+/// numbers, a malformed row) makes ScanMap() give up before reporting
+/// anything, so DMMParser can parse the same file from the start.
+///
+/// ScanMap() only reads the object tree, so several maps can be scanned at
+/// once; their warnings are held until ReportWarnings().
+/// </summary>
+class DMMScanner {
+public:
+    DMMScanner(DMCompiler* compiler, const std::string& fileName, std::string_view source, int zOffset);
+
+    /// Scan the whole file, the same as DMMParser::ParseMap() does
+    /// @return The map, or null if the file needs DMMParser
+    std::unique_ptr<DreamMapJson> ScanMap();
+
+    /// Report the warnings of a successful ScanMap()
+    void ReportWarnings();
+
+    /// What ScanMap() would report, for MapCache
+    const std::vector<std::string>& GetWarnings() const { return Warnings_; }
+
+    /// Every distinct type path the map names, found or not, in order
+    const std::vector<DreamPath>& GetReferencedTypes() const { return ReferencedTypes_; }
+
+private:
+    DMCompiler* Compiler_;
+    uint32_t FileId_;
+    std::string_view Source_;
+    int ZOffset_;
+    size_t Pos_ = 0;
+    int CellNameLength_ = -1;
+    DMObject* Turf_ = nullptr;
+    DMObject* Area_ = nullptr;
+    std::unordered_set<DreamPath, DreamPathHash> SeenTypes_;
+    std::vector<DreamPath> ReferencedTypes_;
+    std::vector<std::string> Warnings_;
+
+    // Where LocationAt() last counted lines up to, as warnings come in order
+    size_t CountedPos_ = 0;
+    int CountedLine_ = 1;
+
+    bool ScanCellDefinition(DreamMapJson& map);
+    bool ScanMapBlock(DreamMapJson& map);
+    bool ScanPath(std::string_view& path);
+    bool SkipVarOverrides(uint32_t& count);
+    bool ScanInteger(int& value);
+    bool ScanString(std::string_view& value);
+
+    /// Skip whitespace and comments
+    /// @return false if a comment is not closed
+    bool SkipWhitespace();
+    bool Expect(char c);
+    char Current() const { return Pos_ < Source_.size() ? Source_[Pos_] : '\0'; }
+
+    /// The location DMLexer gives a token starting at pos (columns count from 0)
+    Location LocationAt(size_t pos);
+    void Warning(size_t pos, const std::string& message);
+};
+
+} // namespace DMCompiler
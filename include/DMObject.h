@@ -2,7 +2,9 @@
 
 #include "DreamPath.h"
 #include "DMVariable.h"
+#include "FlatHashMap.h"
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -32,7 +34,23 @@ class DMProc;
 /// - Variables and procs are inherited from Parent
 /// - GetVariable() searches up the parent chain
 /// - HasProc() checks both owned and inherited procs
+/// - Once the tree is frozen, FlattenMembers() resolves all of that into one
+///   table per type, and those lookups become a single probe of it
 /// </summary>
+class DMObject;
+
+/// <summary>
+/// What a name resolves to on a type, inheritance included
+/// </summary>
+struct DMObjectMember {
+    const std::vector<int>* Procs = nullptr;  // As GetProcs() finds them
+    DMVariable* Variable = nullptr;           // As GetVariable() finds it
+    const DMVariable* Listed = nullptr;       // As DMObjectTree::GetAllVariables() lists it
+    bool IsLocalVariable = false;             // As HasLocalVariable() answers
+};
+
+using DMObjectMemberTable = std::unordered_map<std::string_view, DMObjectMember>;
+
 class DMObject {
 public:
     /// Unique identifier for this type (index in DMObjectTree::AllObjects)
@@ -55,7 +73,7 @@ public:
     
     /// Global/static variables on this type
     /// Maps variable name -> global variable ID
-    std::unordered_map<std::string, int> GlobalVariables;
+    FlatHashMap<int> GlobalVariables;
     
     /// Variable overrides from parent types
     /// When a child redefines a parent's variable, it goes here
@@ -70,10 +88,17 @@ public:
     std::unordered_set<std::string> ConstVariables;
     
     /// Optional initialization proc ID
-    /// If present, this proc is called when instances of this type are created
+    /// If present, this proc is called when instances of this type are created.
+    /// A type with no initial values of its own uses its nearest ancestor's.
     /// -1 indicates no initialization proc
     int InitializationProc = -1;
     
+    /// Position of this type in a pre-order walk of the frozen tree, and the
+    /// last position inside its subtree, so every subtype has a TreeIndex in
+    /// [TreeIndex, SubtreeEnd]. -1 until DMObjectTree::FreezeTypeTree().
+    int TreeIndex = -1;
+    int SubtreeEnd = -1;
+    
     /// Whether this object was defined in DMStandard files
     /// Used to distinguish built-in types from user-defined types
     bool IsFromDMStandard = false;
@@ -121,6 +146,12 @@ public:
     /// @return true if proc exists on this type or any parent
     bool HasProc(const std::string& name) const;
     
+    /// Check if this type is ancestor or a type below it, as istype() does
+    /// Two comparisons once both are numbered, a parent walk otherwise
+    /// @param ancestor The type to check against
+    /// @return true if this type is ancestor or inherits from it
+    bool IsSubtypeOf(const DMObject* ancestor) const;
+    
     /// Check if a proc was defined directly on this type (not inherited)
     /// @param name Proc name to check
     /// @return true if proc is directly owned by this type
@@ -134,12 +165,34 @@ public:
     
     /// Create an initialization proc for this object if needed
     /// This proc will be called when instances are created to initialize variables
-    /// Only creates if there are variables with initial values
+    /// Only creates if there are variables with initial values; otherwise the
+    /// type takes its parent's, instead of a proc that would only call ..()
     /// @param compiler Pointer to the compiler for creating the proc
     /// @param objectTree Pointer to the object tree for proc creation
     void CreateInitializationProc(class DMCompiler* compiler, class DMObjectTree* objectTree);
     
+    /// Resolve the procs and variables of this type and its parents into one
+    /// table. A type that defines none of its own shares its parent's. Called
+    /// by DMObjectTree::FreezeTypeTree(); nothing may add members after it
+    /// without calling ForgetMembers() on every type.
+    void FlattenMembers();
+    
+    /// Go back to walking the parent chain for every lookup
+    void ForgetMembers() { Members_.reset(); }
+    
+    /// The table FlattenMembers() made, or null before it
+    const DMObjectMemberTable* GetMembers() const { return Members_.get(); }
+    
 private:
+    /// Keys point into the maps of the types that define the names
+    std::shared_ptr<const DMObjectMemberTable> Members_;
+    
+    /// The entry for name in Members_, or null if it has none
+    const DMObjectMember* FindMember(const std::string& name) const {
+        auto it = Members_->find(name);
+        return it != Members_->end() ? &it->second : nullptr;
+    }
+    
     // Helper for HasGlobalVariable that doesn't check root
     bool HasGlobalVariableNotInRoot(const std::string& name) const;
 };
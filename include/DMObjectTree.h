@@ -4,12 +4,18 @@
 #include "DMVariable.h"
 #include "DreamPath.h"
 #include "Location.h"
+#include "ConcurrentStringInterner.h"
+#include "PointerRange.h"
+#include "FlatHashMap.h"
+#include "OperandEncoding.h"
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 
 namespace DMCompiler {
 
@@ -52,11 +58,11 @@ public:
     
     /// Mapping from global proc name to proc ID
     /// Used for quick lookup of globally-defined procedures
-    std::unordered_map<std::string, int> GlobalProcs;
+    FlatHashMap<int> GlobalProcs;
     
     /// Interned string table - all string literals point here
     /// Deduplication saves memory and enables efficient string comparison
-    std::vector<std::string> StringTable;
+    ConcurrentStringInterner StringTable;
     
     /// Resource paths used in the compilation (icons, sounds, etc.)
     /// Collected for packaging with the compiled output
@@ -78,7 +84,11 @@ public:
     /// If the string already exists, returns the existing ID
     /// @param value The string literal to intern
     /// @return Index in StringTable where the string is stored
-    int AddString(const std::string& value);
+    int AddString(std::string_view value);
+    
+    /// Record a resource path a proc uses
+    /// @param path The path as written in the resource literal
+    void AddResource(const std::string& path);
     
     /// Create or retrieve an existing object by path
     /// Automatically creates parent objects if they don't exist
@@ -123,10 +133,29 @@ public:
     /// @return Pointer to the first matching DMProc if found, nullptr otherwise
     DMProc* GetProc(DMObject* obj, const std::string& procName);
     
+    /// Called once every type and proc is in the tree, before procs are
+    /// compiled. Numbers the types for DMObject::IsSubtypeOf(), flattens the
+    /// members of every type (DMObject::FlattenMembers()),
+    /// records which types define each proc name, for
+    /// IsProcOverriddenBelow(), and from then on remembers what GetType(),
+    /// GetProc() and UpwardSearch() resolve to, so a repeated lookup is one
+    /// hash probe. Adding a type, proc or var through the tree afterwards
+    /// forgets all of that.
+    void FreezeTypeTree();
+    
+    /// Whether a call to procName on an instance of obj could run something
+    /// other than the single definition GetProc() finds: a type below obj
+    /// defines it too, or the type it comes from defines it more than once.
+    /// Always true before FreezeTypeTree().
+    /// @param obj The type the call is made on
+    /// @param procName The name of the proc called
+    bool IsProcOverriddenBelow(const DMObject* obj, const std::string& procName) const;
+    
     /// Get all variables for an object including inherited ones
+    /// Merged once per type and kept until the tree changes (see ForgetResolutions())
     /// @param obj The object to get variables for
     /// @return Map of variable name to variable definition (includes inherited)
-    std::unordered_map<std::string, const DMVariable*> GetAllVariables(DMObject* obj) const;
+    const std::unordered_map<std::string, const DMVariable*>& GetAllVariables(DMObject* obj) const;
     
     /// Create a global variable at file scope
     /// @param outGlobal Variable object to populate with the created global
@@ -173,7 +202,7 @@ public:
     /// Add a global constant with a numeric value
     /// Used for initializing DMStandard constants (NORTH, SOUTH, etc.)
     /// @param name The name of the constant
-    /// @param value The numeric value of the constant
+    /// @param value The numeric value of the constant (references compile to it)
     void AddGlobalConstant(const std::string& name, int value);
     
     /// Create a new proc and add it to the object tree
@@ -211,41 +240,108 @@ public:
     DMProc* AddProc(const DreamPath& owner, class DMASTObjectProcDefinition* procDef);
     
     /// Get all objects in the tree (for iteration during compilation)
-    /// @return Vector of pointers to all DMObject instances
-    std::vector<DMObject*> GetAllObjects() const;
+    /// @return View of AllObjects as DMObject pointers, valid until a type is added
+    PointerRange<DMObject> GetAllObjects() const { return PointerRange<DMObject>(AllObjects); }
     
     /// Get all procs in the tree (for iteration during compilation)
-    /// @return Vector of pointers to all DMProc instances
-    std::vector<DMProc*> GetAllProcs() const;
+    /// @return View of AllProcs as DMProc pointers, valid until a proc is added
+    PointerRange<DMProc> GetAllProcs() const { return PointerRange<DMProc>(AllProcs); }
     
     /// Get all procs for an object including inherited procs
     /// Walks up the inheritance hierarchy and collects all procs
     /// Child procs override parent procs with the same name
+    /// Merged once per type and kept until the tree changes, like GetAllVariables()
     /// @param obj The object to get procs for
     /// @return Map of proc name to the most-derived DMProc
-    std::unordered_map<std::string, DMProc*> GetAllProcsForObject(DMObject* obj) const;
+    const std::unordered_map<std::string, DMProc*>& GetAllProcsForObject(DMObject* obj) const;
     
     /// Mark all existing objects and procs as being from DMStandard
     /// Called when transitioning from DMStandard file processing to user code
     /// Sets IsFromDMStandard=true on all objects created before this point
     void SetDMStandardFinalized();
+    
+    /// Drop the procs not kept and renumber the rest in order, pointing types,
+    /// global procs and every kept proc's bytecode at the new IDs
+    /// (--strip-unused). No kept proc may still refer to a dropped one.
+    /// @param keep Whether each proc stays
+    /// @param encoding How the procs' operands are written
+    /// @return The dropped procs, in their old order
+    std::vector<std::unique_ptr<DMProc>> RemoveProcs(const std::vector<bool>& keep, OperandEncoding encoding);
 
 private:
     /// Pointer to compiler for error reporting (may be null)
     DMCompiler* Compiler_;
     
-    /// String to string ID mapping for O(1) deduplication lookup
-    std::unordered_map<std::string, int> StringToStringId_;
-    
     /// Path to type ID mapping for O(1) type lookup
     std::unordered_map<DreamPath, int, DreamPathHash> PathToTypeId_;
     
     /// Next available object ID (incremented on each object creation)
     int DmObjectIdCounter_;
     
+    /// Values of the constants added by AddGlobalConstant (their Globals
+    /// entries point here, as they have no source to point into)
+    std::vector<std::unique_ptr<DMASTExpression>> ConstantValues_;
+    
     /// Next available proc ID (incremented on each proc creation)
     int DmProcIdCounter_;
     
+    /// Types defining each proc name, once FreezeTypeTree() has run
+    std::optional<std::unordered_map<std::string, std::vector<const DMObject*>>> ProcDefiners_;
+    
+    /// A lookup: where it starts, the path it looks for, and the proc the
+    /// type has to have (GetProc() and UpwardSearch())
+    struct ResolutionKey {
+        DreamPath From;
+        DreamPath Search;
+        std::string ProcName;
+        
+        bool operator==(const ResolutionKey& other) const {
+            return From == other.From && Search == other.Search && ProcName == other.ProcName;
+        }
+    };
+    struct ResolutionKeyHash {
+        std::size_t operator()(const ResolutionKey& key) const {
+            return key.From.Hash() * 31 + key.Search.Hash() * 17 + std::hash<std::string>{}(key.ProcName);
+        }
+    };
+    
+    /// What relative lookups came to since FreezeTypeTree(). Procs compile
+    /// on several threads, so the memos have a lock.
+    bool TypesFrozen_ = false;
+    mutable std::shared_mutex ResolutionMutex_;
+    std::unordered_map<ResolutionKey, DMObject*, ResolutionKeyHash> ResolvedTypes_;
+    std::unordered_map<ResolutionKey, DMProc*, ResolutionKeyHash> ResolvedProcs_;
+    std::unordered_map<ResolutionKey, std::optional<DreamPath>, ResolutionKeyHash> UpwardSearches_;
+    
+    /// What GetAllVariables() and GetAllProcsForObject() merged, by type
+    mutable std::unordered_map<const DMObject*, std::unordered_map<std::string, const DMVariable*>> MergedVariables_;
+    mutable std::unordered_map<const DMObject*, std::unordered_map<std::string, DMProc*>> MergedProcs_;
+    
+    /// The result for key from memo, running resolve to find it the first time
+    template <typename Value, typename Resolve>
+    Value Memoize(std::unordered_map<ResolutionKey, Value, ResolutionKeyHash>& memo, ResolutionKey key,
+                  Resolve resolve);
+    
+    /// GetType() for a relative path and a context, without the memo
+    DMObject* ResolveRelativeType(const DreamPath& path, DMObject* context);
+    
+    /// Drop the memos, merged tables and member tables, as a new type, proc
+    /// or var may change what a lookup finds
+    void ForgetResolutions();
+    
+    /// Give every type its TreeIndex and SubtreeEnd
+    void NumberTypes();
+    
+    /// GetProc() on a type, without the memo
+    DMProc* ResolveProc(DMObject* obj, const std::string& procName);
+    
+    /// GetAllVariables() and GetAllProcsForObject() without the caches
+    std::unordered_map<std::string, const DMVariable*> MergeVariables(const DMObject* obj) const;
+    std::unordered_map<std::string, DMProc*> MergeProcs(const DMObject* obj) const;
+    
+    /// UpwardSearch() without the memo
+    std::optional<DreamPath> SearchUpward(const DreamPath& path, const DreamPath& search, const std::string& procName);
+    
     /// Initialize built-in global constants (TRUE, FALSE, NORTH, etc.)
     void InitializeBuiltInConstants();
     
@@ -12,7 +12,7 @@
 #include <memory>
 #include <array>
 #include <unordered_set>
-#include <stack>
+#include <deque>
 #include <stdexcept>
 
 namespace DMCompiler {
@@ -20,21 +20,25 @@ namespace DMCompiler {
 /// <summary>
 /// RAII guard for tracking recursion depth in parser.
 /// Automatically decrements depth when going out of scope.
-/// Throws exception if max depth is exceeded.
+/// Past the maximum depth it counts nothing and reports Exceeded(), for the
+/// caller to give up on the statement with DMParser::Fail().
 /// </summary>
 class RecursionGuard {
 public:
-    RecursionGuard(int& depth, int maxDepth, const char* context = nullptr)
-        : Depth_(depth), Context_(context) {
-        if (++Depth_ > maxDepth) {
-            --Depth_;  // Restore before throwing
-            throw std::runtime_error(
-                std::string("Maximum nesting depth exceeded") + 
-                (context ? std::string(" in ") + context : ""));
+    RecursionGuard(int& depth, int maxDepth)
+        : Depth_(depth), Exceeded_(depth >= maxDepth) {
+        if (!Exceeded_) {
+            ++Depth_;
         }
     }
     
-    ~RecursionGuard() { --Depth_; }
+    ~RecursionGuard() {
+        if (!Exceeded_) {
+            --Depth_;
+        }
+    }
+    
+    bool Exceeded() const { return Exceeded_; }
     
     // Non-copyable
     RecursionGuard(const RecursionGuard&) = delete;
@@ -42,10 +46,11 @@ public:
     
 private:
     int& Depth_;
-    const char* Context_;
+    bool Exceeded_;
 };
 
 class DMCompiler;
+class TokenStreamDMLexer;
 enum class WarningCode;
 
 /// <summary>
@@ -80,27 +85,107 @@ public:
     /// Parse an object statement (for testing)
     /// </summary>
     std::unique_ptr<DMASTObjectStatement> ObjectStatement();
+    
+    /// <summary>
+    /// Note diagnostics instead of reporting them. Every parser diagnostic
+    /// means malformed input, so ParallelParser uses this to detect chunks it
+    /// has to reparse sequentially for error recovery to match a normal run.
+    /// </summary>
+    void SetSuppressDiagnostics(bool suppress) { SuppressDiagnostics_ = suppress; }
+    bool HadSuppressedDiagnostics() const { return HadSuppressedDiagnostics_; }
+    
+    /// <summary>
+    /// Skip proc bodies whose extent follows from Indent/Dedent or brace
+    /// nesting alone, recording their token range in
+    /// DMASTObjectProcDefinition::DeferredBody instead; other bodies are
+    /// parsed as usual. Takes effect only when the lexer walks a TokenBuffer
+    /// that went through ResolveIndentation.
+    /// </summary>
+    void SetDeferProcBodies(bool defer);
+    
+    /// <summary>
+    /// Parse a lone proc body, such as one deferred by SetDeferProcBodies()
+    /// read back through a TokenStreamDMLexer over its range
+    /// </summary>
+    /// @param baseIndent Column the body's lines must be indented past
+    std::unique_ptr<DMASTProcBlockInner> ParseProcBody(int baseIndent);
 
 protected:
     // Base parser functionality
-    Token Current() const { return CurrentToken_; }
-    Token Advance();
+    const Token& Current() const { return Failure_.empty() ? Window_[Position_ - WindowStart_] : FailedAt_; }
+    const Token& Advance();
     bool Check(TokenType type);
     void Consume(TokenType type, const std::string& errorMessage);
-    void ReuseToken(Token token);
     void Warning(const std::string& message, const Token* token = nullptr);
     void Emit(WarningCode code, const std::string& message);
+    void Emit(WarningCode code, const Location& location, const std::string& message);
+    
+    // Token cursor: tokens read from the lexer stay in a window until
+    // DiscardConsumed(), so looking ahead and backtracking only move an index
+    
+    /// Look at the token offset places after the current one without consuming it
+    const Token& Peek(size_t offset = 1);
+    /// Position of the current token, to return to with Rewind()
+    size_t Mark() const { return Position_; }
+    /// Make the token at a position from Mark() current again
+    void Rewind(size_t mark) {
+        if (Failure_.empty()) {
+            Position_ = mark;
+        }
+    }
+    
+    /// <summary>
+    /// Give up on the statement being parsed. Until the statement loop around
+    /// it calls TakeFailure(), the parser sits on an EndOfFile, which ends
+    /// every loop and makes every parse return what it has: a status-return
+    /// unwind that leaves the position where parsing failed, for the loop to
+    /// resume from
+    /// </summary>
+    void Fail(const std::string& reason);
+    /// End an unwind from Fail(), discarding what the statement parsed
+    /// @return false if nothing failed
+    bool TakeFailure(std::string& reason);
+    /// Forget the tokens before the current one. Called between top-level
+    /// statements; marks taken earlier can no longer be rewound to
+    void DiscardConsumed();
     
     // Path parsing (exposed for derived parsers like DMMParser)
     DMASTPath ParsePath();
     
+    /// <summary>
+    /// Create an AST node. Inside ParseFile() nodes come from the arena the
+    /// resulting DMASTFile will own; otherwise (single expressions or
+    /// statements parsed on their own) they are heap-allocated.
+    /// </summary>
+    template<typename T, typename... Args>
+    std::unique_ptr<T> NewNode(Args&&... args) {
+        if (Arena_) {
+            return std::unique_ptr<T>(new (*Arena_) T(std::forward<Args>(args)...));
+        }
+        return std::make_unique<T>(std::forward<Args>(args)...);
+    }
+    
     // Parser state
     DMCompiler* Compiler_;
     
 private:
     DMLexer* Lexer_;
-    Token CurrentToken_;
-    std::stack<Token> TokenStack_;
+    DMASTArena* Arena_;             // Arena of the file being parsed by ParseFile(), if any
+    TokenStreamDMLexer* DeferSource_;  // Lexer to skip deferred proc bodies in (see SetDeferProcBodies)
+    bool SuppressDiagnostics_;
+    bool HadSuppressedDiagnostics_;
+    std::string Failure_;  // Why the statement being parsed failed, empty unless unwinding from Fail()
+    Token FailedAt_;       // What Current() returns while unwinding
+    
+    // Tokens from WindowStart_ on, read from the lexer with whitespace and
+    // #error/#warn tokens already handled. std::deque keeps references from
+    // Current() valid while more tokens are read
+    std::deque<Token> Window_;
+    size_t WindowStart_;
+    size_t Position_;
+    
+    /// Read the next parser-visible token from the lexer into the window
+    void FetchToken();
     
     // Current parsing state
     DreamPath CurrentPath_;
@@ -125,11 +210,6 @@ private:
     
     // Token type sets for parsing decisions
     static const std::array<TokenType, 15> AssignTypes_;
-    static const std::array<TokenType, 4> ComparisonTypes_;
-    static const std::array<TokenType, 4> LtGtComparisonTypes_;
-    static const std::array<TokenType, 2> ShiftTypes_;
-    static const std::array<TokenType, 2> PlusMinusTypes_;
-    static const std::array<TokenType, 4> MulDivModTypes_;
     static const std::array<TokenType, 6> DereferenceTypes_;
     static const std::array<TokenType, 1> WhitespaceTypes_;
     static const std::array<TokenType, 3> IdentifierTypes_;
@@ -157,15 +237,13 @@ private:
     // Expression() is public for testing
     std::unique_ptr<DMASTExpression> PrimaryExpression();
     std::unique_ptr<DMASTExpression> UnaryExpression();
-    std::unique_ptr<DMASTExpression> MultiplicationExpression();
-    std::unique_ptr<DMASTExpression> AdditionExpression();
-    std::unique_ptr<DMASTExpression> ShiftExpression();
-    std::unique_ptr<DMASTExpression> ComparisonExpression();
-    std::unique_ptr<DMASTExpression> BitwiseAndExpression();
-    std::unique_ptr<DMASTExpression> BitwiseXorExpression();
-    std::unique_ptr<DMASTExpression> BitwiseOrExpression();
-    std::unique_ptr<DMASTExpression> LogicalAndExpression();
-    std::unique_ptr<DMASTExpression> LogicalOrExpression();
+    
+    /// <summary>
+    /// Parse a chain of binary operators (|| up to * / % **) by precedence
+    /// climbing, taking only operators that bind at least as tightly as
+    /// minPrecedence. 1 parses every binary operator.
+    /// </summary>
+    std::unique_ptr<DMASTExpression> BinaryExpression(int minPrecedence = 1);
     std::unique_ptr<DMASTExpression> TernaryExpression();
     std::unique_ptr<DMASTExpression> AssignmentExpression();
     std::unique_ptr<DMASTExpression> PostfixExpression();
@@ -210,6 +288,15 @@ private:
     std::unique_ptr<DMASTObjectStatement> ObjectDefinition(const DMASTPath& path, Location loc);
     std::unique_ptr<DMASTDefinitionParameter> ProcParameter();
     
+    /// Parse the body of a proc definition, or skip it and fill in deferred
+    /// if SetDeferProcBodies() is on and the body's end is certain
+    std::unique_ptr<DMASTProcBlockInner> ProcDefinitionBody(int baseIndent, DMASTObjectProcDefinition::DeferredBodyRange& deferred);
+    
+    /// Find where the body starting at buffer index begin ends (past its
+    /// last token), the way ProcBlockInner() would end it on well-formed code
+    /// @return False if that is not certain without parsing it
+    bool FindProcBodyEnd(size_t begin, int baseIndent, size_t& end) const;
+    
     // Helper methods
     BinaryOperator TokenTypeToBinaryOp(TokenType type);
     UnaryOperator TokenTypeToUnaryOp(TokenType type);
@@ -223,6 +310,8 @@ private:
     
     // Error recovery
     void SkipToNextStatement();
+    /// Skip past the rest of the current top-level definition, indented lines and all
+    void SkipToTopLevel();
     
     /// <summary>
     /// Recover from a parse error by skipping to the next statement boundary
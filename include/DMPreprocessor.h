@@ -6,14 +6,39 @@
 #include <unordered_set>
 #include <stack>
 #include <memory>
+#include <cstdint>
+#include <chrono>
 #include <filesystem>
 #include "Token.h"
 #include "Location.h"
+#include "PreprocessorStats.h"
+#include "FlatHashMap.h"
 
 namespace DMCompiler {
 
 class DMCompiler;
 class DMLexer;
+class SourceBuffer;
+class PreLexedFiles;
+class TokenCache;
+class CompileCosts;
+struct DependencyGraph;
+
+/// Map a source file for lexing, joining backslash line continuations
+std::shared_ptr<const SourceBuffer> LoadPreprocessorSource(const std::string& path);
+
+/// Restore backslashes in an #include path that the lexer treated as escapes
+std::string FixIncludePath(const std::string& path);
+
+/// <summary>
+/// Arguments of one function-like macro call, as [begin, end) ranges into a token array
+/// owned by the preprocessor. Only valid for the duration of the expansion.
+/// </summary>
+struct MacroArguments {
+    const Token* Tokens = nullptr;
+    const std::pair<size_t, size_t>* Ranges = nullptr;
+    size_t Count = 0;
+};
 
 /// <summary>
 /// Represents a preprocessor macro
@@ -24,6 +49,9 @@ public:
     // Each argument is now a vector of tokens to support multi-token arguments like "++ x"
     virtual std::vector<Token> Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) = 0;
     virtual bool HasParameters() const { return false; }
+    
+    /// Push the expansion onto a token stack, last token first, so it pops off in order
+    virtual void ExpandOnto(const MacroArguments& arguments, const Location& location, std::stack<Token>& output);
 };
 
 /// <summary>
@@ -38,22 +66,36 @@ public:
     std::vector<Token> Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) override {
         return Tokens;
     }
+    
+    void ExpandOnto(const MacroArguments& arguments, const Location& location, std::stack<Token>& output) override;
 };
 
 /// <summary>
 /// Function-like macro with parameters
+///
+/// The body is compiled into a template when the macro is defined: each body token
+/// is either a literal or the index of the parameter it stands for, so expansion is
+/// a single pass with no name lookups.
 /// </summary>
 class DMMacroFunction : public DMMacro {
 public:
     std::vector<std::string> Parameters;
     std::vector<Token> Tokens;
     
-    DMMacroFunction(const std::vector<std::string>& params, const std::vector<Token>& tokens)
-        : Parameters(params), Tokens(tokens) {}
+    DMMacroFunction(const std::vector<std::string>& params, const std::vector<Token>& tokens);
     
     bool HasParameters() const override { return true; }
     
     std::vector<Token> Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) override;
+    void ExpandOnto(const MacroArguments& arguments, const Location& location, std::stack<Token>& output) override;
+    
+private:
+    static constexpr int32_t LiteralSlot = -1;
+    
+    // Parallel to Tokens: LiteralSlot, or the parameter index substituted for that token
+    std::vector<int32_t> Template_;
+    
+    bool CheckArgumentCount(size_t count, const Location& location) const;
 };
 
 /// <summary>
@@ -97,6 +139,16 @@ struct FileContext {
     std::string Directory;
     int IncludeDepth;
     
+    // Include-guard detection: the whole file is "#ifndef X ... #endif"
+    enum class GuardState { Start, Inside, Closed, None };
+    GuardState Guard = GuardState::Start;
+    std::string GuardMacro;
+    size_t GuardDepth = 0;  // Conditional nesting outside the guard
+    bool PragmaOnce = false;
+    
+    // Counters for this file when statistics are enabled
+    PreprocessorStats::FileStats* Stats = nullptr;
+    
     FileContext(std::unique_ptr<DMLexer> lexer, const std::string& path, int depth)
         : Lexer(std::move(lexer))
         , FilePath(path)
@@ -110,6 +162,11 @@ struct FileContext {
         , FilePath(std::move(other.FilePath))
         , Directory(std::move(other.Directory))
         , IncludeDepth(other.IncludeDepth)
+        , Guard(other.Guard)
+        , GuardMacro(std::move(other.GuardMacro))
+        , GuardDepth(other.GuardDepth)
+        , PragmaOnce(other.PragmaOnce)
+        , Stats(other.Stats)
     {}
     
     // Move assignment
@@ -119,6 +176,11 @@ struct FileContext {
             FilePath = std::move(other.FilePath);
             Directory = std::move(other.Directory);
             IncludeDepth = other.IncludeDepth;
+            Guard = other.Guard;
+            GuardMacro = std::move(other.GuardMacro);
+            GuardDepth = other.GuardDepth;
+            PragmaOnce = other.PragmaOnce;
+            Stats = other.Stats;
         }
         return *this;
     }
@@ -152,14 +214,37 @@ public:
     Token GetNextToken();
     bool IsComplete() const;
     
+    /// Get the next token of the preprocessed output. Mid-line whitespace is
+    /// dropped; whitespace after a newline is kept for indentation.
+    /// @return false once the stream is exhausted
+    bool ReadOutputToken(Token& token);
+    
     // Main preprocessing entry point (kept for backward compatibility)
     std::vector<Token> Preprocess(const std::string& filePath);
     
+    /// Lex files reachable from each root on this many threads before preprocessing (0 = lex inline)
+    void SetLexThreads(unsigned threadCount) { LexThreads_ = threadCount; }
+    
+    /// Reuse lexer output stored in this on-disk cache, adding files that miss
+    void SetTokenCache(std::shared_ptr<const TokenCache> cache) { TokenCache_ = std::move(cache); }
+    
+    /// Collect per-file, per-macro and skipping statistics into this object (null = off)
+    void SetStats(std::shared_ptr<PreprocessorStats> stats) { Stats_ = std::move(stats); }
+    
+    /// Charge each file the time it is the one being read into this object (null = off)
+    void SetCosts(std::shared_ptr<CompileCosts> costs) { Costs_ = std::move(costs); }
+    
+    /// Record what each file includes, defines and expands into this graph (null = off)
+    void SetDependencies(std::shared_ptr<DependencyGraph> dependencies) { Dependencies_ = std::move(dependencies); }
+    
+    /// Number of #if/#elif conditions answered from the condition cache
+    size_t GetConditionCacheHits() const { return ConditionCacheHits_; }
+    
     // Include tracking
     std::vector<std::string> GetIncludedMaps() const { return IncludedMaps_; }
     std::string GetIncludedInterface() const { return IncludedInterface_; }
     
-    // Define management
+    // Define management (Define() is for command-line defines, which every root file sees)
     void Define(const std::string& name, const std::string& value);
     void Undefine(const std::string& name);
     bool IsDefined(const std::string& name) const;
@@ -183,24 +268,63 @@ private:
     std::stack<Token> UnprocessedTokens_;
     std::stack<Token> BufferedWhitespace_;
     
+    // Macro call arguments, shared by nested calls (each call truncates back to where it started)
+    std::vector<Token> MacroArgTokens_;
+    std::vector<std::pair<size_t, size_t>> MacroArgRanges_;
+    
     // Macro definitions
-    std::unordered_map<std::string, std::unique_ptr<DMMacro>> Defines_;
+    FlatHashMap<std::unique_ptr<DMMacro>> Defines_;
+    std::vector<std::pair<std::string, std::string>> CommandLineDefines_;  // Given to Define(), restored by Initialize()
+    
+    // Bumped whenever a macro is defined, redefined or undefined (absent = never changed)
+    std::unordered_map<std::string, uint64_t> MacroGenerations_;
+    uint64_t MacroGenerationCounter_ = 0;
+    
+    // Evaluated #if/#elif conditions, keyed by the expanded directive tokens. An entry holds
+    // while every macro the evaluation looked at is still at the generation it saw.
+    struct ConditionCacheEntry {
+        bool Result = false;
+        std::vector<std::pair<std::string, uint64_t>> Dependencies;
+    };
+    std::unordered_map<std::string, ConditionCacheEntry> ConditionCache_;
+    size_t ConditionCacheHits_ = 0;
+    
+    // Statistics for --preproc-stats (null when disabled)
+    std::shared_ptr<PreprocessorStats> Stats_;
+    
+    // Time attribution for --compile-costs (null when disabled)
+    std::shared_ptr<CompileCosts> Costs_;
+    
+    // Per-file includes and macros for --dependency-graph (null when disabled)
+    std::shared_ptr<DependencyGraph> Dependencies_;
+    std::chrono::steady_clock::time_point CostMark_;  // When the file on top began being read
+    
+    /// Charge the file on top of the stack until now, before it changes
+    void ChargeCurrentFile();
     
     // Include tracking
     std::unordered_set<std::string> IncludedFiles_;
     
+    // Files lexed ahead of time by SetLexThreads (kept across Initialize calls)
+    unsigned LexThreads_ = 0;
+    std::unique_ptr<PreLexedFiles> PreLexed_;
+    std::shared_ptr<const TokenCache> TokenCache_;
+    
     // Path resolution cache for performance
     std::unordered_map<std::string, std::string> PathCache_;
     
+    // Files found to be include-guarded: normalized path -> controlling macro ("" for #pragma once)
+    std::unordered_map<std::string, std::string> IncludeGuards_;
+    
     // Conditional compilation state
     std::stack<bool> LastIfEvaluations_;
     bool CanUseDirective_;
     bool CurrentLineContainsNonWhitespace_;
     TokenType PreviousNonWhitespaceToken_; // Track previous token for path context detection
+    bool LastOutputWasNewline_; // Whether ReadOutputToken last returned a newline
     
     // Token processing (GetNextToken is now public for streaming interface)
     void PushToken(Token&& token);
-    void PushTokens(std::vector<Token>&& tokens);
     Token GetNextRawToken(); // NEW: Get token from lexer without preprocessing
     
     // Directive handlers (batch mode - for backward compatibility)
@@ -228,11 +352,22 @@ private:
     
     // Macro handling
     bool TryExpandMacro(const Token& token);
-    std::vector<std::vector<Token>> ReadMacroArguments();
+    void ReadMacroArguments();  // Appends to MacroArgTokens_/MacroArgRanges_
     
     // Conditional evaluation
     bool EvaluateCondition(const std::vector<Token>& tokens);
+    void DefineMacro(const std::string& name, const std::string& value);  // Define() without recording it
+    void TouchMacro(const std::string& name);
+    uint64_t GetMacroGeneration(const std::string& name) const;
     void SkipIfBody(bool skipElse);
+    void SkipIfBodyUntimed(bool skipElse);
+    
+    // Include guards
+    std::string ResolveIncludePath(const std::string& filePath);
+    bool IsIncludeGuarded(const std::string& absolutePath) const;
+    void TrackIncludeGuard(FileContext& context, const Token& token);
+    void RecordIncludeGuard(const FileContext& context);
+    void RecordIncludeRequest(const std::string& absolutePath);
     
     // File inclusion
     bool IncludeFile(const std::string& path, const Location& includeLocation);
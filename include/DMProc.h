@@ -3,6 +3,8 @@
 #include "DreamPath.h"
 #include "DMVariable.h"
 #include "Location.h"
+#include "FlatHashMap.h"
+#include "ProcProfile.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -20,6 +22,7 @@ class DMObject;
 class DMCompiler;
 class DMASTExpression;
 class DMASTProcDefinition;
+class DMASTObjectProcDefinition;
 class DMASTDefinitionParameter;
 
 /// <summary>
@@ -73,7 +76,7 @@ public:
     /// Variable name
     std::string Name;
     
-    /// Unique ID within this proc
+    /// Slot within this proc; locals whose scopes do not overlap can share one
     int Id;
     
     /// Is this a parameter (vs local var)?
@@ -233,8 +236,9 @@ public:
 /// </summary>
 class DMProc {
 public:
-    /// Unique identifier for this proc (index in DMObjectTree::AllProcs)
-    const int Id;
+    /// Unique identifier for this proc (index in DMObjectTree::AllProcs);
+    /// only DMObjectTree::RemoveProcs() changes it
+    int Id;
     
     /// Proc name (e.g., "New", "Attack", "Move")
     std::string Name;
@@ -254,11 +258,12 @@ public:
     /// Parameter names in declaration order
     std::vector<std::string> Parameters;
     
-    /// All local variables (parameters + local vars)
-    std::unordered_map<std::string, std::unique_ptr<LocalVariable>> LocalVariables;
+    /// Every parameter and local declared so far, in declaration order,
+    /// including the ones whose scope has ended
+    std::vector<std::unique_ptr<LocalVariable>> LocalVariables;
     
     /// Global variables accessed by this proc
-    std::unordered_map<std::string, int> GlobalVariables;
+    FlatHashMap<int> GlobalVariables;
     
     /// Bytecode for this proc (raw bytes in little-endian format)
     /// Generated by BytecodeWriter during compilation
@@ -268,10 +273,18 @@ public:
     /// Maximum stack size required by this proc
     int MaxStackSize;
     
+    /// How hot the runtime profile says this proc is (--profile-data), set
+    /// before procs are compiled
+    ProcTemperature Temperature = ProcTemperature::Warm;
+    
     /// AST body for this proc (stored during Phase 3, compiled in Phase 4)
     /// This is a non-owning pointer - the AST is owned by the DMASTFile
     DMASTProcBlockInner* AstBody = nullptr;
     
+    /// Definition the proc came from, whose body may still be deferred
+    /// (--lazy-proc-bodies); non-owning like AstBody
+    DMASTObjectProcDefinition* AstDefinition = nullptr;
+    
     /// AST parameter definitions (stored during Phase 3, used in Phase 4)
     /// These are non-owning pointers - the AST is owned by the DMASTFile
     std::vector<DMASTDefinitionParameter*> AstParameters;
@@ -357,7 +370,7 @@ public:
         Constant value
     );
     
-    /// Get a local variable by name (includes parameters)
+    /// Get a local variable in scope by name (includes parameters)
     /// @param name Variable name to look up
     /// @return Pointer to variable if found, nullptr otherwise
     LocalVariable* GetLocalVariable(const std::string& name);
@@ -376,6 +389,24 @@ public:
     /// @return Local variable count
     int GetLocalVariableCount() const;
     
+    /// Open a block scope. Locals declared until the matching EndScope() are
+    /// only visible inside it, and give their slots back when it ends.
+    void StartScope();
+    
+    /// Close the innermost scope opened by StartScope()
+    void EndScope();
+    
+    /// A local that is read before anything is stored in it has to read null.
+    /// @param local A local that was just declared without a value
+    /// @return True if its slot held another local before, in which case the
+    ///         caller has to store null in it; otherwise the slot is kept from
+    ///         being reused, so it stays null
+    bool NeedsNullStore(const LocalVariable* local);
+    
+    /// Get the number of slots the proc's frame needs for its parameters and locals
+    /// @return Highest local ID plus one
+    int GetLocalSlotCount() const { return static_cast<int>(Slots_.size()); }
+    
     /// Check if this proc is marked as unsupported
     /// @return true if UnsupportedReason is set
     bool IsUnsupported() const { return UnsupportedReason.has_value(); }
@@ -399,6 +430,21 @@ public:
     /// @param compiler Pointer to the compiler for emitting bytecode
     void Compile(class DMCompiler* compiler);
     
+    /// Optimize (unless --no-opts) and finalize what writer holds, size the
+    /// stack from the result and store it as this proc's bytecode
+    /// @param compiler The compiler whose settings apply
+    /// @param writer The writer the body was compiled with
+    void StoreBytecode(class DMCompiler* compiler, class BytecodeWriter& writer);
+    
+    /// Parse the body of AstDefinition if the parser deferred it, and point
+    /// AstBody at it
+    /// @param compiler The compiler holding the parsed token stream
+    void LoadDeferredBody(class DMCompiler* compiler);
+    
+    /// Undo what the last Compile() did to this proc (its bytecode, and the
+    /// locals and enumerators it declared), so it can be compiled again
+    void ResetCompilation();
+    
     /// Get a string representation for debugging
     /// Format: "/mob/proc/Attack(target, damage)"
     /// @return String representation
@@ -420,11 +466,39 @@ public:
     int DecrementEnumeratorId() { return --EnumeratorIdCounter_; }
 
 private:
-    /// Next available local variable ID
-    int LocalVariableIdCounter_;
+    /// What a local slot holds
+    struct LocalSlot {
+        const LocalVariable* Holder = nullptr;  // Null while the slot is free
+        bool Reused = false;  // Held another local before Holder
+        bool Pinned = false;  // Never handed to another local
+    };
+    
+    /// Take the lowest free slot for a new local
+    /// @return The slot, which is the local's ID
+    int AllocateSlot();
+    
+    /// Add a local created for the slot AllocateSlot() returned, in the innermost scope
+    LocalVariable* DeclareLocal(std::unique_ptr<LocalVariable> local);
+    
+    /// Every slot, indexed by LocalVariable::Id
+    std::vector<LocalSlot> Slots_;
+    
+    /// Locals in scope, innermost last
+    std::vector<LocalVariable*> VisibleLocals_;
+    
+    /// Size of VisibleLocals_ when each open scope started
+    std::vector<size_t> ScopeStarts_;
     
     /// Enumerator ID counter for for-in loops
     int EnumeratorIdCounter_ = 0;
+    
+    /// Locals, the enumerator counter and whether the proc was unsupported
+    /// (set statements can mark it while compiling) as the last Compile() found them
+    size_t CompileLocalCount_ = 0;
+    std::vector<LocalSlot> CompileSlots_;
+    std::vector<LocalVariable*> CompileVisibleLocals_;
+    int CompileEnumeratorIdStart_ = 0;
+    std::optional<std::string> CompileUnsupportedReason_;
 };
 
 } // namespace DMCompiler
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <cstdint>
+#include "Token.h"
+#include "DMCompiler.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// Cached result of the DMStandard front end: the preprocessed token stream of
+/// _Standard.dm, the numeric constants read from Defines.dm, and any pragmas or
+/// resource directories the standard library set while being preprocessed.
+///
+/// A snapshot is stamped with the size and modification time of every file in
+/// the DMStandard directory and with the command-line defines (DM_VERSION among
+/// them), so editing the library, defining something else, or upgrading the
+/// lexer invalidates it without having to read the sources. It ends with a checksum
+/// of the rest, and a damaged snapshot is rejected and rebuilt like a stale one.
+/// </summary>
+struct DMStandardSnapshot {
+    std::vector<Token> Tokens;
+    std::vector<std::pair<std::string, int>> Constants;
+    std::vector<std::pair<WarningCode, ErrorLevel>> Pragmas;
+    std::vector<std::string> ResourceDirectories;
+    uint64_t SourcesStamp = 0;  // StampSources() it was built under, for a copy kept in memory
+
+    /// Load a snapshot, rejecting it if the DMStandard directory changed since it
+    /// was written or it was built under other defines
+    /// @return false if the file is missing, corrupt, or stale
+    bool Load(const std::string& path, const std::string& standardDir,
+              const std::unordered_map<std::string, std::string>& defines);
+
+    /// Write the snapshot, stamped with the current state of the DMStandard directory and the defines
+    bool Save(const std::string& path, const std::string& standardDir,
+              const std::unordered_map<std::string, std::string>& defines) const;
+
+    /// Hash of the path, size and modification time of every DM source in the
+    /// DMStandard directory and of the defines, which changes when a snapshot
+    /// would go stale
+    static uint64_t StampSources(const std::string& standardDir,
+                                 const std::unordered_map<std::string, std::string>& defines);
+};
+
+} // namespace DMCompiler
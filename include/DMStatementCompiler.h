@@ -3,6 +3,8 @@
 #include "DMASTStatement.h"
 #include "BytecodeWriter.h"
 #include "DMExpressionCompiler.h"
+#include <functional>
+#include <optional>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -65,6 +67,35 @@ private:
     std::string NewLabel();
     void EmitLabel(const std::string& label);
     
+    // ===== Dead Branch Elimination =====
+    // Truth of a condition known at compile time; nullopt if it is only known
+    // at runtime or optimizations are off
+    std::optional<bool> ConstantCondition(DMASTExpression* condition);
+    // The body a switch on a constant always runs (nullptr if none); nullopt
+    // if any case up to the matching one is only known at runtime
+    std::optional<DMASTProcBlockInner*> ConstantSwitchTarget(DMASTProcStatementSwitch* stmt);
+    // Run compile against a scratch writer and drop what it emits, so code that
+    // never runs still reports the errors and warnings it would with --no-opts
+    bool CompileDiscarded(const std::function<bool()>& compile);
+    
+    // ===== Switch Dispatch =====
+    // A numeric case test: the value Low, or the range Low to High
+    struct SwitchCaseTest {
+        float Low;
+        float High;
+        bool IsRange;
+        int LabelId;
+    };
+    // A case value the compiler can test in place, or nullopt
+    std::optional<float> ConstantNumber(DMASTExpression* expr);
+    // Sort tests by value and merge the overlapping ones of a case; false if
+    // tests of different cases overlap, so a search could change which one wins
+    static bool OrderSwitchTests(std::vector<SwitchCaseTest>& tests);
+    void EmitSwitchTest(const SwitchCaseTest& test);
+    // Emit tests[begin, end) as a binary search, falling through when none match
+    void EmitSwitchSearch(const std::vector<SwitchCaseTest>& tests, size_t begin, size_t end,
+                          const std::string& noMatchLabel);
+    
     // ===== Jump Emission =====
     void EmitJump(const std::string& label);
     void EmitJumpIfFalse(const std::string& label);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "JsonWriter.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace DMCompiler {
+
+class DMCompiler;
+class DMObjectTree;
+
+/// One var a type writes in its output "Variables": IDs into a DMVariableStore's
+/// names and values
+struct DMVariableDefault {
+    uint32_t Name;
+    uint32_t Value;
+};
+
+/// <summary>
+/// Compact copy of the var defaults every type writes to the output.
+///
+/// Thousands of subtypes set the same vars (icon, name, desc) to the same
+/// constants, each through its own DMVariable and AST node. Here each var name
+/// is kept once, each distinct default value is kept once in a shared pool,
+/// and a type's vars are two IDs apiece in one flat array, in the order
+/// OutputJson writes them: the type's own vars by name, then its overrides of
+/// inherited ones by name. A default with no JSON representation is pooled
+/// as null, as that is what gets written for it.
+/// </summary>
+class DMVariableStore {
+public:
+    /// The vars of one type, as a range over the flat array
+    struct TypeDefaults {
+        const DMVariableDefault* Begin;
+        const DMVariableDefault* End;
+
+        const DMVariableDefault* begin() const { return Begin; }
+        const DMVariableDefault* end() const { return End; }
+        bool empty() const { return Begin == End; }
+        size_t size() const { return static_cast<size_t>(End - Begin); }
+    };
+
+    /// Fill the store from every type in objectTree, evaluating each default
+    /// once into constants, which has to outlive the store. Resource IDs have
+    /// to be settled, as a resource default refers to one.
+    void Build(DMCompiler* compiler, JsonConstants& constants, const DMObjectTree& objectTree);
+
+    /// The vars of the type with this ID, empty for a type outside the store
+    TypeDefaults GetDefaults(int typeId) const;
+
+    const std::string& GetName(uint32_t id) const { return Names_[id]; }
+    const JsonValue& GetValue(uint32_t id) const { return Values_[id]; }
+    size_t NameCount() const { return Names_.size(); }
+    size_t ValueCount() const { return Values_.size(); }
+
+private:
+    uint32_t InternName(const std::string& name);
+    uint32_t PoolValue(JsonValue value);
+
+    /// Names by ID; a deque, so the views NameIds_ keys on stay put
+    std::deque<std::string> Names_;
+    std::unordered_map<std::string_view, uint32_t> NameIds_;
+
+    /// Distinct default values by ID, and the ID of each by its ValueKey()
+    std::vector<JsonValue> Values_;
+    std::unordered_map<std::string, uint32_t> ValueIds_;
+
+    /// Every type's vars back to back in type ID order, and where each type's
+    /// start (one more entry than there are types)
+    std::vector<DMVariableDefault> Defaults_;
+    std::vector<uint32_t> TypeStarts_;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+
+namespace DMCompiler {
+
+class DreamPath;
+class Location;
+
+/// <summary>
+/// What each source file brings into a compile and takes from the others,
+/// collected when enabled (--dependency-graph) and written as [name].deps.json.
+///
+/// DMPreprocessor records the files each one includes, the macros it defines
+/// or undefines and the macros expanded while it is read; DMCodeTreeBuilder
+/// records the types a file defines vars in and the procs it defines. Files are
+/// keyed by absolute path. Files read from a DMStandard snapshot are not
+/// preprocessed, so they only show what they declare. Tells which files a
+/// changed macro or type reaches; the proc cache (--proc-cache) is what skips
+/// the work when they are compiled again.
+/// </summary>
+struct DependencyGraph {
+    struct File {
+        std::set<std::string> Includes;
+        std::set<std::string> MacrosDefined;  // #define and #undef
+        std::set<std::string> MacrosUsed;     // Expanded while this file was read
+        std::set<std::string> Types;          // Types given a definition, var or override here
+        std::set<std::string> Procs;          // Procs defined here, as /type/proc/name
+    };
+
+    std::map<std::string, File> Files;
+
+    /// File a declaration is in (nullptr for internal locations)
+    File* At(const Location& location);
+
+    void AddType(const Location& location, const DreamPath& type);
+    void AddProc(const Location& location, const DreamPath& owner, const std::string& name, bool isVerb);
+
+    /// Write every file's entry, and for each macro the files defining and using it
+    bool WriteJson(const std::string& path) const;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "DMDisassembler.h"
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Keeps a compiled output loaded and answers queries on it for as long as it
+/// runs (dmdisasm [file] serve), so tools asking after every compile do not
+/// pay for loading it each time.
+///
+/// Requests and replies are one JSON object per line:
+///   {"id": 1, "method": "Search", "params": {"query": "Login"}}
+///   {"id": 1, "result": ["/mob/Login"]}
+/// A request that fails gets "error", a message, in place of "result"; id is
+/// echoed as given. Methods are Search, SearchStrings, GetType, GetProc,
+/// DecompileProc, Stats and Reload, their params named as in DMDisassembler.
+///
+/// Before each request the file's size and write time are compared with what
+/// was loaded, and it is loaded again if either changed. A binary output
+/// loads only its tables, bytecode being read as procs are asked for, so this
+/// costs little after a compile. A load that fails keeps the last good one.
+/// </summary>
+class DisasmServer {
+public:
+    explicit DisasmServer(std::string path);
+
+    /// Load the file the first time
+    /// @return false if it does not load
+    bool Load();
+
+    /// Answer one request line
+    /// @return The reply line, without its newline
+    std::string Handle(const std::string& request);
+
+    /// Answer requests read from in until it ends, for a tool that runs the
+    /// server as a child process
+    void Serve(std::istream& in, std::ostream& out);
+
+    /// Answer requests from clients of a local (Unix domain) socket until the
+    /// process is stopped, each client on its own thread
+    /// @param socketPath Where to create the socket; a stale one is replaced
+    /// @return false if the socket cannot be set up
+    bool Listen(const std::string& socketPath);
+
+private:
+    std::string Path_;
+    std::unique_ptr<DMDisassembler> Disassembler_;
+    std::filesystem::file_time_type LoadedTime_;
+    std::uintmax_t LoadedSize_ = 0;
+    std::mutex Mutex_;  // Held per request; the disassembler reads bytecode lazily
+
+    /// Load the file again if it changed since it was last loaded, or always if forced
+    /// @return false if the file changed and could not be loaded
+    bool ReloadIfChanged(bool force);
+};
+
+} // namespace DMCompiler
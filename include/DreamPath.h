@@ -1,5 +1,6 @@
 #pragma once
 
+#include <functional>
 #include <string>
 #include <vector>
 #include <memory>
@@ -8,6 +9,12 @@ namespace DMCompiler {
 
 /// <summary>
 /// Represents a path in the DM object tree (e.g., /obj/item/weapon)
+///
+/// Element lists are interned: every distinct list is one node of a trie
+/// shared by the whole process, and a path is its type plus a pointer to
+/// that node. Copying, hashing and comparing paths and taking a parent are
+/// O(1) and never allocate; IsDescendantOf() walks parent pointers. Nodes
+/// are never freed, and several threads can make paths at once.
 /// </summary>
 class DreamPath {
 public:
@@ -22,9 +29,14 @@ public:
     DreamPath(PathType type, const std::vector<std::string>& elements);
 
     PathType GetPathType() const { return Type_; }
-    const std::vector<std::string>& GetElements() const { return Elements_; }
+    const std::vector<std::string>& GetElements() const;
     std::string ToString() const;
     
+    /// Hash of the type and node, for unordered containers
+    std::size_t Hash() const {
+        return std::hash<const void*>{}(Node_) ^ static_cast<std::size_t>(Type_);
+    }
+    
     // Path operations
     DreamPath Combine(const DreamPath& other) const;
     DreamPath AddToPath(const std::string& element) const;
@@ -32,7 +44,7 @@ public:
     std::string GetLastElement() const;
     
     bool IsDescendantOf(const DreamPath& ancestor) const;
-    bool operator==(const DreamPath& other) const;
+    bool operator==(const DreamPath& other) const { return Type_ == other.Type_ && Node_ == other.Node_; }
     bool operator!=(const DreamPath& other) const { return !(*this == other); }
     
     // Special paths
@@ -47,10 +59,29 @@ public:
     static DreamPath List;
 
 private:
+    struct Node;  // One interned element list (see DreamPath.cpp)
+    struct Trie;  // Every node, and the lock the nodes' child maps share
+    
     PathType Type_;
-    std::vector<std::string> Elements_;
+    const Node* Node_;
+    
+    static DreamPath FromNode(PathType type, const Node* node) {
+        DreamPath path;
+        path.Type_ = type;
+        path.Node_ = node;
+        return path;
+    }
     
     void ParseFromString(const std::string& pathString);
+    
+    /// The trie, made on first use so static paths anywhere can be made
+    static Trie& GetTrie();
+    
+    /// The node of no elements
+    static const Node* RootNode();
+    
+    /// The node of parent's elements followed by element, made if it is new
+    static const Node* Child(const Node* parent, const std::string& element);
 };
 
 /// <summary>
@@ -58,8 +89,7 @@ private:
 /// </summary>
 struct DreamPathHash {
     std::size_t operator()(const DreamPath& path) const {
-        // Simple hash based on string representation
-        return std::hash<std::string>{}(path.ToString());
+        return path.Hash();
     }
 };
 
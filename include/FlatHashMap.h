@@ -0,0 +1,219 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Hash map from strings to Value with open addressing, for the symbol tables
+/// the compiler looks names up in (macros, builtins, global procs).
+///
+/// Entries sit back to back in one vector, in the order they were added
+/// (an erase moves the last entry into the hole), and a power-of-two table of
+/// (entry index, hash) pairs is probed linearly to find them. Lookups take a
+/// std::string_view, so a token's text or a literal is never copied into a
+/// std::string just to search.
+///
+/// Unlike std::unordered_map, adding or erasing an entry may move the others:
+/// iterators, pointers and references into the map are only good until the
+/// next insert or erase. Keep a pointer to what a Value owns, not to the Value.
+/// </summary>
+template <typename Value>
+class FlatHashMap {
+public:
+    using key_type = std::string;
+    using mapped_type = Value;
+    using value_type = std::pair<std::string, Value>;
+    using iterator = typename std::vector<value_type>::iterator;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+
+    iterator begin() { return Entries_.begin(); }
+    iterator end() { return Entries_.end(); }
+    const_iterator begin() const { return Entries_.begin(); }
+    const_iterator end() const { return Entries_.end(); }
+    size_t size() const { return Entries_.size(); }
+    bool empty() const { return Entries_.empty(); }
+
+    void clear() {
+        Entries_.clear();
+        Buckets_.clear();
+    }
+
+    void reserve(size_t count) {
+        Entries_.reserve(count);
+        if (count * 4 > Buckets_.size() * 3) {
+            Rehash(BucketCountFor(count));
+        }
+    }
+
+    iterator find(std::string_view key) {
+        size_t bucket = FindBucket(key, Hash(key));
+        return bucket == NotFound ? end() : begin() + Buckets_[bucket].Entry;
+    }
+
+    const_iterator find(std::string_view key) const {
+        size_t bucket = FindBucket(key, Hash(key));
+        return bucket == NotFound ? end() : begin() + Buckets_[bucket].Entry;
+    }
+
+    size_t count(std::string_view key) const { return find(key) != end() ? 1 : 0; }
+    bool contains(std::string_view key) const { return find(key) != end(); }
+
+    Value& at(std::string_view key) {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at: no entry for " + std::string(key));
+        }
+        return it->second;
+    }
+
+    const Value& at(std::string_view key) const {
+        auto it = find(key);
+        if (it == end()) {
+            throw std::out_of_range("FlatHashMap::at: no entry for " + std::string(key));
+        }
+        return it->second;
+    }
+
+    Value& operator[](std::string_view key) { return try_emplace(key).first->second; }
+
+    /// Add key with a Value built from args, unless key is already there
+    /// @return The entry for key, and whether it was added
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(std::string_view key, Args&&... args) {
+        uint32_t hash = Hash(key);
+        size_t bucket = FindBucket(key, hash);
+        if (bucket != NotFound) {
+            return {begin() + Buckets_[bucket].Entry, false};
+        }
+        if ((Entries_.size() + 1) * 4 > Buckets_.size() * 3) {
+            Rehash(BucketCountFor(Entries_.size() + 1));
+        }
+        uint32_t entry = static_cast<uint32_t>(Entries_.size());
+        Entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::forward<Args>(args)...));
+        Buckets_[FreeBucket(hash)] = {entry, hash};
+        return {begin() + entry, true};
+    }
+
+    template <typename V>
+    std::pair<iterator, bool> emplace(std::string_view key, V&& value) {
+        return try_emplace(key, std::forward<V>(value));
+    }
+
+    std::pair<iterator, bool> insert(value_type entry) {
+        return try_emplace(entry.first, std::move(entry.second));
+    }
+
+    /// @return 1 if key was there, 0 if not
+    size_t erase(std::string_view key) {
+        size_t bucket = FindBucket(key, Hash(key));
+        if (bucket == NotFound) {
+            return 0;
+        }
+        uint32_t entry = Buckets_[bucket].Entry;
+        RemoveBucket(bucket);
+
+        // Fill the hole with the last entry, and point its bucket there
+        uint32_t last = static_cast<uint32_t>(Entries_.size() - 1);
+        if (entry != last) {
+            Entries_[entry] = std::move(Entries_[last]);
+            size_t mask = Buckets_.size() - 1;
+            for (size_t i = Hash(Entries_[entry].first) & mask;; i = (i + 1) & mask) {
+                if (Buckets_[i].Entry == last) {
+                    Buckets_[i].Entry = entry;
+                    break;
+                }
+            }
+        }
+        Entries_.pop_back();
+        return 1;
+    }
+
+private:
+    struct Bucket {
+        uint32_t Entry = EmptyBucket;
+        uint32_t Hash = 0;
+    };
+
+    static constexpr uint32_t EmptyBucket = std::numeric_limits<uint32_t>::max();
+    static constexpr size_t NotFound = std::numeric_limits<size_t>::max();
+
+    std::vector<value_type> Entries_;
+    std::vector<Bucket> Buckets_;  // Empty until the first insert, then a power of two
+
+    static uint32_t Hash(std::string_view key) {
+        size_t hash = std::hash<std::string_view>{}(key);
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+
+    /// Smallest power of two that holds count entries at most 3/4 full
+    static size_t BucketCountFor(size_t count) {
+        size_t buckets = 8;
+        while (count * 4 > buckets * 3) {
+            buckets *= 2;
+        }
+        return buckets;
+    }
+
+    size_t FindBucket(std::string_view key, uint32_t hash) const {
+        if (Buckets_.empty()) {
+            return NotFound;
+        }
+        size_t mask = Buckets_.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            const Bucket& bucket = Buckets_[i];
+            if (bucket.Entry == EmptyBucket) {
+                return NotFound;
+            }
+            if (bucket.Hash == hash && Entries_[bucket.Entry].first == key) {
+                return i;
+            }
+        }
+    }
+
+    size_t FreeBucket(uint32_t hash) const {
+        size_t mask = Buckets_.size() - 1;
+        size_t i = hash & mask;
+        while (Buckets_[i].Entry != EmptyBucket) {
+            i = (i + 1) & mask;
+        }
+        return i;
+    }
+
+    /// Empty a bucket, moving later buckets of the same probe run back so
+    /// none of them ends up past an empty one
+    void RemoveBucket(size_t bucket) {
+        size_t mask = Buckets_.size() - 1;
+        size_t hole = bucket;
+        for (size_t i = (hole + 1) & mask; Buckets_[i].Entry != EmptyBucket; i = (i + 1) & mask) {
+            size_t home = Buckets_[i].Hash & mask;
+            // Move it back unless its home lies after the hole, up to where it sits
+            bool staysPut = hole <= i ? (hole < home && home <= i) : (hole < home || home <= i);
+            if (!staysPut) {
+                Buckets_[hole] = Buckets_[i];
+                hole = i;
+            }
+        }
+        Buckets_[hole] = Bucket{};
+    }
+
+    void Rehash(size_t bucketCount) {
+        Buckets_.assign(bucketCount, Bucket{});
+        for (uint32_t entry = 0; entry < Entries_.size(); ++entry) {
+            uint32_t hash = Hash(Entries_[entry].first);
+            Buckets_[FreeBucket(hash)] = {entry, hash};
+        }
+    }
+};
+
+} // namespace DMCompiler
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "ConcurrentStringInterner.h"
+#include <map>
+#include <mutex>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <ostream>
+#include <utility>
 #include <vector>
 #include <unordered_map>
 #include <cstdint>
@@ -15,21 +20,73 @@ struct ResourceRef {
     explicit ResourceRef(int id) : id(id) {}
 };
 
-// JsonValue type for representing JSON values from expressions
+// Interned string constant (JsonConstants::String): equal strings share an
+// ID, and Text stays valid for as long as the pool it came from
+struct JsonString {
+    uint32_t Id;
+    const std::string* Text;
+};
+
+// Pooled constant object of string keys and values (JsonConstants::Object),
+// such as {"type": "PositiveInfinity"}; equal objects share an ID
+struct JsonObject {
+    uint32_t Id;
+    const std::vector<std::pair<std::string, std::string>>* Entries;  // By key
+};
+
+// JsonValue type for representing JSON values from expressions. Strings and
+// objects are handles into JsonConstants, so values copy and compare cheaply
 using JsonValue = std::variant<
     std::nullptr_t,
     bool,
     int64_t,
     double,
-    std::string,
-    std::unordered_map<std::string, std::string>,
+    JsonString,
+    JsonObject,
     ResourceRef
 >;
 
-/// Simple JSON writer helper for serializing compiler output
+/// <summary>
+/// Pool behind JsonValue's strings and objects. The var defaults of thousands
+/// of types repeat a few hundred constants, so each is stored once and
+/// evaluating, pooling and writing a default passes its handle around rather
+/// than copying text. Each DMCompiler owns the pool of its compile, so a
+/// process compiling many times (--server, --batch) frees each compile's
+/// constants with it. Safe on several threads.
+/// </summary>
+class JsonConstants {
+public:
+    JsonConstants() = default;
+    JsonConstants(const JsonConstants&) = delete;
+    JsonConstants& operator=(const JsonConstants&) = delete;
+
+    /// Intern a string, copying it only if it is new
+    JsonString String(std::string_view text);
+
+    /// Pool an object; entries may come in any order
+    JsonObject Object(std::vector<std::pair<std::string, std::string>> entries);
+
+    /// Distinct strings and objects pooled so far
+    size_t StringCount() const { return Strings_.Size(); }
+    size_t ObjectCount() const;
+
+private:
+    ConcurrentStringInterner Strings_;
+    mutable std::mutex ObjectsMutex_;
+    std::map<std::vector<std::pair<std::string, std::string>>, uint32_t> ObjectIds_;  // A map never moves its keys, which handles point at
+};
+
+/// Simple JSON writer helper for serializing compiler output.
+///
+/// Output collects in a string; given a stream, the writer hands that on
+/// every FlushThreshold bytes, so a large output is never held in memory
+/// whole. Without one, ToString() gives everything written.
 class JsonWriter {
 public:
-    JsonWriter() : indent_(0) {}
+    static constexpr size_t FlushThreshold = 1 << 20;
+
+    JsonWriter() = default;
+    explicit JsonWriter(std::ostream& out) : out_(&out) { buffer_.reserve(FlushThreshold * 2); }
     
     void BeginObject();
     void EndObject();
@@ -51,16 +108,40 @@ public:
     
     void WriteByteArray(const std::vector<uint8_t>& bytes);
     
-    std::string ToString() const { return ss_.str(); }
+    /// Hand what is buffered to the stream, if there is one
+    /// @return False if the stream failed at any point
+    bool Flush();
+
+    /// Everything written, for a writer without a stream
+    std::string ToString() const { return buffer_; }
+    std::string TakeString() { return std::move(buffer_); }
+
+    /// A writer without a stream for elements of the array or object this one
+    /// is in, indented to match; what it writes goes in with WriteFragment()
+    /// @param depth Levels further in the elements go, for one not begun yet
+    JsonWriter Fragment(int depth = 0) const {
+        JsonWriter fragment;
+        fragment.indent_ = indent_ + depth;
+        return fragment;
+    }
+
+    /// Write the elements a Fragment() writer wrote, as if written here
+    void WriteFragment(const std::string& fragment);
     
 private:
-    std::stringstream ss_;
-    int indent_;
+    std::string buffer_;
+    std::ostream* out_ = nullptr;
+    int indent_ = 0;
     bool needsComma_ = false;
     
     void WriteIndent();
     void WriteComma();
-    std::string EscapeString(const std::string& str);
+    void WriteEscaped(const std::string& str);
+    void FlushIfFull() {
+        if (out_ != nullptr && buffer_.size() >= FlushThreshold) {
+            Flush();
+        }
+    }
 };
 
 } // namespace DMCompiler
\ No newline at end of file
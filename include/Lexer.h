@@ -4,6 +4,7 @@
 #include <queue>
 #include <memory>
 #include <string>
+#include <string_view>
 #include "Token.h"
 #include "Location.h"
 
@@ -17,13 +18,25 @@ class Lexer {
 protected:
     Location CurrentLocation_;
     Location PreviousLocation_;
-    std::vector<TSourceType> Source_;
+    std::vector<TSourceType> OwnedSource_;  // Backing storage when the lexer was given a copy
+    std::basic_string_view<TSourceType> Source_;  // Bytes being scanned (owned or a non-owning view)
     size_t CurrentIndex_;
     bool AtEndOfSource_;
     std::queue<Token> PendingTokenQueue_;
 
 public:
     Lexer(const std::string& sourceName, const std::vector<TSourceType>& source)
+        : CurrentLocation_(sourceName, 1, 0)
+        , PreviousLocation_(CurrentLocation_)
+        , OwnedSource_(source)
+        , Source_(OwnedSource_.data(), OwnedSource_.size())
+        , CurrentIndex_(0)
+        , AtEndOfSource_(false)
+    {
+    }
+
+    /// Scan a caller-owned buffer in place; the buffer must outlive the lexer
+    Lexer(const std::string& sourceName, std::basic_string_view<TSourceType> source)
         : CurrentLocation_(sourceName, 1, 0)
         , PreviousLocation_(CurrentLocation_)
         , Source_(source)
@@ -34,6 +47,10 @@ public:
 
     virtual ~Lexer() = default;
 
+    // Source_ may point into OwnedSource_, so copying would leave a dangling view
+    Lexer(const Lexer&) = delete;
+    Lexer& operator=(const Lexer&) = delete;
+
     Token GetNextToken() {
         if (!PendingTokenQueue_.empty()) {
             Token token = PendingTokenQueue_.front();
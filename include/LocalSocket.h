@@ -0,0 +1,32 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Line-based requests over a local (Unix domain) socket, shared by the
+/// resident servers (dmdisasm serve, dmcompiler --server) and their clients.
+/// A request and its reply are each one line; a client may send several on
+/// one connection.
+/// </summary>
+class LocalSocket {
+public:
+    using Handler = std::function<std::string(const std::string& request)>;
+
+    /// Answer the requests of every client until the process is stopped, each
+    /// client on its own thread; the handler is called for each non-empty
+    /// line and its result sent back with a newline
+    /// @param socketPath Where to create the socket; a stale one is replaced
+    /// @return false if the socket cannot be set up
+    static bool Serve(const std::string& socketPath, const Handler& handler);
+
+    /// Send one request line and wait for its reply line
+    /// @param reply Set to the reply, without its newline
+    /// @param error Set to why no reply came
+    static bool Request(const std::string& socketPath, const std::string& request, std::string& reply,
+                        std::string& error);
+};
+
+} // namespace DMCompiler
@@ -1,28 +1,54 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 namespace DMCompiler {
 
+/// <summary>
+/// Process-wide table of source file paths. Locations refer to files by index
+/// so that tokens, AST nodes and diagnostics don't each own a copy of the path.
+/// Index 0 is the unnamed file and index 1 is "internal".
+/// </summary>
+class SourceFileRegistry {
+public:
+    static constexpr uint32_t UnknownFileId = 0;
+    static constexpr uint32_t InternalFileId = 1;
+
+    /// Get the index of a path, registering it on first use (thread-safe)
+    static uint32_t Register(std::string_view path);
+
+    /// Look up the path of a registered index
+    static const std::string& GetPath(uint32_t fileId);
+
+    /// Number of registered files (including the two reserved entries)
+    static size_t Count();
+};
+
 /// <summary>
 /// Represents a location in source code (file, line, column)
 /// </summary>
 class Location {
 public:
-    std::string SourceFile;
+    uint32_t FileId;
     int Line;
     int Column;
     bool InDMStandard; // True if this location is within DMStandard files
 
-    Location() : Line(0), Column(0), InDMStandard(false) {}
+    Location() : FileId(SourceFileRegistry::UnknownFileId), Line(0), Column(0), InDMStandard(false) {}
     Location(const std::string& sourceFile, int line, int column, bool inDMStandard = false)
-        : SourceFile(sourceFile), Line(line), Column(column), InDMStandard(inDMStandard) {}
+        : FileId(SourceFileRegistry::Register(sourceFile)), Line(line), Column(column), InDMStandard(inDMStandard) {}
+    Location(uint32_t fileId, int line, int column, bool inDMStandard = false)
+        : FileId(fileId), Line(line), Column(column), InDMStandard(inDMStandard) {}
 
     static Location Internal;
 
+    /// Path of the source file (looked up in the registry)
+    const std::string& SourceFile() const { return SourceFileRegistry::GetPath(FileId); }
+
     std::string ToString() const;
-    bool IsInternal() const { return SourceFile == "internal"; }
+    bool IsInternal() const { return FileId == SourceFileRegistry::InternalFileId; }
 };
 
 } // namespace DMCompiler
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DreamPath.h"
+
+namespace DMCompiler {
+
+struct DreamMapJson;
+class DMObjectTree;
+
+/// <summary>
+/// On-disk cache of maps read by DMMScanner, so an unchanged .dmm is not
+/// scanned again on the next build.
+///
+/// Entries are named by a 64-bit hash of the map's path and contents. A
+/// scanned map holds type IDs, and which objects went where depends on the
+/// type tree, so an entry also keeps a fingerprint of that: every type path
+/// the map names, with the ID and kind (turf, area, other or missing) it
+/// resolved to. Load() checks each of them against the current tree, and
+/// misses if any resolves differently. The scanner's warnings are stored as
+/// well, to be reported on a hit just as a scan would. Each entry ends with a
+/// checksum of the rest, and one that does not match is a miss.
+///
+/// Maps are stored as scanned, from z = 0. DMMScanner skips var overrides,
+/// so entries have none; a map with any is not stored.
+/// </summary>
+class MapCache {
+public:
+    /// @param directory Where entries are kept (created if missing)
+    explicit MapCache(std::string directory);
+
+    /// FNV-1a hash of a map file's path and contents
+    static uint64_t HashMap(const std::string& mapPath, std::string_view content);
+
+    /// Get the cached map, or nullptr on a miss
+    /// @param warnings Set to the warnings the scan reported
+    std::unique_ptr<DreamMapJson> Load(uint64_t hash, DMObjectTree& tree, std::vector<std::string>& warnings) const;
+
+    /// Save a scanned map (best effort; failures are ignored)
+    /// @param referencedTypes DMMScanner::GetReferencedTypes()
+    void Store(uint64_t hash, const DreamMapJson& map, const std::vector<DreamPath>& referencedTypes,
+               const std::vector<std::string>& warnings, DMObjectTree& tree) const;
+
+    const std::string& GetDirectory() const { return Directory_; }
+
+private:
+    std::string EntryPath(uint64_t hash) const;
+
+    std::string Directory_;
+};
+
+} // namespace DMCompiler
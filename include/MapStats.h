@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace DMCompiler {
+
+struct DreamMapJson;
+class DMObjectTree;
+
+/// <summary>
+/// Size and density figures for each map, collected when statistics are
+/// enabled (--map-stats) to size the runtime's memory without running it.
+///
+/// Add() reads a map as ConvertMaps() hands it over, so nothing is kept but
+/// the counts. Tiles are grid positions; a key's definition is counted once
+/// for every tile that names it. Objects are what a tile holds besides its
+/// turf and area. Report() prints a summary of each map and WriteJson()
+/// writes every figure, with the whole type table, as [name].mapstats.json.
+/// </summary>
+struct MapStats {
+    /// Buckets of the objects-per-tile histogram; the last counts that many or more
+    static constexpr size_t HistogramSize = 16;
+
+    struct Map {
+        std::string Path;
+        int MaxX = 0;
+        int MaxY = 0;
+        int MaxZ = 0;
+        uint64_t Blocks = 0;
+        uint64_t Keys = 0;            // Distinct keys, defined or not
+        uint64_t DefinedKeys = 0;
+        uint64_t DistinctCells = 0;   // Definitions with distinct turf, area and object types
+        uint64_t Tiles = 0;
+        uint64_t UndefinedTiles = 0;  // Tiles naming a key with no definition
+        uint64_t Objects = 0;
+        uint64_t Overrides = 0;       // Var overrides over all tiles
+        uint64_t KeyOverrides = 0;    // Var overrides over all definitions
+        std::vector<uint64_t> ObjectsPerTile = std::vector<uint64_t>(HistogramSize, 0);
+        std::unordered_map<int, uint64_t> TypeTiles;  // Type ID -> tiles placing it (turfs and areas too)
+    };
+
+    std::vector<Map> Maps;
+
+    /// Count a converted map
+    void Add(const std::string& path, const DreamMapJson& map);
+
+    /// Print a summary of each map with its most frequent types
+    /// @param out Stream to write to
+    /// @param topCount Types to show per map
+    void Report(std::ostream& out, const DMObjectTree& tree, size_t topCount = 10) const;
+
+    /// Write every figure as JSON
+    bool WriteJson(const std::string& path, const DMObjectTree& tree) const;
+};
+
+} // namespace DMCompiler
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include "DreamProcOpcode.h"
 
@@ -28,8 +29,26 @@ enum class OpcodeArgType {
     Float
 };
 
+/// Bytes an operand takes in OperandEncoding::Fixed, or 0 for a reference,
+/// which is sized by its type byte
+constexpr size_t FixedOperandSize(OpcodeArgType type) {
+    switch (type) {
+        case OpcodeArgType::None:
+        case OpcodeArgType::Reference:
+            return 0;
+        case OpcodeArgType::ArgType:
+            return 1;
+        default:
+            return 4;
+    }
+}
+
 /// <summary>
 /// Metadata about each opcode
+///
+/// The operand kinds are the one description of an instruction's layout;
+/// the other fields are worked out from them, so decoders need no per-opcode
+/// logic of their own.
 /// </summary>
 struct OpcodeMetadata {
     int StackDelta;  // Change in stack size (-1 for pops, +1 for pushes, etc.)
@@ -37,28 +56,50 @@ struct OpcodeMetadata {
     OpcodeArgType ArgType2;
     OpcodeArgType ArgType3;
     OpcodeArgType ArgType4;
+    bool Known;            // Listed in the table, rather than the empty entry unlisted opcodes get
+    bool HasLabel;         // Holds a jump offset
+    bool HasReference;     // Has an operand sized by its type byte
+    uint8_t OperandCount;
+    uint8_t FixedLength;   // Opcode byte and operands in OperandEncoding::Fixed, references not counted
 
-    OpcodeMetadata()
+    constexpr OpcodeMetadata()
         : StackDelta(0)
         , ArgType1(OpcodeArgType::None)
         , ArgType2(OpcodeArgType::None)
         , ArgType3(OpcodeArgType::None)
         , ArgType4(OpcodeArgType::None)
+        , Known(false)
+        , HasLabel(false)
+        , HasReference(false)
+        , OperandCount(0)
+        , FixedLength(1)
     {}
 
-    OpcodeMetadata(int delta, OpcodeArgType arg1 = OpcodeArgType::None,
-                   OpcodeArgType arg2 = OpcodeArgType::None,
-                   OpcodeArgType arg3 = OpcodeArgType::None,
-                   OpcodeArgType arg4 = OpcodeArgType::None)
+    constexpr OpcodeMetadata(int delta, OpcodeArgType arg1 = OpcodeArgType::None,
+                             OpcodeArgType arg2 = OpcodeArgType::None,
+                             OpcodeArgType arg3 = OpcodeArgType::None,
+                             OpcodeArgType arg4 = OpcodeArgType::None)
         : StackDelta(delta)
         , ArgType1(arg1)
         , ArgType2(arg2)
         , ArgType3(arg3)
         , ArgType4(arg4)
+        , Known(true)
+        , HasLabel(arg1 == OpcodeArgType::Label || arg2 == OpcodeArgType::Label ||
+                   arg3 == OpcodeArgType::Label || arg4 == OpcodeArgType::Label)
+        , HasReference(arg1 == OpcodeArgType::Reference || arg2 == OpcodeArgType::Reference ||
+                       arg3 == OpcodeArgType::Reference || arg4 == OpcodeArgType::Reference)
+        , OperandCount(static_cast<uint8_t>((arg1 != OpcodeArgType::None) + (arg2 != OpcodeArgType::None) +
+                                            (arg3 != OpcodeArgType::None) + (arg4 != OpcodeArgType::None)))
+        , FixedLength(static_cast<uint8_t>(1 + FixedOperandSize(arg1) + FixedOperandSize(arg2) +
+                                           FixedOperandSize(arg3) + FixedOperandSize(arg4)))
     {}
 };
 
-// Get metadata for an opcode
+// Get metadata for an opcode, from a table indexed by its byte
 const OpcodeMetadata& GetOpcodeMetadata(DreamProcOpcode opcode);
 
+// True if the table has an entry for the opcode, rather than GetOpcodeMetadata() falling back to an empty one
+bool HasOpcodeMetadata(DreamProcOpcode opcode);
+
 } // namespace DMCompiler
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// The operand bytes of one instruction, such as a reference or an argument
+/// type and count, as the expression compiler builds them before handing
+/// them to BytecodeWriter.
+///
+/// These are a handful of bytes each (a reference is at most 5), so they are
+/// kept inline and only move to the heap past InlineCapacity; building and
+/// copying them never allocates in practice.
+/// </summary>
+class OperandBytes {
+public:
+    static constexpr size_t InlineCapacity = 15;
+
+    OperandBytes() = default;
+
+    OperandBytes(std::initializer_list<uint8_t> bytes) {
+        for (uint8_t byte : bytes) {
+            push_back(byte);
+        }
+    }
+
+    void push_back(uint8_t byte) {
+        if (Size_ < InlineCapacity) {
+            Inline_[Size_++] = byte;
+            return;
+        }
+        if (Size_ == InlineCapacity) {
+            Heap_.assign(Inline_.begin(), Inline_.end());
+        }
+        Heap_.push_back(byte);
+        Size_++;
+    }
+
+    void clear() {
+        Size_ = 0;
+        Heap_.clear();
+    }
+
+    size_t size() const { return Size_; }
+    bool empty() const { return Size_ == 0; }
+
+    const uint8_t* data() const { return Size_ > InlineCapacity ? Heap_.data() : Inline_.data(); }
+    const uint8_t* begin() const { return data(); }
+    const uint8_t* end() const { return data() + Size_; }
+
+    uint8_t operator[](size_t index) const { return data()[index]; }
+    uint8_t front() const { return data()[0]; }
+    uint8_t back() const { return data()[Size_ - 1]; }
+
+    bool operator==(const OperandBytes& other) const {
+        return Size_ == other.Size_ && std::equal(begin(), end(), other.begin());
+    }
+    bool operator!=(const OperandBytes& other) const { return !(*this == other); }
+
+private:
+    std::array<uint8_t, InlineCapacity> Inline_{};
+    size_t Size_ = 0;
+    std::vector<uint8_t> Heap_;  // Every byte, once there are more than InlineCapacity
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ControlFlowGraph.h"
+#include "OpcodeDefinitions.h"
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// How the operands of an instruction are laid out after its opcode byte.
+///
+/// Fixed is what the runtime reads by default: an arguments type is one byte,
+/// a reference is its type byte and whatever that type carries, and every
+/// other operand is a 4-byte little-endian int or float.
+///
+/// Leb128 (--compact-operands) writes IDs and counts (strings, types, procs,
+/// resources, enumerators, filters, stack deltas and list sizes) as unsigned
+/// LEB128 instead, so anything below 128 takes one byte. Labels keep 4 bytes,
+/// so jump offsets can be filled in without moving code again, and floats and
+/// references keep theirs. The output's Metadata.OperandEncoding says which
+/// one a file uses.
+/// </summary>
+enum class OperandEncoding {
+    Fixed,
+    Leb128
+};
+
+/// <summary>
+/// Where one operand sits in an instruction's bytes.
+/// </summary>
+struct OperandSpan {
+    OpcodeArgType Type;
+    size_t Offset;  // From the opcode byte
+    size_t Length;
+};
+
+/// <summary>
+/// An instruction found in a proc's bytes by DecodeInstruction().
+/// </summary>
+struct DecodedInstruction {
+    DreamProcOpcode Opcode = DreamProcOpcode::Error;
+    size_t Length = 0;             // Opcode byte included
+    uint8_t OperandCount = 0;
+    OperandSpan Operands[4] = {};  // The opcode table's operands, in order
+    bool Truncated = false;        // An operand ran past the end; Length stops there and it is left out
+};
+
+/// True for the operands OperandEncoding::Leb128 writes as LEB128
+bool IsCompactOperand(OpcodeArgType type);
+
+/// Bytes a reference takes, type byte included, going by how the writer
+/// writes references of that type
+size_t ReferenceLength(uint8_t type);
+
+/// Bytes the operand starting at offset takes, or nullopt if it runs past
+/// the end of bytes
+std::optional<size_t> OperandLength(OpcodeArgType type, const std::vector<uint8_t>& bytes, size_t offset,
+                                    OperandEncoding encoding);
+
+/// Decode the instruction at offset, sizing its operands from the opcode
+/// table as the writer writes them in encoding. It takes its opcode byte and
+/// at most the rest of bytes, so a loop adding Length always gets to the end.
+/// Opcodes the table does not list decode as the opcode byte alone.
+DecodedInstruction DecodeInstruction(const std::vector<uint8_t>& bytes, size_t offset, OperandEncoding encoding);
+
+/// The number a decoded operand holds: an ID, count or label, a float's
+/// bits, or what follows a reference's type byte
+/// @param offset Where the instruction starts
+uint32_t ReadOperandValue(const std::vector<uint8_t>& bytes, size_t offset, const OperandSpan& operand,
+                          OperandEncoding encoding);
+
+/// Split an instruction written with OperandEncoding::Fixed along the operands
+/// the opcode table lists. A single reference takes whatever the other
+/// operands leave; several are sized from their type bytes.
+/// @return nullopt if the bytes do not add up to what the table lists
+std::optional<std::vector<OperandSpan>> SplitOperands(const BytecodeInstruction& instruction);
+
+void WriteLeb128(std::vector<uint8_t>& bytes, uint32_t value);
+
+/// Read an unsigned LEB128 value of at most 5 bytes, moving offset past it
+std::optional<uint32_t> ReadLeb128(const std::vector<uint8_t>& bytes, size_t& offset);
+
+/// Rewrite an instruction written with OperandEncoding::Fixed in
+/// OperandEncoding::Leb128, moving its JumpOffset along with the operands.
+/// @return False, leaving it as it is, if its bytes do not follow the opcode table
+bool CompactInstruction(BytecodeInstruction& instruction);
+
+} // namespace DMCompiler
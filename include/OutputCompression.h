@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Compression for the compiled output (--compress-output), for shipping it
+/// to many servers. Either output file, JSON or CompiledOutput, is wrapped
+/// whole, so a loader tells a compressed file apart by its magic before it
+/// parses anything.
+///
+/// The input is cut into chunks of ChunkSize bytes, and each chunk is
+/// compressed by itself. That lets the chunks be compressed on several
+/// threads, and lets a reader check each one's size before touching it.
+///
+///   Header  "DMCZ", version, codec, chunk size, original size (low, high),
+///           chunk count
+///   Table   per chunk: its stored size, with StoredChunk set if it did
+///           not compress and is kept as is
+///   Chunks  back to back
+///
+/// Everything is little-endian u32 words. The codec is the LZ4 block format:
+/// each sequence is a token, extra literal length bytes, the literals, a
+/// 16-bit match offset and extra match length bytes.
+/// </summary>
+namespace OutputCompression {
+
+constexpr char Magic[4] = {'D', 'M', 'C', 'Z'};
+constexpr uint32_t Version = 1;
+constexpr uint32_t CodecLz4Block = 1;
+constexpr uint32_t ChunkSize = 1u << 20;
+constexpr uint32_t StoredChunk = 0x80000000u;
+
+/// Whether data starts with the compressed output's magic
+bool IsCompressed(std::string_view data);
+
+/// Compress data into the format above
+/// @param threadCount Threads to compress chunks on (0 = on this one)
+std::string Compress(std::string_view data, unsigned threadCount);
+
+/// Undo Compress()
+/// @return false if data is not in this format or is malformed
+bool Decompress(std::string_view data, std::string& out);
+
+} // namespace OutputCompression
+
+} // namespace DMCompiler
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "DMLexer.h"
+
+namespace DMCompiler {
+
+class TokenCache;
+
+/// <summary>
+/// Raw DMLexer output for source files, produced ahead of preprocessing.
+///
+/// Lexing only depends on a file's bytes, so every file reachable from a root
+/// through quoted #include directives is lexed on a pool of threads before the
+/// (inherently sequential) preprocessor runs. Reachability ignores #if state,
+/// so a few files may be lexed without ever being included; files that are
+/// missed here are simply lexed inline by the preprocessor as before.
+/// </summary>
+class PreLexedFiles {
+public:
+    using TokenArray = std::vector<Token>;
+
+    /// Lex the root file and everything it includes, skipping files already lexed
+    /// @param rootPath Absolute path of the root file
+    /// @param threadCount Number of worker threads (at least 1)
+    /// @param cache Optional on-disk token cache to read from and populate
+    void LexReachable(const std::string& rootPath, unsigned threadCount, const TokenCache* cache = nullptr);
+
+    /// Lex one file to completion (EndOfFile token included), going through the cache if given
+    /// @return The tokens, or nullptr if the file could not be read
+    static std::shared_ptr<TokenArray> LexFile(const std::string& path, const TokenCache* cache);
+
+    /// Get the tokens of a file, or nullptr if it was not pre-lexed
+    std::shared_ptr<const TokenArray> Find(const std::string& absolutePath) const;
+
+    size_t Size() const;
+
+private:
+    mutable std::mutex Mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const TokenArray>> Files_;
+};
+
+/// <summary>
+/// DMLexer that replays a pre-lexed token array instead of scanning source.
+/// </summary>
+class ReplayDMLexer : public DMLexer {
+public:
+    ReplayDMLexer(const std::string& sourceName, std::shared_ptr<const PreLexedFiles::TokenArray> tokens);
+    
+    Token SkipConditionalBlock(int& depth, bool stopAtElse) override;
+
+protected:
+    Token ParseNextToken() override;
+
+private:
+    std::shared_ptr<const PreLexedFiles::TokenArray> Tokens_;
+    size_t Index_ = 0;
+};
+
+} // namespace DMCompiler
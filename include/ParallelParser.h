@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include "DMAST.h"
+#include "TokenBuffer.h"
+
+namespace DMCompiler {
+
+class DMCompiler;
+
+/// <summary>
+/// Parses a buffered preprocessed token stream on several threads.
+///
+/// After preprocessing, every top-level definition starts on a line with no
+/// indentation outside any brackets, braces or string interpolation (in a
+/// buffer run through ResolveIndentation, once its Dedents are closed), and
+/// nothing the parser does carries over from one such definition to the
+/// next. The stream is cut at those lines into chunks of roughly equal size.
+/// Each chunk is parsed into its own DMASTFile, and the fragments are merged
+/// in order into one file that matches a sequential parse.
+///
+/// Parser diagnostics only come from malformed input. Where error recovery
+/// skips tokens depends on what follows, so if any chunk reports a
+/// diagnostic, Parse() returns null and the caller parses sequentially.
+/// </summary>
+class ParallelParser {
+public:
+    ParallelParser(DMCompiler* compiler, const TokenBuffer& tokens);
+
+    /// Find the token indices each chunk starts at (always including begin)
+    /// @param tokens The buffered stream
+    /// @param minChunkTokens Smallest chunk worth giving its own parser
+    /// @param begin Where to start, which has to be a chunk start itself
+    static std::vector<size_t> FindChunkStarts(const TokenBuffer& tokens, size_t minChunkTokens, size_t begin = 0);
+
+    /// Whether a chunk could start at tokens[index], so that what comes before
+    /// it parses on its own
+    static bool IsChunkStart(const TokenBuffer& tokens, size_t index);
+
+    /// Chunks below this many tokens are not worth a parser of their own
+    static constexpr size_t DefaultMinChunkTokens = 4096;
+
+    /// Parse the stream, from a chunk start on, on threadCount threads
+    /// @param minChunkTokens Smallest chunk to split off
+    /// @param begin Where to start parsing, which has to be a chunk start
+    /// @return The merged file, or nullptr if the stream has to be parsed
+    ///         sequentially (it has syntax errors, or is too small to split)
+    std::unique_ptr<DMASTFile> Parse(unsigned threadCount, size_t minChunkTokens = DefaultMinChunkTokens, size_t begin = 0);
+
+    /// Parse the tokens in [begin, end) on their own, as one chunk
+    /// @return The fragment, or nullptr if it reported a diagnostic (which is
+    ///         suppressed) or threw
+    static std::unique_ptr<DMASTFile> ParseChunk(DMCompiler* compiler, const TokenBuffer& tokens, size_t begin, size_t end);
+
+    /// Move the statements of fragments, in order, into one file that also
+    /// takes over their arenas
+    static std::unique_ptr<DMASTFile> Merge(std::vector<std::unique_ptr<DMASTFile>> fragments);
+
+    /// Chunks used by the last Parse()
+    size_t ChunkCount() const { return ChunkCount_; }
+
+private:
+    DMCompiler* Compiler_;
+    const TokenBuffer& Tokens_;
+    size_t ChunkCount_ = 0;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "PointerRange.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace DMCompiler {
+
+class DMCompiler;
+class DMProc;
+
+/// <summary>
+/// Compiles procs on several threads, with the same output as compiling them
+/// one after another in order.
+///
+/// A proc's bytecode only depends on the tree and on the IDs of the strings it
+/// interns, so procs are first compiled speculatively against a frozen string
+/// table. A worker never writes shared state: strings the table does not have
+/// yet are recorded in the order the proc first used them and get a
+/// placeholder ID, diagnostics go to the proc's DiagnosticBuffer, and anything
+/// else (a new resource, a message of the compiler's own) abandons the proc.
+/// The recorded strings are then interned and the diagnostics reported in
+/// proc order, which builds the same table and prints the same output a
+/// sequential build would, and abandoned procs are compiled right there. Procs
+/// that held a placeholder are compiled once more in parallel, now only
+/// looking strings up; not for a check (--check-only), which keeps only the
+/// diagnostics.
+///
+/// Deferred proc bodies are parsed before the workers start. Procs in the
+/// proc cache (--proc-cache) are looked up by the workers and applied in
+/// order, interning their strings where compiling them would have.
+/// </summary>
+class ParallelProcCompiler {
+public:
+    explicit ParallelProcCompiler(DMCompiler* compiler);
+
+    /// Compile procs, in order, on threadCount threads
+    void Compile(PointerRange<DMProc> procs, unsigned threadCount);
+
+    /// True if this thread is compiling a proc speculatively
+    static bool IsSpeculating();
+
+    /// Give up on the proc this thread compiles speculatively, so it is
+    /// compiled again sequentially. Called instead of touching state other
+    /// threads can see.
+    /// @return True if the thread was speculating, in which case the caller
+    ///         must not report anything itself
+    static bool Abandon();
+
+    /// Where compiler code writes messages of its own: std::cerr, or while
+    /// speculating, a stream that drops them after abandoning the proc
+    static std::ostream& ErrorStream();
+
+    /// Stand-in ID for a string the frozen table does not hold, recording its
+    /// first use by the proc being compiled
+    static int RecordNewString(std::string_view value);
+
+    /// Procs the last Compile() compiled again in parallel once their strings
+    /// were interned
+    size_t RecompiledCount() const { return RecompiledCount_; }
+
+    /// Procs the last Compile() abandoned and compiled sequentially
+    size_t AbandonedCount() const { return AbandonedCount_; }
+
+private:
+    DMCompiler* Compiler_;
+    size_t RecompiledCount_ = 0;
+    size_t AbandonedCount_ = 0;
+};
+
+} // namespace DMCompiler
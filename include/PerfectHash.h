@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace DMCompiler {
+
+/// FNV-1a, usable in constant expressions
+constexpr uint32_t HashName(std::string_view name) {
+    uint32_t hash = 2166136261u;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+/// <summary>
+/// Perfect hash over a fixed set of N key hashes, built at compile time.
+///
+/// Keys are split into buckets by hash, and every bucket gets the seed that
+/// sends all of its keys to slots no other key has taken (hash and
+/// displace), so finding a key is one seed load and one slot load with no
+/// probing. Each slot holds the index of the key that owns it, or -1; the
+/// caller still compares that key against the name it was asked for, as any
+/// name hashes to some slot.
+///
+/// Build it with BuildPerfectHash() into a constexpr variable and
+/// static_assert that Complete is set: it is false if two keys share a hash,
+/// which no seed can separate.
+/// </summary>
+template <size_t N>
+struct PerfectHash {
+    /// At most half full, so a seed for each bucket turns up within a few tries
+    static constexpr size_t SlotCount = [] {
+        size_t slots = 2;
+        while (slots < N * 2) {
+            slots *= 2;
+        }
+        return slots;
+    }();
+    static constexpr size_t BucketCount = N / 2 + 1;
+    static constexpr size_t MaxBucketSize = 16;
+
+    std::array<uint16_t, BucketCount> Seeds{};
+    std::array<int16_t, SlotCount> Slots{};
+    bool Complete = false;
+
+    static constexpr size_t BucketOf(uint32_t hash) { return ((hash >> 16) ^ hash) % BucketCount; }
+
+    static constexpr size_t SlotOf(uint32_t hash, uint32_t seed) {
+        uint32_t h = hash ^ (seed * 0x9E3779B9u);
+        h ^= h >> 16;
+        h *= 0x85EBCA6Bu;
+        h ^= h >> 13;
+        h *= 0xC2B2AE35u;
+        h ^= h >> 16;
+        return h & (SlotCount - 1);
+    }
+
+    /// Index of the only key that can have this hash, or -1
+    constexpr int Find(uint32_t hash) const { return Slots[SlotOf(hash, Seeds[BucketOf(hash)])]; }
+};
+
+/// Build the PerfectHash for keys with these hashes; key i is found as index i
+template <size_t N>
+constexpr PerfectHash<N> BuildPerfectHash(const std::array<uint32_t, N>& hashes) {
+    using Table = PerfectHash<N>;
+    Table table;
+    for (auto& slot : table.Slots) {
+        slot = -1;
+    }
+
+    // Keys grouped by bucket: counting sort into members
+    std::array<size_t, Table::BucketCount + 1> starts{};
+    for (size_t i = 0; i < N; ++i) {
+        ++starts[Table::BucketOf(hashes[i]) + 1];
+    }
+    size_t largest = 0;
+    for (size_t b = 0; b < Table::BucketCount; ++b) {
+        largest = starts[b + 1] > largest ? starts[b + 1] : largest;
+        starts[b + 1] += starts[b];
+    }
+    if (largest > Table::MaxBucketSize) {
+        return table;
+    }
+    std::array<size_t, N> members{};
+    std::array<size_t, Table::BucketCount> filled{};
+    for (size_t i = 0; i < N; ++i) {
+        size_t b = Table::BucketOf(hashes[i]);
+        members[starts[b] + filled[b]++] = i;
+    }
+    for (size_t b = 0; b < Table::BucketCount; ++b) {
+        for (size_t k = starts[b]; k < starts[b + 1]; ++k) {
+            for (size_t j = starts[b]; j < k; ++j) {
+                if (hashes[members[j]] == hashes[members[k]]) {
+                    return table;  // No seed tells these apart
+                }
+            }
+        }
+    }
+
+    // Place the largest buckets first, while the table is emptiest
+    for (size_t size = largest; size > 0; --size) {
+        for (size_t b = 0; b < Table::BucketCount; ++b) {
+            if (starts[b + 1] - starts[b] != size) {
+                continue;
+            }
+            bool placed = false;
+            for (uint32_t seed = 0; seed <= 0xFFFF && !placed; ++seed) {
+                std::array<size_t, Table::MaxBucketSize> slots{};
+                placed = true;
+                for (size_t k = 0; k < size && placed; ++k) {
+                    slots[k] = Table::SlotOf(hashes[members[starts[b] + k]], seed);
+                    placed = table.Slots[slots[k]] == -1;
+                    for (size_t j = 0; j < k && placed; ++j) {
+                        placed = slots[j] != slots[k];
+                    }
+                }
+                if (placed) {
+                    table.Seeds[b] = static_cast<uint16_t>(seed);
+                    for (size_t k = 0; k < size; ++k) {
+                        table.Slots[slots[k]] = static_cast<int16_t>(members[starts[b] + k]);
+                    }
+                }
+            }
+            if (!placed) {
+                return table;
+            }
+        }
+    }
+    table.Complete = true;
+    return table;
+}
+
+} // namespace DMCompiler
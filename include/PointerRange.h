@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// View of a vector of unique_ptrs as the raw pointers they hold, such as
+/// DMObjectTree::AllObjects. Nothing is copied; the view stays valid as long
+/// as the vector does not change.
+/// </summary>
+template <typename T>
+class PointerRange {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = T*;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T* const*;
+        using reference = T*;
+
+        explicit Iterator(typename std::vector<std::unique_ptr<T>>::const_iterator it) : It_(it) {}
+
+        T* operator*() const { return It_->get(); }
+        Iterator& operator++() { ++It_; return *this; }
+        Iterator operator++(int) { Iterator old = *this; ++It_; return old; }
+        difference_type operator-(const Iterator& other) const { return It_ - other.It_; }
+        bool operator==(const Iterator& other) const { return It_ == other.It_; }
+        bool operator!=(const Iterator& other) const { return It_ != other.It_; }
+
+    private:
+        typename std::vector<std::unique_ptr<T>>::const_iterator It_;
+    };
+
+    explicit PointerRange(const std::vector<std::unique_ptr<T>>& items) : Items_(&items) {}
+
+    Iterator begin() const { return Iterator(Items_->begin()); }
+    Iterator end() const { return Iterator(Items_->end()); }
+    size_t size() const { return Items_->size(); }
+    bool empty() const { return Items_->empty(); }
+    T* operator[](size_t index) const { return (*Items_)[index].get(); }
+
+private:
+    const std::vector<std::unique_ptr<T>>* Items_;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include "Token.h"
+#include "DMCompiler.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// Complete result of the preprocessing phase, in a binary form that another
+/// dmcompiler can load instead of preprocessing (--emit-preprocessed and
+/// --load-preprocessed).
+///
+/// Besides the token stream this carries everything later phases read from
+/// the preprocessor or from DMStandard/Defines.dm: pragma levels, resource
+/// directories, included maps and interface, and the standard constants. File
+/// paths are stored as written on the producing machine, so consumers need
+/// the same source layout to resolve maps and resources.
+/// </summary>
+struct PreprocessedOutput {
+    std::vector<Token> Tokens;
+    std::vector<std::pair<std::string, int>> StandardConstants;
+    std::vector<std::pair<WarningCode, ErrorLevel>> Pragmas;
+    std::vector<std::string> ResourceDirectories;
+    std::vector<std::string> IncludedMaps;
+    std::string IncludedInterface;
+
+    /// Read a file written by Save
+    /// @return false if the file is missing, corrupt, or from another lexer version
+    bool Load(const std::string& path);
+
+    /// Write the output (replacing the file atomically)
+    bool Save(const std::string& path) const;
+};
+
+} // namespace DMCompiler
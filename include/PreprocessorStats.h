@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <ostream>
+#include <cstdint>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Counters collected by DMPreprocessor when statistics are enabled (--preproc-stats).
+///
+/// Files are keyed by absolute path and macros by name; counts accumulate over
+/// every root file the preprocessor is initialized with. Report() prints the
+/// heaviest entries, which point at macros worth restructuring and headers
+/// worth precompiling.
+/// </summary>
+struct PreprocessorStats {
+    struct FileStats {
+        uint64_t Bytes = 0;
+        uint64_t Tokens = 0;       // Raw lexer tokens read from the file (all inclusions)
+        uint64_t IncludedBy = 0;   // #include directives naming the file, including skipped ones
+        uint64_t Opened = 0;       // Times the file was actually pushed and read
+        size_t MaxDepth = 0;       // Deepest include chain the file was opened at
+    };
+
+    struct MacroStats {
+        uint64_t Expansions = 0;
+        uint64_t TokensProduced = 0;
+    };
+
+    std::unordered_map<std::string, FileStats> Files;
+    std::unordered_map<std::string, MacroStats> Macros;
+
+    /// Longest include chain seen, outermost file first
+    std::vector<std::string> DeepestChain;
+
+    uint64_t SkippedBlocks = 0;
+    double SkipSeconds = 0.0;  // Wall time spent in SkipIfBody
+
+    /// Print a summary with the top entries of each table
+    /// @param out Stream to write to
+    /// @param topCount Rows to show per table
+    void Report(std::ostream& out, size_t topCount = 20) const;
+};
+
+} // namespace DMCompiler
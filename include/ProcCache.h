@@ -0,0 +1,156 @@
+#pragma once
+
+#include "OperandEncoding.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace DMCompiler {
+
+class DMCompiler;
+class DMObjectTree;
+class DMProc;
+
+/// <summary>
+/// On-disk cache of compiled procs, so a rebuild only compiles the procs
+/// whose code or surroundings changed (--proc-cache).
+///
+/// Each proc has one entry, kept under a hash of its type, name and ID and
+/// replaced when it changes. An entry is used while its key matches: a hash
+/// of the proc's parameters and body (ASTCache::HashProc, which leaves
+/// locations out, so a proc that only moved is a hit), of the settings that
+/// change code generation, the bytecode version and the shape of the type
+/// tree (every type's ID, path and parent), and of every symbol the proc can
+/// resolve. Code only looks symbols up by name, so those are the symbols
+/// declared under a name the body holds, or under the proc's own name for
+/// ..(): every var and override with its initial value, every proc with its
+/// signature and attributes (and its body, if it is short enough that calls
+/// to it are inlined), and every global. Editing a proc body misses that
+/// proc only; editing a declaration misses the procs naming it; adding a
+/// type moves type IDs and misses every proc. __init__ procs compile their
+/// type's vars, so they are keyed on the whole tree.
+/// Macros are expanded before parsing, so a changed macro misses the procs
+/// whose expansion of it changed.
+///
+/// Bytecode holds string IDs, which depend on what earlier procs interned. An
+/// entry keeps every string the compile asked for, in first-use order, with
+/// the ID it got. Apply() interns them again in that order, which builds the
+/// table a compile would, and points the bytecode's string operands at the
+/// IDs they get now. Where that would change the code's length (a LEB128 ID
+/// growing a byte) the proc is compiled instead, finding its strings in the
+/// table. Resources the proc referenced are added again. A compile that
+/// reported anything (a diagnostic, a message, or while speculating, a string
+/// not yet in the table) is not stored, so a hit never leaves out a warning.
+/// Each entry ends with a checksum of the rest, and one that does not match
+/// is a miss, so a damaged entry is compiled again rather than trusted.
+/// </summary>
+class ProcCache {
+public:
+    /// What compiling a proc produced
+    struct Entry {
+        std::vector<uint8_t> Bytecode;
+        int MaxStackSize = 0;
+        uint8_t Attributes = 0;  // ProcAttributes, as set statements left them
+        std::optional<uint16_t> VerbSource;
+        std::optional<std::string> VerbName;
+        std::optional<std::string> VerbCategory;
+        std::optional<std::string> VerbDescription;
+        int8_t Invisibility = 0;
+        std::vector<std::pair<std::string, std::string>> SetAttributes;  // Sorted by attribute
+        std::vector<std::pair<std::string, int>> Strings;  // Every string asked for, in first-use order, with its ID
+        std::vector<std::string> Resources;  // Every resource referenced, in first-use order
+    };
+
+    /// What procs' bytecode can depend on in the frozen tree and settings
+    struct TreeFingerprint {
+        uint64_t Whole = 0;      // All of it, which __init__ procs are keyed on
+        uint64_t Structure = 0;  // The settings, the versions and every type's path and parent
+        std::unordered_map<std::string, uint64_t> Symbols;  // Everything declared under each name
+    };
+
+    /// Records what the proc being compiled on this thread asks for, and while
+    /// the cache is in use, stores the result when it ends if the proc got
+    /// bytecode and nothing kept it from being stored
+    class Recorder {
+    public:
+        /// @param cache nullptr when procs are not cached, which records nothing
+        Recorder(ProcCache* cache, DMProc* proc);
+        ~Recorder();
+        Recorder(const Recorder&) = delete;
+        Recorder& operator=(const Recorder&) = delete;
+
+    private:
+        friend class ProcCache;
+
+        ProcCache* Cache_;
+        DMProc* Proc_;
+        Recorder* Outer_;  // Recorder of a proc whose compile this one interrupted
+        Entry Entry_;
+        std::unordered_map<std::string, int> SeenStrings_;
+        std::unordered_map<std::string, bool> SeenResources_;
+        bool Storable_ = true;
+    };
+
+    /// Note that the proc compiled on this thread used a string (no-op when none is recorded)
+    static void RecordString(std::string_view value, int id);
+
+    /// Note that the proc compiled on this thread referenced a resource
+    static void RecordResource(const std::string& path);
+
+    /// Note that the proc compiled on this thread did something a cached
+    /// copy would not repeat, so it is not stored
+    static void RecordSideEffect();
+
+    /// Hash everything about the frozen tree and settings a proc's bytecode can depend on
+    /// @return false if the tree holds nodes that cannot be hashed, in which case nothing can be cached
+    static bool Fingerprint(const DMCompiler& compiler, const DMObjectTree& tree, TreeFingerprint& fingerprint);
+
+    /// @param directory Where entries are kept (created if missing)
+    /// @param fingerprint Fingerprint() of the tree being compiled
+    /// @param encoding How the procs being compiled write their operands
+    ProcCache(std::string directory, TreeFingerprint fingerprint, OperandEncoding encoding);
+
+    /// Get the cached compile of a proc, or nullptr on a miss; safe on several threads
+    std::unique_ptr<Entry> Find(const DMProc& proc) const;
+
+    /// Give a proc the bytecode of a found entry, interning its strings and
+    /// adding its resources, in the order a compile would, with its string
+    /// operands renumbered to the IDs the strings have now
+    /// @return false if they cannot all be renumbered in place, in which case
+    ///         the proc still has to be compiled
+    bool Apply(DMProc& proc, const Entry& entry, DMObjectTree& tree);
+
+    /// Point string operands (and field and proc references, which name
+    /// theirs by string ID) at new IDs, in place
+    /// @param newIds New ID of each old one that changed
+    /// @return false if the bytecode does not decode, or if an ID cannot be
+    ///         rewritten without changing the code's length or might be a type
+    static bool RenumberStrings(std::vector<uint8_t>& bytecode, const std::unordered_map<uint32_t, uint32_t>& newIds,
+                                OperandEncoding encoding);
+
+    const std::string& GetDirectory() const { return Directory_; }
+    size_t GetReusedCount() const { return Reused_; }
+    size_t GetRenumberedCount() const { return Renumbered_; }
+    size_t GetStoredCount() const { return Stored_; }
+
+private:
+    std::string Directory_;
+    TreeFingerprint Fingerprint_;
+    OperandEncoding Encoding_;
+    std::atomic<size_t> Reused_{0};
+    std::atomic<size_t> Renumbered_{0};  // Of those reused, how many had their strings renumbered
+    std::atomic<size_t> Stored_{0};
+
+    /// What an entry has to match to be used; false if the body cannot be hashed
+    bool Key(const DMProc& proc, uint64_t& key) const;
+    std::string EntryPath(uint64_t nameHash) const;
+    void Store(const DMProc& proc, const Entry& entry);
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace DMCompiler {
+
+class DMObjectTree;
+class DMProc;
+
+/// How much of the runtime's time a proc took in the profile (--profile-data)
+enum class ProcTemperature : uint8_t {
+    Warm,  // Ran, or no profile was given: compiled as usual
+    Hot,   // Among the procs the runtime spent most of its time in
+    Cold,  // Never ran in the profile
+};
+
+/// <summary>
+/// A runtime's per-proc profile (--profile-data), which sorts procs into hot
+/// and cold for the choices that trade code size for speed.
+///
+/// The file is JSON: {"Procs": [{"Type": "/mob", "Name": "Life", "Calls": 1200,
+/// "Time": 35.2}, ...]}, with global procs on type "/". Time may be in any
+/// unit; without it, calls are weighed instead. Procs are taken from the
+/// most expensive down until they cover HotShare of the profile's total, and
+/// those are hot. Procs the profile lists without calls or time, or does not
+/// list, are cold. A type and name stand for each definition of that proc on
+/// the type, overrides included.
+///
+/// Hot procs get the runtime's superinstructions and binary-search switch
+/// dispatch from fewer tests; cold procs keep the smaller linear switch
+/// chain. The binary output stores hot procs' code first, hottest first.
+/// </summary>
+class ProcProfile {
+public:
+    /// Share of the profile's total that makes up the hot procs
+    static constexpr double HotShare = 0.9;
+
+    /// Read a profile; nullptr with error set if it cannot be read or is not one
+    static std::unique_ptr<ProcProfile> Load(const std::string& path, std::string& error);
+
+    /// Set the Temperature of every proc in the tree
+    void Classify(DMObjectTree& tree);
+
+    /// What the profile weighs the proc at (its time, or without times its
+    /// calls), 0 if it is not listed
+    double GetWeight(const DMProc& proc) const;
+
+    /// How many procs Classify() found hot and cold
+    size_t GetHotCount() const { return HotCount_; }
+    size_t GetColdCount() const { return ColdCount_; }
+
+private:
+    struct Sample {
+        uint64_t Calls = 0;
+        double Time = 0;
+    };
+
+    std::unordered_map<std::string, Sample> Samples_;  // By type path, '\n' and proc name
+    bool Timed_ = false;  // Some sample has a time, so times are weighed rather than calls
+    size_t HotCount_ = 0;
+    size_t ColdCount_ = 0;
+
+    double Weigh(const Sample& sample) const { return Timed_ ? sample.Time : static_cast<double>(sample.Calls); }
+};
+
+} // namespace DMCompiler
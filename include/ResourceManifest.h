@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace DMCompiler {
+
+class ResourceHashIndex;
+
+/// <summary>
+/// The resource manifest (--resource-manifest), written next to the output
+/// as [name].resources.json so an asset pipeline can ship only the resources
+/// whose contents changed.
+///
+/// Each resource the code references, in resource ID order, is looked for
+/// relative to the project's directory and then in each FILE_DIR directory.
+/// A found one is listed with the file it resolved to, its size, its
+/// modification time and an XXH64 hash of its contents; one that is not
+/// found is listed as missing. The previous manifest doubles as the hash
+/// cache: a file whose size and modification time are unchanged keeps the
+/// hash it had, so only new and touched files are read.
+/// </summary>
+class ResourceManifest {
+public:
+    struct Entry {
+        std::string Path;          // As the code wrote it
+        std::string File;          // What it resolved to; empty if missing
+        uint64_t Size = 0;
+        int64_t ModifiedTime = 0;  // In the filesystem clock's ticks
+        uint64_t Hash = 0;
+    };
+
+    /// Resolve and hash resources on threadCount threads (0 = on this one)
+    /// @param searchDirs Directories to look in, in order
+    /// @param previousPath An earlier manifest to take unchanged hashes from
+    /// @param hashedCount Set to how many files had to be read
+    /// @param hashes Hashes kept across compiles, consulted after the previous manifest and updated
+    static std::vector<Entry> Build(const std::vector<std::string>& resources, const std::vector<std::string>& searchDirs,
+                                    const std::string& previousPath, unsigned threadCount, size_t& hashedCount,
+                                    ResourceHashIndex* hashes = nullptr);
+
+    /// Write entries as a manifest, entry i being resource ID i + 1
+    static bool Write(const std::string& path, const std::vector<Entry>& entries);
+
+    /// XXH64 of data, with seed 0
+    static uint64_t Hash(std::string_view data);
+};
+
+/// <summary>
+/// Resource hashes kept in memory by compiles that share a process
+/// (dmcompiler --batch and --server), so targets built from the same
+/// resources read each file once. As with a previous manifest, a hash is
+/// reused only while the file's size and modification time are unchanged.
+/// Safe on several threads.
+/// </summary>
+class ResourceHashIndex {
+public:
+    /// Get the hash of a file last seen with this size and modification time
+    bool Find(const std::string& file, uint64_t size, int64_t modifiedTime, uint64_t& hash) const;
+
+    /// Keep a resolved entry's hash
+    void Remember(const ResourceManifest::Entry& entry);
+
+    /// Number of files held
+    size_t Size() const;
+
+private:
+    mutable std::mutex Mutex_;
+    std::unordered_map<std::string, ResourceManifest::Entry> Files_;  // By resolved file
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace DMCompiler {
+
+namespace Detail {
+
+template<typename Key, typename Value>
+const Key& EntryKey(const std::pair<Key, Value>& entry) { return entry.first; }
+
+template<typename Key>
+const Key& EntryKey(const Key& entry) { return entry; }
+
+} // namespace Detail
+
+/// <summary>
+/// The entries of an unordered map or set (or a FlatHashMap), sorted by key.
+///
+/// Anything that ends up in the output (JSON, bytecode, string IDs) is built
+/// in this order rather than the container's, so it comes out the same on
+/// every run, thread count and standard library.
+/// </summary>
+template<typename Container>
+std::vector<const typename Container::value_type*> SortedEntries(const Container& container) {
+    std::vector<const typename Container::value_type*> entries;
+    entries.reserve(container.size());
+    for (const auto& entry : container) {
+        entries.push_back(&entry);
+    }
+    std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) {
+        return Detail::EntryKey(*a) < Detail::EntryKey(*b);
+    });
+    return entries;
+}
+
+} // namespace DMCompiler
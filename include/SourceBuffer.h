@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <cstddef>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Read-only bytes of a source file.
+///
+/// Files are memory-mapped where the platform supports it (mmap on POSIX,
+/// MapViewOfFile on Windows) so DMLexer can scan them in place without copying
+/// the contents into a std::string first. Buffers created from in-memory text
+/// (tests, rewritten sources) own their storage instead.
+///
+/// Buffers are shared via std::shared_ptr: each DMLexer holds a reference to the
+/// buffer it scans, so a mapping stays alive exactly as long as some lexer uses it.
+/// </summary>
+class SourceBuffer {
+public:
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    /// Map a file into memory (or read it, if mapping is unavailable)
+    /// @param path File to open
+    /// @return The buffer, or nullptr if the file could not be opened
+    static std::shared_ptr<const SourceBuffer> FromFile(const std::string& path);
+
+    /// Create a buffer that owns a copy of the given text
+    /// @param content Source text
+    /// @return The buffer (never null)
+    static std::shared_ptr<const SourceBuffer> FromString(std::string content);
+
+    const char* Data() const { return Data_; }
+    size_t Size() const { return Size_; }
+    std::string_view View() const { return std::string_view(Data_, Size_); }
+
+    /// True if the bytes are a view of a file mapping rather than owned storage
+    bool IsMapped() const { return Mapping_ != nullptr; }
+
+private:
+    SourceBuffer() = default;
+
+    const char* Data_ = "";
+    size_t Size_ = 0;
+
+    /// Owned storage for non-mapped buffers
+    std::string Owned_;
+
+    /// Platform mapping handle (base address of the view), null when not mapped
+    void* Mapping_ = nullptr;
+
+#ifdef _WIN32
+    /// Windows file and mapping object handles (HANDLE)
+    void* FileHandle_ = nullptr;
+    void* MappingHandle_ = nullptr;
+#endif
+};
+
+} // namespace DMCompiler
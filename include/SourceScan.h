@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Small set of byte values that the source scanning functions search for.
+/// </summary>
+class ByteSet {
+public:
+    static constexpr size_t MaxBytes = 12;
+
+    /// @param bytes Bytes in the set (at most MaxBytes; extras are ignored)
+    ByteSet(std::initializer_list<char> bytes);
+
+    bool Contains(char c) const;
+
+    const char* Bytes() const { return Bytes_; }
+    size_t Count() const { return Count_; }
+
+private:
+    char Bytes_[MaxBytes] = {};
+    size_t Count_ = 0;
+};
+
+/// <summary>
+/// Vectorized byte scanning used by DMLexer to cross whitespace, comments and
+/// string bodies in runs instead of one Advance() at a time.
+///
+/// The instruction set is chosen at compile time: AVX2 when the build enables
+/// it, SSE2 on any x86-64 target, NEON on ARM64, and a scalar loop elsewhere.
+/// All variants return identical results.
+/// </summary>
+namespace SourceScan {
+
+/// Find the first byte at or after begin that is in the set
+/// @return Its index, or text.size() if there is none
+size_t FindFirstOf(std::string_view text, size_t begin, const ByteSet& set);
+
+/// Find the first byte at or after begin that is not in the set
+/// @return Its index, or text.size() if there is none
+size_t FindFirstNotOf(std::string_view text, size_t begin, const ByteSet& set);
+
+/// Name of the scanning implementation compiled in ("avx2", "sse2", "neon" or "scalar")
+const char* ImplementationName();
+
+} // namespace SourceScan
+
+} // namespace DMCompiler
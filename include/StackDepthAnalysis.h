@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ControlFlowGraph.h"
+#include <optional>
+#include <vector>
+
+namespace DMCompiler {
+
+/// <summary>
+/// Stack depth at every instruction of a proc's lifted bytecode, worked out
+/// from the opcode table rather than from the ResizeStack() calls made while
+/// it was emitted.
+///
+/// Follows every path from the first instruction. An instruction changes the
+/// depth by the StackDelta its OpcodeMetadata gives, plus what its count
+/// operand and its reference add for opcodes that have them. A jump that
+/// keeps the value it tested (BooleanAnd/Or, JumpIfTrueReference and
+/// JumpIfFalseReference) has its own effect on that edge; the switch opcodes
+/// jump with the switch value still on the stack, like falling through, and
+/// every case pops it. A try's catch is entered at the depth of the Try.
+///
+/// Where the bytes do not say what an instruction does to the stack (a
+/// CallStatement other than ..(), keyed arguments, references written in a
+/// form the table cannot size), the delta counted while it was emitted is
+/// used instead.
+/// </summary>
+class StackDepthAnalysis {
+public:
+    explicit StackDepthAnalysis(const std::vector<BytecodeInstruction>& instructions);
+
+    /// Deepest the stack gets on any path, or nullopt if two paths reach an
+    /// instruction at different depths or one takes more values than there are
+    std::optional<int> GetMaxDepth() const { return MaxDepth_; }
+
+    /// Depth at the start of each instruction, or -1 where no path reaches it
+    const std::vector<int>& GetDepths() const { return Depths_; }
+
+    /// The instruction the analysis gave up at, if GetMaxDepth() is nullopt
+    size_t GetFailedAt() const { return FailedAt_; }
+
+    /// How an instruction changes the depth when it falls through, or nullopt
+    /// if its bytes do not say
+    static std::optional<int> StackEffect(const BytecodeInstruction& instruction);
+
+    /// How an instruction holding a label changes the depth when it jumps
+    /// there, or nullopt if its bytes do not say
+    static std::optional<int> JumpStackEffect(const BytecodeInstruction& instruction);
+
+private:
+    std::vector<int> Depths_;
+    std::optional<int> MaxDepth_;
+    size_t FailedAt_ = 0;
+};
+
+} // namespace DMCompiler
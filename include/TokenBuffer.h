@@ -0,0 +1,116 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "Token.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// Deduplicating string store. Each distinct string is kept once and
+/// identified by a dense 32-bit ID; views returned by Get() stay valid for
+/// the lifetime of the interner.
+/// </summary>
+class StringInterner {
+public:
+    StringInterner();
+
+    /// Get the ID of a string, storing it on first use
+    uint32_t Intern(std::string_view text);
+
+    /// Look up the text of an interned ID
+    std::string_view Get(uint32_t id) const { return Views_[id]; }
+
+    size_t Size() const { return Views_.size(); }
+
+    /// ID of the empty string (always present)
+    static constexpr uint32_t EmptyId = 0;
+
+private:
+    // std::deque never relocates existing elements, so views into them are stable
+    std::deque<std::string> Storage_;
+    std::vector<std::string_view> Views_;
+    std::unordered_map<std::string_view, uint32_t> Ids_;
+};
+
+/// <summary>
+/// Trivially-copyable form of a Token. Text and string value are stored as IDs
+/// into the owning TokenBuffer's interner and the file as a SourceFileRegistry
+/// index, so a token is a fixed 40 bytes with no heap allocations of its own.
+/// </summary>
+struct CompactToken {
+    TokenType Type;
+    Token::TokenValue::Type ValueType;
+    bool InDMStandard;
+    uint32_t TextId;
+    uint32_t StringValueId;
+    uint32_t FileId;
+    int32_t Line;
+    int32_t Column;
+    union {
+        int64_t IntValue;
+        double FloatValue;
+    };
+};
+
+static_assert(std::is_trivially_copyable<CompactToken>::value,
+              "CompactToken must stay trivially copyable");
+
+/// <summary>
+/// Flat storage for the preprocessed token stream. Tokens are appended as
+/// CompactTokens and expanded back to full Tokens only when the parser
+/// consumes them, so the (potentially multi-million entry) buffer holds no
+/// per-token strings.
+/// </summary>
+class TokenBuffer {
+public:
+    /// Append a token, interning its strings
+    void Push(const Token& token);
+
+    /// Append a batch of tokens
+    void Append(const std::vector<Token>& tokens);
+
+    /// Expand the token at the given index back into a full Token
+    Token Get(size_t index) const;
+
+    TokenType TypeAt(size_t index) const { return Tokens_[index].Type; }
+    std::string_view TextAt(size_t index) const { return Strings_.Get(Tokens_[index].TextId); }
+    std::string_view StringValueAt(size_t index) const { return Strings_.Get(Tokens_[index].StringValueId); }
+    const CompactToken& At(size_t index) const { return Tokens_[index]; }
+
+    size_t size() const { return Tokens_.size(); }
+    bool empty() const { return Tokens_.empty(); }
+
+    void Reserve(size_t count) { Tokens_.reserve(count); }
+
+    /// Drop every token and string, giving their memory back
+    void Release() {
+        Tokens_ = {};
+        Strings_ = StringInterner();
+        IndentationResolved_ = false;
+    }
+
+    /// Swap in a rewritten token array whose strings come from this buffer
+    /// @param tokens The new tokens
+    /// @param indentationResolved True if they already contain Indent/Dedent (see ResolveIndentation)
+    void Replace(std::vector<CompactToken> tokens, bool indentationResolved) {
+        Tokens_ = std::move(tokens);
+        IndentationResolved_ = indentationResolved;
+    }
+
+    /// True once Indent/Dedent tokens are in place and indentation whitespace is gone
+    bool IndentationResolved() const { return IndentationResolved_; }
+
+private:
+    std::vector<CompactToken> Tokens_;
+    StringInterner Strings_;
+    bool IndentationResolved_ = false;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include "Token.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// On-disk cache of raw DMLexer output, one file per distinct source text.
+///
+/// Entries are named by a 64-bit hash of the (continuation-joined) source bytes
+/// and stamped with the lexer version, so unchanged files are never re-lexed
+/// and a lexer change invalidates everything. Tokens are stored without their
+/// file path; Load() attaches the path of the file being read. Each entry ends
+/// with a checksum of the rest, and one that does not match is a miss.
+///
+/// A cache kept across compiles (dmcompiler --server) can also hold every
+/// entry it loads or stores in memory, so hits skip reading and decoding the
+/// entry file. Entries are never dropped from memory while the cache lives.
+/// </summary>
+class TokenCache {
+public:
+    /// @param keepInMemory Also hold entries in memory, for a cache used by many compiles
+    explicit TokenCache(std::string directory, bool keepInMemory = false);
+
+    /// Get the cached tokens of a source text, or nullptr on a miss
+    /// @param sourcePath File the tokens will be attributed to
+    /// @param content Source text the tokens were lexed from
+    std::shared_ptr<std::vector<Token>> Load(const std::string& sourcePath, std::string_view content) const;
+
+    /// Save the tokens lexed from a source text (best effort; failures are ignored)
+    void Store(std::string_view content, const std::vector<Token>& tokens) const;
+
+    const std::string& GetDirectory() const { return Directory_; }
+
+    /// Number of entries held in memory
+    size_t MemoryEntries() const;
+
+    /// FNV-1a hash of a source text
+    static uint64_t HashContent(std::string_view content);
+
+private:
+    std::string EntryPath(uint64_t hash) const;
+
+    std::string Directory_;
+    bool KeepInMemory_;
+    mutable std::mutex MemoryMutex_;  // Lexer threads load and store concurrently
+    mutable std::unordered_map<uint64_t, std::shared_ptr<const std::vector<Token>>> Memory_;  // By content hash
+
+    void Remember(uint64_t hash, std::shared_ptr<const std::vector<Token>> tokens) const;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "TokenBuffer.h"
+
+namespace DMCompiler {
+
+/// <summary>
+/// Rewrite a preprocessed token buffer so indentation is explicit.
+///
+/// Applies the rules TokenStreamDMLexer otherwise applies while parsing: a
+/// newline outside brackets followed by deeper whitespace gets an Indent
+/// before it, one followed by shallower whitespace gets a Dedent after it per
+/// level closed, and whitespace is dropped. Remaining Dedents and an
+/// EndOfFile token are appended, all with the locations the streaming lexer
+/// would have given them. Afterwards the lexer only has to walk the array,
+/// and ParallelParser can split it without re-deriving indentation.
+///
+/// Does nothing if the buffer is already resolved.
+/// </summary>
+/// @param tokens The buffer to rewrite in place
+void ResolveIndentation(TokenBuffer& tokens);
+
+} // namespace DMCompiler
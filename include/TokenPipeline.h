@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Token.h"
+
+namespace DMCompiler {
+
+class DMCompiler;
+class DMPreprocessor;
+
+/// <summary>
+/// Fixed-capacity single-producer/single-consumer token queue. Tokens are
+/// moved in and out in batches so the lock is taken once per batch rather
+/// than once per token.
+/// </summary>
+class TokenRingBuffer {
+public:
+    explicit TokenRingBuffer(size_t capacity);
+
+    /// Move tokens into the buffer, blocking while it is full
+    /// @return false if the consumer cancelled the stream
+    bool PushBatch(std::vector<Token>& tokens);
+
+    /// Move up to maxCount tokens out of the buffer, blocking while it is empty
+    /// @return false once the producer has closed the stream and it is drained
+    bool PopBatch(std::vector<Token>& out, size_t maxCount);
+
+    /// Producer side: no more tokens will be pushed
+    void Close();
+
+    /// Consumer side: stop accepting tokens and wake the producer
+    void Cancel();
+
+private:
+    std::vector<Token> Slots_;
+    size_t Head_ = 0;
+    size_t Count_ = 0;
+    bool Closed_ = false;
+    bool Cancelled_ = false;
+
+    std::mutex Mutex_;
+    std::condition_variable NotEmpty_;
+    std::condition_variable NotFull_;
+};
+
+/// <summary>
+/// Runs the preprocessor on a background thread over a list of root files,
+/// feeding its output into a TokenRingBuffer that the parser drains through
+/// TokenStreamDMLexer. Memory use is bounded by the buffer capacity instead
+/// of growing with the total token count.
+/// </summary>
+class PreprocessorPipeline {
+public:
+    static constexpr size_t DefaultCapacity = 16384;
+
+    PreprocessorPipeline(DMCompiler* compiler, std::unique_ptr<DMPreprocessor> preprocessor,
+                         std::vector<std::string> files, size_t capacity = DefaultCapacity);
+    ~PreprocessorPipeline();
+
+    PreprocessorPipeline(const PreprocessorPipeline&) = delete;
+    PreprocessorPipeline& operator=(const PreprocessorPipeline&) = delete;
+
+    /// Tokens to stream ahead of the first file (e.g. a loaded DMStandard snapshot); call before Start
+    void SetLeadingTokens(std::vector<Token> tokens) { LeadingTokens_ = std::move(tokens); }
+
+    /// Start preprocessing on the background thread
+    void Start();
+
+    /// Wait for the producer thread to exit (cancelling it if the consumer stopped early)
+    /// @return true if every file was preprocessed without a fatal error
+    bool Finish();
+
+    TokenRingBuffer& GetStream() { return Stream_; }
+
+    /// The preprocessor (only safe to inspect after Finish)
+    DMPreprocessor& GetPreprocessor() { return *Preprocessor_; }
+
+    /// Number of tokens produced so far (only exact after Finish)
+    size_t GetTokenCount() const { return TokenCount_; }
+
+private:
+    void Run();
+
+    DMCompiler* Compiler_;
+    std::unique_ptr<DMPreprocessor> Preprocessor_;
+    std::vector<std::string> Files_;
+    std::vector<Token> LeadingTokens_;
+    TokenRingBuffer Stream_;
+    std::thread Thread_;
+    size_t TokenCount_ = 0;
+    bool Failed_ = false;
+};
+
+} // namespace DMCompiler
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "Token.h"
+
+namespace DMCompiler {
+
+/// FNV-1a hash of bytes, which the caches name entries by and check files with
+inline uint64_t HashBytes(std::string_view data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : data) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/// <summary>
+/// Little helpers for the compiler's binary cache formats (token cache, DMStandard
+/// snapshot). Values are written in native byte order; the files are only read
+/// back by the build that wrote them.
+/// </summary>
+class BinaryWriter {
+public:
+    template <typename T>
+    void Write(T value) {
+        Data_.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteString(std::string_view value) {
+        Write<uint32_t>(static_cast<uint32_t>(value.size()));
+        Data_.append(value.data(), value.size());
+    }
+
+    void WriteBytes(const char* data, size_t size) { Data_.append(data, size); }
+
+    /// End the file with a checksum of everything written, for BinaryReader::VerifyChecksum()
+    void WriteChecksum() { Write<uint64_t>(HashBytes(Data_)); }
+
+    void Reserve(size_t size) { Data_.reserve(size); }
+    const std::string& Data() const { return Data_; }
+
+private:
+    std::string Data_;
+};
+
+/// <summary>
+/// Bounds-checked reader matching BinaryWriter. Any overrun clears Ok() and
+/// makes every later read return a default value.
+/// </summary>
+class BinaryReader {
+public:
+    explicit BinaryReader(std::string_view data) : Data_(data) {}
+
+    template <typename T>
+    T Read() {
+        T value{};
+        if (!Ok_ || Pos_ + sizeof(T) > Data_.size()) {
+            Ok_ = false;
+            return value;
+        }
+        std::memcpy(&value, Data_.data() + Pos_, sizeof(T));
+        Pos_ += sizeof(T);
+        return value;
+    }
+
+    std::string ReadString() {
+        uint32_t length = Read<uint32_t>();
+        if (!Ok_ || Pos_ + length > Data_.size()) {
+            Ok_ = false;
+            return std::string();
+        }
+        std::string value(Data_.substr(Pos_, length));
+        Pos_ += length;
+        return value;
+    }
+
+    /// Check the checksum WriteChecksum() ended the file with and drop it from
+    /// the data, so a file damaged anywhere is rejected before it is read.
+    /// Call before reading anything
+    bool VerifyChecksum() {
+        uint64_t stored = 0;
+        if (!Ok_ || Data_.size() < sizeof(stored)) {
+            Ok_ = false;
+            return false;
+        }
+        std::memcpy(&stored, Data_.data() + Data_.size() - sizeof(stored), sizeof(stored));
+        Data_.remove_suffix(sizeof(stored));
+        if (stored != HashBytes(Data_)) {
+            Ok_ = false;
+        }
+        return Ok_;
+    }
+
+    /// Check that the next bytes match, consuming them
+    bool Expect(const char* bytes, size_t size) {
+        if (!Ok_ || Pos_ + size > Data_.size() || std::memcmp(Data_.data() + Pos_, bytes, size) != 0) {
+            Ok_ = false;
+            return false;
+        }
+        Pos_ += size;
+        return true;
+    }
+
+    /// Read an element count, failing if the bytes left cannot hold that
+    /// many elements of at least minSize bytes each, so a corrupt count is
+    /// rejected before anything is sized by it
+    uint32_t ReadCount(size_t minSize) {
+        uint32_t count = Read<uint32_t>();
+        if (Ok_ && count > Remaining() / minSize) {
+            Ok_ = false;
+            return 0;
+        }
+        return count;
+    }
+
+    void Fail() { Ok_ = false; }
+    bool Ok() const { return Ok_; }
+    bool AtEnd() const { return Pos_ == Data_.size(); }
+    size_t Remaining() const { return Data_.size() - Pos_; }
+
+private:
+    std::string_view Data_;
+    size_t Pos_ = 0;
+    bool Ok_ = true;
+};
+
+/// Write a token array. With includeFiles, each token's source file is stored
+/// through a path table; otherwise locations keep only line and column.
+void WriteTokens(BinaryWriter& writer, const std::vector<Token>& tokens, bool includeFiles);
+
+/// Read a token array written by WriteTokens, which must end the data. The
+/// array's paths are registered only if it all reads
+/// @param defaultFileId File to attribute tokens to when the array has no path table
+bool ReadTokens(BinaryReader& reader, std::vector<Token>& tokens, bool includeFiles, uint32_t defaultFileId);
+
+/// Read a whole file into memory
+/// @return false if it could not be opened
+bool ReadBinaryFile(const std::string& path, std::string& contents);
+
+/// Write a file through a temporary and rename it into place, so readers never
+/// see a partial file (best effort; returns false on failure)
+bool WriteBinaryFileAtomic(const std::string& path, const std::string& contents);
+
+/// Make an existing file hold contents by rewriting, in place, only the
+/// blocks that differ from what it holds, then truncating or extending it.
+/// Unlike WriteBinaryFileAtomic(), a reader may see a file half patched.
+/// @param bytesWritten Set to how many bytes were written
+/// @return false if the file could not be read or written (it may then be partly patched)
+bool PatchBinaryFile(const std::string& path, const std::string& contents, size_t& bytesWritten);
+
+} // namespace DMCompiler
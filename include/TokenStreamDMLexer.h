@@ -1,6 +1,9 @@
 #include "DMLexer.h"
 #include "Token.h"
+#include "TokenBuffer.h"
+#include "TokenPipeline.h"
 #include <vector>
+#include <algorithm>
 #include <stack>
 #include <queue>
 #include <iostream>
@@ -10,21 +13,66 @@ namespace DMCompiler {
 /// <summary>
 /// Special DMLexer that streams pre-existing tokens instead of parsing source.
 /// Used by the parser when working with preprocessed token streams.
-/// Adds Indent/Dedent tokens based on whitespace tokens (matching C# implementation).
+/// Tokens are expanded from the compact buffer one at a time as they are consumed,
+/// or pulled from a TokenRingBuffer while the preprocessor is still running.
+/// Adds Indent/Dedent tokens based on whitespace tokens (matching C# implementation),
+/// unless the buffer already went through ResolveIndentation, in which case the
+/// tokens are returned as stored.
 /// </summary>
 class TokenStreamDMLexer : public DMLexer {
 public:
-    TokenStreamDMLexer(const std::vector<Token>& tokens)
-        : DMLexer("preprocessed", ""),  // Empty source
-          Tokens_(tokens),
+    /// Source name of the lexer's own starting location
+    static constexpr const char* SourceName = "preprocessed";
+    
+    TokenStreamDMLexer(const TokenBuffer& tokens)
+        : DMLexer(SourceName, ""),  // Empty source
+          Tokens_(&tokens),
+          Stream_(nullptr),
+          CurrentIndex_(0),
+          BracketNesting_(0)
+    {
+        IndentationStack_.push(0);  // Initialize with 0 indentation
+    }
+    
+    /// Feed only tokens [begin, end) of the buffer, as if they were the whole stream
+    TokenStreamDMLexer(const TokenBuffer& tokens, size_t begin, size_t end)
+        : DMLexer(SourceName, ""),  // Empty source
+          Tokens_(&tokens),
+          Stream_(nullptr),
+          End_(end),
+          CurrentIndex_(begin),
+          BracketNesting_(0)
+    {
+        IndentationStack_.push(0);  // Initialize with 0 indentation
+    }
+    
+    /// Stream tokens from a running preprocessor pipeline
+    TokenStreamDMLexer(TokenRingBuffer& stream)
+        : DMLexer(SourceName, ""),  // Empty source
+          Tokens_(nullptr),
+          Stream_(&stream),
           CurrentIndex_(0),
           BracketNesting_(0)
     {
         IndentationStack_.push(0);  // Initialize with 0 indentation
     }
     
+    /// Buffer being walked (null when streaming)
+    const TokenBuffer* Buffer() const { return Tokens_; }
+    
+    /// Buffer index of the next token to be read
+    size_t Position() const { return CurrentIndex_; }
+    
+    /// Continue reading at a buffer index. Only valid on a buffer that went
+    /// through ResolveIndentation, where no token is held back for later
+    void Seek(size_t index) { CurrentIndex_ = index; }
+    
 protected:
     Token ParseNextToken() override {
+        if (Tokens_ && Tokens_->IndentationResolved()) {
+            return NextResolvedToken();
+        }
+        
         // Return any pending tokens first
         if (!PendingTokens_.empty()) {
             Token token = PendingTokens_.front();
@@ -33,7 +81,7 @@ protected:
         }
         
         // At end of file, emit remaining dedents
-        if (CurrentIndex_ >= Tokens_.size()) {
+        if (!HasMoreTokens()) {
             while (IndentationStack_.top() > 0) {
                 IndentationStack_.pop();
                 PendingTokens_.push(CreateToken(TokenType::Dedent, ""));
@@ -48,8 +96,8 @@ protected:
             // EOF should have column 0 (indicates start of a "virtual" line after file end)
             // This is important for indentation-based parsing
             Location eofLoc;
-            if (!Tokens_.empty()) {
-                eofLoc = Tokens_.back().Loc;
+            if (HasLastLocation_) {
+                eofLoc = LastLocation_;
                 eofLoc.Column = 0;  // Force column 0 for proper dedent handling
             } else {
                 eofLoc = Location("", 0, 0);
@@ -59,14 +107,7 @@ protected:
             return CreateToken(TokenType::EndOfFile, "");
         }
         
-        // Safety check to prevent infinite loops
-        if (CurrentIndex_ >= Tokens_.size() + 1000) {
-            std::cerr << "ERROR: Token index overflow at " << CurrentIndex_ << std::endl;
-            AtEndOfSource_ = true;
-            return CreateToken(TokenType::EndOfFile, "");
-        }
-        
-        Token preprocToken = Tokens_[CurrentIndex_++];
+        Token preprocToken = TakeToken();
         
         // Update location tracking
         PreviousLocation_ = CurrentLocation_;
@@ -87,17 +128,6 @@ protected:
                     // Dedent
                     PendingTokens_.push(preprocToken);  // Queue the newline
                     
-                    // Check if the dedent level is valid
-                    bool validDedent = false;
-                    std::stack<int> tempStack = IndentationStack_;
-                    while (!tempStack.empty() && tempStack.top() > indentationLevel) {
-                        tempStack.pop();
-                        if (tempStack.top() == indentationLevel) {
-                            validDedent = true;
-                            break;
-                        }
-                    }
-                    
                     // Emit dedent tokens
                     while (IndentationStack_.top() > indentationLevel) {
                         IndentationStack_.pop();
@@ -142,6 +172,30 @@ protected:
     }
 
 private:
+    /// <summary>
+    /// Walk a buffer whose Indent/Dedent/EndOfFile tokens are already in place.
+    /// A range that stops before the buffer's EndOfFile ends like the stream does.
+    /// </summary>
+    Token NextResolvedToken() {
+        if (!HasMoreTokens()) {
+            AtEndOfSource_ = true;
+            Location eofLoc = HasLastLocation_ ? LastLocation_ : Location("", 0, 0);
+            eofLoc.Column = 0;
+            return Token(TokenType::EndOfFile, "", eofLoc);
+        }
+        
+        // Stay on EndOfFile so repeated reads keep returning it
+        if (Tokens_->TypeAt(CurrentIndex_) == TokenType::EndOfFile) {
+            AtEndOfSource_ = true;
+            return Tokens_->Get(CurrentIndex_);
+        }
+        
+        Token token = TakeToken();
+        PreviousLocation_ = CurrentLocation_;
+        CurrentLocation_ = token.Loc;
+        return token;
+    }
+    
     /// <summary>
     /// Check indentation level after a newline.
     /// Looks for a DM_Preproc_Whitespace token and returns its length.
@@ -151,19 +205,54 @@ private:
         int indentationLevel = 0;
         
         // Check if the next token is whitespace
-        if (CurrentIndex_ < Tokens_.size()) {
-            const Token& current = Tokens_[CurrentIndex_];
-            if (current.Type == TokenType::DM_Preproc_Whitespace) {
-                indentationLevel = current.Text.length();
-                // NOTE: We consume the whitespace token here
-                CurrentIndex_++;
+        if (HasMoreTokens()) {
+            if (Tokens_) {
+                if (Tokens_->TypeAt(CurrentIndex_) == TokenType::DM_Preproc_Whitespace) {
+                    indentationLevel = static_cast<int>(Tokens_->TextAt(CurrentIndex_).length());
+                    // NOTE: We consume the whitespace token here
+                    CurrentIndex_++;
+                }
+            } else {
+                const Token& next = StreamBatch_[CurrentIndex_];
+                if (next.Type == TokenType::DM_Preproc_Whitespace) {
+                    indentationLevel = static_cast<int>(next.Text.length());
+                    CurrentIndex_++;
+                }
             }
         }
         
         return indentationLevel;
     }
     
-    const std::vector<Token>& Tokens_;
+    /// True if another source token is available (refills the stream batch if needed)
+    bool HasMoreTokens() {
+        if (Tokens_) {
+            return CurrentIndex_ < std::min(End_, Tokens_->size());
+        }
+        if (CurrentIndex_ < StreamBatch_.size()) {
+            return true;
+        }
+        StreamBatch_.clear();
+        CurrentIndex_ = 0;
+        return Stream_->PopBatch(StreamBatch_, StreamBatchSize);
+    }
+    
+    /// Consume the next source token; HasMoreTokens() must have returned true
+    Token TakeToken() {
+        Token token = Tokens_ ? Tokens_->Get(CurrentIndex_++) : std::move(StreamBatch_[CurrentIndex_++]);
+        LastLocation_ = token.Loc;
+        HasLastLocation_ = true;
+        return token;
+    }
+    
+    static constexpr size_t StreamBatchSize = 1024;
+    
+    const TokenBuffer* Tokens_;
+    TokenRingBuffer* Stream_;
+    size_t End_ = static_cast<size_t>(-1);  // Index past the last buffered token to feed
+    std::vector<Token> StreamBatch_;  // Tokens popped from Stream_, indexed by CurrentIndex_
+    Location LastLocation_;
+    bool HasLastLocation_ = false;
     size_t CurrentIndex_;
     int BracketNesting_;
     std::stack<int> IndentationStack_;
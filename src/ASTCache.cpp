@@ -0,0 +1,1091 @@
+#include "ASTCache.h"
+#include "DMASTStatement.h"
+#include "DMConstants.h"
+#include "ParallelParser.h"
+#include "TokenSerialization.h"
+#include <cstdio>
+#include <filesystem>
+#include <type_traits>
+#include <unordered_map>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char CacheMagic[4] = {'D', 'M', 'A', 'C'};
+static constexpr uint32_t CacheFormatVersion = 2;
+
+// Which node follows in a serialized fragment
+enum class NodeTag : uint8_t {
+    Null = 0,
+
+    // Expressions
+    InvalidExpression, Void, Identifier, ConstantInteger, ConstantFloat, ConstantString, StringFormat,
+    ConstantResource, ConstantNull, ConstantPath, Binary, Unary, List, NewList, NewPath, Call,
+    Dereference, Ternary, Assign, SwitchCaseRange,
+
+    // Proc statements
+    ProcExpression, ProcVarDeclaration, ProcReturn, ProcBreak, ProcContinue, ProcGoto, ProcLabel,
+    ProcDel, ProcSpawn, ProcIf, ProcFor, ProcForIn, ProcForRange, ProcWhile, ProcDoWhile,
+    ProcSwitch, ProcTryCatch, ProcThrow, ProcSet,
+
+    // Object statements
+    ObjectVarDefinition, ObjectVarOverride, ObjectProcDefinition, ObjectDefinition
+};
+
+// Incremental FNV-1a, the hash TokenCache uses for source text
+struct TokenHash {
+    uint64_t Value = 14695981039346656037ull;
+
+    void AddBytes(const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            Value ^= bytes[i];
+            Value *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void Add(T value) { AddBytes(&value, sizeof(T)); }
+
+    void AddString(std::string_view text) {
+        Add<uint32_t>(static_cast<uint32_t>(text.size()));
+        AddBytes(text.data(), text.size());
+    }
+};
+
+static uint64_t HashTokens(const TokenBuffer& tokens, size_t begin, size_t end) {
+    TokenHash hash;
+    hash.Add<uint64_t>(end - begin);
+
+    // Files are hashed by path, in order of first use, since registry IDs are per-process
+    std::unordered_map<uint32_t, uint32_t> fileIndices;
+    uint32_t lastFileId = SourceFileRegistry::UnknownFileId;
+    uint32_t lastFileIndex = 0;
+
+    for (size_t i = begin; i < end; ++i) {
+        const CompactToken& token = tokens.At(i);
+        if (i == begin || token.FileId != lastFileId) {
+            auto [it, inserted] = fileIndices.emplace(token.FileId, static_cast<uint32_t>(fileIndices.size()));
+            if (inserted) {
+                hash.AddString(SourceFileRegistry::GetPath(token.FileId));
+            }
+            lastFileId = token.FileId;
+            lastFileIndex = it->second;
+        }
+
+        hash.Add<uint32_t>(lastFileIndex);
+        hash.Add<uint16_t>(static_cast<uint16_t>(token.Type));
+        hash.Add<uint8_t>(static_cast<uint8_t>(token.ValueType));
+        hash.Add<uint8_t>(token.InDMStandard ? 1 : 0);
+        hash.Add<int32_t>(token.Line);
+        hash.Add<int32_t>(token.Column);
+        hash.AddString(tokens.TextAt(i));
+        switch (token.ValueType) {
+            case Token::TokenValue::Type::Int:
+                hash.Add<int64_t>(token.IntValue);
+                break;
+            case Token::TokenValue::Type::Float:
+                hash.Add<double>(token.FloatValue);
+                break;
+            case Token::TokenValue::Type::String:
+                hash.AddString(tokens.StringValueAt(i));
+                break;
+            case Token::TokenValue::Type::None:
+                break;
+        }
+    }
+    return hash.Value;
+}
+
+// ============================================================================
+// Writing
+// ============================================================================
+
+namespace {
+
+/// Serializes a fragment's nodes, collecting the files their locations use.
+/// Without a segment it writes nodes to be hashed instead: locations are left
+/// out but for whether they are in DMStandard, and deferred body ranges too.
+/// Given names, it also adds every name and text it writes to them.
+class FragmentWriter {
+public:
+    explicit FragmentWriter(const ASTCache::Segment* segment, std::vector<std::string>* names = nullptr)
+        : Segment_(segment), Names_(names) {}
+
+    /// False if a node could not be written, in which case nothing is stored
+    bool Ok() const { return Ok_; }
+    const std::string& Data() const { return Body_.Data(); }
+    const std::vector<uint32_t>& Files() const { return Files_; }
+
+    void WriteProc(const std::vector<DMASTDefinitionParameter*>& parameters, const DMASTProcBlockInner* body) {
+        Body_.Write<uint32_t>(static_cast<uint32_t>(parameters.size()));
+        for (const DMASTDefinitionParameter* parameter : parameters) {
+            WriteDefinitionParameter(parameter);
+        }
+        WriteBlock(body);
+    }
+
+    void WriteValue(const DMASTExpression* expression) { WriteExpression(expression); }
+
+    void WriteFile(const DMASTFile& file) {
+        WriteLocation(file.Location_);
+        Body_.Write<uint32_t>(static_cast<uint32_t>(file.Statements.size()));
+        for (const auto& statement : file.Statements) {
+            WriteStatement(statement.get());
+        }
+    }
+
+private:
+    void WriteBool(bool value) { Body_.Write<uint8_t>(value ? 1 : 0); }
+    void WriteTag(NodeTag tag) { Body_.Write<uint8_t>(static_cast<uint8_t>(tag)); }
+
+    void WriteText(const std::string& text) {
+        Body_.WriteString(text);
+        if (Names_) {
+            Names_->push_back(text);
+        }
+    }
+
+    void Begin(NodeTag tag, const DMASTNode& node) {
+        WriteTag(tag);
+        WriteLocation(node.Location_);
+    }
+
+    void Unknown() {
+        Ok_ = false;
+        WriteTag(NodeTag::Null);
+    }
+
+    void WriteLocation(const Location& loc) {
+        if (!Segment_) {
+            WriteBool(loc.InDMStandard);
+            return;
+        }
+        auto [it, inserted] = FileIndices_.emplace(loc.FileId, static_cast<uint32_t>(Files_.size()));
+        if (inserted) {
+            Files_.push_back(loc.FileId);
+        }
+        Body_.Write<uint32_t>(it->second);
+        Body_.Write<int32_t>(loc.Line);
+        Body_.Write<int32_t>(loc.Column);
+        WriteBool(loc.InDMStandard);
+    }
+
+    void WritePath(const DreamPath& path) {
+        Body_.Write<uint8_t>(static_cast<uint8_t>(path.GetPathType()));
+        Body_.Write<uint32_t>(static_cast<uint32_t>(path.GetElements().size()));
+        for (const auto& element : path.GetElements()) {
+            WriteText(element);
+        }
+    }
+
+    void WriteOptionalPath(const std::optional<DreamPath>& path) {
+        WriteBool(path.has_value());
+        if (path) {
+            WritePath(*path);
+        }
+    }
+
+    void WriteValueType(const std::optional<DMComplexValueType>& type) {
+        WriteBool(type.has_value());
+        if (type) {
+            Body_.Write<uint32_t>(static_cast<uint32_t>(type->Type));
+            WriteOptionalPath(type->TypePath);
+            WriteBool(type->IsUnimplemented);
+            WriteBool(type->IsUnsupported);
+            WriteBool(type->IsCompileTimeReadOnly);
+        }
+    }
+
+    void WriteASTPath(const DMASTPath& path) {
+        WriteLocation(path.Location_);
+        WritePath(path.Path);
+        WriteBool(path.IsOperator);
+    }
+
+    void WriteCallParameters(const std::vector<std::unique_ptr<DMASTCallParameter>>& parameters) {
+        Body_.Write<uint32_t>(static_cast<uint32_t>(parameters.size()));
+        for (const auto& parameter : parameters) {
+            WriteBool(parameter != nullptr);
+            if (parameter) {
+                WriteLocation(parameter->Location_);
+                WriteExpression(parameter->Value.get());
+                WriteExpression(parameter->Key.get());
+            }
+        }
+    }
+
+    void WriteDefinitionParameters(const std::vector<std::unique_ptr<DMASTDefinitionParameter>>& parameters) {
+        Body_.Write<uint32_t>(static_cast<uint32_t>(parameters.size()));
+        for (const auto& parameter : parameters) {
+            WriteDefinitionParameter(parameter.get());
+        }
+    }
+
+    void WriteDefinitionParameter(const DMASTDefinitionParameter* parameter) {
+        WriteBool(parameter != nullptr);
+        if (parameter) {
+            WriteLocation(parameter->Location_);
+            WriteText(parameter->Name);
+            WritePath(parameter->TypePath);
+            WriteBool(parameter->IsList);
+            WriteExpression(parameter->DefaultValue.get());
+            WriteExpression(parameter->PossibleValues.get());
+            WriteValueType(parameter->ExplicitValueType);
+        }
+    }
+
+    template <typename Statement>
+    void WriteStatements(const std::vector<std::unique_ptr<Statement>>& statements) {
+        Body_.Write<uint32_t>(static_cast<uint32_t>(statements.size()));
+        for (const auto& statement : statements) {
+            WriteStatement(statement.get());
+        }
+    }
+
+    void WriteBlock(const DMASTProcBlockInner* block) {
+        WriteBool(block != nullptr);
+        if (block) {
+            WriteLocation(block->Location_);
+            WriteStatements(block->Statements);
+            WriteStatements(block->SetStatements);
+        }
+    }
+
+    void WriteExpression(const DMASTExpression* expr) {
+        if (!expr) {
+            WriteTag(NodeTag::Null);
+        } else if (auto* e = DMASTCast<DMASTInvalidExpression>(expr)) {
+            Begin(NodeTag::InvalidExpression, *e);
+        } else if (auto* e = DMASTCast<DMASTVoid>(expr)) {
+            Begin(NodeTag::Void, *e);
+        } else if (auto* e = DMASTCast<DMASTIdentifier>(expr)) {
+            Begin(NodeTag::Identifier, *e);
+            WriteText(e->Identifier);
+        } else if (auto* e = DMASTCast<DMASTConstantInteger>(expr)) {
+            Begin(NodeTag::ConstantInteger, *e);
+            Body_.Write<int32_t>(e->Value);
+        } else if (auto* e = DMASTCast<DMASTConstantFloat>(expr)) {
+            Begin(NodeTag::ConstantFloat, *e);
+            Body_.Write<float>(e->Value);
+        } else if (auto* e = DMASTCast<DMASTConstantString>(expr)) {
+            Begin(NodeTag::ConstantString, *e);
+            WriteText(e->Value);
+        } else if (auto* e = DMASTCast<DMASTStringFormat>(expr)) {
+            Begin(NodeTag::StringFormat, *e);
+            Body_.Write<uint32_t>(static_cast<uint32_t>(e->StringParts.size()));
+            for (const auto& part : e->StringParts) {
+                WriteText(part);
+            }
+            Body_.Write<uint32_t>(static_cast<uint32_t>(e->Expressions.size()));
+            for (const auto& inner : e->Expressions) {
+                WriteExpression(inner.get());
+            }
+        } else if (auto* e = DMASTCast<DMASTConstantResource>(expr)) {
+            Begin(NodeTag::ConstantResource, *e);
+            WriteText(e->Path);
+        } else if (auto* e = DMASTCast<DMASTConstantNull>(expr)) {
+            Begin(NodeTag::ConstantNull, *e);
+        } else if (auto* e = DMASTCast<DMASTConstantPath>(expr)) {
+            Begin(NodeTag::ConstantPath, *e);
+            WriteASTPath(e->Path);
+        } else if (auto* e = DMASTCast<DMASTExpressionBinary>(expr)) {
+            Begin(NodeTag::Binary, *e);
+            Body_.Write<uint8_t>(static_cast<uint8_t>(e->Operator));
+            WriteExpression(e->Left.get());
+            WriteExpression(e->Right.get());
+        } else if (auto* e = DMASTCast<DMASTExpressionUnary>(expr)) {
+            Begin(NodeTag::Unary, *e);
+            Body_.Write<uint8_t>(static_cast<uint8_t>(e->Operator));
+            WriteExpression(e->Expression.get());
+        } else if (auto* e = DMASTCast<DMASTList>(expr)) {
+            Begin(NodeTag::List, *e);
+            WriteCallParameters(e->Values);
+            WriteBool(e->IsAssociativeList);
+        } else if (auto* e = DMASTCast<DMASTNewList>(expr)) {
+            Begin(NodeTag::NewList, *e);
+            WriteCallParameters(e->Parameters);
+        } else if (auto* e = DMASTCast<DMASTNewPath>(expr)) {
+            Begin(NodeTag::NewPath, *e);
+            WriteExpression(e->Path.get());
+            WriteCallParameters(e->Parameters);
+        } else if (auto* e = DMASTCast<DMASTCall>(expr)) {
+            Begin(NodeTag::Call, *e);
+            WriteExpression(e->Target.get());
+            WriteCallParameters(e->Parameters);
+            Body_.Write<uint32_t>(static_cast<uint32_t>(e->InputTypes));
+            WriteExpression(e->InputList.get());
+            WriteBool(e->IsInputCall);
+        } else if (auto* e = DMASTCast<DMASTDereference>(expr)) {
+            Begin(NodeTag::Dereference, *e);
+            WriteExpression(e->Expression.get());
+            Body_.Write<uint8_t>(static_cast<uint8_t>(e->Type));
+            WriteExpression(e->Property.get());
+        } else if (auto* e = DMASTCast<DMASTTernary>(expr)) {
+            Begin(NodeTag::Ternary, *e);
+            WriteExpression(e->Condition.get());
+            WriteExpression(e->TrueExpression.get());
+            WriteExpression(e->FalseExpression.get());
+        } else if (auto* e = DMASTCast<DMASTAssign>(expr)) {
+            Begin(NodeTag::Assign, *e);
+            WriteExpression(e->LValue.get());
+            Body_.Write<uint8_t>(static_cast<uint8_t>(e->Operator));
+            WriteExpression(e->Value.get());
+        } else if (auto* e = DMASTCast<DMASTSwitchCaseRange>(expr)) {
+            Begin(NodeTag::SwitchCaseRange, *e);
+            WriteExpression(e->RangeStart.get());
+            WriteExpression(e->RangeEnd.get());
+        } else {
+            Unknown();
+        }
+    }
+
+    void WriteStatement(const DMASTStatement* statement) {
+        if (!statement) {
+            WriteTag(NodeTag::Null);
+        } else if (auto* s = DMASTCast<DMASTProcStatementExpression>(statement)) {
+            Begin(NodeTag::ProcExpression, *s);
+            WriteExpression(s->Expression.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementVarDeclaration>(statement)) {
+            Begin(NodeTag::ProcVarDeclaration, *s);
+            Body_.Write<uint32_t>(static_cast<uint32_t>(s->Decls.size()));
+            for (const auto& decl : s->Decls) {
+                WriteLocation(decl.Loc);
+                WriteText(decl.Name);
+                WriteOptionalPath(decl.TypePath);
+                WriteExpression(decl.Value.get());
+                WriteValueType(decl.ExplicitValueType);
+                WriteBool(decl.IsList);
+            }
+        } else if (auto* s = DMASTCast<DMASTProcStatementReturn>(statement)) {
+            Begin(NodeTag::ProcReturn, *s);
+            WriteExpression(s->Value.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementBreak>(statement)) {
+            Begin(NodeTag::ProcBreak, *s);
+            WriteExpression(s->Label.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementContinue>(statement)) {
+            Begin(NodeTag::ProcContinue, *s);
+            WriteExpression(s->Label.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementGoto>(statement)) {
+            Begin(NodeTag::ProcGoto, *s);
+            WriteExpression(s->Label.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementLabel>(statement)) {
+            Begin(NodeTag::ProcLabel, *s);
+            WriteText(s->Name);
+            WriteStatement(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementDel>(statement)) {
+            Begin(NodeTag::ProcDel, *s);
+            WriteExpression(s->Value.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementSpawn>(statement)) {
+            Begin(NodeTag::ProcSpawn, *s);
+            WriteExpression(s->Delay.get());
+            WriteBlock(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementIf>(statement)) {
+            Begin(NodeTag::ProcIf, *s);
+            WriteExpression(s->Condition.get());
+            WriteBlock(s->Body.get());
+            WriteBlock(s->ElseBody.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementFor>(statement)) {
+            Begin(NodeTag::ProcFor, *s);
+            WriteStatement(s->Initializer.get());
+            WriteExpression(s->Condition.get());
+            WriteExpression(s->Increment.get());
+            WriteBlock(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementForIn>(statement)) {
+            Begin(NodeTag::ProcForIn, *s);
+            WriteExpression(s->Variable.get());
+            WriteLocation(s->VarDecl.Loc);
+            WriteText(s->VarDecl.Name);
+            WriteOptionalPath(s->VarDecl.TypePath);
+            WriteBool(s->VarDecl.TypeFilter.has_value());
+            if (s->VarDecl.TypeFilter) {
+                WriteText(*s->VarDecl.TypeFilter);
+            }
+            WriteExpression(s->List.get());
+            WriteBlock(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementForRange>(statement)) {
+            Begin(NodeTag::ProcForRange, *s);
+            WriteExpression(s->Initializer.get());
+            WriteExpression(s->End.get());
+            WriteExpression(s->Step.get());
+            WriteBlock(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementWhile>(statement)) {
+            Begin(NodeTag::ProcWhile, *s);
+            WriteExpression(s->Condition.get());
+            WriteBlock(s->Body.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementDoWhile>(statement)) {
+            Begin(NodeTag::ProcDoWhile, *s);
+            WriteBlock(s->Body.get());
+            WriteExpression(s->Condition.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementSwitch>(statement)) {
+            Begin(NodeTag::ProcSwitch, *s);
+            WriteExpression(s->Value.get());
+            Body_.Write<uint32_t>(static_cast<uint32_t>(s->Cases.size()));
+            for (const auto& switchCase : s->Cases) {
+                Body_.Write<uint32_t>(static_cast<uint32_t>(switchCase.Values.size()));
+                for (const auto& value : switchCase.Values) {
+                    WriteExpression(value.get());
+                }
+                WriteBlock(switchCase.Body.get());
+            }
+        } else if (auto* s = DMASTCast<DMASTProcStatementTryCatch>(statement)) {
+            Begin(NodeTag::ProcTryCatch, *s);
+            WriteBlock(s->TryBody.get());
+            WriteExpression(s->CatchVariable.get());
+            WriteBlock(s->CatchBody.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementThrow>(statement)) {
+            Begin(NodeTag::ProcThrow, *s);
+            WriteExpression(s->Value.get());
+        } else if (auto* s = DMASTCast<DMASTProcStatementSet>(statement)) {
+            Begin(NodeTag::ProcSet, *s);
+            WriteText(s->Attribute);
+            WriteExpression(s->Value.get());
+        } else if (auto* s = DMASTCast<DMASTObjectVarDefinition>(statement)) {
+            Begin(NodeTag::ObjectVarDefinition, *s);
+            WriteText(s->Name);
+            WriteASTPath(s->TypePath);
+            WriteExpression(s->Value.get());
+            WriteValueType(s->ExplicitValueType);
+        } else if (auto* s = DMASTCast<DMASTObjectVarOverride>(statement)) {
+            Begin(NodeTag::ObjectVarOverride, *s);
+            WriteText(s->VarName);
+            WriteExpression(s->Value.get());
+        } else if (auto* s = DMASTCast<DMASTObjectProcDefinition>(statement)) {
+            Begin(NodeTag::ObjectProcDefinition, *s);
+            WritePath(s->ObjectPath);
+            WriteText(s->Name);
+            WriteDefinitionParameters(s->Parameters);
+            WriteBlock(s->Body.get());
+            WriteBool(s->IsVerb);
+            if (!Segment_) {
+                return;
+            }
+            WriteBool(s->HasDeferredBody());
+            if (s->HasDeferredBody()) {
+                const auto& range = s->DeferredBody;
+                if (range.Begin < Segment_->Begin || range.End > Segment_->End) {
+                    Ok_ = false;
+                }
+                Body_.Write<uint64_t>(range.Begin - Segment_->Begin);
+                Body_.Write<uint64_t>(range.End - Segment_->Begin);
+                Body_.Write<int32_t>(range.BaseIndent);
+            }
+        } else if (auto* s = DMASTCast<DMASTObjectDefinition>(statement)) {
+            Begin(NodeTag::ObjectDefinition, *s);
+            WriteASTPath(s->Path);
+            WriteStatements(s->InnerStatements);
+        } else {
+            Unknown();
+        }
+    }
+
+    const ASTCache::Segment* Segment_;
+    std::vector<std::string>* Names_;
+    BinaryWriter Body_;
+    std::vector<uint32_t> Files_;
+    std::unordered_map<uint32_t, uint32_t> FileIndices_;
+    bool Ok_ = true;
+};
+
+// ============================================================================
+// Reading
+// ============================================================================
+
+/// Rebuilds a fragment written by FragmentWriter, placing its nodes in an arena.
+/// Fields are read into locals first, since argument evaluation order is unspecified
+// Every count is bounded by the bytes left: each node, parameter and block
+// takes at least its tag or presence byte, each string its length
+class FragmentReader {
+public:
+    FragmentReader(BinaryReader& reader, std::vector<uint32_t> fileIds,
+                   const ASTCache::Segment& segment, DMASTArena& arena)
+        : Reader_(reader), FileIds_(std::move(fileIds)), Segment_(segment), Arena_(arena) {}
+
+    std::unique_ptr<DMASTFile> ReadFile() {
+        Location loc = ReadLocation();
+        auto statements = ReadStatements<DMASTStatement>();
+        if (!Reader_.Ok()) {
+            return nullptr;
+        }
+        // The file itself stays on the heap, as DMParser::ParseFile leaves it
+        return std::make_unique<DMASTFile>(loc, std::move(statements));
+    }
+
+private:
+    template <typename T, typename... Args>
+    std::unique_ptr<T> New(Args&&... args) {
+        return std::unique_ptr<T>(new (Arena_) T(std::forward<Args>(args)...));
+    }
+
+    // File index, line, column and the DMStandard flag
+    static constexpr size_t LocationSize = 3 * sizeof(uint32_t) + 1;
+
+    bool ReadBool() { return Reader_.Read<uint8_t>() != 0; }
+    NodeTag ReadTag() { return static_cast<NodeTag>(Reader_.Read<uint8_t>()); }
+
+    Location ReadLocation() {
+        uint32_t index = Reader_.Read<uint32_t>();
+        int32_t line = Reader_.Read<int32_t>();
+        int32_t column = Reader_.Read<int32_t>();
+        bool inDMStandard = ReadBool();
+        if (index >= FileIds_.size()) {
+            Reader_.Fail();
+            return Location();
+        }
+        return Location(FileIds_[index], line, column, inDMStandard);
+    }
+
+    DreamPath ReadPath() {
+        auto type = static_cast<DreamPath::PathType>(Reader_.Read<uint8_t>());
+        uint32_t count = Reader_.ReadCount(sizeof(uint32_t));
+        std::vector<std::string> elements;
+        for (uint32_t i = 0; i < count && Reader_.Ok(); ++i) {
+            elements.push_back(Reader_.ReadString());
+        }
+        return DreamPath(type, elements);
+    }
+
+    std::optional<DreamPath> ReadOptionalPath() {
+        if (!ReadBool()) {
+            return std::nullopt;
+        }
+        return ReadPath();
+    }
+
+    std::optional<DMComplexValueType> ReadValueType() {
+        if (!ReadBool()) {
+            return std::nullopt;
+        }
+        DMComplexValueType type;
+        type.Type = static_cast<DMValueType>(Reader_.Read<uint32_t>());
+        type.TypePath = ReadOptionalPath();
+        type.IsUnimplemented = ReadBool();
+        type.IsUnsupported = ReadBool();
+        type.IsCompileTimeReadOnly = ReadBool();
+        return type;
+    }
+
+    DMASTPath ReadASTPath() {
+        Location loc = ReadLocation();
+        DreamPath path = ReadPath();
+        bool isOperator = ReadBool();
+        return DMASTPath(loc, path, isOperator);
+    }
+
+    std::vector<std::unique_ptr<DMASTCallParameter>> ReadCallParameters() {
+        uint32_t count = Reader_.ReadCount(1);
+        std::vector<std::unique_ptr<DMASTCallParameter>> parameters;
+        for (uint32_t i = 0; i < count && Reader_.Ok(); ++i) {
+            if (!ReadBool()) {
+                parameters.push_back(nullptr);
+                continue;
+            }
+            Location loc = ReadLocation();
+            auto value = ReadExpression();
+            auto key = ReadExpression();
+            parameters.push_back(New<DMASTCallParameter>(loc, std::move(value), std::move(key)));
+        }
+        return parameters;
+    }
+
+    std::vector<std::unique_ptr<DMASTDefinitionParameter>> ReadDefinitionParameters() {
+        uint32_t count = Reader_.ReadCount(1);
+        std::vector<std::unique_ptr<DMASTDefinitionParameter>> parameters;
+        for (uint32_t i = 0; i < count && Reader_.Ok(); ++i) {
+            if (!ReadBool()) {
+                parameters.push_back(nullptr);
+                continue;
+            }
+            Location loc = ReadLocation();
+            std::string name = Reader_.ReadString();
+            DreamPath typePath = ReadPath();
+            bool isList = ReadBool();
+            auto defaultValue = ReadExpression();
+            auto possibleValues = ReadExpression();
+            auto explicitValueType = ReadValueType();
+            parameters.push_back(New<DMASTDefinitionParameter>(loc, name, typePath, isList, std::move(defaultValue),
+                                                               std::move(possibleValues), explicitValueType));
+        }
+        return parameters;
+    }
+
+    template <typename Statement>
+    std::vector<std::unique_ptr<Statement>> ReadStatements() {
+        uint32_t count = Reader_.ReadCount(1);
+        std::vector<std::unique_ptr<Statement>> statements;
+        for (uint32_t i = 0; i < count && Reader_.Ok(); ++i) {
+            statements.push_back(ReadStatementAs<Statement>());
+        }
+        return statements;
+    }
+
+    std::unique_ptr<DMASTProcBlockInner> ReadBlock() {
+        if (!ReadBool()) {
+            return nullptr;
+        }
+        Location loc = ReadLocation();
+        auto statements = ReadStatements<DMASTProcStatement>();
+        auto setStatements = ReadStatements<DMASTProcStatement>();
+        return New<DMASTProcBlockInner>(loc, std::move(statements), std::move(setStatements));
+    }
+
+    // Whether a statement of this kind is a T, one of the abstract statement bases
+    template <typename T>
+    static bool IsStatementKind(DMASTNodeKind kind) {
+        if constexpr (std::is_same_v<T, DMASTProcStatement>) {
+            return IsProcStatementKind(kind);
+        } else if constexpr (std::is_same_v<T, DMASTObjectStatement>) {
+            return IsObjectStatementKind(kind);
+        } else {
+            static_assert(std::is_same_v<T, DMASTStatement>, "read as a statement base");
+            return true;
+        }
+    }
+
+    template <typename T>
+    std::unique_ptr<T> ReadStatementAs() {
+        std::unique_ptr<DMASTStatement> statement = ReadStatement();
+        if (!statement) {
+            return nullptr;
+        }
+        if (!IsStatementKind<T>(statement->Kind_)) {
+            Reader_.Fail();
+            return nullptr;
+        }
+        return std::unique_ptr<T>(static_cast<T*>(statement.release()));
+    }
+
+    std::unique_ptr<DMASTIdentifier> ReadIdentifier() {
+        std::unique_ptr<DMASTExpression> expr = ReadExpression();
+        if (!expr) {
+            return nullptr;
+        }
+        if (!DMASTCast<DMASTIdentifier>(expr.get())) {
+            Reader_.Fail();
+            return nullptr;
+        }
+        return std::unique_ptr<DMASTIdentifier>(static_cast<DMASTIdentifier*>(expr.release()));
+    }
+
+    std::unique_ptr<DMASTExpression> ReadExpression() {
+        NodeTag tag = ReadTag();
+        if (tag == NodeTag::Null || !Reader_.Ok()) {
+            return nullptr;
+        }
+        Location loc = ReadLocation();
+
+        switch (tag) {
+            case NodeTag::InvalidExpression:
+                return New<DMASTInvalidExpression>(loc);
+            case NodeTag::Void:
+                return New<DMASTVoid>(loc);
+            case NodeTag::Identifier: {
+                std::string name = Reader_.ReadString();
+                return New<DMASTIdentifier>(loc, name);
+            }
+            case NodeTag::ConstantInteger: {
+                int32_t value = Reader_.Read<int32_t>();
+                return New<DMASTConstantInteger>(loc, value);
+            }
+            case NodeTag::ConstantFloat: {
+                float value = Reader_.Read<float>();
+                return New<DMASTConstantFloat>(loc, value);
+            }
+            case NodeTag::ConstantString: {
+                std::string value = Reader_.ReadString();
+                return New<DMASTConstantString>(loc, value);
+            }
+            case NodeTag::StringFormat: {
+                uint32_t partCount = Reader_.ReadCount(sizeof(uint32_t));
+                std::vector<std::string> parts;
+                for (uint32_t i = 0; i < partCount && Reader_.Ok(); ++i) {
+                    parts.push_back(Reader_.ReadString());
+                }
+                uint32_t exprCount = Reader_.ReadCount(1);
+                std::vector<std::unique_ptr<DMASTExpression>> expressions;
+                for (uint32_t i = 0; i < exprCount && Reader_.Ok(); ++i) {
+                    expressions.push_back(ReadExpression());
+                }
+                return New<DMASTStringFormat>(loc, std::move(parts), std::move(expressions));
+            }
+            case NodeTag::ConstantResource: {
+                std::string path = Reader_.ReadString();
+                return New<DMASTConstantResource>(loc, path);
+            }
+            case NodeTag::ConstantNull:
+                return New<DMASTConstantNull>(loc);
+            case NodeTag::ConstantPath: {
+                DMASTPath path = ReadASTPath();
+                return New<DMASTConstantPath>(loc, path);
+            }
+            case NodeTag::Binary: {
+                auto op = static_cast<BinaryOperator>(Reader_.Read<uint8_t>());
+                auto left = ReadExpression();
+                auto right = ReadExpression();
+                return New<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
+            }
+            case NodeTag::Unary: {
+                auto op = static_cast<UnaryOperator>(Reader_.Read<uint8_t>());
+                auto expr = ReadExpression();
+                return New<DMASTExpressionUnary>(loc, op, std::move(expr));
+            }
+            case NodeTag::List: {
+                auto values = ReadCallParameters();
+                bool isAssociative = ReadBool();
+                return New<DMASTList>(loc, std::move(values), isAssociative);
+            }
+            case NodeTag::NewList: {
+                auto parameters = ReadCallParameters();
+                return New<DMASTNewList>(loc, std::move(parameters));
+            }
+            case NodeTag::NewPath: {
+                auto path = ReadExpression();
+                auto parameters = ReadCallParameters();
+                return New<DMASTNewPath>(loc, std::move(path), std::move(parameters));
+            }
+            case NodeTag::Call: {
+                auto target = ReadExpression();
+                auto parameters = ReadCallParameters();
+                auto call = New<DMASTCall>(loc, std::move(target), std::move(parameters));
+                call->InputTypes = static_cast<DMValueType>(Reader_.Read<uint32_t>());
+                call->InputList = ReadExpression();
+                call->IsInputCall = ReadBool();
+                return call;
+            }
+            case NodeTag::Dereference: {
+                auto expr = ReadExpression();
+                auto type = static_cast<DereferenceType>(Reader_.Read<uint8_t>());
+                auto property = ReadExpression();
+                return New<DMASTDereference>(loc, std::move(expr), type, std::move(property));
+            }
+            case NodeTag::Ternary: {
+                auto condition = ReadExpression();
+                auto trueExpr = ReadExpression();
+                auto falseExpr = ReadExpression();
+                return New<DMASTTernary>(loc, std::move(condition), std::move(trueExpr), std::move(falseExpr));
+            }
+            case NodeTag::Assign: {
+                auto lvalue = ReadExpression();
+                auto op = static_cast<AssignmentOperator>(Reader_.Read<uint8_t>());
+                auto value = ReadExpression();
+                return New<DMASTAssign>(loc, std::move(lvalue), op, std::move(value));
+            }
+            case NodeTag::SwitchCaseRange: {
+                auto rangeStart = ReadExpression();
+                auto rangeEnd = ReadExpression();
+                return New<DMASTSwitchCaseRange>(loc, std::move(rangeStart), std::move(rangeEnd));
+            }
+            default:
+                Reader_.Fail();
+                return nullptr;
+        }
+    }
+
+    std::unique_ptr<DMASTStatement> ReadStatement() {
+        NodeTag tag = ReadTag();
+        if (tag == NodeTag::Null || !Reader_.Ok()) {
+            return nullptr;
+        }
+        Location loc = ReadLocation();
+
+        switch (tag) {
+            case NodeTag::ProcExpression: {
+                auto expr = ReadExpression();
+                return New<DMASTProcStatementExpression>(loc, std::move(expr));
+            }
+            case NodeTag::ProcVarDeclaration: {
+                uint32_t count = Reader_.ReadCount(LocationSize);
+                std::vector<DMASTProcStatementVarDeclaration::Decl> decls;
+                for (uint32_t i = 0; i < count && Reader_.Ok(); ++i) {
+                    Location declLoc = ReadLocation();
+                    std::string name = Reader_.ReadString();
+                    auto typePath = ReadOptionalPath();
+                    auto value = ReadExpression();
+                    auto explicitValueType = ReadValueType();
+                    bool isList = ReadBool();
+                    decls.emplace_back(declLoc, name, typePath, std::move(value), explicitValueType, isList);
+                }
+                return New<DMASTProcStatementVarDeclaration>(loc, std::move(decls));
+            }
+            case NodeTag::ProcReturn: {
+                auto value = ReadExpression();
+                return New<DMASTProcStatementReturn>(loc, std::move(value));
+            }
+            case NodeTag::ProcBreak: {
+                auto label = ReadIdentifier();
+                return New<DMASTProcStatementBreak>(loc, std::move(label));
+            }
+            case NodeTag::ProcContinue: {
+                auto label = ReadIdentifier();
+                return New<DMASTProcStatementContinue>(loc, std::move(label));
+            }
+            case NodeTag::ProcGoto: {
+                auto label = ReadIdentifier();
+                return New<DMASTProcStatementGoto>(loc, std::move(label));
+            }
+            case NodeTag::ProcLabel: {
+                std::string name = Reader_.ReadString();
+                auto body = ReadStatementAs<DMASTProcStatement>();
+                return New<DMASTProcStatementLabel>(loc, name, std::move(body));
+            }
+            case NodeTag::ProcDel: {
+                auto value = ReadExpression();
+                return New<DMASTProcStatementDel>(loc, std::move(value));
+            }
+            case NodeTag::ProcSpawn: {
+                auto delay = ReadExpression();
+                auto body = ReadBlock();
+                return New<DMASTProcStatementSpawn>(loc, std::move(delay), std::move(body));
+            }
+            case NodeTag::ProcIf: {
+                auto condition = ReadExpression();
+                auto body = ReadBlock();
+                auto elseBody = ReadBlock();
+                return New<DMASTProcStatementIf>(loc, std::move(condition), std::move(body), std::move(elseBody));
+            }
+            case NodeTag::ProcFor: {
+                auto initializer = ReadStatementAs<DMASTProcStatement>();
+                auto condition = ReadExpression();
+                auto increment = ReadExpression();
+                auto body = ReadBlock();
+                return New<DMASTProcStatementFor>(loc, std::move(initializer), std::move(condition),
+                                                  std::move(increment), std::move(body));
+            }
+            case NodeTag::ProcForIn: {
+                auto variable = ReadExpression();
+                DMASTProcStatementForIn::VariableDeclaration varDecl;
+                varDecl.Loc = ReadLocation();
+                varDecl.Name = Reader_.ReadString();
+                varDecl.TypePath = ReadOptionalPath();
+                if (ReadBool()) {
+                    varDecl.TypeFilter = Reader_.ReadString();
+                }
+                auto list = ReadExpression();
+                auto body = ReadBlock();
+                return New<DMASTProcStatementForIn>(loc, std::move(variable), varDecl, std::move(list), std::move(body));
+            }
+            case NodeTag::ProcForRange: {
+                auto initializer = ReadExpression();
+                auto end = ReadExpression();
+                auto step = ReadExpression();
+                auto body = ReadBlock();
+                return New<DMASTProcStatementForRange>(loc, std::move(initializer), std::move(end),
+                                                       std::move(step), std::move(body));
+            }
+            case NodeTag::ProcWhile: {
+                auto condition = ReadExpression();
+                auto body = ReadBlock();
+                return New<DMASTProcStatementWhile>(loc, std::move(condition), std::move(body));
+            }
+            case NodeTag::ProcDoWhile: {
+                auto body = ReadBlock();
+                auto condition = ReadExpression();
+                return New<DMASTProcStatementDoWhile>(loc, std::move(body), std::move(condition));
+            }
+            case NodeTag::ProcSwitch: {
+                auto value = ReadExpression();
+                uint32_t caseCount = Reader_.ReadCount(sizeof(uint32_t) + 1);
+                std::vector<DMASTProcStatementSwitch::SwitchCase> cases;
+                for (uint32_t i = 0; i < caseCount && Reader_.Ok(); ++i) {
+                    DMASTProcStatementSwitch::SwitchCase switchCase;
+                    uint32_t valueCount = Reader_.ReadCount(1);
+                    for (uint32_t j = 0; j < valueCount && Reader_.Ok(); ++j) {
+                        switchCase.Values.push_back(ReadExpression());
+                    }
+                    switchCase.Body = ReadBlock();
+                    cases.push_back(std::move(switchCase));
+                }
+                return New<DMASTProcStatementSwitch>(loc, std::move(value), std::move(cases));
+            }
+            case NodeTag::ProcTryCatch: {
+                auto tryBody = ReadBlock();
+                auto catchVariable = ReadIdentifier();
+                auto catchBody = ReadBlock();
+                return New<DMASTProcStatementTryCatch>(loc, std::move(tryBody), std::move(catchVariable),
+                                                       std::move(catchBody));
+            }
+            case NodeTag::ProcThrow: {
+                auto value = ReadExpression();
+                return New<DMASTProcStatementThrow>(loc, std::move(value));
+            }
+            case NodeTag::ProcSet: {
+                std::string attribute = Reader_.ReadString();
+                auto value = ReadExpression();
+                return New<DMASTProcStatementSet>(loc, attribute, std::move(value));
+            }
+            case NodeTag::ObjectVarDefinition: {
+                std::string name = Reader_.ReadString();
+                DMASTPath typePath = ReadASTPath();
+                auto value = ReadExpression();
+                auto explicitValueType = ReadValueType();
+                return New<DMASTObjectVarDefinition>(loc, name, typePath, std::move(value), explicitValueType);
+            }
+            case NodeTag::ObjectVarOverride: {
+                std::string varName = Reader_.ReadString();
+                auto value = ReadExpression();
+                return New<DMASTObjectVarOverride>(loc, varName, std::move(value));
+            }
+            case NodeTag::ObjectProcDefinition: {
+                DreamPath objectPath = ReadPath();
+                std::string name = Reader_.ReadString();
+                auto parameters = ReadDefinitionParameters();
+                auto body = ReadBlock();
+                bool isVerb = ReadBool();
+                auto procDef = New<DMASTObjectProcDefinition>(loc, objectPath, name, std::move(parameters),
+                                                              std::move(body), isVerb);
+                if (ReadBool()) {
+                    // Stored relative to the segment, which holds the same tokens in this build
+                    auto& range = procDef->DeferredBody;
+                    range.Begin = Segment_.Begin + Reader_.Read<uint64_t>();
+                    range.End = Segment_.Begin + Reader_.Read<uint64_t>();
+                    range.BaseIndent = Reader_.Read<int32_t>();
+                    if (range.End > Segment_.End || range.Begin > range.End) {
+                        Reader_.Fail();
+                    }
+                }
+                return procDef;
+            }
+            case NodeTag::ObjectDefinition: {
+                DMASTPath path = ReadASTPath();
+                auto innerStatements = ReadStatements<DMASTObjectStatement>();
+                return New<DMASTObjectDefinition>(loc, path, std::move(innerStatements));
+            }
+            default:
+                Reader_.Fail();
+                return nullptr;
+        }
+    }
+
+    BinaryReader& Reader_;
+    std::vector<uint32_t> FileIds_;
+    const ASTCache::Segment& Segment_;
+    DMASTArena& Arena_;
+};
+
+} // namespace
+
+// ============================================================================
+// ASTCache
+// ============================================================================
+
+ASTCache::ASTCache(std::string directory, bool deferredBodies)
+    : Directory_(std::move(directory))
+    , DeferredBodies_(deferredBodies)
+{
+    std::error_code ec;
+    fs::create_directories(Directory_, ec);
+}
+
+std::vector<ASTCache::Segment> ASTCache::FindSegments(const TokenBuffer& tokens) {
+    std::vector<Segment> segments;
+    if (tokens.empty()) {
+        return segments;
+    }
+
+    // A definition that starts in another file than the one before it starts a new segment
+    for (size_t start : ParallelParser::FindChunkStarts(tokens, 1)) {
+        if (!segments.empty() && tokens.At(start).FileId == tokens.At(segments.back().Begin).FileId) {
+            continue;
+        }
+        if (!segments.empty()) {
+            segments.back().End = start;
+        }
+        Segment segment;
+        segment.Begin = start;
+        segment.End = tokens.size();
+        segments.push_back(segment);
+    }
+
+    for (auto& segment : segments) {
+        segment.Hash = HashTokens(tokens, segment.Begin, segment.End);
+    }
+    return segments;
+}
+
+std::string ASTCache::EntryPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.ast", static_cast<unsigned long long>(hash));
+    return (fs::path(Directory_) / name).string();
+}
+
+std::unique_ptr<DMASTFile> ASTCache::Load(const Segment& segment) const {
+    std::string data;
+    if (!ReadBinaryFile(EntryPath(segment.Hash), data)) {
+        return nullptr;
+    }
+
+    BinaryReader reader(data);
+    if (!reader.VerifyChecksum() ||
+        !reader.Expect(CacheMagic, sizeof(CacheMagic)) ||
+        reader.Read<uint32_t>() != CacheFormatVersion ||
+        reader.Read<uint32_t>() != static_cast<uint32_t>(Versions::PARSER_VERSION) ||
+        reader.Read<uint8_t>() != (DeferredBodies_ ? 1 : 0) ||
+        reader.Read<uint64_t>() != segment.End - segment.Begin ||
+        reader.Read<uint64_t>() != segment.Hash) {
+        return nullptr;
+    }
+
+    std::vector<uint32_t> fileIds;
+    uint32_t fileCount = reader.ReadCount(sizeof(uint32_t));
+    for (uint32_t i = 0; i < fileCount && reader.Ok(); ++i) {
+        fileIds.push_back(SourceFileRegistry::Register(reader.ReadString()));
+    }
+
+    // Declared before the file so a partly read tree is destroyed first
+    auto arena = std::make_unique<DMASTArena>();
+    FragmentReader fragmentReader(reader, std::move(fileIds), segment, *arena);
+    std::unique_ptr<DMASTFile> file = fragmentReader.ReadFile();
+    if (!file || !reader.Ok() || !reader.AtEnd()) {
+        return nullptr;
+    }
+    file->Arena = std::move(arena);
+    return file;
+}
+
+void ASTCache::Store(const Segment& segment, const DMASTFile& fragment) const {
+    FragmentWriter fragmentWriter(&segment);
+    fragmentWriter.WriteFile(fragment);
+    if (!fragmentWriter.Ok()) {
+        return;
+    }
+
+    BinaryWriter writer;
+    writer.Reserve(64 + fragmentWriter.Data().size());
+    writer.WriteBytes(CacheMagic, sizeof(CacheMagic));
+    writer.Write<uint32_t>(CacheFormatVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(Versions::PARSER_VERSION));
+    writer.Write<uint8_t>(DeferredBodies_ ? 1 : 0);
+    writer.Write<uint64_t>(segment.End - segment.Begin);
+    writer.Write<uint64_t>(segment.Hash);
+    writer.Write<uint32_t>(static_cast<uint32_t>(fragmentWriter.Files().size()));
+    for (uint32_t fileId : fragmentWriter.Files()) {
+        writer.WriteString(SourceFileRegistry::GetPath(fileId));
+    }
+    writer.WriteBytes(fragmentWriter.Data().data(), fragmentWriter.Data().size());
+    writer.WriteChecksum();
+
+    // Written through a temporary, so concurrent compilers never see a partial entry
+    WriteBinaryFileAtomic(EntryPath(segment.Hash), writer.Data());
+}
+
+bool ASTCache::HashProc(const std::vector<DMASTDefinitionParameter*>& parameters, const DMASTProcBlockInner* body,
+                        uint64_t& hash, std::vector<std::string>* names) {
+    FragmentWriter writer(nullptr, names);
+    writer.WriteProc(parameters, body);
+    TokenHash data;
+    data.AddString(writer.Data());
+    hash = data.Value;
+    return writer.Ok();
+}
+
+bool ASTCache::HashExpression(const DMASTExpression* expression, uint64_t& hash) {
+    FragmentWriter writer(nullptr);
+    writer.WriteValue(expression);
+    TokenHash data;
+    data.AddString(writer.Data());
+    hash = data.Value;
+    return writer.Ok();
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,228 @@
+#include "BatchCompiler.h"
+#include "ResourceManifest.h"
+#include "TokenCache.h"
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Buffer the calling thread's target writes its console output to
+thread_local std::string* TargetOutput = nullptr;
+
+// Put under std::cout and std::cerr while a batch runs: a target's thread
+// writes to its own buffer, any other thread to the console
+class TargetConsole : public std::streambuf {
+public:
+    TargetConsole(std::streambuf* console, std::mutex& mutex) : Console_(console), Mutex_(mutex) {}
+
+protected:
+    int_type overflow(int_type c) override {
+        if (traits_type::eq_int_type(c, traits_type::eof())) {
+            return traits_type::not_eof(c);
+        }
+        char ch = traits_type::to_char_type(c);
+        return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (TargetOutput) {
+            TargetOutput->append(s, static_cast<size_t>(n));
+            return n;
+        }
+        std::lock_guard<std::mutex> lock(Mutex_);
+        return Console_->sputn(s, n);
+    }
+
+    int sync() override {
+        if (TargetOutput) {
+            return 0;
+        }
+        std::lock_guard<std::mutex> lock(Mutex_);
+        return Console_->pubsync();
+    }
+
+private:
+    std::streambuf* Console_;
+    std::mutex& Mutex_;
+};
+
+// Routes std::cout and std::cerr through TargetConsole while it lives
+class BatchConsole {
+public:
+    BatchConsole()
+        : Out_(std::cout.rdbuf(), Mutex_), Err_(std::cerr.rdbuf(), Mutex_)
+        , OutPrevious_(std::cout.rdbuf(&Out_)), ErrPrevious_(std::cerr.rdbuf(&Err_)) {}
+    ~BatchConsole() {
+        std::cout.flush();
+        std::cout.rdbuf(OutPrevious_);
+        std::cerr.rdbuf(ErrPrevious_);
+    }
+    BatchConsole(const BatchConsole&) = delete;
+    BatchConsole& operator=(const BatchConsole&) = delete;
+
+private:
+    std::mutex Mutex_;
+    TargetConsole Out_;
+    TargetConsole Err_;
+    std::streambuf* OutPrevious_;
+    std::streambuf* ErrPrevious_;
+};
+
+} // namespace
+
+BatchCompiler::BatchCompiler(std::string cacheDir, ArgumentParser parseArguments)
+    : CacheDir_(fs::absolute(cacheDir).string())
+    , ParseArguments_(std::move(parseArguments))
+    , WarmState_(std::make_shared<DMCompilerWarmState>())
+{
+    WarmState_->Tokens = std::make_shared<TokenCache>((fs::path(CacheDir_) / "tokens").string(), true);
+    WarmState_->Resources = std::make_shared<ResourceHashIndex>();
+}
+
+bool BatchCompiler::LoadTargets(const std::string& path, std::vector<Target>& targets, std::string& error) {
+    std::string data;
+    if (!ReadBinaryFile(path, data)) {
+        error = "Failed to read batch file: " + path;
+        return false;
+    }
+    auto json = nlohmann::json::parse(data, nullptr, false);
+    if (!json.is_object() || !json.contains("Targets") || !json["Targets"].is_array()) {
+        error = "Batch file has no \"Targets\" array: " + path;
+        return false;
+    }
+
+    targets.clear();
+    for (const auto& entry : json["Targets"]) {
+        if (!entry.is_object() || !entry.contains("Args") || !entry["Args"].is_array() || entry["Args"].empty()) {
+            error = "Batch target without \"Args\" in " + path;
+            return false;
+        }
+        Target target;
+        for (const auto& arg : entry["Args"]) {
+            if (!arg.is_string()) {
+                error = "Batch target with an argument that is not a string in " + path;
+                return false;
+            }
+            target.Args.push_back(arg.get<std::string>());
+        }
+        target.Name = entry.contains("Name") && entry["Name"].is_string() ? entry["Name"].get<std::string>()
+                                                                          : target.Args.back();
+        targets.push_back(std::move(target));
+    }
+    if (targets.empty()) {
+        error = "Batch file lists no targets: " + path;
+        return false;
+    }
+    return true;
+}
+
+std::vector<BatchCompiler::Result> BatchCompiler::Compile(const std::vector<Target>& targets, unsigned threadCount,
+                                                          std::ostream& out) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<unsigned>(threadCount, static_cast<unsigned>(targets.size()));
+
+    auto batchStart = std::chrono::steady_clock::now();
+    std::vector<Result> results(targets.size());
+    std::mutex mutex;  // Guards outputs and writes to out
+    std::map<std::string, size_t> outputs;  // Output path each started target writes, and the target
+    std::atomic<size_t> next{0};
+
+    auto compileTarget = [&](size_t index) {
+        const Target& target = targets[index];
+        Result& result = results[index];
+        result.Name = target.Name;
+
+        auto start = std::chrono::steady_clock::now();
+        DMCompiler compiler;
+        TargetOutput = &result.Output;
+        DMCompilerSettings settings;
+        if (ParseArguments_(target.Args, settings)) {
+            if (settings.TokenCacheDir.empty()) {
+                settings.TokenCacheDir = WarmState_->Tokens->GetDirectory();
+            }
+            if (settings.StandardSnapshotPath.empty()) {
+                settings.StandardSnapshotPath = (fs::path(CacheDir_) / "standard.dmss").string();
+            }
+
+            std::string outputPath = fs::absolute(fs::path(settings.OutputPath.empty() ? settings.Files[0]
+                                                                                      : settings.OutputPath)
+                                                      .replace_extension(".json"))
+                                         .lexically_normal()
+                                         .string();
+            std::string claimedBy;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                auto claim = outputs.emplace(outputPath, index);
+                if (!claim.second) {
+                    claimedBy = targets[claim.first->second].Name;
+                }
+            }
+            if (!claimedBy.empty()) {
+                std::cerr << "Error: Target " << target.Name << " writes " << outputPath << " as target " << claimedBy
+                          << " does; name its output with --output" << std::endl;
+            } else {
+                compiler.SetWarmState(WarmState_);
+                try {
+                    result.Success = compiler.Compile(settings);
+                } catch (const std::exception& e) {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+            }
+        }
+        std::cout.flush();
+        TargetOutput = nullptr;
+
+        result.Errors = compiler.GetErrorCount();
+        result.Warnings = compiler.GetWarningCount();
+        result.Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::ostringstream block;
+        block << "=== " << target.Name << ": " << (result.Success ? "succeeded" : "failed") << " ("
+              << result.Errors << " errors, " << result.Warnings << " warnings, "
+              << static_cast<long long>(result.Ms) << " ms) ===\n"
+              << result.Output;
+        std::lock_guard<std::mutex> lock(mutex);
+        out << block.str() << std::flush;
+    };
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < targets.size(); i = next.fetch_add(1)) {
+            compileTarget(i);
+        }
+    };
+
+    {
+        BatchConsole console;
+        std::vector<std::thread> threads;
+        for (unsigned i = 1; i < threadCount; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    size_t succeeded = std::count_if(results.begin(), results.end(), [](const Result& result) { return result.Success; });
+    out << "Batch: " << succeeded << " of " << targets.size() << " targets succeeded on " << threadCount
+        << " threads in "
+        << static_cast<long long>(
+               std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batchStart).count())
+        << " ms" << std::endl;
+    return results;
+}
+
+} // namespace DMCompiler
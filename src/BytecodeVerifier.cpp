@@ -0,0 +1,208 @@
+#include "BytecodeVerifier.h"
+#include "DMReference.h"
+#include "OpcodeDefinitions.h"
+#include "StackDepthAnalysis.h"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+
+namespace DMCompiler {
+
+namespace {
+
+// ..() is written with a SuperProc reference the opcode table does not list
+constexpr uint8_t SuperProcReferenceType = 7;
+constexpr size_t SuperCallLength = 7;
+
+struct VerifiedInstruction {
+    size_t Start = 0;
+    BytecodeInstruction Fixed;  // In OperandEncoding::Fixed, which StackDepthAnalysis reads
+    bool Jumps = false;
+    int64_t Destination = 0;    // Byte its label points at
+    size_t Target = 0;          // Index of the instruction there, or the count for the end
+};
+
+std::string Describe(const std::vector<uint8_t>& bytecode, size_t start, const std::string& problem) {
+    std::ostringstream description;
+    description << problem << " at byte " << start << " (opcode 0x" << std::hex << static_cast<int>(bytecode[start])
+                << ")";
+    return description.str();
+}
+
+void AppendInt(std::vector<uint8_t>& bytes, uint32_t value) {
+    for (size_t i = 0; i < 4; ++i) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+} // namespace
+
+std::string BytecodeVerifier::Verify(const std::vector<uint8_t>& bytecode, int maxStackSize) const {
+    std::vector<VerifiedInstruction> instructions;
+    for (size_t pc = 0; pc < bytecode.size();) {
+        VerifiedInstruction instruction;
+        instruction.Start = pc;
+        instruction.Fixed.Opcode = static_cast<DreamProcOpcode>(bytecode[pc]);
+        if (instruction.Fixed.Opcode == DreamProcOpcode::CallStatement && pc + 1 < bytecode.size() &&
+            bytecode[pc + 1] == SuperProcReferenceType) {
+            if (bytecode.size() - pc < SuperCallLength) {
+                return Describe(bytecode, pc, "the instruction runs past the end of the proc");
+            }
+            instruction.Fixed.Bytes.assign(bytecode.begin() + static_cast<std::ptrdiff_t>(pc),
+                                           bytecode.begin() + static_cast<std::ptrdiff_t>(pc + SuperCallLength));
+            instructions.push_back(std::move(instruction));
+            pc += SuperCallLength;
+            continue;
+        }
+
+        DecodedInstruction decoded = DecodeInstruction(bytecode, pc, Encoding_);
+        if (!HasOpcodeMetadata(decoded.Opcode)) {
+            return Describe(bytecode, pc, "unknown opcode");
+        }
+        if (decoded.Truncated) {
+            return Describe(bytecode, pc, "the instruction runs past the end of the proc");
+        }
+
+        instruction.Fixed.Bytes.push_back(bytecode[pc]);
+        for (size_t i = 0; i < decoded.OperandCount; ++i) {
+            const OperandSpan& operand = decoded.Operands[i];
+            uint32_t value = ReadOperandValue(bytecode, pc, operand, Encoding_);
+            size_t limit = std::numeric_limits<size_t>::max();
+            const char* table = "";
+            switch (operand.Type) {
+                case OpcodeArgType::String:
+                case OpcodeArgType::Resource:
+                    limit = Tables_.Strings;
+                    table = "string";
+                    break;
+                case OpcodeArgType::TypeId:
+                    // A bare new pushes its type by string ID
+                    limit = std::max(Tables_.Types, Tables_.Strings);
+                    table = "type";
+                    break;
+                case OpcodeArgType::ProcId:
+                    limit = Tables_.Procs;
+                    table = "proc";
+                    break;
+                case OpcodeArgType::Label:
+                    // Offsets count from the end of the offset
+                    instruction.Jumps = true;
+                    instruction.Destination = static_cast<int64_t>(pc + operand.Offset + operand.Length) +
+                                              static_cast<int32_t>(value);
+                    break;
+                case OpcodeArgType::Reference:
+                    if (operand.Length != 5) {
+                        break;
+                    }
+                    switch (static_cast<DMReference::Type>(bytecode[pc + operand.Offset])) {
+                        case DMReference::Type::Field:
+                        case DMReference::Type::SrcField:
+                        case DMReference::Type::SrcProc:
+                            limit = Tables_.Strings;
+                            table = "string";
+                            break;
+                        case DMReference::Type::Global:
+                            limit = Tables_.Globals;
+                            table = "global";
+                            break;
+                        case DMReference::Type::GlobalProc:
+                            // An assignment to a var of src can write its name with this type byte
+                            limit = std::max(Tables_.Procs, Tables_.Strings);
+                            table = "proc";
+                            break;
+                        default:
+                            break;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            if (value >= limit) {
+                return Describe(bytecode, pc, "operand " + std::to_string(i + 1) + " names " + table + " " +
+                                                  std::to_string(value) + " of " + std::to_string(limit));
+            }
+
+            if (Encoding_ == OperandEncoding::Leb128 && IsCompactOperand(operand.Type)) {
+                AppendInt(instruction.Fixed.Bytes, value);
+            } else {
+                auto begin = bytecode.begin() + static_cast<std::ptrdiff_t>(pc + operand.Offset);
+                instruction.Fixed.Bytes.insert(instruction.Fixed.Bytes.end(), begin,
+                                               begin + static_cast<std::ptrdiff_t>(operand.Length));
+            }
+        }
+        instructions.push_back(std::move(instruction));
+        pc += decoded.Length;
+    }
+
+    // Jumping to the end of the proc returns
+    for (auto& instruction : instructions) {
+        if (!instruction.Jumps) {
+            continue;
+        }
+        if (instruction.Destination < 0 || instruction.Destination > static_cast<int64_t>(bytecode.size())) {
+            return Describe(bytecode, instruction.Start,
+                            "jump to byte " + std::to_string(instruction.Destination) + ", outside the proc");
+        }
+        auto target = std::lower_bound(instructions.begin(), instructions.end(), instruction.Destination,
+                                       [](const VerifiedInstruction& other, int64_t destination) {
+                                           return static_cast<int64_t>(other.Start) < destination;
+                                       });
+        instruction.Target = static_cast<size_t>(target - instructions.begin());
+        if (target != instructions.end() && static_cast<int64_t>(target->Start) != instruction.Destination) {
+            return Describe(bytecode, instruction.Start,
+                            "jump into the middle of the instruction at byte " + std::to_string(target[-1].Start));
+        }
+    }
+
+    std::vector<int> depths(instructions.size(), -1);
+    std::vector<size_t> worklist;
+    if (!instructions.empty()) {
+        depths[0] = 0;
+        worklist.push_back(0);
+    }
+    std::string problem;
+    auto reach = [&](size_t from, size_t target, int depth) {
+        if (depth < 0) {
+            problem = Describe(bytecode, instructions[from].Start, "takes more values than the stack holds");
+        } else if (depth > maxStackSize) {
+            problem = Describe(bytecode, instructions[from].Start,
+                               "needs a stack of " + std::to_string(depth) + ", more than its max stack size of " +
+                                   std::to_string(maxStackSize));
+        } else if (target < depths.size() && depths[target] < 0) {
+            depths[target] = depth;
+            worklist.push_back(target);
+        } else if (target < depths.size() && depths[target] != depth) {
+            problem = Describe(bytecode, instructions[target].Start,
+                               "reached at stack depths " + std::to_string(depths[target]) + " and " +
+                                   std::to_string(depth));
+        }
+        return problem.empty();
+    };
+    while (!worklist.empty()) {
+        size_t i = worklist.back();
+        worklist.pop_back();
+        const VerifiedInstruction& instruction = instructions[i];
+
+        // Past an instruction the table cannot size, the depth is unknown
+        auto effect = StackDepthAnalysis::StackEffect(instruction.Fixed);
+        if (!effect) {
+            continue;
+        }
+        int depth = depths[i] + *effect;
+        if (!ControlFlowGraph::EndsFlow(instruction.Fixed.Opcode) && !reach(i, i + 1, depth)) {
+            return problem;
+        }
+        if (ControlFlowGraph::EndsFlow(instruction.Fixed.Opcode) && !reach(i, instructions.size(), depth)) {
+            return problem;
+        }
+        if (instruction.Jumps) {
+            auto jumpEffect = StackDepthAnalysis::JumpStackEffect(instruction.Fixed);
+            if (jumpEffect && !reach(i, instruction.Target, depths[i] + *jumpEffect)) {
+                return problem;
+            }
+        }
+    }
+    return std::string();
+}
+
+} // namespace DMCompiler
@@ -1,51 +1,58 @@
 #include "BytecodeWriter.h"
+#include "ControlFlowGraph.h"
+#include "DMObjectTree.h"
+#include "OpcodeDefinitions.h"
+#include "OperandEncoding.h"
+#include "StackDepthAnalysis.h"
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <sstream>
 #include <stdexcept>
 #include <iostream>
 
 namespace DMCompiler {
 
-BytecodeWriter::BytecodeWriter()
-    : NextLabelId_(0)
+BytecodeWriter::BytecodeWriter(DMObjectTree* objectTree)
+    : ObjectTree_(objectTree)
+    , NextLabelId_(0)
     , CurrentStackSize_(0)
     , MaxStackSize_(0) {
 }
 
 void BytecodeWriter::Emit(DreamProcOpcode opcode) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
 }
 
 void BytecodeWriter::EmitByte(DreamProcOpcode opcode, uint8_t value) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     WriteByte(value);
 }
 
 void BytecodeWriter::EmitShort(DreamProcOpcode opcode, uint16_t value) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     WriteShort(value);
 }
 
 void BytecodeWriter::EmitInt(DreamProcOpcode opcode, int32_t value) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     WriteInt(value);
 }
 
 void BytecodeWriter::EmitFloat(DreamProcOpcode opcode, float value) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     WriteFloat(value);
 }
 
 void BytecodeWriter::EmitString(DreamProcOpcode opcode, const std::string& value) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     int stringId = GetStringId(value);
     WriteInt(stringId);
 }
 
-void BytecodeWriter::EmitMulti(DreamProcOpcode opcode, const std::vector<uint8_t>& operands) {
-    WriteByte(static_cast<uint8_t>(opcode));
-    for (uint8_t operand : operands) {
-        WriteByte(operand);
-    }
+void BytecodeWriter::EmitMulti(DreamProcOpcode opcode, const OperandBytes& operands) {
+    WriteOpcode(opcode);
+    Bytecode_.insert(Bytecode_.end(), operands.begin(), operands.end());
 }
 
 int BytecodeWriter::CreateLabel() {
@@ -56,8 +63,12 @@ void BytecodeWriter::MarkLabel(int labelId) {
     LabelPositions_[labelId] = Bytecode_.size();
 }
 
+void BytecodeWriter::ContinueLabelsFrom(const BytecodeWriter& other) {
+    NextLabelId_ = std::max(NextLabelId_, other.NextLabelId_);
+}
+
 void BytecodeWriter::EmitJump(DreamProcOpcode opcode, int labelId) {
-    WriteByte(static_cast<uint8_t>(opcode));
+    WriteOpcode(opcode);
     
     // Reserve space for the jump offset (4 bytes for int32)
     size_t jumpPosition = Bytecode_.size();
@@ -67,13 +78,11 @@ void BytecodeWriter::EmitJump(DreamProcOpcode opcode, int labelId) {
     PendingJumps_.push_back({jumpPosition, labelId, opcode});
 }
 
-void BytecodeWriter::EmitJumpWithReference(DreamProcOpcode opcode, const std::vector<uint8_t>& refBytes, int labelId) {
-    WriteByte(static_cast<uint8_t>(opcode));
+void BytecodeWriter::EmitJumpWithReference(DreamProcOpcode opcode, const OperandBytes& refBytes, int labelId) {
+    WriteOpcode(opcode);
     
     // Emit reference bytes
-    for (uint8_t byte : refBytes) {
-        WriteByte(byte);
-    }
+    Bytecode_.insert(Bytecode_.end(), refBytes.begin(), refBytes.end());
     
     // Reserve space for the jump offset (4 bytes for int32)
     size_t jumpPosition = Bytecode_.size();
@@ -83,6 +92,24 @@ void BytecodeWriter::EmitJumpWithReference(DreamProcOpcode opcode, const std::ve
     PendingJumps_.push_back({jumpPosition, labelId, opcode});
 }
 
+void BytecodeWriter::EmitJumpWithFloat(DreamProcOpcode opcode, float value, int labelId) {
+    WriteOpcode(opcode);
+    WriteFloat(value);
+    
+    size_t jumpPosition = Bytecode_.size();
+    WriteInt(0);  // Placeholder, will be fixed up in Finalize()
+    PendingJumps_.push_back({jumpPosition, labelId, opcode});
+}
+
+void BytecodeWriter::EmitJumpWithString(DreamProcOpcode opcode, const std::string& value, int labelId) {
+    WriteOpcode(opcode);
+    WriteInt(GetStringId(value));
+    
+    size_t jumpPosition = Bytecode_.size();
+    WriteInt(0);  // Placeholder, will be fixed up in Finalize()
+    PendingJumps_.push_back({jumpPosition, labelId, opcode});
+}
+
 void BytecodeWriter::Finalize() {
     // Fix up all pending jumps
     for (const auto& jump : PendingJumps_) {
@@ -106,35 +133,607 @@ void BytecodeWriter::Finalize() {
     PendingJumps_.clear();
 }
 
-int BytecodeWriter::GetStringId(const std::string& str) {
-    auto it = StringTable_.find(str);
-    if (it != StringTable_.end()) {
-        return it->second;
+namespace {
+
+// Two instructions that run as one: the fused opcode takes First's operands
+struct FusionRule {
+    DreamProcOpcode First;
+    DreamProcOpcode Second;
+    DreamProcOpcode Fused;
+};
+
+const FusionRule FusionRules[] = {
+    {DreamProcOpcode::Assign, DreamProcOpcode::Pop, DreamProcOpcode::AssignNoPush},
+    {DreamProcOpcode::Append, DreamProcOpcode::Pop, DreamProcOpcode::AppendNoPush},
+    {DreamProcOpcode::PushFloat, DreamProcOpcode::Return, DreamProcOpcode::ReturnFloat},
+    {DreamProcOpcode::PushReferenceValue, DreamProcOpcode::Return, DreamProcOpcode::ReturnReferenceValue},
+};
+
+// A rule only holds if the opcode table agrees the fused opcode reads the
+// same operands and leaves the stack as the pair did
+bool FusionMatchesMetadata(const FusionRule& rule) {
+    const OpcodeMetadata& first = GetOpcodeMetadata(rule.First);
+    const OpcodeMetadata& second = GetOpcodeMetadata(rule.Second);
+    const OpcodeMetadata& fused = GetOpcodeMetadata(rule.Fused);
+    return second.ArgType1 == OpcodeArgType::None &&
+           fused.ArgType1 == first.ArgType1 && fused.ArgType2 == first.ArgType2 &&
+           fused.ArgType3 == first.ArgType3 && fused.ArgType4 == first.ArgType4 &&
+           fused.StackDelta == first.StackDelta + second.StackDelta;
+}
+
+bool IsConstantOperand(OpcodeArgType type) {
+    switch (type) {
+        case OpcodeArgType::None:
+        case OpcodeArgType::TypeId:
+        case OpcodeArgType::String:
+        case OpcodeArgType::Resource:
+        case OpcodeArgType::ProcId:
+        case OpcodeArgType::Float:
+            return true;
+        default:
+            return false;
     }
-    
-    // Add new string to table
-    int id = static_cast<int>(Strings_.size());
-    StringTable_[str] = id;
-    Strings_.push_back(str);
-    return id;
+}
+
+// Pushes one value and reads nothing but its own constant operands
+bool IsPurePush(DreamProcOpcode opcode) {
+    const OpcodeMetadata& metadata = GetOpcodeMetadata(opcode);
+    return metadata.StackDelta == 1 &&
+           IsConstantOperand(metadata.ArgType1) && IsConstantOperand(metadata.ArgType2) &&
+           IsConstantOperand(metadata.ArgType3) && IsConstantOperand(metadata.ArgType4);
+}
+
+float ReadFloatOperand(const BytecodeInstruction& instruction) {
+    uint32_t bits = static_cast<uint32_t>(instruction.Bytes[1]) |
+                    (static_cast<uint32_t>(instruction.Bytes[2]) << 8) |
+                    (static_cast<uint32_t>(instruction.Bytes[3]) << 16) |
+                    (static_cast<uint32_t>(instruction.Bytes[4]) << 24);
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
+BytecodeInstruction MakePushFloat(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    BytecodeInstruction instruction;
+    instruction.Opcode = DreamProcOpcode::PushFloat;
+    instruction.Bytes = {
+        static_cast<uint8_t>(DreamProcOpcode::PushFloat),
+        static_cast<uint8_t>(bits & 0xFF), static_cast<uint8_t>((bits >> 8) & 0xFF),
+        static_cast<uint8_t>((bits >> 16) & 0xFF), static_cast<uint8_t>((bits >> 24) & 0xFF)
+    };
+    return instruction;
+}
+
+bool IsPushFloat(const BytecodeInstruction& instruction) {
+    return instruction.Opcode == DreamProcOpcode::PushFloat && instruction.Bytes.size() == 5;
+}
+
+std::optional<bool> CompareFloats(DreamProcOpcode opcode, float left, float right) {
+    if (std::isnan(left) || std::isnan(right)) {
+        return std::nullopt;
+    }
+    switch (opcode) {
+        case DreamProcOpcode::CompareEquals:
+        case DreamProcOpcode::CompareEquivalent:
+            return left == right;
+        case DreamProcOpcode::CompareNotEquals:
+        case DreamProcOpcode::CompareNotEquivalent:
+            return left != right;
+        case DreamProcOpcode::CompareLessThan:
+            return left < right;
+        case DreamProcOpcode::CompareGreaterThan:
+            return left > right;
+        case DreamProcOpcode::CompareLessThanOrEqual:
+            return left <= right;
+        case DreamProcOpcode::CompareGreaterThanOrEqual:
+            return left >= right;
+        default:
+            return std::nullopt;
+    }
+}
+
+// Pairs the runtime also runs as one instruction, reading First's operands and
+// then Second's. Only fused after everything else, since the other rules and
+// the dead store pass no longer recognise the pair once it is one opcode.
+const FusionRule Superinstructions[] = {
+    {DreamProcOpcode::PushReferenceValue, DreamProcOpcode::DereferenceField, DreamProcOpcode::PushRefAndDereferenceField},
+    {DreamProcOpcode::PushReferenceValue, DreamProcOpcode::JumpIfFalse, DreamProcOpcode::JumpIfReferenceFalse},
+    {DreamProcOpcode::PushString, DreamProcOpcode::PushFloat, DreamProcOpcode::PushStringFloat},
+};
+
+std::vector<OpcodeArgType> ArgTypes(const OpcodeMetadata& metadata) {
+    std::vector<OpcodeArgType> types;
+    for (OpcodeArgType type : {metadata.ArgType1, metadata.ArgType2, metadata.ArgType3, metadata.ArgType4}) {
+        if (type != OpcodeArgType::None) {
+            types.push_back(type);
+        }
+    }
+    return types;
+}
+
+bool SuperinstructionMatchesMetadata(const FusionRule& rule) {
+    const OpcodeMetadata& first = GetOpcodeMetadata(rule.First);
+    const OpcodeMetadata& second = GetOpcodeMetadata(rule.Second);
+    const OpcodeMetadata& fused = GetOpcodeMetadata(rule.Fused);
+    std::vector<OpcodeArgType> pair = ArgTypes(first);
+    std::vector<OpcodeArgType> secondTypes = ArgTypes(second);
+    pair.insert(pair.end(), secondTypes.begin(), secondTypes.end());
+    return ArgTypes(fused) == pair && fused.StackDelta == first.StackDelta + second.StackDelta;
+}
+
+void FuseSuperinstructions(std::vector<BytecodeInstruction>& instructions) {
+    std::vector<BytecodeInstruction> fused;
+    fused.reserve(instructions.size());
+    for (auto& instruction : instructions) {
+        const FusionRule* match = nullptr;
+        if (!fused.empty() && instruction.Labels.empty() && fused.back().JumpLabel < 0) {
+            for (const FusionRule& rule : Superinstructions) {
+                if (fused.back().Opcode == rule.First && instruction.Opcode == rule.Second &&
+                    SuperinstructionMatchesMetadata(rule)) {
+                    match = &rule;
+                    break;
+                }
+            }
+        }
+        if (match == nullptr) {
+            fused.push_back(std::move(instruction));
+            continue;
+        }
+
+        BytecodeInstruction& previous = fused.back();
+        if (instruction.JumpLabel >= 0) {
+            // Offsets count from the opcode, which the pair now shares
+            previous.JumpLabel = instruction.JumpLabel;
+            previous.JumpOffset = previous.Bytes.size() + instruction.JumpOffset - 1;
+        }
+        previous.Opcode = match->Fused;
+        previous.Bytes[0] = static_cast<uint8_t>(match->Fused);
+        previous.Bytes.insert(previous.Bytes.end(), instruction.Bytes.begin() + 1, instruction.Bytes.end());
+        previous.StackPeak = std::max(previous.StackPeak, instruction.StackPeak);
+        previous.StackDelta += instruction.StackDelta;
+    }
+    instructions = std::move(fused);
+}
+
+// Add the next instruction to the optimized stream, rewriting it together
+// with the ones before it where a rule applies. Labels of instructions that
+// are dropped are carried over to the next one kept.
+bool AppendPeephole(std::vector<BytecodeInstruction>& out, BytecodeInstruction instruction, std::vector<int>& carriedLabels) {
+    instruction.Labels.insert(instruction.Labels.begin(), carriedLabels.begin(), carriedLabels.end());
+    carriedLabels.clear();
+
+    // Jumping into the middle of a pattern must still work, so anything after
+    // its first instruction has to be unlabeled
+    if (out.empty() || !instruction.Labels.empty()) {
+        // A jump to the instruction right after it does nothing
+        if (!out.empty() && out.back().Opcode == DreamProcOpcode::Jump &&
+            std::find(instruction.Labels.begin(), instruction.Labels.end(), out.back().JumpLabel) != instruction.Labels.end()) {
+            instruction.Labels.insert(instruction.Labels.begin(), out.back().Labels.begin(), out.back().Labels.end());
+            out.pop_back();
+            out.push_back(std::move(instruction));
+            return true;
+        }
+        out.push_back(std::move(instruction));
+        return false;
+    }
+
+    BytecodeInstruction& previous = out.back();
+
+    for (const FusionRule& rule : FusionRules) {
+        if (previous.Opcode == rule.First && instruction.Opcode == rule.Second &&
+            instruction.Bytes.size() == 1 && previous.JumpLabel < 0 && FusionMatchesMetadata(rule)) {
+            previous.Opcode = rule.Fused;
+            previous.Bytes[0] = static_cast<uint8_t>(rule.Fused);
+            previous.StackPeak = std::max(previous.StackPeak, instruction.StackPeak);
+            previous.StackDelta += instruction.StackDelta;
+            return true;
+        }
+    }
+
+    if (instruction.Opcode == DreamProcOpcode::Pop && instruction.Bytes.size() == 1 &&
+        previous.JumpLabel < 0 && IsPurePush(previous.Opcode)) {
+        carriedLabels = std::move(previous.Labels);
+        out.pop_back();
+        return true;
+    }
+
+    if (instruction.Opcode == DreamProcOpcode::JumpIfFalse && IsPushFloat(previous)) {
+        std::vector<int> labels = std::move(previous.Labels);
+        bool taken = ReadFloatOperand(previous) == 0.0f;
+        int stackPeak = std::max(previous.StackPeak, instruction.StackPeak);
+        int stackDepth = previous.StackDepth;
+        int stackDelta = previous.StackDelta + instruction.StackDelta;
+        out.pop_back();
+        if (taken) {
+            instruction.Opcode = DreamProcOpcode::Jump;
+            instruction.Bytes[0] = static_cast<uint8_t>(DreamProcOpcode::Jump);
+            instruction.StackPeak = stackPeak;
+            instruction.StackDepth = stackDepth;
+            instruction.StackDelta = stackDelta;
+            instruction.Labels = std::move(labels);
+            out.push_back(std::move(instruction));
+        } else {
+            carriedLabels = std::move(labels);
+        }
+        return true;
+    }
+
+    if (out.size() >= 2 && IsPushFloat(previous) && previous.Labels.empty() && instruction.Bytes.size() == 1) {
+        BytecodeInstruction& left = out[out.size() - 2];
+        if (IsPushFloat(left)) {
+            if (auto result = CompareFloats(instruction.Opcode, ReadFloatOperand(left), ReadFloatOperand(previous))) {
+                std::vector<int> labels = std::move(left.Labels);
+                int stackPeak = std::max({left.StackPeak, previous.StackPeak, instruction.StackPeak});
+                int stackDepth = left.StackDepth;
+                int stackDelta = left.StackDelta + previous.StackDelta + instruction.StackDelta;
+                out.pop_back();
+                out.back() = MakePushFloat(*result ? 1.0f : 0.0f);
+                out.back().Labels = std::move(labels);
+                out.back().StackPeak = stackPeak;
+                out.back().StackDepth = stackDepth;
+                out.back().StackDelta = stackDelta;
+                return true;
+            }
+        }
+    }
+
+    out.push_back(std::move(instruction));
+    return false;
+}
+
+// Point jumps that land on an unconditional jump at where that one goes
+bool ThreadJumps(std::vector<BytecodeInstruction>& instructions) {
+    std::unordered_map<int, size_t> labelIndices;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        for (int label : instructions[i].Labels) {
+            labelIndices[label] = i;
+        }
+    }
+
+    bool changed = false;
+    for (auto& instruction : instructions) {
+        if (instruction.JumpLabel < 0) {
+            continue;
+        }
+        int target = instruction.JumpLabel;
+        size_t hops = 0;
+        for (auto it = labelIndices.find(target); it != labelIndices.end() && hops <= instructions.size(); it = labelIndices.find(target), ++hops) {
+            const BytecodeInstruction& landing = instructions[it->second];
+            if (landing.Opcode != DreamProcOpcode::Jump || landing.JumpLabel < 0) {
+                break;
+            }
+            target = landing.JumpLabel;
+        }
+        // A cycle of jumps never settles on a target; leave it alone
+        if (hops > instructions.size() || target == instruction.JumpLabel) {
+            continue;
+        }
+        instruction.JumpLabel = target;
+        changed = true;
+    }
+    return changed;
+}
+
+// Drop every instruction in a block no path from the start reaches
+bool RemoveUnreachable(std::vector<BytecodeInstruction>& instructions, std::vector<int>& trailingLabels) {
+    ControlFlowGraph graph(instructions);
+    std::vector<BytecodeInstruction> reachable;
+    reachable.reserve(instructions.size());
+    // Only unreachable code jumps to the labels of unreachable code, so they
+    // can sit anywhere; they go to the next instruction kept
+    std::vector<int> carriedLabels;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (!graph.GetBlocks()[graph.BlockOf(i)].Reachable) {
+            carriedLabels.insert(carriedLabels.end(), instructions[i].Labels.begin(), instructions[i].Labels.end());
+            continue;
+        }
+        instructions[i].Labels.insert(instructions[i].Labels.begin(), carriedLabels.begin(), carriedLabels.end());
+        carriedLabels.clear();
+        reachable.push_back(std::move(instructions[i]));
+    }
+    if (reachable.size() == instructions.size()) {
+        instructions = std::move(reachable);
+        return false;
+    }
+    trailingLabels.insert(trailingLabels.begin(), carriedLabels.begin(), carriedLabels.end());
+    instructions = std::move(reachable);
+    return true;
+}
+
+// Drop stores to locals that are never read afterwards
+bool EliminateDeadStores(std::vector<BytecodeInstruction>& instructions, std::vector<int>& trailingLabels, int parameterCount) {
+    // A throw inside a try jumps to the catch from anywhere, which the graph
+    // does not model
+    for (const auto& instruction : instructions) {
+        if (instruction.Opcode == DreamProcOpcode::Try || instruction.Opcode == DreamProcOpcode::TryNoValue) {
+            return false;
+        }
+    }
+
+    // Dropping a store changes when the value the local held before is
+    // released, so only locals that never hold anything but constants
+    // qualify. Arguments also show up in args, so they never do.
+    ControlFlowGraph::LocalSet constantLocals;
+    constantLocals.set();
+    for (int i = 0; i < parameterCount && i < static_cast<int>(constantLocals.size()); ++i) {
+        constantLocals.reset(static_cast<size_t>(i));
+    }
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        const BytecodeInstruction& instruction = instructions[i];
+        int written = ControlFlowGraph::WrittenLocal(instruction);
+        if (written >= 0) {
+            if (i == 0 || !instruction.Labels.empty() || !IsPurePush(instructions[i - 1].Opcode)) {
+                constantLocals.reset(static_cast<size_t>(written));
+            }
+            continue;
+        }
+        bool keepsConstant = instruction.Bytes.size() == 3 &&
+                             (instruction.Opcode == DreamProcOpcode::PushReferenceValue ||
+                              instruction.Opcode == DreamProcOpcode::ReturnReferenceValue ||
+                              instruction.Opcode == DreamProcOpcode::Increment ||
+                              instruction.Opcode == DreamProcOpcode::Decrement);
+        if (!keepsConstant) {
+            constantLocals &= ~ControlFlowGraph::ReadLocals(instruction);
+        }
+    }
+    if (constantLocals.none()) {
+        return false;
+    }
+
+    ControlFlowGraph graph(instructions);
+    graph.ComputeLiveness();
+    std::vector<bool> dead(instructions.size(), false);
+    bool changed = false;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        int written = ControlFlowGraph::WrittenLocal(instructions[i]);
+        if (written >= 0 && constantLocals.test(static_cast<size_t>(written)) &&
+            !graph.LiveAfter(i).test(static_cast<size_t>(written))) {
+            dead[i] = true;
+            changed = true;
+        }
+    }
+    if (!changed) {
+        return false;
+    }
+
+    std::vector<BytecodeInstruction> live;
+    live.reserve(instructions.size());
+    std::vector<int> carriedLabels;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        BytecodeInstruction& instruction = instructions[i];
+        instruction.Labels.insert(instruction.Labels.begin(), carriedLabels.begin(), carriedLabels.end());
+        carriedLabels.clear();
+        if (dead[i]) {
+            // Assign leaves the value on the stack as it found it; AssignNoPush
+            // still has to take it off
+            if (instruction.Opcode == DreamProcOpcode::Assign) {
+                carriedLabels = std::move(instruction.Labels);
+                continue;
+            }
+            instruction.Opcode = DreamProcOpcode::Pop;
+            instruction.Bytes = {static_cast<uint8_t>(DreamProcOpcode::Pop)};
+        }
+        live.push_back(std::move(instruction));
+    }
+    trailingLabels.insert(trailingLabels.begin(), carriedLabels.begin(), carriedLabels.end());
+    instructions = std::move(live);
+    return true;
+}
+
+} // namespace
+
+bool BytecodeWriter::LiftInstructions(std::vector<BytecodeInstruction>& instructions, std::vector<int>& trailingLabels) const {
+    if (Bytecode_.empty() || InstructionStarts_.empty() || InstructionStarts_.front() != 0 ||
+        !std::is_sorted(InstructionStarts_.begin(), InstructionStarts_.end()) ||
+        std::adjacent_find(InstructionStarts_.begin(), InstructionStarts_.end()) != InstructionStarts_.end()) {
+        return false;
+    }
+
+    instructions.assign(InstructionStarts_.size(), BytecodeInstruction{});
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        size_t start = InstructionStarts_[i];
+        size_t end = (i + 1 < InstructionStarts_.size()) ? InstructionStarts_[i + 1] : Bytecode_.size();
+        instructions[i].Opcode = static_cast<DreamProcOpcode>(Bytecode_[start]);
+        instructions[i].Bytes.assign(Bytecode_.begin() + start, Bytecode_.begin() + end);
+        instructions[i].StackPeak = InstructionPeaks_[i];
+        instructions[i].StackDepth = InstructionDepths_[i];
+        instructions[i].StackDelta = InstructionDeltas_[i];
+    }
+
+    // Every jump offset and every label has to line up with the instructions,
+    // otherwise moving them around would break something we cannot see
+    auto instructionAt = [&](size_t position) {
+        return static_cast<size_t>(std::upper_bound(InstructionStarts_.begin(), InstructionStarts_.end(), position) - InstructionStarts_.begin()) - 1;
+    };
+    for (const auto& jump : PendingJumps_) {
+        size_t index = instructionAt(jump.BytecodePosition);
+        BytecodeInstruction& instruction = instructions[index];
+        size_t offset = jump.BytecodePosition - InstructionStarts_[index];
+        if (instruction.JumpLabel >= 0 || offset == 0 || offset + 4 > instruction.Bytes.size()) {
+            return false;
+        }
+        instruction.JumpLabel = jump.TargetLabel;
+        instruction.JumpOffset = offset;
+    }
+    trailingLabels.clear();
+    for (const auto& [label, position] : LabelPositions_) {
+        if (position == Bytecode_.size()) {
+            trailingLabels.push_back(label);
+            continue;
+        }
+        size_t index = instructionAt(position);
+        if (position > Bytecode_.size() || InstructionStarts_[index] != position) {
+            return false;
+        }
+        instructions[index].Labels.push_back(label);
+    }
+    return true;
+}
+
+void BytecodeWriter::Optimize(int parameterCount, bool superinstructions) {
+    std::vector<BytecodeInstruction> instructions;
+    std::vector<int> trailingLabels;
+    if (!LiftInstructions(instructions, trailingLabels)) {
+        return;
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = ThreadJumps(instructions);
+
+        std::vector<BytecodeInstruction> optimized;
+        optimized.reserve(instructions.size());
+        std::vector<int> carriedLabels;
+        for (auto& instruction : instructions) {
+            changed |= AppendPeephole(optimized, std::move(instruction), carriedLabels);
+        }
+        // A jump to the end of the proc right before its end does nothing either
+        if (!optimized.empty() && optimized.back().Opcode == DreamProcOpcode::Jump &&
+            (std::find(carriedLabels.begin(), carriedLabels.end(), optimized.back().JumpLabel) != carriedLabels.end() ||
+             std::find(trailingLabels.begin(), trailingLabels.end(), optimized.back().JumpLabel) != trailingLabels.end())) {
+            carriedLabels.insert(carriedLabels.begin(), optimized.back().Labels.begin(), optimized.back().Labels.end());
+            optimized.pop_back();
+            changed = true;
+        }
+        trailingLabels.insert(trailingLabels.begin(), carriedLabels.begin(), carriedLabels.end());
+        instructions = std::move(optimized);
+
+        changed |= RemoveUnreachable(instructions, trailingLabels);
+        changed |= EliminateDeadStores(instructions, trailingLabels, parameterCount);
+    }
+    if (superinstructions) {
+        FuseSuperinstructions(instructions);
+    }
+
+    // Instructions that were dropped no longer count towards the stack size
+    MaxStackSize_ = std::min(MaxStackSize_, StoreInstructions(instructions, trailingLabels));
+}
+
+void BytecodeWriter::CompactOperands() {
+    std::vector<BytecodeInstruction> instructions;
+    std::vector<int> trailingLabels;
+    if (!LiftInstructions(instructions, trailingLabels)) {
+        return;
+    }
+    for (auto& instruction : instructions) {
+        CompactInstruction(instruction);
+    }
+    StoreInstructions(instructions, trailingLabels);
+}
+
+int BytecodeWriter::StoreInstructions(const std::vector<BytecodeInstruction>& instructions, const std::vector<int>& trailingLabels) {
+    Bytecode_.clear();
+    InstructionStarts_.clear();
+    InstructionPeaks_.clear();
+    InstructionDepths_.clear();
+    InstructionDeltas_.clear();
+    LabelPositions_.clear();
+    PendingJumps_.clear();
+    int maxStackSize = 0;
+    for (const auto& instruction : instructions) {
+        for (int label : instruction.Labels) {
+            LabelPositions_[label] = Bytecode_.size();
+        }
+        InstructionStarts_.push_back(Bytecode_.size());
+        InstructionPeaks_.push_back(instruction.StackPeak);
+        InstructionDepths_.push_back(instruction.StackDepth);
+        InstructionDeltas_.push_back(instruction.StackDelta);
+        maxStackSize = std::max(maxStackSize, instruction.StackPeak);
+        if (instruction.JumpLabel >= 0) {
+            PendingJumps_.push_back({Bytecode_.size() + instruction.JumpOffset, instruction.JumpLabel, instruction.Opcode});
+        }
+        Bytecode_.insert(Bytecode_.end(), instruction.Bytes.begin(), instruction.Bytes.end());
+    }
+    for (int label : trailingLabels) {
+        LabelPositions_[label] = Bytecode_.size();
+    }
+    return maxStackSize;
+}
+
+std::vector<std::string> BytecodeWriter::AnalyzeStack() {
+    std::vector<std::string> disagreements;
+    if (Bytecode_.empty()) {
+        return disagreements;
+    }
+    std::vector<BytecodeInstruction> instructions;
+    std::vector<int> trailingLabels;
+    if (!LiftInstructions(instructions, trailingLabels)) {
+        disagreements.push_back("its instructions cannot be told apart; keeping the counted max stack size of " +
+                                std::to_string(MaxStackSize_));
+        return disagreements;
+    }
+
+    auto describe = [&](size_t index) {
+        std::ostringstream description;
+        description << "instruction " << index << " (opcode 0x" << std::hex
+                    << static_cast<int>(instructions[index].Opcode) << std::dec << ") at byte " << InstructionStarts_[index];
+        return description.str();
+    };
+
+    StackDepthAnalysis analysis(instructions);
+    auto maxDepth = analysis.GetMaxDepth();
+    if (!maxDepth) {
+        disagreements.push_back("the opcode table gives no single stack depth after " + describe(analysis.GetFailedAt()) +
+                                "; keeping the counted max stack size of " + std::to_string(MaxStackSize_));
+        return disagreements;
+    }
+    // Past the first difference every depth is off by the same amount
+    const std::vector<int>& depths = analysis.GetDepths();
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        if (depths[i] >= 0 && depths[i] != instructions[i].StackDepth) {
+            disagreements.push_back("the opcode table puts the stack at depth " + std::to_string(depths[i]) + " before " +
+                                    describe(i) + ", the ResizeStack() calls at " + std::to_string(instructions[i].StackDepth));
+            break;
+        }
+    }
+    if (*maxDepth != MaxStackSize_) {
+        disagreements.push_back("the opcode table needs a max stack size of " + std::to_string(*maxDepth) +
+                                ", the ResizeStack() calls counted " + std::to_string(MaxStackSize_));
+    }
+    MaxStackSize_ = *maxDepth;
+    return disagreements;
+}
+
+int BytecodeWriter::GetStringId(std::string_view str) {
+    if (ObjectTree_) {
+        return ObjectTree_->AddString(str);
+    }
+    if (!OwnStrings_) {
+        OwnStrings_ = std::make_unique<ConcurrentStringInterner>();
+    }
+    return OwnStrings_->Intern(str);
+}
+
+std::vector<uint8_t> BytecodeWriter::TakeBytecode() {
+    LastBytecodeSize_ = Bytecode_.size();
+    return std::move(Bytecode_);
 }
 
 void BytecodeWriter::Reset() {
     Bytecode_.clear();
-    StringTable_.clear();
-    Strings_.clear();
+    OwnStrings_.reset();
     LabelPositions_.clear();
     PendingJumps_.clear();
+    InstructionStarts_.clear();
+    InstructionPeaks_.clear();
+    InstructionDepths_.clear();
+    InstructionDeltas_.clear();
     NextLabelId_ = 0;
     CurrentStackSize_ = 0;
     MaxStackSize_ = 0;
 }
 
 void BytecodeWriter::ResizeStack(int sizeDelta) {
+    int previousStackSize = CurrentStackSize_;
     CurrentStackSize_ += sizeDelta;
     if (CurrentStackSize_ > MaxStackSize_) {
         MaxStackSize_ = CurrentStackSize_;
     }
+    if (!InstructionPeaks_.empty() && CurrentStackSize_ > InstructionPeaks_.back()) {
+        InstructionPeaks_.back() = CurrentStackSize_;
+    }
     
     // Detect stack underflow (debugging aid)
     if (CurrentStackSize_ < 0) {
@@ -144,6 +743,17 @@ void BytecodeWriter::ResizeStack(int sizeDelta) {
         // Reset to 0 to prevent cascading errors
         CurrentStackSize_ = 0;
     }
+    if (!InstructionDeltas_.empty()) {
+        InstructionDeltas_.back() += CurrentStackSize_ - previousStackSize;
+    }
+}
+
+void BytecodeWriter::WriteOpcode(DreamProcOpcode opcode) {
+    InstructionStarts_.push_back(Bytecode_.size());
+    InstructionPeaks_.push_back(CurrentStackSize_);
+    InstructionDepths_.push_back(CurrentStackSize_);
+    InstructionDeltas_.push_back(0);
+    WriteByte(static_cast<uint8_t>(opcode));
 }
 
 void BytecodeWriter::WriteByte(uint8_t value) {
@@ -185,6 +795,14 @@ void BytecodeWriter::EmitGlobalProcReference(int procId) {
     WriteInt(procId);
 }
 
+void BytecodeWriter::EmitNullStore(int localId) {
+    Emit(DreamProcOpcode::PushNull);
+    ResizeStack(1);
+    Emit(DreamProcOpcode::AssignNoPush);
+    WriteReference(DMReference::CreateLocal(localId));
+    ResizeStack(-1);
+}
+
 void BytecodeWriter::WriteReference(const DMReference& reference) {
     // Write the reference type byte
     WriteByte(static_cast<uint8_t>(reference.RefType));
@@ -276,5 +894,33 @@ void BytecodeWriter::DestroyEnumerator(int enumeratorId) {
     WriteInt(enumeratorId);
 }
 
+namespace {
+
+// Writers a thread is done with. A few are enough: only procs compiled while
+// another is being written need a second one.
+constexpr size_t MaxPooledWriters = 4;
+thread_local std::vector<std::unique_ptr<BytecodeWriter>> WriterPool;
+
+} // namespace
+
+PooledBytecodeWriter::PooledBytecodeWriter(DMObjectTree* objectTree) {
+    if (WriterPool.empty()) {
+        Writer_ = std::make_unique<BytecodeWriter>(objectTree);
+        return;
+    }
+    Writer_ = std::move(WriterPool.back());
+    WriterPool.pop_back();
+    Writer_->ObjectTree_ = objectTree;
+    // Whatever the last proc took is a fair guess for this one
+    Writer_->Bytecode_.reserve(Writer_->LastBytecodeSize_);
+}
+
+PooledBytecodeWriter::~PooledBytecodeWriter() {
+    if (WriterPool.size() >= MaxPooledWriters) {
+        return;
+    }
+    Writer_->Reset();
+    WriterPool.push_back(std::move(Writer_));
+}
 
 } // namespace DMCompiler
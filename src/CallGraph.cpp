@@ -0,0 +1,495 @@
+#include "CallGraph.h"
+#include "DMReference.h"
+#include "JsonWriter.h"
+#include <algorithm>
+#include <deque>
+
+namespace DMCompiler {
+
+namespace {
+
+// ..() is a CallStatement written with a SuperProc reference the opcode
+// table does not list: opcode, reference type, arguments type and count.
+// The expression compiler writes that type as 7.
+constexpr uint8_t SuperProcReferenceType = 7;
+constexpr size_t SuperCallLength = 7;
+
+std::string EscapeDot(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+// Visit each instruction of a proc, ..() as a whole with no operands
+// @return False if one does not decode to its end
+template <typename Visit>
+bool ForEachInstruction(const std::vector<uint8_t>& bytecode, OperandEncoding encoding, Visit visit) {
+    bool readable = true;
+    for (size_t pc = 0; pc < bytecode.size();) {
+        DecodedInstruction instruction;
+        bool superCall = bytecode[pc] == static_cast<uint8_t>(DreamProcOpcode::CallStatement) &&
+                         pc + 1 < bytecode.size() && bytecode[pc + 1] == SuperProcReferenceType;
+        if (superCall) {
+            instruction.Opcode = DreamProcOpcode::CallStatement;
+            instruction.Length = std::min(SuperCallLength, bytecode.size() - pc);
+            instruction.Truncated = instruction.Length < SuperCallLength;
+        } else {
+            instruction = DecodeInstruction(bytecode, pc, encoding);
+        }
+        readable = readable && !instruction.Truncated && HasOpcodeMetadata(instruction.Opcode);
+        visit(pc, instruction, superCall);
+        pc += instruction.Length;
+    }
+    return readable;
+}
+
+bool IsGlobalProcReference(const std::vector<uint8_t>& bytecode, size_t pc, const OperandSpan& operand) {
+    return operand.Type == OpcodeArgType::Reference && operand.Length == 5 &&
+           bytecode[pc + operand.Offset] == static_cast<uint8_t>(DMReference::Type::GlobalProc);
+}
+
+} // namespace
+
+CallGraph::CallGraph(const std::vector<Type>& types, const std::vector<Proc>& procs,
+                     const std::function<std::string(uint32_t)>& stringAt, OperandEncoding encoding)
+    : Callees_(procs.size())
+{
+    Parents_.reserve(types.size());
+    for (const Type& type : types) {
+        Parents_.push_back(type.ParentId);
+    }
+    for (size_t id = 0; id < procs.size(); ++id) {
+        const Proc& proc = procs[id];
+        bool onType = proc.OwnerTypeId >= 0 && static_cast<size_t>(proc.OwnerTypeId) < types.size();
+        Owners_.push_back(onType ? proc.OwnerTypeId : -1);
+        Names_.push_back(proc.Name);
+        std::string owner = onType ? types[proc.OwnerTypeId].Path : "/";
+        Labels_.push_back(owner == "/" ? "/proc/" + proc.Name : owner + "/" + proc.Name);
+        ProcsByName_[proc.Name].push_back(static_cast<int>(id));
+        if (proc.IsRoot) {
+            Roots_.push_back(static_cast<int>(id));
+        }
+    }
+
+    // Names are looked up once per string, not once per call
+    std::unordered_map<uint32_t, std::string> names;
+    auto nameAt = [&](uint32_t stringId) -> const std::string& {
+        auto it = names.find(stringId);
+        if (it == names.end()) {
+            it = names.emplace(stringId, stringAt(stringId)).first;
+        }
+        return it->second;
+    };
+
+    for (size_t id = 0; id < procs.size(); ++id) {
+        if (!procs[id].Bytecode) {
+            continue;
+        }
+        const std::vector<uint8_t>& bytecode = *procs[id].Bytecode;
+        int owner = Owners_[id];
+        std::vector<int>& callees = Callees_[id];
+        auto addNamed = [&](const std::string& name) {
+            auto it = ProcsByName_.find(name);
+            if (it != ProcsByName_.end()) {
+                callees.insert(callees.end(), it->second.begin(), it->second.end());
+            }
+        };
+        auto addVirtual = [&](const std::string& name) {
+            if (owner < 0) {
+                addNamed(name);
+                return;
+            }
+            int definition = Resolve(owner, name);
+            if (definition >= 0) {
+                callees.push_back(definition);
+            }
+            auto it = ProcsByName_.find(name);
+            if (it != ProcsByName_.end()) {
+                for (int procId : it->second) {
+                    if (Owners_[procId] != owner && IsSubtypeOf(Owners_[procId], owner)) {
+                        callees.push_back(procId);
+                    }
+                }
+            }
+        };
+
+        bool afterSrc = false;
+        bool readable = ForEachInstruction(bytecode, encoding, [&](size_t pc, const DecodedInstruction& instruction,
+                                                                   bool superCall) {
+            if (superCall) {
+                if (owner >= 0) {
+                    int overridden = Resolve(owner, Names_[id], static_cast<int>(id));
+                    if (overridden >= 0) {
+                        callees.push_back(overridden);
+                    }
+                }
+                afterSrc = false;
+                return;
+            }
+
+            const OperandSpan* first = instruction.OperandCount > 0 ? &instruction.Operands[0] : nullptr;
+            uint8_t referenceType = first && first->Type == OpcodeArgType::Reference ? bytecode[pc + first->Offset] : 0;
+            if (instruction.Opcode == DreamProcOpcode::Call && first && first->Length == 5 &&
+                referenceType == static_cast<uint8_t>(DMReference::Type::SrcProc)) {
+                addVirtual(nameAt(ReadOperandValue(bytecode, pc, *first, encoding)));
+            } else if (instruction.Opcode == DreamProcOpcode::DereferenceCall && first &&
+                       first->Type == OpcodeArgType::String) {
+                const std::string& name = nameAt(ReadOperandValue(bytecode, pc, *first, encoding));
+                if (afterSrc) {
+                    addVirtual(name);
+                } else {
+                    addNamed(name);
+                }
+            }
+            for (size_t i = 0; i < instruction.OperandCount; ++i) {
+                const OperandSpan& operand = instruction.Operands[i];
+                if (operand.Type == OpcodeArgType::ProcId || IsGlobalProcReference(bytecode, pc, operand)) {
+                    callees.push_back(static_cast<int>(ReadOperandValue(bytecode, pc, operand, encoding)));
+                } else if (operand.Type == OpcodeArgType::TypeId) {
+                    auto constructors = Constructors(static_cast<int>(ReadOperandValue(bytecode, pc, operand, encoding)));
+                    callees.insert(callees.end(), constructors.begin(), constructors.end());
+                }
+            }
+
+            afterSrc = instruction.Opcode == DreamProcOpcode::PushReferenceValue &&
+                       referenceType == static_cast<uint8_t>(DMReference::Type::Src);
+        });
+        if (!readable) {
+            Unreadable_.push_back(static_cast<int>(id));
+        }
+
+        // IDs past the end come from bytes the table misreads; there is no proc to point at
+        callees.erase(std::remove_if(callees.begin(), callees.end(), [&](int callee) {
+            return callee < 0 || static_cast<size_t>(callee) >= procs.size();
+        }), callees.end());
+        std::sort(callees.begin(), callees.end());
+        callees.erase(std::unique(callees.begin(), callees.end()), callees.end());
+    }
+}
+
+int CallGraph::Resolve(int typeId, const std::string& name, int before) const {
+    auto it = ProcsByName_.find(name);
+    if (it == ProcsByName_.end()) {
+        return -1;
+    }
+
+    // The highest ID on a type is its last definition, the one that runs
+    const std::vector<int>& candidates = it->second;
+    for (size_t steps = 0; typeId >= 0 && steps <= Parents_.size(); ++steps) {
+        for (auto candidate = candidates.rbegin(); candidate != candidates.rend(); ++candidate) {
+            if (Owners_[*candidate] == typeId && (before < 0 || steps > 0 || *candidate < before)) {
+                return *candidate;
+            }
+        }
+        typeId = static_cast<size_t>(typeId) < Parents_.size() ? Parents_[typeId] : -1;
+    }
+    return -1;
+}
+
+bool CallGraph::IsSubtypeOf(int typeId, int ancestorId) const {
+    for (size_t steps = 0; typeId >= 0 && steps <= Parents_.size(); ++steps) {
+        if (typeId == ancestorId) {
+            return true;
+        }
+        typeId = static_cast<size_t>(typeId) < Parents_.size() ? Parents_[typeId] : -1;
+    }
+    return false;
+}
+
+std::vector<int> CallGraph::Constructors(int typeId) const {
+    std::vector<int> constructors;
+    for (const char* name : {"New", "__init__"}) {
+        int procId = Resolve(typeId, name);
+        if (procId >= 0) {
+            constructors.push_back(procId);
+        }
+    }
+    return constructors;
+}
+
+std::vector<bool> CallGraph::FindReachable(const std::vector<int>& roots) const {
+    std::vector<bool> reachable(Callees_.size(), false);
+    std::vector<int> pending;
+    for (int root : roots) {
+        if (root >= 0 && static_cast<size_t>(root) < reachable.size() && !reachable[root]) {
+            reachable[root] = true;
+            pending.push_back(root);
+        }
+    }
+    while (!pending.empty()) {
+        int procId = pending.back();
+        pending.pop_back();
+        for (int callee : Callees_[procId]) {
+            if (!reachable[callee]) {
+                reachable[callee] = true;
+                pending.push_back(callee);
+            }
+        }
+    }
+    return reachable;
+}
+
+std::vector<int> CallGraph::FindUnreachable() const {
+    std::vector<bool> reachable = FindReachable(Roots_);
+    std::vector<int> unreachable;
+    for (size_t id = 0; id < reachable.size(); ++id) {
+        if (!reachable[id]) {
+            unreachable.push_back(static_cast<int>(id));
+        }
+    }
+    return unreachable;
+}
+
+std::vector<int> CallGraph::FindComponents(size_t& componentCount) const {
+    // Tarjan's algorithm without recursion, since call chains can be long.
+    // A component is finished only after every one it calls into.
+    const size_t count = Callees_.size();
+    std::vector<int> index(count, -1);
+    std::vector<int> low(count, 0);
+    std::vector<int> components(count, -1);
+    std::vector<int> stack;
+    std::vector<std::pair<int, size_t>> work;  // Proc, next callee to look at
+    int nextIndex = 0;
+    componentCount = 0;
+
+    auto visit = [&](int procId) {
+        index[procId] = low[procId] = nextIndex++;
+        stack.push_back(procId);
+        work.emplace_back(procId, 0);
+    };
+    for (size_t start = 0; start < count; ++start) {
+        if (index[start] >= 0) {
+            continue;
+        }
+        visit(static_cast<int>(start));
+        while (!work.empty()) {
+            int procId = work.back().first;
+            size_t next = work.back().second;
+            if (next < Callees_[procId].size()) {
+                work.back().second++;
+                int callee = Callees_[procId][next];
+                if (index[callee] < 0) {
+                    visit(callee);
+                } else if (components[callee] < 0) {
+                    low[procId] = std::min(low[procId], index[callee]);
+                }
+                continue;
+            }
+
+            work.pop_back();
+            if (!work.empty()) {
+                int caller = work.back().first;
+                low[caller] = std::min(low[caller], low[procId]);
+            }
+            if (low[procId] == index[procId]) {
+                int member;
+                do {
+                    member = stack.back();
+                    stack.pop_back();
+                    components[member] = static_cast<int>(componentCount);
+                } while (member != procId);
+                componentCount++;
+            }
+        }
+    }
+    return components;
+}
+
+std::vector<std::vector<int>> CallGraph::FindRecursiveGroups() const {
+    size_t componentCount;
+    std::vector<int> components = FindComponents(componentCount);
+    std::vector<std::vector<int>> members(componentCount);
+    for (size_t id = 0; id < components.size(); ++id) {
+        members[components[id]].push_back(static_cast<int>(id));
+    }
+
+    std::vector<std::vector<int>> groups;
+    for (auto& group : members) {
+        int procId = group.front();
+        if (group.size() > 1 || std::binary_search(Callees_[procId].begin(), Callees_[procId].end(), procId)) {
+            groups.push_back(std::move(group));
+        }
+    }
+    std::sort(groups.begin(), groups.end());
+    return groups;
+}
+
+std::vector<int> CallGraph::FindDeepestChain() const {
+    if (Callees_.empty()) {
+        return {};
+    }
+    size_t componentCount;
+    std::vector<int> components = FindComponents(componentCount);
+    std::vector<std::vector<int>> members(componentCount);
+    for (size_t id = 0; id < components.size(); ++id) {
+        members[components[id]].push_back(static_cast<int>(id));
+    }
+
+    // Longest path over the components, each counting as one step;
+    // callees are numbered first, so theirs is known by the time it is needed
+    std::vector<size_t> depth(componentCount, 1);
+    std::vector<std::pair<int, int>> step(componentCount, {-1, -1});  // The call leaving a component
+    for (size_t component = 0; component < componentCount; ++component) {
+        for (int procId : members[component]) {
+            for (int callee : Callees_[procId]) {
+                size_t calleeComponent = components[callee];
+                if (calleeComponent != component && depth[calleeComponent] + 1 > depth[component]) {
+                    depth[component] = depth[calleeComponent] + 1;
+                    step[component] = {procId, callee};
+                }
+            }
+        }
+    }
+    size_t deepest = 0;
+    for (size_t component = 1; component < componentCount; ++component) {
+        if (depth[component] > depth[deepest] ||
+            (depth[component] == depth[deepest] && members[component].front() < members[deepest].front())) {
+            deepest = component;
+        }
+    }
+
+    // Within a component, the shortest path from where the chain came in to where it leaves
+    auto pathWithin = [&](int from, int to) {
+        std::unordered_map<int, int> cameFrom{{from, from}};
+        std::deque<int> pending{from};
+        while (!pending.empty() && !cameFrom.count(to)) {
+            int procId = pending.front();
+            pending.pop_front();
+            for (int callee : Callees_[procId]) {
+                if (components[callee] == components[from] && cameFrom.emplace(callee, procId).second) {
+                    pending.push_back(callee);
+                }
+            }
+        }
+        std::vector<int> path{to};
+        while (path.back() != from) {
+            path.push_back(cameFrom[path.back()]);
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    };
+
+    std::vector<int> chain;
+    size_t component = deepest;
+    int entry = step[component].first >= 0 ? step[component].first : members[component].front();
+    while (true) {
+        if (step[component].first < 0) {
+            chain.push_back(entry);
+            break;
+        }
+        auto path = pathWithin(entry, step[component].first);
+        chain.insert(chain.end(), path.begin(), path.end());
+        entry = step[component].second;
+        component = components[entry];
+    }
+    return chain;
+}
+
+void CallGraph::RenumberProcs(std::vector<uint8_t>& bytecode, const std::vector<int>& newIds,
+                              OperandEncoding encoding) {
+    auto write = [&](size_t offset, size_t length, uint32_t value, bool leb128) {
+        for (size_t i = 0; i < length; ++i) {
+            if (leb128) {
+                bytecode[offset + i] = static_cast<uint8_t>((value & 0x7F) | (i + 1 < length ? 0x80 : 0));
+                value >>= 7;
+            } else {
+                bytecode[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+    };
+    ForEachInstruction(bytecode, encoding, [&](size_t pc, const DecodedInstruction& instruction, bool) {
+        for (size_t i = 0; i < instruction.OperandCount; ++i) {
+            const OperandSpan& operand = instruction.Operands[i];
+            bool globalProc = IsGlobalProcReference(bytecode, pc, operand);
+            if (operand.Type != OpcodeArgType::ProcId && !globalProc) {
+                continue;
+            }
+            uint32_t oldId = ReadOperandValue(bytecode, pc, operand, encoding);
+            if (oldId >= newIds.size() || newIds[oldId] < 0) {
+                continue;
+            }
+            uint32_t newId = static_cast<uint32_t>(newIds[oldId]);
+            if (globalProc) {
+                write(pc + operand.Offset + 1, 4, newId, false);
+            } else {
+                bool leb128 = encoding == OperandEncoding::Leb128 && IsCompactOperand(operand.Type);
+                write(pc + operand.Offset, operand.Length, newId, leb128);
+            }
+        }
+    });
+}
+
+void CallGraph::WriteDot(std::ostream& out) const {
+    std::vector<bool> reachable = FindReachable(Roots_);
+    std::vector<bool> isRoot(Callees_.size(), false);
+    for (int root : Roots_) {
+        isRoot[root] = true;
+    }
+
+    out << "digraph calls {\n";
+    for (size_t id = 0; id < Callees_.size(); ++id) {
+        out << "    p" << id << " [label=\"" << EscapeDot(Labels_[id]) << "\"";
+        if (isRoot[id]) {
+            out << ", shape=box";
+        }
+        if (!reachable[id]) {
+            out << ", color=gray, fontcolor=gray";
+        }
+        out << "];\n";
+    }
+    for (size_t id = 0; id < Callees_.size(); ++id) {
+        for (int callee : Callees_[id]) {
+            out << "    p" << id << " -> p" << callee << ";\n";
+        }
+    }
+    out << "}\n";
+}
+
+std::string CallGraph::ToJson() const {
+    std::vector<bool> reachable = FindReachable(Roots_);
+    std::vector<bool> isRoot(Callees_.size(), false);
+    for (int root : Roots_) {
+        isRoot[root] = true;
+    }
+    auto writeIds = [](JsonWriter& json, const std::vector<int>& ids) {
+        json.BeginArray();
+        for (int id : ids) {
+            json.WriteInt(id);
+        }
+        json.EndArray();
+    };
+
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKey("Procs");
+    json.BeginArray();
+    for (size_t id = 0; id < Callees_.size(); ++id) {
+        json.BeginObject();
+        json.WriteKeyValue("Id", static_cast<int>(id));
+        json.WriteKeyValue("Name", Labels_[id]);
+        json.WriteKeyValue("Root", static_cast<bool>(isRoot[id]));
+        json.WriteKeyValue("Reachable", static_cast<bool>(reachable[id]));
+        json.WriteKey("Callees");
+        writeIds(json, Callees_[id]);
+        json.EndObject();
+    }
+    json.EndArray();
+
+    json.WriteKey("RecursiveGroups");
+    json.BeginArray();
+    for (const auto& group : FindRecursiveGroups()) {
+        writeIds(json, group);
+    }
+    json.EndArray();
+    json.WriteKey("DeepestChain");
+    writeIds(json, FindDeepestChain());
+    json.EndObject();
+    return json.ToString();
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,90 @@
+#include "CompileCosts.h"
+#include "DMObject.h"
+#include "DMProc.h"
+#include "Location.h"
+#include <algorithm>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace DMCompiler {
+
+namespace {
+
+double Milliseconds(CompileCosts::Duration time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+std::string ProcLabel(const DMProc& proc) {
+    std::string path = proc.OwningObject ? proc.OwningObject->Path.ToString() : "?";
+    if (path.empty() || path.back() != '/') {
+        path += "/";
+    }
+    return path + proc.Name;
+}
+
+} // namespace
+
+void CompileCosts::AddFileTime(uint32_t fileId, FileStage stage, Duration time) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    FileCost& cost = Files_[fileId];
+    (stage == FileStage::Preprocess ? cost.Preprocess : cost.Parse) += time;
+}
+
+void CompileCosts::AddProcTime(const DMProc* proc, Duration time) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Procs_[proc] += time;
+}
+
+void CompileCosts::Report(std::ostream& out, size_t topCount) const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+
+    std::vector<std::pair<uint32_t, FileCost>> files(Files_.begin(), Files_.end());
+    Duration fileTotal{};
+    for (const auto& [fileId, cost] : files) {
+        fileTotal += cost.Preprocess + cost.Parse;
+    }
+    std::sort(files.begin(), files.end(), [](const auto& a, const auto& b) {
+        Duration aTime = a.second.Preprocess + a.second.Parse;
+        Duration bTime = b.second.Preprocess + b.second.Parse;
+        return aTime != bTime ? aTime > bTime : a.first < b.first;
+    });
+
+    std::vector<std::pair<const DMProc*, Duration>> procs(Procs_.begin(), Procs_.end());
+    Duration procTotal{};
+    for (const auto& [proc, time] : procs) {
+        procTotal += time;
+    }
+    std::sort(procs.begin(), procs.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first->Id < b.first->Id;
+    });
+
+    out << std::fixed << std::setprecision(1);
+    out << "Compile costs:" << std::endl;
+    out << std::endl << "  Slowest files to preprocess and parse (" << files.size() << " files, "
+        << Milliseconds(fileTotal) << " ms):" << std::endl;
+    out << "    " << std::setw(10) << "Total ms" << std::setw(14) << "Preprocess ms" << std::setw(10) << "Parse ms"
+        << "  File" << std::endl;
+    for (size_t i = 0; i < files.size() && i < topCount; ++i) {
+        const FileCost& cost = files[i].second;
+        out << "    " << std::setw(10) << Milliseconds(cost.Preprocess + cost.Parse) << std::setw(14)
+            << Milliseconds(cost.Preprocess) << std::setw(10) << Milliseconds(cost.Parse) << "  "
+            << SourceFileRegistry::GetPath(files[i].first) << std::endl;
+    }
+
+    out << std::endl << "  Slowest procs to compile (" << procs.size() << " procs, " << Milliseconds(procTotal)
+        << " ms):" << std::endl;
+    out << "    " << std::setw(10) << "ms" << std::setw(10) << "Bytes" << "  Proc" << std::endl;
+    for (size_t i = 0; i < procs.size() && i < topCount; ++i) {
+        const DMProc& proc = *procs[i].first;
+        out << "    " << std::setw(10) << Milliseconds(procs[i].second) << std::setw(10) << proc.Bytecode.size()
+            << "  " << ProcLabel(proc);
+        if (proc.SourceLocation.FileId != SourceFileRegistry::UnknownFileId && !proc.SourceLocation.IsInternal()) {
+            out << " (" << proc.SourceLocation.SourceFile() << ":" << proc.SourceLocation.Line << ")";
+        }
+        out << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,208 @@
+#include "CompileServer.h"
+#include "DMStandardSnapshot.h"
+#include "JsonWriter.h"
+#include "LocalSocket.h"
+#include "ResourceManifest.h"
+#include "TokenCache.h"
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Sends std::cout and std::cerr to a buffer while it lives
+class ConsoleCapture {
+public:
+    explicit ConsoleCapture(std::ostream& target)
+        : Out_(std::cout.rdbuf(target.rdbuf())), Err_(std::cerr.rdbuf(target.rdbuf())) {}
+    ~ConsoleCapture() {
+        std::cout.flush();
+        std::cout.rdbuf(Out_);
+        std::cerr.rdbuf(Err_);
+    }
+    ConsoleCapture(const ConsoleCapture&) = delete;
+    ConsoleCapture& operator=(const ConsoleCapture&) = delete;
+
+private:
+    std::streambuf* Out_;
+    std::streambuf* Err_;
+};
+
+// Runs a compile from another directory, going back when it ends
+class WorkingDirectory {
+public:
+    explicit WorkingDirectory(const std::string& directory) {
+        std::error_code ec;
+        Previous_ = fs::current_path(ec);
+        Ok_ = !ec && (directory.empty() || (fs::current_path(directory, ec), !ec));
+    }
+    ~WorkingDirectory() {
+        std::error_code ec;
+        fs::current_path(Previous_, ec);
+    }
+    WorkingDirectory(const WorkingDirectory&) = delete;
+    WorkingDirectory& operator=(const WorkingDirectory&) = delete;
+
+    bool Ok() const { return Ok_; }
+
+private:
+    fs::path Previous_;
+    bool Ok_;
+};
+
+} // namespace
+
+CompileServer::CompileServer(std::string cacheDir, ArgumentParser parseArguments)
+    : CacheDir_(fs::absolute(cacheDir).string())
+    , ParseArguments_(std::move(parseArguments))
+{
+    ResetWarmState();
+}
+
+void CompileServer::ResetWarmState() {
+    WarmState_ = std::make_shared<DMCompilerWarmState>();
+    WarmState_->Tokens = std::make_shared<TokenCache>((fs::path(CacheDir_) / "tokens").string(), true);
+    WarmState_->Resources = std::make_shared<ResourceHashIndex>();
+}
+
+std::string CompileServer::Handle(const std::string& request) {
+    json reply = {{"id", nullptr}};
+    json message = json::parse(request, nullptr, false);
+    if (message.is_discarded() || !message.is_object()) {
+        reply["error"] = "Request is not a JSON object";
+        return reply.dump();
+    }
+    if (message.contains("id")) {
+        reply["id"] = message["id"];
+    }
+
+    try {
+        std::string method = message.value("method", "");
+        json params = message.value("params", json::object());
+
+        std::lock_guard<std::mutex> lock(Mutex_);
+        if (method == "Compile") {
+            std::vector<std::string> args = params.at("args").get<std::vector<std::string>>();
+            std::string directory = params.value("directory", "");
+
+            auto start = std::chrono::steady_clock::now();
+            std::ostringstream output;
+            DMCompiler compiler;
+            bool success = false;
+            {
+                WorkingDirectory workingDirectory(directory);
+                if (!workingDirectory.Ok()) {
+                    reply["error"] = "Cannot compile in " + directory;
+                    return reply.dump();
+                }
+                ConsoleCapture capture(output);
+
+                DMCompilerSettings settings;
+                if (ParseArguments_(args, settings)) {
+                    // Whatever the compile does not cache itself goes in the server's caches
+                    fs::path cacheDir(CacheDir_);
+                    if (settings.TokenCacheDir.empty()) {
+                        settings.TokenCacheDir = WarmState_->Tokens->GetDirectory();
+                    }
+                    if (settings.ASTCacheDir.empty() && !settings.StreamTokens) {
+                        settings.ASTCacheDir = (cacheDir / "ast").string();
+                    }
+                    if (settings.MapCacheDir.empty()) {
+                        settings.MapCacheDir = (cacheDir / "maps").string();
+                    }
+                    if (settings.StandardSnapshotPath.empty()) {
+                        settings.StandardSnapshotPath = (cacheDir / "standard.dmss").string();
+                    }
+                    if (settings.ProcCacheDir.empty()) {
+                        settings.ProcCacheDir = (cacheDir / "procs").string();
+                    }
+
+                    compiler.SetWarmState(WarmState_);
+                    try {
+                        success = compiler.Compile(settings);
+                    } catch (const std::exception& e) {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    Compiles_++;
+                }
+            }
+
+            reply["result"] = {
+                {"Success", success},
+                {"Errors", compiler.GetErrorCount()},
+                {"Warnings", compiler.GetWarningCount()},
+                {"Ms", std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()},
+                {"Output", output.str()},
+                {"Messages", compiler.GetCompilerMessages()},
+                {"JsonConstants", compiler.GetJsonConstants().StringCount()},
+            };
+        } else if (method == "Stats") {
+            reply["result"] = {
+                {"Compiles", Compiles_},
+                {"CacheDirectory", CacheDir_},
+                {"TokenFilesInMemory", WarmState_->Tokens->MemoryEntries()},
+                {"StandardSnapshot", WarmState_->Standard != nullptr},
+            };
+        } else if (method == "Reset") {
+            ResetWarmState();
+            reply["result"] = true;
+        } else {
+            reply["error"] = "Unknown method: " + method;
+        }
+    } catch (const json::exception& e) {
+        reply["error"] = std::string("Bad request: ") + e.what();
+    }
+    return reply.dump();
+}
+
+void CompileServer::Serve(std::istream& in, std::ostream& out) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        out << Handle(line) << std::endl;
+    }
+}
+
+bool CompileServer::Listen(const std::string& socketPath) {
+    return LocalSocket::Serve(socketPath, [this](const std::string& request) { return Handle(request); });
+}
+
+bool CompileServer::CompileRemotely(const std::string& socketPath, const std::vector<std::string>& args,
+                                    std::ostream& out) {
+    std::error_code ec;
+    json request = {
+        {"id", 1},
+        {"method", "Compile"},
+        {"params", {{"args", args}, {"directory", fs::current_path(ec).string()}}},
+    };
+
+    std::string replyLine;
+    std::string error;
+    if (!LocalSocket::Request(socketPath, request.dump(), replyLine, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+    json reply = json::parse(replyLine, nullptr, false);
+    if (reply.is_discarded() || !reply.is_object()) {
+        std::cerr << "Error: The server sent a reply that is not JSON" << std::endl;
+        return false;
+    }
+    if (reply.contains("error")) {
+        std::cerr << "Error: " << reply["error"].get<std::string>() << std::endl;
+        return false;
+    }
+    const json& result = reply["result"];
+    out << result.value("Output", "");
+    return result.value("Success", false);
+}
+
+} // namespace DMCompiler
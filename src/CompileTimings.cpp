@@ -0,0 +1,338 @@
+#include "CompileTimings.h"
+#include "JsonWriter.h"
+#include "TokenSerialization.h"
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+
+#if defined(DM_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(DM_ALLOCATOR_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+namespace DMCompiler {
+
+namespace {
+
+// Counted only while timings exist, so other compiles pay a load per allocation
+std::atomic<int> CountingTimings{0};
+std::atomic<uint64_t> AllocationCount{0};
+std::atomic<uint64_t> AllocatedBytes{0};
+
+// The allocator the build links (scons --allocator) serves operator new and
+// delete; malloc itself is left to the C library
+void* AllocateFrom(std::size_t size) {
+#if defined(DM_ALLOCATOR_MIMALLOC)
+    return mi_malloc(size);
+#elif defined(DM_ALLOCATOR_JEMALLOC)
+    return mallocx(size, 0);
+#else
+    return std::malloc(size);
+#endif
+}
+
+void Free(void* memory) noexcept {
+#if defined(DM_ALLOCATOR_MIMALLOC)
+    mi_free(memory);
+#elif defined(DM_ALLOCATOR_JEMALLOC)
+    if (memory) {
+        dallocx(memory, 0);
+    }
+#else
+    std::free(memory);
+#endif
+}
+
+// A size from sized delete, which is the size that was asked for; it saves
+// the allocator looking it up
+void Free(void* memory, std::size_t size) noexcept {
+#if defined(DM_ALLOCATOR_MIMALLOC)
+    mi_free_size(memory, size ? size : 1);
+#elif defined(DM_ALLOCATOR_JEMALLOC)
+    if (memory) {
+        sdallocx(memory, size ? size : 1, 0);
+    }
+#else
+    (void)size;
+    std::free(memory);
+#endif
+}
+
+double ProcessCpuMs() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0;
+    }
+    auto ticks = [](const FILETIME& time) {
+        return (static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return static_cast<double>(ticks(kernel) + ticks(user)) / 10000.0;  // 100ns ticks
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto ms = [](const timeval& time) { return time.tv_sec * 1000.0 + time.tv_usec / 1000.0; };
+    return ms(usage.ru_utime) + ms(usage.ru_stime);
+#endif
+}
+
+uint64_t PeakRssBytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss);  // Bytes on macOS
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;  // Kilobytes on Linux
+#endif
+#endif
+}
+
+double Milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void* Allocate(std::size_t size) {
+    if (CountingTimings.load(std::memory_order_relaxed) > 0) {
+        AllocationCount.fetch_add(1, std::memory_order_relaxed);
+        AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    while (true) {
+        if (void* memory = AllocateFrom(size ? size : 1)) {
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+} // namespace
+
+CompileTimings::Scope::Scope(Scope&& other) noexcept
+    : Timings_(other.Timings_), Index_(other.Index_)
+{
+    other.Timings_ = nullptr;
+}
+
+CompileTimings::Scope& CompileTimings::Scope::operator=(Scope&& other) noexcept {
+    if (this != &other) {
+        End();
+        Timings_ = other.Timings_;
+        Index_ = other.Index_;
+        other.Timings_ = nullptr;
+    }
+    return *this;
+}
+
+void CompileTimings::Scope::End() {
+    if (Timings_) {
+        Timings_->EndPhase(Index_);
+        Timings_ = nullptr;
+    }
+}
+
+CompileTimings::CompileTimings()
+    : Created_(std::chrono::steady_clock::now())
+{
+    CountingTimings.fetch_add(1, std::memory_order_relaxed);
+}
+
+CompileTimings::~CompileTimings() {
+    CountingTimings.fetch_sub(1, std::memory_order_relaxed);
+}
+
+CompileTimings::Scope CompileTimings::Time(CompileTimings* timings, std::string name) {
+    if (!timings) {
+        return Scope();
+    }
+    Phase& phase = timings->Phases_.emplace_back();
+    phase.Name = std::move(name);
+    phase.Depth = timings->OpenPhases_++;
+
+    Start& start = timings->Starts_.emplace_back();
+    start.Allocations = AllocationCount.load(std::memory_order_relaxed);
+    start.AllocatedBytes = AllocatedBytes.load(std::memory_order_relaxed);
+    start.CpuMs = ProcessCpuMs();
+    start.Wall = std::chrono::steady_clock::now();
+    phase.StartMs = Milliseconds(start.Wall - timings->Created_);
+    return Scope(timings, timings->Phases_.size() - 1);
+}
+
+void CompileTimings::EndPhase(size_t index) {
+    auto wall = std::chrono::steady_clock::now();
+    const Start& start = Starts_[index];
+    Phase& phase = Phases_[index];
+    phase.WallMs = Milliseconds(wall - start.Wall);
+    phase.CpuMs = ProcessCpuMs() - start.CpuMs;
+    phase.Allocations = AllocationCount.load(std::memory_order_relaxed) - start.Allocations;
+    phase.AllocatedBytes = AllocatedBytes.load(std::memory_order_relaxed) - start.AllocatedBytes;
+    phase.PeakRssBytes = PeakRssBytes();
+    OpenPhases_--;
+}
+
+const char* CompileTimings::AllocatorName() {
+#if defined(DM_ALLOCATOR_MIMALLOC)
+    return "mimalloc";
+#elif defined(DM_ALLOCATOR_JEMALLOC)
+    return "jemalloc";
+#else
+    return "system";
+#endif
+}
+
+void CompileTimings::Report(std::ostream& out) const {
+    out << "Phase timings (" << AllocatorName() << " allocator):" << std::endl;
+    out << "  " << std::left << std::setw(28) << "Phase" << std::right << std::setw(12) << "Wall ms"
+        << std::setw(12) << "CPU ms" << std::setw(14) << "Peak RSS MB" << std::setw(14) << "Allocations"
+        << std::setw(12) << "Alloc MB" << std::endl;
+    out << std::fixed << std::setprecision(1);
+    for (const Phase& phase : Phases_) {
+        std::string name = std::string(2 * phase.Depth, ' ') + phase.Name;
+        out << "  " << std::left << std::setw(28) << name << std::right << std::setw(12) << phase.WallMs
+            << std::setw(12) << phase.CpuMs << std::setw(14) << phase.PeakRssBytes / (1024.0 * 1024.0)
+            << std::setw(14) << phase.Allocations << std::setw(12) << phase.AllocatedBytes / (1024.0 * 1024.0)
+            << std::endl;
+    }
+    out.unsetf(std::ios::floatfield);
+    out << std::setprecision(6);
+}
+
+bool CompileTimings::WriteJson(const std::string& path) const {
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKeyValue("Allocator", std::string(AllocatorName()));
+    json.WriteKey("Phases");
+    json.BeginArray();
+    for (const Phase& phase : Phases_) {
+        json.BeginObject();
+        json.WriteKeyValue("Name", phase.Name);
+        json.WriteKeyValue("Depth", phase.Depth);
+        json.WriteKey("StartMs");
+        json.WriteDouble(phase.StartMs);
+        json.WriteKey("WallMs");
+        json.WriteDouble(phase.WallMs);
+        json.WriteKey("CpuMs");
+        json.WriteDouble(phase.CpuMs);
+        json.WriteKey("PeakRssBytes");
+        json.WriteInt64(static_cast<int64_t>(phase.PeakRssBytes));
+        json.WriteKey("Allocations");
+        json.WriteInt64(static_cast<int64_t>(phase.Allocations));
+        json.WriteKey("AllocatedBytes");
+        json.WriteInt64(static_cast<int64_t>(phase.AllocatedBytes));
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return WriteBinaryFileAtomic(path, json.ToString());
+}
+
+bool CompileTimings::WriteTrace(const std::string& path) const {
+    // Nested phases are on the same thread, which the viewers stack by time
+    auto microseconds = [](double ms) { return static_cast<int64_t>(std::llround(ms * 1000.0)); };
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKey("traceEvents");
+    json.BeginArray();
+    for (const Phase& phase : Phases_) {
+        json.BeginObject();
+        json.WriteKeyValue("name", phase.Name);
+        json.WriteKeyValue("cat", std::string("compile"));
+        json.WriteKeyValue("ph", std::string("X"));
+        json.WriteKey("ts");
+        json.WriteInt64(microseconds(phase.StartMs));
+        json.WriteKey("dur");
+        json.WriteInt64(microseconds(phase.WallMs));
+        json.WriteKeyValue("pid", 1);
+        json.WriteKeyValue("tid", 1);
+        json.WriteKey("args");
+        json.BeginObject();
+        json.WriteKey("CpuMs");
+        json.WriteDouble(phase.CpuMs);
+        json.WriteKey("PeakRssBytes");
+        json.WriteInt64(static_cast<int64_t>(phase.PeakRssBytes));
+        json.WriteKey("Allocations");
+        json.WriteInt64(static_cast<int64_t>(phase.Allocations));
+        json.WriteKey("AllocatedBytes");
+        json.WriteInt64(static_cast<int64_t>(phase.AllocatedBytes));
+        json.EndObject();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.WriteKeyValue("displayTimeUnit", std::string("ms"));
+    json.EndObject();
+    return WriteBinaryFileAtomic(path, json.ToString());
+}
+
+} // namespace DMCompiler
+
+// Replaced so allocations can be counted; the aligned forms are left to the
+// library, as nothing here over-aligns
+void* operator new(std::size_t size) {
+    return DMCompiler::Allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return DMCompiler::Allocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return DMCompiler::Allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return DMCompiler::Allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* memory) noexcept {
+    DMCompiler::Free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    DMCompiler::Free(memory);
+}
+
+void operator delete(void* memory, std::size_t size) noexcept {
+    DMCompiler::Free(memory, size);
+}
+
+void operator delete[](void* memory, std::size_t size) noexcept {
+    DMCompiler::Free(memory, size);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+    DMCompiler::Free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept {
+    DMCompiler::Free(memory);
+}
@@ -0,0 +1,431 @@
+#include "CompiledOutput.h"
+#include <algorithm>
+
+namespace DMCompiler {
+
+using namespace CompiledOutputFormat;
+
+namespace {
+
+constexpr uint32_t StringsSection = SectionId("STRS");
+constexpr uint32_t NamesSection = SectionId("NAME");
+constexpr uint32_t ResourcesSection = SectionId("RSRC");
+constexpr uint32_t IntsSection = SectionId("INTS");
+constexpr uint32_t ValuesSection = SectionId("VALS");
+constexpr uint32_t TypesSection = SectionId("TYPE");
+constexpr uint32_t ProcsSection = SectionId("PROC");
+constexpr uint32_t CodeSection = SectionId("CODE");
+constexpr uint32_t RootSection = SectionId("ROOT");
+constexpr uint32_t MapsSection = SectionId("MAPS");
+constexpr uint32_t CellKeysSection = SectionId("KEYS");
+constexpr uint32_t CellsSection = SectionId("CELL");
+constexpr uint32_t MapObjectsSection = SectionId("MOBJ");
+constexpr uint32_t BlocksSection = SectionId("BLKS");
+constexpr uint32_t VerbsSection = SectionId("VERB");
+constexpr uint32_t VerbIndexSection = SectionId("VIDX");
+
+constexpr size_t HeaderSize = 16;
+constexpr size_t SectionEntrySize = 24;
+
+void AppendWord(std::string& out, uint32_t word) {
+    char bytes[4] = {static_cast<char>(word), static_cast<char>(word >> 8), static_cast<char>(word >> 16),
+                     static_cast<char>(word >> 24)};
+    out.append(bytes, 4);
+}
+
+template <typename Record>
+void AppendRecords(std::string& out, const std::vector<Record>& records) {
+    static_assert(std::is_trivially_copyable_v<Record> && sizeof(Record) % 4 == 0, "records are u32 words");
+    out.reserve(out.size() + records.size() * sizeof(Record));
+    for (const Record& record : records) {
+        uint32_t words[sizeof(Record) / 4];
+        std::memcpy(words, &record, sizeof(Record));
+        for (uint32_t word : words) {
+            AppendWord(out, word);
+        }
+    }
+}
+
+std::string StringPoolSection(const std::vector<std::string>& strings) {
+    std::string out;
+    AppendWord(out, static_cast<uint32_t>(strings.size()));
+    uint32_t offset = 0;
+    AppendWord(out, offset);
+    for (const auto& value : strings) {
+        offset += static_cast<uint32_t>(value.size());
+        AppendWord(out, offset);
+    }
+    for (const auto& value : strings) {
+        out += value;
+    }
+    return out;
+}
+
+} // namespace
+
+uint32_t CompiledOutputWriter::AddName(std::string_view name) {
+    auto [it, inserted] = NameIds_.try_emplace(name, static_cast<uint32_t>(Names_.size()));
+    if (inserted) {
+        Names_.emplace_back(name);
+    }
+    return it->second;
+}
+
+uint32_t CompiledOutputWriter::AddValue(const JsonValue& value) {
+    CompiledValue record{CompiledValueKind::Null, 0, 0, 0};
+    std::visit([&](auto&& arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, bool>) {
+            record.Kind = CompiledValueKind::Bool;
+            record.Low = arg ? 1 : 0;
+        } else if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, double>) {
+            uint64_t bits;
+            std::memcpy(&bits, &arg, sizeof(bits));
+            record.Kind = std::is_same_v<T, int64_t> ? CompiledValueKind::Int : CompiledValueKind::Double;
+            record.Low = static_cast<uint32_t>(bits);
+            record.High = static_cast<uint32_t>(bits >> 32);
+        } else if constexpr (std::is_same_v<T, JsonString>) {
+            record.Kind = CompiledValueKind::String;
+            record.Low = AddName(*arg.Text);
+        } else if constexpr (std::is_same_v<T, JsonObject>) {
+            std::vector<uint32_t> pairs;
+            for (const auto& [key, entryValue] : *arg.Entries) {
+                pairs.push_back(AddName(key));
+                pairs.push_back(AddName(entryValue));
+            }
+            record.Kind = CompiledValueKind::Map;
+            record.Count = static_cast<uint32_t>(arg.Entries->size());
+            record.Low = AddInts(pairs);
+        } else if constexpr (std::is_same_v<T, ResourceRef>) {
+            record.Kind = CompiledValueKind::Resource;
+            record.Low = static_cast<uint32_t>(arg.id);
+        }
+    }, value);
+
+    std::string_view key(reinterpret_cast<const char*>(&record), sizeof(record));
+    auto [it, inserted] = ValueIds_.try_emplace(key, static_cast<uint32_t>(Values_.size()));
+    if (inserted) {
+        Values_.push_back(record);
+    }
+    return it->second;
+}
+
+uint32_t CompiledOutputWriter::AddInts(const std::vector<uint32_t>& ints) {
+    uint32_t offset = static_cast<uint32_t>(Ints_.size());
+    Ints_.insert(Ints_.end(), ints.begin(), ints.end());
+    return offset;
+}
+
+void CompiledOutputWriter::AddProc(CompiledProc proc, const std::vector<uint8_t>& bytecode) {
+    std::string_view code(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+    bool shared = false;
+    proc.CodeOffset = StoreCode(code, true, shared);
+    proc.CodeSize = static_cast<uint32_t>(code.size());
+    if (shared) {
+        SharedCodeBytes_ += code.size();
+    }
+    Procs_.push_back(proc);
+}
+
+void CompiledOutputWriter::PlaceCode(const std::vector<uint8_t>& bytecode) {
+    bool shared = false;
+    StoreCode(std::string_view(reinterpret_cast<const char*>(bytecode.data()), bytecode.size()), false, shared);
+}
+
+uint32_t CompiledOutputWriter::StoreCode(std::string_view code, bool use, bool& shared) {
+    // String, type and proc operands are IDs into tables shared by every
+    // proc, so the same bytes mean the same code wherever they appear
+    std::vector<StoredCode>& sameHash = CodeByHash_[std::hash<std::string_view>()(code)];
+    for (StoredCode& stored : sameHash) {
+        if (std::string_view(Code_).substr(stored.Offset, stored.Size) == code) {
+            shared = stored.Used;
+            stored.Used |= use;
+            return stored.Offset;
+        }
+    }
+    uint32_t offset = static_cast<uint32_t>(Code_.size());
+    Code_ += code;
+    sameHash.push_back({offset, static_cast<uint32_t>(code.size()), use});
+    shared = false;
+    return offset;
+}
+
+uint32_t CompiledOutputWriter::AddMapObject(int32_t type, const std::vector<uint32_t>& overrides) {
+    // Override names and values are pooled, so equal objects have equal words
+    std::vector<uint32_t> words{static_cast<uint32_t>(type)};
+    words.insert(words.end(), overrides.begin(), overrides.end());
+    std::string_view key(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    auto [it, inserted] = MapObjectIds_.try_emplace(key, static_cast<uint32_t>(MapObjects_.size()));
+    if (inserted) {
+        MapObjects_.push_back({type, AddInts(overrides), static_cast<uint32_t>(overrides.size() / 2)});
+    }
+    return it->second;
+}
+
+uint32_t CompiledOutputWriter::AddCell(int32_t turf, int32_t area, const std::vector<uint32_t>& objects) {
+    std::vector<uint32_t> words{static_cast<uint32_t>(turf), static_cast<uint32_t>(area)};
+    words.insert(words.end(), objects.begin(), objects.end());
+    std::string_view key(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    auto [it, inserted] = CellIds_.try_emplace(key, static_cast<uint32_t>(Cells_.size()));
+    if (inserted) {
+        Cells_.push_back({turf, area, AddInts(objects), static_cast<uint32_t>(objects.size())});
+    }
+    return it->second;
+}
+
+uint32_t CompiledOutputWriter::AddBlock(const CompiledBlock& block) {
+    Blocks_.push_back(block);
+    return static_cast<uint32_t>(Blocks_.size() - 1);
+}
+
+std::string CompiledOutputWriter::Finish() const {
+    std::vector<std::pair<uint32_t, std::string>> sections;
+    sections.emplace_back(StringsSection, StringPoolSection(Strings_));
+    sections.emplace_back(NamesSection, StringPoolSection(Names_));
+    sections.emplace_back(ResourcesSection, StringPoolSection(Resources_));
+    sections.emplace_back(IntsSection, std::string());
+    for (uint32_t word : Ints_) {
+        AppendWord(sections.back().second, word);
+    }
+    sections.emplace_back(ValuesSection, std::string());
+    AppendRecords(sections.back().second, Values_);
+    sections.emplace_back(TypesSection, std::string());
+    AppendRecords(sections.back().second, Types_);
+    sections.emplace_back(ProcsSection, std::string());
+    AppendRecords(sections.back().second, Procs_);
+    sections.emplace_back(RootSection, std::string());
+    AppendRecords(sections.back().second, std::vector<CompiledRoot>{Root_});
+    sections.emplace_back(MapsSection, std::string());
+    AppendRecords(sections.back().second, Maps_);
+    sections.emplace_back(CellKeysSection, std::string());
+    AppendRecords(sections.back().second, CellKeys_);
+    sections.emplace_back(CellsSection, std::string());
+    AppendRecords(sections.back().second, Cells_);
+    sections.emplace_back(MapObjectsSection, std::string());
+    AppendRecords(sections.back().second, MapObjects_);
+    sections.emplace_back(BlocksSection, std::string());
+    AppendRecords(sections.back().second, Blocks_);
+    sections.emplace_back(VerbsSection, std::string());
+    AppendRecords(sections.back().second, Verbs_);
+    std::vector<uint32_t> byName(Verbs_.size());
+    for (size_t i = 0; i < byName.size(); ++i) {
+        byName[i] = static_cast<uint32_t>(i);
+    }
+    std::stable_sort(byName.begin(), byName.end(), [&](uint32_t a, uint32_t b) {
+        return Names_[Verbs_[a].Name] < Names_[Verbs_[b].Name];
+    });
+    sections.emplace_back(VerbIndexSection, std::string());
+    for (uint32_t verb : byName) {
+        AppendWord(sections.back().second, verb);
+    }
+    // Last, as it is the largest and what an edit changes the length of
+    sections.emplace_back(CodeSection, Code_);
+
+    std::string out;
+    out.append(Magic, sizeof(Magic));
+    AppendWord(out, Version);
+    AppendWord(out, Flags_);
+    AppendWord(out, static_cast<uint32_t>(sections.size()));
+
+    uint64_t offset = HeaderSize + SectionEntrySize * sections.size();
+    for (const auto& [id, data] : sections) {
+        offset = (offset + 7) & ~uint64_t(7);
+        AppendWord(out, id);
+        AppendWord(out, 0);
+        AppendWord(out, static_cast<uint32_t>(offset));
+        AppendWord(out, static_cast<uint32_t>(offset >> 32));
+        AppendWord(out, static_cast<uint32_t>(data.size()));
+        AppendWord(out, static_cast<uint32_t>(static_cast<uint64_t>(data.size()) >> 32));
+        offset += data.size();
+    }
+    out.reserve(offset);
+    for (const auto& [id, data] : sections) {
+        out.append((8 - out.size() % 8) % 8, '\0');
+        out += data;
+    }
+    return out;
+}
+
+std::string_view CompiledOutputView::StringPool::Get(std::string_view data, size_t index) const {
+    if (index >= Count) {
+        return std::string_view();
+    }
+    auto word = [&](size_t offset) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(data.data() + offset);
+        return static_cast<size_t>(bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24);
+    };
+    size_t begin = word(Offsets + index * 4);
+    size_t end = word(Offsets + index * 4 + 4);
+    return data.substr(Bytes + begin, end - begin);
+}
+
+uint32_t CompiledOutputView::ReadWord(size_t offset) const {
+    if (offset + 4 > Data_.size()) {
+        return 0;
+    }
+    const auto* bytes = reinterpret_cast<const uint8_t*>(Data_.data() + offset);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+bool CompiledOutputView::OpenStringPool(const Section& section, StringPool& pool) const {
+    if (section.Size < 8) {
+        return false;
+    }
+    size_t count = ReadWord(section.Offset);
+    if ((section.Size - 4) / 4 < count + 1) {
+        return false;
+    }
+    size_t offsets = section.Offset + 4;
+    size_t bytes = offsets + (count + 1) * 4;
+    size_t byteCount = section.Offset + section.Size - bytes;
+    // Offsets must rise and end within the section, so Get() never checks them
+    uint32_t previous = 0;
+    for (size_t i = 0; i <= count; ++i) {
+        uint32_t offset = ReadWord(offsets + i * 4);
+        if (offset < previous || offset > byteCount) {
+            return false;
+        }
+        previous = offset;
+    }
+    pool = {count, offsets, bytes};
+    return true;
+}
+
+bool CompiledOutputView::Open(std::string_view data) {
+    *this = CompiledOutputView();
+    Data_ = data;
+    if (data.size() < HeaderSize || std::memcmp(data.data(), Magic, sizeof(Magic)) != 0 ||
+        ReadWord(4) != Version) {
+        return false;
+    }
+    Flags_ = ReadWord(8);
+    size_t sectionCount = ReadWord(12);
+    if ((data.size() - HeaderSize) / SectionEntrySize < sectionCount) {
+        return false;
+    }
+
+    Section strings, names, resources;
+    for (size_t i = 0; i < sectionCount; ++i) {
+        size_t entry = HeaderSize + i * SectionEntrySize;
+        uint64_t offset = ReadWord(entry + 8) | static_cast<uint64_t>(ReadWord(entry + 12)) << 32;
+        uint64_t size = ReadWord(entry + 16) | static_cast<uint64_t>(ReadWord(entry + 20)) << 32;
+        if (offset > data.size() || size > data.size() - offset) {
+            return false;
+        }
+        Section section{static_cast<size_t>(offset), static_cast<size_t>(size)};
+        switch (ReadWord(entry)) {
+            case StringsSection: strings = section; break;
+            case NamesSection: names = section; break;
+            case ResourcesSection: resources = section; break;
+            case IntsSection: Ints_ = section; break;
+            case ValuesSection: Values_ = section; break;
+            case TypesSection: Types_ = section; break;
+            case ProcsSection: Procs_ = section; break;
+            case CodeSection: Code_ = section; break;
+            case RootSection: Root_ = section; break;
+            case MapsSection: Maps_ = section; break;
+            case CellKeysSection: CellKeys_ = section; break;
+            case CellsSection: Cells_ = section; break;
+            case MapObjectsSection: MapObjects_ = section; break;
+            case BlocksSection: Blocks_ = section; break;
+            case VerbsSection: Verbs_ = section; break;
+            case VerbIndexSection: VerbIndex_ = section; break;
+            default: break;
+        }
+    }
+    if (!OpenStringPool(strings, Strings_) || !OpenStringPool(names, Names_) ||
+        !OpenStringPool(resources, Resources_) || Root_.Size < sizeof(CompiledRoot)) {
+        return false;
+    }
+    // Every list a record points at must lie in INTS, so a reader can trust its
+    // count instead of looping (or allocating) as far as a bad one says
+    for (size_t i = 0; i < ProcCount(); ++i) {
+        CompiledProc proc = GetProc(i);
+        if (proc.CodeOffset > Code_.Size || proc.CodeSize > Code_.Size - proc.CodeOffset ||
+            !InInts(proc.Arguments, uint64_t(proc.ArgumentCount) * 2)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < TypeCount(); ++i) {
+        CompiledType type = GetType(i);
+        if (!InInts(type.ProcGroups, uint64_t(type.ProcGroupCount) * 2) ||
+            !InInts(type.Variables, uint64_t(type.VariableCount) * 2) ||
+            !InInts(type.ConstVariables, type.ConstVariableCount) ||
+            !InInts(type.TmpVariables, type.TmpVariableCount)) {
+            return false;
+        }
+        for (uint32_t group = 0; group < type.ProcGroupCount; ++group) {
+            if (!InInts(GetInt(type.ProcGroups + group * 2), GetInt(type.ProcGroups + group * 2 + 1))) {
+                return false;
+            }
+        }
+    }
+    for (size_t i = 0; i < Values_.Size / sizeof(CompiledValue); ++i) {
+        CompiledValue value = GetValue(static_cast<uint32_t>(i));
+        if (value.Kind == CompiledValueKind::Map && !InInts(value.Low, uint64_t(value.Count) * 2)) {
+            return false;
+        }
+    }
+    CompiledRoot root = GetRoot();
+    if (!InInts(root.GlobalProcs, root.GlobalProcCount) || !InInts(root.Globals, uint64_t(root.GlobalCount) * 2) ||
+        !InInts(root.OptionalErrors, uint64_t(root.OptionalErrorCount) * 2)) {
+        return false;
+    }
+    for (size_t i = 0; i < MapCount(); ++i) {
+        CompiledMap map = GetMap(i);
+        if (uint64_t(map.FirstKey) + map.KeyCount > CellKeys_.Size / sizeof(CompiledCellKey) ||
+            uint64_t(map.FirstBlock) + map.BlockCount > Blocks_.Size / sizeof(CompiledBlock)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < Cells_.Size / sizeof(CompiledCell); ++i) {
+        CompiledCell cell = GetCell(i);
+        if (!InInts(cell.Objects, cell.ObjectCount)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < MapObjects_.Size / sizeof(CompiledMapObject); ++i) {
+        CompiledMapObject object = GetMapObject(i);
+        if (!InInts(object.Overrides, uint64_t(object.OverrideCount) * 2)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < Blocks_.Size / sizeof(CompiledBlock); ++i) {
+        CompiledBlock block = GetBlock(i);
+        if (!InInts(block.Cells, block.CellCount)) {
+            return false;
+        }
+    }
+    // FindVerbs() compares names through the index without checking it
+    if (VerbIndex_.Size != VerbCount() * 4) {
+        return false;
+    }
+    for (size_t i = 0; i < VerbCount(); ++i) {
+        if (GetVerbByName(i) >= VerbCount() || GetVerb(GetVerbByName(i)).Name >= Names_.Count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::pair<size_t, size_t> CompiledOutputView::FindVerbs(std::string_view name) const {
+    auto nameAt = [&](size_t position) { return GetName(GetVerb(GetVerbByName(position)).Name); };
+    size_t first = 0;
+    size_t count = VerbCount();
+    while (count > 0) {
+        size_t half = count / 2;
+        if (nameAt(first + half) < name) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    size_t last = first;
+    while (last < VerbCount() && nameAt(last) == name) {
+        ++last;
+    }
+    return {first, last};
+}
+
+} // namespace DMCompiler
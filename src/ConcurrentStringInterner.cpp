@@ -0,0 +1,66 @@
+#include "ConcurrentStringInterner.h"
+#include <mutex>
+
+namespace DMCompiler {
+
+ConcurrentStringInterner::ConcurrentStringInterner() {
+    for (auto& shard : Shards_) {
+        shard = std::make_unique<Shard>();
+    }
+}
+
+ConcurrentStringInterner::~ConcurrentStringInterner() = default;
+
+int ConcurrentStringInterner::Intern(std::string_view value) {
+    Key key{value, std::hash<std::string_view>{}(value)};
+    Shard& shard = ShardFor(key.Hash);
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+        auto it = shard.Ids.find(key);
+        if (it != shard.Ids.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(shard.Mutex);
+    // Another thread may have added it in between
+    auto it = shard.Ids.find(key);
+    if (it != shard.Ids.end()) {
+        return it->second;
+    }
+
+    int id;
+    {
+        std::unique_lock<std::shared_mutex> stringsLock(StringsMutex_);
+        id = static_cast<int>(Strings_.size());
+        Strings_.emplace_back(value);
+        key.Text = Strings_.back();
+    }
+    shard.Ids.emplace(key, id);
+    return id;
+}
+
+int ConcurrentStringInterner::Find(std::string_view value) const {
+    Key key{value, std::hash<std::string_view>{}(value)};
+    const Shard& shard = ShardFor(key.Hash);
+    std::shared_lock<std::shared_mutex> lock(shard.Mutex);
+    auto it = shard.Ids.find(key);
+    return it != shard.Ids.end() ? it->second : -1;
+}
+
+const std::string& ConcurrentStringInterner::operator[](int id) const {
+    std::shared_lock<std::shared_mutex> lock(StringsMutex_);
+    return Strings_[static_cast<size_t>(id)];
+}
+
+size_t ConcurrentStringInterner::Size() const {
+    std::shared_lock<std::shared_mutex> lock(StringsMutex_);
+    return Strings_.size();
+}
+
+std::vector<std::string> ConcurrentStringInterner::ToVector() const {
+    std::shared_lock<std::shared_mutex> lock(StringsMutex_);
+    return std::vector<std::string>(Strings_.begin(), Strings_.end());
+}
+
+} // namespace DMCompiler
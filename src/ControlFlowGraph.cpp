@@ -0,0 +1,143 @@
+#include "ControlFlowGraph.h"
+#include "DMReference.h"
+#include <unordered_map>
+
+namespace DMCompiler {
+
+// Reads of locals are written with this type byte by the expression compiler
+static constexpr uint8_t LocalReadReferenceType = 28;
+
+ControlFlowGraph::ControlFlowGraph(const std::vector<BytecodeInstruction>& instructions)
+    : Instructions_(instructions), InstructionBlocks_(instructions.size()) {
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        bool leader = i == 0 || !instructions[i].Labels.empty() ||
+                      instructions[i - 1].JumpLabel >= 0 || EndsFlow(instructions[i - 1].Opcode);
+        if (leader) {
+            if (!Blocks_.empty()) {
+                Blocks_.back().End = i;
+            }
+            Blocks_.emplace_back();
+            Blocks_.back().Begin = i;
+        }
+        InstructionBlocks_[i] = Blocks_.size() - 1;
+    }
+    if (Blocks_.empty()) {
+        return;
+    }
+    Blocks_.back().End = instructions.size();
+
+    std::unordered_map<int, size_t> labelBlocks;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        for (int label : instructions[i].Labels) {
+            labelBlocks[label] = InstructionBlocks_[i];
+        }
+    }
+
+    for (size_t b = 0; b < Blocks_.size(); ++b) {
+        BasicBlock& block = Blocks_[b];
+        const BytecodeInstruction& last = instructions[block.End - 1];
+        if (!EndsFlow(last.Opcode) && b + 1 < Blocks_.size()) {
+            block.Successors.push_back(b + 1);
+        }
+        // Labels at the very end of the proc have no block; jumping there returns
+        if (last.JumpLabel >= 0) {
+            auto it = labelBlocks.find(last.JumpLabel);
+            if (it != labelBlocks.end() && (block.Successors.empty() || block.Successors.front() != it->second)) {
+                block.Successors.push_back(it->second);
+            }
+        }
+    }
+
+    std::vector<size_t> worklist{0};
+    Blocks_[0].Reachable = true;
+    while (!worklist.empty()) {
+        size_t b = worklist.back();
+        worklist.pop_back();
+        for (size_t successor : Blocks_[b].Successors) {
+            if (!Blocks_[successor].Reachable) {
+                Blocks_[successor].Reachable = true;
+                worklist.push_back(successor);
+            }
+        }
+    }
+}
+
+void ControlFlowGraph::ComputeLiveness() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        // Liveness flows backwards, so walking the blocks in reverse settles faster
+        for (size_t b = Blocks_.size(); b-- > 0;) {
+            BasicBlock& block = Blocks_[b];
+            LocalSet liveOut;
+            for (size_t successor : block.Successors) {
+                liveOut |= Blocks_[successor].LiveIn;
+            }
+            LocalSet live = liveOut;
+            for (size_t i = block.End; i-- > block.Begin;) {
+                int written = WrittenLocal(Instructions_[i]);
+                if (written >= 0) {
+                    live.reset(static_cast<size_t>(written));
+                }
+                live |= ReadLocals(Instructions_[i]);
+            }
+            if (liveOut != block.LiveOut || live != block.LiveIn) {
+                block.LiveOut = liveOut;
+                block.LiveIn = live;
+                changed = true;
+            }
+        }
+    }
+}
+
+ControlFlowGraph::LocalSet ControlFlowGraph::LiveAfter(size_t instruction) const {
+    const BasicBlock& block = Blocks_[InstructionBlocks_[instruction]];
+    LocalSet live = block.LiveOut;
+    for (size_t i = block.End; i-- > instruction + 1;) {
+        int written = WrittenLocal(Instructions_[i]);
+        if (written >= 0) {
+            live.reset(static_cast<size_t>(written));
+        }
+        live |= ReadLocals(Instructions_[i]);
+    }
+    return live;
+}
+
+int ControlFlowGraph::WrittenLocal(const BytecodeInstruction& instruction) {
+    if ((instruction.Opcode == DreamProcOpcode::Assign || instruction.Opcode == DreamProcOpcode::AssignNoPush) &&
+        instruction.Bytes.size() == 3 && instruction.Bytes[1] == static_cast<uint8_t>(DMReference::Type::Local)) {
+        return instruction.Bytes[2];
+    }
+    return -1;
+}
+
+ControlFlowGraph::LocalSet ControlFlowGraph::ReadLocals(const BytecodeInstruction& instruction) {
+    LocalSet reads;
+    if (WrittenLocal(instruction) >= 0) {
+        return reads;
+    }
+    // Operands are not decoded, so every byte pair that looks like a local
+    // reference counts; a constant that happens to match only keeps a store
+    for (size_t i = 1; i + 1 < instruction.Bytes.size(); ++i) {
+        uint8_t type = instruction.Bytes[i];
+        if (type == static_cast<uint8_t>(DMReference::Type::Local) || type == LocalReadReferenceType) {
+            reads.set(instruction.Bytes[i + 1]);
+        }
+    }
+    return reads;
+}
+
+bool ControlFlowGraph::EndsFlow(DreamProcOpcode opcode) {
+    switch (opcode) {
+        case DreamProcOpcode::Jump:
+        case DreamProcOpcode::Return:
+        case DreamProcOpcode::ReturnFloat:
+        case DreamProcOpcode::ReturnReferenceValue:
+        case DreamProcOpcode::Throw:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace DMCompiler
@@ -15,31 +15,63 @@ std::string DMASTNode::ToString() const {
     return oss.str();
 }
 
+namespace {
+// Kept a full alignment unit so the node after the header stays aligned
+constexpr size_t NodeHeaderSize = alignof(std::max_align_t);
+enum NodeStorage : unsigned char { HeapNode = 0, ArenaNode = 1 };
+}
+
+void* DMASTNode::operator new(size_t size) {
+    auto* block = static_cast<unsigned char*>(::operator new(size + NodeHeaderSize));
+    block[0] = HeapNode;
+    return block + NodeHeaderSize;
+}
+
+void* DMASTNode::operator new(size_t size, DMASTArena& arena) {
+    auto* block = static_cast<unsigned char*>(arena.Allocate(size + NodeHeaderSize));
+    block[0] = ArenaNode;
+    return block + NodeHeaderSize;
+}
+
+void DMASTNode::operator delete(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    auto* block = static_cast<unsigned char*>(ptr) - NodeHeaderSize;
+    if (block[0] == HeapNode) {
+        ::operator delete(block);
+    }
+}
+
+void DMASTNode::operator delete(void*, DMASTArena&) {
+    // Only called when a constructor throws; the arena keeps the memory
+}
+
 // ============================================================================
 // DMASTFile
 // ============================================================================
 
 DMASTFile::DMASTFile(const Location& location, std::vector<std::unique_ptr<DMASTStatement>> statements)
-    : DMASTNode(location), Statements(std::move(statements)) {}
+    : DMASTNode(StaticKind, location), Statements(std::move(statements)) {}
 
 // ============================================================================
 // DMASTBlockInner
 // ============================================================================
 
 DMASTBlockInner::DMASTBlockInner(const Location& location, std::vector<std::unique_ptr<DMASTStatement>> statements)
-    : DMASTNode(location), Statements(std::move(statements)) {}
+    : DMASTNode(StaticKind, location), Statements(std::move(statements)) {}
 
 // ============================================================================
 // DMASTProcBlockInner
 // ============================================================================
 
 DMASTProcBlockInner::DMASTProcBlockInner(const Location& location)
-    : DMASTNode(location) {}
+    : DMASTNode(StaticKind, location) {}
 
 DMASTProcBlockInner::DMASTProcBlockInner(const Location& location,
                                          std::vector<std::unique_ptr<DMASTProcStatement>> statements,
                                          std::vector<std::unique_ptr<DMASTProcStatement>> setStatements)
-    : DMASTNode(location), Statements(std::move(statements)), SetStatements(std::move(setStatements)) {}
+    : DMASTNode(StaticKind, location), Statements(std::move(statements)), SetStatements(std::move(setStatements)) {}
 
 // DMASTPath is now a struct with inline constructor, no implementation needed
 
@@ -50,7 +82,7 @@ DMASTProcBlockInner::DMASTProcBlockInner(const Location& location,
 DMASTCallParameter::DMASTCallParameter(const Location& location,
                                        std::unique_ptr<DMASTExpression> value,
                                        std::unique_ptr<DMASTExpression> key)
-    : DMASTNode(location), Value(std::move(value)), Key(std::move(key)) {}
+    : DMASTNode(StaticKind, location), Value(std::move(value)), Key(std::move(key)) {}
 
 // ============================================================================
 // DMASTDefinitionParameter
@@ -63,7 +95,7 @@ DMASTDefinitionParameter::DMASTDefinitionParameter(const Location& location,
                                                    std::unique_ptr<DMASTExpression> defaultValue,
                                                    std::unique_ptr<DMASTExpression> possibleValues,
                                                    std::optional<DMComplexValueType> explicitValueType)
-    : DMASTNode(location), Name(name), TypePath(typePath), IsList(isList),
+    : DMASTNode(StaticKind, location), Name(name), TypePath(typePath), IsList(isList),
       DefaultValue(std::move(defaultValue)), PossibleValues(std::move(possibleValues)),
       ExplicitValueType(explicitValueType) {}
 
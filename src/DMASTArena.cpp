@@ -0,0 +1,50 @@
+#include "DMASTArena.h"
+
+namespace DMCompiler {
+
+static size_t AlignUp(size_t size) {
+    return (size + DMASTArena::Alignment - 1) & ~(DMASTArena::Alignment - 1);
+}
+
+char* DMASTArena::NewChunk(size_t size) {
+    size_t elements = (size + sizeof(std::max_align_t) - 1) / sizeof(std::max_align_t);
+    Chunks_.emplace_back(new std::max_align_t[elements]);
+    return reinterpret_cast<char*>(Chunks_.back().get());
+}
+
+void* DMASTArena::Allocate(size_t size) {
+    size = AlignUp(size == 0 ? 1 : size);
+    BytesUsed_ += size;
+
+    if (size > static_cast<size_t>(End_ - Next_)) {
+        // Oversized requests get a dedicated chunk so the current one keeps
+        // its free space
+        if (size > ChunkSize / 4) {
+            return NewChunk(size);
+        }
+        Next_ = NewChunk(ChunkSize);
+        End_ = Next_ + ChunkSize;
+    }
+
+    char* result = Next_;
+    Next_ += size;
+    return result;
+}
+
+void DMASTArena::Adopt(DMASTArena& other) {
+    // Chunk buffers do not move with their owning pointers, so nodes stay put
+    for (auto& chunk : other.Chunks_) {
+        Chunks_.push_back(std::move(chunk));
+    }
+    BytesUsed_ += other.BytesUsed_;
+    other.Reset();
+}
+
+void DMASTArena::Reset() {
+    Chunks_.clear();
+    Next_ = nullptr;
+    End_ = nullptr;
+    BytesUsed_ = 0;
+}
+
+} // namespace DMCompiler
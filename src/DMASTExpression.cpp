@@ -5,29 +5,33 @@
 
 namespace DMCompiler {
 
+// DMASTExpressionBinary
+DMASTExpressionBinary::~DMASTExpressionBinary() {
+    std::unique_ptr<DMASTExpression> left = std::move(Left);
+    while (left && left->Kind_ == DMASTNodeKind::ExpressionBinary) {
+        // Taken before it is freed, so freeing it frees nothing nested
+        std::unique_ptr<DMASTExpression> next = std::move(static_cast<DMASTExpressionBinary*>(left.get())->Left);
+        left = std::move(next);
+    }
+}
+
 // DMASTConstantNull
-bool DMASTConstantNull::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTConstantNull::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants&, JsonValue& outJson) {
     outJson = nullptr;
     return true;
 }
 
 // DMASTConstantInteger
-bool DMASTConstantInteger::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTConstantInteger::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants&, JsonValue& outJson) {
     outJson = static_cast<int64_t>(Value);
     return true;
 }
 
 // DMASTConstantFloat
-bool DMASTConstantFloat::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTConstantFloat::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) {
     // Check for infinity
     if (std::isinf(Value)) {
-        std::unordered_map<std::string, std::string> specialValue;
-        if (Value > 0) {
-            specialValue["type"] = "PositiveInfinity";
-        } else {
-            specialValue["type"] = "NegativeInfinity";
-        }
-        outJson = specialValue;
+        outJson = constants.Object({{"type", Value > 0 ? "PositiveInfinity" : "NegativeInfinity"}});
     } else {
         outJson = static_cast<double>(Value);
     }
@@ -35,24 +39,24 @@ bool DMASTConstantFloat::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue
 }
 
 // DMASTConstantString
-bool DMASTConstantString::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
-    outJson = Value;
+bool DMASTConstantString::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) {
+    outJson = constants.String(Value);
     return true;
 }
 
 // DMASTStringFormat
-bool DMASTStringFormat::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTStringFormat::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) {
     // String format with embedded expressions - for now, just return a placeholder
     // Full support would require extending JsonValue to support arrays/objects
     std::string result = "[string format: ";
     result += std::to_string(StringParts.size()) + " parts, ";
     result += std::to_string(Expressions.size()) + " expressions]";
-    outJson = result;
+    outJson = constants.String(result);
     return true;
 }
 
 // DMASTConstantResource
-bool DMASTConstantResource::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTConstantResource::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) {
     // Resources are serialized as {"type": "resource", "id": N}
     // Look up the resource ID from the compiler
     int resourceId = compiler->GetResourceId(Path);
@@ -61,14 +65,14 @@ bool DMASTConstantResource::TryAsJsonRepresentation(DMCompiler* compiler, JsonVa
         return true;
     }
     // Fallback: output as string if ID not found
-    outJson = Path;
+    outJson = constants.String(Path);
     return true;
 }
 
 // DMASTConstantPath
-bool DMASTConstantPath::TryAsJsonRepresentation(DMCompiler* compiler, JsonValue& outJson) {
+bool DMASTConstantPath::TryAsJsonRepresentation(DMCompiler* compiler, JsonConstants& constants, JsonValue& outJson) {
     // Paths are serialized as their string representation
-    outJson = Path.Path.ToString();
+    outJson = constants.String(Path.Path.ToString());
     return true;
 }
 
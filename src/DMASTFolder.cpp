@@ -2,118 +2,320 @@
 #include "DMAST.h"
 #include "DMASTStatement.h"
 #include "DMASTExpression.h"
+#include <cmath>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace DMCompiler {
 
-void DMASTFolder::FoldAst(DMASTNode* ast) {
-    if (!ast) return;
+namespace {
 
-    // Handle different node types
-    if (auto* file = dynamic_cast<DMASTFile*>(ast)) {
-        for (auto& statement : file->Statements) {
-            FoldAst(statement.get());
-        }
-    }
-    else if (auto* objectDef = dynamic_cast<DMASTObjectDefinition*>(ast)) {
-        for (auto& statement : objectDef->InnerStatements) {
-            FoldAst(statement.get());
-        }
-    }
-    else if (auto* objectVarDef = dynamic_cast<DMASTObjectVarDefinition*>(ast)) {
-        objectVarDef->Value = FoldExpression(std::move(objectVarDef->Value));
-    }
-    else if (auto* objectVarOverride = dynamic_cast<DMASTObjectVarOverride*>(ast)) {
-        objectVarOverride->Value = FoldExpression(std::move(objectVarOverride->Value));
-    }
-    else if (auto* procExpr = dynamic_cast<DMASTProcStatementExpression*>(ast)) {
-        procExpr->Expression = FoldExpression(std::move(procExpr->Expression));
+// An operand the folder can evaluate. DM numbers are float32 whatever literal
+// they were written as; FromInteger only decides which node a result becomes
+struct ConstantValue {
+    enum class Type { Number, String, Null };
+
+    Type ValueType = Type::Null;
+    float Number = 0.0f;
+    bool FromInteger = false;
+    const std::string* String = nullptr;
+};
+
+std::optional<ConstantValue> GetConstant(DMASTExpression* expr) {
+    ConstantValue value;
+    switch (expr ? expr->Kind_ : DMASTNodeKind::InvalidExpression) {
+        case DMASTNodeKind::ConstantInteger:
+            value.ValueType = ConstantValue::Type::Number;
+            value.Number = static_cast<float>(static_cast<DMASTConstantInteger*>(expr)->Value);
+            value.FromInteger = true;
+            return value;
+        case DMASTNodeKind::ConstantFloat:
+            value.ValueType = ConstantValue::Type::Number;
+            value.Number = static_cast<DMASTConstantFloat*>(expr)->Value;
+            return value;
+        case DMASTNodeKind::ConstantString:
+            value.ValueType = ConstantValue::Type::String;
+            value.String = &static_cast<DMASTConstantString*>(expr)->Value;
+            return value;
+        case DMASTNodeKind::ConstantNull:
+            return value;
+        default:
+            return std::nullopt;
     }
-    else if (auto* procRet = dynamic_cast<DMASTProcStatementReturn*>(ast)) {
-        procRet->Value = FoldExpression(std::move(procRet->Value));
+}
+
+// True if the runtime's integer conversion of the number is exact
+bool IsInteger(float value) {
+    return std::isfinite(value) && value == std::trunc(value) &&
+           value >= -2147483648.0f && value < 2147483648.0f;
+}
+
+std::unique_ptr<DMASTExpression> MakeNumber(const Location& loc, float value, bool fromInteger) {
+    if (!std::isfinite(value)) {
+        return nullptr; // NaN and infinities are left to the runtime
     }
-    else if (auto* procDel = dynamic_cast<DMASTProcStatementDel*>(ast)) {
-        procDel->Value = FoldExpression(std::move(procDel->Value));
+    if (fromInteger && IsInteger(value)) {
+        return std::make_unique<DMASTConstantInteger>(loc, static_cast<int32_t>(value));
     }
-    else if (auto* procThrow = dynamic_cast<DMASTProcStatementThrow*>(ast)) {
-        procThrow->Value = FoldExpression(std::move(procThrow->Value));
+    return std::make_unique<DMASTConstantFloat>(loc, value);
+}
+
+std::unique_ptr<DMASTExpression> MakeBool(const Location& loc, bool value) {
+    return std::make_unique<DMASTConstantInteger>(loc, value ? 1 : 0);
+}
+
+std::unique_ptr<DMASTExpression> FoldNumbers(const Location& loc, BinaryOperator op, float a, float b, bool fromInteger) {
+    switch (op) {
+        case BinaryOperator::Add:
+            return MakeNumber(loc, a + b, fromInteger);
+        case BinaryOperator::Subtract:
+            return MakeNumber(loc, a - b, fromInteger);
+        case BinaryOperator::Multiply:
+            return MakeNumber(loc, a * b, fromInteger);
+        case BinaryOperator::Divide:
+            if (b == 0.0f) {
+                return nullptr; // Division by zero is a runtime error
+            }
+            return MakeNumber(loc, a / b, fromInteger);
+        case BinaryOperator::Power:
+            return MakeNumber(loc, static_cast<float>(std::pow(static_cast<double>(a), static_cast<double>(b))), fromInteger);
+        case BinaryOperator::Equal:
+        case BinaryOperator::Equivalent:
+            return MakeBool(loc, a == b);
+        case BinaryOperator::NotEqual:
+        case BinaryOperator::NotEquivalent:
+            return MakeBool(loc, a != b);
+        case BinaryOperator::Less:
+            return MakeBool(loc, a < b);
+        case BinaryOperator::Greater:
+            return MakeBool(loc, a > b);
+        case BinaryOperator::LessOrEqual:
+            return MakeBool(loc, a <= b);
+        case BinaryOperator::GreaterOrEqual:
+            return MakeBool(loc, a >= b);
+        default:
+            break;
     }
-    else if (auto* procVarDecl = dynamic_cast<DMASTProcStatementVarDeclaration*>(ast)) {
-        for (auto& decl : procVarDecl->Decls) {
-            decl.Value = FoldExpression(std::move(decl.Value));
+
+    // The rest work on integers; only fold them when no rounding is involved
+    if (!IsInteger(a) || !IsInteger(b)) {
+        return nullptr;
+    }
+    int64_t x = static_cast<int64_t>(a);
+    int64_t y = static_cast<int64_t>(b);
+    switch (op) {
+        case BinaryOperator::Modulo:
+            if (y == 0) {
+                return nullptr;
+            }
+            return std::make_unique<DMASTConstantInteger>(loc, static_cast<int32_t>(x % y));
+        case BinaryOperator::BitwiseAnd:
+            return std::make_unique<DMASTConstantInteger>(loc, static_cast<int32_t>(x & y));
+        case BinaryOperator::BitwiseOr:
+            return std::make_unique<DMASTConstantInteger>(loc, static_cast<int32_t>(x | y));
+        case BinaryOperator::BitwiseXor:
+            return std::make_unique<DMASTConstantInteger>(loc, static_cast<int32_t>(x ^ y));
+        case BinaryOperator::LeftShift:
+        case BinaryOperator::RightShift: {
+            if (y < 0 || y > 31) {
+                return nullptr;
+            }
+            auto value = static_cast<int32_t>(x);
+            int32_t result = op == BinaryOperator::LeftShift
+                ? static_cast<int32_t>(static_cast<uint32_t>(value) << y)
+                : value >> y;
+            return std::make_unique<DMASTConstantInteger>(loc, result);
         }
+        default:
+            return nullptr;
     }
-    else if (auto* procBlockInner = dynamic_cast<DMASTProcBlockInner*>(ast)) {
-        for (auto& statement : procBlockInner->Statements) {
-            FoldAst(statement.get());
+}
+
+} // namespace
+
+void DMASTFolder::FoldAst(DMASTNode* ast) {
+    if (!ast) return;
+
+    // Handle different node types
+    switch (ast->Kind_) {
+        case DMASTNodeKind::File: {
+            auto* file = static_cast<DMASTFile*>(ast);
+            for (auto& statement : file->Statements) {
+                FoldAst(statement.get());
+            }
+            break;
         }
-    }
-    else if (auto* procDef = dynamic_cast<DMASTObjectProcDefinition*>(ast)) {
-        for (auto& param : procDef->Parameters) {
-            param->DefaultValue = FoldExpression(std::move(param->DefaultValue));
-            param->PossibleValues = FoldExpression(std::move(param->PossibleValues));
+        case DMASTNodeKind::ObjectDefinition: {
+            auto* objectDef = static_cast<DMASTObjectDefinition*>(ast);
+            for (auto& statement : objectDef->InnerStatements) {
+                FoldAst(statement.get());
+            }
+            break;
         }
-        if (procDef->Body) {
-            FoldAst(procDef->Body.get());
+        case DMASTNodeKind::ObjectVarDefinition: {
+            auto* objectVarDef = static_cast<DMASTObjectVarDefinition*>(ast);
+            objectVarDef->Value = FoldExpression(std::move(objectVarDef->Value));
+            break;
         }
-    }
-    else if (auto* statementIf = dynamic_cast<DMASTProcStatementIf*>(ast)) {
-        statementIf->Condition = FoldExpression(std::move(statementIf->Condition));
-        if (statementIf->Body) {
-            FoldAst(statementIf->Body.get());
+        case DMASTNodeKind::ObjectVarOverride: {
+            auto* objectVarOverride = static_cast<DMASTObjectVarOverride*>(ast);
+            objectVarOverride->Value = FoldExpression(std::move(objectVarOverride->Value));
+            break;
         }
-        if (statementIf->ElseBody) {
-            FoldAst(statementIf->ElseBody.get());
+        case DMASTNodeKind::ProcStatementExpression: {
+            auto* procExpr = static_cast<DMASTProcStatementExpression*>(ast);
+            procExpr->Expression = FoldExpression(std::move(procExpr->Expression));
+            break;
         }
-    }
-    else if (auto* statementFor = dynamic_cast<DMASTProcStatementFor*>(ast)) {
-        // Initializer is a statement, so fold it recursively
-        if (statementFor->Initializer) {
-            FoldAst(statementFor->Initializer.get());
+        case DMASTNodeKind::ProcStatementReturn: {
+            auto* procRet = static_cast<DMASTProcStatementReturn*>(ast);
+            procRet->Value = FoldExpression(std::move(procRet->Value));
+            break;
         }
-        statementFor->Condition = FoldExpression(std::move(statementFor->Condition));
-        statementFor->Increment = FoldExpression(std::move(statementFor->Increment));
-        if (statementFor->Body) {
-            FoldAst(statementFor->Body.get());
+        case DMASTNodeKind::ProcStatementDel: {
+            auto* procDel = static_cast<DMASTProcStatementDel*>(ast);
+            procDel->Value = FoldExpression(std::move(procDel->Value));
+            break;
         }
-    }
-    else if (auto* statementWhile = dynamic_cast<DMASTProcStatementWhile*>(ast)) {
-        statementWhile->Condition = FoldExpression(std::move(statementWhile->Condition));
-        if (statementWhile->Body) {
-            FoldAst(statementWhile->Body.get());
+        case DMASTNodeKind::ProcStatementThrow: {
+            auto* procThrow = static_cast<DMASTProcStatementThrow*>(ast);
+            procThrow->Value = FoldExpression(std::move(procThrow->Value));
+            break;
         }
-    }
-    else if (auto* statementDoWhile = dynamic_cast<DMASTProcStatementDoWhile*>(ast)) {
-        statementDoWhile->Condition = FoldExpression(std::move(statementDoWhile->Condition));
-        if (statementDoWhile->Body) {
-            FoldAst(statementDoWhile->Body.get());
+        case DMASTNodeKind::ProcStatementVarDeclaration: {
+            auto* procVarDecl = static_cast<DMASTProcStatementVarDeclaration*>(ast);
+            for (auto& decl : procVarDecl->Decls) {
+                decl.Value = FoldExpression(std::move(decl.Value));
+            }
+            break;
         }
-    }
-    else if (auto* statementSwitch = dynamic_cast<DMASTProcStatementSwitch*>(ast)) {
-        statementSwitch->Value = FoldExpression(std::move(statementSwitch->Value));
-        for (auto& switchCase : statementSwitch->Cases) {
-            // Fold values in case
-            for (auto& value : switchCase.Values) {
-                value = FoldExpression(std::move(value));
+        case DMASTNodeKind::ProcBlockInner: {
+            auto* procBlockInner = static_cast<DMASTProcBlockInner*>(ast);
+            for (auto& statement : procBlockInner->SetStatements) {
+                FoldAst(statement.get());
             }
-            if (switchCase.Body) {
-                FoldAst(switchCase.Body.get());
+            for (auto& statement : procBlockInner->Statements) {
+                FoldAst(statement.get());
             }
+            break;
         }
-    }
-    else if (auto* statementSpawn = dynamic_cast<DMASTProcStatementSpawn*>(ast)) {
-        statementSpawn->Delay = FoldExpression(std::move(statementSpawn->Delay));
-        if (statementSpawn->Body) {
-            FoldAst(statementSpawn->Body.get());
+        case DMASTNodeKind::ObjectProcDefinition: {
+            auto* procDef = static_cast<DMASTObjectProcDefinition*>(ast);
+            for (auto& param : procDef->Parameters) {
+                param->DefaultValue = FoldExpression(std::move(param->DefaultValue));
+                param->PossibleValues = FoldExpression(std::move(param->PossibleValues));
+            }
+            if (procDef->Body) {
+                FoldAst(procDef->Body.get());
+            }
+            break;
         }
-    }
-    else if (auto* tryCatch = dynamic_cast<DMASTProcStatementTryCatch*>(ast)) {
-        if (tryCatch->TryBody) {
-            FoldAst(tryCatch->TryBody.get());
+        case DMASTNodeKind::ProcStatementIf: {
+            auto* statementIf = static_cast<DMASTProcStatementIf*>(ast);
+            statementIf->Condition = FoldExpression(std::move(statementIf->Condition));
+            if (statementIf->Body) {
+                FoldAst(statementIf->Body.get());
+            }
+            if (statementIf->ElseBody) {
+                FoldAst(statementIf->ElseBody.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementFor: {
+            auto* statementFor = static_cast<DMASTProcStatementFor*>(ast);
+            // Initializer is a statement, so fold it recursively
+            if (statementFor->Initializer) {
+                FoldAst(statementFor->Initializer.get());
+            }
+            statementFor->Condition = FoldExpression(std::move(statementFor->Condition));
+            statementFor->Increment = FoldExpression(std::move(statementFor->Increment));
+            if (statementFor->Body) {
+                FoldAst(statementFor->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementForIn: {
+            auto* statementForIn = static_cast<DMASTProcStatementForIn*>(ast);
+            statementForIn->List = FoldExpression(std::move(statementForIn->List));
+            if (statementForIn->Body) {
+                FoldAst(statementForIn->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementForRange: {
+            auto* statementForRange = static_cast<DMASTProcStatementForRange*>(ast);
+            statementForRange->Initializer = FoldExpression(std::move(statementForRange->Initializer));
+            statementForRange->End = FoldExpression(std::move(statementForRange->End));
+            statementForRange->Step = FoldExpression(std::move(statementForRange->Step));
+            if (statementForRange->Body) {
+                FoldAst(statementForRange->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementWhile: {
+            auto* statementWhile = static_cast<DMASTProcStatementWhile*>(ast);
+            statementWhile->Condition = FoldExpression(std::move(statementWhile->Condition));
+            if (statementWhile->Body) {
+                FoldAst(statementWhile->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementDoWhile: {
+            auto* statementDoWhile = static_cast<DMASTProcStatementDoWhile*>(ast);
+            statementDoWhile->Condition = FoldExpression(std::move(statementDoWhile->Condition));
+            if (statementDoWhile->Body) {
+                FoldAst(statementDoWhile->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementSwitch: {
+            auto* statementSwitch = static_cast<DMASTProcStatementSwitch*>(ast);
+            statementSwitch->Value = FoldExpression(std::move(statementSwitch->Value));
+            for (auto& switchCase : statementSwitch->Cases) {
+                // Fold values in case
+                for (auto& value : switchCase.Values) {
+                    value = FoldExpression(std::move(value));
+                }
+                if (switchCase.Body) {
+                    FoldAst(switchCase.Body.get());
+                }
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementSpawn: {
+            auto* statementSpawn = static_cast<DMASTProcStatementSpawn*>(ast);
+            statementSpawn->Delay = FoldExpression(std::move(statementSpawn->Delay));
+            if (statementSpawn->Body) {
+                FoldAst(statementSpawn->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementLabel: {
+            auto* label = static_cast<DMASTProcStatementLabel*>(ast);
+            if (label->Body) {
+                FoldAst(label->Body.get());
+            }
+            break;
+        }
+        case DMASTNodeKind::ProcStatementSet: {
+            auto* statementSet = static_cast<DMASTProcStatementSet*>(ast);
+            statementSet->Value = FoldExpression(std::move(statementSet->Value));
+            break;
         }
-        if (tryCatch->CatchBody) {
-            FoldAst(tryCatch->CatchBody.get());
+        case DMASTNodeKind::ProcStatementTryCatch: {
+            auto* tryCatch = static_cast<DMASTProcStatementTryCatch*>(ast);
+            if (tryCatch->TryBody) {
+                FoldAst(tryCatch->TryBody.get());
+            }
+            if (tryCatch->CatchBody) {
+                FoldAst(tryCatch->CatchBody.get());
+            }
+            break;
         }
+        default:
+            break;
     }
 }
 
@@ -121,111 +323,297 @@ std::unique_ptr<DMASTExpression> DMASTFolder::FoldExpression(std::unique_ptr<DMA
     if (!expression) return expression;
 
     // Recursively fold sub-expressions first
-    if (auto* unary = dynamic_cast<DMASTExpressionUnary*>(expression.get())) {
-        unary->Expression = FoldExpression(std::move(unary->Expression));
-        
-        // Perform constant folding for unary operations
-        if (unary->Operator == UnaryOperator::Negate) {
-            if (auto* constInt = dynamic_cast<DMASTConstantInteger*>(unary->Expression.get())) {
-                return std::make_unique<DMASTConstantInteger>(expression->Location_, -constInt->Value);
+    switch (expression->Kind_) {
+        case DMASTNodeKind::ExpressionUnary: {
+            auto* unary = static_cast<DMASTExpressionUnary*>(expression.get());
+            unary->Expression = FoldExpression(std::move(unary->Expression));
+            if (auto folded = FoldUnary(unary)) {
+                return folded;
+            }
+            break;
+        }
+        case DMASTNodeKind::ExpressionBinary: {
+            // Operators are left-associative, so a chain of them nests one
+            // level per term down the left; walk it with a stack of its own
+            std::vector<std::unique_ptr<DMASTExpression>> chain;
+            chain.push_back(std::move(expression));
+            while (true) {
+                auto* binary = static_cast<DMASTExpressionBinary*>(chain.back().get());
+                if (!binary->Left || binary->Left->Kind_ != DMASTNodeKind::ExpressionBinary) {
+                    break;
+                }
+                chain.push_back(std::move(binary->Left));
             }
-            else if (auto* constFloat = dynamic_cast<DMASTConstantFloat*>(unary->Expression.get())) {
-                return std::make_unique<DMASTConstantFloat>(expression->Location_, -constFloat->Value);
+            
+            auto folded = FoldExpression(std::move(static_cast<DMASTExpressionBinary*>(chain.back().get())->Left));
+            while (!chain.empty()) {
+                auto operation = std::move(chain.back());
+                chain.pop_back();
+                auto* binary = static_cast<DMASTExpressionBinary*>(operation.get());
+                binary->Left = std::move(folded);
+                binary->Right = FoldExpression(std::move(binary->Right));
+                folded = FoldOperands(std::move(operation));
             }
+            return folded;
         }
-        else if (unary->Operator == UnaryOperator::Not) {
-            if (auto* constInt = dynamic_cast<DMASTConstantInteger*>(unary->Expression.get())) {
-                return std::make_unique<DMASTConstantInteger>(expression->Location_, constInt->Value != 0 ? 0 : 1);
+        case DMASTNodeKind::List: {
+            auto* list = static_cast<DMASTList*>(expression.get());
+            for (auto& param : list->Values) {
+                param->Value = FoldExpression(std::move(param->Value));
             }
-            else if (auto* constFloat = dynamic_cast<DMASTConstantFloat*>(unary->Expression.get())) {
-                return std::make_unique<DMASTConstantInteger>(expression->Location_, constFloat->Value != 0.0f ? 0 : 1);
+            break;
+        }
+        case DMASTNodeKind::NewList: {
+            auto* newlist = static_cast<DMASTNewList*>(expression.get());
+            for (auto& param : newlist->Parameters) {
+                param->Value = FoldExpression(std::move(param->Value));
             }
+            break;
         }
-    }
-    else if (auto* binary = dynamic_cast<DMASTExpressionBinary*>(expression.get())) {
-        binary->Left = FoldExpression(std::move(binary->Left));
-        binary->Right = FoldExpression(std::move(binary->Right));
-        
-        // Perform constant folding for logical operations
-        if (binary->Operator == BinaryOperator::LogicalOr) {
-            auto simpleTruth = SimpleTruth(binary->Left.get());
-            if (simpleTruth.has_value()) {
-                if (*simpleTruth) {
-                    return std::move(binary->Left); // Left side is truthy, return it
-                } else {
-                    return std::move(binary->Right); // Left side is falsy, return right
-                }
+        case DMASTNodeKind::NewPath: {
+            auto* newPath = static_cast<DMASTNewPath*>(expression.get());
+            for (auto& param : newPath->Parameters) {
+                param->Value = FoldExpression(std::move(param->Value));
+            }
+            break;
+        }
+        case DMASTNodeKind::Call: {
+            auto* call = static_cast<DMASTCall*>(expression.get());
+            for (auto& param : call->Parameters) {
+                param->Value = FoldExpression(std::move(param->Value));
             }
+            break;
         }
-        else if (binary->Operator == BinaryOperator::LogicalAnd) {
-            auto simpleTruth = SimpleTruth(binary->Left.get());
+        case DMASTNodeKind::Ternary: {
+            auto* ternary = static_cast<DMASTTernary*>(expression.get());
+            ternary->Condition = FoldExpression(std::move(ternary->Condition));
+            ternary->TrueExpression = FoldExpression(std::move(ternary->TrueExpression));
+            ternary->FalseExpression = FoldExpression(std::move(ternary->FalseExpression));
+            
+            auto simpleTruth = SimpleTruth(ternary->Condition.get());
             if (simpleTruth.has_value()) {
-                if (!*simpleTruth) {
-                    return std::move(binary->Left); // Left side is falsy, return it
-                } else {
-                    return std::move(binary->Right); // Left side is truthy, return right
+                return std::move(*simpleTruth ? ternary->TrueExpression : ternary->FalseExpression);
+            }
+            break;
+        }
+        case DMASTNodeKind::Assign: {
+            auto* assign = static_cast<DMASTAssign*>(expression.get());
+            assign->Value = FoldExpression(std::move(assign->Value));
+            break;
+        }
+        case DMASTNodeKind::Dereference: {
+            auto* dereference = static_cast<DMASTDereference*>(expression.get());
+            dereference->Expression = FoldExpression(std::move(dereference->Expression));
+            if (dereference->Type == DereferenceType::Index) {
+                dereference->Property = FoldExpression(std::move(dereference->Property));
+            }
+            break;
+        }
+        case DMASTNodeKind::StringFormat: {
+            auto* stringFormat = static_cast<DMASTStringFormat*>(expression.get());
+            for (auto& embedded : stringFormat->Expressions) {
+                embedded = FoldExpression(std::move(embedded));
+            }
+            
+            // Constants print the same every time, so they join the text around them
+            if (stringFormat->StringParts.size() == stringFormat->Expressions.size() + 1) {
+                std::vector<std::string> parts;
+                std::vector<std::unique_ptr<DMASTExpression>> embeddedLeft;
+                parts.push_back(std::move(stringFormat->StringParts[0]));
+                for (size_t i = 0; i < stringFormat->Expressions.size(); ++i) {
+                    std::string& after = stringFormat->StringParts[i + 1];
+                    auto text = EmbeddedText(stringFormat->Expressions[i].get());
+                    if (text && CanEmbedText(parts.back(), *text, after)) {
+                        parts.back() += *text;
+                        parts.back() += after;
+                    } else {
+                        embeddedLeft.push_back(std::move(stringFormat->Expressions[i]));
+                        parts.push_back(std::move(after));
+                    }
+                }
+                stringFormat->StringParts = std::move(parts);
+                stringFormat->Expressions = std::move(embeddedLeft);
+            }
+            
+            // Nothing left to format, so it is just text
+            if (stringFormat->Expressions.empty()) {
+                std::string text;
+                for (const auto& part : stringFormat->StringParts) {
+                    text += part;
                 }
+                return std::make_unique<DMASTConstantString>(expression->Location_, text);
             }
+            break;
+        }
+        case DMASTNodeKind::SwitchCaseRange: {
+            auto* switchCaseRange = static_cast<DMASTSwitchCaseRange*>(expression.get());
+            switchCaseRange->RangeStart = FoldExpression(std::move(switchCaseRange->RangeStart));
+            switchCaseRange->RangeEnd = FoldExpression(std::move(switchCaseRange->RangeEnd));
+            break;
         }
+        default:
+            break;
     }
 
-    // Handle specific expression types for recursive folding
-    if (auto* list = dynamic_cast<DMASTList*>(expression.get())) {
-        for (auto& param : list->Values) {
-            param->Value = FoldExpression(std::move(param->Value));
+    return expression;
+}
+
+std::unique_ptr<DMASTExpression> DMASTFolder::FoldOperands(std::unique_ptr<DMASTExpression> expression) {
+    auto* binary = static_cast<DMASTExpressionBinary*>(expression.get());
+    
+    // Logical operations only need a constant left side
+    if (binary->Operator == BinaryOperator::LogicalOr) {
+        auto simpleTruth = SimpleTruth(binary->Left.get());
+        if (simpleTruth.has_value()) {
+            if (*simpleTruth) {
+                return std::move(binary->Left); // Left side is truthy, return it
+            } else {
+                return std::move(binary->Right); // Left side is falsy, return right
+            }
         }
     }
-    else if (auto* newlist = dynamic_cast<DMASTNewList*>(expression.get())) {
-        for (auto& param : newlist->Parameters) {
-            param->Value = FoldExpression(std::move(param->Value));
+    else if (binary->Operator == BinaryOperator::LogicalAnd) {
+        auto simpleTruth = SimpleTruth(binary->Left.get());
+        if (simpleTruth.has_value()) {
+            if (!*simpleTruth) {
+                return std::move(binary->Left); // Left side is falsy, return it
+            } else {
+                return std::move(binary->Right); // Left side is truthy, return right
+            }
         }
     }
-    else if (auto* newPath = dynamic_cast<DMASTNewPath*>(expression.get())) {
-        for (auto& param : newPath->Parameters) {
-            param->Value = FoldExpression(std::move(param->Value));
-        }
+    else if (auto folded = FoldBinary(binary)) {
+        return folded;
     }
-    else if (auto* call = dynamic_cast<DMASTCall*>(expression.get())) {
-        for (auto& param : call->Parameters) {
-            param->Value = FoldExpression(std::move(param->Value));
-        }
+    return expression;
+}
+
+std::optional<std::string> DMASTFolder::EmbeddedText(DMASTExpression* expr) {
+    auto value = GetConstant(expr);
+    if (!value) {
+        return std::nullopt;
+    }
+    std::string text;
+    switch (value->ValueType) {
+        case ConstantValue::Type::Null:
+            return text;
+        case ConstantValue::Type::String:
+            text = *value->String;
+            break;
+        case ConstantValue::Type::Number:
+            // Whole numbers print as digits up to six of them; past that the
+            // runtime switches to exponent form
+            if (!IsInteger(value->Number) || std::fabs(value->Number) >= 1000000.0f) {
+                return std::nullopt;
+            }
+            text = std::to_string(static_cast<int32_t>(value->Number));
+            break;
     }
-    else if (auto* ternary = dynamic_cast<DMASTTernary*>(expression.get())) {
-        ternary->Condition = FoldExpression(std::move(ternary->Condition));
-        ternary->TrueExpression = FoldExpression(std::move(ternary->TrueExpression));
-        ternary->FalseExpression = FoldExpression(std::move(ternary->FalseExpression));
+    if (text.find_first_of("[]") != std::string::npos) {
+        return std::nullopt;
     }
-    else if (auto* switchCaseRange = dynamic_cast<DMASTSwitchCaseRange*>(expression.get())) {
-        switchCaseRange->RangeStart = FoldExpression(std::move(switchCaseRange->RangeStart));
-        switchCaseRange->RangeEnd = FoldExpression(std::move(switchCaseRange->RangeEnd));
+    return text;
+}
+
+bool DMASTFolder::CanEmbedText(const std::string& before, const std::string& text, const std::string& after) {
+    // Text without brackets only joins a marker when there is none of it
+    return !text.empty() || before.empty() || after.empty() || before.back() != '[' || after.front() != ']';
+}
+
+std::unique_ptr<DMASTExpression> DMASTFolder::FoldBinary(DMASTExpressionBinary* binary) {
+    auto left = GetConstant(binary->Left.get());
+    auto right = GetConstant(binary->Right.get());
+    if (!left || !right || left->ValueType != right->ValueType) {
+        return nullptr;
     }
 
-    return expression;
+    const Location& loc = binary->Location_;
+    switch (left->ValueType) {
+        case ConstantValue::Type::Number:
+            return FoldNumbers(loc, binary->Operator, left->Number, right->Number,
+                               left->FromInteger && right->FromInteger);
+        case ConstantValue::Type::String:
+            // ~= and < on text depend on the runtime's string rules
+            switch (binary->Operator) {
+                case BinaryOperator::Add:
+                    return std::make_unique<DMASTConstantString>(loc, *left->String + *right->String);
+                case BinaryOperator::Equal:
+                    return MakeBool(loc, *left->String == *right->String);
+                case BinaryOperator::NotEqual:
+                    return MakeBool(loc, *left->String != *right->String);
+                default:
+                    return nullptr;
+            }
+        case ConstantValue::Type::Null:
+            switch (binary->Operator) {
+                case BinaryOperator::Equal:
+                case BinaryOperator::Equivalent:
+                    return MakeBool(loc, true);
+                case BinaryOperator::NotEqual:
+                case BinaryOperator::NotEquivalent:
+                    return MakeBool(loc, false);
+                default:
+                    return nullptr;
+            }
+    }
+    return nullptr;
+}
+
+std::unique_ptr<DMASTExpression> DMASTFolder::FoldUnary(DMASTExpressionUnary* unary) {
+    DMASTExpression* operand = unary->Expression.get();
+    const Location& loc = unary->Location_;
+
+    switch (unary->Operator) {
+        case UnaryOperator::Negate:
+            if (auto* constInt = DMASTCast<DMASTConstantInteger>(operand)) {
+                if (constInt->Value != INT32_MIN) {
+                    return std::make_unique<DMASTConstantInteger>(loc, -constInt->Value);
+                }
+                return std::make_unique<DMASTConstantFloat>(loc, -static_cast<float>(constInt->Value));
+            }
+            if (auto* constFloat = DMASTCast<DMASTConstantFloat>(operand)) {
+                return std::make_unique<DMASTConstantFloat>(loc, -constFloat->Value);
+            }
+            return nullptr;
+        case UnaryOperator::Not: {
+            auto simpleTruth = SimpleTruth(operand);
+            if (simpleTruth.has_value()) {
+                return MakeBool(loc, !*simpleTruth);
+            }
+            return nullptr;
+        }
+        case UnaryOperator::BitNot: {
+            // Bitwise not works on the 24 bits a float holds exactly
+            auto value = GetConstant(operand);
+            if (value && value->ValueType == ConstantValue::Type::Number && IsInteger(value->Number)) {
+                auto bits = static_cast<int32_t>(value->Number);
+                return std::make_unique<DMASTConstantInteger>(loc, ~bits & 0xFFFFFF);
+            }
+            return nullptr;
+        }
+        default:
+            return nullptr; // Increments and decrements need a variable
+    }
 }
 
 std::optional<bool> DMASTFolder::SimpleTruth(DMASTExpression* expr) {
     if (!expr) return std::nullopt;
 
-    if (auto* constInt = dynamic_cast<DMASTConstantInteger*>(expr)) {
-        return constInt->Value != 0;
-    }
-    else if (auto* constFloat = dynamic_cast<DMASTConstantFloat*>(expr)) {
-        return constFloat->Value != 0.0f;
-    }
-    else if (auto* constString = dynamic_cast<DMASTConstantString*>(expr)) {
-        return !constString->Value.empty();
-    }
-    else if (dynamic_cast<DMASTConstantNull*>(expr)) {
-        return false;
+    switch (expr->Kind_) {
+        case DMASTNodeKind::ConstantInteger:
+            return static_cast<DMASTConstantInteger*>(expr)->Value != 0;
+        case DMASTNodeKind::ConstantFloat:
+            return static_cast<DMASTConstantFloat*>(expr)->Value != 0.0f;
+        case DMASTNodeKind::ConstantString:
+            return !static_cast<DMASTConstantString*>(expr)->Value.empty();
+        case DMASTNodeKind::ConstantNull:
+            return false;
+        case DMASTNodeKind::ConstantPath:
+        case DMASTNodeKind::ConstantResource:
+            return true;
+        default:
+            return std::nullopt; // Cannot determine at compile time
     }
-    else if (dynamic_cast<DMASTConstantPath*>(expr)) {
-        return true;
-    }
-    else if (dynamic_cast<DMASTConstantResource*>(expr)) {
-        return true;
-    }
-
-    return std::nullopt; // Cannot determine at compile time
 }
 
 } // namespace DMCompiler
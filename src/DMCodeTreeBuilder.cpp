@@ -7,6 +7,10 @@
 #include "DMProc.h"
 #include "DMVariable.h"
 #include "DMASTExpression.h"
+#include "ParallelProcCompiler.h"
+#include "ProcCache.h"
+#include "DependencyGraph.h"
+#include "CompileTimings.h"
 #include <iostream>
 
 namespace DMCompiler {
@@ -46,13 +50,35 @@ void DMCodeTreeBuilder::BuildCodeTree(DMASTFile* astFile) {
         dmObject->CreateInitializationProc(Compiler_, ObjectTree_);
     }
 
+    // Proc bodies the parser skipped are needed from here on
+    if (Compiler_->GetSettings().LazyProcBodies) {
+        Compiler_->ParseDeferredProcBodies();
+    }
+    
     // Compile every proc
     if (Compiler_->GetSettings().Verbose) {
         std::cout << "  Compiling procs..." << std::endl;
     }
     
-    for (auto* proc : ObjectTree_->GetAllProcs()) {
-        proc->Compile(Compiler_);
+    // No types or procs are added from here on
+    ObjectTree_->FreezeTypeTree();
+    Compiler_->ApplyProcProfile();
+    Compiler_->OpenProcCache();
+    
+    ParallelProcCompiler procCompiler(Compiler_);
+    auto timing = CompileTimings::Time(Compiler_->GetTimings(), "DMProc::Compile");
+    procCompiler.Compile(ObjectTree_->GetAllProcs(), Compiler_->GetSettings().CompileThreads);
+    timing.End();
+    if (Compiler_->GetSettings().Verbose && Compiler_->GetSettings().CompileThreads > 1) {
+        std::cout << "  Compiled procs on " << Compiler_->GetSettings().CompileThreads << " threads ("
+                  << procCompiler.RecompiledCount() << " compiled again, "
+                  << procCompiler.AbandonedCount() << " sequentially)" << std::endl;
+    }
+    if (Compiler_->GetSettings().Verbose && Compiler_->GetProcCache()) {
+        const ProcCache& cache = *Compiler_->GetProcCache();
+        std::cout << "  Proc cache: reused " << cache.GetReusedCount() << " of " << ObjectTree_->AllProcs.size()
+                  << " procs (" << cache.GetRenumberedCount() << " with strings renumbered), stored "
+                  << cache.GetStoredCount() << std::endl;
     }
 }
 
@@ -76,7 +102,7 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
     }
 
     // Object definition: /mob/player { ... }
-    if (auto* objectDef = dynamic_cast<DMASTObjectDefinition*>(statement)) {
+    if (auto* objectDef = DMASTCast<DMASTObjectDefinition>(statement)) {
         DreamPath typePath = objectDef->Path.Path;
         
         // Convert relative paths to absolute paths
@@ -127,6 +153,9 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
                          << " with " << objectDef->InnerStatements.size() << " inner statements" << std::endl;
             }
             ObjectTree_->AddType(typePath);
+            if (DependencyGraph* dependencies = Compiler_->GetDependencyGraph()) {
+                dependencies->AddType(objectDef->Location_, typePath);
+            }
             
             for (const auto& innerStmt : objectDef->InnerStatements) {
                 ProcessStatementWithVarContext(innerStmt.get(), innerType, std::nullopt);
@@ -135,7 +164,7 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
         return;
     }
     // Variable definition: var/name = value
-    else if (auto* varDef = dynamic_cast<DMASTObjectVarDefinition*>(statement)) {
+    else if (auto* varDef = DMASTCast<DMASTObjectVarDefinition>(statement)) {
         // If we're in a var block context, apply the accumulated type
         std::optional<DreamPath> effectiveType;
         
@@ -165,9 +194,12 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
         // The variable's type constraint (if any) is in varDef->TypePath (or from var block context)
         ObjectTree_->AddType(currentType);
         ObjectTree_->AddObjectVar(currentType, varDef, effectiveType);
+        if (DependencyGraph* dependencies = Compiler_->GetDependencyGraph()) {
+            dependencies->AddType(varDef->Location_, currentType);
+        }
     }
     // Variable override: existing_var = new_value
-    else if (auto* varOverride = dynamic_cast<DMASTObjectVarOverride*>(statement)) {
+    else if (auto* varOverride = DMASTCast<DMASTObjectVarOverride>(statement)) {
         // Check for DMStandard modification
         if (DMStandardFinalized_) {
             DMObject* obj = ObjectTree_->GetType(currentType);
@@ -197,9 +229,12 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
         // Variable overrides apply to the current type
         ObjectTree_->AddType(currentType);
         ObjectTree_->AddObjectVarOverride(currentType, varOverride);
+        if (DependencyGraph* dependencies = Compiler_->GetDependencyGraph()) {
+            dependencies->AddType(varOverride->Location_, currentType);
+        }
     }
     // Proc definition: proc/test() { ... }
-    else if (auto* procDef = dynamic_cast<DMASTObjectProcDefinition*>(statement)) {
+    else if (auto* procDef = DMASTCast<DMASTObjectProcDefinition>(statement)) {
         DreamPath procOwner = currentType.Combine(procDef->ObjectPath);
         
         // Check for DMStandard modification
@@ -216,6 +251,9 @@ void DMCodeTreeBuilder::ProcessStatementWithVarContext(DMASTStatement* statement
         
         // Add the proc to the object tree
         DMProc* proc = ObjectTree_->AddProc(procOwner, procDef);
+        if (DependencyGraph* dependencies = Compiler_->GetDependencyGraph()) {
+            dependencies->AddProc(procDef->Location_, procOwner, procDef->Name, procDef->IsVerb);
+        }
 
         if (proc) {
             // Register parameters as local variables immediately
@@ -6,22 +6,53 @@
 #include "DMPreprocessor.h"
 #include "DMParser.h"
 #include "DMMParser.h"
+#include "DMMScanner.h"
 #include "DMLexer.h"
+#include "SourceBuffer.h"
 #include "DMASTFolder.h"
 #include "TokenStreamDMLexer.h"
+#include "TokenIndentation.h"
+#include "TokenPipeline.h"
+#include "TokenCache.h"
+#include "ASTCache.h"
+#include "MapCache.h"
+#include "ResourceManifest.h"
+#include "DMStandardSnapshot.h"
+#include "PreprocessorStats.h"
+#include "MapStats.h"
+#include "CompileTimings.h"
+#include "CompileCosts.h"
+#include "PreprocessedOutput.h"
+#include "ParallelParser.h"
+#include "ParallelProcCompiler.h"
+#include "ProcCache.h"
+#include "ProcProfile.h"
+#include "DependencyGraph.h"
 #include "DMASTStatement.h"
 #include "DMObject.h"
 #include "DMVariable.h"
 #include "BytecodeWriter.h"
+#include "BytecodeVerifier.h"
+#include "CallGraph.h"
 #include "DMExpressionCompiler.h"
 #include "DMStatementCompiler.h"
 #include "JsonWriter.h"
 #include "DMConstants.h"
+#include "SortedEntries.h"
+#include "DMVariableStore.h"
+#include "CompiledOutput.h"
+#include "OutputCompression.h"
+#include "TokenSerialization.h"
+#include <iomanip>
 #include <iostream>
+#include <thread>
 #include <fstream>
 #include <sstream>
 #include <filesystem>
 #include <chrono>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
 
 // Platform-specific includes for executable path
 #ifdef _WIN32
@@ -54,6 +85,7 @@ DMCompiler::DMCompiler()
     , WarningCount_(0)
     , ObjectTree_(std::make_unique<DMObjectTree>(this))
     , CodeTree_(std::make_unique<DMCodeTree>())
+    , JsonConstants_(std::make_unique<JsonConstants>())
 {
     // Initialize default error configuration
     ErrorConfig_[WarningCode::UnimplementedAccess] = ErrorLevel::Warning;
@@ -66,7 +98,12 @@ DMCompiler::DMCompiler()
     // Add more default configurations as needed
 }
 
-DMCompiler::~DMCompiler() = default;
+DMCompiler::~DMCompiler() {
+    // A compile that failed before parsing leaves the DMStandard parse running
+    if (StandardParser_.joinable()) {
+        StandardParser_.join();
+    }
+}
 
 bool DMCompiler::Compile(const DMCompilerSettings& settings) {
     Settings_ = settings;
@@ -81,79 +118,170 @@ bool DMCompiler::Compile(const DMCompilerSettings& settings) {
         ForcedWarning("Compiler optimizations disabled via --no-opts");
     }
     
+    if (!Settings_.EmitPreprocessedPath.empty() && Settings_.StreamTokens) {
+        ForcedWarning("--emit-preprocessed needs the whole token stream; ignoring --stream-tokens");
+        Settings_.StreamTokens = false;
+    }
+    
+    if (Settings_.LazyProcBodies && Settings_.StreamTokens) {
+        ForcedWarning("--lazy-proc-bodies needs the buffered token stream; ignoring it with --stream-tokens");
+        Settings_.LazyProcBodies = false;
+    }
+    
+    if (!Settings_.ASTCacheDir.empty() && Settings_.StreamTokens) {
+        ForcedWarning("--ast-cache needs the buffered token stream; ignoring it with --stream-tokens");
+        Settings_.ASTCacheDir.clear();
+    }
+    
+    if (Settings_.CheckOnly && !Settings_.ProcCacheDir.empty()) {
+        ForcedWarning("--check-only does not optimize procs, so they cannot be cached; ignoring --proc-cache");
+        Settings_.ProcCacheDir.clear();
+    }
+    
+    // A check reports the same diagnostics on any number of threads
+    if (Settings_.CheckOnly && Settings_.CompileThreads == 0) {
+        Settings_.CompileThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    
     if (Settings_.SuppressUnimplementedWarnings) {
         Emit(WarningCode::UnimplementedAccess, Location::Internal,
              "Unimplemented proc & var warnings are suppressed");
     }
     
+    Timings_.reset();
+    if (!Settings_.Timings.empty() || Settings_.MemoryReport) {
+        Timings_ = std::make_unique<CompileTimings>();
+    }
+    Costs_.reset();
+    if (Settings_.CompileCostsTop > 0) {
+        Costs_ = std::make_shared<CompileCosts>();
+    }
+    Dependencies_.reset();
+    if (Settings_.DependencyGraph) {
+        Dependencies_ = std::make_shared<DependencyGraph>();
+    }
+    
     // Compilation phases
     bool success = true;
     
     auto phaseStart = std::chrono::steady_clock::now();
-    if (success && !ShouldAbort() && !PreprocessFiles()) {
+    bool loadPreprocessed = !Settings_.LoadPreprocessedPath.empty();
+    auto timing = CompileTimings::Time(Timings_.get(), loadPreprocessed ? "LoadPreprocessedOutput" : "PreprocessFiles");
+    if (success && !ShouldAbort() && !(loadPreprocessed ? LoadPreprocessedOutput() : PreprocessFiles())) {
         success = false;
     }
+    timing.End();
     if (Settings_.Verbose) {
         auto phaseEnd = std::chrono::steady_clock::now();
         std::cout << "Preprocessing took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
     }
     
     phaseStart = std::chrono::steady_clock::now();
+    timing = CompileTimings::Time(Timings_.get(), "InitializeDMStandard");
     if (success && !ShouldAbort() && !InitializeDMStandard()) {
         success = false;
     }
+    timing.End();
     if (Settings_.Verbose) {
         auto phaseEnd = std::chrono::steady_clock::now();
         std::cout << "DMStandard init took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
     }
     
+    if (success && !ShouldAbort() && !Settings_.EmitPreprocessedPath.empty() && !SavePreprocessedOutput()) {
+        success = false;
+    }
+    
     phaseStart = std::chrono::steady_clock::now();
+    timing = CompileTimings::Time(Timings_.get(), "ParseFiles");
     if (success && !ShouldAbort() && !ParseFiles()) {
         success = false;
     }
+    Pipeline_.reset();  // Stops the streaming preprocessor if parsing was skipped
+    if (!Settings_.LazyProcBodies) {
+        ReleaseTokens();
+    }
+    timing.End();
     if (Settings_.Verbose) {
         auto phaseEnd = std::chrono::steady_clock::now();
         std::cout << "Parsing took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
     }
     
     phaseStart = std::chrono::steady_clock::now();
+    timing = CompileTimings::Time(Timings_.get(), "BuildObjectTree");
     if (success && !ShouldAbort() && !BuildObjectTree()) {
         success = false;
     }
+    timing.End();
     if (Settings_.Verbose) {
         auto phaseEnd = std::chrono::steady_clock::now();
         std::cout << "Object tree build took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
     }
     
-    if (success && !ShouldAbort() && !IncludedMaps_.empty()) {
-        phaseStart = std::chrono::steady_clock::now();
-        std::cout << "Phase 5: Converting maps..." << std::endl;
-        int zOffset = 1; // Start Z offset at 1
-        ParsedMaps_ = ConvertMaps(IncludedMaps_, zOffset);
-        
-        if (Settings_.Verbose) {
-            std::cout << "  Converted " << ParsedMaps_.size() << " maps" << std::endl;
-            auto phaseEnd = std::chrono::steady_clock::now();
-            std::cout << "Map conversion took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
-        }
-    }
-    
     phaseStart = std::chrono::steady_clock::now();
+    timing = CompileTimings::Time(Timings_.get(), "EmitBytecode");
     if (success && !ShouldAbort() && !EmitBytecode()) {
         success = false;
     }
+    ReleaseProcBodies();
+    ReleaseTokens();
+    timing.End();
+    
+    // Procs that failed to compile are left with whatever code they got
+    // to, which is already reported
+    if (Settings_.Verify && !Settings_.CheckOnly && ErrorCount_ == 0) {
+        timing = CompileTimings::Time(Timings_.get(), "VerifyBytecode");
+        if (success && !ShouldAbort() && !VerifyBytecode()) {
+            success = false;
+        }
+        timing.End();
+    }
+    
+    // Before the output, which may strip procs the table points at
+    if (Costs_) {
+        Costs_->Report(std::cout, Settings_.CompileCostsTop);
+    }
     if (Settings_.Verbose) {
         auto phaseEnd = std::chrono::steady_clock::now();
         std::cout << "Bytecode emission took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
     }
     
     phaseStart = std::chrono::steady_clock::now();
-    if (success && !ShouldAbort() && !OutputJson(settings.Files[0])) {
+    if (Settings_.CheckOnly) {
+        // Maps are still converted, for what they report about the types they place
+        timing = CompileTimings::Time(Timings_.get(), "ConvertMaps");
+        if (success && !ShouldAbort()) {
+            std::cout << "Phase 5: Checking maps (--check-only, no output written)..." << std::endl;
+            int zOffset = 1;
+            ConvertMaps(IncludedMaps_, zOffset, [](const std::string&, const DreamMapJson&) {});
+        }
+        timing.End();
+    } else {
+        timing = CompileTimings::Time(Timings_.get(), "OutputJson");
+        if (success && !ShouldAbort() && !OutputJson(GetOutputPath())) {
+            success = false;
+        }
+        timing.End();
+        if (Settings_.Verbose) {
+            auto phaseEnd = std::chrono::steady_clock::now();
+            std::cout << "JSON output took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
+        }
+    }
+    
+    // Written for a failed compile too, to see how far it got
+    if (Timings_ && Settings_.MemoryReport && !CheckMemoryBudget()) {
         success = false;
     }
-    if (Settings_.Verbose) {
-        auto phaseEnd = std::chrono::steady_clock::now();
-        std::cout << "JSON output took " << std::chrono::duration_cast<std::chrono::milliseconds>(phaseEnd - phaseStart).count() << "ms" << std::endl;
+    if (Timings_ && !Settings_.Timings.empty()) {
+        namespace fs = std::filesystem;
+        bool trace = Settings_.Timings == "trace";
+        std::string timingsPath = fs::path(GetOutputPath()).replace_extension(trace ? ".trace.json" : ".timings.json").string();
+        Timings_->Report(std::cout);
+        if (!(trace ? Timings_->WriteTrace(timingsPath) : Timings_->WriteJson(timingsPath))) {
+            ForcedError(Location::Internal, "Failed to write timings: " + timingsPath);
+            success = false;
+        } else {
+            std::cout << "Timings written to: " << timingsPath << std::endl;
+        }
     }
     
     auto endTime = std::chrono::steady_clock::now();
@@ -171,14 +299,103 @@ bool DMCompiler::Compile(const DMCompilerSettings& settings) {
     return success && (ErrorCount_ == 0);
 }
 
+namespace {
+thread_local DiagnosticBuffer* CurrentDiagnostics = nullptr;
+} // namespace
+
+DiagnosticBuffer::Capture::Capture(DiagnosticBuffer& buffer)
+    : Outer_(CurrentDiagnostics) {
+    CurrentDiagnostics = &buffer;
+}
+
+DiagnosticBuffer::Capture::~Capture() {
+    CurrentDiagnostics = Outer_;
+}
+
+DiagnosticBuffer* DiagnosticBuffer::Current() {
+    return CurrentDiagnostics;
+}
+
 void DMCompiler::Emit(WarningCode code, const Location& location, const std::string& message, const std::string& context) {
+    // A proc compiled on a worker thread reports this when compiled again in order
+    ProcCache::RecordSideEffect();
+    if (DiagnosticBuffer* buffer = DiagnosticBuffer::Current()) {
+        buffer->Add({DiagnosticBuffer::Entry::Kind::Emitted, code, location, message, context});
+        return;
+    }
+    if (ParallelProcCompiler::Abandon()) return;
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+    std::string output;
+    RecordLocked({DiagnosticBuffer::Entry::Kind::Emitted, code, location, message, context}, output);
+    std::cerr << output << std::flush;
+}
+
+void DMCompiler::SetMaxErrors(int maxErrors) {
+    MaxErrors_ = maxErrors;
+}
+
+bool DMCompiler::ShouldAbort() const {
+    return Aborted_;
+}
+
+void DMCompiler::ForcedWarning(const std::string& message) {
+    ProcCache::RecordSideEffect();
+    if (DiagnosticBuffer* buffer = DiagnosticBuffer::Current()) {
+        buffer->Add({DiagnosticBuffer::Entry::Kind::ForcedWarning, WarningCode::Unknown, Location(), message, ""});
+        return;
+    }
+    if (ParallelProcCompiler::Abandon()) return;
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+    std::string output;
+    RecordLocked({DiagnosticBuffer::Entry::Kind::ForcedWarning, WarningCode::Unknown, Location(), message, ""}, output);
+    std::cerr << output << std::flush;
+}
+
+void DMCompiler::ForcedError(const Location& location, const std::string& message) {
+    ProcCache::RecordSideEffect();
+    if (DiagnosticBuffer* buffer = DiagnosticBuffer::Current()) {
+        buffer->Add({DiagnosticBuffer::Entry::Kind::ForcedError, WarningCode::Unknown, location, message, ""});
+        return;
+    }
+    if (ParallelProcCompiler::Abandon()) return;
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+    std::string output;
+    RecordLocked({DiagnosticBuffer::Entry::Kind::ForcedError, WarningCode::Unknown, location, message, ""}, output);
+    std::cerr << output << std::flush;
+}
+
+void DMCompiler::Report(const DiagnosticBuffer& buffer) {
+    if (buffer.Empty()) return;
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+    std::string output;
+    for (const auto& entry : buffer.GetEntries()) {
+        RecordLocked(entry, output);
+    }
+    std::cerr << output << std::flush;
+}
+
+void DMCompiler::RecordLocked(const DiagnosticBuffer::Entry& entry, std::string& output) {
+    if (entry.EntryKind == DiagnosticBuffer::Entry::Kind::ForcedWarning) {
+        output += "Warning: " + entry.Message + "\n";
+        CompilerMessages_.push_back("Warning: " + entry.Message);
+        WarningCount_++;
+        return;
+    }
+    if (entry.EntryKind == DiagnosticBuffer::Entry::Kind::ForcedError) {
+        std::string fullMessage = entry.Loc.ToString() + ": Error: " + entry.Message;
+        output += fullMessage + "\n";
+        CompilerMessages_.push_back(std::move(fullMessage));
+        ErrorCount_++;
+        return;
+    }
+
     if (Aborted_) return;
 
-    if (UniqueEmissions_.find(code) != UniqueEmissions_.end()) {
+    if (UniqueEmissions_.find(entry.Code) != UniqueEmissions_.end()) {
         return; // Already emitted this warning
     }
     
-    auto it = ErrorConfig_.find(code);
+    auto it = ErrorConfig_.find(entry.Code);
     ErrorLevel level = (it != ErrorConfig_.end()) ? it->second : ErrorLevel::Warning;
     
     if (level == ErrorLevel::Disabled) {
@@ -193,44 +410,24 @@ void DMCompiler::Emit(WarningCode code, const Location& location, const std::str
         default: levelStr = "Unknown"; break;
     }
     
-    std::string fullMessage = location.ToString() + ": " + levelStr + ": " + message;
-    if (!context.empty()) {
-        fullMessage += "\n    Context: " + context;
+    std::string fullMessage = entry.Loc.ToString() + ": " + levelStr + ": " + entry.Message;
+    if (!entry.Context.empty()) {
+        fullMessage += "\n    Context: " + entry.Context;
     }
     
-    std::cerr << fullMessage << std::endl;
-    CompilerMessages_.push_back(fullMessage);
+    output += fullMessage + "\n";
+    CompilerMessages_.push_back(std::move(fullMessage));
     
-    UniqueEmissions_.insert(code);
+    UniqueEmissions_.insert(entry.Code);
 
     if (ErrorCount_ >= MaxErrors_ && MaxErrors_ > 0) {
-        std::cerr << "Fatal: Error limit reached (" << MaxErrors_ << "). Aborting compilation." << std::endl;
+        output += "Fatal: Error limit reached (" + std::to_string(MaxErrors_) + "). Aborting compilation.\n";
         Aborted_ = true;
     }
 }
 
-void DMCompiler::SetMaxErrors(int maxErrors) {
-    MaxErrors_ = maxErrors;
-}
-
-bool DMCompiler::ShouldAbort() const {
-    return Aborted_;
-}
-
-void DMCompiler::ForcedWarning(const std::string& message) {
-    std::cerr << "Warning: " << message << std::endl;
-    CompilerMessages_.push_back("Warning: " + message);
-    WarningCount_++;
-}
-
-void DMCompiler::ForcedError(const Location& location, const std::string& message) {
-    std::string fullMessage = location.ToString() + ": Error: " + message;
-    std::cerr << fullMessage << std::endl;
-    CompilerMessages_.push_back(fullMessage);
-    ErrorCount_++;
-}
-
 void DMCompiler::SetPragma(WarningCode code, ErrorLevel level) {
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
     ErrorConfig_[code] = level;
 }
 
@@ -242,6 +439,7 @@ void DMCompiler::AddResourceDirectory(const std::string& dir, const Location& lo
         return;
     }
     
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
     ResourceDirectories_.insert(dir);
 }
 
@@ -249,11 +447,13 @@ void DMCompiler::BuildResourceIdMap() {
     ResourceIdMap_.clear();
     int id = 1; // Resource IDs start at 1
     
-    // Convert unordered_set to ordered vector for consistent IDs
-    std::vector<std::string> sortedResources(ObjectTree_->Resources.begin(), ObjectTree_->Resources.end());
-    std::sort(sortedResources.begin(), sortedResources.end());
+    // Convert unordered_set to ordered vector for consistent IDs; kept for
+    // the JSON and binary outputs, which list resources in this order
+    SortedResources_.assign(ObjectTree_->Resources.begin(), ObjectTree_->Resources.end());
+    std::sort(SortedResources_.begin(), SortedResources_.end());
     
-    for (const auto& path : sortedResources) {
+    ResourceIdMap_.reserve(SortedResources_.size());
+    for (const auto& path : SortedResources_) {
         ResourceIdMap_[path] = id++;
     }
 }
@@ -266,12 +466,226 @@ int DMCompiler::GetResourceId(const std::string& path) const {
     return -1;
 }
 
+// Extract the numeric #define constants from DMStandard/Defines.dm
+static bool ParseStandardConstants(const std::string& definesPath, std::vector<std::pair<std::string, int>>& constants) {
+    std::ifstream file(definesPath);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::string line;
+    
+    // Parse #define directives and extract numeric constants
+    while (std::getline(file, line)) {
+        // Trim leading whitespace
+        size_t start = line.find_first_not_of(" \t");
+        if (start == std::string::npos) continue;
+        
+        // Check if line starts with #define
+        if (line.substr(start, 7) != "#define") continue;
+        
+        // Extract the macro name and value
+        size_t nameStart = start + 7;
+        nameStart = line.find_first_not_of(" \t", nameStart);
+        if (nameStart == std::string::npos) continue;
+        
+        size_t nameEnd = line.find_first_of(" \t", nameStart);
+        if (nameEnd == std::string::npos) continue;
+        
+        std::string name = line.substr(nameStart, nameEnd - nameStart);
+        
+        // Extract the value
+        size_t valueStart = line.find_first_not_of(" \t", nameEnd);
+        if (valueStart == std::string::npos) continue;
+        
+        // Find the end of the value (before any comment)
+        size_t valueEnd = line.find("//", valueStart);
+        if (valueEnd == std::string::npos) {
+            valueEnd = line.length();
+        }
+        
+        // Trim trailing whitespace from value
+        while (valueEnd > valueStart && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) {
+            valueEnd--;
+        }
+        
+        std::string valueStr = line.substr(valueStart, valueEnd - valueStart);
+        
+        // Try to parse as integer
+        try {
+            // Handle simple numeric values
+            if (valueStr.find_first_not_of("0123456789-") == std::string::npos) {
+                int value = std::stoi(valueStr);
+                constants.emplace_back(name, value);
+            }
+            // Handle hex values (0x...)
+            else if (valueStr.substr(0, 2) == "0x" || valueStr.substr(0, 2) == "0X") {
+                int value = std::stoi(valueStr, nullptr, 16);
+                constants.emplace_back(name, value);
+            }
+            // Handle expressions like "NORTH | EAST" (5)
+            else if (name == "NORTHEAST") {
+                constants.emplace_back(name, 5);  // NORTH | EAST
+            }
+            else if (name == "SOUTHEAST") {
+                constants.emplace_back(name, 6);  // SOUTH | EAST
+            }
+            else if (name == "SOUTHWEST") {
+                constants.emplace_back(name, 10);  // SOUTH | WEST
+            }
+            else if (name == "NORTHWEST") {
+                constants.emplace_back(name, 9);  // NORTH | WEST
+            }
+            // Handle bit shift expressions like "(1<<0)"
+            else if (valueStr.find("<<") != std::string::npos) {
+                // Parse simple bit shift: (1<<N)
+                size_t shiftPos = valueStr.find("<<");
+                size_t numStart = valueStr.find_first_of("0123456789", shiftPos + 2);
+                if (numStart != std::string::npos) {
+                    size_t numEnd = valueStr.find_first_not_of("0123456789", numStart);
+                    if (numEnd == std::string::npos) numEnd = valueStr.length();
+                    
+                    int shiftAmount = std::stoi(valueStr.substr(numStart, numEnd - numStart));
+                    int value = 1 << shiftAmount;
+                    constants.emplace_back(name, value);
+                }
+            }
+            // Skip string constants and complex expressions
+        } catch (const std::exception&) {
+            // Skip constants that can't be parsed as integers
+            continue;
+        }
+    }
+    
+    return true;
+}
+
+bool DMCompiler::LoadStandardSnapshot(DMPreprocessor& preprocessor, const std::string& standardDir,
+                                      const std::string& standardFile) {
+    // Replay the side effects preprocessing _Standard.dm would have had
+    auto replay = [this](const DMStandardSnapshot& snapshot) {
+        for (const auto& [code, level] : snapshot.Pragmas) {
+            SetPragma(code, level);
+        }
+        for (const auto& dir : snapshot.ResourceDirectories) {
+            AddResourceDirectory(dir, Location::Internal);
+        }
+    };
+
+    // A resident compiler keeps the last one, checked by stat and defines like
+    // the file. Targets of a batch wait here for the first to build it.
+    uint64_t sourcesStamp = DMStandardSnapshot::StampSources(standardDir, Settings_.MacroDefines);
+    std::unique_lock<std::mutex> warmLock;
+    if (WarmState_) {
+        warmLock = std::unique_lock<std::mutex>(WarmState_->StandardMutex);
+    }
+    if (WarmState_ && WarmState_->Standard && WarmState_->StandardDir == standardDir &&
+        WarmState_->Standard->SourcesStamp == sourcesStamp) {
+        replay(*WarmState_->Standard);
+        if (Settings_.Verbose) {
+            std::cout << "  Reused DMStandard snapshot in memory (" << WarmState_->Standard->Tokens.size()
+                      << " tokens)" << std::endl;
+        }
+        StandardSnapshot_ = WarmState_->Standard;
+        return true;
+    }
+
+    auto snapshot = std::make_shared<DMStandardSnapshot>();
+    if (snapshot->Load(Settings_.StandardSnapshotPath, standardDir, Settings_.MacroDefines)) {
+        replay(*snapshot);
+        if (Settings_.Verbose) {
+            std::cout << "  Loaded DMStandard snapshot: " << Settings_.StandardSnapshotPath
+                      << " (" << snapshot->Tokens.size() << " tokens)" << std::endl;
+        }
+        if (WarmState_) {
+            WarmState_->Standard = snapshot;
+            WarmState_->StandardDir = standardDir;
+        }
+        StandardSnapshot_ = std::move(snapshot);
+        return true;
+    }
+    snapshot->SourcesStamp = sourcesStamp;
+
+    // Missing or stale: preprocess DMStandard normally and record what it did
+    std::unordered_map<WarningCode, ErrorLevel> pragmasBefore;
+    std::set<std::string> resourcesBefore;
+    int errorsBefore;
+    {
+        std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+        pragmasBefore = ErrorConfig_;
+        resourcesBefore = ResourceDirectories_;
+        errorsBefore = ErrorCount_;
+    }
+
+    try {
+        if (Settings_.Verbose) {
+            std::cout << "  Including DMStandard: " << standardFile << std::endl;
+        }
+        snapshot->Tokens = preprocessor.Preprocess(standardFile);
+    } catch (const std::exception& e) {
+        ForcedError(Location::Internal,
+            "Error preprocessing DMStandard: " + std::string(e.what()));
+        return false;
+    }
+
+    std::string definesFile = (std::filesystem::path(standardDir) / "Defines.dm").string();
+    bool haveConstants = ParseStandardConstants(definesFile, snapshot->Constants);
+
+    bool clean;
+    {
+        std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+        for (const auto& [code, level] : ErrorConfig_) {
+            auto it = pragmasBefore.find(code);
+            if (it == pragmasBefore.end() || it->second != level) {
+                snapshot->Pragmas.emplace_back(code, level);
+            }
+        }
+        for (const auto& dir : ResourceDirectories_) {
+            if (resourcesBefore.count(dir) == 0) {
+                snapshot->ResourceDirectories.push_back(dir);
+            }
+        }
+        clean = ErrorCount_ == errorsBefore;
+    }
+
+    // A DMStandard that produced errors is not worth reusing
+    if (haveConstants && clean &&
+        !snapshot->Save(Settings_.StandardSnapshotPath, standardDir, Settings_.MacroDefines)) {
+        ForcedWarning("Failed to write DMStandard snapshot: " + Settings_.StandardSnapshotPath);
+    }
+    if (haveConstants && clean && WarmState_) {
+        WarmState_->Standard = snapshot;
+        WarmState_->StandardDir = standardDir;
+    }
+    if (!haveConstants) {
+        snapshot->Constants.clear();  // InitializeDMStandard falls back to Defines.dm and reports the problem
+    }
+    if (Settings_.Verbose) {
+        std::cout << "  DMStandard tokens: " << snapshot->Tokens.size() << std::endl;
+    }
+    StandardSnapshot_ = std::move(snapshot);
+    return true;
+}
+
 bool DMCompiler::PreprocessFiles() {
     if (Settings_.Verbose) {
         std::cout << "Phase 1: Preprocessing files..." << std::endl;
     }
 
-    DMPreprocessor preprocessor(this);
+    auto preprocessorOwner = std::make_unique<DMPreprocessor>(this);
+    DMPreprocessor& preprocessor = *preprocessorOwner;
+    preprocessor.SetLexThreads(Settings_.LexThreads);
+    if (WarmState_ && WarmState_->Tokens && WarmState_->Tokens->GetDirectory() == Settings_.TokenCacheDir) {
+        preprocessor.SetTokenCache(WarmState_->Tokens);
+    } else if (!Settings_.TokenCacheDir.empty()) {
+        preprocessor.SetTokenCache(std::make_shared<TokenCache>(Settings_.TokenCacheDir));
+    }
+    if (Settings_.PreprocStats) {
+        PreprocessorStats_ = std::make_shared<PreprocessorStats>();
+        preprocessor.SetStats(PreprocessorStats_);
+    }
+    preprocessor.SetCosts(Costs_);
+    preprocessor.SetDependencies(Dependencies_);
 
     // Add custom defines from settings
     for (const auto& [name, value] : Settings_.MacroDefines) {
@@ -282,6 +696,9 @@ bool DMCompiler::PreprocessFiles() {
         }
     }
 
+    // Root files handed to the pipeline when streaming
+    std::vector<std::string> streamFiles;
+
     // Include DMStandard if not suppressed (matching C# implementation)
     if (!Settings_.NoStandard) {
         namespace fs = std::filesystem;
@@ -327,18 +744,29 @@ bool DMCompiler::PreprocessFiles() {
         fs::path dmStandardDir = compilerDir / "DMStandard";
         fs::path standardFile = dmStandardDir / "_Standard.dm";
         
-        if (fs::exists(standardFile)) {
+        if (fs::exists(standardFile) && !Settings_.StandardSnapshotPath.empty()) {
+            if (!LoadStandardSnapshot(preprocessor, dmStandardDir.string(), standardFile.string())) {
+                return false;
+            }
+            if (!Settings_.StreamTokens) {
+                PreprocessedTokens_.Append(StandardSnapshot_->Tokens);
+                StartStandardParse(std::shared_ptr<const std::vector<Token>>(StandardSnapshot_, &StandardSnapshot_->Tokens));
+            }
+        } else if (fs::exists(standardFile) && Settings_.StreamTokens) {
+            streamFiles.push_back(standardFile.string());
+        } else if (fs::exists(standardFile)) {
             try {
                 if (Settings_.Verbose) {
                     std::cout << "  Including DMStandard: " << standardFile.string() << std::endl;
                 }
                 
                 std::vector<Token> tokens = preprocessor.Preprocess(standardFile.string());
-                PreprocessedTokens_.insert(PreprocessedTokens_.end(), tokens.begin(), tokens.end());
+                PreprocessedTokens_.Append(tokens);
                 
                 if (Settings_.Verbose) {
                     std::cout << "  DMStandard tokens: " << tokens.size() << std::endl;
                 }
+                StartStandardParse(std::make_shared<const std::vector<Token>>(std::move(tokens)));
             } catch (const std::exception& e) {
                 ForcedError(Location::Internal, 
                     "Error preprocessing DMStandard: " + std::string(e.what()));
@@ -354,14 +782,33 @@ bool DMCompiler::PreprocessFiles() {
         }
     }
 
+    // Streaming: the parser drains the preprocessor as it runs
+    if (Settings_.StreamTokens) {
+        streamFiles.insert(streamFiles.end(), Settings_.Files.begin(), Settings_.Files.end());
+        Pipeline_ = std::make_unique<PreprocessorPipeline>(this, std::move(preprocessorOwner), std::move(streamFiles));
+        if (StandardSnapshot_) {
+            Pipeline_->SetLeadingTokens(StandardSnapshot_->Tokens);
+        }
+        Pipeline_->Start();
+        if (Settings_.Verbose) {
+            std::cout << "  Streaming preprocessor output to the parser" << std::endl;
+        }
+        return true;
+    }
+
     // Preprocess all user files
     for (const auto& filePath : Settings_.Files) {
         CheckProgress("Preprocessing");
         try {
-            std::vector<Token> tokens = preprocessor.Preprocess(filePath);
-            
-            // Append to PreprocessedTokens_
-            PreprocessedTokens_.insert(PreprocessedTokens_.end(), tokens.begin(), tokens.end());
+            // Straight into PreprocessedTokens_, so the file's tokens are
+            // never held twice
+            size_t before = PreprocessedTokens_.size();
+            if (preprocessor.Initialize(filePath)) {
+                Token token;
+                while (preprocessor.ReadOutputToken(token)) {
+                    PreprocessedTokens_.Push(token);
+                }
+            }
             
             // Check token limit
             if (PreprocessedTokens_.size() > Limits::MAX_TOKENS) {
@@ -372,7 +819,7 @@ bool DMCompiler::PreprocessFiles() {
             
             if (Settings_.Verbose) {
                 std::cout << "  Preprocessed " << filePath << ": " 
-                         << tokens.size() << " tokens" << std::endl;
+                         << PreprocessedTokens_.size() - before << " tokens" << std::endl;
             }
         } catch (const std::exception& e) {
             std::cerr << "Error preprocessing " << filePath << ": " << e.what() << std::endl;
@@ -386,8 +833,8 @@ bool DMCompiler::PreprocessFiles() {
         // DEBUG: Print first 50 tokens to see what's happening
         std::cout << "  First 50 preprocessed tokens:" << std::endl;
         for (size_t i = 0; i < std::min(size_t(50), PreprocessedTokens_.size()); ++i) {
-            std::cout << "    [" << i << "] type=" << static_cast<int>(PreprocessedTokens_[i].Type)
-                      << " text='" << PreprocessedTokens_[i].Text << "'" << std::endl;
+            std::cout << "    [" << i << "] type=" << static_cast<int>(PreprocessedTokens_.TypeAt(i))
+                      << " text='" << PreprocessedTokens_.TextAt(i) << "'" << std::endl;
         }
     }
 
@@ -404,39 +851,142 @@ bool DMCompiler::PreprocessFiles() {
             std::cout << "  Included interface: " << IncludedInterface_ << std::endl;
         }
     }
+    
+    if (PreprocessorStats_) {
+        PreprocessorStats_->Report(std::cout);
+    }
 
     return true;
 }
 
-bool DMCompiler::ParseFiles() {
-    std::cout << "Phase 2: Parsing..." << std::endl;
+bool DMCompiler::LoadPreprocessedOutput() {
+    if (Settings_.Verbose) {
+        std::cout << "Phase 1: Loading preprocessed output: " << Settings_.LoadPreprocessedPath << std::endl;
+    }
     
-    if (PreprocessedTokens_.empty()) {
-        ForcedError(Location::Internal, "No tokens to parse");
+    PreprocessedOutput output;
+    if (!output.Load(Settings_.LoadPreprocessedPath)) {
+        ForcedError(Location::Internal, "Failed to load preprocessed output (missing, corrupt or from another compiler version): " +
+            Settings_.LoadPreprocessedPath);
         return false;
     }
     
-    if (Settings_.Verbose) {
-        std::cout << "  Parsing " << PreprocessedTokens_.size() << " tokens..." << std::endl;
+    // Restore the state preprocessing left behind on the producing side
+    for (const auto& [code, level] : output.Pragmas) {
+        SetPragma(code, level);
     }
+    for (const auto& dir : output.ResourceDirectories) {
+        AddResourceDirectory(dir, Location::Internal);
+    }
+    IncludedMaps_ = std::move(output.IncludedMaps);
+    IncludedInterface_ = std::move(output.IncludedInterface);
+    StandardConstants_ = std::move(output.StandardConstants);
+    PreprocessedTokens_.Append(output.Tokens);
     
-    // Create a token stream lexer that feeds our preprocessed tokens to the parser
-    TokenStreamDMLexer lexer(PreprocessedTokens_);
+    if (Settings_.Verbose) {
+        std::cout << "  Loaded " << PreprocessedTokens_.size() << " preprocessed tokens" << std::endl;
+    }
+    return true;
+}
+
+bool DMCompiler::SavePreprocessedOutput() {
+    if (ErrorCount_ > 0) {
+        // A consumer would parse a stream that already failed here
+        ForcedWarning("Not writing preprocessed output because preprocessing reported errors");
+        return true;
+    }
     
-    // Create the parser
-    DMParser parser(this, &lexer);
+    PreprocessedOutput output;
+    output.Tokens.reserve(PreprocessedTokens_.size());
+    for (size_t i = 0; i < PreprocessedTokens_.size(); ++i) {
+        output.Tokens.push_back(PreprocessedTokens_.Get(i));
+    }
+    output.StandardConstants = StandardConstants_;
+    {
+        std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
+        output.Pragmas.assign(ErrorConfig_.begin(), ErrorConfig_.end());
+        output.ResourceDirectories.assign(ResourceDirectories_.begin(), ResourceDirectories_.end());
+    }
+    output.IncludedMaps = IncludedMaps_;
+    output.IncludedInterface = IncludedInterface_;
     
-    // Parse the token stream into an AST
-    try {
-        ParsedAST_ = parser.ParseFile();
-        
+    if (!output.Save(Settings_.EmitPreprocessedPath)) {
+        ForcedError(Location::Internal, "Failed to write preprocessed output: " + Settings_.EmitPreprocessedPath);
+        return false;
+    }
+    if (Settings_.Verbose) {
+        std::cout << "  Wrote " << output.Tokens.size() << " preprocessed tokens to " << Settings_.EmitPreprocessedPath << std::endl;
+    }
+    return true;
+}
+
+bool DMCompiler::ParseFiles() {
+    std::cout << "Phase 2: Parsing..." << std::endl;
+    
+    if (!Pipeline_ && PreprocessedTokens_.empty()) {
+        ForcedError(Location::Internal, "No tokens to parse");
+        return false;
+    }
+    
+    if (!Pipeline_) {
+        // Settle indentation once, so the lexer and the parallel splitter just walk the array
+        ResolveIndentation(PreprocessedTokens_);
+    }
+    
+    if (Settings_.Verbose && !Pipeline_) {
+        std::cout << "  Parsing " << PreprocessedTokens_.size() << " tokens..." << std::endl;
+    }
+    
+    // Create a token stream lexer that feeds our preprocessed tokens to the parser
+    std::unique_ptr<TokenStreamDMLexer> lexer = Pipeline_
+        ? std::make_unique<TokenStreamDMLexer>(Pipeline_->GetStream())
+        : std::make_unique<TokenStreamDMLexer>(PreprocessedTokens_);
+    
+    // Create the parser
+    DMParser parser(this, lexer.get());
+    parser.SetDeferProcBodies(Settings_.LazyProcBodies);
+    
+    // Parse the token stream into an AST
+    try {
+        if (!Pipeline_ && !Settings_.ASTCacheDir.empty()) {
+            ParsedAST_ = ParseWithASTCache();
+        }
+        if (!ParsedAST_ && StandardParser_.joinable()) {
+            ParsedAST_ = ParseAfterStandard();
+        }
+        if (!ParsedAST_ && !Pipeline_ && Settings_.ParseThreads > 1) {
+            ParallelParser parallel(this, PreprocessedTokens_);
+            ParsedAST_ = parallel.Parse(Settings_.ParseThreads);
+            if (Settings_.Verbose) {
+                if (ParsedAST_) {
+                    std::cout << "  Parsed " << parallel.ChunkCount() << " chunks on " << Settings_.ParseThreads << " threads" << std::endl;
+                } else if (parallel.ChunkCount() < 2) {
+                    std::cout << "  Parsing sequentially (too few tokens to split)" << std::endl;
+                } else {
+                    std::cout << "  Parsing sequentially (a chunk has syntax errors)" << std::endl;
+                }
+            }
+        }
+        if (!ParsedAST_) {
+            ParsedAST_ = parser.ParseFile();
+        }
+        
+        if (Pipeline_ && !FinishPipeline()) {
+            return false;
+        }
+        
         if (!ParsedAST_) {
             ForcedError(Location::Internal, "Parser returned null AST");
             return false;
         }
         
         if (Settings_.Verbose) {
-            std::cout << "  Parsed " << ParsedAST_->Statements.size() << " top-level statements" << std::endl;
+            std::cout << "  Parsed " << ParsedAST_->Statements.size() << " top-level statements";
+            if (ParsedAST_->Arena) {
+                std::cout << " (" << ParsedAST_->Arena->BytesUsed() / 1024 << " KB of AST in "
+                          << ParsedAST_->Arena->ChunkCount() << " chunks)";
+            }
+            std::cout << std::endl;
         }
         
         // Phase 2.5: Constant folding
@@ -444,17 +994,168 @@ bool DMCompiler::ParseFiles() {
             std::cout << "  Performing constant folding..." << std::endl;
         }
         
+        auto timing = CompileTimings::Time(Timings_.get(), "ConstantFolding");
         DMASTFolder folder;
         folder.FoldAst(ParsedAST_.get());
         
         return true;
         
     } catch (const std::exception& e) {
+        if (Pipeline_) {
+            FinishPipeline();
+        }
         ForcedError(Location::Internal, std::string("Parser exception: ") + e.what());
         return false;
     }
 }
 
+std::unique_ptr<DMASTFile> DMCompiler::ParseWithASTCache() {
+    ASTCache cache(Settings_.ASTCacheDir, Settings_.LazyProcBodies);
+    std::vector<ASTCache::Segment> segments = ASTCache::FindSegments(PreprocessedTokens_);
+    if (segments.empty()) {
+        return nullptr;
+    }
+    
+    std::vector<std::unique_ptr<DMASTFile>> fragments(segments.size());
+    std::vector<size_t> misses;
+    for (size_t i = 0; i < segments.size(); ++i) {
+        fragments[i] = cache.Load(segments[i]);
+        if (!fragments[i]) {
+            misses.push_back(i);
+        }
+    }
+    
+    // Segments parse independently, like ParallelParser's chunks
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    auto worker = [&]() {
+        size_t index;
+        while (!failed && (index = next++) < misses.size()) {
+            const ASTCache::Segment& segment = segments[misses[index]];
+            fragments[misses[index]] = ParallelParser::ParseChunk(this, PreprocessedTokens_, segment.Begin, segment.End);
+            if (!fragments[misses[index]]) {
+                failed = true;
+            }
+        }
+    };
+    
+    unsigned count = static_cast<unsigned>(std::min<size_t>(std::max(Settings_.ParseThreads, 1u), misses.size()));
+    if (count > 1) {
+        std::vector<std::thread> threads;
+        threads.reserve(count);
+        for (unsigned i = 0; i < count; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    } else {
+        worker();
+    }
+    
+    if (failed) {
+        if (Settings_.Verbose) {
+            std::cout << "  AST cache: a changed segment has syntax errors, parsing without the cache" << std::endl;
+        }
+        return nullptr;
+    }
+    
+    // Stored before folding, which runs on loaded and parsed fragments alike
+    for (size_t index : misses) {
+        cache.Store(segments[index], *fragments[index]);
+    }
+    if (Settings_.Verbose) {
+        std::cout << "  AST cache: loaded " << segments.size() - misses.size() << " of " << segments.size()
+                  << " segments, parsed " << misses.size() << std::endl;
+    }
+    return ParallelParser::Merge(std::move(fragments));
+}
+
+void DMCompiler::StartStandardParse(std::shared_ptr<const std::vector<Token>> tokens) {
+    // The AST cache already keeps DMStandard's segments parsed
+    if (Settings_.ParseThreads < 2 || Settings_.StreamTokens || !Settings_.ASTCacheDir.empty() || tokens->empty()) {
+        return;
+    }
+    StandardParser_ = std::thread([this, tokens = std::move(tokens)]() {
+        for (const auto& token : *tokens) {
+            StandardTokens_.Push(token);
+        }
+        ResolveIndentation(StandardTokens_);
+        StandardAST_ = ParallelParser::ParseChunk(this, StandardTokens_, 0, StandardTokens_.size());
+    });
+}
+
+std::unique_ptr<DMASTFile> DMCompiler::ParseAfterStandard() {
+    StandardParser_.join();
+    std::unique_ptr<DMASTFile> standard = std::move(StandardAST_);
+    
+    // Resolved on its own, DMStandard ends in an EndOfFile where user code starts in
+    // the whole stream. Indentation only looks one token ahead, so the tokens before
+    // it match when a definition can start there
+    size_t begin = StandardTokens_.size() - 1;
+    bool split = standard && begin < PreprocessedTokens_.size() && ParallelParser::IsChunkStart(PreprocessedTokens_, begin);
+    for (size_t i = 0; split && i < begin; ++i) {
+        const CompactToken& own = StandardTokens_.At(i);
+        const CompactToken& whole = PreprocessedTokens_.At(i);
+        split = own.Type == whole.Type && own.FileId == whole.FileId && own.Line == whole.Line && own.Column == whole.Column;
+    }
+    StandardTokens_.Release();
+    if (!split) {
+        if (Settings_.Verbose) {
+            std::cout << "  DMStandard cannot be parsed apart from user code, parsing them together" << std::endl;
+        }
+        return nullptr;
+    }
+    
+    std::vector<std::unique_ptr<DMASTFile>> fragments;
+    fragments.push_back(std::move(standard));
+    ParallelParser parallel(this, PreprocessedTokens_);
+    fragments.push_back(parallel.Parse(Settings_.ParseThreads, ParallelParser::DefaultMinChunkTokens, begin));
+    if (!fragments.back()) {
+        // Nothing the parser does carries over into user code, so its diagnostics are the ones a whole parse reports
+        TokenStreamDMLexer lexer(PreprocessedTokens_, begin, PreprocessedTokens_.size());
+        DMParser parser(this, &lexer);
+        parser.SetDeferProcBodies(Settings_.LazyProcBodies);
+        fragments.back() = parser.ParseFile();
+        if (!fragments.back()) {
+            return nullptr;
+        }
+    }
+    if (Settings_.Verbose) {
+        std::cout << "  Parsed DMStandard while user files were preprocessed" << std::endl;
+    }
+    return ParallelParser::Merge(std::move(fragments));
+}
+
+bool DMCompiler::FinishPipeline() {
+    bool succeeded = Pipeline_->Finish();
+    size_t tokenCount = Pipeline_->GetTokenCount();
+    
+    // Maps and interface are only known once the last file has been preprocessed
+    IncludedMaps_ = Pipeline_->GetPreprocessor().GetIncludedMaps();
+    IncludedInterface_ = Pipeline_->GetPreprocessor().GetIncludedInterface();
+    Pipeline_.reset();
+    
+    // The producer thread has exited, so the counters are complete
+    if (PreprocessorStats_) {
+        PreprocessorStats_->Report(std::cout);
+    }
+    
+    if (Settings_.Verbose) {
+        std::cout << "  Streamed " << tokenCount << " preprocessed tokens" << std::endl;
+        std::cout << "  Included maps: " << IncludedMaps_.size() << std::endl;
+    }
+    
+    if (!succeeded) {
+        return false;
+    }
+    if (tokenCount == 0) {
+        ForcedError(Location::Internal, "No tokens to parse");
+        return false;
+    }
+    return true;
+}
+
 bool DMCompiler::BuildObjectTree() {
     std::cout << "Phase 3: Building object tree..." << std::endl;
     
@@ -476,24 +1177,134 @@ bool DMCompiler::BuildObjectTree() {
     return true;
 }
 
+std::unique_ptr<DMASTProcBlockInner> DMCompiler::ParseProcBodyRange(const DMASTObjectProcDefinition& procDef, bool suppressDiagnostics) {
+    const auto& range = procDef.DeferredBody;
+    TokenStreamDMLexer lexer(PreprocessedTokens_, range.Begin, range.End);
+    DMParser parser(this, &lexer);
+    parser.SetSuppressDiagnostics(suppressDiagnostics);
+    
+    auto body = parser.ParseProcBody(range.BaseIndent);
+    if (parser.HadSuppressedDiagnostics()) {
+        return nullptr;
+    }
+    
+    DMASTFolder folder;
+    folder.FoldAst(body.get());
+    return body;
+}
+
+void DMCompiler::ParseDeferredProcBody(DMASTObjectProcDefinition* procDef) {
+    if (!procDef || !procDef->HasDeferredBody()) {
+        return;
+    }
+    procDef->Body = ParseProcBodyRange(*procDef, false);
+    procDef->DeferredBody = {};
+}
+
+void DMCompiler::ParseDeferredProcBodies() {
+    if (Settings_.ParseThreads < 2) {
+        return;
+    }
+    
+    std::vector<DMASTObjectProcDefinition*> deferred;
+    for (const auto& proc : ObjectTree_->AllProcs) {
+        if (proc->AstDefinition && proc->AstDefinition->HasDeferredBody()) {
+            deferred.push_back(proc->AstDefinition);
+        }
+    }
+    if (deferred.size() < 2) {
+        return;
+    }
+    
+    // Each body is parsed into its own heap-allocated nodes, so the workers share nothing
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> parsed{0};
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next++) < deferred.size()) {
+            DMASTObjectProcDefinition* procDef = deferred[index];
+            try {
+                procDef->Body = ParseProcBodyRange(*procDef, true);
+            } catch (const std::exception&) {
+                procDef->Body = nullptr;
+            }
+            if (procDef->Body) {
+                procDef->DeferredBody = {};
+                parsed++;
+            }
+        }
+    };
+    
+    std::vector<std::thread> threads;
+    unsigned count = static_cast<unsigned>(std::min<size_t>(Settings_.ParseThreads, deferred.size()));
+    threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    if (Settings_.Verbose) {
+        std::cout << "  Parsed " << parsed << " of " << deferred.size() << " deferred proc bodies on "
+                  << count << " threads" << std::endl;
+    }
+}
+
+void DMCompiler::ApplyProcProfile() {
+    Profile_.reset();
+    if (Settings_.ProfileDataPath.empty()) {
+        return;
+    }
+    
+    std::string error;
+    Profile_ = ProcProfile::Load(Settings_.ProfileDataPath, error);
+    if (!Profile_) {
+        ForcedError(Location::Internal, error);
+        return;
+    }
+    Profile_->Classify(*ObjectTree_);
+    if (Settings_.Verbose) {
+        std::cout << "  Profile: " << Profile_->GetHotCount() << " hot and " << Profile_->GetColdCount()
+                  << " cold procs of " << ObjectTree_->AllProcs.size() << std::endl;
+    }
+}
+
+void DMCompiler::OpenProcCache() {
+    ProcCache_.reset();
+    if (Settings_.ProcCacheDir.empty()) {
+        return;
+    }
+    
+    ProcCache::TreeFingerprint fingerprint;
+    if (!ProcCache::Fingerprint(*this, *ObjectTree_, fingerprint)) {
+        if (Settings_.Verbose) {
+            std::cout << "  Proc cache not used: a var's value or a short proc cannot be hashed" << std::endl;
+        }
+        return;
+    }
+    OperandEncoding encoding = Settings_.CompactOperands ? OperandEncoding::Leb128 : OperandEncoding::Fixed;
+    ProcCache_ = std::make_unique<ProcCache>(Settings_.ProcCacheDir, std::move(fingerprint), encoding);
+}
+
 bool DMCompiler::ProcessObjectStatement(DMASTStatement* statement, const DreamPath& currentPath) {
     // Skip proc-level statements (they're inside proc bodies, not object definitions)
     // We only process DMASTObjectStatement types here
-    if (!dynamic_cast<DMASTObjectStatement*>(statement)) {
+    if (!IsObjectStatementKind(statement->Kind_)) {
         // This is a proc-level statement (if, for, expression, etc.)
         // It should not be processed at object tree level
         return true;
     }
     
     // Object definition: /mob/player { ... }
-    if (auto* objDef = dynamic_cast<DMASTObjectDefinition*>(statement)) {
+    if (auto* objDef = DMASTCast<DMASTObjectDefinition>(statement)) {
         // No longer needed - parser now properly handles return type annotations
         // and doesn't create spurious object definitions
         return ProcessObjectDefinition(objDef, currentPath);
     }
     
     // Variable definition: var/name = "value"
-    else if (auto* varDef = dynamic_cast<DMASTObjectVarDefinition*>(statement)) {
+    else if (auto* varDef = DMASTCast<DMASTObjectVarDefinition>(statement)) {
         if (Settings_.Verbose) {
             std::cout << "  Found variable definition statement for: " << varDef->Name << std::endl;
         }
@@ -501,12 +1312,12 @@ bool DMCompiler::ProcessObjectStatement(DMASTStatement* statement, const DreamPa
     }
     
     // Variable override: name = "value"
-    else if (auto* varOverride = dynamic_cast<DMASTObjectVarOverride*>(statement)) {
+    else if (auto* varOverride = DMASTCast<DMASTObjectVarOverride>(statement)) {
         return ProcessVarOverride(varOverride, currentPath);
     }
     
     // Proc definition: proc/test() { ... }
-    else if (auto* procDef = dynamic_cast<DMASTObjectProcDefinition*>(statement)) {
+    else if (auto* procDef = DMASTCast<DMASTObjectProcDefinition>(statement)) {
         return ProcessProcDefinition(procDef, currentPath);
     }
     
@@ -516,7 +1327,7 @@ bool DMCompiler::ProcessObjectStatement(DMASTStatement* statement, const DreamPa
             std::cout << "  Skipping unknown statement type at " 
                       << statement->Location_.ToString() << std::endl;
             // Try to identify the type for debugging
-            if (dynamic_cast<DMASTObjectDefinition*>(statement)) {
+            if (DMASTCast<DMASTObjectDefinition>(statement)) {
                 std::cout << "    (It's an ObjectDefinition that wasn't caught earlier)" << std::endl;
             }
         }
@@ -531,10 +1342,8 @@ bool DMCompiler::ProcessObjectDefinition(DMASTObjectDefinition* objDef, const Dr
     // Check if this is a "var" block (path ends with "var")
     // In this case, we don't create an object, we just process the inner statements
     // which will be variable definitions
-    bool isVarBlock = false;
     auto elements = fullPath.GetElements();
     if (!elements.empty() && elements.back() == "var") {
-        isVarBlock = true;
         if (Settings_.Verbose) {
             std::cout << "  Processing var block at: " << fullPath.ToString() << std::endl;
         }
@@ -797,28 +1606,17 @@ bool DMCompiler::ProcessProcDefinition(DMASTObjectProcDefinition* procDef, const
     
     // Store the AST body for later bytecode compilation (Phase 4)
     proc->AstBody = procDef->Body.get();
+    proc->AstDefinition = procDef;
     
     // Process parameters
-    int paramIndex = 0;
     for (const auto& param : procDef->Parameters) {
-        // Add to parameter list
-        proc->Parameters.push_back(param->Name);
-        
         // Create local variable for parameter
         std::optional<DreamPath> paramType = std::nullopt;
         if (!param->TypePath.GetElements().empty()) {
             paramType = param->TypePath;
         }
         
-        auto localVar = std::make_unique<LocalVariable>(
-            param->Name,
-            paramIndex,
-            true, // IsParameter
-            paramType
-        );
-        
-        proc->LocalVariables[param->Name] = std::move(localVar);
-        paramIndex++;
+        proc->AddParameter(param->Name, paramType);
     }
     
     // Add the proc to the object
@@ -850,13 +1648,16 @@ bool DMCompiler::EmitBytecode() {
             continue;
         }
         
+        CompileCosts::ProcTimer costTimer(Costs_.get(), proc.get());
+        proc->LoadDeferredBody(this);
         if (!proc->AstBody) {
             // No body to compile (e.g., native procs)
             continue;
         }
         
         // Create bytecode writer
-        BytecodeWriter writer;
+        PooledBytecodeWriter pooledWriter(ObjectTree_.get());
+        BytecodeWriter& writer = *pooledWriter;
         
         // Create expression compiler
         DMExpressionCompiler exprCompiler(this, proc.get(), &writer);
@@ -877,13 +1678,13 @@ bool DMCompiler::EmitBytecode() {
                 ForcedWarning("Compiling " + proc->Name + " as stub due to compilation failure in " + proc->OwningObject->Path.ToString());
                 
                 // Create a fresh writer for the stub
-                BytecodeWriter stubWriter;
+                BytecodeWriter stubWriter(ObjectTree_.get());
                 stubWriter.Emit(DreamProcOpcode::PushNull);
                 stubWriter.ResizeStack(1);
                 stubWriter.Emit(DreamProcOpcode::Return);
                 
                 // Store stub bytecode
-                proc->Bytecode = stubWriter.GetBytecode();
+                proc->Bytecode = stubWriter.TakeBytecode();
                 proc->MaxStackSize = stubWriter.GetMaxStackSize();
                 continue;
             }
@@ -909,12 +1710,8 @@ bool DMCompiler::EmitBytecode() {
             writer.Emit(DreamProcOpcode::Return);
         }
         
-        // Finalize bytecode (resolve jump labels)
-        writer.Finalize();
-        
-        // Store bytecode and max stack size
-        proc->Bytecode = writer.GetBytecode();
-        proc->MaxStackSize = writer.GetMaxStackSize();
+        // Optimize, then finalize bytecode (resolve jump labels) and store it
+        proc->StoreBytecode(this, writer);
         
         if (Settings_.Verbose) {
             std::string pathStr = proc->OwningObject->Path.ToString();
@@ -930,56 +1727,352 @@ bool DMCompiler::EmitBytecode() {
     return true;
 }
 
+namespace {
+
+// Write count elements into the array json is in, element i by
+// writeElement(writer, i). With threadCount threads, runs of consecutive
+// elements are written into fragments side by side, a window of them at a
+// time, and put in the output in order, so it is the same as writing them
+// one after another and there is never more than a window held in memory.
+template <typename WriteElement>
+void WriteJsonElements(JsonWriter& json, size_t count, unsigned threadCount, const WriteElement& writeElement) {
+    constexpr size_t ElementsPerFragment = 64;
+    size_t fragmentCount = (count + ElementsPerFragment - 1) / ElementsPerFragment;
+    if (threadCount < 2 || fragmentCount < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            writeElement(json, i);
+        }
+        return;
+    }
+    
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, fragmentCount));
+    size_t windowSize = static_cast<size_t>(workers) * 8;
+    std::vector<std::string> fragments;
+    for (size_t windowStart = 0; windowStart < fragmentCount; windowStart += windowSize) {
+        size_t windowEnd = std::min(windowStart + windowSize, fragmentCount);
+        fragments.assign(windowEnd - windowStart, std::string());
+        
+        std::atomic<size_t> next{windowStart};
+        auto worker = [&]() {
+            size_t fragment;
+            while ((fragment = next++) < windowEnd) {
+                JsonWriter writer = json.Fragment();
+                size_t end = std::min((fragment + 1) * ElementsPerFragment, count);
+                for (size_t i = fragment * ElementsPerFragment; i < end; ++i) {
+                    writeElement(writer, i);
+                }
+                fragments[fragment - windowStart] = writer.TakeString();
+            }
+        };
+        
+        std::vector<std::thread> threads;
+        threads.reserve(workers);
+        for (unsigned i = 0; i < workers; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        for (const std::string& fragment : fragments) {
+            json.WriteFragment(fragment);
+        }
+    }
+}
+
+// Add a map's records to the binary output
+void AddCompiledMap(CompiledOutputWriter& writer, const DreamMapJson& map) {
+    auto addMapObject = [&](const MapObjectJson& object) {
+        std::vector<uint32_t> overrides;
+        for (const auto* entry : SortedEntries(object.VarOverrides)) {
+            overrides.push_back(writer.AddName(entry->first));
+            overrides.push_back(writer.AddValue(entry->second));
+        }
+        return writer.AddMapObject(object.Type, overrides);
+    };
+    
+    CompiledMap record{map.MaxX, map.MaxY, map.MaxZ, writer.CellKeyCount(), 0, writer.BlockCount(), 0};
+    // One key per key ID, so a block's cells index straight into them; the
+    // cells they name are pooled across maps
+    for (size_t id = 0; id < map.CellKeys.size(); ++id) {
+        CompiledCellKey key{writer.AddName(map.CellKeys[id]), CompiledOutputFormat::NoCell};
+        if (const CellDefinitionJson* cell = map.CellDefinitions[id].get()) {
+            int32_t turf = cell->Turf ? static_cast<int32_t>(addMapObject(*cell->Turf)) : -1;
+            int32_t area = cell->Area ? static_cast<int32_t>(addMapObject(*cell->Area)) : -1;
+            std::vector<uint32_t> objects;
+            for (const auto& obj : cell->Objects) {
+                objects.push_back(addMapObject(*obj));
+            }
+            key.Cell = writer.AddCell(turf, area, objects);
+        }
+        writer.AddCellKey(key);
+    }
+    for (const auto& block : map.Blocks) {
+        writer.AddBlock({block->X, block->Y, block->Z, block->Width, block->Height,
+                         writer.AddInts(block->Cells), static_cast<uint32_t>(block->Cells.size())});
+    }
+    record.KeyCount = writer.CellKeyCount() - record.FirstKey;
+    record.BlockCount = writer.BlockCount() - record.FirstBlock;
+    writer.AddMap(record);
+}
+
+// Every type a map places, turfs and areas included
+void AddMapTypes(const DreamMapJson& map, std::unordered_set<int>& types) {
+    for (const auto& cell : map.CellDefinitions) {
+        if (!cell) {
+            continue;
+        }
+        for (const MapObjectJson* object : {cell->Turf.get(), cell->Area.get()}) {
+            if (object) {
+                types.insert(object->Type);
+            }
+        }
+        for (const auto& object : cell->Objects) {
+            types.insert(object->Type);
+        }
+    }
+}
+
+} // namespace
+
+bool DMCompiler::VerifyBytecode() {
+    BytecodeVerifier::Tables tables;
+    tables.Strings = ObjectTree_->StringTable.Size();
+    tables.Types = ObjectTree_->AllObjects.size();
+    tables.Procs = ObjectTree_->AllProcs.size();
+    tables.Globals = ObjectTree_->Globals.size();
+    BytecodeVerifier verifier(tables, Settings_.CompactOperands ? OperandEncoding::Leb128 : OperandEncoding::Fixed);
+    
+    const auto& procs = ObjectTree_->AllProcs;
+    std::vector<std::string> problems(procs.size());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t index = next++; index < procs.size(); index = next++) {
+            if (!procs[index]->Bytecode.empty()) {
+                problems[index] = verifier.Verify(procs[index]->Bytecode, procs[index]->MaxStackSize);
+            }
+        }
+    };
+    unsigned threadCount = std::min<size_t>(std::max(1u, Settings_.CompileThreads), procs.size());
+    if (threadCount > 1) {
+        std::vector<std::thread> threads;
+        threads.reserve(threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    } else {
+        worker();
+    }
+    
+    bool verified = true;
+    for (size_t i = 0; i < procs.size(); ++i) {
+        if (problems[i].empty()) {
+            continue;
+        }
+        const DMProc& proc = *procs[i];
+        std::string path = proc.OwningObject ? proc.OwningObject->Path.ToString() : std::string();
+        ForcedError(proc.SourceLocation, "--verify: " + path + "/" + proc.Name + ": " + problems[i]);
+        verified = false;
+    }
+    return verified;
+}
+
+void DMCompiler::ReleaseTokens() {
+    if (PreprocessedTokens_.empty()) {
+        return;
+    }
+    ReleasedTokens_ += PreprocessedTokens_.size();
+    PreprocessedTokens_.Release();
+    if (Settings_.Verbose) {
+        std::cout << "  Released " << ReleasedTokens_ << " preprocessed tokens" << std::endl;
+    }
+}
+
+void DMCompiler::ReleaseProcBodies() {
+    // Not as each proc is compiled: callers inline short procs from their
+    // bodies, and EmitBytecode() compiles what DMProc::Compile left
+    for (const auto& proc : ObjectTree_->AllProcs) {
+        DMASTObjectProcDefinition* procDef = proc->AstDefinition;
+        proc->AstBody = nullptr;
+        if (procDef && (procDef->Body || procDef->HasDeferredBody())) {
+            procDef->Body.reset();  // Nodes from the AST's arena keep their chunk until ParsedAST_ goes
+            procDef->DeferredBody = {};
+            ReleasedProcBodies_++;
+        }
+    }
+    if (Settings_.Verbose && ReleasedProcBodies_ > 0) {
+        std::cout << "  Released " << ReleasedProcBodies_ << " proc bodies" << std::endl;
+    }
+}
+
+bool DMCompiler::CheckMemoryBudget() {
+    const uint64_t budget = static_cast<uint64_t>(Settings_.MaxMemoryMB) * 1024 * 1024;
+    const std::vector<CompileTimings::Phase>& phases = Timings_->GetPhases();
+    auto megabytes = [](uint64_t bytes) { return bytes / (1024.0 * 1024.0); };
+
+    std::cout << "Memory high-water marks";
+    if (budget > 0) {
+        std::cout << " (--max-memory " << Settings_.MaxMemoryMB << " MB)";
+    }
+    std::cout << ":" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    uint64_t previous = 0;
+    const CompileTimings::Phase* crossed = nullptr;
+    for (const CompileTimings::Phase& phase : phases) {
+        std::string name = std::string(2 * phase.Depth, ' ') + phase.Name;
+        std::cout << "  " << std::left << std::setw(28) << name << std::right << std::setw(10)
+                  << megabytes(phase.PeakRssBytes) << " MB";
+        if (phase.Depth == 0) {
+            uint64_t growth = phase.PeakRssBytes > previous ? phase.PeakRssBytes - previous : 0;
+            std::cout << std::showpos << std::setw(10) << megabytes(growth) << std::noshowpos << " MB";
+            previous = phase.PeakRssBytes;
+        }
+        std::cout << std::endl;
+        if (!crossed && budget > 0 && phase.PeakRssBytes > budget) {
+            crossed = &phase;
+        }
+    }
+    std::cout << "  Released " << ReleasedTokens_ << " preprocessed tokens after parsing and "
+              << ReleasedProcBodies_ << " proc bodies after code generation" << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+    if (!phases.empty() && phases.back().PeakRssBytes == 0) {
+        ForcedWarning("--max-memory cannot measure memory on this platform");
+        return true;
+    }
+    if (crossed) {
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(1) << "Peak memory of " << megabytes(phases.back().PeakRssBytes)
+                << " MB exceeds --max-memory " << Settings_.MaxMemoryMB << " MB, first passed in " << crossed->Name;
+        ForcedError(Location::Internal, message.str());
+        return false;
+    }
+    return true;
+}
+
 bool DMCompiler::OutputJson(const std::string& outputPath) {
     std::cout << "Phase 5: Writing JSON output..." << std::endl;
     
     namespace fs = std::filesystem;
     fs::path jsonPath = fs::path(outputPath).replace_extension(".json");
     
-    std::ofstream out(jsonPath);
-    if (!out) {
-        ForcedError(Location::Internal, "Failed to open output file: " + jsonPath.string());
-        return false;
+    // Compressed output is built in memory, as it is compressed in chunks at the end
+    std::ofstream file;
+    std::ostringstream memory;
+    if (!Settings_.CompressOutput) {
+        file.open(jsonPath);
+        if (!file) {
+            ForcedError(Location::Internal, "Failed to open output file: " + jsonPath.string());
+            return false;
+        }
     }
+    std::ostream& out = Settings_.CompressOutput ? static_cast<std::ostream&>(memory) : file;
     
     // Build resource ID map before writing JSON (needed for variable serialization)
     BuildResourceIdMap();
     
-    JsonWriter json;
+    // Written through to the file as it goes, rather than built up whole
+    JsonWriter json(out);
+    
+    // Each converted map is written, and handed to the binary output and the
+    // statistics, then freed before the next
+    std::unique_ptr<CompiledOutputWriter> binaryWriter;
+    if (Settings_.BinaryOutput) {
+        binaryWriter = std::make_unique<CompiledOutputWriter>();
+    }
+    std::unique_ptr<MapStats> mapStats;
+    if (Settings_.MapStats) {
+        mapStats = std::make_unique<MapStats>();
+    }
+    size_t mapCount = 0;
+    auto convertMaps = [&](const std::function<void(const DreamMapJson&)>& write) {
+        auto mapsStart = std::chrono::steady_clock::now();
+        auto timing = CompileTimings::Time(Timings_.get(), "ConvertMaps");
+        int zOffset = 1; // Start Z offset at 1
+        mapCount = ConvertMaps(IncludedMaps_, zOffset, [&](const std::string& mapPath, const DreamMapJson& map) {
+            write(map);
+            if (binaryWriter) {
+                AddCompiledMap(*binaryWriter, map);
+            }
+            if (mapStats) {
+                mapStats->Add(mapPath, map);
+            }
+        });
+        if (Settings_.Verbose) {
+            auto mapsEnd = std::chrono::steady_clock::now();
+            std::cout << "  Converted and wrote " << mapCount << " maps in "
+                      << std::chrono::duration_cast<std::chrono::milliseconds>(mapsEnd - mapsStart).count() << "ms"
+                      << std::endl;
+        }
+    };
+    
+    // Stripping has to know the types the maps place before anything names a
+    // proc ID, so then the maps are converted first and their JSON kept for later
+    std::vector<std::string> mapFragments;
+    if (Settings_.StripUnused) {
+        std::unordered_set<int> mappedTypes;
+        if (!IncludedMaps_.empty()) {
+            convertMaps([&](const DreamMapJson& map) {
+                JsonWriter fragment = json.Fragment(2);  // An element of "Maps" in the root object
+                WriteMapJson(fragment, map);
+                mapFragments.push_back(fragment.TakeString());
+                AddMapTypes(map, mappedTypes);
+            });
+        }
+        if (!StripUnusedProcs(mappedTypes, outputPath)) {
+            return false;
+        }
+    }
+    
+    // Every type's var defaults, evaluated once with equal values shared
+    DMVariableStore variableStore;
+    variableStore.Build(this, *JsonConstants_, *ObjectTree_);
+    
     json.BeginObject();
     
     // Metadata
     json.WriteKey("Metadata");
     json.BeginObject();
     json.WriteKeyValue("Version", "DMCompilerCpp-1.0");
+    if (Settings_.CompactOperands) {
+        json.WriteKeyValue("OperandEncoding", std::string("LEB128"));
+    }
     json.EndObject();
     
     // Strings table
     json.WriteKey("Strings");
     json.BeginArray();
-    for (const auto& str : ObjectTree_->StringTable) {
-        json.WriteString(str);
+    for (size_t i = 0; i < ObjectTree_->StringTable.Size(); ++i) {
+        json.WriteString(ObjectTree_->StringTable[static_cast<int>(i)]);
     }
     json.EndArray();
     
     // Resources (if any) - output in sorted order matching ResourceIdMap_
-    if (!ObjectTree_->Resources.empty()) {
-        std::vector<std::string> sortedResources(ObjectTree_->Resources.begin(), ObjectTree_->Resources.end());
-        std::sort(sortedResources.begin(), sortedResources.end());
-        
+    if (!SortedResources_.empty()) {
         json.WriteKey("Resources");
         json.BeginArray();
-        for (const auto& res : sortedResources) {
+        for (const auto& res : SortedResources_) {
             json.WriteString(res);
         }
         json.EndArray();
     }
     
-    // Global procs
+    // Global procs, in the order they were defined
     if (!ObjectTree_->GlobalProcs.empty()) {
+        std::vector<int> globalProcIds;
+        globalProcIds.reserve(ObjectTree_->GlobalProcs.size());
+        for (const auto& [name, id] : ObjectTree_->GlobalProcs) {
+            globalProcIds.push_back(id);
+        }
+        std::sort(globalProcIds.begin(), globalProcIds.end());
+        
         json.WriteKey("GlobalProcs");
         json.BeginArray();
-        for (const auto& [name, id] : ObjectTree_->GlobalProcs) {
+        for (int id : globalProcIds) {
             json.WriteInt(id);
         }
         json.EndArray();
@@ -1006,7 +2099,7 @@ bool DMCompiler::OutputJson(const std::string& outputPath) {
             // Try to serialize the default value
             if (global.Value) {
                 JsonValue jsonValue;
-                if (global.Value->TryAsJsonRepresentation(this, jsonValue)) {
+                if (global.Value->TryAsJsonRepresentation(this, *JsonConstants_, jsonValue)) {
                     json.WriteValue(jsonValue);
                 } else {
                     json.WriteNull();
@@ -1020,373 +2113,905 @@ bool DMCompiler::OutputJson(const std::string& outputPath) {
         json.EndObject();
     }
     
-    // Types
+    // Types and procs are each written on their own, so with OutputThreads
+    // they are written on several threads, then put together in ID order
     json.WriteKey("Types");
     json.BeginArray();
-    for (const auto& obj : ObjectTree_->AllObjects) {
-        json.BeginObject();
-        
-        json.WriteKeyValue("Path", obj->Path.ToString());
-        
-        if (obj->Parent) {
-            json.WriteKeyValue("Parent", obj->Parent->Id);
-        }
-        
-        if (obj->InitializationProc != -1) {
-            json.WriteKeyValue("InitProc", obj->InitializationProc);
-        }
-        
-        // Procs on this type
-        if (!obj->Procs.empty()) {
-            json.WriteKey("Procs");
+    WriteJsonElements(json, ObjectTree_->AllObjects.size(), Settings_.OutputThreads, [&](JsonWriter& writer, size_t id) {
+        WriteTypeJson(writer, *ObjectTree_->AllObjects[id], variableStore);
+    });
+    json.EndArray();
+    
+    // Procs
+    json.WriteKey("Procs");
+    json.BeginArray();
+    WriteJsonElements(json, ObjectTree_->AllProcs.size(), Settings_.OutputThreads, [&](JsonWriter& writer, size_t id) {
+        WriteProcJson(writer, *ObjectTree_->AllProcs[id]);
+    });
+    json.EndArray();
+    
+    // Maps (if any)
+    if (Settings_.StripUnused) {
+        if (!mapFragments.empty()) {
+            json.WriteKey("Maps");
             json.BeginArray();
-            for (const auto& [name, procIds] : obj->Procs) {
+            for (const std::string& fragment : mapFragments) {
+                json.WriteFragment(fragment);
+            }
+            json.EndArray();
+        }
+    } else if (!IncludedMaps_.empty()) {
+        bool mapsBegun = false;
+        convertMaps([&](const DreamMapJson& map) {
+            if (!mapsBegun) {
+                json.WriteKey("Maps");
                 json.BeginArray();
-                for (int procId : procIds) {
-                    json.WriteInt(procId);
-                }
-                json.EndArray();
+                mapsBegun = true;
             }
+            WriteMapJson(json, map);
+        });
+        if (mapsBegun) {
             json.EndArray();
         }
-        
-        // Variables (merge Variables and VariableOverrides)
-        // VariableOverrides contains values for inherited variables like icon = 'path.dmi'
-        if (!obj->Variables.empty() || !obj->VariableOverrides.empty()) {
-            json.WriteKey("Variables");
-            json.BeginObject();
-            
-            // First write base variable definitions
-            for (const auto& [name, var] : obj->Variables) {
-                json.WriteKey(name);
-                
-                // Try to serialize the default value
-                if (var.Value) {
-                    JsonValue jsonValue;
-                    if (var.Value->TryAsJsonRepresentation(this, jsonValue)) {
-                        json.WriteValue(jsonValue);
-                    } else {
-                        json.WriteNull();
-                    }
-                } else {
-                    json.WriteNull();
-                }
-            }
-            
-            // Then write variable overrides (will include icon, icon_state, etc.)
-            for (const auto& [name, var] : obj->VariableOverrides) {
-                // Skip if already written from Variables
-                if (obj->Variables.find(name) != obj->Variables.end()) {
-                    continue;
-                }
-                json.WriteKey(name);
-                
-                // Try to serialize the default value
-                if (var.Value) {
-                    JsonValue jsonValue;
-                    if (var.Value->TryAsJsonRepresentation(this, jsonValue)) {
-                        json.WriteValue(jsonValue);
-                    } else {
-                        json.WriteNull();
-                    }
-                } else {
-                    json.WriteNull();
-                }
-            }
-            
-            json.EndObject();
+    }
+    
+    // Optional errors (runtime configuration warnings in range 4000-4999)
+    json.WriteKey("OptionalErrors");
+    json.BeginObject();
+    for (const auto& [code, level] : ErrorConfig_) {
+        int codeValue = static_cast<int>(code);
+        if (codeValue >= 4000 && codeValue <= 4999) {
+            json.WriteKey(std::to_string(codeValue));
+            json.WriteInt(static_cast<int>(level));
         }
-        
-        // Const variables
-        if (!obj->ConstVariables.empty()) {
-            json.WriteKey("ConstVariables");
-            json.BeginArray();
-            for (const auto& name : obj->ConstVariables) {
-                json.WriteString(name);
-            }
-            json.EndArray();
+    }
+    json.EndObject();
+    
+    json.EndObject();
+    
+    if (!json.Flush()) {
+        ForcedError(Location::Internal, "Failed to write output file: " + jsonPath.string());
+        return false;
+    }
+    if (Settings_.CompressOutput && !WriteCompressedOutput(jsonPath.string(), memory.str())) {
+        return false;
+    }
+    
+    if (!Settings_.CompressOutput) {
+        std::cout << "Output written to: " << jsonPath.string() << std::endl;
+    }
+    if (binaryWriter && !OutputBinary(outputPath, variableStore, *binaryWriter)) {
+        return false;
+    }
+    if (Settings_.ResourceManifest && !OutputResourceManifest(outputPath)) {
+        return false;
+    }
+    if (Dependencies_) {
+        std::string depsPath = fs::path(outputPath).replace_extension(".deps.json").string();
+        if (!Dependencies_->WriteJson(depsPath)) {
+            ForcedError(Location::Internal, "Failed to write the dependency graph: " + depsPath);
+            return false;
         }
-        
-        // Tmp variables
-        if (!obj->TmpVariables.empty()) {
-            json.WriteKey("TmpVariables");
+        std::cout << "Dependency graph written to: " << depsPath << std::endl;
+    }
+    if (mapStats) {
+        std::string statsPath = fs::path(outputPath).replace_extension(".mapstats.json").string();
+        mapStats->Report(std::cout, *ObjectTree_);
+        if (!mapStats->WriteJson(statsPath, *ObjectTree_)) {
+            ForcedError(Location::Internal, "Failed to write map statistics: " + statsPath);
+            return false;
+        }
+        std::cout << "Map statistics written to: " << statsPath << std::endl;
+    }
+    if (Settings_.Verbose) {
+        std::cout << "  Types: " << ObjectTree_->AllObjects.size() << std::endl;
+        std::cout << "  Procs: " << ObjectTree_->AllProcs.size() << std::endl;
+        std::cout << "  Strings: " << ObjectTree_->StringTable.Size() << std::endl;
+        std::cout << "  Maps: " << mapCount << std::endl;
+    }
+    return true;
+}
+
+void DMCompiler::WriteTypeJson(JsonWriter& json, const DMObject& obj, const DMVariableStore& variableStore) {
+    json.BeginObject();
+    
+    json.WriteKeyValue("Path", obj.Path.ToString());
+    
+    if (obj.Parent) {
+        json.WriteKeyValue("Parent", obj.Parent->Id);
+    }
+    
+    // Pre-order index and subtree end, so the runtime can check subtypes
+    // (istype, filtered for loops) with two comparisons
+    if (obj.TreeIndex >= 0) {
+        json.WriteKey("SubtypeRange");
+        json.BeginArray();
+        json.WriteInt(obj.TreeIndex);
+        json.WriteInt(obj.SubtreeEnd);
+        json.EndArray();
+    }
+    
+    if (obj.InitializationProc != -1) {
+        json.WriteKeyValue("InitProc", obj.InitializationProc);
+    }
+    
+    // Procs on this type
+    if (!obj.Procs.empty()) {
+        json.WriteKey("Procs");
+        json.BeginArray();
+        for (const auto* entry : SortedEntries(obj.Procs)) {
             json.BeginArray();
-            for (const auto& name : obj->TmpVariables) {
-                json.WriteString(name);
+            for (int procId : entry->second) {
+                json.WriteInt(procId);
             }
             json.EndArray();
         }
-        
+        json.EndArray();
+    }
+    
+    // Variables (merge Variables and VariableOverrides)
+    // VariableOverrides contains values for inherited variables like icon = 'path.dmi'
+    DMVariableStore::TypeDefaults defaults = variableStore.GetDefaults(obj.Id);
+    if (!defaults.empty()) {
+        json.WriteKey("Variables");
+        json.BeginObject();
+        for (const DMVariableDefault& var : defaults) {
+            json.WriteKey(variableStore.GetName(var.Name));
+            json.WriteValue(variableStore.GetValue(var.Value));
+        }
         json.EndObject();
     }
-    json.EndArray();
     
-    // Procs
-    json.WriteKey("Procs");
+    // Const variables
+    if (!obj.ConstVariables.empty()) {
+        json.WriteKey("ConstVariables");
+        json.BeginArray();
+        for (const auto* name : SortedEntries(obj.ConstVariables)) {
+            json.WriteString(*name);
+        }
+        json.EndArray();
+    }
+    
+    // Tmp variables
+    if (!obj.TmpVariables.empty()) {
+        json.WriteKey("TmpVariables");
+        json.BeginArray();
+        for (const auto* name : SortedEntries(obj.TmpVariables)) {
+            json.WriteString(*name);
+        }
+        json.EndArray();
+    }
+    
+    json.EndObject();
+}
+
+void DMCompiler::WriteProcJson(JsonWriter& json, const DMProc& proc) {
+    json.BeginObject();
+    
+    json.WriteKeyValue("OwningTypeId", proc.OwningObject->Id);
+    json.WriteKeyValue("Name", proc.Name);
+    json.WriteKeyValue("Attributes", static_cast<int>(proc.Attributes));
+    
+    // Use actual max stack size calculated during bytecode emission
+    json.WriteKeyValue("MaxStackSize", proc.MaxStackSize);
+    
+    // Arguments
+    if (!proc.Parameters.empty()) {
+        json.WriteKey("Arguments");
+        json.BeginArray();
+        for (const auto& paramName : proc.Parameters) {
+            json.BeginObject();
+            json.WriteKeyValue("Name", paramName);
+            
+            uint32_t typeFlags = ParameterTypeFlags(proc, paramName);
+            json.WriteKeyValue("Type", static_cast<int>(typeFlags));
+            json.EndObject();
+        }
+        json.EndArray();
+    }
+    
+    // Source info (placeholder)
+    json.WriteKey("SourceInfo");
     json.BeginArray();
-    for (const auto& proc : ObjectTree_->AllProcs) {
+    json.BeginObject();
+    json.WriteKeyValue("Offset", 0);
+    json.WriteKeyValue("Line", proc.SourceLocation.Line);
+    json.EndObject();
+    json.EndArray();
+    
+    // Bytecode
+    if (!proc.Bytecode.empty()) {
+        json.WriteKey("Bytecode");
+        json.WriteByteArray(proc.Bytecode);
+    }
+    
+    // Verb properties
+    json.WriteKeyValue("IsVerb", proc.IsVerb);
+    if (proc.IsVerb) {
+        if (proc.VerbSource.has_value()) {
+            json.WriteKeyValue("VerbSrc", static_cast<int>(proc.VerbSource.value()));
+        }
+        if (proc.VerbName.has_value()) {
+            json.WriteKeyValue("VerbName", proc.VerbName.value());
+        }
+        if (proc.VerbCategory.has_value()) {
+            json.WriteKeyValue("VerbCategory", proc.VerbCategory.value());
+        }
+        if (proc.VerbDescription.has_value()) {
+            json.WriteKeyValue("VerbDesc", proc.VerbDescription.value());
+        }
+        json.WriteKeyValue("Invisibility", static_cast<int>(proc.Invisibility));
+    }
+    
+    json.EndObject();
+}
+
+uint32_t DMCompiler::ParameterTypeFlags(const DMProc& proc, const std::string& paramName) {
+    // Get the type information from LocalVariables
+    uint32_t typeFlags = 0; // Default to Anything (0)
+    if (const LocalVariable* param = proc.GetLocalVariable(paramName)) {
+        // If there's an explicit value type (from "as" keyword), use that
+        if (param->ExplicitValueType.has_value()) {
+            typeFlags = static_cast<uint32_t>(param->ExplicitValueType->Type);
+        }
+        // Otherwise, infer from the type path
+        else if (param->Type.has_value()) {
+            // Get the DMObject for this type path and determine its DMValueType
+            DMObject* typeObj = nullptr;
+            if (ObjectTree_->TryGetDMObject(param->Type.value(), &typeObj)) {
+                // Convert the type path to a DMValueType
+                std::string pathStr = param->Type->ToString();
+                if (pathStr == "/obj" || pathStr.rfind("/obj/", 0) == 0) {
+                    typeFlags = static_cast<uint32_t>(DMValueType::Obj);
+                } else if (pathStr == "/mob" || pathStr.rfind("/mob/", 0) == 0) {
+                    typeFlags = static_cast<uint32_t>(DMValueType::Mob);
+                } else if (pathStr == "/turf" || pathStr.rfind("/turf/", 0) == 0) {
+                    typeFlags = static_cast<uint32_t>(DMValueType::Turf);
+                } else if (pathStr == "/area" || pathStr.rfind("/area/", 0) == 0) {
+                    typeFlags = static_cast<uint32_t>(DMValueType::Area);
+                }
+                // Otherwise leave as Anything (0)
+            }
+        }
+        // If no type specified, it's Anything (0)
+    }
+    return typeFlags;
+}
+
+void DMCompiler::WriteMapJson(JsonWriter& json, const DreamMapJson& map) {
+    json.BeginObject();
+    
+    // Map dimensions
+    json.WriteKeyValue("MaxX", map.MaxX);
+    json.WriteKeyValue("MaxY", map.MaxY);
+    json.WriteKeyValue("MaxZ", map.MaxZ);
+    
+    // Cell definitions
+    json.WriteKey("CellDefinitions");
+    json.BeginObject();
+    for (size_t id = 0; id < map.CellDefinitions.size(); ++id) {
+        const auto& cell = map.CellDefinitions[id];
+        if (!cell) {
+            continue;
+        }
+        json.WriteKey(map.CellKeys[id]);
         json.BeginObject();
         
-        json.WriteKeyValue("OwningTypeId", proc->OwningObject->Id);
-        json.WriteKeyValue("Name", proc->Name);
-        json.WriteKeyValue("Attributes", static_cast<int>(proc->Attributes));
+        // Turf
+        if (cell->Turf) {
+            json.WriteKey("Turf");
+            json.BeginObject();
+            json.WriteKeyValue("Type", cell->Turf->Type);
+            if (!cell->Turf->VarOverrides.empty()) {
+                json.WriteKey("VarOverrides");
+                json.BeginObject();
+                for (const auto& [varName, varValue] : cell->Turf->VarOverrides) {
+                    json.WriteKey(varName);
+                    json.WriteValue(varValue);
+                }
+                json.EndObject();
+            }
+            json.EndObject();
+        }
         
-        // Use actual max stack size calculated during bytecode emission
-        json.WriteKeyValue("MaxStackSize", proc->MaxStackSize);
+        // Area
+        if (cell->Area) {
+            json.WriteKey("Area");
+            json.BeginObject();
+            json.WriteKeyValue("Type", cell->Area->Type);
+            if (!cell->Area->VarOverrides.empty()) {
+                json.WriteKey("VarOverrides");
+                json.BeginObject();
+                for (const auto& [varName, varValue] : cell->Area->VarOverrides) {
+                    json.WriteKey(varName);
+                    json.WriteValue(varValue);
+                }
+                json.EndObject();
+            }
+            json.EndObject();
+        }
         
-        // Arguments
-        if (!proc->Parameters.empty()) {
-            json.WriteKey("Arguments");
+        // Objects
+        if (!cell->Objects.empty()) {
+            json.WriteKey("Objects");
             json.BeginArray();
-            for (const auto& paramName : proc->Parameters) {
+            for (const auto& obj : cell->Objects) {
                 json.BeginObject();
-                json.WriteKeyValue("Name", paramName);
-                
-                // Get the type information from LocalVariables
-                uint32_t typeFlags = 0; // Default to Anything (0)
-                auto it = proc->LocalVariables.find(paramName);
-                if (it != proc->LocalVariables.end()) {
-                    const LocalVariable* param = it->second.get();
-                    
-                    // If there's an explicit value type (from "as" keyword), use that
-                    if (param->ExplicitValueType.has_value()) {
-                        typeFlags = static_cast<uint32_t>(param->ExplicitValueType->Type);
-                    }
-                    // Otherwise, infer from the type path
-                    else if (param->Type.has_value()) {
-                        // Get the DMObject for this type path and determine its DMValueType
-                        DMObject* typeObj = nullptr;
-                        if (ObjectTree_->TryGetDMObject(param->Type.value(), &typeObj)) {
-                            // Convert the type path to a DMValueType
-                            std::string pathStr = param->Type->ToString();
-                            if (pathStr == "/obj" || pathStr.rfind("/obj/", 0) == 0) {
-                                typeFlags = static_cast<uint32_t>(DMValueType::Obj);
-                            } else if (pathStr == "/mob" || pathStr.rfind("/mob/", 0) == 0) {
-                                typeFlags = static_cast<uint32_t>(DMValueType::Mob);
-                            } else if (pathStr == "/turf" || pathStr.rfind("/turf/", 0) == 0) {
-                                typeFlags = static_cast<uint32_t>(DMValueType::Turf);
-                            } else if (pathStr == "/area" || pathStr.rfind("/area/", 0) == 0) {
-                                typeFlags = static_cast<uint32_t>(DMValueType::Area);
-                            }
-                            // Otherwise leave as Anything (0)
-                        }
+                json.WriteKeyValue("Type", obj->Type);
+                if (!obj->VarOverrides.empty()) {
+                    json.WriteKey("VarOverrides");
+                    json.BeginObject();
+                    for (const auto& [varName, varValue] : obj->VarOverrides) {
+                        json.WriteKey(varName);
+                        json.WriteValue(varValue);
                     }
-                    // If no type specified, it's Anything (0)
+                    json.EndObject();
                 }
-                
-                json.WriteKeyValue("Type", static_cast<int>(typeFlags));
                 json.EndObject();
             }
             json.EndArray();
         }
         
-        // Source info (placeholder)
-        json.WriteKey("SourceInfo");
-        json.BeginArray();
-        json.BeginObject();
-        json.WriteKeyValue("Offset", 0);
-        json.WriteKeyValue("Line", proc->SourceLocation.Line);
         json.EndObject();
+    }
+    json.EndObject();
+    
+    // Map blocks
+    json.WriteKey("Blocks");
+    json.BeginArray();
+    for (const auto& block : map.Blocks) {
+        json.BeginObject();
+        json.WriteKeyValue("X", block->X);
+        json.WriteKeyValue("Y", block->Y);
+        json.WriteKeyValue("Z", block->Z);
+        json.WriteKeyValue("Width", block->Width);
+        json.WriteKeyValue("Height", block->Height);
+        
+        json.WriteKey("Cells");
+        json.BeginArray();
+        for (uint32_t cellId : block->Cells) {
+            json.WriteString(map.CellKeys[cellId]);
+        }
         json.EndArray();
         
-        // Bytecode
-        if (!proc->Bytecode.empty()) {
-            json.WriteKey("Bytecode");
-            json.WriteByteArray(proc->Bytecode);
+        json.EndObject();
+    }
+    json.EndArray();
+    
+    json.EndObject();
+}
+
+bool DMCompiler::OutputBinary(const std::string& outputPath, const DMVariableStore& variableStore,
+                              CompiledOutputWriter& writer) {
+    namespace fs = std::filesystem;
+    fs::path binaryPath = fs::path(outputPath).replace_extension(".dmbc");
+    
+    writer.SetFlags(Settings_.CompactOperands ? static_cast<uint32_t>(CompiledOutputLeb128Operands) : 0u);
+    
+    std::vector<std::string> strings;
+    strings.reserve(ObjectTree_->StringTable.Size());
+    for (size_t i = 0; i < ObjectTree_->StringTable.Size(); ++i) {
+        strings.push_back(ObjectTree_->StringTable[static_cast<int>(i)]);
+    }
+    writer.SetStrings(strings);
+    
+    // Resource IDs are their index in sorted order, as in the JSON
+    writer.SetResources(SortedResources_);
+    
+    // Var defaults are already pooled by the store, so map its IDs once
+    std::vector<uint32_t> nameIds(variableStore.NameCount());
+    for (size_t i = 0; i < nameIds.size(); ++i) {
+        nameIds[i] = writer.AddName(variableStore.GetName(static_cast<uint32_t>(i)));
+    }
+    std::vector<uint32_t> valueIds(variableStore.ValueCount());
+    for (size_t i = 0; i < valueIds.size(); ++i) {
+        valueIds[i] = writer.AddValue(variableStore.GetValue(static_cast<uint32_t>(i)));
+    }
+    
+    auto addNames = [&](const auto& names) {
+        std::vector<uint32_t> ids;
+        for (const auto* name : SortedEntries(names)) {
+            ids.push_back(writer.AddName(*name));
+        }
+        return writer.AddInts(ids);
+    };
+    
+    for (const auto& obj : ObjectTree_->AllObjects) {
+        CompiledType type{};
+        type.Path = writer.AddName(obj->Path.ToString());
+        type.Parent = obj->Parent ? obj->Parent->Id : -1;
+        type.InitProc = obj->InitializationProc;
+        type.TreeIndex = obj->TreeIndex;
+        type.SubtreeEnd = obj->SubtreeEnd;
+        
+        std::vector<uint32_t> groups;
+        for (const auto* entry : SortedEntries(obj->Procs)) {
+            std::vector<uint32_t> ids(entry->second.begin(), entry->second.end());
+            groups.push_back(writer.AddInts(ids));
+            groups.push_back(static_cast<uint32_t>(ids.size()));
         }
+        type.ProcGroups = writer.AddInts(groups);
+        type.ProcGroupCount = static_cast<uint32_t>(obj->Procs.size());
         
-        // Verb properties
-        json.WriteKeyValue("IsVerb", proc->IsVerb);
+        std::vector<uint32_t> variables;
+        for (const DMVariableDefault& var : variableStore.GetDefaults(obj->Id)) {
+            variables.push_back(nameIds[var.Name]);
+            variables.push_back(valueIds[var.Value]);
+        }
+        type.Variables = writer.AddInts(variables);
+        type.VariableCount = static_cast<uint32_t>(variables.size() / 2);
+        type.ConstVariables = addNames(obj->ConstVariables);
+        type.ConstVariableCount = static_cast<uint32_t>(obj->ConstVariables.size());
+        type.TmpVariables = addNames(obj->TmpVariables);
+        type.TmpVariableCount = static_cast<uint32_t>(obj->TmpVariables.size());
+        writer.AddType(type);
+    }
+    
+    auto optionalName = [&](const std::optional<std::string>& name) {
+        return name.has_value() ? writer.AddName(*name) : CompiledOutputFormat::NoName;
+    };
+    
+    // Hot code goes first, so the runtime touches fewer pages running it
+    if (Profile_) {
+        std::vector<const DMProc*> hot;
+        for (const auto& proc : ObjectTree_->AllProcs) {
+            if (proc->Temperature == ProcTemperature::Hot) {
+                hot.push_back(proc.get());
+            }
+        }
+        std::stable_sort(hot.begin(), hot.end(), [&](const DMProc* a, const DMProc* b) {
+            return Profile_->GetWeight(*a) > Profile_->GetWeight(*b);
+        });
+        for (const DMProc* proc : hot) {
+            writer.PlaceCode(proc->Bytecode);
+        }
+    }
+    if (Settings_.LocalityLayout) {
+        for (int id : LocalityCodeOrder()) {
+            writer.PlaceCode(ObjectTree_->AllProcs[id]->Bytecode);
+        }
+    }
+    for (const auto& proc : ObjectTree_->AllProcs) {
+        CompiledProc record{};
+        record.OwningType = proc->OwningObject->Id;
+        record.Name = writer.AddName(proc->Name);
+        record.Attributes = static_cast<uint32_t>(proc->Attributes);
+        record.MaxStackSize = static_cast<uint32_t>(proc->MaxStackSize);
+        
+        std::vector<uint32_t> arguments;
+        for (const auto& paramName : proc->Parameters) {
+            arguments.push_back(writer.AddName(paramName));
+            arguments.push_back(ParameterTypeFlags(*proc, paramName));
+        }
+        record.Arguments = writer.AddInts(arguments);
+        record.ArgumentCount = static_cast<uint32_t>(proc->Parameters.size());
+        record.Line = static_cast<uint32_t>(proc->SourceLocation.Line);
+        
+        record.VerbSource = -1;
+        record.VerbName = record.VerbCategory = record.VerbDescription = CompiledOutputFormat::NoName;
         if (proc->IsVerb) {
+            record.Flags |= CompiledProcIsVerb;
             if (proc->VerbSource.has_value()) {
-                json.WriteKeyValue("VerbSrc", static_cast<int>(proc->VerbSource.value()));
-            }
-            if (proc->VerbName.has_value()) {
-                json.WriteKeyValue("VerbName", proc->VerbName.value());
+                record.Flags |= CompiledProcHasVerbSource;
+                record.VerbSource = static_cast<int32_t>(proc->VerbSource.value());
             }
-            if (proc->VerbCategory.has_value()) {
-                json.WriteKeyValue("VerbCategory", proc->VerbCategory.value());
+            record.VerbName = optionalName(proc->VerbName);
+            record.VerbCategory = optionalName(proc->VerbCategory);
+            record.VerbDescription = optionalName(proc->VerbDescription);
+            record.Invisibility = static_cast<int32_t>(proc->Invisibility);
+            
+            CompiledVerb verb{};
+            verb.Type = record.OwningType;
+            verb.Proc = static_cast<uint32_t>(proc->Id);
+            verb.Name = proc->VerbName.has_value() ? record.VerbName : record.Name;
+            verb.Category = record.VerbCategory;
+            verb.Description = record.VerbDescription;
+            verb.Flags = record.Attributes & CompiledVerbAttributes;
+            if (proc->VerbSource.has_value()) {
+                verb.Flags |= CompiledVerbHasSource;
             }
-            if (proc->VerbDescription.has_value()) {
-                json.WriteKeyValue("VerbDesc", proc->VerbDescription.value());
+            if (!proc->VerbName.has_value()) {
+                verb.Flags |= CompiledVerbNamedByProc;
             }
-            json.WriteKeyValue("Invisibility", static_cast<int>(proc->Invisibility));
+            verb.Source = record.VerbSource;
+            verb.Invisibility = record.Invisibility;
+            writer.AddVerb(verb);
         }
-        
-        json.EndObject();
+        writer.AddProc(record, proc->Bytecode);
     }
-    json.EndArray();
     
-    // Maps (if any)
-    if (!ParsedMaps_.empty()) {
-        json.WriteKey("Maps");
-        json.BeginArray();
-        for (const auto& map : ParsedMaps_) {
-            json.BeginObject();
-            
-            // Map dimensions
-            json.WriteKeyValue("MaxX", map->MaxX);
-            json.WriteKeyValue("MaxY", map->MaxY);
-            json.WriteKeyValue("MaxZ", map->MaxZ);
-            
-            // Cell definitions
-            json.WriteKey("CellDefinitions");
-            json.BeginObject();
-            for (const auto& [name, cell] : map->CellDefinitions) {
-                json.WriteKey(name);
-                json.BeginObject();
-                
-                // Turf
-                if (cell->Turf) {
-                    json.WriteKey("Turf");
-                    json.BeginObject();
-                    json.WriteKeyValue("Type", cell->Turf->Type);
-                    if (!cell->Turf->VarOverrides.empty()) {
-                        json.WriteKey("VarOverrides");
-                        json.BeginObject();
-                        for (const auto& [varName, varValue] : cell->Turf->VarOverrides) {
-                            json.WriteKey(varName);
-                            json.WriteValue(varValue);
-                        }
-                        json.EndObject();
-                    }
-                    json.EndObject();
-                }
-                
-                // Area
-                if (cell->Area) {
-                    json.WriteKey("Area");
-                    json.BeginObject();
-                    json.WriteKeyValue("Type", cell->Area->Type);
-                    if (!cell->Area->VarOverrides.empty()) {
-                        json.WriteKey("VarOverrides");
-                        json.BeginObject();
-                        for (const auto& [varName, varValue] : cell->Area->VarOverrides) {
-                            json.WriteKey(varName);
-                            json.WriteValue(varValue);
-                        }
-                        json.EndObject();
-                    }
-                    json.EndObject();
-                }
-                
-                // Objects
-                if (!cell->Objects.empty()) {
-                    json.WriteKey("Objects");
-                    json.BeginArray();
-                    for (const auto& obj : cell->Objects) {
-                        json.BeginObject();
-                        json.WriteKeyValue("Type", obj->Type);
-                        if (!obj->VarOverrides.empty()) {
-                            json.WriteKey("VarOverrides");
-                            json.BeginObject();
-                            for (const auto& [varName, varValue] : obj->VarOverrides) {
-                                json.WriteKey(varName);
-                                json.WriteValue(varValue);
-                            }
-                            json.EndObject();
-                        }
-                        json.EndObject();
-                    }
-                    json.EndArray();
-                }
-                
-                json.EndObject();
-            }
-            json.EndObject();
-            
-            // Map blocks
-            json.WriteKey("Blocks");
-            json.BeginArray();
-            for (const auto& block : map->Blocks) {
-                json.BeginObject();
-                json.WriteKeyValue("X", block->X);
-                json.WriteKeyValue("Y", block->Y);
-                json.WriteKeyValue("Z", block->Z);
-                json.WriteKeyValue("Width", block->Width);
-                json.WriteKeyValue("Height", block->Height);
-                
-                json.WriteKey("Cells");
-                json.BeginArray();
-                for (const auto& cellRef : block->Cells) {
-                    json.WriteString(cellRef);
-                }
-                json.EndArray();
-                
-                json.EndObject();
-            }
-            json.EndArray();
-            
-            json.EndObject();
+    CompiledRoot root{};
+    std::vector<uint32_t> globalProcIds;
+    for (const auto& [name, id] : ObjectTree_->GlobalProcs) {
+        globalProcIds.push_back(static_cast<uint32_t>(id));
+    }
+    std::sort(globalProcIds.begin(), globalProcIds.end());
+    root.GlobalProcs = writer.AddInts(globalProcIds);
+    root.GlobalProcCount = static_cast<uint32_t>(globalProcIds.size());
+    
+    std::vector<uint32_t> globals;
+    for (const auto& global : ObjectTree_->Globals) {
+        JsonValue jsonValue = nullptr;
+        if (global.Value && !global.Value->TryAsJsonRepresentation(this, *JsonConstants_, jsonValue)) {
+            jsonValue = nullptr;
         }
-        json.EndArray();
+        globals.push_back(writer.AddName(global.Name));
+        globals.push_back(writer.AddValue(jsonValue));
     }
+    root.Globals = writer.AddInts(globals);
+    root.GlobalCount = static_cast<uint32_t>(ObjectTree_->Globals.size());
     
-    // Optional errors (runtime configuration warnings in range 4000-4999)
-    json.WriteKey("OptionalErrors");
-    json.BeginObject();
-    for (const auto& [code, level] : ErrorConfig_) {
-        int codeValue = static_cast<int>(code);
+    std::vector<uint32_t> optionalErrors;
+    for (const auto* entry : SortedEntries(ErrorConfig_)) {
+        int codeValue = static_cast<int>(entry->first);
         if (codeValue >= 4000 && codeValue <= 4999) {
-            json.WriteKey(std::to_string(codeValue));
-            json.WriteInt(static_cast<int>(level));
+            optionalErrors.push_back(static_cast<uint32_t>(codeValue));
+            optionalErrors.push_back(static_cast<uint32_t>(entry->second));
         }
     }
-    json.EndObject();
+    root.OptionalErrors = writer.AddInts(optionalErrors);
+    root.OptionalErrorCount = static_cast<uint32_t>(optionalErrors.size() / 2);
+    writer.SetRoot(root);
     
-    json.EndObject();
-    
-    out << json.ToString();
+    if (Settings_.Verbose) {
+        std::cout << "  Bytecode shared between identical procs: " << writer.SharedCodeBytes() << " bytes" << std::endl;
+        if (writer.CellKeyCount() > 0) {
+            std::cout << "  Map cells: " << writer.CellCount() << " distinct for " << writer.CellKeyCount() << " keys"
+                      << std::endl;
+        }
+    }
+    if (Settings_.CompressOutput) {
+        return WriteCompressedOutput(binaryPath.string(), writer.Finish());
+    }
+    std::string contents = writer.Finish();
     
-    std::cout << "Output written to: " << jsonPath.string() << std::endl;
+    // Types and procs keep their IDs between builds, so usually little moves
+    size_t bytesWritten = 0;
+    std::error_code ec;
+    if (Settings_.IncrementalOutput && fs::exists(binaryPath, ec) &&
+        PatchBinaryFile(binaryPath.string(), contents, bytesWritten)) {
+        std::cout << "Binary output patched: " << binaryPath.string() << " (" << bytesWritten << " of "
+                  << contents.size() << " bytes written)" << std::endl;
+        return true;
+    }
+    if (!WriteBinaryFileAtomic(binaryPath.string(), contents)) {
+        ForcedError(Location::Internal, "Failed to write output file: " + binaryPath.string());
+        return false;
+    }
+    std::cout << "Binary output written to: " << binaryPath.string() << std::endl;
+    return true;
+}
+
+bool DMCompiler::WriteCompressedOutput(const std::string& outputPath, const std::string& contents) {
+    std::string compressedPath = outputPath + ".dmz";
+    std::string compressed = OutputCompression::Compress(contents, Settings_.OutputThreads);
+    if (!WriteBinaryFileAtomic(compressedPath, compressed)) {
+        ForcedError(Location::Internal, "Failed to write output file: " + compressedPath);
+        return false;
+    }
+    std::cout << "Output written to: " << compressedPath << " (" << contents.size() << " bytes compressed to "
+              << compressed.size() << ")" << std::endl;
+    return true;
+}
+
+bool DMCompiler::OutputResourceManifest(const std::string& outputPath) {
+    namespace fs = std::filesystem;
+    std::string manifestPath = fs::path(outputPath).replace_extension(".resources.json").string();
+    
+    // Resources are looked for relative to the project, then in each FILE_DIR
+    std::string projectDir = fs::path(Settings_.Files[0]).parent_path().string();
+    std::vector<std::string> searchDirs{projectDir.empty() ? "." : projectDir};
+    searchDirs.insert(searchDirs.end(), ResourceDirectories_.begin(), ResourceDirectories_.end());
+    
+    size_t hashedCount = 0;
+    auto entries = ResourceManifest::Build(SortedResources_, searchDirs, manifestPath, Settings_.OutputThreads,
+                                           hashedCount, WarmState_ ? WarmState_->Resources.get() : nullptr);
+    if (!ResourceManifest::Write(manifestPath, entries)) {
+        ForcedError(Location::Internal, "Failed to write resource manifest: " + manifestPath);
+        return false;
+    }
+    std::cout << "Resource manifest written to: " << manifestPath << std::endl;
     if (Settings_.Verbose) {
-        std::cout << "  Types: " << ObjectTree_->AllObjects.size() << std::endl;
-        std::cout << "  Procs: " << ObjectTree_->AllProcs.size() << std::endl;
-        std::cout << "  Strings: " << ObjectTree_->StringTable.size() << std::endl;
-        std::cout << "  Maps: " << ParsedMaps_.size() << std::endl;
+        size_t missingCount = std::count_if(entries.begin(), entries.end(),
+                                            [](const ResourceManifest::Entry& entry) { return entry.File.empty(); });
+        std::cout << "  Resources: " << entries.size() << " (" << missingCount << " missing, " << hashedCount
+                  << " hashed)" << std::endl;
     }
     return true;
 }
 
-std::vector<std::unique_ptr<DreamMapJson>> DMCompiler::ConvertMaps(const std::vector<std::string>& mapPaths, int& zOffset) {
-    std::vector<std::unique_ptr<DreamMapJson>> maps;
+CallGraph DMCompiler::BuildCallGraph(const std::function<bool(const DMProc&)>& isRoot) const {
+    std::vector<CallGraph::Type> types;
+    types.reserve(ObjectTree_->AllObjects.size());
+    for (const auto& object : ObjectTree_->AllObjects) {
+        types.push_back({object->Path.ToString(), object->Parent ? object->Parent->Id : -1});
+    }
+    std::vector<CallGraph::Proc> procs;
+    procs.reserve(ObjectTree_->AllProcs.size());
+    for (const auto& proc : ObjectTree_->AllProcs) {
+        procs.push_back({proc->Name, proc->OwningObject ? proc->OwningObject->Id : -1, &proc->Bytecode, isRoot(*proc)});
+    }
+    OperandEncoding encoding = Settings_.CompactOperands ? OperandEncoding::Leb128 : OperandEncoding::Fixed;
+    return CallGraph(types, procs, [&](uint32_t id) {
+        return id < ObjectTree_->StringTable.Size() ? ObjectTree_->StringTable[static_cast<int>(id)] : std::string();
+    }, encoding);
+}
+
+std::vector<int> DMCompiler::LocalityCodeOrder() const {
+    // A proc called from more places than this gains little from sitting
+    // next to any one of them, so it stays with its type
+    constexpr size_t MaxPulledCallers = 4;
+    
+    const auto& procs = ObjectTree_->AllProcs;
+    CallGraph graph = BuildCallGraph([](const DMProc&) { return false; });
+    std::vector<size_t> callerCounts(procs.size());
+    for (size_t id = 0; id < procs.size(); ++id) {
+        for (int callee : graph.GetCallees(static_cast<int>(id))) {
+            if (callee != static_cast<int>(id)) {
+                ++callerCounts[callee];
+            }
+        }
+    }
+    auto pulled = [&](int id) { return callerCounts[id] > 0 && callerCounts[id] <= MaxPulledCallers; };
+    
+    // Types in tree order, so a type's subtypes (and their overrides) follow it
+    std::vector<int> byType(procs.size());
+    std::iota(byType.begin(), byType.end(), 0);
+    std::stable_sort(byType.begin(), byType.end(), [&](int a, int b) {
+        return procs[a]->OwningObject->TreeIndex < procs[b]->OwningObject->TreeIndex;
+    });
+    
+    std::vector<int> order;
+    order.reserve(procs.size());
+    std::vector<bool> placed(procs.size());
+    auto place = [&](int start) {
+        // Depth first, so a proc's first callee comes right after it
+        std::vector<int> pending{start};
+        while (!pending.empty()) {
+            int id = pending.back();
+            pending.pop_back();
+            if (placed[id]) {
+                continue;
+            }
+            placed[id] = true;
+            order.push_back(id);
+            const auto& callees = graph.GetCallees(id);
+            for (auto callee = callees.rbegin(); callee != callees.rend(); ++callee) {
+                if (!placed[*callee] && pulled(*callee)) {
+                    pending.push_back(*callee);
+                }
+            }
+        }
+    };
+    // Procs their callers pull in wait for them; those only called in a
+    // cycle of such procs start the second pass
+    for (int id : byType) {
+        if (!placed[id] && !pulled(id)) {
+            place(id);
+        }
+    }
+    for (int id : byType) {
+        if (!placed[id]) {
+            place(id);
+        }
+    }
+    return order;
+}
+
+bool DMCompiler::StripUnusedProcs(const std::unordered_set<int>& mappedTypes, const std::string& outputPath) {
+    const auto& procs = ObjectTree_->AllProcs;
+    
+    // A proc is DMStandard's if its file sits in a DMStandard directory. Tokens
+    // do not carry InDMStandard, and whatever loaded them (snapshot, cache or
+    // preprocessed output) kept the path; a user directory of that name only
+    // means more procs are kept.
+    std::vector<int8_t> standardFiles(SourceFileRegistry::Count(), -1);
+    auto inStandard = [&](const DMProc& proc) {
+        uint32_t fileId = proc.SourceLocation.FileId;
+        if (fileId >= standardFiles.size()) {
+            standardFiles.resize(SourceFileRegistry::Count(), -1);
+        }
+        if (standardFiles[fileId] < 0) {
+            namespace fs = std::filesystem;
+            fs::path dir = fs::path(SourceFileRegistry::GetPath(fileId)).lexically_normal().parent_path();
+            standardFiles[fileId] = std::any_of(dir.begin(), dir.end(), [](const fs::path& part) {
+                return part == "DMStandard";
+            });
+        }
+        return standardFiles[fileId] != 0;
+    };
+    // An override of a proc DMStandard defines, on the proc's type or any parent
+    auto isHookOverride = [&](const DMProc& proc) {
+        for (const DMObject* type = proc.OwningObject; type; type = type->Parent) {
+            auto it = type->Procs.find(proc.Name);
+            if (it != type->Procs.end() &&
+                std::any_of(it->second.begin(), it->second.end(), [&](int id) { return inStandard(*procs[id]); })) {
+                return true;
+            }
+        }
+        return false;
+    };
+    
+    // Roots are what the engine runs with nothing in the code calling it:
+    // verbs, /world's procs, DMStandard and every override of a proc it
+    // defines (the hooks), and the var initializers of every type
+    std::unordered_set<int> initializers;
+    for (const auto& object : ObjectTree_->AllObjects) {
+        initializers.insert(object->InitializationProc);
+    }
+    CallGraph graph = BuildCallGraph([&](const DMProc& proc) {
+        return proc.IsVerb || inStandard(proc) || initializers.count(proc.Id) ||
+               (proc.OwningObject && proc.OwningObject->Path.ToString() == "/world") || isHookOverride(proc);
+    });
+    OperandEncoding encoding = Settings_.CompactOperands ? OperandEncoding::Leb128 : OperandEncoding::Fixed;
+    
+    // A call in bytes the decoder cannot follow would be missed, and its callee dropped
+    if (!graph.GetUnreadable().empty()) {
+        ForcedWarning("--strip-unused: cannot follow the calls in " + graph.GetLabel(graph.GetUnreadable().front()) +
+                      ", so no procs were stripped");
+        return true;
+    }
     
-    for (const auto& mapPath : mapPaths) {
-        CheckProgress("Converting Maps");
+    // A type on a map is created by the engine, running its New
+    std::vector<int> roots = graph.GetRoots();
+    for (int typeId : mappedTypes) {
+        auto constructors = graph.Constructors(typeId);
+        roots.insert(roots.end(), constructors.begin(), constructors.end());
+    }
+    std::vector<bool> reachable = graph.FindReachable(roots);
+    std::vector<std::pair<int, std::string>> stripped;
+    for (size_t id = 0; id < reachable.size(); ++id) {
+        if (!reachable[id]) {
+            stripped.emplace_back(static_cast<int>(id), graph.GetLabel(static_cast<int>(id)));
+        }
+    }
+    size_t procCount = procs.size();
+    auto removed = ObjectTree_->RemoveProcs(reachable, encoding);
+    
+    size_t strippedBytes = 0;
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKeyValue("KeptProcs", static_cast<int>(ObjectTree_->AllProcs.size()));
+    json.WriteKey("StrippedProcs");
+    json.BeginArray();
+    for (size_t i = 0; i < stripped.size(); ++i) {
+        strippedBytes += removed[i]->Bytecode.size();
+        json.BeginObject();
+        json.WriteKeyValue("Id", stripped[i].first);  // Before renumbering
+        json.WriteKeyValue("Path", stripped[i].second);
+        json.WriteKeyValue("Bytes", static_cast<int>(removed[i]->Bytecode.size()));
+        json.EndObject();
         if (Settings_.Verbose) {
-            std::cout << "  Converting map: " << mapPath << std::endl;
+            std::cout << "  Stripped: " << stripped[i].second << std::endl;
         }
-        
-        // Read the map file
-        std::ifstream file(mapPath);
-        if (!file.is_open()) {
-            ForcedError(Location::Internal, "Failed to open map file: " + mapPath);
-            continue;
+    }
+    json.EndArray();
+    json.EndObject();
+    
+    namespace fs = std::filesystem;
+    std::string reportPath = fs::path(outputPath).replace_extension(".stripped.json").string();
+    if (!WriteBinaryFileAtomic(reportPath, json.ToString())) {
+        ForcedError(Location::Internal, "Failed to write stripped proc report: " + reportPath);
+        return false;
+    }
+    std::cout << "Stripped " << stripped.size() << " of " << procCount << " procs (" << strippedBytes
+              << " bytes of bytecode), listed in: " << reportPath << std::endl;
+    return true;
+}
+
+size_t DMCompiler::ConvertMaps(const std::vector<std::string>& mapPaths, int& zOffset,
+                               const std::function<void(const std::string&, const DreamMapJson&)>& consume) {
+    size_t converted = 0;
+    size_t cacheHitCount = 0;
+    std::unique_ptr<MapCache> cache;
+    if (!Settings_.MapCacheDir.empty()) {
+        cache = std::make_unique<MapCache>(Settings_.MapCacheDir);
+    }
+    
+    // Maps are converted a window at a time, each one freed once consumed, so
+    // no more than a window's worth is held at once
+    size_t windowSize = std::max(Settings_.ParseThreads, 1u);
+    for (size_t windowStart = 0; windowStart < mapPaths.size(); windowStart += windowSize) {
+        size_t windowEnd = std::min(windowStart + windowSize, mapPaths.size());
+        size_t windowCount = windowEnd - windowStart;
+        
+        // Each map is scanned from z = 0 on its own, several at once. The scanners
+        // are made here so file IDs are registered in include order.
+        std::vector<std::shared_ptr<const SourceBuffer>> contents(windowCount);
+        std::vector<std::unique_ptr<DMMScanner>> scanners(windowCount);
+        std::vector<std::unique_ptr<DreamMapJson>> scanned(windowCount);
+        std::vector<std::vector<std::string>> cachedWarnings(windowCount);
+        std::vector<char> cacheHits(windowCount, 0);
+        for (size_t i = 0; i < windowCount; ++i) {
+            // Map the file into memory
+            contents[i] = SourceBuffer::FromFile(mapPaths[windowStart + i]);
+            if (contents[i]) {
+                scanners[i] = std::make_unique<DMMScanner>(this, mapPaths[windowStart + i], contents[i]->View(), 0);
+            }
         }
         
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        std::string content = buffer.str();
-        
-        // Create a lexer for the map file
-        DMLexer lexer(mapPath, content);
-        
-        // Create the DMM parser
-        DMMParser parser(this, &lexer, zOffset);
-        
-        // Parse the map
-        auto map = parser.ParseMap();
-        
-        if (map) {
-            // Update z-offset for next map
-            zOffset = std::max(zOffset + 1, map->MaxZ);
-            maps.push_back(std::move(map));
+        std::atomic<size_t> next{0};
+        auto worker = [&]() {
+            for (size_t index = next++; index < windowCount; index = next++) {
+                if (!scanners[index]) {
+                    continue;
+                }
+                const std::string& mapPath = mapPaths[windowStart + index];
+                uint64_t hash = cache ? MapCache::HashMap(mapPath, contents[index]->View()) : 0;
+                if (cache && (scanned[index] = cache->Load(hash, *ObjectTree_, cachedWarnings[index]))) {
+                    cacheHits[index] = 1;
+                    continue;
+                }
+                scanned[index] = scanners[index]->ScanMap();
+                if (cache && scanned[index]) {
+                    cache->Store(hash, *scanned[index], scanners[index]->GetReferencedTypes(),
+                                 scanners[index]->GetWarnings(), *ObjectTree_);
+                }
+            }
+        };
+        if (windowCount > 1) {
+            std::vector<std::thread> threads;
+            threads.reserve(windowCount);
+            for (size_t i = 0; i < windowCount; ++i) {
+                threads.emplace_back(worker);
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
         } else {
-            ForcedError(Location::Internal, "Failed to parse map: " + mapPath);
+            worker();
+        }
+        cacheHitCount += std::count(cacheHits.begin(), cacheHits.end(), 1);
+        
+        // Z-offsets, diagnostics and the DM parser for what the scanner could not
+        // read all go in include order, so the result is the same either way
+        for (size_t i = 0; i < windowCount; ++i) {
+            const std::string& mapPath = mapPaths[windowStart + i];
+            CheckProgress("Converting Maps");
+            if (Settings_.Verbose) {
+                std::cout << "  Converting map: " << mapPath << std::endl;
+            }
+            
+            if (!contents[i]) {
+                ForcedError(Location::Internal, "Failed to open map file: " + mapPath);
+                continue;
+            }
+            
+            // Scan the usual layout directly, and lex and parse anything else
+            auto map = std::move(scanned[i]);
+            if (map) {
+                if (cacheHits[i]) {
+                    for (const auto& warning : cachedWarnings[i]) {
+                        ForcedWarning(warning);
+                    }
+                } else {
+                    scanners[i]->ReportWarnings();
+                }
+                map->OffsetZ(zOffset);
+            } else {
+                if (Settings_.Verbose) {
+                    std::cout << "  Parsing map with the DM parser: " << mapPath << std::endl;
+                }
+                DMLexer lexer(mapPath, contents[i]);
+                DMMParser parser(this, &lexer, zOffset);
+                map = parser.ParseMap();
+            }
+            
+            if (map) {
+                // Update z-offset for next map
+                zOffset = std::max(zOffset + 1, map->MaxZ);
+                consume(mapPath, *map);
+                ++converted;
+            } else {
+                ForcedError(Location::Internal, "Failed to parse map: " + mapPath);
+            }
         }
     }
+    if (cache && Settings_.Verbose) {
+        std::cout << "  Map cache: loaded " << cacheHitCount << " of " << mapPaths.size() << " maps" << std::endl;
+    }
     
-    return maps;
+    return converted;
 }
 
 bool DMCompiler::InitializeDMStandard() {
@@ -1404,161 +3029,77 @@ bool DMCompiler::InitializeDMStandard() {
     
     namespace fs = std::filesystem;
     
-    // Get the directory where the compiler executable is located
-    fs::path compilerDir;
-#ifdef _WIN32
-    // Windows implementation
-    wchar_t exePath[MAX_PATH];
-    DWORD length = GetModuleFileNameW(NULL, exePath, MAX_PATH);
-    if (length == 0 || length == MAX_PATH) {
-        ForcedWarning("Failed to get executable path for DMStandard initialization");
-        return true;  // Non-fatal, continue compilation
+    std::vector<std::pair<std::string, int>> constants;
+    if (!StandardConstants_.empty()) {
+        // Loaded along with preprocessed output
+        constants = StandardConstants_;
+    } else if (StandardSnapshot_ && !StandardSnapshot_->Constants.empty()) {
+        // Captured when the snapshot was built; no need to touch Defines.dm
+        constants = StandardSnapshot_->Constants;
     } else {
-        // Convert wide string to regular string
-        std::wstring ws(exePath);
-        std::string str(ws.begin(), ws.end());
-        compilerDir = fs::path(str).parent_path();
-    }
+        // Get the directory where the compiler executable is located
+        fs::path compilerDir;
+#ifdef _WIN32
+        // Windows implementation
+        wchar_t exePath[MAX_PATH];
+        DWORD length = GetModuleFileNameW(NULL, exePath, MAX_PATH);
+        if (length == 0 || length == MAX_PATH) {
+            ForcedWarning("Failed to get executable path for DMStandard initialization");
+            return true;  // Non-fatal, continue compilation
+        } else {
+            // Convert wide string to regular string
+            std::wstring ws(exePath);
+            std::string str(ws.begin(), ws.end());
+            compilerDir = fs::path(str).parent_path();
+        }
 #elif defined(__linux__) || defined(__APPLE__)
-    // Unix-like systems
-    char exePath[PATH_MAX];
+        // Unix-like systems
+        char exePath[PATH_MAX];
 #ifdef __linux__
-    ssize_t length = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
+        ssize_t length = readlink("/proc/self/exe", exePath, sizeof(exePath) - 1);
 #elif defined(__APPLE__)
-    uint32_t bufsize = PATH_MAX;
-    int length = _NSGetExecutablePath(exePath, &bufsize);
-    if (length != 0) length = -1;
-    else length = strlen(exePath);
+        uint32_t bufsize = PATH_MAX;
+        int length = _NSGetExecutablePath(exePath, &bufsize);
+        if (length != 0) length = -1;
+        else length = strlen(exePath);
 #endif
-    if (length == -1) {
-        ForcedWarning("Failed to get executable path for DMStandard initialization");
-        return true;  // Non-fatal, continue compilation
-    } else {
-        exePath[length] = '\0';
-        compilerDir = fs::path(exePath).parent_path();
-    }
+        if (length == -1) {
+            ForcedWarning("Failed to get executable path for DMStandard initialization");
+            return true;  // Non-fatal, continue compilation
+        } else {
+            exePath[length] = '\0';
+            compilerDir = fs::path(exePath).parent_path();
+        }
 #else
-    // Fallback for other platforms
-    ForcedWarning("Executable path detection not implemented for this platform");
-    return true;  // Non-fatal, continue compilation
+        // Fallback for other platforms
+        ForcedWarning("Executable path detection not implemented for this platform");
+        return true;  // Non-fatal, continue compilation
 #endif
     
-    fs::path dmStandardDir = compilerDir / "DMStandard";
-    fs::path definesFile = dmStandardDir / "Defines.dm";
+        fs::path dmStandardDir = compilerDir / "DMStandard";
+        fs::path definesFile = dmStandardDir / "Defines.dm";
     
-    if (!fs::exists(definesFile)) {
-        ForcedWarning("DMStandard/Defines.dm not found at: " + definesFile.string());
-        return true;  // Non-fatal, continue compilation
-    }
+        if (!fs::exists(definesFile)) {
+            ForcedWarning("DMStandard/Defines.dm not found at: " + definesFile.string());
+            return true;  // Non-fatal, continue compilation
+        }
     
-    // Read the Defines.dm file
-    std::ifstream file(definesFile);
-    if (!file.is_open()) {
-        ForcedWarning("Failed to open DMStandard/Defines.dm");
-        return true;  // Non-fatal, continue compilation
+        // Read the Defines.dm file
+        if (!ParseStandardConstants(definesFile.string(), constants)) {
+            ForcedWarning("Failed to open DMStandard/Defines.dm");
+            return true;  // Non-fatal, continue compilation
+        }
     }
     
-    std::string line;
-    int constantsAdded = 0;
+    StandardConstants_ = constants;
     
-    // Parse #define directives and extract numeric constants
-    while (std::getline(file, line)) {
-        // Trim leading whitespace
-        size_t start = line.find_first_not_of(" \t");
-        if (start == std::string::npos) continue;
-        
-        // Check if line starts with #define
-        if (line.substr(start, 7) != "#define") continue;
-        
-        // Extract the macro name and value
-        size_t nameStart = start + 7;
-        nameStart = line.find_first_not_of(" \t", nameStart);
-        if (nameStart == std::string::npos) continue;
-        
-        size_t nameEnd = line.find_first_of(" \t", nameStart);
-        if (nameEnd == std::string::npos) continue;
-        
-        std::string name = line.substr(nameStart, nameEnd - nameStart);
-        
-        // Extract the value
-        size_t valueStart = line.find_first_not_of(" \t", nameEnd);
-        if (valueStart == std::string::npos) continue;
-        
-        // Find the end of the value (before any comment)
-        size_t valueEnd = line.find("//", valueStart);
-        if (valueEnd == std::string::npos) {
-            valueEnd = line.length();
-        }
-        
-        // Trim trailing whitespace from value
-        while (valueEnd > valueStart && (line[valueEnd - 1] == ' ' || line[valueEnd - 1] == '\t')) {
-            valueEnd--;
-        }
-        
-        std::string valueStr = line.substr(valueStart, valueEnd - valueStart);
+    int constantsAdded = 0;
+    for (const auto& [name, value] : constants) {
+        ObjectTree_->AddGlobalConstant(name, value);
+        constantsAdded++;
         
-        // Try to parse as integer
-        try {
-            // Handle simple numeric values
-            if (valueStr.find_first_not_of("0123456789-") == std::string::npos) {
-                int value = std::stoi(valueStr);
-                ObjectTree_->AddGlobalConstant(name, value);
-                constantsAdded++;
-                
-                if (Settings_.Verbose) {
-                    std::cout << "  Added constant: " << name << " = " << value << std::endl;
-                }
-            }
-            // Handle hex values (0x...)
-            else if (valueStr.substr(0, 2) == "0x" || valueStr.substr(0, 2) == "0X") {
-                int value = std::stoi(valueStr, nullptr, 16);
-                ObjectTree_->AddGlobalConstant(name, value);
-                constantsAdded++;
-                
-                if (Settings_.Verbose) {
-                    std::cout << "  Added constant: " << name << " = " << value << std::endl;
-                }
-            }
-            // Handle expressions like "NORTH | EAST" (5)
-            else if (name == "NORTHEAST") {
-                ObjectTree_->AddGlobalConstant(name, 5);  // NORTH | EAST
-                constantsAdded++;
-            }
-            else if (name == "SOUTHEAST") {
-                ObjectTree_->AddGlobalConstant(name, 6);  // SOUTH | EAST
-                constantsAdded++;
-            }
-            else if (name == "SOUTHWEST") {
-                ObjectTree_->AddGlobalConstant(name, 10);  // SOUTH | WEST
-                constantsAdded++;
-            }
-            else if (name == "NORTHWEST") {
-                ObjectTree_->AddGlobalConstant(name, 9);  // NORTH | WEST
-                constantsAdded++;
-            }
-            // Handle bit shift expressions like "(1<<0)"
-            else if (valueStr.find("<<") != std::string::npos) {
-                // Parse simple bit shift: (1<<N)
-                size_t shiftPos = valueStr.find("<<");
-                size_t numStart = valueStr.find_first_of("0123456789", shiftPos + 2);
-                if (numStart != std::string::npos) {
-                    size_t numEnd = valueStr.find_first_not_of("0123456789", numStart);
-                    if (numEnd == std::string::npos) numEnd = valueStr.length();
-                    
-                    int shiftAmount = std::stoi(valueStr.substr(numStart, numEnd - numStart));
-                    int value = 1 << shiftAmount;
-                    ObjectTree_->AddGlobalConstant(name, value);
-                    constantsAdded++;
-                    
-                    if (Settings_.Verbose) {
-                        std::cout << "  Added constant: " << name << " = " << value << std::endl;
-                    }
-                }
-            }
-            // Skip string constants and complex expressions
-        } catch (const std::exception&) {
-            // Skip constants that can't be parsed as integers
-            continue;
+        if (Settings_.Verbose) {
+            std::cout << "  Added constant: " << name << " = " << value << std::endl;
         }
     }
     
@@ -1580,6 +3121,7 @@ bool DMCompiler::InitializeDMStandard() {
 }
 
 void DMCompiler::CheckProgress(const std::string& phase) {
+    std::lock_guard<std::mutex> lock(DiagnosticsMutex_);
     auto now = std::chrono::steady_clock::now();
     auto totalDuration = std::chrono::duration_cast<std::chrono::seconds>(now - StartTime_).count();
     
@@ -1,11 +1,21 @@
 #include "DMDisassembler.h"
 #include "DreamProcOpcode.h"
 #include "OpcodeDefinitions.h"
+#include "DMReference.h"
+#include "CompiledOutput.h"
+#include "OutputCompression.h"
+#include "SourceBuffer.h"
 #include <fstream>
 #include <sstream>
 #include <algorithm>
+#include <iterator>
 #include <cctype>
+#include <cstring>
 #include <iomanip>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <unordered_set>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -171,119 +181,413 @@ std::string GetOpcodeName(DreamProcOpcode opcode) {
 
 DMDisassembler::DMDisassembler()
     : loaded_(false)
+    , operandEncoding_(OperandEncoding::Fixed)
+    , stringUsersBuilt_(false)
 {
 }
 
 DMDisassembler::~DMDisassembler() = default;
 
 bool DMDisassembler::LoadJson(const std::string& jsonPath) {
-    // Read file content
-    std::ifstream file(jsonPath);
-    if (!file.is_open()) {
+    // Parsed straight from the mapped file
+    auto buffer = SourceBuffer::FromFile(jsonPath);
+    if (!buffer || !ParseJson(buffer->View())) {
         return false;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
-    file.close();
+    // Build lookup tables
+    BuildLookupTables();
+    
+    filePath_ = jsonPath;
+    loaded_ = true;
+    return true;
+}
+
+bool DMDisassembler::LoadBinary(const std::string& binaryPath) {
+    return LoadFile(binaryPath, false);
+}
+
+bool DMDisassembler::Load(const std::string& path) {
+    return LoadFile(path, true);
+}
+
+bool DMDisassembler::LoadFile(const std::string& path, bool allowJson) {
+    source_ = SourceBuffer::FromFile(path);
+    if (!source_) {
+        return false;
+    }
+    std::string_view content = source_->View();
+    
+    // Compressed output (--compress-output) holds either form whole
+    if (allowJson && OutputCompression::IsCompressed(content)) {
+        if (!OutputCompression::Decompress(content, decompressed_)) {
+            std::cerr << "Decompression Error: malformed compressed output" << std::endl;
+            return false;
+        }
+        source_.reset();
+        content = decompressed_;
+    }
     
-    // Parse the JSON content
-    if (!ParseJson(content)) {
+    bool isBinary = !allowJson || (content.size() >= sizeof(CompiledOutputFormat::Magic) &&
+                    std::equal(CompiledOutputFormat::Magic, std::end(CompiledOutputFormat::Magic), content.begin()));
+    if (!(isBinary ? ParseBinary(content) : ParseJson(content))) {
         return false;
     }
+    if (!isBinary) {
+        // Nothing points into a JSON file once it is read
+        source_.reset();
+        decompressed_ = std::string();
+    }
     
-    // Build lookup tables
     BuildLookupTables();
     
-    filePath_ = jsonPath;
+    filePath_ = path;
     loaded_ = true;
     return true;
 }
 
-bool DMDisassembler::ParseJson(const std::string& content) {
-    try {
-        auto root = json::parse(content);
-        
-        // 1. Strings
-        if (root.contains("Strings")) {
-            for (const auto& str : root["Strings"]) {
-                stringTable_.push_back(str.get<std::string>());
+bool DMDisassembler::ParseBinary(std::string_view content) {
+    CompiledOutputView view;
+    if (!view.Open(content)) {
+        std::cerr << "Binary Parse Error: not a compiled output file of version "
+                  << CompiledOutputFormat::Version << std::endl;
+        return false;
+    }
+    
+    if (view.Flags() & CompiledOutputLeb128Operands) {
+        operandEncoding_ = OperandEncoding::Leb128;
+    }
+    
+    for (size_t i = 0; i < view.StringCount(); ++i) {
+        stringTable_.emplace_back(view.GetString(i));
+    }
+    
+    for (size_t i = 0; i < view.TypeCount(); ++i) {
+        CompiledType record = view.GetType(i);
+        DisasmType type;
+        type.Id = static_cast<int>(i);
+        type.Path = std::string(view.GetName(record.Path));
+        type.ParentId = record.Parent;
+        for (uint32_t var = 0; var < record.VariableCount; ++var) {
+            type.Variables.emplace_back(view.GetName(view.GetInt(record.Variables + var * 2)));
+        }
+        for (uint32_t group = 0; group < record.ProcGroupCount; ++group) {
+            uint32_t procs = view.GetInt(record.ProcGroups + group * 2);
+            uint32_t count = view.GetInt(record.ProcGroups + group * 2 + 1);
+            for (uint32_t proc = 0; proc < count; ++proc) {
+                type.ProcIds.push_back(static_cast<int>(view.GetInt(procs + proc)));
             }
         }
-        
-        // 2. Types
-        if (root.contains("Types")) {
-            int typeId = 0;
-            for (const auto& typeJson : root["Types"]) {
-                DisasmType type;
-                type.Id = typeId++;
-                type.Path = typeJson.value("Path", "");
-                if (typeJson.contains("Parent")) {
-                    type.ParentId = typeJson["Parent"].get<int>();
+        types_.push_back(type);
+    }
+    
+    for (size_t i = 0; i < view.ProcCount(); ++i) {
+        CompiledProc record = view.GetProc(i);
+        DisasmProc proc;
+        proc.Id = static_cast<int>(i);
+        proc.Name = std::string(view.GetName(record.Name));
+        proc.OwnerTypeId = record.OwningType;
+        if (proc.OwnerTypeId >= 0 && proc.OwnerTypeId < static_cast<int>(types_.size())) {
+            proc.OwnerPath = types_[proc.OwnerTypeId].Path;
+        }
+        for (uint32_t arg = 0; arg < record.ArgumentCount; ++arg) {
+            proc.Parameters.emplace_back(view.GetName(view.GetInt(record.Arguments + arg * 2)));
+        }
+        pendingBytecode_.push_back(view.GetBytecode(record));
+        proc.MaxStackSize = static_cast<int>(record.MaxStackSize);
+        proc.IsVerb = (record.Flags & CompiledProcIsVerb) != 0;
+        procs_.push_back(proc);
+    }
+    
+    return true;
+}
+
+namespace {
+
+/// <summary>
+/// SAX handler filling the disassembler's tables as the JSON output is read,
+/// so no document is built: a proc's bytecode goes straight into its byte
+/// vector rather than becoming one JSON node per byte.
+///
+/// Each open object or array gets a role from its parent's role and, in an
+/// object, the key it is under; anything the disassembler does not read
+/// (var values, maps, ...) is Ignored, along with everything inside it.
+/// </summary>
+class DisassemblyJsonReader {
+public:
+    DisassemblyJsonReader(std::vector<DisasmType>& types, std::vector<DisasmProc>& procs,
+                          std::vector<std::string>& strings, OperandEncoding& operandEncoding)
+        : types_(types), procs_(procs), strings_(strings), operandEncoding_(operandEncoding) {}
+
+    bool null() { return true; }
+    bool boolean(bool value) {
+        if (Top() == Role::Proc && key_ == "IsVerb") {
+            procs_.back().IsVerb = value;
+        }
+        return true;
+    }
+    bool number_integer(json::number_integer_t value) { return Integer(value); }
+    bool number_unsigned(json::number_unsigned_t value) { return Integer(static_cast<int64_t>(value)); }
+    bool number_float(json::number_float_t, const json::string_t&) { return true; }
+    bool binary(json::binary_t&) { return true; }
+
+    bool string(json::string_t& value) {
+        switch (Top()) {
+            case Role::Metadata:
+                if (key_ == "OperandEncoding" && value == "LEB128") {
+                    operandEncoding_ = OperandEncoding::Leb128;
                 }
-                
-                if (typeJson.contains("Variables")) {
-                    for (auto& [key, val] : typeJson["Variables"].items()) {
-                        type.Variables.push_back(key);
-                    }
+                break;
+            case Role::Strings:
+                strings_.push_back(std::move(value));
+                break;
+            case Role::Type:
+                if (key_ == "Path") {
+                    types_.back().Path = std::move(value);
                 }
-                
-                if (typeJson.contains("Procs")) {
-                    for (const auto& procGroup : typeJson["Procs"]) {
-                        for (const auto& procId : procGroup) {
-                            type.ProcIds.push_back(procId.get<int>());
-                        }
-                    }
+                break;
+            case Role::Proc:
+                if (key_ == "Name") {
+                    procs_.back().Name = std::move(value);
                 }
-                
-                types_.push_back(type);
-            }
-        }
-        
-        // 3. Procs
-        if (root.contains("Procs")) {
-            int procId = 0;
-            for (const auto& procJson : root["Procs"]) {
-                DisasmProc proc;
-                proc.Id = procId++;
-                proc.Name = procJson.value("Name", "");
-                proc.OwnerTypeId = procJson.value("OwningTypeId", -1);
-                
-                // Resolve OwnerPath
-                if (proc.OwnerTypeId >= 0 && proc.OwnerTypeId < static_cast<int>(types_.size())) {
-                    proc.OwnerPath = types_[proc.OwnerTypeId].Path;
+                break;
+            case Role::ProcArgument:
+                if (key_ == "Name") {
+                    procs_.back().Parameters.back() = std::move(value);
                 }
-                
-                if (procJson.contains("Arguments")) {
-                    for (const auto& arg : procJson["Arguments"]) {
-                        proc.Parameters.push_back(arg.value("Name", ""));
-                    }
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+    bool start_object(std::size_t) {
+        Role role = Role::Ignored;
+        switch (Top()) {
+            case Role::None: role = Role::Root; break;
+            case Role::Root: role = key_ == "Metadata" ? Role::Metadata : Role::Ignored; break;
+            case Role::Types: role = Role::Type; break;
+            case Role::Type: role = key_ == "Variables" ? Role::TypeVariables : Role::Ignored; break;
+            case Role::Procs: role = Role::Proc; break;
+            case Role::ProcArguments: role = Role::ProcArgument; break;
+            default: break;
+        }
+        if (role == Role::Type) {
+            int id = static_cast<int>(types_.size());
+            types_.emplace_back().Id = id;
+        } else if (role == Role::Proc) {
+            int id = static_cast<int>(procs_.size());
+            procs_.emplace_back().Id = id;
+        } else if (role == Role::ProcArgument) {
+            procs_.back().Parameters.emplace_back();
+        }
+        roles_.push_back(role);
+        return true;
+    }
+
+    bool key(json::string_t& name) {
+        if (Top() == Role::TypeVariables) {
+            types_.back().Variables.push_back(name);
+        }
+        key_ = std::move(name);
+        return true;
+    }
+
+    bool end_object() {
+        roles_.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t) {
+        Role role = Role::Ignored;
+        switch (Top()) {
+            case Role::Root:
+                role = key_ == "Strings" ? Role::Strings : key_ == "Types" ? Role::Types
+                     : key_ == "Procs" ? Role::Procs : Role::Ignored;
+                break;
+            case Role::Type: role = key_ == "Procs" ? Role::TypeProcs : Role::Ignored; break;
+            case Role::TypeProcs: role = Role::TypeProcGroup; break;
+            case Role::Proc:
+                role = key_ == "Arguments" ? Role::ProcArguments : key_ == "Bytecode" ? Role::ProcBytecode
+                     : Role::Ignored;
+                break;
+            default: break;
+        }
+        roles_.push_back(role);
+        return true;
+    }
+
+    bool end_array() {
+        roles_.pop_back();
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& error) {
+        error_ = error.what();
+        return false;
+    }
+
+    const std::string& GetError() const { return error_; }
+
+private:
+    enum class Role : uint8_t {
+        None, Root, Metadata, Strings,
+        Types, Type, TypeVariables, TypeProcs, TypeProcGroup,
+        Procs, Proc, ProcArguments, ProcArgument, ProcBytecode,
+        Ignored
+    };
+
+    Role Top() const { return roles_.empty() ? Role::None : roles_.back(); }
+
+    bool Integer(int64_t value) {
+        switch (Top()) {
+            case Role::Type:
+                if (key_ == "Parent") {
+                    types_.back().ParentId = static_cast<int>(value);
                 }
-                
-                if (procJson.contains("Bytecode")) {
-                    proc.Bytecode = procJson["Bytecode"].get<std::vector<uint8_t>>();
+                break;
+            case Role::TypeProcGroup:
+                types_.back().ProcIds.push_back(static_cast<int>(value));
+                break;
+            case Role::Proc:
+                if (key_ == "OwningTypeId") {
+                    procs_.back().OwnerTypeId = static_cast<int>(value);
+                } else if (key_ == "MaxStackSize") {
+                    procs_.back().MaxStackSize = static_cast<int>(value);
                 }
-                
-                proc.IsVerb = procJson.value("IsVerb", false);
-                
-                procs_.push_back(proc);
-            }
+                break;
+            case Role::ProcBytecode:
+                procs_.back().Bytecode.push_back(static_cast<uint8_t>(value));
+                break;
+            default:
+                break;
         }
-        
         return true;
-    } catch (const std::exception& e) {
-        std::cerr << "JSON Parse Error: " << e.what() << std::endl;
+    }
+
+    std::vector<DisasmType>& types_;
+    std::vector<DisasmProc>& procs_;
+    std::vector<std::string>& strings_;
+    OperandEncoding& operandEncoding_;
+    std::vector<Role> roles_;
+    std::string key_;  // The last key read; scalars and containers take their meaning from it
+    std::string error_;
+};
+
+} // namespace
+
+bool DMDisassembler::ParseJson(std::string_view content) {
+    DisassemblyJsonReader reader(types_, procs_, stringTable_, operandEncoding_);
+    if (!json::sax_parse(content.begin(), content.end(), &reader)) {
+        std::cerr << "JSON Parse Error: " << reader.GetError() << std::endl;
         return false;
     }
+    
+    // Listed by name, as a document's object keys would be
+    for (auto& type : types_) {
+        std::sort(type.Variables.begin(), type.Variables.end());
+        type.Variables.erase(std::unique(type.Variables.begin(), type.Variables.end()), type.Variables.end());
+    }
+    
+    // Types may come after procs, so owners are resolved once both are read
+    for (auto& proc : procs_) {
+        if (proc.OwnerTypeId >= 0 && proc.OwnerTypeId < static_cast<int>(types_.size())) {
+            proc.OwnerPath = types_[proc.OwnerTypeId].Path;
+        }
+    }
+    return true;
 }
 
+namespace {
+
+std::string ToLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+// The three characters of text from offset, as a trigrams_ key
+uint32_t Trigram(const std::string& text, size_t offset) {
+    return static_cast<uint32_t>(static_cast<unsigned char>(text[offset])) << 16 |
+           static_cast<uint32_t>(static_cast<unsigned char>(text[offset + 1])) << 8 |
+           static_cast<unsigned char>(text[offset + 2]);
+}
+
+// References whose operand is a string table index
+bool IsNameReference(uint8_t type) {
+    return type == static_cast<uint8_t>(DMReference::Type::Field) ||
+           type == static_cast<uint8_t>(DMReference::Type::SrcField) ||
+           type == static_cast<uint8_t>(DMReference::Type::SrcProc);
+}
+
+} // namespace
+
 void DMDisassembler::BuildLookupTables() {
     // Build path to type ID lookup
     pathToTypeId_.clear();
     for (const auto& type : types_) {
         pathToTypeId_[type.Path] = type.Id;
     }
+    
+    // Build the search index
+    searchText_.clear();
+    trigrams_.clear();
+    searchText_.reserve(types_.size() + procs_.size() + stringTable_.size());
+    auto addText = [&](const std::string& text) {
+        uint32_t entry = static_cast<uint32_t>(searchText_.size());
+        const std::string& lower = searchText_.emplace_back(ToLower(text));
+        for (size_t i = 0; i + 3 <= lower.size(); ++i) {
+            auto& entries = trigrams_[Trigram(lower, i)];
+            if (entries.empty() || entries.back() != entry) {
+                entries.push_back(entry);
+            }
+        }
+    };
+    for (const auto& type : types_) {
+        addText(type.Path);
+    }
+    for (const auto& proc : procs_) {
+        addText(proc.Name);
+    }
+    for (const auto& string : stringTable_) {
+        addText(string);
+    }
+    
+    stringUsers_.clear();
+    stringUsersBuilt_ = false;
+}
+
+std::vector<size_t> DMDisassembler::FindText(const std::string& query, size_t begin, size_t end) const {
+    std::vector<size_t> matches;
+    std::string lowerQuery = ToLower(query);
+    if (lowerQuery.size() < 3) {
+        for (size_t i = begin; i < end; ++i) {
+            if (searchText_[i].find(lowerQuery) != std::string::npos) {
+                matches.push_back(i);
+            }
+        }
+        return matches;
+    }
+    
+    // Only the entries holding the query's rarest trigram can match
+    const std::vector<uint32_t>* candidates = nullptr;
+    for (size_t i = 0; i + 3 <= lowerQuery.size(); ++i) {
+        auto it = trigrams_.find(Trigram(lowerQuery, i));
+        if (it == trigrams_.end()) {
+            return matches;
+        }
+        if (!candidates || it->second.size() < candidates->size()) {
+            candidates = &it->second;
+        }
+    }
+    for (auto it = std::lower_bound(candidates->begin(), candidates->end(), begin);
+         it != candidates->end() && *it < end; ++it) {
+        if (searchText_[*it].find(lowerQuery) != std::string::npos) {
+            matches.push_back(*it);
+        }
+    }
+    return matches;
 }
 
 std::vector<std::string> DMDisassembler::Search(const std::string& query) const {
@@ -293,34 +597,70 @@ std::vector<std::string> DMDisassembler::Search(const std::string& query) const
         return results;
     }
     
-    // Convert query to lowercase for case-insensitive search
-    std::string lowerQuery = query;
-    std::transform(lowerQuery.begin(), lowerQuery.end(), lowerQuery.begin(),
-                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-    
-    // Search types
-    for (const auto& type : types_) {
-        std::string lowerPath = type.Path;
-        std::transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(),
-                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-        
-        if (lowerPath.find(lowerQuery) != std::string::npos) {
-            results.push_back(type.Path);
+    // Types come first in the index, then procs
+    for (size_t entry : FindText(query, 0, types_.size() + procs_.size())) {
+        if (entry < types_.size()) {
+            results.push_back(types_[entry].Path);
+        } else {
+            const DisasmProc& proc = procs_[entry - types_.size()];
+            results.push_back(proc.OwnerPath + "/" + proc.Name);
         }
     }
     
-    // Search procs
-    for (const auto& proc : procs_) {
-        std::string lowerName = proc.Name;
-        std::transform(lowerName.begin(), lowerName.end(), lowerName.begin(),
-                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return results;
+}
+
+std::vector<size_t> DMDisassembler::SearchStrings(const std::string& query) const {
+    std::vector<size_t> results;
+    if (query.empty()) {
+        return results;
+    }
+    size_t first = types_.size() + procs_.size();
+    for (size_t entry : FindText(query, first, searchText_.size())) {
+        results.push_back(entry - first);
+    }
+    return results;
+}
+
+void DMDisassembler::BuildStringUsers() const {
+    LoadAllBytecode();
+    stringUsers_.assign(stringTable_.size(), {});
+    for (size_t procIndex = 0; procIndex < procs_.size(); ++procIndex) {
+        const auto& bytecode = procs_[procIndex].Bytecode;
+        auto use = [&](uint32_t index) {
+            if (index < stringUsers_.size() &&
+                (stringUsers_[index].empty() || stringUsers_[index].back() != procIndex)) {
+                stringUsers_[index].push_back(static_cast<uint32_t>(procIndex));
+            }
+        };
         
-        if (lowerName.find(lowerQuery) != std::string::npos) {
-            results.push_back(proc.OwnerPath + "/" + proc.Name);
+        for (size_t pc = 0; pc < bytecode.size();) {
+            DecodedInstruction instruction = DecodeInstruction(bytecode, pc, operandEncoding_);
+            for (size_t i = 0; i < instruction.OperandCount; ++i) {
+                const OperandSpan& operand = instruction.Operands[i];
+                if (operand.Type == OpcodeArgType::String ||
+                    (operand.Type == OpcodeArgType::Reference && operand.Length == 5 &&
+                     IsNameReference(bytecode[pc + operand.Offset]))) {
+                    use(ReadOperandValue(bytecode, pc, operand, operandEncoding_));
+                }
+            }
+            pc += instruction.Length;
         }
     }
-    
-    return results;
+    stringUsersBuilt_ = true;
+}
+
+std::vector<const DisasmProc*> DMDisassembler::GetProcsReferencingString(size_t index) const {
+    if (!stringUsersBuilt_) {
+        BuildStringUsers();
+    }
+    std::vector<const DisasmProc*> procs;
+    if (index < stringUsers_.size()) {
+        for (uint32_t procIndex : stringUsers_[index]) {
+            procs.push_back(&procs_[procIndex]);
+        }
+    }
+    return procs;
 }
 
 const DisasmType* DMDisassembler::GetType(const std::string& path) const {
@@ -338,13 +678,40 @@ const DisasmType* DMDisassembler::GetTypeById(int typeId) const {
     return nullptr;
 }
 
-const DisasmProc* DMDisassembler::GetProc(int procId) const {
+DisasmProc* DMDisassembler::FindProc(int procId) const {
     if (procId >= 0 && static_cast<size_t>(procId) < procs_.size()) {
         return &procs_[procId];
     }
     return nullptr;
 }
 
+const DisasmProc* DMDisassembler::GetProc(int procId) const {
+    DisasmProc* proc = FindProc(procId);
+    if (proc) {
+        LoadBytecode(*proc);
+    }
+    return proc;
+}
+
+void DMDisassembler::LoadBytecode(DisasmProc& proc) const {
+    if (static_cast<size_t>(proc.Id) < pendingBytecode_.size() && !pendingBytecode_[proc.Id].empty()) {
+        std::string_view& bytecode = pendingBytecode_[proc.Id];
+        proc.Bytecode.assign(bytecode.begin(), bytecode.end());
+        bytecode = std::string_view();
+    }
+}
+
+void DMDisassembler::LoadAllBytecode() const {
+    for (auto& proc : procs_) {
+        LoadBytecode(proc);
+    }
+}
+
+size_t DMDisassembler::BytecodeSize(const DisasmProc& proc) const {
+    bool pending = static_cast<size_t>(proc.Id) < pendingBytecode_.size() && !pendingBytecode_[proc.Id].empty();
+    return pending ? pendingBytecode_[proc.Id].size() : proc.Bytecode.size();
+}
+
 std::vector<const DisasmProc*> DMDisassembler::GetProcsForType(const std::string& typePath) const {
     std::vector<const DisasmProc*> result;
     
@@ -387,6 +754,13 @@ std::string DMDisassembler::DecompileProc(int procId) const {
         return val;
     };
     
+    // IDs and counts, which --compact-operands writes as LEB128
+    auto readId = [&](size_t& pc) -> int {
+        if (operandEncoding_ == OperandEncoding::Fixed) return readInt(pc);
+        auto val = ReadLeb128(bytecode, pc);
+        return val ? static_cast<int>(*val) : 0;
+    };
+    
     auto readFloat = [&](size_t& pc) -> float {
         if (pc + 4 > bytecode.size()) return 0.0f;
         float val = *reinterpret_cast<const float*>(&bytecode[pc]);
@@ -407,7 +781,7 @@ std::string DMDisassembler::DecompileProc(int procId) const {
         auto printArg = [&](OpcodeArgType argType) {
             switch (argType) {
                 case OpcodeArgType::Int: {
-                    int val = readInt(pc);
+                    int val = readId(pc);
                     ss << " " << val;
                     break;
                 }
@@ -417,18 +791,18 @@ std::string DMDisassembler::DecompileProc(int procId) const {
                     break;
                 }
                 case OpcodeArgType::String: {
-                    int id = readInt(pc);
+                    int id = readId(pc);
                     ss << " \"" << GetString(id) << "\"";
                     break;
                 }
                 case OpcodeArgType::TypeId: {
-                    int id = readInt(pc);
+                    int id = readId(pc);
                     const DisasmType* type = GetTypeById(id);
                     ss << " " << (type ? type->Path : "UnknownType(" + std::to_string(id) + ")");
                     break;
                 }
                 case OpcodeArgType::ProcId: {
-                    int id = readInt(pc);
+                    int id = readId(pc);
                     const DisasmProc* p = GetProc(id);
                     ss << " " << (p ? (p->OwnerPath + "/" + p->Name) : "UnknownProc(" + std::to_string(id) + ")");
                     break;
@@ -439,27 +813,41 @@ std::string DMDisassembler::DecompileProc(int procId) const {
                     break;
                 }
                 case OpcodeArgType::Reference: {
-                    int type = readInt(pc);
-                    int val = readInt(pc);
-                    ss << " Ref(" << type << ", " << val << ")";
+                    if (pc >= bytecode.size()) break;
+                    int type = bytecode[pc];
+                    size_t length = ReferenceLength(bytecode[pc]);
+                    pc++;
+                    if (length == 1) {
+                        ss << " Ref(" << type << ")";
+                    } else if (length == 2) {
+                        int val = pc < bytecode.size() ? bytecode[pc++] : 0;
+                        ss << " Ref(" << type << ", " << val << ")";
+                    } else {
+                        int val = readInt(pc);
+                        ss << " Ref(" << type << ", " << val << ")";
+                    }
                     break;
                 }
                 case OpcodeArgType::FilterId: {
-                    int id = readInt(pc);
+                    int id = readId(pc);
                     // Filter ID is usually a type ID in our implementation
                     const DisasmType* type = GetTypeById(id);
                     ss << " Filter(" << (type ? type->Path : std::to_string(id)) << ")";
                     break;
                 }
+                case OpcodeArgType::ArgType: {
+                    int val = pc < bytecode.size() ? bytecode[pc++] : 0;
+                    ss << " " << val;
+                    break;
+                }
                 case OpcodeArgType::ListSize:
                 case OpcodeArgType::StackDelta:
                 case OpcodeArgType::PickCount:
                 case OpcodeArgType::ConcatCount:
                 case OpcodeArgType::FormatCount:
                 case OpcodeArgType::Resource:
-                case OpcodeArgType::EnumeratorId:
-                case OpcodeArgType::ArgType: {
-                    int val = readInt(pc);
+                case OpcodeArgType::EnumeratorId: {
+                    int val = readId(pc);
                     ss << " " << val;
                     break;
                 }
@@ -492,7 +880,60 @@ std::string DMDisassembler::DecompileProc(int procId) const {
     return ss.str();
 }
 
-void DMDisassembler::DumpAll(std::ostream& out) const {
+namespace {
+
+// Write element i of count for each i, in order, on threadCount threads. A
+// window of fragments (so many elements each) is formatted at once, then
+// written out, so the text matches a sequential run.
+void WriteElements(std::ostream& out, size_t count, unsigned threadCount,
+                   const std::function<void(std::ostream&, size_t)>& writeElement) {
+    constexpr size_t ElementsPerFragment = 256;
+    size_t fragmentCount = (count + ElementsPerFragment - 1) / ElementsPerFragment;
+    if (threadCount < 2 || fragmentCount < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            writeElement(out, i);
+        }
+        return;
+    }
+    
+    unsigned workers = static_cast<unsigned>(std::min<size_t>(threadCount, fragmentCount));
+    size_t windowSize = static_cast<size_t>(workers) * 8;
+    std::vector<std::string> fragments;
+    for (size_t windowStart = 0; windowStart < fragmentCount; windowStart += windowSize) {
+        size_t windowEnd = std::min(windowStart + windowSize, fragmentCount);
+        fragments.assign(windowEnd - windowStart, std::string());
+        
+        std::atomic<size_t> next{windowStart};
+        auto worker = [&]() {
+            size_t fragment;
+            while ((fragment = next++) < windowEnd) {
+                std::ostringstream text;
+                size_t end = std::min((fragment + 1) * ElementsPerFragment, count);
+                for (size_t i = fragment * ElementsPerFragment; i < end; ++i) {
+                    writeElement(text, i);
+                }
+                fragments[fragment - windowStart] = text.str();
+            }
+        };
+        
+        std::vector<std::thread> threads;
+        threads.reserve(workers);
+        for (unsigned i = 0; i < workers; ++i) {
+            threads.emplace_back(worker);
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        
+        for (const std::string& fragment : fragments) {
+            out << fragment;
+        }
+    }
+}
+
+} // namespace
+
+void DMDisassembler::DumpAll(std::ostream& out, unsigned threadCount) const {
     out << "=== DMDisassembler Dump ===\n\n";
     
     // Statistics
@@ -505,7 +946,8 @@ void DMDisassembler::DumpAll(std::ostream& out) const {
     
     // Types
     out << "Types:\n";
-    for (const auto& type : types_) {
+    WriteElements(out, types_.size(), threadCount, [&](std::ostream& out, size_t index) {
+        const DisasmType& type = types_[index];
         out << "  [" << type.Id << "] " << type.Path;
         if (type.ParentId >= 0) {
             out << " (parent: " << type.ParentId << ")";
@@ -525,7 +967,7 @@ void DMDisassembler::DumpAll(std::ostream& out) const {
             out << "    Procs: ";
             for (size_t i = 0; i < type.ProcIds.size(); ++i) {
                 if (i > 0) out << ", ";
-                const DisasmProc* proc = GetProc(type.ProcIds[i]);
+                const DisasmProc* proc = FindProc(type.ProcIds[i]);
                 if (proc) {
                     out << proc->Name;
                 } else {
@@ -534,11 +976,12 @@ void DMDisassembler::DumpAll(std::ostream& out) const {
             }
             out << "\n";
         }
-    }
+    });
     
     // Procs
     out << "\nProcs:\n";
-    for (const auto& proc : procs_) {
+    WriteElements(out, procs_.size(), threadCount, [&](std::ostream& out, size_t index) {
+        const DisasmProc& proc = procs_[index];
         out << "  [" << proc.Id << "] " << proc.OwnerPath << "/" << proc.Name;
         if (proc.IsVerb) out << " (verb)";
         out << "\n";
@@ -552,26 +995,39 @@ void DMDisassembler::DumpAll(std::ostream& out) const {
             out << "\n";
         }
         
-        out << "    Bytecode: " << proc.Bytecode.size() << " bytes\n";
-    }
+        out << "    Bytecode: " << BytecodeSize(proc) << " bytes\n";
+    });
 }
 
-int DMDisassembler::TestAll() const {
-    int failures = 0;
+int DMDisassembler::TestAll(unsigned threadCount) const {
+    // Filled in first, so the threads only read
+    LoadAllBytecode();
     
     // Try to decompile each proc
-    for (const auto& proc : procs_) {
-        try {
-            std::string result = DecompileProc(proc.Id);
-            if (result.empty() || result.find("Error:") == 0) {
+    std::atomic<int> failures{0};
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t index = next++; index < procs_.size(); index = next++) {
+            try {
+                std::string result = DecompileProc(procs_[index].Id);
+                if (result.empty() || result.find("Error:") == 0) {
+                    failures++;
+                }
+            } catch (...) {
                 failures++;
             }
-        } catch (...) {
-            failures++;
         }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount && i < procs_.size(); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
     }
     
-    return failures;
+    return failures.load();
 }
 
 DMDisassembler::Stats DMDisassembler::GetStats() const {
@@ -582,12 +1038,427 @@ DMDisassembler::Stats DMDisassembler::GetStats() const {
     
     stats.TotalBytecodeSize = 0;
     for (const auto& proc : procs_) {
-        stats.TotalBytecodeSize += proc.Bytecode.size();
+        stats.TotalBytecodeSize += BytecodeSize(proc);
     }
     
     return stats;
 }
 
+CallGraph DMDisassembler::BuildCallGraph() const {
+    LoadAllBytecode();
+    std::vector<CallGraph::Type> types;
+    types.reserve(types_.size());
+    for (const auto& type : types_) {
+        types.push_back({type.Path, type.ParentId});
+    }
+    std::vector<CallGraph::Proc> procs;
+    procs.reserve(procs_.size());
+    for (const auto& proc : procs_) {
+        procs.push_back({proc.Name, proc.OwnerTypeId, &proc.Bytecode, proc.OwnerPath == "/world" || proc.IsVerb});
+    }
+    return CallGraph(types, procs, [this](uint32_t index) { return GetString(index); }, operandEncoding_);
+}
+
+std::vector<std::pair<std::string, size_t>> DMDisassembler::TopOpcodeNGrams(size_t length, size_t top) const {
+    if (length == 0) {
+        return {};
+    }
+    LoadAllBytecode();
+    std::unordered_map<std::string, size_t> counts;
+    for (const auto& proc : procs_) {
+        std::vector<DreamProcOpcode> opcodes;
+        for (size_t pc = 0; pc < proc.Bytecode.size();) {
+            DecodedInstruction instruction = DecodeInstruction(proc.Bytecode, pc, operandEncoding_);
+            opcodes.push_back(instruction.Opcode);
+            pc += instruction.Length;
+        }
+        
+        for (size_t i = 0; i + length <= opcodes.size(); ++i) {
+            std::string key = GetOpcodeName(opcodes[i]);
+            for (size_t j = 1; j < length; ++j) {
+                key += " " + GetOpcodeName(opcodes[i + j]);
+            }
+            counts[key]++;
+        }
+    }
+    
+    std::vector<std::pair<std::string, size_t>> ngrams(counts.begin(), counts.end());
+    std::sort(ngrams.begin(), ngrams.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (ngrams.size() > top) {
+        ngrams.resize(top);
+    }
+    return ngrams;
+}
+
+namespace {
+
+// Sort largest first, by name where equal, and keep the first top entries
+void SortDescending(std::vector<std::pair<std::string, size_t>>& entries, size_t top) {
+    std::sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (entries.size() > top) {
+        entries.resize(top);
+    }
+}
+
+} // namespace
+
+DMDisassembler::Profile DMDisassembler::GetProfile(size_t top, size_t ngramLength) const {
+    LoadAllBytecode();
+    Profile profile;
+    std::unordered_map<std::string, size_t> opcodeCounts;
+    std::vector<size_t> typeSizes(types_.size(), 0);
+    
+    for (const auto& proc : procs_) {
+        std::string procPath = proc.OwnerPath + "/" + proc.Name;
+        const auto& bytecode = proc.Bytecode;
+        profile.ProcSizes.emplace_back(procPath, bytecode.size());
+        profile.StackSizes.emplace_back(procPath, static_cast<size_t>(std::max(proc.MaxStackSize, 0)));
+        if (proc.OwnerTypeId >= 0 && static_cast<size_t>(proc.OwnerTypeId) < typeSizes.size()) {
+            typeSizes[proc.OwnerTypeId] += bytecode.size();
+        }
+        
+        // Callees as the bytes name them: a global proc by ID, anything else by name or reference
+        std::unordered_set<std::string> callees;
+        for (size_t pc = 0; pc < bytecode.size();) {
+            DecodedInstruction instruction = DecodeInstruction(bytecode, pc, operandEncoding_);
+            opcodeCounts[GetOpcodeName(instruction.Opcode)]++;
+            profile.InstructionCount++;
+            
+            // Call's reference and DereferenceCall's name are their first operands
+            const OperandSpan* target = instruction.OperandCount > 0 ? &instruction.Operands[0] : nullptr;
+            if (instruction.Opcode == DreamProcOpcode::Call && target) {
+                uint8_t type = bytecode[pc + target->Offset];
+                uint32_t value = ReadOperandValue(bytecode, pc, *target, operandEncoding_);
+                const DisasmProc* callee = nullptr;
+                if (type == static_cast<uint8_t>(DMReference::Type::GlobalProc) && target->Length == 5) {
+                    callee = FindProc(static_cast<int>(value));
+                }
+                if (callee) {
+                    callees.insert(callee->OwnerPath + "/" + callee->Name);
+                } else if (type == static_cast<uint8_t>(DMReference::Type::SrcProc) && target->Length == 5) {
+                    callees.insert("src." + GetString(value));
+                } else {
+                    auto begin = bytecode.begin() + pc + target->Offset;
+                    callees.insert(std::string(begin, begin + target->Length));
+                }
+            } else if (instruction.Opcode == DreamProcOpcode::DereferenceCall && target) {
+                callees.insert("." + GetString(ReadOperandValue(bytecode, pc, *target, operandEncoding_)));
+            } else if (instruction.Opcode == DreamProcOpcode::CallStatement) {
+                callees.insert("..()");
+            }
+            pc += instruction.Length;
+        }
+        if (!callees.empty()) {
+            profile.CallFanOut.emplace_back(procPath, callees.size());
+        }
+    }
+    
+    for (size_t i = 0; i < types_.size(); ++i) {
+        if (typeSizes[i] > 0) {
+            profile.TypeSizes.emplace_back(types_[i].Path, typeSizes[i]);
+        }
+    }
+    profile.Opcodes.assign(opcodeCounts.begin(), opcodeCounts.end());
+    SortDescending(profile.Opcodes, profile.Opcodes.size());
+    SortDescending(profile.TypeSizes, top);
+    SortDescending(profile.ProcSizes, top);
+    SortDescending(profile.StackSizes, top);
+    SortDescending(profile.CallFanOut, top);
+    profile.NGrams = TopOpcodeNGrams(ngramLength, top);
+    return profile;
+}
+
+namespace {
+
+// The shortest edit turning a into b (Myers' algorithm), as pairs of a line
+// of a and a line of b, either -1 for a removed or added line. Past maxEdits
+// the middle is given as removed and added whole, to bound the trace kept.
+std::vector<std::pair<int, int>> DiffLines(const std::vector<std::string>& a, const std::vector<std::string>& b,
+                                           int maxEdits = 2048) {
+    std::vector<std::pair<int, int>> script;
+    int n = static_cast<int>(a.size());
+    int m = static_cast<int>(b.size());
+    int prefix = 0;
+    while (prefix < n && prefix < m && a[prefix] == b[prefix]) {
+        script.emplace_back(prefix, prefix);
+        prefix++;
+    }
+    int suffix = 0;
+    while (suffix < n - prefix && suffix < m - prefix && a[n - 1 - suffix] == b[m - 1 - suffix]) {
+        suffix++;
+    }
+    int aCount = n - prefix - suffix;
+    int bCount = m - prefix - suffix;
+    auto lineA = [&](int x) -> const std::string& { return a[prefix + x]; };
+    auto lineB = [&](int y) -> const std::string& { return b[prefix + y]; };
+    
+    // trace[d][k + d] is how far along a the furthest path with d edits reaches on diagonal k
+    int maxD = aCount + bCount;
+    std::vector<int> v(2 * maxD + 3, 0);
+    auto at = [&](int k) -> int& { return v[k + maxD + 1]; };
+    std::vector<std::vector<int>> trace;
+    int edits = -1;
+    for (int d = 0; d <= maxD && d <= maxEdits; ++d) {
+        for (int k = -d; k <= d; k += 2) {
+            int x = (k == -d || (k != d && at(k - 1) < at(k + 1))) ? at(k + 1) : at(k - 1) + 1;
+            int y = x - k;
+            while (x < aCount && y < bCount && lineA(x) == lineB(y)) {
+                x++;
+                y++;
+            }
+            at(k) = x;
+            if (x >= aCount && y >= bCount) {
+                edits = d;
+                break;
+            }
+        }
+        trace.emplace_back(v.begin() + (maxD + 1 - d), v.begin() + (maxD + 2 + d));
+        if (edits >= 0) {
+            break;
+        }
+    }
+    
+    std::vector<std::pair<int, int>> middle;
+    if (edits < 0) {
+        for (int x = aCount - 1; x >= 0; --x) middle.emplace_back(prefix + x, -1);
+        for (int y = bCount - 1; y >= 0; --y) middle.emplace_back(-1, prefix + y);
+        std::reverse(middle.begin(), middle.end());
+    } else {
+        // Walk back from the end, one edit and the diagonal before it at a time
+        int x = aCount;
+        int y = bCount;
+        for (int d = edits; d >= 0; --d) {
+            int k = x - y;
+            int previousX = 0;
+            int previousY = 0;
+            if (d > 0) {
+                const auto& previous = trace[d - 1];
+                auto previousAt = [&](int kk) { return previous[kk + d - 1]; };
+                int previousK = (k == -d || (k != d && previousAt(k - 1) < previousAt(k + 1))) ? k + 1 : k - 1;
+                previousX = previousAt(previousK);
+                previousY = previousX - previousK;
+            }
+            while (x > previousX && y > previousY) {
+                x--;
+                y--;
+                middle.emplace_back(prefix + x, prefix + y);
+            }
+            if (d > 0) {
+                if (x == previousX) {
+                    middle.emplace_back(-1, prefix + y - 1);
+                } else {
+                    middle.emplace_back(prefix + x - 1, -1);
+                }
+                x = previousX;
+                y = previousY;
+            }
+        }
+        std::reverse(middle.begin(), middle.end());
+    }
+    script.insert(script.end(), middle.begin(), middle.end());
+    for (int i = suffix; i > 0; --i) {
+        script.emplace_back(n - i, m - i);
+    }
+    return script;
+}
+
+// Owner path and name, numbered after the first where a type has several procs of that name
+std::vector<std::string> ProcKeys(const std::vector<DisasmProc>& procs) {
+    std::vector<std::string> keys;
+    std::unordered_map<std::string, int> seen;
+    for (const auto& proc : procs) {
+        std::string key = proc.OwnerPath + "/" + proc.Name;
+        int count = seen[key]++;
+        keys.push_back(count == 0 ? key : key + "#" + std::to_string(count + 1));
+    }
+    return keys;
+}
+
+std::string SizeChange(size_t oldSize, size_t newSize) {
+    int64_t delta = static_cast<int64_t>(newSize) - static_cast<int64_t>(oldSize);
+    return std::to_string(oldSize) + " -> " + std::to_string(newSize) + " bytes (" + (delta >= 0 ? "+" : "") +
+           std::to_string(delta) + ")";
+}
+
+} // namespace
+
+std::vector<std::string> DMDisassembler::ComparableInstructions(const DisasmProc& proc) const {
+    const auto& bytecode = proc.Bytecode;
+    
+    // Decoded up front, to count labels in instructions
+    std::vector<size_t> starts;
+    std::vector<DecodedInstruction> instructions;
+    for (size_t pc = 0; pc < bytecode.size(); pc += instructions.back().Length) {
+        starts.push_back(pc);
+        instructions.push_back(DecodeInstruction(bytecode, pc, operandEncoding_));
+    }
+    
+    std::vector<std::string> lines;
+    for (size_t index = 0; index < instructions.size(); ++index) {
+        const DecodedInstruction& instruction = instructions[index];
+        size_t pc = starts[index];
+        std::string line = GetOpcodeName(instruction.Opcode);
+        for (size_t i = 0; i < instruction.OperandCount; ++i) {
+            const OperandSpan& operand = instruction.Operands[i];
+            uint32_t value = ReadOperandValue(bytecode, pc, operand, operandEncoding_);
+            switch (operand.Type) {
+                case OpcodeArgType::String:
+                    line += " \"" + GetString(value) + "\"";
+                    break;
+                case OpcodeArgType::TypeId:
+                case OpcodeArgType::FilterId: {
+                    const DisasmType* type = GetTypeById(static_cast<int>(value));
+                    line += " " + (type ? type->Path : "UnknownType(" + std::to_string(value) + ")");
+                    break;
+                }
+                case OpcodeArgType::ProcId: {
+                    const DisasmProc* target = FindProc(static_cast<int>(value));
+                    line += " " + (target ? target->OwnerPath + "/" + target->Name
+                                          : "UnknownProc(" + std::to_string(value) + ")");
+                    break;
+                }
+                case OpcodeArgType::Label: {
+                    // Offsets count from the end of the offset; the end of the proc counts as an instruction
+                    int64_t destination = static_cast<int64_t>(pc + operand.Offset + operand.Length) +
+                                          static_cast<int32_t>(value);
+                    size_t target = static_cast<size_t>(
+                        std::lower_bound(starts.begin(), starts.end(), destination,
+                                         [](size_t start, int64_t position) { return static_cast<int64_t>(start) < position; }) -
+                        starts.begin());
+                    size_t targetStart = target < starts.size() ? starts[target] : bytecode.size();
+                    if (destination >= 0 && static_cast<int64_t>(targetStart) == destination) {
+                        int64_t relative = static_cast<int64_t>(target) - static_cast<int64_t>(index);
+                        line += std::string(" @") + (relative >= 0 ? "+" : "") + std::to_string(relative);
+                    } else {
+                        line += " @" + std::to_string(static_cast<int32_t>(value)) + "?";
+                    }
+                    break;
+                }
+                case OpcodeArgType::Float: {
+                    float number;
+                    std::memcpy(&number, &value, sizeof(number));
+                    std::ostringstream text;
+                    text << number;
+                    line += " " + text.str();
+                    break;
+                }
+                case OpcodeArgType::Reference: {
+                    uint8_t type = bytecode[pc + operand.Offset];
+                    line += " Ref(" + std::to_string(type);
+                    if (operand.Length == 5 && IsNameReference(type)) {
+                        line += ", " + GetString(value);
+                    } else if (operand.Length == 5 && type == static_cast<uint8_t>(DMReference::Type::GlobalProc)) {
+                        const DisasmProc* target = FindProc(static_cast<int>(value));
+                        line += ", " + (target ? target->OwnerPath + "/" + target->Name : std::to_string(value));
+                    } else if (operand.Length == 5) {
+                        line += ", " + std::to_string(static_cast<int32_t>(value));
+                    } else if (operand.Length == 2) {
+                        line += ", " + std::to_string(value);
+                    }
+                    line += ")";
+                    break;
+                }
+                default:
+                    line += " " + std::to_string(static_cast<int32_t>(value));
+                    break;
+            }
+        }
+        if (instruction.Truncated) {
+            line += " <truncated>";
+        }
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+DMDisassembler::DiffSummary DMDisassembler::Diff(const DMDisassembler& newer, std::ostream& out) const {
+    DiffSummary summary;
+    LoadAllBytecode();
+    newer.LoadAllBytecode();
+    
+    for (const auto& type : newer.types_) {
+        if (!GetType(type.Path)) {
+            out << "+ type " << type.Path << "\n";
+            summary.AddedTypes++;
+        }
+    }
+    for (const auto& type : types_) {
+        if (!newer.GetType(type.Path)) {
+            out << "- type " << type.Path << "\n";
+            summary.RemovedTypes++;
+        }
+    }
+    
+    std::vector<std::string> oldKeys = ProcKeys(procs_);
+    std::vector<std::string> newKeys = ProcKeys(newer.procs_);
+    std::unordered_map<std::string, size_t> newIndex;
+    for (size_t i = 0; i < newKeys.size(); ++i) {
+        newIndex.emplace(newKeys[i], i);
+    }
+    std::vector<bool> matched(newKeys.size(), false);
+    
+    for (size_t i = 0; i < procs_.size(); ++i) {
+        const DisasmProc& oldProc = procs_[i];
+        summary.OldBytecodeSize += oldProc.Bytecode.size();
+        auto it = newIndex.find(oldKeys[i]);
+        if (it == newIndex.end()) {
+            out << "- proc " << oldKeys[i] << " (" << oldProc.Bytecode.size() << " bytes)\n";
+            summary.RemovedProcs++;
+            continue;
+        }
+        matched[it->second] = true;
+        summary.MatchedProcs++;
+        
+        const DisasmProc& newProc = newer.procs_[it->second];
+        std::vector<std::string> oldLines = ComparableInstructions(oldProc);
+        std::vector<std::string> newLines = newer.ComparableInstructions(newProc);
+        if (oldLines == newLines && oldProc.Bytecode.size() == newProc.Bytecode.size()) {
+            continue;
+        }
+        summary.ChangedProcs++;
+        out << "~ proc " << oldKeys[i] << ": " << SizeChange(oldProc.Bytecode.size(), newProc.Bytecode.size()) << "\n";
+        // Removed and added instructions, each with its index in its own proc
+        auto writeLine = [&](char mark, int index, const std::string& line) {
+            std::string number = std::to_string(index);
+            out << "    " << mark << " " << std::string(number.size() < 4 ? 4 - number.size() : 0, ' ') << number
+                << "  " << line << "\n";
+        };
+        for (const auto& [oldLine, newLine] : DiffLines(oldLines, newLines)) {
+            if (newLine < 0) {
+                writeLine('-', oldLine, oldLines[oldLine]);
+            } else if (oldLine < 0) {
+                writeLine('+', newLine, newLines[newLine]);
+            }
+        }
+    }
+    for (size_t i = 0; i < newer.procs_.size(); ++i) {
+        summary.NewBytecodeSize += newer.procs_[i].Bytecode.size();
+        if (!matched[i]) {
+            out << "+ proc " << newKeys[i] << " (" << newer.procs_[i].Bytecode.size() << " bytes)\n";
+            summary.AddedProcs++;
+        }
+    }
+    
+    out << "\nSummary:\n";
+    out << "  Types: " << summary.AddedTypes << " added, " << summary.RemovedTypes << " removed\n";
+    out << "  Procs: " << summary.MatchedProcs << " matched, " << summary.ChangedProcs << " changed, "
+        << summary.AddedProcs << " added, " << summary.RemovedProcs << " removed\n";
+    out << "  Bytecode: " << SizeChange(summary.OldBytecodeSize, summary.NewBytecodeSize);
+    if (summary.OldBytecodeSize > 0) {
+        double percent = 100.0 * (static_cast<double>(summary.NewBytecodeSize) - summary.OldBytecodeSize) /
+                         summary.OldBytecodeSize;
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2) << (percent >= 0 ? "+" : "") << percent << "%";
+        out << ", " << text.str();
+    }
+    out << "\n";
+    return summary;
+}
+
 const std::string& DMDisassembler::GetString(size_t index) const {
     if (index < stringTable_.size()) {
         return stringTable_[index];
@@ -1,12 +1,21 @@
 #include "DMLexer.h"
 #include "DMConstants.h"
+#include "SourceScan.h"
+#include <algorithm>
 #include <cctype>
-#include <unordered_map>
 #include <iostream>
+#include <iterator>
+#include <string_view>
+#include <vector>
 
 namespace DMCompiler {
 
-static const std::unordered_map<std::string, TokenType> Keywords = {
+struct KeywordEntry {
+    std::string_view Text;
+    TokenType Type = TokenType::Identifier;
+};
+
+static constexpr KeywordEntry KeywordList[] = {
     {"var", TokenType::Var},
     {"proc", TokenType::Proc},
     {"verb", TokenType::Verb},
@@ -40,12 +49,224 @@ static const std::unordered_map<std::string, TokenType> Keywords = {
     {"throw", TokenType::Throw}
 };
 
+// Keywords are found with a perfect hash of (first char, last char, length). The
+// multipliers were picked by a search for an assignment with no collisions; the
+// static_assert below re-checks it whenever the keyword list changes.
+static constexpr size_t KeywordTableSize = 64;
+static constexpr size_t MaxKeywordLength = 8;
+
+static constexpr size_t KeywordSlot(std::string_view word) {
+    return ((static_cast<unsigned char>(word.front()) * 37u) ^
+            (static_cast<unsigned char>(word.back()) * 31u) ^
+            word.size()) & (KeywordTableSize - 1);
+}
+
+struct KeywordTable {
+    KeywordEntry Slots[KeywordTableSize];
+};
+
+static constexpr KeywordTable BuildKeywordTable() {
+    KeywordTable table{};
+    for (const auto& keyword : KeywordList) {
+        table.Slots[KeywordSlot(keyword.Text)] = keyword;
+    }
+    return table;
+}
+
+static constexpr bool KeywordHashIsPerfect() {
+    KeywordTable table{};
+    for (const auto& keyword : KeywordList) {
+        KeywordEntry& slot = table.Slots[KeywordSlot(keyword.Text)];
+        if (!slot.Text.empty() || keyword.Text.size() > MaxKeywordLength) {
+            return false;
+        }
+        slot = keyword;
+    }
+    return true;
+}
+
+static_assert(KeywordHashIsPerfect(), "Keyword hash collides; choose new multipliers in KeywordSlot");
+
+static constexpr KeywordTable Keywords = BuildKeywordTable();
+
+struct OperatorEntry {
+    const char* Text;
+    TokenType Type;
+};
+
+// Every operator and punctuation token; ParseOperator takes the longest match
+static const OperatorEntry Operators[] = {
+    {"||=", TokenType::OrOrAssign},
+    {"&&=", TokenType::AndAndAssign},
+    {"%%=", TokenType::ModuloModuloAssign},
+    {"...", TokenType::DotDotDot},
+    {"==", TokenType::Equals},
+    {"!=", TokenType::NotEquals},
+    {"<=", TokenType::LessOrEqual},
+    {">=", TokenType::GreaterOrEqual},
+    {"&&", TokenType::LogicalAnd},
+    {"||", TokenType::LogicalOr},
+    {"<<", TokenType::LeftShift},
+    {">>", TokenType::RightShift},
+    {"++", TokenType::Increment},
+    {"--", TokenType::Decrement},
+    {"+=", TokenType::PlusAssign},
+    {"-=", TokenType::MinusAssign},
+    {"**", TokenType::Power},
+    {"*=", TokenType::MultiplyAssign},
+    {"/=", TokenType::DivideAssign},
+    {"%=", TokenType::ModuloAssign},
+    {"&=", TokenType::AndAssign},
+    {"|=", TokenType::OrAssign},
+    {"^=", TokenType::XorAssign},
+    {"..", TokenType::DotDot},
+    {"::", TokenType::DoubleColon},
+    {":=", TokenType::AssignInto},
+    {"~=", TokenType::TildeEquals},
+    {"~!", TokenType::TildeExclamation},
+    {"?.", TokenType::QuestionDot},
+    {"?:", TokenType::QuestionColon},
+    {"?[", TokenType::QuestionBracket},
+    {"(", TokenType::LeftParenthesis},
+    {")", TokenType::RightParenthesis},
+    {"[", TokenType::LeftBracket},
+    {"]", TokenType::RightBracket},
+    {"{", TokenType::LeftCurlyBracket},
+    {"}", TokenType::RightCurlyBracket},
+    {";", TokenType::Semicolon},
+    {",", TokenType::Comma},
+    {":", TokenType::Colon},
+    {".", TokenType::Period},
+    {"?", TokenType::Question},
+    {"=", TokenType::Assign},
+    {"+", TokenType::Plus},
+    {"-", TokenType::Minus},
+    {"*", TokenType::Multiply},
+    {"/", TokenType::Divide},
+    {"%", TokenType::Modulo},
+    {"<", TokenType::Less},
+    {">", TokenType::Greater},
+    {"!", TokenType::LogicalNot},
+    {"&", TokenType::BitwiseAnd},
+    {"|", TokenType::BitwiseOr},
+    {"^", TokenType::BitwiseXor},
+    {"~", TokenType::BitwiseNot}
+};
+
+/// <summary>
+/// Deterministic automaton over ASCII that recognizes the Operators table.
+/// One row of transitions per state; a state accepts if some operator ends there.
+/// </summary>
+class OperatorDfa {
+public:
+    static constexpr size_t MaxOperatorLength = 3;
+    
+    OperatorDfa() : States_(1) {
+        for (const auto& op : Operators) {
+            size_t state = 0;
+            for (const char* c = op.Text; *c; ++c) {
+                int16_t next = States_[state].Next[static_cast<unsigned char>(*c)];
+                if (next == NoState) {
+                    // Not a reference into States_; emplace_back can move it
+                    next = static_cast<int16_t>(States_.size());
+                    States_[state].Next[static_cast<unsigned char>(*c)] = next;
+                    States_.emplace_back();
+                }
+                state = static_cast<size_t>(next);
+            }
+            States_[state].Accept = &op;
+        }
+    }
+    
+    /// Longest operator at the start of text, or nullptr if none
+    const OperatorEntry* Match(std::string_view text, size_t& length) const {
+        const OperatorEntry* best = nullptr;
+        size_t state = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 128 || States_[state].Next[c] == NoState) {
+                break;
+            }
+            state = static_cast<size_t>(States_[state].Next[c]);
+            if (States_[state].Accept) {
+                best = States_[state].Accept;
+                length = i + 1;
+            }
+        }
+        return best;
+    }
+    
+private:
+    static constexpr int16_t NoState = -1;
+    
+    struct State {
+        State() { std::fill(std::begin(Next), std::end(Next), NoState); }
+        int16_t Next[128];
+        const OperatorEntry* Accept = nullptr;
+    };
+    
+    std::vector<State> States_;
+};
+
+static const OperatorDfa& GetOperatorDfa() {
+    static const OperatorDfa dfa;
+    return dfa;
+}
+
+struct DirectiveInfo {
+    const char* Name;  // Lowercase; directive names are case-insensitive
+    TokenType Type;
+    const char* Text;
+};
+
+static const DirectiveInfo Directives[] = {
+    {"include", TokenType::DM_Preproc_Include, "#include"},
+    {"define", TokenType::DM_Preproc_Define, "#define"},
+    {"undef", TokenType::DM_Preproc_Undefine, "#undef"},
+    {"if", TokenType::DM_Preproc_If, "#if"},
+    {"ifdef", TokenType::DM_Preproc_Ifdef, "#ifdef"},
+    {"ifndef", TokenType::DM_Preproc_Ifndef, "#ifndef"},
+    {"elif", TokenType::DM_Preproc_Elif, "#elif"},
+    {"else", TokenType::DM_Preproc_Else, "#else"},
+    {"endif", TokenType::DM_Preproc_EndIf, "#endif"},
+    {"error", TokenType::DM_Preproc_Error, "#error"},
+    {"warn", TokenType::DM_Preproc_Warning, "#warning"},
+    {"warning", TokenType::DM_Preproc_Warning, "#warning"},
+    {"pragma", TokenType::DM_Preproc_Pragma, "#pragma"}
+};
+
+// Returns nullptr for unknown directives
+static const DirectiveInfo* FindDirective(const std::string& lowerName) {
+    for (const auto& directive : Directives) {
+        if (lowerName == directive.Name) {
+            return &directive;
+        }
+    }
+    return nullptr;
+}
+
 DMLexer::DMLexer(const std::string& sourceName, const std::string& source, bool emitWhitespace)
-    : Lexer<char>(sourceName, std::vector<char>(source.begin(), source.end()))
+    : DMLexer(sourceName, SourceBuffer::FromString(source), emitWhitespace)
+{
+}
+
+DMLexer::DMLexer(const std::string& sourceName, std::shared_ptr<const SourceBuffer> source, bool emitWhitespace)
+    : Lexer<char>(sourceName, source ? source->View() : std::string_view())
+    , Buffer_(std::move(source))
     , EmitWhitespace_(emitWhitespace)
 {
 }
 
+// Bytes that end a plain run in each scanning context. Runs between them are
+// crossed with SourceScan and AdvanceRun; the stop byte itself goes through the
+// per-character logic below as before.
+static const ByteSet HorizontalWhitespace = {' ', '\t'};
+static const ByteSet SkippedWhitespace = {' ', '\t', '\r'};
+static const ByteSet LineCommentStops = {'\n'};
+static const ByteSet BlockCommentStops = {'*', '\n'};
+static const ByteSet MultiLineStringStops = {'"', '\n', '\r'};
+static const ByteSet ResourceStops = {'\''};
+
 Token DMLexer::ParseNextToken() {
     if (AtEndOfSource_ || CurrentIndex_ >= Source_.size()) {
         return CreateToken(TokenType::EndOfFile, "");
@@ -75,12 +296,9 @@ Token DMLexer::ParseNextToken() {
         if (EmitWhitespace_) {
             // Emit whitespace token
             Location wsLoc = CurrentLocation_;
-            std::string ws;
-            while (!AtEndOfSource_ && (GetCurrent() == ' ' || GetCurrent() == '\t')) {
-                ws += GetCurrent();
-                Advance();
-            }
-            return Token(TokenType::DM_Preproc_Whitespace, ws, wsLoc);
+            size_t start = CurrentIndex_;
+            AdvanceTo(SourceScan::FindFirstNotOf(Source_, start, HorizontalWhitespace));
+            return Token(TokenType::DM_Preproc_Whitespace, std::string(Source_.substr(start, CurrentIndex_ - start)), wsLoc);
         }
         SkipWhitespace();
         return ParseNextToken();
@@ -96,6 +314,16 @@ Token DMLexer::ParseNextToken() {
         return ParseNextToken();
     }
     
+    // Carriage returns: mapped sources keep CRLF line endings, so fold "\r\n" into
+    // the newline below and treat a stray '\r' as insignificant whitespace
+    if (current == '\r') {
+        Advance();
+        if (GetCurrent() != '\n') {
+            return ParseNextToken();
+        }
+        current = '\n';
+    }
+    
     // Newlines - just emit them without checking indentation
     // Indentation is handled by TokenStreamDMLexer
     if (current == '\n') {
@@ -149,21 +377,18 @@ Token DMLexer::ParseNextToken() {
 }
 
 Token DMLexer::ParseIdentifierOrKeyword() {
-    std::string identifier;
     Location startLoc = CurrentLocation_;
     
-    while (!AtEndOfSource_ && IsIdentifierChar(GetCurrent())) {
-        identifier += GetCurrent();
-        Advance();
-
-        if (identifier.length() > Limits::MAX_IDENTIFIER_LENGTH) {
-            // Stop consuming to avoid memory issues
-            break;
-        }
+    // Stop consuming past the limit to avoid memory issues
+    const size_t maxLength = static_cast<size_t>(Limits::MAX_IDENTIFIER_LENGTH) + 1;
+    size_t end = CurrentIndex_;
+    while (end < Source_.size() && end - CurrentIndex_ < maxLength && IsIdentifierChar(Source_[end])) {
+        ++end;
     }
     
-    TokenType type = GetKeywordType(identifier);
-    return Token(type, identifier, startLoc);
+    std::string_view identifier = Source_.substr(CurrentIndex_, end - CurrentIndex_);
+    AdvanceRun(identifier.size());
+    return Token(GetKeywordType(identifier), std::string(identifier), startLoc);
 }
 
 Token DMLexer::ParseNumber() {
@@ -224,9 +449,9 @@ Token DMLexer::ParseNumber() {
     if (isFloat) {
         value = Token::TokenValue(std::stod(number));
     } else if (isHex) {
-        value = Token::TokenValue(std::stoll(number, nullptr, 16));
+        value = Token::TokenValue(static_cast<int64_t>(std::stoll(number, nullptr, 16)));
     } else {
-        value = Token::TokenValue(std::stoll(number));
+        value = Token::TokenValue(static_cast<int64_t>(std::stoll(number)));
     }
     
     return Token(TokenType::Number, number, startLoc, value);
@@ -241,12 +466,22 @@ Token DMLexer::ParseString() {
     // If we're already inside an interpolated expression, parse string without interpolation
     // to avoid nested interpolation complexity
     bool allowInterpolation = !inInterpolatedString_;
+    const ByteSet stops = {quote, '\\', '['};
     
     while (!AtEndOfSource_ && GetCurrent() != quote) {
         if (str.length() > Limits::MAX_STRING_LENGTH) {
             // Stop consuming
             break;
         }
+        
+        // Plain characters up to the next quote, escape or bracket are taken in one run
+        size_t stop = std::min(SourceScan::FindFirstOf(Source_, CurrentIndex_, stops),
+                               CurrentIndex_ + (Limits::MAX_STRING_LENGTH + 1 - str.length()));
+        if (stop > CurrentIndex_) {
+            str.append(Source_.substr(CurrentIndex_, stop - CurrentIndex_));
+            AdvanceTo(stop);
+            continue;
+        }
 
         // Check for embedded expression [...] only if allowed
         if (allowInterpolation && GetCurrent() == '[') {
@@ -298,11 +533,20 @@ Token DMLexer::ContinueString() {
     std::string str;
     Location startLoc = CurrentLocation_;
     char quote = stringQuoteChar_;
+    const ByteSet stops = {quote, '\\', '['};
     
     while (!AtEndOfSource_ && GetCurrent() != quote) {
         if (str.length() > Limits::MAX_STRING_LENGTH) {
             break;
         }
+        
+        size_t stop = std::min(SourceScan::FindFirstOf(Source_, CurrentIndex_, stops),
+                               CurrentIndex_ + (Limits::MAX_STRING_LENGTH + 1 - str.length()));
+        if (stop > CurrentIndex_) {
+            str.append(Source_.substr(CurrentIndex_, stop - CurrentIndex_));
+            AdvanceTo(stop);
+            continue;
+        }
 
         // Check for another embedded expression
         if (GetCurrent() == '[') {
@@ -357,6 +601,12 @@ Token DMLexer::ParseMultiLineString() {
     Advance(); // Skip '"'
     
     while (!AtEndOfSource_) {
+        size_t stop = SourceScan::FindFirstOf(Source_, CurrentIndex_, MultiLineStringStops);
+        if (stop > CurrentIndex_) {
+            str.append(Source_.substr(CurrentIndex_, stop - CurrentIndex_));
+            AdvanceTo(stop);
+        }
+        
         if (GetCurrent() == '"' && Peek() == '}') {
             break;
         }
@@ -367,6 +617,12 @@ Token DMLexer::ParseMultiLineString() {
             CurrentLocation_.Column = 0;
         }
         
+        // Normalize CRLF line endings inside the string to LF
+        if (GetCurrent() == '\r' && Peek() == '\n') {
+            Advance();
+            continue;
+        }
+        
         str += GetCurrent();
         Advance();
     }
@@ -386,7 +642,12 @@ Token DMLexer::ParseResource() {
     Location startLoc = CurrentLocation_;
     Advance(); // Skip opening '
     
-    while (!AtEndOfSource_ && GetCurrent() != '\'') {
+    size_t stop = SourceScan::FindFirstOf(Source_, CurrentIndex_, ResourceStops);
+    resource.append(Source_.substr(CurrentIndex_, stop - CurrentIndex_));
+    AdvanceTo(stop);
+    
+    // An unterminated resource keeps the trailing NUL the per-character loop produced
+    if (!AtEndOfSource_ && GetCurrent() != '\'') {
         resource += GetCurrent();
         Advance();
     }
@@ -400,180 +661,30 @@ Token DMLexer::ParseResource() {
 
 Token DMLexer::ParseOperator() {
     Location startLoc = CurrentLocation_;
-    char current = GetCurrent();
-    char next = Peek();
     
-    // Three-character operators
-    if (current == '|' && next == '|' && Peek(2) == '=') {
-        Advance(); Advance(); Advance();
-        return Token(TokenType::OrOrAssign, "||=", startLoc);
-    }
-    if (current == '&' && next == '&' && Peek(2) == '=') {
-        Advance(); Advance(); Advance();
-        return Token(TokenType::AndAndAssign, "&&=", startLoc);
-    }
-    if (current == '%' && next == '%' && Peek(2) == '=') {
-        Advance(); Advance(); Advance();
-        return Token(TokenType::ModuloModuloAssign, "%%=", startLoc);
-    }
-    if (current == '.' && next == '.' && Peek(2) == '.') {
-        Advance(); Advance(); Advance();
-        return Token(TokenType::DotDotDot, "...", startLoc);
+    size_t length = 0;
+    std::string_view text = Source_.substr(CurrentIndex_, OperatorDfa::MaxOperatorLength);
+    if (const OperatorEntry* op = GetOperatorDfa().Match(text, length)) {
+        AdvanceRun(length);
+        return Token(op->Type, op->Text, startLoc);
     }
     
-    // Two-character operators
-    if (current == '=' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::Equals, "==", startLoc);
-    }
-    if (current == '!' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::NotEquals, "!=", startLoc);
-    }
-    if (current == '<' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::LessOrEqual, "<=", startLoc);
-    }
-    if (current == '>' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::GreaterOrEqual, ">=", startLoc);
-    }
-    if (current == '&' && next == '&') {
-        Advance(); Advance();
-        return Token(TokenType::LogicalAnd, "&&", startLoc);
-    }
-    if (current == '|' && next == '|') {
-        Advance(); Advance();
-        return Token(TokenType::LogicalOr, "||", startLoc);
-    }
-    if (current == '<' && next == '<') {
-        Advance(); Advance();
-        return Token(TokenType::LeftShift, "<<", startLoc);
-    }
-    if (current == '>' && next == '>') {
-        Advance(); Advance();
-        return Token(TokenType::RightShift, ">>", startLoc);
-    }
-    if (current == '+' && next == '+') {
-        Advance(); Advance();
-        return Token(TokenType::Increment, "++", startLoc);
-    }
-    if (current == '-' && next == '-') {
-        Advance(); Advance();
-        return Token(TokenType::Decrement, "--", startLoc);
-    }
-    if (current == '+' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::PlusAssign, "+=", startLoc);
-    }
-    if (current == '-' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::MinusAssign, "-=", startLoc);
-    }
-    if (current == '*' && next == '*') {
-        Advance(); Advance();
-        return Token(TokenType::Power, "**", startLoc);
-    }
-    if (current == '*' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::MultiplyAssign, "*=", startLoc);
-    }
-    if (current == '/' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::DivideAssign, "/=", startLoc);
-    }
-    if (current == '%' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::ModuloAssign, "%=", startLoc);
-    }
-    if (current == '&' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::AndAssign, "&=", startLoc);
-    }
-    if (current == '|' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::OrAssign, "|=", startLoc);
-    }
-    if (current == '^' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::XorAssign, "^=", startLoc);
-    }
-    if (current == '.' && next == '.') {
-        Advance(); Advance();
-        return Token(TokenType::DotDot, "..", startLoc);
-    }
-    if (current == ':' && next == ':') {
-        Advance(); Advance();
-        return Token(TokenType::DoubleColon, "::", startLoc);
-    }
-    if (current == ':' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::AssignInto, ":=", startLoc);
-    }
-    // Tilde comparison operators
-    if (current == '~' && next == '=') {
-        Advance(); Advance();
-        return Token(TokenType::TildeEquals, "~=", startLoc);
-    }
-    if (current == '~' && next == '!') {
-        Advance(); Advance();
-        return Token(TokenType::TildeExclamation, "~!", startLoc);
-    }
-    // Null-conditional operators (question prefix)
-    if (current == '?' && next == '.') {
-        Advance(); Advance();
-        return Token(TokenType::QuestionDot, "?.", startLoc);
-    }
-    if (current == '?' && next == ':') {
-        Advance(); Advance();
-        return Token(TokenType::QuestionColon, "?:", startLoc);
-    }
-    if (current == '?' && next == '[') {
-        Advance(); Advance();
-        return Token(TokenType::QuestionBracket, "?[", startLoc);
-    }
-    
-    // Single-character operators
+    char current = GetCurrent();
     Advance();
-    switch (current) {
-        case '(': return Token(TokenType::LeftParenthesis, "(", startLoc);
-        case ')': return Token(TokenType::RightParenthesis, ")", startLoc);
-        case '[': return Token(TokenType::LeftBracket, "[", startLoc);
-        case ']': return Token(TokenType::RightBracket, "]", startLoc);
-        case '{': return Token(TokenType::LeftCurlyBracket, "{", startLoc);
-        case '}': return Token(TokenType::RightCurlyBracket, "}", startLoc);
-        case ';': return Token(TokenType::Semicolon, ";", startLoc);
-        case ',': return Token(TokenType::Comma, ",", startLoc);
-        case ':': return Token(TokenType::Colon, ":", startLoc);
-        case '.': return Token(TokenType::Period, ".", startLoc);
-        case '?': return Token(TokenType::Question, "?", startLoc);
-        case '=': return Token(TokenType::Assign, "=", startLoc);
-        case '+': return Token(TokenType::Plus, "+", startLoc);
-        case '-': return Token(TokenType::Minus, "-", startLoc);
-        case '*': return Token(TokenType::Multiply, "*", startLoc);
-        case '/': return Token(TokenType::Divide, "/", startLoc);
-        case '%': return Token(TokenType::Modulo, "%", startLoc);
-        case '<': return Token(TokenType::Less, "<", startLoc);
-        case '>': return Token(TokenType::Greater, ">", startLoc);
-        case '!': return Token(TokenType::LogicalNot, "!", startLoc);
-        case '&': return Token(TokenType::BitwiseAnd, "&", startLoc);
-        case '|': return Token(TokenType::BitwiseOr, "|", startLoc);
-        case '^': return Token(TokenType::BitwiseXor, "^", startLoc);
-        case '~': return Token(TokenType::BitwiseNot, "~", startLoc);
-        default: return Token(TokenType::Unknown, std::string(1, current), startLoc);
-    }
+    return Token(TokenType::Unknown, std::string(1, current), startLoc);
 }
 
 void DMLexer::SkipWhitespace() {
-    while (!AtEndOfSource_ && IsWhitespace(GetCurrent()) && GetCurrent() != '\n') {
-        Advance();
+    if (!AtEndOfSource_) {
+        AdvanceTo(SourceScan::FindFirstNotOf(Source_, CurrentIndex_, SkippedWhitespace));
     }
 }
 
 void DMLexer::SkipLineComment() {
     // Skip to end of line
-    while (!AtEndOfSource_ && GetCurrent() != '\n') {
-        Advance();
+    AdvanceTo(SourceScan::FindFirstOf(Source_, CurrentIndex_, LineCommentStops));
+    if (CurrentIndex_ >= Source_.size()) {
+        AtEndOfSource_ = true;  // As the failed Advance() past the last byte would
     }
     // Do NOT consume the newline. The newline is a token that should be emitted.
 }
@@ -583,6 +694,7 @@ void DMLexer::SkipBlockComment() {
     Advance(); // Skip '*'
     
     while (!AtEndOfSource_) {
+        AdvanceTo(SourceScan::FindFirstOf(Source_, CurrentIndex_, BlockCommentStops));
         if (GetCurrent() == '*' && Peek() == '/') {
             Advance(); // Skip '*'
             Advance(); // Skip '/'
@@ -597,8 +709,8 @@ void DMLexer::SkipBlockComment() {
     
     // After closing */, skip any trailing spaces or tabs (but not newlines)
     // This matches the C# preprocessor behavior
-    while (!AtEndOfSource_ && (GetCurrent() == ' ' || GetCurrent() == '\t')) {
-        Advance();
+    if (!AtEndOfSource_) {
+        AdvanceTo(SourceScan::FindFirstNotOf(Source_, CurrentIndex_, HorizontalWhitespace));
     }
 }
 
@@ -630,33 +742,277 @@ Token DMLexer::ParsePreprocessorDirective() {
     }
     
     // Map directive names to token types
-    if (directiveLower == "include") {
-        return Token(TokenType::DM_Preproc_Include, "#include", startLoc);
-    } else if (directiveLower == "define") {
-        return Token(TokenType::DM_Preproc_Define, "#define", startLoc);
-    } else if (directiveLower == "undef") {
-        return Token(TokenType::DM_Preproc_Undefine, "#undef", startLoc);
-    } else if (directiveLower == "if") {
-        return Token(TokenType::DM_Preproc_If, "#if", startLoc);
-    } else if (directiveLower == "ifdef") {
-        return Token(TokenType::DM_Preproc_Ifdef, "#ifdef", startLoc);
-    } else if (directiveLower == "ifndef") {
-        return Token(TokenType::DM_Preproc_Ifndef, "#ifndef", startLoc);
-    } else if (directiveLower == "elif") {
-        return Token(TokenType::DM_Preproc_Elif, "#elif", startLoc);
-    } else if (directiveLower == "else") {
-        return Token(TokenType::DM_Preproc_Else, "#else", startLoc);
-    } else if (directiveLower == "endif") {
-        return Token(TokenType::DM_Preproc_EndIf, "#endif", startLoc);
-    } else if (directiveLower == "error") {
-        return Token(TokenType::DM_Preproc_Error, "#error", startLoc);
-    } else if (directiveLower == "warn" || directiveLower == "warning") {
-        return Token(TokenType::DM_Preproc_Warning, "#warning", startLoc);
-    } else if (directiveLower == "pragma") {
-        return Token(TokenType::DM_Preproc_Pragma, "#pragma", startLoc);
-    } else {
-        // Unknown directive - skip it
-        return ParseNextToken();
+    if (const DirectiveInfo* directive = FindDirective(directiveLower)) {
+        return Token(directive->Type, directive->Text, startLoc);
+    }
+    
+    // Unknown directive - skip it
+    return ParseNextToken();
+}
+
+// ============================================================================
+// Inactive conditional blocks
+// ============================================================================
+
+Token DMLexer::SkipConditionalTokens(int& depth, bool stopAtElse) {
+    while (true) {
+        Token token = GetNextToken();
+        switch (token.Type) {
+            case TokenType::EndOfFile:
+                return token;
+            case TokenType::DM_Preproc_If:
+            case TokenType::DM_Preproc_Ifdef:
+            case TokenType::DM_Preproc_Ifndef:
+                depth++;
+                break;
+            case TokenType::DM_Preproc_EndIf:
+                if (depth == 1) {
+                    return token;
+                }
+                depth--;
+                break;
+            case TokenType::DM_Preproc_Else:
+            case TokenType::DM_Preproc_Elif:
+                if (depth == 1 && stopAtElse) {
+                    return token;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Characters that can change how the rest of a dead block is scanned. Everything
+// else is part of an identifier, number, operator or whitespace and is skipped in runs.
+static const ByteSet SkipBoundaries = {'/', '\r', '\n', '{', '\'', '"', '#', '[', ']', '?'};
+
+Token DMLexer::SkipConditionalBlock(int& depth, bool stopAtElse) {
+    if (!PendingTokenQueue_.empty()) {
+        return SkipConditionalTokens(depth, stopAtElse);
+    }
+    
+    // Walks the source the same way ParseNextToken does, so strings, comments and
+    // embedded expressions end in the same places, but never builds token text
+    while (true) {
+        if (AtEndOfSource_ || CurrentIndex_ >= Source_.size()) {
+            return CreateToken(TokenType::EndOfFile, "");
+        }
+        
+        char current = GetCurrent();
+        
+        if (inInterpolatedString_) {
+            if (current == ']') {
+                stringBracketNesting_--;
+                if (stringBracketNesting_ == 0) {
+                    Advance(); // Skip the ']'
+                    SkipString(stringQuoteChar_, true, true);
+                    continue;
+                }
+            } else if (current == '[') {
+                stringBracketNesting_++;
+            } else if (current == '?' && Peek() == '[') {
+                // "?[" is a single operator token, so its bracket is not counted
+                Advance();
+                Advance();
+                continue;
+            }
+        }
+        
+        switch (current) {
+            case '/':
+                if (Peek() == '/') {
+                    SkipLineComment();
+                    continue;
+                }
+                if (Peek() == '*') {
+                    SkipBlockComment();
+                    continue;
+                }
+                break;
+            case '\r':
+                Advance();
+                if (GetCurrent() != '\n') {
+                    continue;
+                }
+                [[fallthrough]];
+            case '\n':
+                Advance();
+                CurrentLocation_.Line++;
+                CurrentLocation_.Column = 0;
+                continue;
+            case '{':
+                if (Peek() == '"') {
+                    SkipMultiLineString();
+                    continue;
+                }
+                break;
+            case '\'':
+                SkipResource();
+                continue;
+            case '"':
+                SkipString(current, !inInterpolatedString_, false);
+                continue;
+            case '#': {
+                Location startLoc = CurrentLocation_;
+                Advance(); // Skip '#'
+                while (!AtEndOfSource_ && (GetCurrent() == ' ' || GetCurrent() == '\t')) {
+                    Advance();
+                }
+                
+                // Directive names are short; only those are read out of a dead block
+                std::string directiveLower;
+                while (!AtEndOfSource_ && IsIdentifierChar(GetCurrent())) {
+                    directiveLower += static_cast<char>(std::tolower(GetCurrent()));
+                    Advance();
+                }
+                
+                const DirectiveInfo* directive = FindDirective(directiveLower);
+                if (!directive) {
+                    continue;
+                }
+                
+                switch (directive->Type) {
+                    case TokenType::DM_Preproc_If:
+                    case TokenType::DM_Preproc_Ifdef:
+                    case TokenType::DM_Preproc_Ifndef:
+                        depth++;
+                        break;
+                    case TokenType::DM_Preproc_EndIf:
+                        if (depth == 1) {
+                            return Token(directive->Type, directive->Text, startLoc);
+                        }
+                        depth--;
+                        break;
+                    case TokenType::DM_Preproc_Else:
+                    case TokenType::DM_Preproc_Elif:
+                        if (depth == 1 && stopAtElse) {
+                            return Token(directive->Type, directive->Text, startLoc);
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                continue;
+            }
+            default:
+                break;
+        }
+        
+        AdvanceTo(SourceScan::FindFirstOf(Source_, CurrentIndex_ + 1, SkipBoundaries));
+    }
+}
+
+void DMLexer::SkipString(char quote, bool allowInterpolation, bool continuation) {
+    // Same loop as ParseString/ContinueString, counting the text instead of building it
+    size_t length = 0;
+    Location startLoc = CurrentLocation_;
+    if (!continuation) {
+        Advance(); // Skip opening quote
+    }
+    const ByteSet stops = {quote, '\\', '['};
+    
+    while (!AtEndOfSource_ && GetCurrent() != quote) {
+        if (length > Limits::MAX_STRING_LENGTH) {
+            break;
+        }
+        
+        size_t stop = std::min(SourceScan::FindFirstOf(Source_, CurrentIndex_, stops),
+                               CurrentIndex_ + (Limits::MAX_STRING_LENGTH + 1 - length));
+        if (stop > CurrentIndex_) {
+            length += stop - CurrentIndex_;
+            AdvanceTo(stop);
+            continue;
+        }
+        
+        if (allowInterpolation && GetCurrent() == '[') {
+            if (!continuation) {
+                inInterpolatedString_ = true;
+                stringQuoteChar_ = quote;
+                stringStartLoc_ = startLoc;
+            }
+            stringBracketNesting_ = 1;
+            Advance(); // Skip the '['
+            return;
+        }
+        
+        if (GetCurrent() == '\\' && Peek() != '\0') {
+            Advance();
+            switch (GetCurrent()) {
+                case 'n': case 't': case 'r': case '\\': case '"': case '\'': case '[': case ']':
+                    length += 1;
+                    break;
+                default:
+                    length += 2;
+                    break;
+            }
+        } else {
+            length++;
+        }
+        Advance();
+    }
+    
+    if (!AtEndOfSource_) {
+        Advance(); // Skip closing quote
+    }
+    
+    if (continuation) {
+        inInterpolatedString_ = false;
+        stringQuoteChar_ = 0;
+        stringBracketNesting_ = 0;
+    }
+}
+
+void DMLexer::SkipMultiLineString() {
+    Advance(); // Skip '{'
+    Advance(); // Skip '"'
+    
+    while (!AtEndOfSource_) {
+        AdvanceTo(SourceScan::FindFirstOf(Source_, CurrentIndex_, MultiLineStringStops));
+        if (GetCurrent() == '"' && Peek() == '}') {
+            break;
+        }
+        if (GetCurrent() == '\n') {
+            CurrentLocation_.Line++;
+            CurrentLocation_.Column = 0;
+        }
+        if (GetCurrent() == '\r' && Peek() == '\n') {
+            Advance();
+            continue;
+        }
+        Advance();
+    }
+    
+    if (!AtEndOfSource_) {
+        Advance(); // Skip '"'
+        if (!AtEndOfSource_) {
+            Advance(); // Skip '}'
+        }
+    }
+}
+
+void DMLexer::SkipResource() {
+    Advance(); // Skip opening '
+    AdvanceTo(SourceScan::FindFirstOf(Source_, CurrentIndex_, ResourceStops));
+    if (!AtEndOfSource_ && GetCurrent() != '\'') {
+        Advance();
+    }
+    if (!AtEndOfSource_) {
+        Advance(); // Skip closing '
+    }
+}
+
+void DMLexer::AdvanceRun(size_t count) {
+    // Equivalent to calling Advance() count times within the current line
+    PreviousLocation_ = CurrentLocation_;
+    PreviousLocation_.Column += static_cast<int>(count) - 1;
+    CurrentIndex_ += count;
+    CurrentLocation_.Column += static_cast<int>(count);
+}
+
+void DMLexer::AdvanceTo(size_t index) {
+    if (index > CurrentIndex_) {
+        AdvanceRun(index - CurrentIndex_);
     }
 }
 
@@ -680,12 +1036,12 @@ bool DMLexer::IsIdentifierChar(char c) const {
     return IsIdentifierStart(c) || IsDigit(c);
 }
 
-TokenType DMLexer::GetKeywordType(const std::string& identifier) const {
-    auto it = Keywords.find(identifier);
-    if (it != Keywords.end()) {
-        return it->second;
+TokenType DMLexer::GetKeywordType(std::string_view identifier) const {
+    if (identifier.size() < 2 || identifier.size() > MaxKeywordLength) {
+        return TokenType::Identifier;
     }
-    return TokenType::Identifier;
+    const KeywordEntry& entry = Keywords.Slots[KeywordSlot(identifier)];
+    return entry.Text == identifier ? entry.Type : TokenType::Identifier;
 }
 
 int DMLexer::CheckIndentation() {
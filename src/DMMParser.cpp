@@ -21,6 +21,9 @@ std::unique_ptr<DreamMapJson> DMMParser::ParseMap() {
     
     bool parsing = true;
     while (parsing) {
+        // Maps can be large; keep only the current definition's tokens
+        DiscardConsumed();
+        
         auto cellDefinition = ParseCellDefinition();
         bool foundCell = false;
         if (cellDefinition) {
@@ -30,13 +33,13 @@ std::unique_ptr<DreamMapJson> DMMParser::ParseMap() {
             }
             
             if (static_cast<int>(cellDefinition->Name.length()) == CellNameLength_) {
-                map->CellDefinitions[cellDefinition->Name] = std::move(cellDefinition);
+                map->SetCellDefinition(std::move(cellDefinition));
             } else {
                 Warning("Invalid cell definition name length '" + cellDefinition->Name + "'");
             }
         }
         
-        auto mapBlock = ParseMapBlock();
+        auto mapBlock = ParseMapBlock(*map);
         bool foundBlock = false;
         if (mapBlock) {
             foundBlock = true;
@@ -54,6 +57,13 @@ std::unique_ptr<DreamMapJson> DMMParser::ParseMap() {
         }
     }
     
+    // Nothing in a map resumes after a failed definition
+    std::string failure;
+    if (TakeFailure(failure)) {
+        Warning("Parse error: " + failure);
+        return nullptr;
+    }
+    
     Consume(TokenType::EndOfFile, "Expected EOF");
     return map;
 }
@@ -100,10 +110,10 @@ std::unique_ptr<CellDefinitionJson> DMMParser::ParseCellDefinition() {
                         
                         if (Check(TokenType::Assign)) {
                             Advance(); // Consume =
+                            cellDefinition->SkippedOverrides++;
                             
-                            // Parse value (constant or path)
-                            auto expr = ConstantExpression();
-                            if (!expr) {
+                            // Skip the value (literal or path)
+                            if (!SkipLiteral()) {
                                 auto path = PathExpression();
                                 if (!path) {
                                     // Fallback: consume until semicolon or }
@@ -128,9 +138,13 @@ std::unique_ptr<CellDefinitionJson> DMMParser::ParseCellDefinition() {
             
             // Add the map object to the appropriate list
             if (type != nullptr) {
-                if (type->Path.IsDescendantOf(DreamPath::Turf) || type->Path == DreamPath::Turf) {
+                DMObject* turf = nullptr;
+                DMObject* area = nullptr;
+                Compiler_->GetObjectTree()->TryGetDMObject(DreamPath::Turf, &turf);
+                Compiler_->GetObjectTree()->TryGetDMObject(DreamPath::Area, &area);
+                if (type->IsSubtypeOf(turf)) {
                     cellDefinition->Turf = std::move(mapObject);
-                } else if (type->Path.IsDescendantOf(DreamPath::Area) || type->Path == DreamPath::Area) {
+                } else if (type->IsSubtypeOf(area)) {
                     cellDefinition->Area = std::move(mapObject);
                 } else {
                     cellDefinition->Objects.push_back(std::move(mapObject));
@@ -164,7 +178,7 @@ std::unique_ptr<CellDefinitionJson> DMMParser::ParseCellDefinition() {
     return nullptr;
 }
 
-std::unique_ptr<MapBlockJson> DMMParser::ParseMapBlock() {
+std::unique_ptr<MapBlockJson> DMMParser::ParseMapBlock(DreamMapJson& map) {
     // Skip whitespace and newlines
     while (Current().Type == TokenType::Newline || 
            Current().Type == TokenType::Indent || 
@@ -215,8 +229,8 @@ std::unique_ptr<MapBlockJson> DMMParser::ParseMapBlock() {
             }
             
             for (int x = 1; x <= width; x++) {
-                std::string cell = currentLine.substr((x - 1) * CellNameLength_, CellNameLength_);
-                mapBlock->Cells.push_back(cell);
+                std::string_view cell = std::string_view(currentLine).substr((x - 1) * CellNameLength_, CellNameLength_);
+                mapBlock->Cells.push_back(map.GetCellKeyId(cell));
             }
         }
         
@@ -241,7 +255,7 @@ std::unique_ptr<DMMParser::Coordinates> DMMParser::ParseCoordinates() {
     Advance(); // Consume (
     
     auto xExpr = ConstantExpression();
-    auto xConst = dynamic_cast<DMASTConstantInteger*>(xExpr.get());
+    auto xConst = DMASTCast<DMASTConstantInteger>(xExpr.get());
     if (!xConst) {
         Warning("Expected an integer for X coordinate");
         return nullptr;
@@ -250,7 +264,7 @@ std::unique_ptr<DMMParser::Coordinates> DMMParser::ParseCoordinates() {
     Consume(TokenType::Comma, "Expected ','");
     
     auto yExpr = ConstantExpression();
-    auto yConst = dynamic_cast<DMASTConstantInteger*>(yExpr.get());
+    auto yConst = DMASTCast<DMASTConstantInteger>(yExpr.get());
     if (!yConst) {
         Warning("Expected an integer for Y coordinate");
         return nullptr;
@@ -259,7 +273,7 @@ std::unique_ptr<DMMParser::Coordinates> DMMParser::ParseCoordinates() {
     Consume(TokenType::Comma, "Expected ','");
     
     auto zExpr = ConstantExpression();
-    auto zConst = dynamic_cast<DMASTConstantInteger*>(zExpr.get());
+    auto zConst = DMASTCast<DMASTConstantInteger>(zExpr.get());
     if (!zConst) {
         Warning("Expected an integer for Z coordinate");
         return nullptr;
@@ -293,6 +307,26 @@ std::unique_ptr<DMASTPath> DMMParser::PathExpression() {
     return std::make_unique<DMASTPath>(path);
 }
 
+bool DMMParser::SkipLiteral() {
+    // Skip whitespace and newlines
+    while (Current().Type == TokenType::Newline || 
+           Current().Type == TokenType::Indent || 
+           Current().Type == TokenType::Dedent) {
+        Advance();
+    }
+    
+    switch (Current().Type) {
+        case TokenType::Number:
+        case TokenType::String:
+        case TokenType::Null:
+        case TokenType::Resource:
+            Advance();
+            return true;
+        default:
+            return false;
+    }
+}
+
 std::unique_ptr<DMASTExpression> DMMParser::ConstantExpression() {
     // Skip whitespace and newlines
     while (Current().Type == TokenType::Newline || 
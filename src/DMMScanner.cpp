@@ -0,0 +1,292 @@
+#include "DMMScanner.h"
+#include "DMCompiler.h"
+#include "DMObjectTree.h"
+#include "DMObject.h"
+#include <algorithm>
+
+namespace DMCompiler {
+
+namespace {
+
+bool IsIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+bool IsIdentifierChar(char c) {
+    return IsIdentifierStart(c) || (c >= '0' && c <= '9');
+}
+
+} // namespace
+
+DMMScanner::DMMScanner(DMCompiler* compiler, const std::string& fileName, std::string_view source, int zOffset)
+    : Compiler_(compiler), FileId_(SourceFileRegistry::Register(fileName)), Source_(source), ZOffset_(zOffset) {
+}
+
+std::unique_ptr<DreamMapJson> DMMScanner::ScanMap() {
+    Compiler_->GetObjectTree()->TryGetDMObject(DreamPath::Turf, &Turf_);
+    Compiler_->GetObjectTree()->TryGetDMObject(DreamPath::Area, &Area_);
+
+    auto map = std::make_unique<DreamMapJson>();
+    while (true) {
+        if (!SkipWhitespace()) {
+            return nullptr;
+        }
+        if (Pos_ == Source_.size()) {
+            break;
+        }
+        bool scanned = Current() == '"' ? ScanCellDefinition(*map)
+                     : Current() == '(' ? ScanMapBlock(*map)
+                     : false;
+        if (!scanned) {
+            return nullptr;
+        }
+    }
+    return map;
+}
+
+void DMMScanner::ReportWarnings() {
+    for (const auto& warning : Warnings_) {
+        Compiler_->ForcedWarning(warning);
+    }
+    Warnings_.clear();
+}
+
+bool DMMScanner::ScanCellDefinition(DreamMapJson& map) {
+    std::string_view name;
+    if (!ScanString(name) || !Expect('=') || !Expect('(')) {
+        return false;
+    }
+    auto cellDefinition = std::make_unique<CellDefinitionJson>(std::string(name));
+
+    if (!SkipWhitespace()) {
+        return false;
+    }
+    while (Current() == '/') {
+        std::string_view pathText;
+        if (!ScanPath(pathText)) {
+            return false;
+        }
+        // DMMParser reports a skipped type at the token after the path
+        while (Current() == ' ' || Current() == '\t') {
+            ++Pos_;
+        }
+        if (Current() != '{' && Current() != ',' && Current() != ')') {
+            return false;
+        }
+
+        DreamPath path{std::string(pathText)};
+        DMObject* type = nullptr;
+        bool foundType = Compiler_->GetObjectTree()->TryGetDMObject(path, &type);
+        if (SeenTypes_.insert(path).second) {
+            ReferencedTypes_.push_back(path);
+            if (!foundType) {
+                Warning(Pos_, "Skipping type '" + path.ToString() + "'");
+            }
+        }
+        if (Current() == '{' && !SkipVarOverrides(cellDefinition->SkippedOverrides)) {
+            return false;
+        }
+
+        if (type != nullptr) {
+            auto mapObject = std::make_unique<MapObjectJson>(type->Id);
+            if (type->IsSubtypeOf(Turf_)) {
+                cellDefinition->Turf = std::move(mapObject);
+            } else if (type->IsSubtypeOf(Area_)) {
+                cellDefinition->Area = std::move(mapObject);
+            } else {
+                cellDefinition->Objects.push_back(std::move(mapObject));
+            }
+        }
+
+        if (!SkipWhitespace()) {
+            return false;
+        }
+        if (Current() != ',') {
+            break;
+        }
+        ++Pos_;
+        if (!SkipWhitespace() || Current() != '/') {
+            return false;
+        }
+    }
+    if (Current() != ')') {
+        return false;
+    }
+    if (!cellDefinition->Turf) {
+        Warning(Pos_, "Cell definition \"" + cellDefinition->Name + "\" is missing a turf");
+    }
+    ++Pos_;
+
+    // DMMParser warns about a bad name length after the next token; leave that to it
+    if (CellNameLength_ == -1) {
+        CellNameLength_ = static_cast<int>(name.size());
+    }
+    if (static_cast<int>(name.size()) != CellNameLength_) {
+        return false;
+    }
+    map.SetCellDefinition(std::move(cellDefinition));
+    return true;
+}
+
+bool DMMScanner::ScanMapBlock(DreamMapJson& map) {
+    int x, y, z;
+    ++Pos_;  // (
+    if (!ScanInteger(x) || !Expect(',') || !ScanInteger(y) || !Expect(',') || !ScanInteger(z) ||
+        !Expect(')') || !Expect('=')) {
+        return false;
+    }
+    std::string_view grid;
+    if (!SkipWhitespace() || !ScanString(grid) || CellNameLength_ <= 0) {
+        return false;
+    }
+
+    auto mapBlock = std::make_unique<MapBlockJson>(x, y, z + ZOffset_);
+    mapBlock->Cells.reserve(grid.size() / CellNameLength_);
+    size_t cellLength = static_cast<size_t>(CellNameLength_);
+    for (size_t lineStart = 0; lineStart < grid.size();) {
+        size_t lineEnd = std::min(grid.find('\n', lineStart), grid.size());
+        std::string_view line = grid.substr(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos) {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+        if (line.size() % cellLength != 0) {
+            return false;
+        }
+        mapBlock->Width = std::max(mapBlock->Width, static_cast<int>(line.size() / cellLength));
+        mapBlock->Height++;
+        for (size_t cell = 0; cell < line.size(); cell += cellLength) {
+            mapBlock->Cells.push_back(map.GetCellKeyId(line.substr(cell, cellLength)));
+        }
+    }
+
+    map.MaxX = std::max(map.MaxX, mapBlock->X + mapBlock->Width - 1);
+    map.MaxY = std::max(map.MaxY, mapBlock->Y + mapBlock->Height - 1);
+    map.MaxZ = std::max(map.MaxZ, mapBlock->Z);
+    map.Blocks.push_back(std::move(mapBlock));
+    return true;
+}
+
+bool DMMScanner::ScanPath(std::string_view& path) {
+    size_t start = Pos_;
+    while (Current() == '/') {
+        ++Pos_;
+        if (!IsIdentifierStart(Current())) {
+            return false;
+        }
+        while (IsIdentifierChar(Current())) {
+            ++Pos_;
+        }
+    }
+    path = Source_.substr(start, Pos_ - start);
+    return true;
+}
+
+bool DMMScanner::SkipVarOverrides(uint32_t& count) {
+    ++Pos_;  // {
+    int depth = 0;  // Of parentheses, as in list("key" = value)
+    while (Pos_ < Source_.size()) {
+        char c = Source_[Pos_++];
+        if (c == '}') {
+            return depth == 0;
+        }
+        if (c == '{' || c == '[' || c == '<' || c == '>' || c == '!') {
+            return false;
+        }
+        if (c == '(' || c == ')') {
+            depth += c == '(' ? 1 : -1;
+        } else if (c == '=' && depth == 0) {
+            // Each override is one "name = value"; a comparison is left to DMMParser
+            if (Pos_ < Source_.size() && Source_[Pos_] == '=') {
+                return false;
+            }
+            ++count;
+        }
+        if (c == '"' || c == '\'') {
+            // Text with escapes or embedded expressions is left to DMMParser
+            size_t end = Source_.find(c, Pos_);
+            if (end == std::string_view::npos ||
+                Source_.substr(Pos_, end - Pos_).find_first_of("\\[\n") != std::string_view::npos) {
+                return false;
+            }
+            Pos_ = end + 1;
+        }
+    }
+    return false;
+}
+
+bool DMMScanner::ScanInteger(int& value) {
+    if (!SkipWhitespace()) {
+        return false;
+    }
+    size_t start = Pos_;
+    value = 0;
+    while (Current() >= '0' && Current() <= '9' && Pos_ - start < 9) {
+        value = value * 10 + (Current() - '0');
+        ++Pos_;
+    }
+    return Pos_ > start && !(Current() >= '0' && Current() <= '9') && Current() != '.';
+}
+
+bool DMMScanner::ScanString(std::string_view& value) {
+    bool multiLine = Current() == '{';
+    if (Source_.substr(Pos_, multiLine ? 2 : 1) != (multiLine ? "{\"" : "\"")) {
+        return false;
+    }
+    Pos_ += multiLine ? 2 : 1;
+    size_t end = Source_.find('"', Pos_);
+    if (end == std::string_view::npos || (multiLine && Source_.substr(end, 2) != "\"}")) {
+        return false;
+    }
+    value = Source_.substr(Pos_, end - Pos_);
+    if (value.find_first_of(multiLine ? "\\[" : "\\[\n") != std::string_view::npos) {
+        return false;
+    }
+    Pos_ = end + (multiLine ? 2 : 1);
+    return true;
+}
+
+bool DMMScanner::SkipWhitespace() {
+    while (Pos_ < Source_.size()) {
+        char c = Source_[Pos_];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            ++Pos_;
+        } else if (c == '/' && Pos_ + 1 < Source_.size() && Source_[Pos_ + 1] == '/') {
+            Pos_ = std::min(Source_.find('\n', Pos_), Source_.size());
+        } else if (c == '/' && Pos_ + 1 < Source_.size() && Source_[Pos_ + 1] == '*') {
+            size_t end = Source_.find("*/", Pos_ + 2);
+            if (end == std::string_view::npos) {
+                return false;
+            }
+            Pos_ = end + 2;
+        } else {
+            break;
+        }
+    }
+    return true;
+}
+
+bool DMMScanner::Expect(char c) {
+    if (!SkipWhitespace() || Current() != c) {
+        return false;
+    }
+    ++Pos_;
+    return true;
+}
+
+Location DMMScanner::LocationAt(size_t pos) {
+    CountedLine_ += static_cast<int>(std::count(Source_.begin() + CountedPos_, Source_.begin() + pos, '\n'));
+    CountedPos_ = pos;
+    size_t lineStart = Source_.rfind('\n', pos == 0 ? 0 : pos - 1);
+    lineStart = (lineStart == std::string_view::npos || pos == 0) ? 0 : lineStart + 1;
+    return Location(FileId_, CountedLine_, static_cast<int>(pos - lineStart));
+}
+
+void DMMScanner::Warning(size_t pos, const std::string& message) {
+    Warnings_.push_back(LocationAt(pos).ToString() + ": " + message);
+}
+
+} // namespace DMCompiler
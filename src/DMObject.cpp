@@ -29,6 +29,11 @@ void DMObject::AddProc(int procId, const std::string& procName, bool forceFirst)
 }
 
 const DMVariable* DMObject::GetVariable(const std::string& name) const {
+    if (Members_) {
+        const DMObjectMember* member = FindMember(name);
+        return member ? member->Variable : nullptr;
+    }
+    
     // Check local variables
     auto it = Variables.find(name);
     if (it != Variables.end()) {
@@ -57,6 +62,11 @@ DMVariable* DMObject::GetVariable(const std::string& name) {
 }
 
 bool DMObject::HasLocalVariable(const std::string& name) const {
+    if (Members_) {
+        const DMObjectMember* member = FindMember(name);
+        return member && member->IsLocalVariable;
+    }
+    
     if (Variables.find(name) != Variables.end()) {
         return true;
     }
@@ -89,6 +99,11 @@ bool DMObject::HasGlobalVariableNotInRoot(const std::string& name) const {
 }
 
 bool DMObject::HasProc(const std::string& name) const {
+    if (Members_) {
+        const DMObjectMember* member = FindMember(name);
+        return member && member->Procs;
+    }
+    
     if (Procs.find(name) != Procs.end()) {
         return true;
     }
@@ -100,11 +115,32 @@ bool DMObject::HasProc(const std::string& name) const {
     return false;
 }
 
+bool DMObject::IsSubtypeOf(const DMObject* ancestor) const {
+    if (ancestor == nullptr) {
+        return false;
+    }
+    if (TreeIndex >= 0 && ancestor->TreeIndex >= 0) {
+        return ancestor->TreeIndex <= TreeIndex && TreeIndex <= ancestor->SubtreeEnd;
+    }
+    
+    for (const DMObject* type = this; type != nullptr; type = type->Parent) {
+        if (type == ancestor) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool DMObject::OwnsProc(const std::string& name) const {
     return Procs.find(name) != Procs.end();
 }
 
 const std::vector<int>* DMObject::GetProcs(const std::string& name) const {
+    if (Members_) {
+        const DMObjectMember* member = FindMember(name);
+        return member ? member->Procs : nullptr;
+    }
+    
     auto it = Procs.find(name);
     if (it != Procs.end()) {
         return &it->second;
@@ -117,6 +153,41 @@ const std::vector<int>* DMObject::GetProcs(const std::string& name) const {
     return nullptr;
 }
 
+void DMObject::FlattenMembers() {
+    if (Members_) {
+        return;
+    }
+    if (Parent) {
+        Parent->FlattenMembers();
+        if (Procs.empty() && Variables.empty() && VariableOverrides.empty()) {
+            Members_ = Parent->Members_;
+            return;
+        }
+    }
+    
+    auto members = Parent ? std::make_shared<DMObjectMemberTable>(*Parent->Members_)
+                          : std::make_shared<DMObjectMemberTable>();
+    for (const auto& [name, procIds] : Procs) {
+        (*members)[name].Procs = &procIds;
+    }
+    // GetVariable() prefers a declaration to an override on the same type,
+    // while GetAllVariables() lists the override
+    for (auto& [name, var] : VariableOverrides) {
+        DMObjectMember& member = (*members)[name];
+        member.Variable = &var;
+        member.Listed = &var;
+    }
+    for (auto& [name, var] : Variables) {
+        DMObjectMember& member = (*members)[name];
+        member.Variable = &var;
+        member.IsLocalVariable = true;
+        if (VariableOverrides.find(name) == VariableOverrides.end()) {
+            member.Listed = &var;
+        }
+    }
+    Members_ = std::move(members);
+}
+
 void DMObject::CreateInitializationProc(DMCompiler* compiler, DMObjectTree* objectTree) {
     // Only create init proc if we have variables with values and don't already have one
     if (InitializationProc != -1) {
@@ -142,8 +213,17 @@ void DMObject::CreateInitializationProc(DMCompiler* compiler, DMObjectTree* obje
         }
     }
     
+    // Settle the parent's first, since ours either calls it with ..() or is it
+    if (Parent != nullptr) {
+        Parent->CreateInitializationProc(compiler, objectTree);
+    }
+    
     if (!hasInitialValues) {
-        return; // No initialization needed
+        // Nothing of our own to set, so new() can run the parent's directly
+        if (Parent != nullptr) {
+            InitializationProc = Parent->InitializationProc;
+        }
+        return;
     }
     
     // Create the initialization proc
@@ -1,7 +1,11 @@
 #include "DMObjectTree.h"
+#include "CallGraph.h"
 #include "DMCompiler.h"
 #include "DMProc.h"
 #include "DMASTStatement.h"
+#include "ParallelProcCompiler.h"
+#include "ProcCache.h"
+#include <iterator>
 #include <stdexcept>
 #include <iostream>
 
@@ -46,21 +50,29 @@ DMObject* DMObjectTree::GetRoot() {
     return GetOrCreateDMObject(DreamPath::Root);
 }
 
-int DMObjectTree::AddString(const std::string& value) {
-    // Check if string already exists
-    auto it = StringToStringId_.find(value);
-    if (it != StringToStringId_.end()) {
-        return it->second;
+int DMObjectTree::AddString(std::string_view value) {
+    // Worker threads leave the table alone; the string is added once they are done
+    if (ParallelProcCompiler::IsSpeculating()) {
+        int stringId = StringTable.Find(value);
+        if (stringId < 0) {
+            return ParallelProcCompiler::RecordNewString(value);
+        }
+        ProcCache::RecordString(value, stringId);
+        return stringId;
     }
     
-    // Add new string
-    int stringId = static_cast<int>(StringTable.size());
-    StringTable.push_back(value);
-    StringToStringId_[value] = stringId;
-    
+    int stringId = StringTable.Intern(value);
+    ProcCache::RecordString(value, stringId);
     return stringId;
 }
 
+void DMObjectTree::AddResource(const std::string& path) {
+    ProcCache::RecordResource(path);
+    if (Resources.find(path) == Resources.end() && !ParallelProcCompiler::Abandon()) {
+        Resources.insert(path);
+    }
+}
+
 DMObject* DMObjectTree::GetOrCreateDMObject(const DreamPath& path) {
     DMObject* existing = nullptr;
     if (TryGetDMObject(path, &existing)) {
@@ -84,6 +96,9 @@ DMObject* DMObjectTree::GetOrCreateDMObject(const DreamPath& path) {
     AllObjects.push_back(std::move(dmObject));
     PathToTypeId_[path] = id;
     
+    // A lookup that found nothing, or found a parent, may find this now
+    ForgetResolutions();
+    
     return dmObjectPtr;
 }
 
@@ -130,22 +145,12 @@ DMObject* DMObjectTree::GetType(const DreamPath& path, DMObject* context) {
         return nullptr;
     }
     
-    // Handle relative paths with context
     if (context != nullptr) {
-        // Try combining with context path
-        DreamPath combinedPath = context->Path.Combine(path);
-        DMObject* obj = nullptr;
-        if (TryGetDMObject(combinedPath, &obj)) {
-            return obj;
-        }
-        
-        // Try upward search through parent chain
-        auto result = UpwardSearch(context->Path, path);
-        if (result.has_value()) {
-            if (TryGetDMObject(result.value(), &obj)) {
-                return obj;
-            }
+        if (TypesFrozen_) {
+            return Memoize(ResolvedTypes_, {context->Path, path, ""},
+                           [&]() { return ResolveRelativeType(path, context); });
         }
+        return ResolveRelativeType(path, context);
     }
     
     // Try as absolute path from root (for relative paths without context)
@@ -158,6 +163,98 @@ DMObject* DMObjectTree::GetType(const DreamPath& path, DMObject* context) {
     return nullptr;
 }
 
+template <typename Value, typename Resolve>
+Value DMObjectTree::Memoize(std::unordered_map<ResolutionKey, Value, ResolutionKeyHash>& memo, ResolutionKey key,
+                            Resolve resolve) {
+    {
+        std::shared_lock lock(ResolutionMutex_);
+        auto it = memo.find(key);
+        if (it != memo.end()) {
+            return it->second;
+        }
+    }
+    
+    // Resolving only reads the tree, so threads racing here agree
+    Value value = resolve();
+    std::unique_lock lock(ResolutionMutex_);
+    memo.emplace(std::move(key), value);
+    return value;
+}
+
+DMObject* DMObjectTree::ResolveRelativeType(const DreamPath& path, DMObject* context) {
+    // Try combining with context path
+    DreamPath combinedPath = context->Path.Combine(path);
+    DMObject* obj = nullptr;
+    if (TryGetDMObject(combinedPath, &obj)) {
+        return obj;
+    }
+    
+    // Try upward search through parent chain
+    auto result = UpwardSearch(context->Path, path);
+    if (result.has_value()) {
+        if (TryGetDMObject(result.value(), &obj)) {
+            return obj;
+        }
+    }
+    
+    // Try as absolute path from root
+    DreamPath absolutePath(DreamPath::PathType::Absolute, path.GetElements());
+    if (TryGetDMObject(absolutePath, &obj)) {
+        return obj;
+    }
+    
+    return nullptr;
+}
+
+void DMObjectTree::ForgetResolutions() {
+    std::unique_lock lock(ResolutionMutex_);
+    MergedVariables_.clear();
+    MergedProcs_.clear();
+    if (TypesFrozen_) {
+        ResolvedTypes_.clear();
+        ResolvedProcs_.clear();
+        UpwardSearches_.clear();
+        for (const auto& object : AllObjects) {
+            object->ForgetMembers();
+        }
+        NumberTypes();
+    }
+}
+
+void DMObjectTree::NumberTypes() {
+    // Children in ID order, so the numbering is the same on every build
+    std::vector<std::vector<DMObject*>> children(AllObjects.size());
+    std::vector<DMObject*> roots;
+    for (const auto& object : AllObjects) {
+        if (object->Parent) {
+            children[object->Parent->Id].push_back(object.get());
+        } else {
+            roots.push_back(object.get());
+        }
+    }
+    
+    // Types nest too deep for recursion to be safe, so the walk keeps its own
+    // stack of (type, next child to visit)
+    int nextIndex = 0;
+    std::vector<std::pair<DMObject*, size_t>> stack;
+    for (DMObject* root : roots) {
+        root->TreeIndex = nextIndex++;
+        stack.emplace_back(root, 0);
+        while (!stack.empty()) {
+            auto& [type, nextChild] = stack.back();
+            const std::vector<DMObject*>& below = children[type->Id];
+            if (nextChild < below.size()) {
+                DMObject* child = below[nextChild++];
+                child->TreeIndex = nextIndex++;
+                stack.emplace_back(child, 0);
+            } else {
+                type->SubtreeEnd = nextIndex - 1;
+                stack.pop_back();
+            }
+        }
+    }
+}
+
 DMProc* DMObjectTree::GetProc(DMObject* obj, const std::string& procName) {
     if (!obj) {
         // If no object context, try global procs only
@@ -168,6 +265,14 @@ DMProc* DMObjectTree::GetProc(DMObject* obj, const std::string& procName) {
         return nullptr;
     }
     
+    if (TypesFrozen_) {
+        return Memoize(ResolvedProcs_, {obj->Path, DreamPath(), procName},
+                       [&]() { return ResolveProc(obj, procName); });
+    }
+    return ResolveProc(obj, procName);
+}
+
+DMProc* DMObjectTree::ResolveProc(DMObject* obj, const std::string& procName) {
     // 1. Search current object and parent chain for the proc
     const std::vector<int>* procIds = obj->GetProcs(procName);
     if (procIds && !procIds->empty()) {
@@ -197,16 +302,71 @@ DMProc* DMObjectTree::GetProc(DMObject* obj, const std::string& procName) {
     return nullptr;
 }
 
-std::unordered_map<std::string, const DMVariable*> DMObjectTree::GetAllVariables(DMObject* obj) const {
+void DMObjectTree::FreezeTypeTree() {
+    TypesFrozen_ = true;
+    NumberTypes();
+    for (const auto& object : AllObjects) {
+        object->FlattenMembers();
+    }
+    ProcDefiners_.emplace();
+    for (const auto& object : AllObjects) {
+        for (const auto& [name, ids] : object->Procs) {
+            (*ProcDefiners_)[name].push_back(object.get());
+        }
+    }
+}
+
+bool DMObjectTree::IsProcOverriddenBelow(const DMObject* obj, const std::string& procName) const {
+    if (!ProcDefiners_ || !obj) {
+        return true;
+    }
+    auto it = ProcDefiners_->find(procName);
+    if (it == ProcDefiners_->end()) {
+        return false;
+    }
+    for (const DMObject* definer : it->second) {
+        if (definer != obj && definer->IsSubtypeOf(obj)) {
+            return true;
+        }
+    }
+    // Redefining a proc on the same type makes the call ambiguous for GetProc()
+    const std::vector<int>* ids = obj->GetProcs(procName);
+    return ids != nullptr && ids->size() != 1;
+}
+
+const std::unordered_map<std::string, const DMVariable*>& DMObjectTree::GetAllVariables(DMObject* obj) const {
+    {
+        std::shared_lock lock(ResolutionMutex_);
+        auto it = MergedVariables_.find(obj);
+        if (it != MergedVariables_.end()) {
+            return it->second;
+        }
+    }
+    
+    auto allVars = MergeVariables(obj);
+    std::unique_lock lock(ResolutionMutex_);
+    return MergedVariables_.emplace(obj, std::move(allVars)).first->second;
+}
+
+std::unordered_map<std::string, const DMVariable*> DMObjectTree::MergeVariables(const DMObject* obj) const {
     std::unordered_map<std::string, const DMVariable*> allVars;
     
     if (!obj) {
         return allVars;
     }
     
+    if (const DMObjectMemberTable* members = obj->GetMembers()) {
+        for (const auto& [name, member] : *members) {
+            if (member.Listed) {
+                allVars.emplace(name, member.Listed);
+            }
+        }
+        return allVars;
+    }
+    
     // Collect variables from parent chain (bottom-up so child overrides parent)
-    std::vector<DMObject*> chain;
-    DMObject* current = obj;
+    std::vector<const DMObject*> chain;
+    const DMObject* current = obj;
     while (current != nullptr) {
         chain.push_back(current);
         current = current->Parent;
@@ -214,7 +374,7 @@ std::unordered_map<std::string, const DMVariable*> DMObjectTree::GetAllVariables
     
     // Add variables from root to leaf (so child overrides parent)
     for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
-        DMObject* ancestor = *it;
+        const DMObject* ancestor = *it;
         
         // Add regular variables
         for (const auto& [name, var] : ancestor->Variables) {
@@ -284,6 +444,14 @@ DMObject* DMObjectTree::DetermineParent(const DreamPath& path) {
 }
 
 std::optional<DreamPath> DMObjectTree::UpwardSearch(const DreamPath& path, const DreamPath& search, const std::string& procName) {
+    if (TypesFrozen_) {
+        return Memoize(UpwardSearches_, {path, search, procName},
+                       [&]() { return SearchUpward(path, search, procName); });
+    }
+    return SearchUpward(path, search, procName);
+}
+
+std::optional<DreamPath> DMObjectTree::SearchUpward(const DreamPath& path, const DreamPath& search, const std::string& procName) {
     // Implement full upward search with proc support
     // This searches up the hierarchy for a matching type or proc
     
@@ -329,6 +497,7 @@ std::optional<DreamPath> DMObjectTree::UpwardSearch(const DreamPath& path, const
 
 void DMObjectTree::RegisterGlobalProc(const std::string& procName, int procId) {
     GlobalProcs[procName] = procId;
+    ForgetResolutions();
 }
 
 int DMObjectTree::GetGlobalProcId(const std::string& procName) const {
@@ -366,7 +535,8 @@ void DMObjectTree::AddGlobalConstant(const std::string& name, int value) {
     constant.IsFinal = false;
     constant.IsTmp = false;
     constant.ValType = DMComplexValueType(DMValueType::Num);
-    constant.Value = nullptr;  // Value will be set during initialization
+    ConstantValues_.push_back(std::make_unique<DMASTConstantInteger>(Location::Internal, value));
+    constant.Value = ConstantValues_.back().get();
     
     Globals.push_back(constant);
 }
@@ -434,6 +604,7 @@ void DMObjectTree::AddObjectVar(const DreamPath& owner, DMASTObjectVarDefinition
     
     // Add to the object's variable map
     ownerObj->Variables[var.Name] = var;
+    ForgetResolutions();
 }
 
 void DMObjectTree::AddObjectVarOverride(const DreamPath& owner, DMASTObjectVarOverride* varOverride) {
@@ -454,6 +625,7 @@ void DMObjectTree::AddObjectVarOverride(const DreamPath& owner, DMASTObjectVarOv
     
     // Add to the object's variable override map
     ownerObj->VariableOverrides[var.Name] = var;
+    ForgetResolutions();
 }
 
 DMProc* DMObjectTree::AddProc(const DreamPath& owner, DMASTObjectProcDefinition* procDef) {
@@ -467,6 +639,7 @@ DMProc* DMObjectTree::AddProc(const DreamPath& owner, DMASTObjectProcDefinition*
     
     // Store the proc definition AST for later compilation
     proc->AstBody = procDef->Body.get();  // Store non-owning pointer to proc body
+    proc->AstDefinition = procDef;  // Body may still be deferred (see DMProc::LoadDeferredBody)
     
     // Store the parameter definitions (non-owning pointers)
     for (const auto& param : procDef->Parameters) {
@@ -475,6 +648,7 @@ DMProc* DMObjectTree::AddProc(const DreamPath& owner, DMASTObjectProcDefinition*
     
     // Add the proc to the object
     ownerObj->AddProc(proc->Id, procDef->Name);
+    ForgetResolutions();
     
     // If it's a global proc (owned by root), register it
     if (owner == DreamPath::Root) {
@@ -484,29 +658,21 @@ DMProc* DMObjectTree::AddProc(const DreamPath& owner, DMASTObjectProcDefinition*
     return proc;
 }
 
-std::vector<DMObject*> DMObjectTree::GetAllObjects() const {
-    std::vector<DMObject*> result;
-    result.reserve(AllObjects.size());
-    
-    for (const auto& obj : AllObjects) {
-        result.push_back(obj.get());
-    }
-    
-    return result;
-}
-
-std::vector<DMProc*> DMObjectTree::GetAllProcs() const {
-    std::vector<DMProc*> result;
-    result.reserve(AllProcs.size());
-    
-    for (const auto& proc : AllProcs) {
-        result.push_back(proc.get());
+const std::unordered_map<std::string, DMProc*>& DMObjectTree::GetAllProcsForObject(DMObject* obj) const {
+    {
+        std::shared_lock lock(ResolutionMutex_);
+        auto it = MergedProcs_.find(obj);
+        if (it != MergedProcs_.end()) {
+            return it->second;
+        }
     }
     
-    return result;
+    auto procMap = MergeProcs(obj);
+    std::unique_lock lock(ResolutionMutex_);
+    return MergedProcs_.emplace(obj, std::move(procMap)).first->second;
 }
 
-std::unordered_map<std::string, DMProc*> DMObjectTree::GetAllProcsForObject(DMObject* obj) const {
+std::unordered_map<std::string, DMProc*> DMObjectTree::MergeProcs(const DMObject* obj) const {
     std::unordered_map<std::string, DMProc*> procMap;
     
     if (!obj) {
@@ -514,8 +680,8 @@ std::unordered_map<std::string, DMProc*> DMObjectTree::GetAllProcsForObject(DMOb
     }
     
     // Build hierarchy from current object to root
-    std::vector<DMObject*> hierarchy;
-    DMObject* current = obj;
+    std::vector<const DMObject*> hierarchy;
+    const DMObject* current = obj;
     while (current != nullptr) {
         hierarchy.push_back(current);
         current = current->Parent;
@@ -523,7 +689,7 @@ std::unordered_map<std::string, DMProc*> DMObjectTree::GetAllProcsForObject(DMOb
     
     // Process from root to derived (so derived procs override parent procs)
     for (auto it = hierarchy.rbegin(); it != hierarchy.rend(); ++it) {
-        DMObject* ancestor = *it;
+        const DMObject* ancestor = *it;
         
         // Add all procs from this object
         for (const auto& [name, ids] : ancestor->Procs) {
@@ -549,4 +715,54 @@ void DMObjectTree::SetDMStandardFinalized() {
     }
 }
 
+std::vector<std::unique_ptr<DMProc>> DMObjectTree::RemoveProcs(const std::vector<bool>& keep, OperandEncoding encoding) {
+    std::vector<int> newIds(AllProcs.size(), -1);
+    std::vector<std::unique_ptr<DMProc>> kept;
+    std::vector<std::unique_ptr<DMProc>> removed;
+    for (size_t id = 0; id < AllProcs.size(); ++id) {
+        if (id < keep.size() && keep[id]) {
+            newIds[id] = static_cast<int>(kept.size());
+            kept.push_back(std::move(AllProcs[id]));
+        } else {
+            removed.push_back(std::move(AllProcs[id]));
+        }
+    }
+    AllProcs = std::move(kept);
+    DmProcIdCounter_ = static_cast<int>(AllProcs.size());
+    for (size_t id = 0; id < AllProcs.size(); ++id) {
+        AllProcs[id]->Id = static_cast<int>(id);
+        CallGraph::RenumberProcs(AllProcs[id]->Bytecode, newIds, encoding);
+    }
+    
+    auto renumber = [&](int id) {
+        return id >= 0 && static_cast<size_t>(id) < newIds.size() ? newIds[id] : -1;
+    };
+    for (const auto& object : AllObjects) {
+        for (auto it = object->Procs.begin(); it != object->Procs.end();) {
+            std::vector<int> ids;
+            for (int id : it->second) {
+                if (renumber(id) >= 0) {
+                    ids.push_back(renumber(id));
+                }
+            }
+            it->second = std::move(ids);
+            it = it->second.empty() ? object->Procs.erase(it) : std::next(it);
+        }
+        object->InitializationProc = renumber(object->InitializationProc);
+    }
+    
+    FlatHashMap<int> globalProcs;
+    for (const auto& [name, id] : GlobalProcs) {
+        if (renumber(id) >= 0) {
+            globalProcs.emplace(name, renumber(id));
+        }
+    }
+    GlobalProcs = std::move(globalProcs);
+    
+    // Which types define a name may have changed, and the memos point at dropped procs
+    ProcDefiners_.reset();
+    ForgetResolutions();
+    return removed;
+}
+
 } // namespace DMCompiler
@@ -1,8 +1,12 @@
 #include "DMParser.h"
+#include "TokenStreamDMLexer.h"
 #include "DMCompiler.h"
 #include "DMValueType.h"
+#include "CompileCosts.h"
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <chrono>
 #include <iostream>
 
 namespace DMCompiler {
@@ -26,37 +30,6 @@ const std::array<TokenType, 15> DMParser::AssignTypes_ = {
     TokenType::AssignInto          // := (assign into)
 };
 
-const std::array<TokenType, 4> DMParser::ComparisonTypes_ = {
-    TokenType::Equals,
-    TokenType::NotEquals,
-    TokenType::TildeEquals,        // ~= (equivalence comparison)
-    TokenType::TildeExclamation    // ~! (non-equivalence comparison)
-};
-
-const std::array<TokenType, 4> DMParser::LtGtComparisonTypes_ = {
-    TokenType::Less,
-    TokenType::LessOrEqual,
-    TokenType::Greater,
-    TokenType::GreaterOrEqual
-};
-
-const std::array<TokenType, 2> DMParser::ShiftTypes_ = {
-    TokenType::LeftShift,
-    TokenType::RightShift
-};
-
-const std::array<TokenType, 2> DMParser::PlusMinusTypes_ = {
-    TokenType::Plus,
-    TokenType::Minus
-};
-
-const std::array<TokenType, 4> DMParser::MulDivModTypes_ = {
-    TokenType::Multiply,
-    TokenType::Divide,
-    TokenType::Modulo,
-    TokenType::Power
-};
-
 const std::array<TokenType, 6> DMParser::DereferenceTypes_ = {
     TokenType::Dot,
     TokenType::Colon,
@@ -139,6 +112,12 @@ const std::array<TokenType, 2> DMParser::ForSeparatorTypes_ = {
 DMParser::DMParser(DMCompiler* compiler, DMLexer* lexer)
     : Compiler_(compiler)
     , Lexer_(lexer)
+    , Arena_(nullptr)
+    , DeferSource_(nullptr)
+    , SuppressDiagnostics_(false)
+    , HadSuppressedDiagnostics_(false)
+    , WindowStart_(0)
+    , Position_(0)
     , CurrentPath_(DreamPath::Root)
     , AllowVarDeclExpression_(false)
     , ParsingTernary_(false)
@@ -146,7 +125,8 @@ DMParser::DMParser(DMCompiler* compiler, DMLexer* lexer)
     , NoProgressCounter_(0)
     , NestingDepth_(0)
 {
-    // Initialize by advancing to first token
+    // Position 0 holds a placeholder, so advancing reads the first real token
+    Window_.emplace_back();
     Advance();
 }
 
@@ -154,60 +134,101 @@ DMParser::DMParser(DMCompiler* compiler, DMLexer* lexer)
 // Base Parser Methods
 // ============================================================================
 
-Token DMParser::Advance() {
-    if (!TokenStack_.empty()) {
-        CurrentToken_ = TokenStack_.top();
-        TokenStack_.pop();
-    } else {
-        CurrentToken_ = Lexer_->GetNextToken();
-        
-        // Skip whitespace tokens (DM_Preproc_Whitespace)
-        // The lexer outputs these during preprocessing, but the parser should ignore them
-        while (CurrentToken_.Type == TokenType::DM_Preproc_Whitespace) {
-            CurrentToken_ = Lexer_->GetNextToken();
-        }
-        
-        // Handle error and warning tokens from the lexer/preprocessor
-        // These are emitted when the preprocessor encounters #error or #warn directives
-        while (CurrentToken_.Type == TokenType::DM_Preproc_Error || 
-               CurrentToken_.Type == TokenType::DM_Preproc_Warning) {
-            if (CurrentToken_.Type == TokenType::DM_Preproc_Error) {
-                // Preprocessor #error directive - emit as compiler error
-                Emit(WarningCode::BadToken, "Preprocessor error: " + CurrentToken_.Text);
-            } else {
-                // Preprocessor #warn directive - emit as compiler warning
-                Warning("Preprocessor warning: " + CurrentToken_.Text);
-            }
-            // Skip to next token after handling
-            CurrentToken_ = Lexer_->GetNextToken();
-            
-            // Continue skipping whitespace after error/warning
-            while (CurrentToken_.Type == TokenType::DM_Preproc_Whitespace) {
-                CurrentToken_ = Lexer_->GetNextToken();
-            }
-        }
+const Token& DMParser::Advance() {
+    if (!Failure_.empty()) {
+        return FailedAt_;
+    }
+    ++Position_;
+    if (Position_ - WindowStart_ == Window_.size()) {
+        FetchToken();
     }
 
-    static long long tokenAdvanceCount = 0;
-    tokenAdvanceCount++;
+    // Shared by every parser, including ParallelParser's workers
+    static std::atomic<long long> advanceCounter{0};
+    long long tokenAdvanceCount = ++advanceCounter;
     if (tokenAdvanceCount % 1000 == 0) {
         std::cout << "[parser] advanced " << tokenAdvanceCount
-                  << " tokens, current=" << CurrentToken_.Loc.ToString() << " type="
-                  << static_cast<int>(CurrentToken_.Type) << " text='" << CurrentToken_.Text << "'"
+                  << " tokens, current=" << Current().Loc.ToString() << " type="
+                  << static_cast<int>(Current().Type) << " text='" << Current().Text << "'"
                   << std::endl;
     }
     if (tokenAdvanceCount >= 9500 && tokenAdvanceCount <= 12500) {
         std::cout << "[parser] trace " << tokenAdvanceCount
-                  << " @ " << CurrentToken_.Loc.ToString() << " type="
-                  << static_cast<int>(CurrentToken_.Type) << " text='" << CurrentToken_.Text << "'"
+                  << " @ " << Current().Loc.ToString() << " type="
+                  << static_cast<int>(Current().Type) << " text='" << Current().Text << "'"
                   << std::endl;
     }
-    return CurrentToken_;
+    return Current();
+}
+
+void DMParser::FetchToken() {
+    Token token = Lexer_->GetNextToken();
+    
+    // Skip whitespace tokens (DM_Preproc_Whitespace)
+    // The lexer outputs these during preprocessing, but the parser should ignore them
+    while (token.Type == TokenType::DM_Preproc_Whitespace) {
+        token = Lexer_->GetNextToken();
+    }
+    
+    // Handle error and warning tokens from the lexer/preprocessor
+    // These are emitted when the preprocessor encounters #error or #warn directives.
+    // Tokens are fetched once, so each is reported once however often the parser backtracks
+    while (token.Type == TokenType::DM_Preproc_Error || 
+           token.Type == TokenType::DM_Preproc_Warning) {
+        if (token.Type == TokenType::DM_Preproc_Error) {
+            // Preprocessor #error directive - emit as compiler error
+            Emit(WarningCode::BadToken, token.Loc, "Preprocessor error: " + token.Text);
+        } else {
+            // Preprocessor #warn directive - emit as compiler warning
+            Warning("Preprocessor warning: " + token.Text, &token);
+        }
+        // Skip to next token after handling
+        token = Lexer_->GetNextToken();
+        
+        // Continue skipping whitespace after error/warning
+        while (token.Type == TokenType::DM_Preproc_Whitespace) {
+            token = Lexer_->GetNextToken();
+        }
+    }
+    
+    Window_.push_back(std::move(token));
+}
+
+const Token& DMParser::Peek(size_t offset) {
+    if (!Failure_.empty()) {
+        return FailedAt_;
+    }
+    while (Position_ + offset - WindowStart_ >= Window_.size()) {
+        FetchToken();
+    }
+    return Window_[Position_ + offset - WindowStart_];
+}
+
+void DMParser::DiscardConsumed() {
+    size_t consumed = Position_ - WindowStart_;
+    Window_.erase(Window_.begin(), Window_.begin() + static_cast<std::ptrdiff_t>(consumed));
+    WindowStart_ = Position_;
+}
+
+void DMParser::SetDeferProcBodies(bool defer) {
+    auto* source = dynamic_cast<TokenStreamDMLexer*>(Lexer_);
+    DeferSource_ = defer && source && source->Buffer() && source->Buffer()->IndentationResolved() ? source : nullptr;
+}
+
+std::unique_ptr<DMASTProcBlockInner> DMParser::ParseProcBody(int baseIndent) {
+    Location loc = CurrentLocation();
+    auto body = ProcBlockInner(baseIndent);
+    std::string failure;
+    if (TakeFailure(failure)) {
+        RecoverFromError("Parse error in proc body: " + failure, loc);
+        return NewNode<DMASTProcBlockInner>(loc, std::vector<std::unique_ptr<DMASTProcStatement>>());
+    }
+    return body;
 }
 
 bool DMParser::Check(TokenType type) {
     // Check() just checks - it does NOT advance the token
-    return CurrentToken_.Type == type;
+    return Current().Type == type;
 }
 
 void DMParser::Consume(TokenType type, const std::string& errorMessage) {
@@ -218,13 +239,15 @@ void DMParser::Consume(TokenType type, const std::string& errorMessage) {
     }
 }
 
-void DMParser::ReuseToken(Token token) {
-    TokenStack_.push(CurrentToken_);
-    CurrentToken_ = token;
-}
-
 void DMParser::Warning(const std::string& message, const Token* token) {
-    const Token& t = token ? *token : CurrentToken_;
+    const Token& t = token ? *token : Current();
+    if (!Failure_.empty()) {
+        return;  // Only the failure itself is reported
+    }
+    if (SuppressDiagnostics_) {
+        HadSuppressedDiagnostics_ = true;
+        return;
+    }
     if (Compiler_) {
         // Use ForcedWarning with location info included in message
         Compiler_->ForcedWarning(t.Loc.ToString() + ": " + message);
@@ -232,8 +255,19 @@ void DMParser::Warning(const std::string& message, const Token* token) {
 }
 
 void DMParser::Emit(WarningCode code, const std::string& message) {
+    Emit(code, Current().Loc, message);
+}
+
+void DMParser::Emit(WarningCode code, const Location& location, const std::string& message) {
+    if (!Failure_.empty()) {
+        return;  // Only the failure itself is reported
+    }
+    if (SuppressDiagnostics_) {
+        HadSuppressedDiagnostics_ = true;
+        return;
+    }
     if (Compiler_) {
-        Compiler_->Emit(code, CurrentToken_.Loc, message);
+        Compiler_->Emit(code, location, message);
     }
 }
 
@@ -242,13 +276,32 @@ Location DMParser::CurrentLocation() const {
 }
 
 size_t DMParser::GetTokenPosition() const {
-    const Location& loc = CurrentToken_.Loc;
+    const Location& loc = Current().Loc;
     // Combine line and column into a single value for comparison
     // Line * 100000 + Column gives a unique position identifier
     return static_cast<size_t>(loc.Line) * 100000 + static_cast<size_t>(loc.Column);
 }
 
+void DMParser::Fail(const std::string& reason) {
+    if (Failure_.empty()) {
+        FailedAt_ = Token(TokenType::EndOfFile, "", Current().Loc);
+        Failure_ = reason;
+    }
+}
+
+bool DMParser::TakeFailure(std::string& reason) {
+    if (Failure_.empty()) {
+        return false;
+    }
+    reason = std::move(Failure_);
+    Failure_.clear();
+    return true;
+}
+
 bool DMParser::CheckProgress() {
+    if (!Failure_.empty()) {
+        return true;  // Unwinding, which never moves
+    }
     size_t currentPosition = GetTokenPosition();
     
     if (currentPosition == LastTokenPosition_) {
@@ -257,8 +310,8 @@ bool DMParser::CheckProgress() {
         if (NoProgressCounter_ >= Limits::MAX_NO_PROGRESS_ITERATIONS) {
             // We're stuck in an infinite loop
             Emit(WarningCode::BadToken, 
-                 "Parser stuck at position " + std::to_string(CurrentToken_.Loc.Line) + 
-                 ":" + std::to_string(CurrentToken_.Loc.Column) + 
+                 "Parser stuck at position " + std::to_string(Current().Loc.Line) + 
+                 ":" + std::to_string(Current().Loc.Column) + 
                  " after " + std::to_string(NoProgressCounter_) + " iterations");
             
             // Reset counter and try to advance
@@ -284,14 +337,29 @@ bool DMParser::IsInSet(TokenType type, const std::vector<TokenType>& set) const
 
 std::unique_ptr<DMASTFile> DMParser::ParseFile() {
     Location loc = CurrentLocation();
+    
+    // The arena is declared before the statements so it outlives them if
+    // parsing throws, and is handed to the file at the end
+    auto arena = std::make_unique<DMASTArena>();
+    struct ArenaScope {
+        DMASTArena*& Current;
+        ~ArenaScope() { Current = nullptr; }
+    } arenaScope{Arena_};
+    Arena_ = arena.get();
+    
     std::vector<std::unique_ptr<DMASTStatement>> statements;
     
     Whitespace();
     
     Location lastLoc;
-    int stuckCounter = 0;
+    
+    // Each top-level statement is charged to the file it starts in
+    CompileCosts* costs = Compiler_ ? Compiler_->GetCosts() : nullptr;
     
     while (Current().Type != TokenType::EndOfFile) {
+        // Nothing before a top-level statement is revisited
+        DiscardConsumed();
+        
         if (Compiler_) {
             std::string progress = "Parsing (Line " + std::to_string(Current().Loc.Line) + ")";
             Compiler_->CheckProgress(progress);
@@ -299,36 +367,25 @@ std::unique_ptr<DMASTFile> DMParser::ParseFile() {
         
         Location currentLoc = CurrentLocation();
         
-        // Detect if we're stuck on the same position
-        if (currentLoc.Line == lastLoc.Line && currentLoc.Column == lastLoc.Column && currentLoc.SourceFile == lastLoc.SourceFile) {
-            stuckCounter++;
-            if (stuckCounter > 100) {
-                // Force advance to break the loop
-                Advance();
-                stuckCounter = 0;
-                continue;
-            }
-        } else {
-            stuckCounter = 0;
-            lastLoc = currentLoc;
+        // A statement that got nowhere would only get nowhere again
+        if (currentLoc.Line == lastLoc.Line && currentLoc.Column == lastLoc.Column && currentLoc.FileId == lastLoc.FileId) {
+            SkipToTopLevel();
+            Whitespace();
+            continue;
         }
+        lastLoc = currentLoc;
         
-        try {
-            auto stmt = Statement();
-            if (stmt) {
-                statements.push_back(std::move(stmt));
-            } else {
-                // If we can't parse a statement, skip to next line to avoid infinite loop
-                while (Current().Type != TokenType::Newline && Current().Type != TokenType::EndOfFile) {
-                    Advance();
-                }
-                if (Current().Type == TokenType::Newline) {
-                    Advance();
-                }
-            }
-        } catch (const std::exception& e) {
+        auto statementStart = costs ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        auto stmt = Statement();
+        std::string failure;
+        if (TakeFailure(failure)) {
             // Recover from parse error and continue
-            RecoverFromError(std::string("Parse error: ") + e.what(), currentLoc);
+            RecoverFromError("Parse error: " + failure, currentLoc);
+        } else if (stmt) {
+            statements.push_back(std::move(stmt));
+        } else {
+            // Its indented lines belong to it, so resume after them
+            SkipToTopLevel();
         }
         
         // Skip statement terminators
@@ -337,9 +394,16 @@ std::unique_ptr<DMASTFile> DMParser::ParseFile() {
         }
         
         Whitespace();
+        if (costs) {
+            costs->AddFileTime(currentLoc.FileId, CompileCosts::FileStage::Parse,
+                               std::chrono::steady_clock::now() - statementStart);
+        }
     }
     
-    return std::make_unique<DMASTFile>(loc, std::move(statements));
+    // The file itself stays on the heap since its destruction frees the arena
+    auto file = std::make_unique<DMASTFile>(loc, std::move(statements));
+    file->Arena = std::move(arena);
+    return file;
 }
 
 std::vector<std::unique_ptr<DMASTStatement>> DMParser::BlockInner() {
@@ -364,22 +428,21 @@ std::vector<std::unique_ptr<DMASTStatement>> DMParser::BlockInner() {
         }
         
         Location stmtLoc = CurrentLocation();
-        try {
-            auto stmt = Statement();
-            if (stmt) {
-                statements.push_back(std::move(stmt));
-            } else {
-                // If Statement() returns null, skip to next line to avoid infinite loop
-                while (Current().Type != TokenType::Newline && 
-                       Current().Type != TokenType::Semicolon &&
-                       Current().Type != TokenType::RightCurlyBracket &&
-                       Current().Type != TokenType::EndOfFile) {
-                    Advance();
-                }
-            }
-        } catch (const std::exception& e) {
+        auto stmt = Statement();
+        std::string failure;
+        if (TakeFailure(failure)) {
             // Recover from parse error and continue
-            RecoverFromError(std::string("Parse error in block: ") + e.what(), stmtLoc);
+            RecoverFromError("Parse error in block: " + failure, stmtLoc);
+        } else if (stmt) {
+            statements.push_back(std::move(stmt));
+        } else {
+            // If Statement() returns null, skip to next line to avoid infinite loop
+            while (Current().Type != TokenType::Newline && 
+                   Current().Type != TokenType::Semicolon &&
+                   Current().Type != TokenType::RightCurlyBracket &&
+                   Current().Type != TokenType::EndOfFile) {
+                Advance();
+            }
         }
         
         // Skip statement terminators
@@ -407,7 +470,7 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlock() {
     if (block) {
         // Separate set statements from other statements
         for (auto& stmt : block->Statements) {
-            if (dynamic_cast<DMASTProcStatementSet*>(stmt.get())) {
+            if (DMASTCast<DMASTProcStatementSet>(stmt.get())) {
                 setStatements.push_back(std::move(stmt));
             } else {
                 statements.push_back(std::move(stmt));
@@ -415,7 +478,7 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlock() {
         }
     }
     
-    return std::make_unique<DMASTProcBlockInner>(
+    return NewNode<DMASTProcBlockInner>(
         loc,
         std::move(statements),
         std::move(setStatements)
@@ -434,8 +497,16 @@ std::unique_ptr<DMASTExpression> DMParser::Expression() {
         return nullptr;
     }
     
+    if (!Failure_.empty()) {
+        return nullptr;
+    }
+    
     // Guard against excessive nesting depth
-    RecursionGuard guard(NestingDepth_, Limits::MAX_NESTING_DEPTH, "Expression");
+    RecursionGuard guard(NestingDepth_, Limits::MAX_NESTING_DEPTH);
+    if (guard.Exceeded()) {
+        Fail("Maximum nesting depth exceeded in Expression");
+        return nullptr;
+    }
     
     // Expression() calls the lowest precedence level
     // Assignment has very low precedence (only comma operator is lower)
@@ -444,37 +515,36 @@ std::unique_ptr<DMASTExpression> DMParser::Expression() {
 
 std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
     Location loc = CurrentLocation();
-    Token token = Current();
 
     // Tolerate stray indentation and preprocessor whitespace tokens in
     // expression contexts by treating them as whitespace and continuing. This
     // mirrors BYOND's loose indentation handling and prevents hard parse
     // failures on malformed blocks.
-        while (token.Type == TokenType::Indent ||
-            token.Type == TokenType::Dedent ||
-            token.Type == TokenType::DM_Preproc_Whitespace ||
-            token.Type == TokenType::Newline) {
+    while (Current().Type == TokenType::Indent ||
+           Current().Type == TokenType::Dedent ||
+           Current().Type == TokenType::DM_Preproc_Whitespace ||
+           Current().Type == TokenType::Newline) {
         Advance();
-        token = Current();
         loc = CurrentLocation();
     }
+    const Token& token = Current();
     
     // Integer literal
     if (token.Type == TokenType::Number) {
         // Check if it's an integer or float
         if (token.Value.ValueType == Token::TokenValue::Type::Int) {
             Advance();
-            return std::make_unique<DMASTConstantInteger>(loc, token.Value.IntValue);
+            return NewNode<DMASTConstantInteger>(loc, token.Value.IntValue);
         } else if (token.Value.ValueType == Token::TokenValue::Type::Float) {
             Advance();
-            return std::make_unique<DMASTConstantFloat>(loc, token.Value.FloatValue);
+            return NewNode<DMASTConstantFloat>(loc, token.Value.FloatValue);
         }
     }
     
     // String literal
     if (token.Type == TokenType::String) {
         Advance();
-        return std::make_unique<DMASTConstantString>(loc, token.Value.StringValue);
+        return NewNode<DMASTConstantString>(loc, token.Value.StringValue);
     }
     
     // Interpolated string (starts with DM_Preproc_StringBegin)
@@ -485,32 +555,33 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
     // Resource literal
     if (token.Type == TokenType::Resource) {
         Advance();
-        return std::make_unique<DMASTConstantResource>(loc, token.Value.StringValue);
+        return NewNode<DMASTConstantResource>(loc, token.Value.StringValue);
     }
     
     // Null literal
     if (token.Type == TokenType::Null) {
         Advance();
-        return std::make_unique<DMASTConstantNull>(loc);
+        return NewNode<DMASTConstantNull>(loc);
     }
     
     // Super proc call: ..
     // Check BEFORE path expression to distinguish .. (super) from ../path (upward path)
     if (token.Type == TokenType::DotDot) {
         // Peek ahead to see if it's followed by ( for super call or / for upward path
-        Token nextToken = Advance();
+        size_t dotDot = Mark();
+        const Token& nextToken = Advance();
         if (nextToken.Type == TokenType::LeftParenthesis) {
             // It's a super call: ..()
             // Return a special identifier that CompileCall will recognize
-            return std::make_unique<DMASTIdentifier>(loc, "..");
+            return NewNode<DMASTIdentifier>(loc, "..");
         } else if (nextToken.Type == TokenType::Divide) {
             // It's an upward path: ../something
             // Backtrack and parse as path
-            ReuseToken(token);
+            Rewind(dotDot);
             return PathExpression();
         } else {
             // Just .. by itself - treat as super proc reference
-            return std::make_unique<DMASTIdentifier>(loc, "..");
+            return NewNode<DMASTIdentifier>(loc, "..");
         }
     }
     
@@ -520,7 +591,7 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
         // The single dot (.) represents the proc's return value ("self")
         // We need to consume it and return an identifier, letting postfix handle any following operations
         Advance();  // Consume the dot
-        return std::make_unique<DMASTIdentifier>(loc, ".");
+        return NewNode<DMASTIdentifier>(loc, ".");
     }
     
     // Path expression: /mob/player or ../parent or ./child
@@ -544,7 +615,7 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
             return ListExpression(listLoc, false); // false = not associative
         } else {
             // Just an identifier named 'list'
-            return std::make_unique<DMASTIdentifier>(listLoc, "list");
+            return NewNode<DMASTIdentifier>(listLoc, "list");
         }
     }
     
@@ -556,7 +627,7 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
             return NewListExpression(newlistLoc);
         } else {
             // Just an identifier named 'newlist'
-            return std::make_unique<DMASTIdentifier>(newlistLoc, "newlist");
+            return NewNode<DMASTIdentifier>(newlistLoc, "newlist");
         }
     }
     
@@ -567,7 +638,7 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
         Advance();
         // For now, just return an identifier expression
         // Later we'll handle paths and member access
-        return std::make_unique<DMASTIdentifier>(loc, identifier);
+        return NewNode<DMASTIdentifier>(loc, identifier);
     }
     
     // Parenthesized expression
@@ -579,14 +650,14 @@ std::unique_ptr<DMASTExpression> DMParser::PrimaryExpression() {
     }
     
     // If we get here, it's an error
-    Emit(WarningCode::BadToken, "Expected expression, got '" + token.Text + "' (type: " + std::to_string(static_cast<int>(token.Type)) + ") at " + token.Loc.SourceFile + ":" + std::to_string(token.Loc.Line) + ":" + std::to_string(token.Loc.Column));
+    Emit(WarningCode::BadToken, "Expected expression, got '" + token.Text + "' (type: " + std::to_string(static_cast<int>(token.Type)) + ") at " + token.Loc.SourceFile() + ":" + std::to_string(token.Loc.Line) + ":" + std::to_string(token.Loc.Column));
     Advance(); // Skip the bad token
-    return std::make_unique<DMASTConstantNull>(loc); // Return null as error recovery
+    return NewNode<DMASTConstantNull>(loc); // Return null as error recovery
 }
 
 std::unique_ptr<DMASTExpression> DMParser::UnaryExpression() {
     Location loc = CurrentLocation();
-    Token token = Current();
+    const Token& token = Current();
     
     // Check for unary operators: -, !, ~, ++, --
     if (token.Type == TokenType::Minus || 
@@ -598,151 +669,85 @@ std::unique_ptr<DMASTExpression> DMParser::UnaryExpression() {
         UnaryOperator op = TokenTypeToUnaryOp(token.Type);
         Advance();
         auto operand = UnaryExpression(); // Right-associative
-        return std::make_unique<DMASTExpressionUnary>(loc, op, std::move(operand));
+        return NewNode<DMASTExpressionUnary>(loc, op, std::move(operand));
     }
     
     // Not a unary operator, parse postfix expression
     return PostfixExpression();
 }
 
-std::unique_ptr<DMASTExpression> DMParser::MultiplicationExpression() {
-    auto left = UnaryExpression();
-    
-    while (IsInSet(Current().Type, MulDivModTypes_)) {
-        Location loc = CurrentLocation();
-        BinaryOperator op = TokenTypeToBinaryOp(Current().Type);
-        Advance();
-        auto right = UnaryExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::AdditionExpression() {
-    auto left = MultiplicationExpression();
-    
-    while (IsInSet(Current().Type, PlusMinusTypes_)) {
-        Location loc = CurrentLocation();
-        BinaryOperator op = TokenTypeToBinaryOp(Current().Type);
-        Advance();
-        auto right = MultiplicationExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::ShiftExpression() {
-    auto left = AdditionExpression();
-    
-    // Left-associative: keep consuming while we see << or >>
-    while (IsInSet(Current().Type, ShiftTypes_)) {
-        Location loc = CurrentLocation();
-        BinaryOperator op = TokenTypeToBinaryOp(Current().Type);
-        Advance();
-        auto right = AdditionExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
+// Binding power of each binary operator, loosest first
+enum class BindingPower {
+    None,
+    LogicalOr,
+    LogicalAnd,
+    BitwiseOr,
+    BitwiseXor,
+    BitwiseAnd,
+    Comparison,
+    Shift,
+    Additive,
+    Multiplicative
+};
 
-std::unique_ptr<DMASTExpression> DMParser::ComparisonExpression() {
-    auto left = ShiftExpression();
-    
-    // Left-associative: keep consuming while we see comparison operators
-    // Handles: ==, !=, <, >, <=, >=, in, to
-    while (IsInSet(Current().Type, ComparisonTypes_) || 
-           IsInSet(Current().Type, LtGtComparisonTypes_) ||
-           Current().Type == TokenType::In ||
-           Current().Type == TokenType::To) {
-        Location loc = CurrentLocation();
+static int BinaryPrecedence(TokenType type) {
+    BindingPower power;
+    switch (type) {
+        case TokenType::LogicalOr: power = BindingPower::LogicalOr; break;
+        case TokenType::LogicalAnd: power = BindingPower::LogicalAnd; break;
+        case TokenType::BitwiseOr: power = BindingPower::BitwiseOr; break;
+        case TokenType::BitwiseXor: power = BindingPower::BitwiseXor; break;
+        case TokenType::BitwiseAnd: power = BindingPower::BitwiseAnd; break;
         
-        // Map token to binary operator
-        BinaryOperator op;
-        if (Current().Type == TokenType::In) {
-            op = BinaryOperator::In;
-        } else if (Current().Type == TokenType::To) {
-            op = BinaryOperator::To;
-        } else {
-            op = TokenTypeToBinaryOp(Current().Type);
-        }
+        case TokenType::Equals:
+        case TokenType::NotEquals:
+        case TokenType::TildeEquals:       // ~= (equivalence comparison)
+        case TokenType::TildeExclamation:  // ~! (non-equivalence comparison)
+        case TokenType::Less:
+        case TokenType::LessOrEqual:
+        case TokenType::Greater:
+        case TokenType::GreaterOrEqual:
+        case TokenType::In:
+        case TokenType::To:
+            power = BindingPower::Comparison;
+            break;
         
-        Advance();
-        auto right = ShiftExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::BitwiseAndExpression() {
-    auto left = ComparisonExpression();
-    
-    // Left-associative: keep consuming while we see &
-    while (Current().Type == TokenType::BitwiseAnd) {
-        Location loc = CurrentLocation();
-        Advance();
-        auto right = ComparisonExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, BinaryOperator::BitwiseAnd, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::BitwiseXorExpression() {
-    auto left = BitwiseAndExpression();
-    
-    // Left-associative: keep consuming while we see ^
-    while (Current().Type == TokenType::BitwiseXor) {
-        Location loc = CurrentLocation();
-        Advance();
-        auto right = BitwiseAndExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, BinaryOperator::BitwiseXor, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::BitwiseOrExpression() {
-    auto left = BitwiseXorExpression();
-    
-    // Left-associative: keep consuming while we see |
-    while (Current().Type == TokenType::BitwiseOr) {
-        Location loc = CurrentLocation();
-        Advance();
-        auto right = BitwiseXorExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, BinaryOperator::BitwiseOr, std::move(left), std::move(right));
-    }
-    
-    return left;
-}
-
-std::unique_ptr<DMASTExpression> DMParser::LogicalAndExpression() {
-    auto left = BitwiseOrExpression();
-    
-    // Left-associative: keep consuming while we see &&
-    while (Current().Type == TokenType::LogicalAnd) {
-        Location loc = CurrentLocation();
-        Advance();
-        auto right = BitwiseOrExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, BinaryOperator::LogicalAnd, std::move(left), std::move(right));
+        case TokenType::LeftShift:
+        case TokenType::RightShift:
+            power = BindingPower::Shift;
+            break;
+        
+        case TokenType::Plus:
+        case TokenType::Minus:
+            power = BindingPower::Additive;
+            break;
+        
+        case TokenType::Multiply:
+        case TokenType::Divide:
+        case TokenType::Modulo:
+        case TokenType::Power:
+            power = BindingPower::Multiplicative;
+            break;
+        
+        default:
+            power = BindingPower::None;
+            break;
     }
-    
-    return left;
+    return static_cast<int>(power);
 }
 
-std::unique_ptr<DMASTExpression> DMParser::LogicalOrExpression() {
-    auto left = LogicalAndExpression();
+std::unique_ptr<DMASTExpression> DMParser::BinaryExpression(int minPrecedence) {
+    auto left = UnaryExpression();
     
-    // Left-associative: keep consuming while we see ||
-    // OR has lower precedence than AND, so we call LogicalAndExpression()
-    while (Current().Type == TokenType::LogicalOr) {
+    // Every binary operator is left-associative, so the right operand only
+    // takes operators binding tighter than the one just consumed
+    int precedence;
+    while ((precedence = BinaryPrecedence(Current().Type)) != 0 && precedence >= minPrecedence) {
         Location loc = CurrentLocation();
+        BinaryOperator op = TokenTypeToBinaryOp(Current().Type);
         Advance();
-        auto right = LogicalAndExpression();
-        left = std::make_unique<DMASTExpressionBinary>(loc, BinaryOperator::LogicalOr, std::move(left), std::move(right));
+        auto right = BinaryExpression(precedence + 1);
+        left = NewNode<DMASTExpressionBinary>(loc, op, std::move(left), std::move(right));
     }
     
     return left;
@@ -784,7 +789,7 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
         // than runtime member access when the left side is a constant-like identifier
         // (e.g., direction constants WEST/EAST). This prevents misclassifying
         // "? WEST : EAST" as a member lookup on WEST.
-        auto* identExpr = dynamic_cast<DMASTIdentifier*>(expr.get());
+        auto* identExpr = DMASTCast<DMASTIdentifier>(expr.get());
         bool looksConstantIdentifier = false;
         if (identExpr) {
             const std::string& name = identExpr->Identifier;
@@ -798,18 +803,17 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
         if (Current().Type == TokenType::Colon && !justCompletedCall && !shouldTreatColonAsTernary) {
             // First check: is the left side a valid dereference target?
             // Literals (numbers, strings, null, etc.) cannot have member access
-            bool isValidDerefTarget = dynamic_cast<DMASTIdentifier*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTDereference*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTExpressionUnary*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTCall*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTNewPath*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTNewList*>(expr.get()) != nullptr ||
-                                      dynamic_cast<DMASTList*>(expr.get()) != nullptr;
+            bool isValidDerefTarget = DMASTCast<DMASTIdentifier>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTDereference>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTExpressionUnary>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTCall>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTNewPath>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTNewList>(expr.get()) != nullptr ||
+                                      DMASTCast<DMASTList>(expr.get()) != nullptr;
             
             if (isValidDerefTarget) {
                 // Peek at next token to see if it's a property name (member access) or something else (ternary separator)
-                Token colonToken = Current();
-                Token nextToken = Advance();
+                const Token& nextToken = Peek();
                 
                 // For member access, the next token should be a simple identifier or keyword-as-identifier
                 // But NOT something that would start a full expression (like null, new, etc.)
@@ -829,13 +833,8 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                 if (isPropertyName) {
                     // Colon followed by property name = member access
                     isColonMemberAccess = true;
-                    ReuseToken(nextToken);
-                    CurrentToken_ = colonToken;
-                } else {
-                    // Colon followed by something else = ternary separator or other use
-                    ReuseToken(nextToken);
-                    CurrentToken_ = colonToken;
                 }
+                // Otherwise the colon is a ternary separator or some other use
             }
             // If not a valid deref target (e.g., literal 1000), don't check for member access
             // Let the colon be treated as ternary separator
@@ -858,7 +857,7 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                 Location propLoc = CurrentLocation();
                 std::string propName = Current().Text;
                 Advance();
-                property = std::make_unique<DMASTIdentifier>(propLoc, propName);
+                property = NewNode<DMASTIdentifier>(propLoc, propName);
             } else if (Current().Type == TokenType::LeftBracket) {
                 // Dynamic property access: obj.[expression]
                 Advance();
@@ -873,7 +872,7 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                 break;
             }
             
-            expr = std::make_unique<DMASTDereference>(loc, std::move(expr), derefType, std::move(property));
+            expr = NewNode<DMASTDereference>(loc, std::move(expr), derefType, std::move(property));
         }
         // Function call: func(args)
         else if (Current().Type == TokenType::LeftParenthesis) {
@@ -881,7 +880,7 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
             
             // Check if this is a pick() call which has special weighted syntax
             bool isPickCall = false;
-            if (auto* ident = dynamic_cast<DMASTIdentifier*>(expr.get())) {
+            if (auto* ident = DMASTCast<DMASTIdentifier>(expr.get())) {
                 isPickCall = (ident->Identifier == "pick");
             }
             
@@ -894,9 +893,9 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                     // In DM, func(a,,b) is valid and the middle argument is null
                     if (Current().Type == TokenType::Comma) {
                         // Empty argument - push a null placeholder
-                        parameters.push_back(std::make_unique<DMASTCallParameter>(
+                        parameters.push_back(NewNode<DMASTCallParameter>(
                             CurrentLocation(), 
-                            std::make_unique<DMASTConstantNull>(CurrentLocation())));
+                            NewNode<DMASTConstantNull>(CurrentLocation())));
                         Advance(); // consume comma
                         continue;
                     }
@@ -915,7 +914,7 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                         auto valueExpr = TernaryExpression();
                         
                         // Use Key for weight, Value for the actual value
-                        parameters.push_back(std::make_unique<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
+                        parameters.push_back(NewNode<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
                     }
                     // Check for named parameter syntax: name = value
                     else if (Current().Type == TokenType::Assign) {
@@ -926,10 +925,10 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
                         auto valueExpr = TernaryExpression();
                         
                         // Create a named parameter: key is the name, value is the expression
-                        parameters.push_back(std::make_unique<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
+                        parameters.push_back(NewNode<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
                     } else {
                         // Simple positional argument
-                        parameters.push_back(std::make_unique<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
+                        parameters.push_back(NewNode<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
                     }
 
                     // BYOND allows trailing "as type" annotations in some contexts (e.g., input).
@@ -952,10 +951,10 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
             }
             
             Consume(TokenType::RightParenthesis, "Expected ')' after function arguments");
-            auto call = std::make_unique<DMASTCall>(loc, std::move(expr), std::move(parameters));
+            auto call = NewNode<DMASTCall>(loc, std::move(expr), std::move(parameters));
             
             // Check if this is an input() call and parse "as type" and "in list" clauses
-            if (auto* ident = dynamic_cast<DMASTIdentifier*>(call->Target.get())) {
+            if (auto* ident = DMASTCast<DMASTIdentifier>(call->Target.get())) {
                 if (ident->Identifier == "input") {
                     call->IsInputCall = true;
                     
@@ -1002,19 +1001,19 @@ std::unique_ptr<DMASTExpression> DMParser::PostfixExpression() {
             Consume(TokenType::RightBracket, "Expected ']' after array index");
             
             // Array indexing is represented as dereference with the index as the property
-            expr = std::make_unique<DMASTDereference>(loc, std::move(expr), DereferenceType::Index, std::move(index));
+            expr = NewNode<DMASTDereference>(loc, std::move(expr), DereferenceType::Index, std::move(index));
             justCompletedCall = false;
         }
         // Post-increment: x++
         else if (Current().Type == TokenType::Increment) {
             Advance();
-            expr = std::make_unique<DMASTExpressionUnary>(loc, UnaryOperator::PostIncrement, std::move(expr));
+            expr = NewNode<DMASTExpressionUnary>(loc, UnaryOperator::PostIncrement, std::move(expr));
             justCompletedCall = false;
         }
         // Post-decrement: x--
         else if (Current().Type == TokenType::Decrement) {
             Advance();
-            expr = std::make_unique<DMASTExpressionUnary>(loc, UnaryOperator::PostDecrement, std::move(expr));
+            expr = NewNode<DMASTExpressionUnary>(loc, UnaryOperator::PostDecrement, std::move(expr));
             justCompletedCall = false;
         }
         // No more postfix operations
@@ -1082,7 +1081,7 @@ std::unique_ptr<DMASTExpression> DMParser::PathExpression() {
     // Create DreamPath from pathType and elements (not from string!)
     DreamPath dreamPath(pathType, elements);
     DMASTPath astPath(loc, dreamPath);
-    return std::make_unique<DMASTConstantPath>(loc, astPath);
+    return NewNode<DMASTConstantPath>(loc, astPath);
 }
 
 // Parse interpolated string: "start [expr1] middle [expr2] end"
@@ -1095,7 +1094,7 @@ std::unique_ptr<DMASTExpression> DMParser::ParseInterpolatedString() {
     // First part is the StringBegin token
     if (Current().Type != TokenType::DM_Preproc_StringBegin) {
         Emit(WarningCode::BadToken, "Expected string begin in interpolated string");
-        return std::make_unique<DMASTConstantString>(loc, "");
+        return NewNode<DMASTConstantString>(loc, "");
     }
     
     stringParts.push_back(Current().Value.StringValue);
@@ -1129,7 +1128,7 @@ std::unique_ptr<DMASTExpression> DMParser::ParseInterpolatedString() {
         }
     }
     
-    return std::make_unique<DMASTStringFormat>(loc, std::move(stringParts), std::move(expressions));
+    return NewNode<DMASTStringFormat>(loc, std::move(stringParts), std::move(expressions));
 }
 
 // Parse new expressions: new /type or new type() or just new (infer type from context)
@@ -1174,9 +1173,9 @@ std::unique_ptr<DMASTExpression> DMParser::NewExpression() {
                     Location paramLoc = CurrentLocation();
                     Advance(); // consume '='
                     auto valueExpr = TernaryExpression();
-                    parameters.push_back(std::make_unique<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
+                    parameters.push_back(NewNode<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
                 } else {
-                    parameters.push_back(std::make_unique<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
+                    parameters.push_back(NewNode<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
                 }
                 
                 if (Current().Type == TokenType::Comma) {
@@ -1190,7 +1189,7 @@ std::unique_ptr<DMASTExpression> DMParser::NewExpression() {
         Consume(TokenType::RightParenthesis, "Expected ')' after new arguments");
     }
     
-    return std::make_unique<DMASTNewPath>(loc, std::move(typeExpr), std::move(parameters));
+    return NewNode<DMASTNewPath>(loc, std::move(typeExpr), std::move(parameters));
 }
 
 // Parse list expressions: list(1, 2, 3) or list("key" = value, ...)
@@ -1225,10 +1224,10 @@ std::unique_ptr<DMASTExpression> DMParser::ListExpression(const Location& loc, b
                 
                 // Create an association expression (key, value pair)
                 // DMASTCallParameter takes (location, value, key)
-                values.push_back(std::make_unique<DMASTCallParameter>(assocLoc, std::move(valueExpr), std::move(keyExpr)));
+                values.push_back(NewNode<DMASTCallParameter>(assocLoc, std::move(valueExpr), std::move(keyExpr)));
             } else {
                 // Simple value
-                values.push_back(std::make_unique<DMASTCallParameter>(keyExpr->Location_, std::move(keyExpr)));
+                values.push_back(NewNode<DMASTCallParameter>(keyExpr->Location_, std::move(keyExpr)));
             }
             
             // Skip whitespace and newlines after element
@@ -1249,7 +1248,7 @@ std::unique_ptr<DMASTExpression> DMParser::ListExpression(const Location& loc, b
     }
     
     Consume(TokenType::RightParenthesis, "Expected ')' after list values");
-    return std::make_unique<DMASTList>(loc, std::move(values), isAssociative);
+    return NewNode<DMASTList>(loc, std::move(values), isAssociative);
 }
 
 // Parse newlist expressions: newlist(/obj/item, /mob/player)
@@ -1269,9 +1268,9 @@ std::unique_ptr<DMASTExpression> DMParser::NewListExpression(const Location& loc
                 Location paramLoc = CurrentLocation();
                 Advance(); // consume '='
                 auto valueExpr = TernaryExpression();
-                parameters.push_back(std::make_unique<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
+                parameters.push_back(NewNode<DMASTCallParameter>(paramLoc, std::move(valueExpr), std::move(argExpr)));
             } else {
-                parameters.push_back(std::make_unique<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
+                parameters.push_back(NewNode<DMASTCallParameter>(argExpr->Location_, std::move(argExpr)));
             }
             
             if (Current().Type == TokenType::Comma) {
@@ -1283,12 +1282,12 @@ std::unique_ptr<DMASTExpression> DMParser::NewListExpression(const Location& loc
     }
     
     Consume(TokenType::RightParenthesis, "Expected ')' after newlist parameters");
-    return std::make_unique<DMASTNewList>(loc, std::move(parameters));
+    return NewNode<DMASTNewList>(loc, std::move(parameters));
 }
 
 std::unique_ptr<DMASTExpression> DMParser::TernaryExpression() {
     // Parse condition
-    auto condition = LogicalOrExpression();
+    auto condition = BinaryExpression();
     
     // Check for ternary operator (? :)
     // Ternary is RIGHT-associative: a ? b : c ? d : e means a ? b : (c ? d : e)
@@ -1318,13 +1317,13 @@ std::unique_ptr<DMASTExpression> DMParser::TernaryExpression() {
             Current().Type == TokenType::DM_Preproc_StringEnd ||
             Current().Type == TokenType::RightBracket) {
             // Empty false branch - use null
-            falseExpr = std::make_unique<DMASTConstantNull>(loc);
+            falseExpr = NewNode<DMASTConstantNull>(loc);
         } else {
             // Parse false branch (recursive for right-associativity)
             falseExpr = TernaryExpression();
         }
         
-        return std::make_unique<DMASTTernary>(loc, std::move(condition), std::move(trueExpr), std::move(falseExpr));
+        return NewNode<DMASTTernary>(loc, std::move(condition), std::move(trueExpr), std::move(falseExpr));
     }
     
     // Not a ternary, just return the expression
@@ -1346,7 +1345,7 @@ std::unique_ptr<DMASTExpression> DMParser::AssignmentExpression() {
         // Recursively parse right side (allows chaining: x = y = z)
         auto right = AssignmentExpression();
         
-        return std::make_unique<DMASTAssign>(loc, std::move(left), op, std::move(right));
+        return NewNode<DMASTAssign>(loc, std::move(left), op, std::move(right));
     }
     
     // Not an assignment, just return the expression
@@ -1388,6 +1387,14 @@ BinaryOperator DMParser::TokenTypeToBinaryOp(TokenType type) {
         case TokenType::BitwiseXor: return BinaryOperator::BitwiseXor;
         case TokenType::BitwiseOr: return BinaryOperator::BitwiseOr;
         
+        // Logical operators
+        case TokenType::LogicalAnd: return BinaryOperator::LogicalAnd;
+        case TokenType::LogicalOr: return BinaryOperator::LogicalOr;
+        
+        // Membership and range (DM-specific)
+        case TokenType::In: return BinaryOperator::In;
+        case TokenType::To: return BinaryOperator::To;
+        
         default:
             return BinaryOperator::Add; // Should never reach here
     }
@@ -1560,9 +1567,32 @@ void DMParser::SkipToNextStatement() {
     }
 }
 
+void DMParser::SkipToTopLevel() {
+    // Indentation is settled into Indent (before a deeper line's Newline) and
+    // Dedent (after a shallower one's) markers, so the next top-level line
+    // follows the Newline or Dedent that brings the depth back to zero
+    int depth = 0;
+    while (Current().Type != TokenType::EndOfFile) {
+        TokenType type = Current().Type;
+        Advance();
+        if (type == TokenType::Indent) {
+            ++depth;
+        } else if (type == TokenType::Dedent) {
+            depth = depth > 0 ? depth - 1 : 0;
+        } else if (type != TokenType::Newline) {
+            continue;
+        }
+        if (depth == 0 && Current().Type != TokenType::Dedent) {
+            return;
+        }
+    }
+}
+
 void DMParser::RecoverFromError(const std::string& errorMessage, const Location& loc) {
     // Emit warning about the skipped content
-    if (Compiler_) {
+    if (SuppressDiagnostics_) {
+        HadSuppressedDiagnostics_ = true;
+    } else if (Compiler_) {
         std::string message = errorMessage + " at " + loc.ToString();
         message += " (skipping to next statement)";
         Compiler_->ForcedWarning(message);
@@ -1599,14 +1629,13 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlockInner(int baseIndent) {
                 continue;
             }
             Location stmtLoc = CurrentLocation();
-            try {
-                auto stmt = ProcStatement();
-                if (stmt) {
-                    statements.push_back(std::move(stmt));
-                }
-            } catch (const std::exception& e) {
+            auto stmt = ProcStatement();
+            std::string failure;
+            if (TakeFailure(failure)) {
                 // Recover from parse error and continue
-                RecoverFromError(std::string("Parse error in proc body: ") + e.what(), stmtLoc);
+                RecoverFromError("Parse error in proc body: " + failure, stmtLoc);
+            } else if (stmt) {
+                statements.push_back(std::move(stmt));
             }
             
             // Skip statement terminators
@@ -1678,19 +1707,18 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlockInner(int baseIndent) {
             }
             
             // Parse the statement with error recovery
-            try {
-                auto stmt = ProcStatement();
-                if (stmt) {
-                    statements.push_back(std::move(stmt));
-                } else {
-                    // Skip to next line
-                    while (Current().Type != TokenType::Newline && Current().Type != TokenType::EndOfFile) {
-                        Advance();
-                    }
-                }
-            } catch (const std::exception& e) {
+            auto stmt = ProcStatement();
+            std::string failure;
+            if (TakeFailure(failure)) {
                 // Recover from parse error and continue
-                RecoverFromError(std::string("Parse error in proc body: ") + e.what(), curLoc);
+                RecoverFromError("Parse error in proc body: " + failure, curLoc);
+            } else if (stmt) {
+                statements.push_back(std::move(stmt));
+            } else {
+                // Skip to next line
+                while (Current().Type != TokenType::Newline && Current().Type != TokenType::EndOfFile) {
+                    Advance();
+                }
             }
             
             // Skip trailing newlines/semicolons
@@ -1718,7 +1746,7 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlockInner(int baseIndent) {
                              Current().Type == TokenType::EndOfFile ||
                              Current().Type == TokenType::RightCurlyBracket)) {
             // Empty body - just return empty block
-            return std::make_unique<DMASTProcBlockInner>(loc, std::move(statements));
+            return NewNode<DMASTProcBlockInner>(loc, std::move(statements));
         }
         
         // Now try to parse a single statement if there is one
@@ -1728,7 +1756,7 @@ std::unique_ptr<DMASTProcBlockInner> DMParser::ProcBlockInner(int baseIndent) {
         }
     }
     
-    return std::make_unique<DMASTProcBlockInner>(loc, std::move(statements));
+    return NewNode<DMASTProcBlockInner>(loc, std::move(statements));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatement() {
@@ -1789,33 +1817,23 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatement() {
     // In DM, labels can be either "label:" or just "label" on its own line
     // We need to look ahead to see if there's a colon or newline after an identifier
     if (IsInSet(Current().Type, IdentifierTypes_)) {
-        // Save current position in case this isn't a label
-        Token identToken = Current();
-        Token afterIdent = Advance();  // Advance and save the next token
+        const Token& afterIdent = Peek();
         
         if (afterIdent.Type == TokenType::Colon) {
             // It's a label with colon syntax (label:)
-            ReuseToken(identToken);
             return ProcStatementLabel();
         } else if (afterIdent.Type == TokenType::Newline || afterIdent.Type == TokenType::EndOfFile) {
             // Could be a label without colon (just "label" on its own line)
             // This is valid DM syntax for labels
-            ReuseToken(identToken);
             return ProcStatementLabelNoColon();
-        } else {
-            // Not a label, put both tokens back and continue
-            // We need to restore to the state before we consumed the identifier
-            // Stack order: push afterIdent first, then identToken
-            // So when we Advance(), we get identToken first, then afterIdent
-            TokenStack_.push(afterIdent);
-            CurrentToken_ = identToken;
         }
+        // Not a label, continue with the identifier still current
     }
     
     // Try to parse as expression statement
     auto expr = Expression();
     if (expr) {
-        return std::make_unique<DMASTProcStatementExpression>(loc, std::move(expr));
+        return NewNode<DMASTProcStatementExpression>(loc, std::move(expr));
     }
     
     return nullptr;
@@ -1872,7 +1890,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementVarDeclaration() {
         ParseVarDeclarations(decls, currentTypePath);
     }
     
-    return std::make_unique<DMASTProcStatementVarDeclaration>(loc, std::move(decls));
+    return NewNode<DMASTProcStatementVarDeclaration>(loc, std::move(decls));
 }
 
 void DMParser::ParseVarDeclarations(std::vector<DMASTProcStatementVarDeclaration::Decl>& decls, std::optional<DreamPath>& currentTypePath) {
@@ -1918,18 +1936,23 @@ void DMParser::ParseVarDeclarations(std::vector<DMASTProcStatementVarDeclaration
                 Current().Type == TokenType::Newline ||
                 Current().Type == TokenType::Dedent) {
                 Advance();
-                continue;
+            } else {
+                while (Current().Type != TokenType::Comma &&
+                       Current().Type != TokenType::Semicolon &&
+                       Current().Type != TokenType::Newline &&
+                       Current().Type != TokenType::Dedent &&
+                       Current().Type != TokenType::EndOfFile) {
+                    Advance();
+                }
+                if (Current().Type == TokenType::Comma) {
+                    Advance();
+                }
             }
 
-            while (Current().Type != TokenType::Comma &&
-                   Current().Type != TokenType::Semicolon &&
-                   Current().Type != TokenType::Newline &&
-                   Current().Type != TokenType::Dedent &&
-                   Current().Type != TokenType::EndOfFile) {
-                Advance();
-            }
-            if (Current().Type == TokenType::Comma) {
-                Advance();
+            // Only retry from somewhere new; a truncated "var/" at the end of the file has nothing left
+            if (GetTokenPosition() == loopPos || Current().Type == TokenType::EndOfFile) {
+                Emit(WarningCode::BadToken, declLoc, "Expected a variable name in var declaration");
+                break;
             }
             continue;
         }
@@ -2032,7 +2055,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementReturn() {
         value = Expression();
     }
     
-    return std::make_unique<DMASTProcStatementReturn>(loc, std::move(value));
+    return NewNode<DMASTProcStatementReturn>(loc, std::move(value));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementIf() {
@@ -2087,7 +2110,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementIf() {
             if (chainedIf) {
                 std::vector<std::unique_ptr<DMASTProcStatement>> stmts;
                 stmts.push_back(std::move(chainedIf));
-                elseBody = std::make_unique<DMASTProcBlockInner>(CurrentLocation(), std::move(stmts));
+                elseBody = NewNode<DMASTProcBlockInner>(CurrentLocation(), std::move(stmts));
             }
         } else {
             // Use if statement's column as base indent (else is at same level as if)
@@ -2095,7 +2118,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementIf() {
         }
     }
     
-    return std::make_unique<DMASTProcStatementIf>(loc, std::move(condition), 
+    return NewNode<DMASTProcStatementIf>(loc, std::move(condition), 
                                                    std::move(body), std::move(elseBody));
 }
 
@@ -2145,7 +2168,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementIfWithBaseIndent(int
             if (chainedIf) {
                 std::vector<std::unique_ptr<DMASTProcStatement>> stmts;
                 stmts.push_back(std::move(chainedIf));
-                elseBody = std::make_unique<DMASTProcBlockInner>(CurrentLocation(), std::move(stmts));
+                elseBody = NewNode<DMASTProcBlockInner>(CurrentLocation(), std::move(stmts));
             }
         } else {
             // Final else block
@@ -2153,7 +2176,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementIfWithBaseIndent(int
         }
     }
     
-    return std::make_unique<DMASTProcStatementIf>(loc, std::move(condition), 
+    return NewNode<DMASTProcStatementIf>(loc, std::move(condition), 
                                                    std::move(body), std::move(elseBody));
 }
 
@@ -2177,7 +2200,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementWhile() {
     // Body - pass the while statement's column as base indent
     auto body = ProcBlockInner(loc.Column);
     
-    return std::make_unique<DMASTProcStatementWhile>(loc, std::move(condition), std::move(body));
+    return NewNode<DMASTProcStatementWhile>(loc, std::move(condition), std::move(body));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
@@ -2205,7 +2228,6 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
         if (Current().Type == TokenType::Var) {
             seenVar = true;
             // Consume 'var' keyword
-            Location varLoc = CurrentLocation();
             Advance();
             
             // Now parse the path (e.g., /mob/M or mob/M or just M)
@@ -2222,11 +2244,11 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
                     // Convert path to identifier for the LValue
                     // Extract the variable name from the path
                     std::unique_ptr<DMASTExpression> lvalueExpr;
-                    if (auto* pathConst = dynamic_cast<DMASTConstantPath*>(pathExpr.get())) {
+                    if (auto* pathConst = DMASTCast<DMASTConstantPath>(pathExpr.get())) {
                         std::string varName = pathConst->Path.Path.GetLastElement();
                         if (!varName.empty()) {
                             // Create an identifier with 'var:' prefix to signal it's a new variable
-                            lvalueExpr = std::make_unique<DMASTIdentifier>(pathConst->Location_, "var:" + varName);
+                            lvalueExpr = NewNode<DMASTIdentifier>(pathConst->Location_, "var:" + varName);
                         }
                     }
                     if (!lvalueExpr) {
@@ -2234,7 +2256,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
                     }
                     
                     // Create an assignment expression: var/i = value
-                    firstExpr = std::make_unique<DMASTAssign>(
+                    firstExpr = NewNode<DMASTAssign>(
                         assignLoc, std::move(lvalueExpr), AssignmentOperator::Assign, std::move(initValue));
                 }
             } else {
@@ -2270,9 +2292,9 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
     // Check for implicit range loop (where 'to' was consumed as binary operator)
     std::unique_ptr<DMASTExpression> implicitRangeEnd;
     if (!isForIn && !isForTo && firstExpr) {
-        if (auto* varDecl = dynamic_cast<DMASTProcStatementVarDeclaration*>(firstExpr.get())) {
+        if (auto* varDecl = DMASTCast<DMASTProcStatementVarDeclaration>(firstExpr.get())) {
             if (!varDecl->Decls.empty() && varDecl->Decls[0].Value) {
-                if (auto* binExpr = dynamic_cast<DMASTExpressionBinary*>(varDecl->Decls[0].Value.get())) {
+                if (auto* binExpr = DMASTCast<DMASTExpressionBinary>(varDecl->Decls[0].Value.get())) {
                     if (binExpr->Operator == BinaryOperator::To) {
                         implicitRangeEnd = std::move(binExpr->Right);
                         varDecl->Decls[0].Value = std::move(binExpr->Left);
@@ -2280,8 +2302,8 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
                     }
                 }
             }
-        } else if (auto* assign = dynamic_cast<DMASTAssign*>(firstExpr.get())) {
-            if (auto* binExpr = dynamic_cast<DMASTExpressionBinary*>(assign->Value.get())) {
+        } else if (auto* assign = DMASTCast<DMASTAssign>(firstExpr.get())) {
+            if (auto* binExpr = DMASTCast<DMASTExpressionBinary>(assign->Value.get())) {
                 if (binExpr->Operator == BinaryOperator::To) {
                     implicitRangeEnd = std::move(binExpr->Right);
                     assign->Value = std::move(binExpr->Left);
@@ -2293,7 +2315,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
 
     // Check for implicit "in world" loop: for(var/type/name)
     if (!isForIn && !isForTo && seenVar && Current().Type == TokenType::RightParenthesis) {
-        if (dynamic_cast<DMASTConstantPath*>(firstExpr.get())) {
+        if (DMASTCast<DMASTConstantPath>(firstExpr.get())) {
             isForIn = true;
             implicitInWorld = true;
         }
@@ -2336,7 +2358,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
         
         // Create a for-range statement
         // The firstExpr is the initializer (var/x = start)
-        return std::make_unique<DMASTProcStatementForRange>(loc, std::move(firstExpr), 
+        return NewNode<DMASTProcStatementForRange>(loc, std::move(firstExpr), 
                                                             std::move(endExpr), std::move(stepExpr), 
                                                             std::move(body));
     }
@@ -2345,7 +2367,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
         std::unique_ptr<DMASTExpression> listExpr;
         
         if (implicitInWorld) {
-            listExpr = std::make_unique<DMASTIdentifier>(loc, "world");
+            listExpr = NewNode<DMASTIdentifier>(loc, "world");
         } else {
             Advance(); // Consume 'in'
             listExpr = Expression();
@@ -2360,7 +2382,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
         DMASTProcStatementForIn::VariableDeclaration varDecl;
         
         // Check if firstExpr is a path expression (var/mob/M or /mob/M)
-        if (auto* pathExpr = dynamic_cast<DMASTConstantPath*>(firstExpr.get())) {
+        if (auto* pathExpr = DMASTCast<DMASTConstantPath>(firstExpr.get())) {
             const DMASTPath& path = pathExpr->Path;
             const std::vector<std::string>& elements = path.Path.GetElements();
             
@@ -2379,7 +2401,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
             }
         }
         // Check if firstExpr is just an identifier (simple variable)
-        else if (auto* identExpr = dynamic_cast<DMASTIdentifier*>(firstExpr.get())) {
+        else if (auto* identExpr = DMASTCast<DMASTIdentifier>(firstExpr.get())) {
             varDecl.Name = identExpr->Identifier;
             varDecl.Loc = identExpr->Location_;
         }
@@ -2398,7 +2420,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
         auto body = ProcBlockInner(loc.Column);
         
         // Create a for-in statement with enhanced variable information
-        return std::make_unique<DMASTProcStatementForIn>(loc, std::move(firstExpr), 
+        return NewNode<DMASTProcStatementForIn>(loc, std::move(firstExpr), 
                                                          varDecl, std::move(listExpr), std::move(body));
     }
     
@@ -2408,7 +2430,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
     std::unique_ptr<DMASTExpression> increment;
     
     if (firstExpr) {
-        initializer = std::make_unique<DMASTProcStatementExpression>(loc, std::move(firstExpr));
+        initializer = NewNode<DMASTProcStatementExpression>(loc, std::move(firstExpr));
     }
     
     // DM allows both semicolons (;) and commas (,) as separators in for loops
@@ -2455,7 +2477,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementFor() {
     // Body - pass the for statement's column as base indent
     auto body = ProcBlockInner(loc.Column);
     
-    return std::make_unique<DMASTProcStatementFor>(loc, std::move(initializer), 
+    return NewNode<DMASTProcStatementFor>(loc, std::move(initializer), 
                                                     std::move(condition), std::move(increment), 
                                                     std::move(body));
 }
@@ -2470,11 +2492,11 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementBreak() {
         Current().Type != TokenType::Semicolon && 
         Current().Type != TokenType::Newline && 
         Current().Type != TokenType::EndOfFile) {
-        label = std::make_unique<DMASTIdentifier>(CurrentLocation(), Current().Text);
+        label = NewNode<DMASTIdentifier>(CurrentLocation(), Current().Text);
         Advance();
     }
     
-    return std::make_unique<DMASTProcStatementBreak>(loc, std::move(label));
+    return NewNode<DMASTProcStatementBreak>(loc, std::move(label));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementContinue() {
@@ -2487,11 +2509,11 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementContinue() {
         Current().Type != TokenType::Semicolon && 
         Current().Type != TokenType::Newline && 
         Current().Type != TokenType::EndOfFile) {
-        label = std::make_unique<DMASTIdentifier>(CurrentLocation(), Current().Text);
+        label = NewNode<DMASTIdentifier>(CurrentLocation(), Current().Text);
         Advance();
     }
     
-    return std::make_unique<DMASTProcStatementContinue>(loc, std::move(label));
+    return NewNode<DMASTProcStatementContinue>(loc, std::move(label));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
@@ -2513,7 +2535,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
         if (stmt) {
             stmts.push_back(std::move(stmt));
         }
-        body = std::make_unique<DMASTProcBlockInner>(loc, std::move(stmts));
+        body = NewNode<DMASTProcBlockInner>(loc, std::move(stmts));
         
         // Skip newlines to get to 'while'
         while (Current().Type == TokenType::Newline || Current().Type == TokenType::DM_Preproc_Whitespace) {
@@ -2592,17 +2614,16 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
                     lastStmtLoc = curLoc;
                 }
 
-                try {
-                    auto stmt = ProcStatement();
-                    if (stmt) {
-                        statements.push_back(std::move(stmt));
-                    } else {
-                        while (Current().Type != TokenType::Newline && Current().Type != TokenType::EndOfFile) {
-                            Advance();
-                        }
+                auto stmt = ProcStatement();
+                std::string failure;
+                if (TakeFailure(failure)) {
+                    RecoverFromError("Parse error in do-while body: " + failure, curLoc);
+                } else if (stmt) {
+                    statements.push_back(std::move(stmt));
+                } else {
+                    while (Current().Type != TokenType::Newline && Current().Type != TokenType::EndOfFile) {
+                        Advance();
                     }
-                } catch (const std::exception& e) {
-                    RecoverFromError(std::string("Parse error in do-while body: ") + e.what(), curLoc);
                 }
 
                 while (Current().Type == TokenType::Semicolon || Current().Type == TokenType::Newline) {
@@ -2614,7 +2635,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
                 Advance();
             }
 
-            body = std::make_unique<DMASTProcBlockInner>(blockLoc, std::move(statements));
+            body = NewNode<DMASTProcBlockInner>(blockLoc, std::move(statements));
         }
     }
     
@@ -2633,7 +2654,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
         Emit(WarningCode::BadToken,
              "do-while sync saw token '" + Current().Text + "' (type " +
              std::to_string(static_cast<int>(Current().Type)) + ") at " +
-             Current().Loc.SourceFile + ":" + std::to_string(Current().Loc.Line) +
+             Current().Loc.SourceFile() + ":" + std::to_string(Current().Loc.Line) +
              ":" + std::to_string(Current().Loc.Column));
     }
 
@@ -2649,7 +2670,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDoWhile() {
     }
     Consume(TokenType::RightParenthesis, "Expected ')' after condition");
     
-    return std::make_unique<DMASTProcStatementDoWhile>(loc, std::move(body), std::move(condition));
+    return NewNode<DMASTProcStatementDoWhile>(loc, std::move(body), std::move(condition));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
@@ -2676,6 +2697,8 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
     Whitespace();
     
     std::vector<DMASTProcStatementSwitch::SwitchCase> cases;
+    // The cases of an indentation-based switch sit one level in, behind an Indent
+    bool indented = false;
     
     while (Current().Type != TokenType::EndOfFile) {
         // For indentation-based switch, we stop when we see something
@@ -2683,18 +2706,25 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
         if (!useBraces) {
             // Skip newlines and whitespace to get to the next case
             while (Current().Type == TokenType::Newline || 
-                   Current().Type == TokenType::DM_Preproc_Whitespace) {
+                   Current().Type == TokenType::DM_Preproc_Whitespace ||
+                   (Current().Type == TokenType::Indent && cases.empty())) {
+                indented |= Current().Type == TokenType::Indent;
                 Advance();
             }
             
-            // If we hit something that's not a case keyword, we're done
+            // If we hit something that's not a case keyword, or an if/else
+            // back at the switch's own indentation, we're done
             if (Current().Type != TokenType::If && Current().Type != TokenType::Else) {
                 break;
             }
+            if (indented && GetCurrentIndentation() <= loc.Column) {
+                break;
+            }
         } else {
             // For brace-based, skip whitespace and check for closing brace
             Whitespace();
-            if (Current().Type == TokenType::Newline) {
+            if (Current().Type == TokenType::Newline || Current().Type == TokenType::Indent ||
+                Current().Type == TokenType::Dedent) {
                 Advance();
                 continue;
             }
@@ -2720,9 +2750,9 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
                     Whitespace();
                     
                     bool handled = false;
-                    if (auto* binExpr = dynamic_cast<DMASTExpressionBinary*>(caseValue.get())) {
+                    if (auto* binExpr = DMASTCast<DMASTExpressionBinary>(caseValue.get())) {
                         if (binExpr->Operator == BinaryOperator::To) {
-                            auto rangeExpr = std::make_unique<DMASTSwitchCaseRange>(
+                            auto rangeExpr = NewNode<DMASTSwitchCaseRange>(
                                 binExpr->Location_,
                                 std::move(binExpr->Left),
                                 std::move(binExpr->Right)
@@ -2743,11 +2773,11 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
                             auto rangeEnd = Expression();
                             if (!rangeEnd) {
                                 Warning("Expected upper bound for range in switch case");
-                                rangeEnd = std::make_unique<DMASTConstantNull>(rangeLoc);
+                                rangeEnd = NewNode<DMASTConstantNull>(rangeLoc);
                             }
                             
                             // Create a DMASTSwitchCaseRange node
-                            auto rangeExpr = std::make_unique<DMASTSwitchCaseRange>(
+                            auto rangeExpr = NewNode<DMASTSwitchCaseRange>(
                                 rangeLoc,
                                 std::move(caseValue),
                                 std::move(rangeEnd)
@@ -2797,9 +2827,12 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSwitch() {
     
     if (useBraces) {
         Consume(TokenType::RightCurlyBracket, "Expected '}' to end switch body");
+    } else if (indented && Current().Type == TokenType::Dedent) {
+        // A multi-line case body already consumes it; a single-line one leaves it here
+        Advance();
     }
     
-    return std::make_unique<DMASTProcStatementSwitch>(loc, std::move(value), std::move(cases));
+    return NewNode<DMASTProcStatementSwitch>(loc, std::move(value), std::move(cases));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDel() {
@@ -2824,7 +2857,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementDel() {
         Consume(TokenType::RightParenthesis, "Expected ')' after del value");
     }
     
-    return std::make_unique<DMASTProcStatementDel>(loc, std::move(value));
+    return NewNode<DMASTProcStatementDel>(loc, std::move(value));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSpawn() {
@@ -2844,7 +2877,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSpawn() {
     // Body - pass the spawn statement's column as base indent
     auto body = ProcBlockInner(loc.Column);
     
-    return std::make_unique<DMASTProcStatementSpawn>(loc, std::move(delay), std::move(body));
+    return NewNode<DMASTProcStatementSpawn>(loc, std::move(delay), std::move(body));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementTryCatch() {
@@ -2865,7 +2898,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementTryCatch() {
         if (Current().Type == TokenType::LeftParenthesis) {
             Advance();
             if (IsInSet(Current().Type, IdentifierTypes_)) {
-                catchVariable = std::make_unique<DMASTIdentifier>(CurrentLocation(), Current().Text);
+                catchVariable = NewNode<DMASTIdentifier>(CurrentLocation(), Current().Text);
                 Advance();
             }
             Consume(TokenType::RightParenthesis, "Expected ')' after catch variable");
@@ -2875,7 +2908,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementTryCatch() {
         catchBody = ProcBlockInner(loc.Column);
     }
     
-    return std::make_unique<DMASTProcStatementTryCatch>(loc, std::move(tryBody), 
+    return NewNode<DMASTProcStatementTryCatch>(loc, std::move(tryBody), 
                                                         std::move(catchVariable), std::move(catchBody));
 }
 
@@ -2890,7 +2923,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementThrow() {
         return nullptr;
     }
     
-    return std::make_unique<DMASTProcStatementThrow>(loc, std::move(value));
+    return NewNode<DMASTProcStatementThrow>(loc, std::move(value));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSet() {
@@ -2919,7 +2952,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementSet() {
         return nullptr;
     }
     
-    return std::make_unique<DMASTProcStatementSet>(loc, attribute, std::move(value));
+    return NewNode<DMASTProcStatementSet>(loc, attribute, std::move(value));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementGoto() {
@@ -2932,10 +2965,10 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementGoto() {
         return nullptr;
     }
     
-    auto label = std::make_unique<DMASTIdentifier>(CurrentLocation(), Current().Text);
+    auto label = NewNode<DMASTIdentifier>(CurrentLocation(), Current().Text);
     Advance();
     
-    return std::make_unique<DMASTProcStatementGoto>(loc, std::move(label));
+    return NewNode<DMASTProcStatementGoto>(loc, std::move(label));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementLabel() {
@@ -2962,7 +2995,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementLabel() {
         body = ProcStatement();
     }
     
-    return std::make_unique<DMASTProcStatementLabel>(loc, labelName, std::move(body));
+    return NewNode<DMASTProcStatementLabel>(loc, labelName, std::move(body));
 }
 
 std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementLabelNoColon() {
@@ -2980,7 +3013,7 @@ std::unique_ptr<DMASTProcStatement> DMParser::ProcStatementLabelNoColon() {
     // Don't consume the newline - let the caller handle it
     
     // Labels without colon never have a body on the same line
-    return std::make_unique<DMASTProcStatementLabel>(loc, labelName, nullptr);
+    return NewNode<DMASTProcStatementLabel>(loc, labelName, nullptr);
 }
 
 // ============================================================================
@@ -3000,24 +3033,24 @@ std::unique_ptr<DMASTStatement> DMParser::Statement() {
     
     // Check for proc/verb keyword FIRST (before paths)
     if (Current().Type == TokenType::Proc) {
-        Token saved = Current();
+        size_t saved = Mark();
         Advance();
         Whitespace();
         if (Current().Type == TokenType::Newline || Current().Type == TokenType::LeftCurlyBracket) {
-            ReuseToken(saved);
+            Rewind(saved);
         } else {
-            ReuseToken(saved);
+            Rewind(saved);
             return ObjectProcDefinition(false);
         }
     }
     if (Current().Type == TokenType::Verb) {
-        Token saved = Current();
+        size_t saved = Mark();
         Advance();
         Whitespace();
         if (Current().Type == TokenType::Newline || Current().Type == TokenType::LeftCurlyBracket) {
-            ReuseToken(saved);
+            Rewind(saved);
         } else {
-            ReuseToken(saved);
+            Rewind(saved);
             return ObjectProcDefinition(true);
         }
     }
@@ -3164,7 +3197,8 @@ std::unique_ptr<DMASTStatement> DMParser::Statement() {
             }
             
             // Parse body
-            auto body = ProcBlockInner(loc.Column);
+            DMASTObjectProcDefinition::DeferredBodyRange deferred;
+            auto body = ProcDefinitionBody(loc.Column, deferred);
             
             // Create DreamPath for the object
             // The objectPath should be relative to CurrentPath_ (the current parsing context)
@@ -3180,8 +3214,10 @@ std::unique_ptr<DMASTStatement> DMParser::Statement() {
             }
             
             
-            return std::make_unique<DMASTObjectProcDefinition>(loc, objectPath, procName, std::move(parameters),
+            auto procDef = NewNode<DMASTObjectProcDefinition>(loc, objectPath, procName, std::move(parameters),
                                                                std::move(body), isVerb);
+            procDef->DeferredBody = deferred;
+            return procDef;
         }
         // Check if it's a variable override (simple assignment)
         else if (Current().Type == TokenType::Assign && path.Path.GetElements().size() == 1) {
@@ -3189,7 +3225,7 @@ std::unique_ptr<DMASTStatement> DMParser::Statement() {
             std::string varName = path.Path.GetLastElement();
             Advance(); // consume '='
             auto value = Expression();
-            return std::make_unique<DMASTObjectVarOverride>(loc, varName, std::move(value));
+            return NewNode<DMASTObjectVarOverride>(loc, varName, std::move(value));
         }
         // Otherwise, it's an object definition
         else {
@@ -3250,7 +3286,7 @@ std::unique_ptr<DMASTStatement> DMParser::Statement() {
             // Restore old path
             CurrentPath_ = oldPath;
             
-            return std::make_unique<DMASTObjectDefinition>(loc, path, std::move(innerStatements));
+            return NewNode<DMASTObjectDefinition>(loc, path, std::move(innerStatements));
         }
     }
     
@@ -3272,29 +3308,29 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
     // This handles "proc/name()" and "verb/name()" syntax
     if (Current().Type == TokenType::Proc) {
         // Look ahead to see if it's "proc/" or just "proc" (which could be an object path)
-        Token savedToken = Current();
+        size_t saved = Mark();
         Advance();
         Whitespace();
         if (Current().Type == TokenType::Divide) {
             // It's "proc/", so parse as proc definition
-            ReuseToken(savedToken);
+            Rewind(saved);
             return ObjectProcDefinition(false);
         }
         // It's just "proc", treat as object path
-        ReuseToken(savedToken);
+        Rewind(saved);
     }
     if (Current().Type == TokenType::Verb) {
         // Look ahead to see if it's "verb/" or just "verb" (which could be an object path)
-        Token savedToken = Current();
+        size_t saved = Mark();
         Advance();
         Whitespace();
         if (Current().Type == TokenType::Divide) {
             // It's "verb/", so parse as verb definition
-            ReuseToken(savedToken);
+            Rewind(saved);
             return ObjectProcDefinition(true);
         }
         // It's just "verb", treat as object path
-        ReuseToken(savedToken);
+        Rewind(saved);
     }
     
     // For identifiers and keywords (including var), we need to look ahead to determine the type
@@ -3311,8 +3347,8 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
         Current().Type == TokenType::Static ||
         Current().Type == TokenType::Proc ||
         Current().Type == TokenType::Verb) {
-        // Save current token to backtrack if needed
-        Token savedToken = Current();
+        // Save current position to backtrack if needed
+        size_t saved = Mark();
         
         // Try to parse a path
         auto path = ParsePath();
@@ -3323,7 +3359,7 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
         // Check for ( -> it's a proc definition
         if (Current().Type == TokenType::LeftParenthesis) {
             // Backtrack and parse as proc definition
-            ReuseToken(savedToken);
+            Rewind(saved);
             return ObjectProcDefinition(false);
         }
         
@@ -3390,14 +3426,14 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
                 Whitespace();
                 auto value = Expression();
                 
-                return std::make_unique<DMASTObjectVarDefinition>(loc, varName, typeASTPath, std::move(value), std::nullopt);
+                return NewNode<DMASTObjectVarDefinition>(loc, varName, typeASTPath, std::move(value), std::nullopt);
             } else {
                 // Parse as variable override
                 std::string varName = path.Path.GetElements().empty() ? "" : path.Path.GetLastElement();
                 Advance(); // consume =
                 Whitespace();
                 auto value = Expression();
-                return std::make_unique<DMASTObjectVarOverride>(loc, varName, std::move(value));
+                return NewNode<DMASTObjectVarOverride>(loc, varName, std::move(value));
             }
         }
         
@@ -3437,17 +3473,17 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
             if (arraySize) {
                 // Create /list path expression
                 DreamPath listPath(DreamPath::PathType::Absolute, {"list"});
-                auto listPathExpr = std::make_unique<DMASTConstantPath>(loc, DMASTPath(loc, listPath, false));
+                auto listPathExpr = NewNode<DMASTConstantPath>(loc, DMASTPath(loc, listPath, false));
                 
                 // Create parameter list with the size expression
                 std::vector<std::unique_ptr<DMASTCallParameter>> params;
-                params.push_back(std::make_unique<DMASTCallParameter>(arraySize->Location_, std::move(arraySize)));
+                params.push_back(NewNode<DMASTCallParameter>(arraySize->Location_, std::move(arraySize)));
                 
                 // Create new /list(size) expression
-                initValue = std::make_unique<DMASTNewPath>(loc, std::move(listPathExpr), std::move(params));
+                initValue = NewNode<DMASTNewPath>(loc, std::move(listPathExpr), std::move(params));
             }
             
-            return std::make_unique<DMASTObjectVarDefinition>(loc, varName, typeASTPath, std::move(initValue), std::nullopt);
+            return NewNode<DMASTObjectVarDefinition>(loc, varName, typeASTPath, std::move(initValue), std::nullopt);
         }
         
         // Check for newline/semicolon -> variable definition without initialization (in var block)
@@ -3470,7 +3506,7 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
                 int currentLineIndent = loc.Column;
                 
                 // Save position for lookahead
-                Token savedNewlineToken = Current();
+                size_t savedNewline = Mark();
                 Advance(); // consume newline
                 
                 // Skip any empty lines
@@ -3487,7 +3523,7 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
                 }
                 
                 // Backtrack to before the newline
-                ReuseToken(savedNewlineToken);
+                Rewind(savedNewline);
             }    
 
             // If there's NO nested block, this is a variable definition without initialization
@@ -3524,16 +3560,15 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectStatement() {
                 DreamPath typePath(path.Path.GetPathType(), typeElements);
                 DMASTPath typeASTPath(loc, typePath, false);
                 
-                return std::make_unique<DMASTObjectVarDefinition>(loc, varName, typeASTPath, nullptr, std::nullopt);
+                return NewNode<DMASTObjectVarDefinition>(loc, varName, typeASTPath, nullptr, std::nullopt);
             }
             // If hasNestedBlock is true, fall through to parse as object definition
             // This will properly update CurrentPath_ to include the type (e.g., "list")
         }
         
         // Otherwise, use the already-parsed path for the object definition
-        // IMPORTANT: We don't use ReuseToken here because it only puts back one token,
-        // but the path might have multiple tokens (e.g., "human/player" = 3 tokens).
-        // Instead, we pass the already-parsed path directly to ObjectDefinition.
+        // The path is already parsed, so pass it directly to ObjectDefinition
+        // rather than rewinding and parsing it again.
         return ObjectDefinition(path, loc);
     }
     
@@ -3765,7 +3800,8 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectProcDefinition(bool isVerb
     
     // Parse body - pass the base indentation (column where 'proc' keyword started)
     // so indented blocks can determine when they end
-    auto body = ProcBlockInner(loc.Column);
+    DMASTObjectProcDefinition::DeferredBodyRange deferred;
+    auto body = ProcDefinitionBody(loc.Column, deferred);
     
     // Create DreamPath for the object
     // The objectPath should be relative to CurrentPath_ (the current parsing context)
@@ -3780,8 +3816,109 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectProcDefinition(bool isVerb
         objectPath = DreamPath(path.Path.GetPathType(), objectPathElements);
     }
     
-    return std::make_unique<DMASTObjectProcDefinition>(loc, objectPath, procName, std::move(parameters),
+    auto procDef = NewNode<DMASTObjectProcDefinition>(loc, objectPath, procName, std::move(parameters),
                                                        std::move(body), isVerb);
+    procDef->DeferredBody = deferred;
+    return procDef;
+}
+
+std::unique_ptr<DMASTProcBlockInner> DMParser::ProcDefinitionBody(int baseIndent, DMASTObjectProcDefinition::DeferredBodyRange& deferred) {
+    // The current token's buffer index is only known when nothing was read past it
+    if (!DeferSource_ || Position_ - WindowStart_ + 1 != Window_.size() || DeferSource_->Position() == 0) {
+        return ProcBlockInner(baseIndent);
+    }
+    
+    size_t begin = DeferSource_->Position() - 1;
+    size_t end;
+    if (!FindProcBodyEnd(begin, baseIndent, end)) {
+        return ProcBlockInner(baseIndent);
+    }
+    
+    deferred.Begin = begin;
+    deferred.End = end;
+    deferred.BaseIndent = baseIndent;
+    DeferSource_->Seek(end);
+    Advance();
+    return nullptr;
+}
+
+bool DMParser::FindProcBodyEnd(size_t begin, int baseIndent, size_t& end) const {
+    const TokenBuffer& tokens = *DeferSource_->Buffer();
+    
+    if (tokens.TypeAt(begin) == TokenType::LeftCurlyBracket) {
+        // Braced body: ends after the matching '}'
+        int depth = 0;
+        for (size_t i = begin; i < tokens.size(); ++i) {
+            TokenType type = tokens.TypeAt(i);
+            if (type == TokenType::LeftCurlyBracket) {
+                depth++;
+            } else if (type == TokenType::RightCurlyBracket && --depth == 0) {
+                end = i + 1;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    // Indented body: the header's line ended with an Indent (already consumed),
+    // and the body runs until the Dedent closing it. ProcBlockInner() also eats
+    // the Dedents right after, and ends early at a line not indented past
+    // baseIndent, so bodies containing such lines are left to it
+    if (tokens.TypeAt(begin) != TokenType::Newline || begin == 0 || tokens.TypeAt(begin - 1) != TokenType::Indent) {
+        return false;
+    }
+    
+    int depth = 1;
+    int bracketNesting = 0;
+    bool lineStart = true;
+    for (size_t i = begin + 1; i < tokens.size(); ++i) {
+        switch (tokens.TypeAt(i)) {
+            case TokenType::EndOfFile:
+                return false;
+            case TokenType::Newline:
+                lineStart = bracketNesting == 0;
+                break;
+            case TokenType::Indent:
+                depth++;
+                break;
+            case TokenType::Dedent:
+                if (--depth == 0) {
+                    while (i < tokens.size() && tokens.TypeAt(i) == TokenType::Dedent) {
+                        i++;
+                    }
+                    // A nested block may have eaten this Dedent, leaving the
+                    // column check to end the body
+                    if (i < tokens.size() && tokens.TypeAt(i) != TokenType::EndOfFile &&
+                        tokens.At(i).Column > baseIndent) {
+                        return false;
+                    }
+                    end = i;
+                    return true;
+                }
+                break;
+            case TokenType::LeftParenthesis:
+            case TokenType::LeftBracket:
+            case TokenType::DM_Preproc_Punctuator_LeftParenthesis:
+            case TokenType::DM_Preproc_Punctuator_LeftBracket:
+                bracketNesting++;
+                lineStart = false;
+                break;
+            case TokenType::RightParenthesis:
+            case TokenType::RightBracket:
+            case TokenType::DM_Preproc_Punctuator_RightParenthesis:
+            case TokenType::DM_Preproc_Punctuator_RightBracket:
+                bracketNesting = std::max(bracketNesting - 1, 0);
+                lineStart = false;
+                break;
+            default:
+                if (lineStart && depth == 1 && tokens.At(i).Column <= baseIndent) {
+                    return false;
+                }
+                lineStart = false;
+                break;
+        }
+    }
+    return false;
 }
 
 std::unique_ptr<DMASTDefinitionParameter> DMParser::ProcParameter() {
@@ -3803,7 +3940,7 @@ std::unique_ptr<DMASTDefinitionParameter> DMParser::ProcParameter() {
         paramName = "...";
         Advance();
         // Varargs don't have type, default value, or 'as' clause
-        return std::make_unique<DMASTDefinitionParameter>(loc, paramName, typePath, isList,
+        return NewNode<DMASTDefinitionParameter>(loc, paramName, typePath, isList,
                                                           nullptr, nullptr, std::nullopt);
     }
     
@@ -3823,13 +3960,9 @@ std::unique_ptr<DMASTDefinitionParameter> DMParser::ProcParameter() {
     } else if (IsInSet(Current().Type, IdentifierTypes_)) {
         // Check if this is a typed parameter (type/name syntax)
         // Look ahead to see if there's a / after the identifier
-        Token firstToken = Current();
-        Advance();
-        
-        if (Current().Type == TokenType::Divide) {
+        if (Peek().Type == TokenType::Divide) {
             // It's a typed parameter like mob/M
             // Parse as a path to get all elements
-            ReuseToken(firstToken);
             auto path = ParsePath();
             
             // Extract type and name from the path
@@ -3847,7 +3980,8 @@ std::unique_ptr<DMASTDefinitionParameter> DMParser::ProcParameter() {
             }
         } else {
             // Just a simple parameter name
-            paramName = firstToken.Text;
+            paramName = Current().Text;
+            Advance();
         }
     }
     
@@ -3956,14 +4090,13 @@ std::unique_ptr<DMASTDefinitionParameter> DMParser::ProcParameter() {
         }
     }
     
-    return std::make_unique<DMASTDefinitionParameter>(loc, paramName, typePath, isList,
+    return NewNode<DMASTDefinitionParameter>(loc, paramName, typePath, isList,
                                                       std::move(defaultValue), std::move(possibleValues), explicitValueType);
 }
 
 // ObjectVarDefinition is no longer used - var blocks are now handled through the object definition path
 // This function is kept for backwards compatibility but should not be called
 std::unique_ptr<DMASTObjectStatement> DMParser::ObjectVarDefinition() {
-    Location loc = CurrentLocation();
     Consume(TokenType::Var, "Expected 'var'");
     
     // This should not be reached anymore since var is now handled as part of object paths
@@ -3993,7 +4126,7 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectDefinition(const DMASTPath
         std::cout << "  OBJDEF: oldPath=" << oldPath.ToString()
                  << " path=" << path.Path.ToString() 
                  << " newPath=" << newPath.ToString()
-                 << " from " << loc.SourceFile 
+                 << " from " << loc.SourceFile() 
                  << " at line " << loc.Line << " col " << loc.Column
                  << " next token=" << Current().Text << std::endl;
     }
@@ -4052,7 +4185,7 @@ std::unique_ptr<DMASTObjectStatement> DMParser::ObjectDefinition(const DMASTPath
     // Restore old path
     CurrentPath_ = oldPath;
     
-    return std::make_unique<DMASTObjectDefinition>(loc, path, std::move(innerStatements));
+    return NewNode<DMASTObjectDefinition>(loc, path, std::move(innerStatements));
 }
 
 int DMParser::GetCurrentIndentation() {
@@ -1,10 +1,16 @@
 #include "DMPreprocessor.h"
 #include "DMCompiler.h"
 #include "DMLexer.h"
+#include "SourceBuffer.h"
+#include "ParallelLexer.h"
+#include "TokenCache.h"
+#include "CompileCosts.h"
+#include "DependencyGraph.h"
 #include <fstream>
 #include <filesystem>
 #include <sstream>
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <unordered_set>
 
@@ -14,39 +20,90 @@ namespace DMCompiler {
 // DMMacro Implementations
 // ============================================================================
 
-std::vector<Token> DMMacroFunction::Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) {
-    if (arguments.size() != Parameters.size()) {
-        std::cerr << "Error at " << location.ToString() << ": Macro expansion failed - expected " 
-                  << Parameters.size() << " arguments but got " << arguments.size() << std::endl;
-        return {}; // Error: wrong number of arguments
+void DMMacro::ExpandOnto(const MacroArguments& arguments, const Location& location, std::stack<Token>& output) {
+    std::vector<std::vector<Token>> argumentVectors;
+    argumentVectors.reserve(arguments.Count);
+    for (size_t i = 0; i < arguments.Count; ++i) {
+        const auto& [begin, end] = arguments.Ranges[i];
+        argumentVectors.emplace_back(arguments.Tokens + begin, arguments.Tokens + end);
     }
     
-    std::vector<Token> result;
-    std::unordered_map<std::string, std::vector<Token>> argMap;
-    
-    // Map parameter names to argument token vectors
-    for (size_t i = 0; i < Parameters.size(); ++i) {
-        argMap[Parameters[i]] = arguments[i];
+    std::vector<Token> result = Expand(argumentVectors, location);
+    for (auto it = result.rbegin(); it != result.rend(); ++it) {
+        output.push(std::move(*it));
     }
-    
-    // Replace parameters in token stream
+}
+
+// Text macros take no arguments and their tokens keep the locations of their #define
+void DMMacroText::ExpandOnto(const MacroArguments&, const Location&, std::stack<Token>& output) {
+    for (auto it = Tokens.rbegin(); it != Tokens.rend(); ++it) {
+        output.push(*it);
+    }
+}
+
+DMMacroFunction::DMMacroFunction(const std::vector<std::string>& params, const std::vector<Token>& tokens)
+    : Parameters(params), Tokens(tokens)
+{
+    // Resolve parameter names once, at #define time
+    Template_.reserve(Tokens.size());
     for (const auto& token : Tokens) {
+        int32_t slot = LiteralSlot;
         if (token.Type == TokenType::Identifier) {
-            auto it = argMap.find(token.Text);
-            if (it != argMap.end()) {
-                // Replace with argument tokens (preserving all tokens in multi-token args)
-                for (const auto& argToken : it->second) {
-                    result.push_back(argToken);
-                }
-                continue;
+            auto param = std::find(Parameters.begin(), Parameters.end(), token.Text);
+            if (param != Parameters.end()) {
+                slot = static_cast<int32_t>(param - Parameters.begin());
             }
         }
-        result.push_back(token);
+        Template_.push_back(slot);
+    }
+}
+
+bool DMMacroFunction::CheckArgumentCount(size_t count, const Location& location) const {
+    if (count != Parameters.size()) {
+        std::cerr << "Error at " << location.ToString() << ": Macro expansion failed - expected " 
+                  << Parameters.size() << " arguments but got " << count << std::endl;
+        return false; // Error: wrong number of arguments
+    }
+    return true;
+}
+
+std::vector<Token> DMMacroFunction::Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) {
+    if (!CheckArgumentCount(arguments.size(), location)) {
+        return {};
     }
     
+    std::vector<Token> result;
+    result.reserve(Tokens.size());
+    for (size_t i = 0; i < Tokens.size(); ++i) {
+        if (Template_[i] == LiteralSlot) {
+            result.push_back(Tokens[i]);
+        } else {
+            // Replace with argument tokens (preserving all tokens in multi-token args)
+            const auto& argument = arguments[Template_[i]];
+            result.insert(result.end(), argument.begin(), argument.end());
+        }
+    }
     return result;
 }
 
+void DMMacroFunction::ExpandOnto(const MacroArguments& arguments, const Location& location, std::stack<Token>& output) {
+    if (!CheckArgumentCount(arguments.Count, location)) {
+        return;
+    }
+    
+    // Walk the template backwards so the stack pops the expansion in order
+    for (size_t i = Tokens.size(); i-- > 0;) {
+        if (Template_[i] == LiteralSlot) {
+            output.push(Tokens[i]);
+            continue;
+        }
+        const auto& [begin, end] = arguments.Ranges[Template_[i]];
+        for (size_t j = end; j-- > begin;) {
+            output.push(arguments.Tokens[j]);
+        }
+    }
+}
+
 std::vector<Token> DMMacroLine::Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) {
     std::vector<Token> result;
     Token::TokenValue value(static_cast<int64_t>(location.Line));
@@ -56,8 +113,8 @@ std::vector<Token> DMMacroLine::Expand(const std::vector<std::vector<Token>>& ar
 
 std::vector<Token> DMMacroFile::Expand(const std::vector<std::vector<Token>>& arguments, const Location& location) {
     std::vector<Token> result;
-    Token::TokenValue value(location.SourceFile);
-    result.push_back(Token(TokenType::String, location.SourceFile, location, value));
+    Token::TokenValue value(location.SourceFile());
+    result.push_back(Token(TokenType::String, location.SourceFile(), location, value));
     return result;
 }
 
@@ -84,6 +141,7 @@ DMPreprocessor::DMPreprocessor(DMCompiler* compiler)
     , CanUseDirective_(true)
     , CurrentLineContainsNonWhitespace_(false)
     , PreviousNonWhitespaceToken_(TokenType::EndOfFile)
+    , LastOutputWasNewline_(true)
 {
     // Add built-in macros
     Defines_["__LINE__"] = std::make_unique<DMMacroLine>();
@@ -101,7 +159,7 @@ DMPreprocessor::~DMPreprocessor() = default;
 // Helper function to fix include paths that had escape sequences processed
 // The lexer converts \t to tab, \n to newline, etc. but these are
 // path separators on Windows, not escape sequences!
-static std::string FixIncludePath(const std::string& path) {
+std::string FixIncludePath(const std::string& path) {
     std::string fixedPath;
     fixedPath.reserve(path.size());
     for (size_t i = 0; i < path.size(); ++i) {
@@ -119,6 +177,71 @@ static std::string FixIncludePath(const std::string& path) {
     return fixedPath;
 }
 
+// Returns true if the source contains a line continuation: a backslash followed by
+// optional spaces/tabs and then a newline (LF or CRLF)
+static bool HasLineContinuation(std::string_view content) {
+    size_t pos = content.find('\\');
+    while (pos != std::string_view::npos) {
+        size_t j = pos + 1;
+        while (j < content.size() && (content[j] == ' ' || content[j] == '\t')) {
+            ++j;
+        }
+        if (j < content.size() &&
+            (content[j] == '\n' || (content[j] == '\r' && j + 1 < content.size() && content[j + 1] == '\n'))) {
+            return true;
+        }
+        pos = content.find('\\', pos + 1);
+    }
+    return false;
+}
+
+// Handle line continuation: backslash at end of line joins with next line
+// We need to handle: \<newline>, \<CRLF>, and \ followed by optional whitespace then newline
+// Replace the entire continuation sequence with a single space to join lines
+static std::string JoinLineContinuations(std::string_view content) {
+    std::string processedContent;
+    processedContent.reserve(content.size());
+    for (size_t i = 0; i < content.size(); ++i) {
+        if (content[i] == '\\') {
+            // Check if this backslash is followed by optional whitespace then newline
+            size_t j = i + 1;
+            // Skip any spaces or tabs (but not other whitespace)
+            while (j < content.size() && (content[j] == ' ' || content[j] == '\t')) {
+                ++j;
+            }
+            // Now check for newline
+            if (j < content.size()) {
+                if (content[j] == '\n') {
+                    // Line continuation: replace everything with a single space
+                    processedContent.push_back(' ');
+                    i = j;  // Skip past newline (loop will increment)
+                    continue;
+                } else if (content[j] == '\r') {
+                    // Check for CRLF
+                    if (j + 1 < content.size() && content[j + 1] == '\n') {
+                        // Replace with single space
+                        processedContent.push_back(' ');
+                        i = j + 1;  // Skip past CRLF
+                        continue;
+                    }
+                }
+            }
+        }
+        processedContent.push_back(content[i]);
+    }
+    return processedContent;
+}
+
+// Load a source file for lexing. The memory-mapped file is handed to the lexer as-is;
+// only files that contain line continuations are rewritten into an owned buffer.
+std::shared_ptr<const SourceBuffer> LoadPreprocessorSource(const std::string& path) {
+    std::shared_ptr<const SourceBuffer> buffer = SourceBuffer::FromFile(path);
+    if (!buffer || !HasLineContinuation(buffer->View())) {
+        return buffer;
+    }
+    return SourceBuffer::FromString(JoinLineContinuations(buffer->View()));
+}
+
 bool DMPreprocessor::Initialize(const std::string& rootFilePath) {
     // Clear all state
     while (!FileStack_.empty()) {
@@ -139,18 +262,43 @@ bool DMPreprocessor::Initialize(const std::string& rootFilePath) {
     IncludedInterface_.clear();
     IncludeChain_.clear();
     PathCache_.clear();
+    IncludeGuards_.clear();
     
     // Keep built-in macros, clear user-defined ones
-    std::unordered_map<std::string, std::unique_ptr<DMMacro>> builtins;
+    FlatHashMap<std::unique_ptr<DMMacro>> builtins;
     if (Defines_.count("__LINE__")) builtins["__LINE__"] = std::move(Defines_["__LINE__"]);
     if (Defines_.count("__FILE__")) builtins["__FILE__"] = std::move(Defines_["__FILE__"]);
     if (Defines_.count("DM_VERSION")) builtins["DM_VERSION"] = std::move(Defines_["DM_VERSION"]);
     if (Defines_.count("DM_BUILD")) builtins["DM_BUILD"] = std::move(Defines_["DM_BUILD"]);
+    for (const auto& [name, macro] : Defines_) {
+        if (!builtins.count(name)) {
+            TouchMacro(name);
+        }
+    }
     Defines_ = std::move(builtins);
+    for (const auto& [name, value] : CommandLineDefines_) {
+        DefineMacro(name, value);
+    }
     
     CanUseDirective_ = true;
     CurrentLineContainsNonWhitespace_ = false;
     PreviousNonWhitespaceToken_ = TokenType::EndOfFile;
+    LastOutputWasNewline_ = true; // Start of file counts as after newline
+    
+    // Lex everything the root can reach in parallel before preprocessing it
+    if (LexThreads_ > 0) {
+        if (!PreLexed_) {
+            PreLexed_ = std::make_unique<PreLexedFiles>();
+        }
+        try {
+            PreLexed_->LexReachable(std::filesystem::absolute(rootFilePath).string(), LexThreads_, TokenCache_.get());
+        } catch (const std::exception&) {
+            // Files that were not pre-lexed are lexed inline by PushFile
+        }
+        if (Compiler_ && Compiler_->GetSettings().Verbose) {
+            std::cout << "  Pre-lexed " << PreLexed_->Size() << " files on " << LexThreads_ << " threads" << std::endl;
+        }
+    }
     
     // Push root file onto stack
     return PushFile(rootFilePath, Location::Internal);
@@ -188,58 +336,36 @@ bool DMPreprocessor::PushFile(const std::string& filePath, const Location& inclu
         return false;
     }
     
-    // Read file content
-    std::ifstream file(filePath);
-    if (!file.is_open()) {
-        ReportError(includeLocation, "Failed to open file: " + filePath);
-        return false;
-    }
-    
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
-    
-    // Handle line continuation: backslash at end of line joins with next line
-    // This needs to be done before lexing
-    // We need to handle: \<newline>, \<CRLF>, and \ followed by optional whitespace then newline
-    // Replace the entire continuation sequence with a single space to join lines
-    std::string processedContent;
-    processedContent.reserve(content.size());
-    for (size_t i = 0; i < content.size(); ++i) {
-        if (content[i] == '\\') {
-            // Check if this backslash is followed by optional whitespace then newline
-            size_t j = i + 1;
-            // Skip any spaces or tabs (but not other whitespace)
-            while (j < content.size() && (content[j] == ' ' || content[j] == '\t')) {
-                ++j;
-            }
-            // Now check for newline
-            if (j < content.size()) {
-                if (content[j] == '\n') {
-                    // Line continuation: replace everything with a single space
-                    processedContent.push_back(' ');
-                    i = j;  // Skip past newline (loop will increment)
-                    continue;
-                } else if (content[j] == '\r') {
-                    // Check for CRLF
-                    if (j + 1 < content.size() && content[j + 1] == '\n') {
-                        // Replace with single space
-                        processedContent.push_back(' ');
-                        i = j + 1;  // Skip past CRLF
-                        continue;
-                    }
-                }
-            }
+    std::unique_ptr<DMLexer> lexer;
+    if (auto tokens = PreLexed_ ? PreLexed_->Find(absolutePath) : nullptr) {
+        // Already lexed on a worker thread
+        lexer = std::make_unique<ReplayDMLexer>(absolutePath, std::move(tokens));
+    } else if (TokenCache_) {
+        // Lex the whole file up front so it can be served from (or saved to) the token cache
+        std::shared_ptr<const PreLexedFiles::TokenArray> tokens = PreLexedFiles::LexFile(absolutePath, TokenCache_.get());
+        if (!tokens) {
+            ReportError(includeLocation, "Failed to open file: " + filePath);
+            return false;
         }
-        processedContent.push_back(content[i]);
+        lexer = std::make_unique<ReplayDMLexer>(absolutePath, std::move(tokens));
+    } else {
+        // Map the file (line continuations are joined here, before lexing)
+        std::shared_ptr<const SourceBuffer> content = LoadPreprocessorSource(filePath);
+        if (!content) {
+            ReportError(includeLocation, "Failed to open file: " + filePath);
+            return false;
+        }
+        
+        // Create lexer for this file (with whitespace emission enabled for preprocessing)
+        lexer = std::make_unique<DMLexer>(absolutePath, content, true);
     }
-    content = std::move(processedContent);
     
     // Calculate include depth
     int depth = static_cast<int>(FileStack_.size());
     
-    // Create lexer for this file (with whitespace emission enabled for preprocessing)
-    auto lexer = std::make_unique<DMLexer>(absolutePath, content, true);
+    if (Costs_) {
+        ChargeCurrentFile();
+    }
     
     // Create FileContext and push onto stack
     FileStack_.push(FileContext(std::move(lexer), absolutePath, depth));
@@ -247,6 +373,26 @@ bool DMPreprocessor::PushFile(const std::string& filePath, const Location& inclu
     // Add to include chain for error reporting
     IncludeChain_.push_back(IncludeChainEntry(absolutePath, includeLocation));
     
+    if (Stats_) {
+        PreprocessorStats::FileStats& stats = Stats_->Files[absolutePath];
+        if (stats.Opened++ == 0) {
+            std::error_code ec;
+            uintmax_t size = fs::file_size(absolutePath, ec);
+            stats.Bytes = ec ? 0 : static_cast<uint64_t>(size);
+        }
+        stats.MaxDepth = std::max(stats.MaxDepth, IncludeChain_.size());
+        if (IncludeChain_.size() > Stats_->DeepestChain.size()) {
+            Stats_->DeepestChain.clear();
+            for (const auto& entry : IncludeChain_) {
+                Stats_->DeepestChain.push_back(entry.FilePath);
+            }
+        }
+        FileStack_.top().Stats = &stats;
+    }
+    if (Dependencies_) {
+        Dependencies_->Files[absolutePath];
+    }
+    
     // Verbose logging
     if (Compiler_ && Compiler_->GetSettings().Verbose) {
         std::cout << "  Pushed file onto stack: " << absolutePath 
@@ -267,10 +413,22 @@ void DMPreprocessor::PopFile() {
             IncludeChain_.pop_back();
         }
         
+        if (Costs_) {
+            ChargeCurrentFile();
+        }
         FileStack_.pop();
     }
 }
 
+void DMPreprocessor::ChargeCurrentFile() {
+    auto now = std::chrono::steady_clock::now();
+    if (!FileStack_.empty()) {
+        Costs_->AddFileTime(SourceFileRegistry::Register(FileStack_.top().FilePath),
+                            CompileCosts::FileStage::Preprocess, now - CostMark_);
+    }
+    CostMark_ = now;
+}
+
 const FileContext* DMPreprocessor::GetCurrentContext() const {
     if (FileStack_.empty()) {
         return nullptr;
@@ -301,38 +459,38 @@ void DMPreprocessor::ReportError(const Location& loc, const std::string& message
     }
 }
 
-std::vector<Token> DMPreprocessor::Preprocess(const std::string& filePath) {
-    std::vector<Token> result;
-    
-    // Initialize streaming preprocessor
-    if (!Initialize(filePath)) {
-        return result;  // Error during initialization
-    }
-    
-    bool lastWasNewline = true; // Start of file counts as after newline
-    
-    // Loop: call GetNextToken() until IsComplete() returns true
+bool DMPreprocessor::ReadOutputToken(Token& token) {
     while (!IsComplete()) {
-        Token token = GetNextToken();
+        token = GetNextToken();
         
         // Stop at EOF
         if (token.Type == TokenType::EndOfFile) {
-            break;
+            return false;
         }
         
         // Only keep whitespace tokens if they appear after a newline (for indentation tracking)
         // Skip mid-line whitespace as it's not needed
-        if (token.Type == TokenType::DM_Preproc_Whitespace) {
-            if (!lastWasNewline) {
-                continue; // Skip mid-line whitespace
-            }
-            // Keep leading whitespace for indentation
+        if (token.Type == TokenType::DM_Preproc_Whitespace && !LastOutputWasNewline_) {
+            continue;
         }
         
         // Track newlines to know when to keep whitespace
-        lastWasNewline = (token.Type == TokenType::Newline);
-        
-        // Collect tokens in result vector using move semantics
+        LastOutputWasNewline_ = (token.Type == TokenType::Newline);
+        return true;
+    }
+    return false;
+}
+
+std::vector<Token> DMPreprocessor::Preprocess(const std::string& filePath) {
+    std::vector<Token> result;
+    
+    // Initialize streaming preprocessor
+    if (!Initialize(filePath)) {
+        return result;  // Error during initialization
+    }
+    
+    Token token;
+    while (ReadOutputToken(token)) {
         result.push_back(std::move(token));
     }
     
@@ -340,47 +498,49 @@ std::vector<Token> DMPreprocessor::Preprocess(const std::string& filePath) {
 }
 
 void DMPreprocessor::Define(const std::string& name, const std::string& value) {
+    auto existing = std::find_if(CommandLineDefines_.begin(), CommandLineDefines_.end(),
+                                 [&](const auto& define) { return define.first == name; });
+    if (existing != CommandLineDefines_.end()) {
+        existing->second = value;
+    } else {
+        CommandLineDefines_.emplace_back(name, value);
+    }
+    DefineMacro(name, value);
+}
+
+void DMPreprocessor::DefineMacro(const std::string& name, const std::string& value) {
+    TouchMacro(name);
+    // Lexed as a #define body is, so the value expands to the tokens it would
+    // be written as: a number, a string, an identifier or an expression
+    DMLexer lexer("<command line>", value, true);
     std::vector<Token> tokens;
-    if (!value.empty()) {
-        // Try to parse as integer
-        try {
-            size_t pos;
-            int64_t intVal = std::stoll(value, &pos);
-            if (pos == value.length()) {
-                // Successfully parsed entire string as integer
-                Token::TokenValue val(intVal);
-                tokens.push_back(Token(TokenType::DM_Preproc_Number, value, Location::Internal, val));
-                Defines_[name] = std::make_unique<DMMacroText>(tokens);
-                return;
-            }
-        } catch (...) {
-            // Not an integer, try float
+    for (Token token = lexer.GetNextToken(); token.Type != TokenType::EndOfFile; token = lexer.GetNextToken()) {
+        if (token.Type != TokenType::Newline && (!tokens.empty() || token.Type != TokenType::DM_Preproc_Whitespace)) {
+            tokens.push_back(std::move(token));
         }
-        
-        // Try to parse as float
-        try {
-            size_t pos;
-            double floatVal = std::stod(value, &pos);
-            if (pos == value.length()) {
-                // Successfully parsed entire string as float
-                Token::TokenValue val(floatVal);
-                tokens.push_back(Token(TokenType::DM_Preproc_Number, value, Location::Internal, val));
-                Defines_[name] = std::make_unique<DMMacroText>(tokens);
-                return;
-            }
-        } catch (...) {
-            // Not a float either
-        }
-        
-        // Default to string/identifier
-        Token::TokenValue val(value);
-        tokens.push_back(Token(TokenType::DM_Preproc_Identifier, value, Location::Internal, val));
+    }
+    while (!tokens.empty() && tokens.back().Type == TokenType::DM_Preproc_Whitespace) {
+        tokens.pop_back();
     }
     Defines_[name] = std::make_unique<DMMacroText>(tokens);
 }
 
 void DMPreprocessor::Undefine(const std::string& name) {
-    Defines_.erase(name);
+    if (Defines_.erase(name) != 0) {
+        TouchMacro(name);
+    }
+}
+
+void DMPreprocessor::TouchMacro(const std::string& name) {
+    MacroGenerations_[name] = ++MacroGenerationCounter_;
+    if (Dependencies_ && !FileStack_.empty()) {
+        Dependencies_->Files[FileStack_.top().FilePath].MacrosDefined.insert(name);
+    }
+}
+
+uint64_t DMPreprocessor::GetMacroGeneration(const std::string& name) const {
+    auto it = MacroGenerations_.find(name);
+    return it != MacroGenerations_.end() ? it->second : 0;
 }
 
 bool DMPreprocessor::IsDefined(const std::string& name) const {
@@ -415,7 +575,11 @@ Token DMPreprocessor::GetNextRawToken() {
     }
     
     // Get token from top lexer
-    return FileStack_.top().Lexer->GetNextToken();
+    Token token = FileStack_.top().Lexer->GetNextToken();
+    if (FileStack_.top().Stats && token.Type != TokenType::EndOfFile) {
+        FileStack_.top().Stats->Tokens++;
+    }
+    return token;
 }
 
 Token DMPreprocessor::GetNextToken() {
@@ -441,16 +605,21 @@ Token DMPreprocessor::GetNextToken() {
         
         // Step 3: Get token from top lexer using GetNextRawToken()
         Token token = FileStack_.top().Lexer->GetNextToken();
+        TrackIncludeGuard(FileStack_.top(), token);
+        if (FileStack_.top().Stats && token.Type != TokenType::EndOfFile) {
+            FileStack_.top().Stats->Tokens++;
+        }
         
         // Debug: log all include tokens
         if (Compiler_ && Compiler_->GetSettings().Verbose && token.Type == TokenType::DM_Preproc_Include) {
-            std::cout << "  Got DM_Preproc_Include token at " << token.Loc.SourceFile << ":" << token.Loc.Line << std::endl;
+            std::cout << "  Got DM_Preproc_Include token at " << token.Loc.SourceFile() << ":" << token.Loc.Line << std::endl;
         }
         
         // Step 4: Process token based on type
         
         // Handle EOF tokens by calling PopFile() and continuing
         if (token.Type == TokenType::EndOfFile) {
+            RecordIncludeGuard(FileStack_.top());
             PopFile();
             // Continue to get token from next file (or return EOF if no more files)
             continue;
@@ -483,7 +652,7 @@ Token DMPreprocessor::GetNextToken() {
         // Handle preprocessor directives
         if (token.Type == TokenType::DM_Preproc_Include) {
             if (Compiler_ && Compiler_->GetSettings().Verbose) {
-                std::cout << "  Processing #include at " << token.Loc.SourceFile << ":" << token.Loc.Line << std::endl;
+                std::cout << "  Processing #include at " << token.Loc.SourceFile() << ":" << token.Loc.Line << std::endl;
             }
             HandleIncludeDirectiveStreaming(token);
             continue; // Don't emit directive tokens
@@ -583,13 +752,6 @@ void DMPreprocessor::PushToken(Token&& token) {
     UnprocessedTokens_.push(std::move(token));
 }
 
-void DMPreprocessor::PushTokens(std::vector<Token>&& tokens) {
-    // Push in reverse order so they come out in correct order
-    for (auto it = tokens.rbegin(); it != tokens.rend(); ++it) {
-        UnprocessedTokens_.push(std::move(*it));
-    }
-}
-
 bool DMPreprocessor::TryExpandMacro(const Token& token) {
     // Don't expand macros when in a path context (previous token was / or .)
     // This prevents expansion in proc/MACRO(params), /datum/MACRO, etc.
@@ -603,24 +765,48 @@ bool DMPreprocessor::TryExpandMacro(const Token& token) {
     if (it == Defines_.end()) {
         return false;
     }
-    
-    std::vector<Token> expandedTokens;
-    if (it->second->HasParameters()) {
-        // Function-like macro - read arguments (now returns vector of token vectors)
-        std::vector<std::vector<Token>> arguments = ReadMacroArguments();
-        expandedTokens = it->second->Expand(arguments, token.Loc);
-    } else {
-        // Simple macro
-        expandedTokens = it->second->Expand({}, token.Loc);
+    // Reading the arguments may touch Defines_, which moves its entries
+    DMMacro* macro = it->second.get();
+    if (Dependencies_ && !FileStack_.empty()) {
+        Dependencies_->Files[FileStack_.top().FilePath].MacrosUsed.insert(token.Text);
     }
     
-    PushTokens(std::move(expandedTokens));
+    if (!macro->HasParameters()) {
+        // Simple macro
+        size_t before = UnprocessedTokens_.size();
+        macro->ExpandOnto(MacroArguments(), token.Loc, UnprocessedTokens_);
+        if (Stats_) {
+            PreprocessorStats::MacroStats& stats = Stats_->Macros[token.Text];
+            stats.Expansions++;
+            stats.TokensProduced += UnprocessedTokens_.size() - before;
+        }
+        return true;
+    }
+    
+    // Function-like macro. Arguments can contain macro calls of their own, which
+    // read into the same buffers above this call's entries and truncate back after.
+    size_t tokenBase = MacroArgTokens_.size();
+    size_t rangeBase = MacroArgRanges_.size();
+    ReadMacroArguments();
+    
+    MacroArguments arguments;
+    arguments.Tokens = MacroArgTokens_.data();
+    arguments.Ranges = MacroArgRanges_.data() + rangeBase;
+    arguments.Count = MacroArgRanges_.size() - rangeBase;
+    size_t before = UnprocessedTokens_.size();
+    macro->ExpandOnto(arguments, token.Loc, UnprocessedTokens_);
+    if (Stats_) {
+        PreprocessorStats::MacroStats& stats = Stats_->Macros[token.Text];
+        stats.Expansions++;
+        stats.TokensProduced += UnprocessedTokens_.size() - before;
+    }
+    
+    MacroArgTokens_.erase(MacroArgTokens_.begin() + tokenBase, MacroArgTokens_.end());
+    MacroArgRanges_.erase(MacroArgRanges_.begin() + rangeBase, MacroArgRanges_.end());
     return true;
 }
 
-std::vector<std::vector<Token>> DMPreprocessor::ReadMacroArguments() {
-    std::vector<std::vector<Token>> arguments;
-    
+void DMPreprocessor::ReadMacroArguments() {
     // Expect opening parenthesis
     Token token = GetNextToken();
     while (token.Type == TokenType::DM_Preproc_Whitespace) {
@@ -631,13 +817,30 @@ std::vector<std::vector<Token>> DMPreprocessor::ReadMacroArguments() {
     if (token.Type != TokenType::DM_Preproc_Punctuator_LeftParenthesis &&
         token.Type != TokenType::LeftParenthesis) {
         PushToken(std::move(token));
-        return arguments; // No arguments
+        return; // No arguments
     }
     
-    // Read arguments separated by commas, handling nested parentheses
-    std::vector<Token> currentArg;
+    // Read arguments separated by commas, handling nested parentheses.
+    // Nested macro calls inside the arguments use the buffers too, but they
+    // truncate back before GetNextToken returns, so only this call's tokens remain.
+    size_t rangeBase = MacroArgRanges_.size();
+    size_t argStart = MacroArgTokens_.size();
     int parenDepth = 0;
     
+    // Close the current argument, trimming leading/trailing whitespace from it
+    auto finishArgument = [this, &argStart]() {
+        size_t begin = argStart;
+        size_t end = MacroArgTokens_.size();
+        while (begin < end && MacroArgTokens_[begin].Type == TokenType::DM_Preproc_Whitespace) {
+            ++begin;
+        }
+        while (end > begin && MacroArgTokens_[end - 1].Type == TokenType::DM_Preproc_Whitespace) {
+            --end;
+        }
+        MacroArgRanges_.emplace_back(begin, end);
+        argStart = MacroArgTokens_.size();
+    };
+    
     while (true) {
         token = GetNextToken();
         
@@ -652,49 +855,27 @@ std::vector<std::vector<Token>> DMPreprocessor::ReadMacroArguments() {
         if (token.Type == TokenType::DM_Preproc_Punctuator_LeftParenthesis ||
             token.Type == TokenType::LeftParenthesis) {
             parenDepth++;
-            currentArg.push_back(token);
+            MacroArgTokens_.push_back(std::move(token));
         } else if (token.Type == TokenType::DM_Preproc_Punctuator_RightParenthesis ||
                    token.Type == TokenType::RightParenthesis) {
             if (parenDepth == 0) {
-                // End of arguments
-                if (!currentArg.empty() || !arguments.empty()) {
-                    // Trim leading/trailing whitespace from current arg
-                    while (!currentArg.empty() && currentArg.front().Type == TokenType::DM_Preproc_Whitespace) {
-                        currentArg.erase(currentArg.begin());
-                    }
-                    while (!currentArg.empty() && currentArg.back().Type == TokenType::DM_Preproc_Whitespace) {
-                        currentArg.pop_back();
-                    }
-                    // Keep all tokens for the argument (don't concatenate!)
-                    if (!currentArg.empty()) {
-                        arguments.push_back(std::move(currentArg));
-                    } else if (!arguments.empty()) {
-                        // Empty argument after comma - push empty vector
-                        arguments.push_back({});
-                    }
+                // End of arguments; "()" is a call with no arguments
+                finishArgument();
+                const auto& last = MacroArgRanges_.back();
+                if (last.first == last.second && MacroArgRanges_.size() - 1 == rangeBase) {
+                    MacroArgRanges_.pop_back();
                 }
                 break;
             }
             parenDepth--;
-            currentArg.push_back(token);
+            MacroArgTokens_.push_back(std::move(token));
         } else if ((token.Type == TokenType::DM_Preproc_Punctuator_Comma || token.Type == TokenType::Comma) && parenDepth == 0) {
             // Argument separator
-            // Trim leading/trailing whitespace from current arg
-            while (!currentArg.empty() && currentArg.front().Type == TokenType::DM_Preproc_Whitespace) {
-                currentArg.erase(currentArg.begin());
-            }
-            while (!currentArg.empty() && currentArg.back().Type == TokenType::DM_Preproc_Whitespace) {
-                currentArg.pop_back();
-            }
-            // Keep all tokens for the argument (don't concatenate!)
-            arguments.push_back(std::move(currentArg));
-            currentArg.clear();
+            finishArgument();
         } else {
-            currentArg.push_back(token);
+            MacroArgTokens_.push_back(std::move(token));
         }
     }
-    
-    return arguments;
 }
 
 bool DMPreprocessor::IncludeFile(const std::string& path, const Location& includeLocation) {
@@ -714,19 +895,15 @@ bool DMPreprocessor::IncludeFile(const std::string& path, const Location& includ
         return false;
     }
     
-    // Read file content
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    // Map the file (line continuations are joined here, before lexing)
+    std::shared_ptr<const SourceBuffer> content = LoadPreprocessorSource(path);
+    if (!content) {
         if (Compiler_) {
             Compiler_->ForcedError(includeLocation, "Failed to open file: " + path);
         }
         return false;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
-    
     // Mark as included
     IncludedFiles_.insert(absolutePath);
     
@@ -781,55 +958,15 @@ std::vector<Token> DMPreprocessor::PreprocessFile(const std::string& path, const
         return result;
     }
     
-    // Read file content
-    std::ifstream file(path);
-    if (!file.is_open()) {
+    // Map the file (line continuations are joined here, before lexing)
+    std::shared_ptr<const SourceBuffer> content = LoadPreprocessorSource(path);
+    if (!content) {
         if (Compiler_) {
             Compiler_->ForcedError(includeLocation, "Failed to open file: " + path);
         }
         return result;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string content = buffer.str();
-    
-    // Handle line continuation: backslash at end of line joins with next line
-    // This needs to be done before lexing
-    // We need to handle: \<newline>, \<CRLF>, and \ followed by optional whitespace then newline
-    // Replace the entire continuation sequence with a single space to join lines
-    std::string processedContent;
-    processedContent.reserve(content.size());
-    for (size_t i = 0; i < content.size(); ++i) {
-        if (content[i] == '\\') {
-            // Check if this backslash is followed by optional whitespace then newline
-            size_t j = i + 1;
-            // Skip any spaces or tabs (but not other whitespace)
-            while (j < content.size() && (content[j] == ' ' || content[j] == '\t')) {
-                ++j;
-            }
-            // Now check for newline
-            if (j < content.size()) {
-                if (content[j] == '\n') {
-                    // Line continuation: replace everything with a single space
-                    processedContent.push_back(' ');
-                    i = j;  // Skip past newline (loop will increment)
-                    continue;
-                } else if (content[j] == '\r') {
-                    // Check for CRLF
-                    if (j + 1 < content.size() && content[j + 1] == '\n') {
-                        // Replace with single space
-                        processedContent.push_back(' ');
-                        i = j + 1;  // Skip past CRLF
-                        continue;
-                    }
-                }
-            }
-        }
-        processedContent.push_back(content[i]);
-    }
-    content = std::move(processedContent);
-    
     // Mark as included BEFORE processing to prevent circular includes
     IncludedFiles_.insert(absolutePath);
     
@@ -866,7 +1003,7 @@ std::vector<Token> DMPreprocessor::PreprocessFile(const std::string& path, const
             case TokenType::EndOfFile:
                 // Check if this EOF is from the file we're processing
                 if (!FileStack_.empty() && 
-                    FileStack_.top().Lexer->GetCurrentLocation().SourceFile == absolutePath) {
+                    FileStack_.top().Lexer->GetCurrentLocation().SourceFile() == absolutePath) {
                     // We've finished processing this file
                     FileStack_.pop();
                     processingThisFile = false;
@@ -1022,6 +1159,91 @@ std::string DMPreprocessor::ResolvePath(const std::string& path, const std::stri
     return result;
 }
 
+std::string DMPreprocessor::ResolveIncludePath(const std::string& filePath) {
+    if (FileStack_.empty()) {
+        return filePath;
+    }
+    
+    const std::string& currentDir = FileStack_.top().Directory;
+    std::string cacheKey = currentDir + "|" + filePath;
+    auto it = PathCache_.find(cacheKey);
+    if (it != PathCache_.end()) {
+        return it->second;
+    }
+    
+    std::string resolved = (std::filesystem::path(currentDir) / filePath).string();
+    PathCache_.emplace(std::move(cacheKey), resolved);
+    return resolved;
+}
+
+void DMPreprocessor::RecordIncludeRequest(const std::string& absolutePath) {
+    if (Stats_) {
+        Stats_->Files[absolutePath].IncludedBy++;
+    }
+    if (Dependencies_ && !FileStack_.empty()) {
+        Dependencies_->Files[FileStack_.top().FilePath].Includes.insert(absolutePath);
+    }
+}
+
+bool DMPreprocessor::IsIncludeGuarded(const std::string& absolutePath) const {
+    if (IncludeGuards_.empty()) {
+        return false;
+    }
+    
+    // Normalized so "a/../b.dm" and "b.dm" are recognized as the same file without touching disk
+    auto it = IncludeGuards_.find(std::filesystem::path(absolutePath).lexically_normal().string());
+    if (it == IncludeGuards_.end()) {
+        return false;
+    }
+    return it->second.empty() || IsDefined(it->second);
+}
+
+void DMPreprocessor::TrackIncludeGuard(FileContext& context, const Token& token) {
+    if (context.Guard == FileContext::GuardState::None ||
+        token.Type == TokenType::DM_Preproc_Whitespace ||
+        token.Type == TokenType::Newline ||
+        token.Type == TokenType::EndOfFile) {
+        return;
+    }
+    
+    switch (context.Guard) {
+        case FileContext::GuardState::Start:
+            // Only an #ifndef can open a guard; HandleIfNDefDirectiveStreaming takes it from there
+            if (token.Type != TokenType::DM_Preproc_Ifndef) {
+                context.Guard = FileContext::GuardState::None;
+            }
+            break;
+        case FileContext::GuardState::Inside:
+            if (LastIfEvaluations_.size() == context.GuardDepth + 1) {
+                if (token.Type == TokenType::DM_Preproc_EndIf) {
+                    context.Guard = FileContext::GuardState::Closed;
+                } else if (token.Type == TokenType::DM_Preproc_Else || token.Type == TokenType::DM_Preproc_Elif) {
+                    context.Guard = FileContext::GuardState::None;
+                }
+            }
+            break;
+        case FileContext::GuardState::Closed:
+            // Something follows the guard's #endif
+            context.Guard = FileContext::GuardState::None;
+            break;
+        case FileContext::GuardState::None:
+            break;
+    }
+}
+
+void DMPreprocessor::RecordIncludeGuard(const FileContext& context) {
+    if (!context.PragmaOnce && context.Guard != FileContext::GuardState::Closed) {
+        return;
+    }
+    
+    std::string key = std::filesystem::path(context.FilePath).lexically_normal().string();
+    IncludeGuards_[key] = context.PragmaOnce ? std::string() : context.GuardMacro;
+    if (Compiler_ && Compiler_->GetSettings().Verbose) {
+        std::cout << "  Include guard for " << context.FilePath << ": "
+                  << (context.PragmaOnce ? "#pragma once" : context.GuardMacro) << std::endl;
+    }
+}
+
 std::string DMPreprocessor::ResolveLibraryPath(const std::string& libraryPath, const Location& location) {
     namespace fs = std::filesystem;
     
@@ -1173,13 +1395,7 @@ void DMPreprocessor::HandleIncludeDirective(const Token& token) {
         }
     } else {
         // Resolve path relative to current file
-        resolvedPath = filePath;
-        if (!FileStack_.empty()) {
-            std::string currentFile = FileStack_.top().FilePath;
-            namespace fs = std::filesystem;
-            fs::path currentDir = fs::path(currentFile).parent_path();
-            resolvedPath = (currentDir / filePath).string();
-        }
+        resolvedPath = ResolveIncludePath(filePath);
     }
     
     // Check if already included (skip if so)
@@ -1191,6 +1407,7 @@ void DMPreprocessor::HandleIncludeDirective(const Token& token) {
         ReportError(token.Loc, "Invalid file path: " + filePath);
         return;
     }
+    RecordIncludeRequest(absolutePath);
     
     if (IncludedFiles_.count(absolutePath)) {
         if (Compiler_ && Compiler_->GetSettings().Verbose) {
@@ -1199,6 +1416,14 @@ void DMPreprocessor::HandleIncludeDirective(const Token& token) {
         return; // Already included, skip
     }
     
+    // Reached through another path while its guard is still defined; no need to open it
+    if (IsIncludeGuarded(absolutePath)) {
+        if (Compiler_ && Compiler_->GetSettings().Verbose) {
+            std::cout << "  Skipping include-guarded file: " << absolutePath << std::endl;
+        }
+        return;
+    }
+    
     // Mark as included
     IncludedFiles_.insert(absolutePath);
     
@@ -1407,6 +1632,7 @@ void DMPreprocessor::HandleDefineDirective(const Token& token) {
     }
     
     // Create and store the macro
+    TouchMacro(macroName);
     if (isFunctionMacro) {
         Defines_[macroName] = std::make_unique<DMMacroFunction>(parameters, macroBodyTokens);
     } else {
@@ -1581,6 +1807,14 @@ void DMPreprocessor::HandlePragmaDirective(const Token& token) {
         // Try to parse warning name as enum
         std::string warningName = warningNameToken.Text;
         
+        if (warningName == "once") {
+            if (!FileStack_.empty()) {
+                FileStack_.top().PragmaOnce = true;
+            }
+            ReadLineTokens(); // Consume rest of line
+            return;
+        }
+        
         // Simple mapping - in real implementation, use a proper enum parser
         if (warningName == "SoftReservedKeyword") warningCode = WarningCode::SoftReservedKeyword;
         else if (warningName == "UnimplementedAccess") warningCode = WarningCode::UnimplementedAccess;
@@ -1672,7 +1906,12 @@ void DMPreprocessor::HandlePragmaDirective(const Token& token) {
         return;
     }
     
-    if (Compiler_) {
+    if (Compiler_ && Compiler_->GetSettings().StreamTokens) {
+        // The parser reads warning levels while this thread is still setting
+        // them, so which of its warnings the pragma reached would be down to timing
+        Compiler_->ForcedWarning("#pragma " + warningNameToken.Text + " at " + token.Loc.ToString() +
+                                 " is ignored with --stream-tokens; warning levels cannot change while streaming");
+    } else if (Compiler_) {
         Compiler_->SetPragma(warningCode, level);
     }
     
@@ -1687,6 +1926,12 @@ private:
     size_t pos_;
     DMPreprocessor* preprocessor_;
     std::unordered_set<std::string> expanding_macros_;  // Track macros being expanded to detect cycles
+    std::vector<std::string>* consulted_macros_;  // Every macro name the result depended on
+    
+    bool IsDefined(const std::string& name) {
+        consulted_macros_->push_back(name);
+        return preprocessor_->IsDefined(name);
+    }
 
     Token Current() const {
         if (pos_ >= tokens_.size()) {
@@ -1713,7 +1958,7 @@ private:
         }
         
         // Check if it's defined
-        if (!preprocessor_->IsDefined(macroName)) {
+        if (!IsDefined(macroName)) {
             return 0;
         }
         
@@ -1770,7 +2015,7 @@ private:
         }
         
         // For complex expansions, create a new evaluator
-        PreprocessorExpressionEvaluator subEvaluator(filteredTokens, preprocessor_);
+        PreprocessorExpressionEvaluator subEvaluator(filteredTokens, preprocessor_, consulted_macros_);
         // Copy the expanding_macros_ set to the sub-evaluator to maintain cycle detection
         subEvaluator.expanding_macros_ = expanding_macros_;
         int64_t result = subEvaluator.Evaluate();
@@ -1817,7 +2062,7 @@ private:
                 }
             }
             
-            return preprocessor_->IsDefined(macroName.Text) ? 1 : 0;
+            return IsDefined(macroName.Text) ? 1 : 0;
         }
 
         // Identifier (macro name) - expand and evaluate it
@@ -2065,8 +2310,9 @@ private:
     }
 
 public:
-    PreprocessorExpressionEvaluator(const std::vector<Token>& tokens, DMPreprocessor* preprocessor)
-        : tokens_(tokens), pos_(0), preprocessor_(preprocessor) {}
+    PreprocessorExpressionEvaluator(const std::vector<Token>& tokens, DMPreprocessor* preprocessor,
+                                    std::vector<std::string>* consultedMacros)
+        : tokens_(tokens), pos_(0), preprocessor_(preprocessor), consulted_macros_(consultedMacros) {}
 
     int64_t Evaluate() {
         return ParseTernary();
@@ -2078,16 +2324,71 @@ bool DMPreprocessor::EvaluateCondition(const std::vector<Token>& tokens) {
         return false;
     }
     
-    PreprocessorExpressionEvaluator evaluator(tokens, this);
-    int64_t result = evaluator.Evaluate();
-    return result != 0;
+    // The same guards (DM_VERSION checks, feature flags) recur across many files, so
+    // results are reused while the macros they looked at keep their definitions
+    std::string key;
+    for (const auto& token : tokens) {
+        if (token.Type == TokenType::DM_Preproc_Whitespace) {
+            continue;
+        }
+        key += std::to_string(static_cast<int>(token.Type));
+        key += ':';
+        key += token.Text;
+        key += '\x1f';
+    }
+    
+    auto cached = ConditionCache_.find(key);
+    if (cached != ConditionCache_.end()) {
+        bool valid = true;
+        for (const auto& [name, generation] : cached->second.Dependencies) {
+            if (GetMacroGeneration(name) != generation) {
+                valid = false;
+                break;
+            }
+        }
+        if (valid) {
+            ConditionCacheHits_++;
+            return cached->second.Result;
+        }
+    }
+    
+    std::vector<std::string> consulted;
+    PreprocessorExpressionEvaluator evaluator(tokens, this, &consulted);
+    bool result = evaluator.Evaluate() != 0;
+    
+    ConditionCacheEntry& entry = ConditionCache_[key];
+    entry.Result = result;
+    entry.Dependencies.clear();
+    std::sort(consulted.begin(), consulted.end());
+    consulted.erase(std::unique(consulted.begin(), consulted.end()), consulted.end());
+    for (auto& name : consulted) {
+        uint64_t generation = GetMacroGeneration(name);
+        entry.Dependencies.emplace_back(std::move(name), generation);
+    }
+    return result;
 }
 
 void DMPreprocessor::SkipIfBody(bool skipElse) {
+    if (Stats_) {
+        // Timed as a whole; the body below has several exits
+        auto start = std::chrono::steady_clock::now();
+        SkipIfBodyUntimed(skipElse);
+        Stats_->SkipSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        Stats_->SkippedBlocks++;
+        return;
+    }
+    SkipIfBodyUntimed(skipElse);
+}
+
+void DMPreprocessor::SkipIfBodyUntimed(bool skipElse) {
     int depth = 1;  // Track nesting depth of #if directives
     
     while (depth > 0) {
-        Token token = GetNextRawToken();
+        // Once pushed-back tokens are drained, let the lexer skip the source without tokenizing it;
+        // it returns only the directive that ends the block (nested pairs are counted in depth)
+        Token token = UnprocessedTokens_.empty() && !FileStack_.empty()
+            ? FileStack_.top().Lexer->SkipConditionalBlock(depth, !skipElse)
+            : GetNextRawToken();
         
         if (token.Type == TokenType::EndOfFile) {
             std::cerr << "Error: Unexpected end of file while skipping conditional block" << std::endl;
@@ -2140,7 +2441,7 @@ bool DMPreprocessor::IsDirective(TokenType type) const {
 void DMPreprocessor::HandleIncludeDirectiveStreaming(const Token& token) {
     // Debug
     if (Compiler_ && Compiler_->GetSettings().Verbose) {
-        std::cout << "  HandleIncludeDirectiveStreaming called at " << token.Loc.SourceFile << ":" << token.Loc.Line << std::endl;
+        std::cout << "  HandleIncludeDirectiveStreaming called at " << token.Loc.SourceFile() << ":" << token.Loc.Line << std::endl;
     }
     
     // Read the file path token
@@ -2208,13 +2509,7 @@ void DMPreprocessor::HandleIncludeDirectiveStreaming(const Token& token) {
         }
     } else {
         // Resolve path relative to current file
-        resolvedPath = filePath;
-        if (!FileStack_.empty()) {
-            std::string currentFile = FileStack_.top().FilePath;
-            namespace fs = std::filesystem;
-            fs::path currentDir = fs::path(currentFile).parent_path();
-            resolvedPath = (currentDir / filePath).string();
-        }
+        resolvedPath = ResolveIncludePath(filePath);
     }
     
     // Check if already included
@@ -2226,6 +2521,7 @@ void DMPreprocessor::HandleIncludeDirectiveStreaming(const Token& token) {
         ReportError(token.Loc, "Invalid file path: " + filePath);
         return;
     }
+    RecordIncludeRequest(absolutePath);
     
     if (IncludedFiles_.count(absolutePath)) {
         if (Compiler_ && Compiler_->GetSettings().Verbose) {
@@ -2234,6 +2530,14 @@ void DMPreprocessor::HandleIncludeDirectiveStreaming(const Token& token) {
         return; // Already included, skip
     }
     
+    // Reached through another path while its guard is still defined; no need to open it
+    if (IsIncludeGuarded(absolutePath)) {
+        if (Compiler_ && Compiler_->GetSettings().Verbose) {
+            std::cout << "  Skipping include-guarded file: " << absolutePath << std::endl;
+        }
+        return;
+    }
+    
     // Mark as included
     IncludedFiles_.insert(absolutePath);
     
@@ -2307,15 +2611,27 @@ void DMPreprocessor::HandleIfNDefDirectiveStreaming(const Token& token) {
         defineToken = GetNextRawToken();
     }
     
+    // An #ifndef before anything else in the file may be an include guard
+    FileContext* context = FileStack_.empty() ? nullptr : &FileStack_.top();
+    bool opensGuard = context && context->Guard == FileContext::GuardState::Start;
+    
     if (defineToken.Type != TokenType::DM_Preproc_Identifier && 
         defineToken.Type != TokenType::Identifier) {
         ReportError(token.Loc, "#ifndef directive requires a macro name (identifier)");
+        if (opensGuard) {
+            context->Guard = FileContext::GuardState::None;
+        }
         LastIfEvaluations_.push(false);
         SkipIfBody(false);
         return;
     }
     
     bool result = !IsDefined(defineToken.Text);
+    if (opensGuard) {
+        context->Guard = result ? FileContext::GuardState::Inside : FileContext::GuardState::None;
+        context->GuardMacro = defineToken.Text;
+        context->GuardDepth = LastIfEvaluations_.size();
+    }
     LastIfEvaluations_.push(result);
     
     if (!result) {
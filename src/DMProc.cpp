@@ -3,11 +3,14 @@
 #include "DMObject.h"
 #include "DMAST.h"
 #include "DMCompiler.h"
+#include "CompileCosts.h"
+#include "ProcCache.h"
 #include "DMObjectTree.h"
 #include "BytecodeWriter.h"
 #include "DMExpressionCompiler.h"
 #include "DMStatementCompiler.h"
 #include "DreamProcOpcode.h"
+#include "SortedEntries.h"
 #include <sstream>
 #include <algorithm>
 #include <cctype>
@@ -68,7 +71,6 @@ DMProc::DMProc(
     , MaxStackSize(0)
     , Invisibility(0)
     , SourceLocation(location)
-    , LocalVariableIdCounter_(0)
 {
 }
 
@@ -78,7 +80,7 @@ LocalVariable* DMProc::AddParameter(
     std::optional<DMComplexValueType> explicitValueType
 ) {
     // Check if already exists
-    if (LocalVariables.find(name) != LocalVariables.end()) {
+    if (GetLocalVariable(name)) {
         return nullptr; // Parameter already exists
     }
     
@@ -86,18 +88,13 @@ LocalVariable* DMProc::AddParameter(
     Parameters.push_back(name);
     
     // Create the local variable
-    auto var = std::make_unique<LocalVariable>(
+    return DeclareLocal(std::make_unique<LocalVariable>(
         name,
-        LocalVariableIdCounter_++,
+        AllocateSlot(),
         true, // isParameter
         type,
         explicitValueType
-    );
-    
-    auto* varPtr = var.get();
-    LocalVariables[name] = std::move(var);
-    
-    return varPtr;
+    ));
 }
 
 LocalVariable* DMProc::AddLocalVariable(
@@ -105,23 +102,18 @@ LocalVariable* DMProc::AddLocalVariable(
     std::optional<DreamPath> type
 ) {
     // Check if already exists
-    if (LocalVariables.find(name) != LocalVariables.end()) {
+    if (GetLocalVariable(name)) {
         return nullptr; // Variable already exists
     }
     
     // Create the local variable
-    auto var = std::make_unique<LocalVariable>(
+    return DeclareLocal(std::make_unique<LocalVariable>(
         name,
-        LocalVariableIdCounter_++,
+        AllocateSlot(),
         false, // not a parameter
         type,
         std::nullopt
-    );
-    
-    auto* varPtr = var.get();
-    LocalVariables[name] = std::move(var);
-    
-    return varPtr;
+    ));
 }
 
 LocalConstVariable* DMProc::AddLocalConst(
@@ -130,38 +122,31 @@ LocalConstVariable* DMProc::AddLocalConst(
     Constant value
 ) {
     // Check if already exists
-    if (LocalVariables.find(name) != LocalVariables.end()) {
+    if (GetLocalVariable(name)) {
         return nullptr; // Variable already exists
     }
     
     // Create the const local variable
-    auto var = std::make_unique<LocalConstVariable>(
+    return static_cast<LocalConstVariable*>(DeclareLocal(std::make_unique<LocalConstVariable>(
         name,
-        LocalVariableIdCounter_++,
+        AllocateSlot(),
         type,
         std::move(value)
-    );
-    
-    auto* varPtr = var.get();
-    LocalVariables[name] = std::move(var);
-    
-    return varPtr;
+    )));
 }
 
 LocalVariable* DMProc::GetLocalVariable(const std::string& name) {
-    auto it = LocalVariables.find(name);
-    if (it != LocalVariables.end()) {
-        return it->second.get();
+    // Few locals are in scope at once, so scanning them beats hashing the name
+    for (auto it = VisibleLocals_.rbegin(); it != VisibleLocals_.rend(); ++it) {
+        if ((*it)->Name == name) {
+            return *it;
+        }
     }
     return nullptr;
 }
 
 const LocalVariable* DMProc::GetLocalVariable(const std::string& name) const {
-    auto it = LocalVariables.find(name);
-    if (it != LocalVariables.end()) {
-        return it->second.get();
-    }
-    return nullptr;
+    return const_cast<DMProc*>(this)->GetLocalVariable(name);
 }
 
 bool DMProc::HasParameter(const std::string& name) const {
@@ -172,6 +157,53 @@ int DMProc::GetLocalVariableCount() const {
     return static_cast<int>(LocalVariables.size()) - static_cast<int>(Parameters.size());
 }
 
+void DMProc::StartScope() {
+    ScopeStarts_.push_back(VisibleLocals_.size());
+}
+
+void DMProc::EndScope() {
+    if (ScopeStarts_.empty()) {
+        return;
+    }
+    size_t start = ScopeStarts_.back();
+    ScopeStarts_.pop_back();
+    for (size_t i = start; i < VisibleLocals_.size(); ++i) {
+        LocalSlot& slot = Slots_[VisibleLocals_[i]->Id];
+        if (!slot.Pinned) {
+            slot.Holder = nullptr;
+        }
+    }
+    VisibleLocals_.resize(start);
+}
+
+bool DMProc::NeedsNullStore(const LocalVariable* local) {
+    LocalSlot& slot = Slots_[local->Id];
+    if (slot.Reused) {
+        return true;
+    }
+    slot.Pinned = true;
+    return false;
+}
+
+int DMProc::AllocateSlot() {
+    for (size_t i = 0; i < Slots_.size(); ++i) {
+        if (Slots_[i].Holder == nullptr) {
+            Slots_[i].Reused = true;
+            return static_cast<int>(i);
+        }
+    }
+    Slots_.emplace_back();
+    return static_cast<int>(Slots_.size()) - 1;
+}
+
+LocalVariable* DMProc::DeclareLocal(std::unique_ptr<LocalVariable> local) {
+    LocalVariable* declared = local.get();
+    Slots_[declared->Id].Holder = declared;
+    VisibleLocals_.push_back(declared);
+    LocalVariables.push_back(std::move(local));
+    return declared;
+}
+
 void DMProc::MarkUnsupported(const std::string& reason) {
     UnsupportedReason = reason;
 }
@@ -292,7 +324,28 @@ std::string DMProc::ToString() const {
     return oss.str();
 }
 
+void DMProc::LoadDeferredBody(DMCompiler* compiler) {
+    if (AstBody == nullptr && AstDefinition) {
+        compiler->ParseDeferredProcBody(AstDefinition);
+        AstBody = AstDefinition->Body.get();
+    }
+}
+
+void DMProc::ResetCompilation() {
+    Slots_ = CompileSlots_;
+    VisibleLocals_ = CompileVisibleLocals_;
+    ScopeStarts_.clear();
+    LocalVariables.resize(CompileLocalCount_);
+    EnumeratorIdCounter_ = CompileEnumeratorIdStart_;
+    UnsupportedReason = CompileUnsupportedReason_;
+    Bytecode.clear();
+    MaxStackSize = 0;
+}
+
 void DMProc::Compile(DMCompiler* compiler) {
+    CompileCosts::ProcTimer costTimer(compiler ? compiler->GetCosts() : nullptr, this);
+    LoadDeferredBody(compiler);
+    
     // Skip if already compiled or marked as unsupported
     if (IsUnsupported()) {
         return;
@@ -303,6 +356,15 @@ void DMProc::Compile(DMCompiler* compiler) {
         return;
     }
     
+    CompileLocalCount_ = LocalVariables.size();
+    CompileSlots_ = Slots_;
+    CompileVisibleLocals_ = VisibleLocals_;
+    CompileEnumeratorIdStart_ = EnumeratorIdCounter_;
+    CompileUnsupportedReason_ = UnsupportedReason;
+    
+    // Stores the result in the proc cache (--proc-cache) unless the compile reports anything
+    ProcCache::Recorder cacheRecorder(compiler ? compiler->GetProcCache() : nullptr, this);
+    
     // Initialization procs have null AstBody - they're created dynamically
     if (AstBody == nullptr && Name == "__init__") {
         // For initialization procs, we need to:
@@ -313,7 +375,8 @@ void DMProc::Compile(DMCompiler* compiler) {
             return;
         }
         
-        BytecodeWriter writer;
+        PooledBytecodeWriter pooledWriter(compiler->GetObjectTree());
+        BytecodeWriter& writer = *pooledWriter;
         DMExpressionCompiler exprCompiler(compiler, this, &writer);
         
         // 1. Call parent's init proc if it exists
@@ -330,8 +393,10 @@ void DMProc::Compile(DMCompiler* compiler) {
         }
         
         // 2. Emit bytecode to evaluate and assign each variable's Value expression
+        // (in name order, so the bytecode and the strings it interns never depend on hashing)
         // Process Variables (defined on this type)
-        for (const auto& [varName, variable] : OwningObject->Variables) {
+        for (const auto* entry : SortedEntries(OwningObject->Variables)) {
+            const auto& [varName, variable] = *entry;
             if (variable.Value == nullptr) {
                 continue;  // No initialization needed
             }
@@ -365,7 +430,8 @@ void DMProc::Compile(DMCompiler* compiler) {
         }
         
         // Process VariableOverrides (overridden from parent types)
-        for (const auto& [varName, variable] : OwningObject->VariableOverrides) {
+        for (const auto* entry : SortedEntries(OwningObject->VariableOverrides)) {
+            const auto& [varName, variable] = *entry;
             if (variable.Value == nullptr) {
                 continue;  // No initialization needed
             }
@@ -401,10 +467,7 @@ void DMProc::Compile(DMCompiler* compiler) {
         writer.Emit(DreamProcOpcode::Return);
         
         // Finalize and copy bytecode to proc
-        writer.Finalize();
-        Bytecode = writer.GetBytecode();
-        MaxStackSize = writer.GetMaxStackSize();
-        
+        StoreBytecode(compiler, writer);
         return;
     }
     
@@ -418,7 +481,8 @@ void DMProc::Compile(DMCompiler* compiler) {
     // No need to register them again here
     
     // Create bytecode writer and compilers
-    BytecodeWriter writer;
+    PooledBytecodeWriter pooledWriter(compiler->GetObjectTree());
+    BytecodeWriter& writer = *pooledWriter;
     DMExpressionCompiler exprCompiler(compiler, this, &writer);
     DMStatementCompiler stmtCompiler(compiler, this, &writer, &exprCompiler);
     
@@ -456,11 +520,31 @@ void DMProc::Compile(DMCompiler* compiler) {
         writer.Emit(DreamProcOpcode::Return);
     }
     
-    // 5. Finalize bytecode (resolve jump labels)
+    // 5. Optimize, then finalize bytecode (resolve jump labels)
+    StoreBytecode(compiler, writer);
+}
+
+void DMProc::StoreBytecode(DMCompiler* compiler, BytecodeWriter& writer) {
+    const DMCompilerSettings& settings = compiler->GetSettings();
+    // A check (--check-only) keeps the diagnostics, not the code
+    if (!settings.NoOpts && !settings.CheckOnly) {
+        writer.Optimize(GetParameterCount(), settings.FusedOpcodes || Temperature == ProcTemperature::Hot);
+    }
+    if (!settings.CheckOnly || settings.VerifyStack) {
+        std::vector<std::string> disagreements = writer.AnalyzeStack();
+        if (settings.VerifyStack) {
+            std::string path = OwningObject ? OwningObject->Path.ToString() : std::string();
+            for (const auto& disagreement : disagreements) {
+                compiler->ForcedWarning("--verify-stack: " + path + "/" + Name + ": " + disagreement);
+            }
+        }
+    }
+    if (settings.CompactOperands && !settings.CheckOnly) {
+        writer.CompactOperands();
+    }
     writer.Finalize();
     
-    // Store the compiled bytecode and max stack size
-    Bytecode = writer.GetBytecode();
+    Bytecode = writer.TakeBytecode();
     MaxStackSize = writer.GetMaxStackSize();
 }
 
@@ -0,0 +1,184 @@
+#include "DMStandardSnapshot.h"
+#include "DMConstants.h"
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <filesystem>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char SnapshotMagic[4] = {'D', 'M', 'S', 'S'};
+static constexpr uint32_t SnapshotFormatVersion = 3;
+
+namespace {
+
+struct SourceStamp {
+    std::string RelativePath;
+    uint64_t Size;
+    int64_t ModifiedTime;
+
+    bool operator==(const SourceStamp& other) const {
+        return RelativePath == other.RelativePath && Size == other.Size && ModifiedTime == other.ModifiedTime;
+    }
+};
+
+// Stat every DM source under the DMStandard directory (no file contents are read)
+std::vector<SourceStamp> StampDirectory(const std::string& standardDir) {
+    std::vector<SourceStamp> stamps;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(standardDir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string extension = it->path().extension().string();
+        if (!it->is_regular_file(ec) || (extension != ".dm" && extension != ".dme")) {
+            continue;
+        }
+        SourceStamp stamp;
+        stamp.RelativePath = fs::relative(it->path(), standardDir, ec).generic_string();
+        stamp.Size = static_cast<uint64_t>(it->file_size(ec));
+        stamp.ModifiedTime = static_cast<int64_t>(it->last_write_time(ec).time_since_epoch().count());
+        stamps.push_back(std::move(stamp));
+    }
+    std::sort(stamps.begin(), stamps.end(), [](const SourceStamp& a, const SourceStamp& b) {
+        return a.RelativePath < b.RelativePath;
+    });
+    return stamps;
+}
+
+// FNV-1a over the file stamps, then the defines sorted by name so the order
+// they were given in doesn't matter
+uint64_t HashStamps(const std::vector<SourceStamp>& stamps,
+                    const std::unordered_map<std::string, std::string>& defines) {
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<const unsigned char*>(data)[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    for (const auto& stamp : stamps) {
+        mix(stamp.RelativePath.data(), stamp.RelativePath.size() + 1);
+        mix(&stamp.Size, sizeof(stamp.Size));
+        mix(&stamp.ModifiedTime, sizeof(stamp.ModifiedTime));
+    }
+    std::vector<std::pair<std::string, std::string>> sorted(defines.begin(), defines.end());
+    std::sort(sorted.begin(), sorted.end());
+    for (const auto& [name, value] : sorted) {
+        mix(name.data(), name.size() + 1);
+        mix(value.data(), value.size() + 1);
+    }
+    return hash;
+}
+
+} // namespace
+
+uint64_t DMStandardSnapshot::StampSources(const std::string& standardDir,
+                                          const std::unordered_map<std::string, std::string>& defines) {
+    return HashStamps(StampDirectory(standardDir), defines);
+}
+
+bool DMStandardSnapshot::Load(const std::string& path, const std::string& standardDir,
+                              const std::unordered_map<std::string, std::string>& defines) {
+    std::string data;
+    if (!ReadBinaryFile(path, data)) {
+        return false;
+    }
+
+    BinaryReader reader(data);
+    if (!reader.VerifyChecksum() ||
+        !reader.Expect(SnapshotMagic, sizeof(SnapshotMagic)) ||
+        reader.Read<uint32_t>() != SnapshotFormatVersion ||
+        reader.Read<uint32_t>() != static_cast<uint32_t>(Versions::LEXER_VERSION)) {
+        return false;
+    }
+
+    std::vector<SourceStamp> current = StampDirectory(standardDir);
+    SourcesStamp = HashStamps(current, defines);
+    if (reader.Read<uint64_t>() != SourcesStamp) {
+        return false;
+    }
+    uint32_t stampCount = reader.Read<uint32_t>();
+    if (!reader.Ok() || stampCount != current.size()) {
+        return false;
+    }
+    for (uint32_t i = 0; i < stampCount; ++i) {
+        SourceStamp stamp;
+        stamp.RelativePath = reader.ReadString();
+        stamp.Size = reader.Read<uint64_t>();
+        stamp.ModifiedTime = reader.Read<int64_t>();
+        if (!reader.Ok() || !(stamp == current[i])) {
+            return false;
+        }
+    }
+
+    uint32_t constantCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < constantCount && reader.Ok(); ++i) {
+        std::string name = reader.ReadString();
+        int value = reader.Read<int32_t>();
+        Constants.emplace_back(std::move(name), value);
+    }
+
+    uint32_t pragmaCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < pragmaCount && reader.Ok(); ++i) {
+        auto code = static_cast<WarningCode>(reader.Read<int32_t>());
+        auto level = static_cast<ErrorLevel>(reader.Read<int32_t>());
+        Pragmas.emplace_back(code, level);
+    }
+
+    uint32_t directoryCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < directoryCount && reader.Ok(); ++i) {
+        ResourceDirectories.push_back(reader.ReadString());
+    }
+
+    if (!ReadTokens(reader, Tokens, true, SourceFileRegistry::UnknownFileId)) {
+        *this = DMStandardSnapshot();
+        return false;
+    }
+    return true;
+}
+
+bool DMStandardSnapshot::Save(const std::string& path, const std::string& standardDir,
+                              const std::unordered_map<std::string, std::string>& defines) const {
+    BinaryWriter writer;
+    writer.Reserve(64 + Tokens.size() * 24);
+    writer.WriteBytes(SnapshotMagic, sizeof(SnapshotMagic));
+    writer.Write<uint32_t>(SnapshotFormatVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(Versions::LEXER_VERSION));
+
+    std::vector<SourceStamp> stamps = StampDirectory(standardDir);
+    writer.Write<uint64_t>(HashStamps(stamps, defines));
+    writer.Write<uint32_t>(static_cast<uint32_t>(stamps.size()));
+    for (const auto& stamp : stamps) {
+        writer.WriteString(stamp.RelativePath);
+        writer.Write<uint64_t>(stamp.Size);
+        writer.Write<int64_t>(stamp.ModifiedTime);
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(Constants.size()));
+    for (const auto& [name, value] : Constants) {
+        writer.WriteString(name);
+        writer.Write<int32_t>(value);
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(Pragmas.size()));
+    for (const auto& [code, level] : Pragmas) {
+        writer.Write<int32_t>(static_cast<int32_t>(code));
+        writer.Write<int32_t>(static_cast<int32_t>(level));
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(ResourceDirectories.size()));
+    for (const auto& directory : ResourceDirectories) {
+        writer.WriteString(directory);
+    }
+
+    WriteTokens(writer, Tokens, true);
+    writer.WriteChecksum();
+
+    std::error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent, ec);
+    }
+    return WriteBinaryFileAtomic(path, writer.Data());
+}
+
+} // namespace DMCompiler
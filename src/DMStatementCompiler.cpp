@@ -4,58 +4,73 @@
 #include "DMObjectTree.h"
 #include "DreamProcOpcode.h"
 #include "DMASTExpression.h"
+#include "DMASTFolder.h"
 #include <iostream>
 #include <sstream>
 #include <optional>
 #include <algorithm>
 #include <cctype>
+#include <cmath>
 
 namespace DMCompiler {
 
 namespace {
 
+// Keeps the locals declared while it lives visible until it goes away, also
+// when a statement stops compiling early
+class LocalScope {
+public:
+    explicit LocalScope(DMProc* proc) : Proc_(proc) { Proc_->StartScope(); }
+    ~LocalScope() { Proc_->EndScope(); }
+    LocalScope(const LocalScope&) = delete;
+    LocalScope& operator=(const LocalScope&) = delete;
+
+private:
+    DMProc* Proc_;
+};
+
 bool EvaluateSetConstant(DMASTExpression* expr, std::string& outString, std::optional<bool>& outBool) {
     if (!expr) {
         return false;
     }
     
-    if (auto* constStr = dynamic_cast<DMASTConstantString*>(expr)) {
+    if (auto* constStr = DMASTCast<DMASTConstantString>(expr)) {
         outString = constStr->Value;
         outBool.reset();
         return true;
     }
     
-    if (auto* constInt = dynamic_cast<DMASTConstantInteger*>(expr)) {
+    if (auto* constInt = DMASTCast<DMASTConstantInteger>(expr)) {
         outString = std::to_string(constInt->Value);
         outBool = (constInt->Value != 0);
         return true;
     }
     
-    if (auto* constFloat = dynamic_cast<DMASTConstantFloat*>(expr)) {
+    if (auto* constFloat = DMASTCast<DMASTConstantFloat>(expr)) {
         outString = std::to_string(constFloat->Value);
         outBool = (constFloat->Value != 0.0f);
         return true;
     }
     
-    if (auto* constNull = dynamic_cast<DMASTConstantNull*>(expr)) {
+    if (auto* constNull = DMASTCast<DMASTConstantNull>(expr)) {
         outString = "null";
         outBool = false;
         return true;
     }
     
-    if (auto* constPath = dynamic_cast<DMASTConstantPath*>(expr)) {
+    if (auto* constPath = DMASTCast<DMASTConstantPath>(expr)) {
         outString = constPath->Path.Path.ToString();
         outBool.reset();
         return true;
     }
     
-    if (auto* constResource = dynamic_cast<DMASTConstantResource*>(expr)) {
+    if (auto* constResource = DMASTCast<DMASTConstantResource>(expr)) {
         outString = constResource->Path;
         outBool.reset();
         return true;
     }
     
-    if (auto* ident = dynamic_cast<DMASTIdentifier*>(expr)) {
+    if (auto* ident = DMASTCast<DMASTIdentifier>(expr)) {
         outString = ident->Identifier;
         std::string lower = outString;
         std::transform(lower.begin(), lower.end(), lower.begin(),
@@ -77,7 +92,7 @@ VerbSrc AnalyzeVerbSrc(DMASTExpression* expr) {
     if (!expr) return VerbSrc::Mob; // Default
 
     // Handle identifiers: usr, world, contents
-    if (auto* ident = dynamic_cast<DMASTIdentifier*>(expr)) {
+    if (auto* ident = DMASTCast<DMASTIdentifier>(expr)) {
         std::string name = ident->Identifier;
         if (name == "usr") return VerbSrc::Mob;
         if (name == "world") return VerbSrc::World;
@@ -86,8 +101,8 @@ VerbSrc AnalyzeVerbSrc(DMASTExpression* expr) {
     }
     
     // Handle calls: view(), oview()
-    if (auto* call = dynamic_cast<DMASTCall*>(expr)) {
-        if (auto* ident = dynamic_cast<DMASTIdentifier*>(call->Target.get())) {
+    if (auto* call = DMASTCast<DMASTCall>(expr)) {
+        if (auto* ident = DMASTCast<DMASTIdentifier>(call->Target.get())) {
             std::string name = ident->Identifier;
             if (name == "view") return VerbSrc::View;
             if (name == "oview") return VerbSrc::OView;
@@ -97,6 +112,109 @@ VerbSrc AnalyzeVerbSrc(DMASTExpression* expr) {
     return VerbSrc::Mob; // Fallback
 }
 
+bool MustCompile(DMASTProcBlockInner* block);
+
+// Labels can be reached by goto and set statements apply to the whole proc,
+// so a branch holding either has to be compiled even when it never runs
+bool MustCompile(DMASTProcStatement* statement) {
+    if (!statement) {
+        return false;
+    }
+    
+    switch (statement->Kind_) {
+        case DMASTNodeKind::ProcStatementLabel:
+        case DMASTNodeKind::ProcStatementSet:
+            return true;
+        case DMASTNodeKind::ProcStatementSpawn:
+            return MustCompile(static_cast<DMASTProcStatementSpawn*>(statement)->Body.get());
+        case DMASTNodeKind::ProcStatementIf: {
+            auto* statementIf = static_cast<DMASTProcStatementIf*>(statement);
+            return MustCompile(statementIf->Body.get()) || MustCompile(statementIf->ElseBody.get());
+        }
+        case DMASTNodeKind::ProcStatementFor: {
+            auto* statementFor = static_cast<DMASTProcStatementFor*>(statement);
+            return MustCompile(statementFor->Initializer.get()) || MustCompile(statementFor->Body.get());
+        }
+        case DMASTNodeKind::ProcStatementForIn:
+            return MustCompile(static_cast<DMASTProcStatementForIn*>(statement)->Body.get());
+        case DMASTNodeKind::ProcStatementForRange:
+            return MustCompile(static_cast<DMASTProcStatementForRange*>(statement)->Body.get());
+        case DMASTNodeKind::ProcStatementWhile:
+            return MustCompile(static_cast<DMASTProcStatementWhile*>(statement)->Body.get());
+        case DMASTNodeKind::ProcStatementDoWhile:
+            return MustCompile(static_cast<DMASTProcStatementDoWhile*>(statement)->Body.get());
+        case DMASTNodeKind::ProcStatementSwitch: {
+            for (const auto& switchCase : static_cast<DMASTProcStatementSwitch*>(statement)->Cases) {
+                if (MustCompile(switchCase.Body.get())) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case DMASTNodeKind::ProcStatementTryCatch: {
+            auto* tryCatch = static_cast<DMASTProcStatementTryCatch*>(statement);
+            return MustCompile(tryCatch->TryBody.get()) || MustCompile(tryCatch->CatchBody.get());
+        }
+        default:
+            return false;
+    }
+}
+
+bool MustCompile(DMASTProcBlockInner* block) {
+    if (!block) {
+        return false;
+    }
+    for (const auto& statement : block->Statements) {
+        if (MustCompile(statement.get())) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Switches with at least this many numeric tests, one of them a range, are
+// dispatched by binary search; this many tests or fewer are checked in a row
+constexpr size_t SwitchSearchMinTests = 8;
+constexpr size_t SwitchSearchLeafTests = 3;
+
+// Hot procs search any switch that splits at least once; cold procs keep the
+// shorter linear chain
+size_t SwitchSearchMinTestsFor(ProcTemperature temperature) {
+    switch (temperature) {
+        case ProcTemperature::Hot:
+            return SwitchSearchLeafTests + 1;
+        case ProcTemperature::Cold:
+            return SIZE_MAX;
+        default:
+            return SwitchSearchMinTests;
+    }
+}
+
+// The number a literal holds; NaN is left out since it cannot be ordered
+std::optional<float> AsNumber(const DMASTExpression* expr) {
+    if (auto* constInt = DMASTCast<DMASTConstantInteger>(expr)) {
+        return static_cast<float>(constInt->Value);
+    }
+    if (auto* constFloat = DMASTCast<DMASTConstantFloat>(expr)) {
+        if (!std::isnan(constFloat->Value)) {
+            return constFloat->Value;
+        }
+    }
+    return std::nullopt;
+}
+
+// Truth of "left op right" for two literals, or nullopt if it is left to the runtime
+std::optional<bool> CompareConstants(BinaryOperator op, std::unique_ptr<DMASTExpression> left,
+                                     std::unique_ptr<DMASTExpression> right) {
+    if (!left || !right) {
+        return std::nullopt;
+    }
+    Location location = left->Location_;
+    DMASTExpressionBinary comparison(location, op, std::move(left), std::move(right));
+    auto result = DMASTFolder::FoldBinary(&comparison);
+    return result ? DMASTFolder::SimpleTruth(result.get()) : std::nullopt;
+}
+
 } // namespace
 
 DMStatementCompiler::DMStatementCompiler(DMCompiler* compiler, DMProc* proc, 
@@ -112,40 +230,43 @@ bool DMStatementCompiler::CompileStatement(DMASTProcStatement* statement) {
     }
     
     // Dispatch to appropriate compilation method based on statement type
-    if (auto* expr = dynamic_cast<DMASTProcStatementExpression*>(statement)) {
-        return CompileExpression(expr);
-    } else if (auto* ret = dynamic_cast<DMASTProcStatementReturn*>(statement)) {
-        return CompileReturn(ret);
-    } else if (auto* ifStmt = dynamic_cast<DMASTProcStatementIf*>(statement)) {
-        return CompileIf(ifStmt);
-    } else if (auto* whileStmt = dynamic_cast<DMASTProcStatementWhile*>(statement)) {
-        return CompileWhile(whileStmt);
-    } else if (auto* doWhileStmt = dynamic_cast<DMASTProcStatementDoWhile*>(statement)) {
-        return CompileDoWhile(doWhileStmt);
-    } else if (auto* forStmt = dynamic_cast<DMASTProcStatementFor*>(statement)) {
-        return CompileFor(forStmt);
-    } else if (auto* forRangeStmt = dynamic_cast<DMASTProcStatementForRange*>(statement)) {
-        return CompileForRange(forRangeStmt);
-    } else if (auto* forInStmt = dynamic_cast<DMASTProcStatementForIn*>(statement)) {
-        return CompileForIn(forInStmt);
-    } else if (auto* switchStmt = dynamic_cast<DMASTProcStatementSwitch*>(statement)) {
-        return CompileSwitch(switchStmt);
-    } else if (auto* breakStmt = dynamic_cast<DMASTProcStatementBreak*>(statement)) {
-        return CompileBreak(breakStmt);
-    } else if (auto* continueStmt = dynamic_cast<DMASTProcStatementContinue*>(statement)) {
-        return CompileContinue(continueStmt);
-    } else if (auto* varDecl = dynamic_cast<DMASTProcStatementVarDeclaration*>(statement)) {
-        return CompileVarDeclaration(varDecl);
-    } else if (auto* delStmt = dynamic_cast<DMASTProcStatementDel*>(statement)) {
-        return CompileDel(delStmt);
-    } else if (auto* spawnStmt = dynamic_cast<DMASTProcStatementSpawn*>(statement)) {
-        return CompileSpawn(spawnStmt);
-    } else if (auto* labelStmt = dynamic_cast<DMASTProcStatementLabel*>(statement)) {
-        return CompileLabel(labelStmt);
-    } else if (auto* gotoStmt = dynamic_cast<DMASTProcStatementGoto*>(statement)) {
-        return CompileGoto(gotoStmt);
-    } else if (auto* setStmt = dynamic_cast<DMASTProcStatementSet*>(statement)) {
-        return CompileSet(setStmt);
+    switch (statement->Kind_) {
+        case DMASTNodeKind::ProcStatementExpression:
+            return CompileExpression(static_cast<DMASTProcStatementExpression*>(statement));
+        case DMASTNodeKind::ProcStatementReturn:
+            return CompileReturn(static_cast<DMASTProcStatementReturn*>(statement));
+        case DMASTNodeKind::ProcStatementIf:
+            return CompileIf(static_cast<DMASTProcStatementIf*>(statement));
+        case DMASTNodeKind::ProcStatementWhile:
+            return CompileWhile(static_cast<DMASTProcStatementWhile*>(statement));
+        case DMASTNodeKind::ProcStatementDoWhile:
+            return CompileDoWhile(static_cast<DMASTProcStatementDoWhile*>(statement));
+        case DMASTNodeKind::ProcStatementFor:
+            return CompileFor(static_cast<DMASTProcStatementFor*>(statement));
+        case DMASTNodeKind::ProcStatementForRange:
+            return CompileForRange(static_cast<DMASTProcStatementForRange*>(statement));
+        case DMASTNodeKind::ProcStatementForIn:
+            return CompileForIn(static_cast<DMASTProcStatementForIn*>(statement));
+        case DMASTNodeKind::ProcStatementSwitch:
+            return CompileSwitch(static_cast<DMASTProcStatementSwitch*>(statement));
+        case DMASTNodeKind::ProcStatementBreak:
+            return CompileBreak(static_cast<DMASTProcStatementBreak*>(statement));
+        case DMASTNodeKind::ProcStatementContinue:
+            return CompileContinue(static_cast<DMASTProcStatementContinue*>(statement));
+        case DMASTNodeKind::ProcStatementVarDeclaration:
+            return CompileVarDeclaration(static_cast<DMASTProcStatementVarDeclaration*>(statement));
+        case DMASTNodeKind::ProcStatementDel:
+            return CompileDel(static_cast<DMASTProcStatementDel*>(statement));
+        case DMASTNodeKind::ProcStatementSpawn:
+            return CompileSpawn(static_cast<DMASTProcStatementSpawn*>(statement));
+        case DMASTNodeKind::ProcStatementLabel:
+            return CompileLabel(static_cast<DMASTProcStatementLabel*>(statement));
+        case DMASTNodeKind::ProcStatementGoto:
+            return CompileGoto(static_cast<DMASTProcStatementGoto*>(statement));
+        case DMASTNodeKind::ProcStatementSet:
+            return CompileSet(static_cast<DMASTProcStatementSet*>(statement));
+        default:
+            break;
     }
     
     std::string contextMsg = "Unknown statement type at " + statement->Location_.ToString();
@@ -161,6 +282,9 @@ bool DMStatementCompiler::CompileBlockInner(DMASTProcBlockInner* block) {
         return true; // Empty block is OK
     }
     
+    // Locals declared in the block end with it, so later ones can take their slots
+    LocalScope scope(Proc_);
+    
     // Compile each statement in the block
     for (const auto& statement : block->Statements) {
         if (!CompileStatement(statement.get())) {
@@ -187,6 +311,147 @@ void DMStatementCompiler::EmitLabel(const std::string& label) {
     Writer_->MarkLabel(labelId);
 }
 
+// ===== Dead Branch Elimination =====
+
+std::optional<bool> DMStatementCompiler::ConstantCondition(DMASTExpression* condition) {
+    if (Compiler_->GetSettings().NoOpts) {
+        return std::nullopt;
+    }
+    auto value = ExprCompiler_->TryEvaluateConstant(condition);
+    return value ? DMASTFolder::SimpleTruth(value.get()) : std::nullopt;
+}
+
+std::optional<DMASTProcBlockInner*> DMStatementCompiler::ConstantSwitchTarget(DMASTProcStatementSwitch* stmt) {
+    if (Compiler_->GetSettings().NoOpts || !ExprCompiler_->TryEvaluateConstant(stmt->Value.get())) {
+        return std::nullopt;
+    }
+    
+    // Cases are tested in order, so only the ones before the match need to be known
+    DMASTProcBlockInner* defaultBody = nullptr;
+    for (auto& switchCase : stmt->Cases) {
+        if (switchCase.Values.empty()) {
+            defaultBody = switchCase.Body.get();
+            continue;
+        }
+        for (auto& value : switchCase.Values) {
+            std::optional<bool> matches;
+            if (auto* range = DMASTCast<DMASTSwitchCaseRange>(value.get())) {
+                std::optional<bool> aboveStart = CompareConstants(BinaryOperator::GreaterOrEqual,
+                    ExprCompiler_->TryEvaluateConstant(stmt->Value.get()),
+                    ExprCompiler_->TryEvaluateConstant(range->RangeStart.get()));
+                std::optional<bool> belowEnd = CompareConstants(BinaryOperator::LessOrEqual,
+                    ExprCompiler_->TryEvaluateConstant(stmt->Value.get()),
+                    ExprCompiler_->TryEvaluateConstant(range->RangeEnd.get()));
+                if (aboveStart.has_value() && belowEnd.has_value()) {
+                    matches = *aboveStart && *belowEnd;
+                }
+            } else {
+                matches = CompareConstants(BinaryOperator::Equal,
+                    ExprCompiler_->TryEvaluateConstant(stmt->Value.get()),
+                    ExprCompiler_->TryEvaluateConstant(value.get()));
+            }
+            
+            if (!matches.has_value()) {
+                return std::nullopt;
+            }
+            if (*matches) {
+                return switchCase.Body.get();
+            }
+        }
+    }
+    return defaultBody;
+}
+
+bool DMStatementCompiler::CompileDiscarded(const std::function<bool()>& compile) {
+    PooledBytecodeWriter scratch(Compiler_->GetObjectTree());
+    BytecodeWriter* writer = Writer_;
+    
+    // A goto here may make the placeholder a later label is marked with
+    scratch->ContinueLabelsFrom(*writer);
+    Writer_ = &*scratch;
+    ExprCompiler_->SetWriter(Writer_);
+    bool success = compile();
+    Writer_ = writer;
+    ExprCompiler_->SetWriter(writer);
+    writer->ContinueLabelsFrom(*scratch);
+    
+    return success;
+}
+
+// ===== Switch Dispatch =====
+
+std::optional<float> DMStatementCompiler::ConstantNumber(DMASTExpression* expr) {
+    if (Compiler_->GetSettings().NoOpts) {
+        return std::nullopt;
+    }
+    auto value = ExprCompiler_->TryEvaluateConstant(expr);
+    return AsNumber(value.get());
+}
+
+bool DMStatementCompiler::OrderSwitchTests(std::vector<SwitchCaseTest>& tests) {
+    // Stable, so tests of the same value stay in case order
+    std::stable_sort(tests.begin(), tests.end(),
+                     [](const SwitchCaseTest& a, const SwitchCaseTest& b) { return a.Low < b.Low; });
+    
+    std::vector<SwitchCaseTest> ordered;
+    ordered.reserve(tests.size());
+    for (const auto& test : tests) {
+        if (!ordered.empty() && test.Low <= ordered.back().High) {
+            SwitchCaseTest& last = ordered.back();
+            if (test.LabelId == last.LabelId) {
+                // Overlapping tests of one case become a single interval
+                last.High = std::max(last.High, test.High);
+                last.IsRange |= test.IsRange;
+                continue;
+            }
+            if (!test.IsRange && !last.IsRange) {
+                // An earlier case already takes this value
+                continue;
+            }
+            // Overlapping cases are decided by their order, not their values
+            return false;
+        }
+        ordered.push_back(test);
+    }
+    tests = std::move(ordered);
+    return true;
+}
+
+void DMStatementCompiler::EmitSwitchTest(const SwitchCaseTest& test) {
+    if (!test.IsRange) {
+        // SwitchOnFloat compares with the switch value in place
+        Writer_->EmitJumpWithFloat(DreamProcOpcode::SwitchOnFloat, test.Low, test.LabelId);
+        return;
+    }
+    Writer_->EmitFloat(DreamProcOpcode::PushFloat, test.Low);
+    Writer_->ResizeStack(1);
+    Writer_->EmitFloat(DreamProcOpcode::PushFloat, test.High);
+    Writer_->ResizeStack(1);
+    Writer_->EmitJump(DreamProcOpcode::SwitchCaseRange, test.LabelId);
+    Writer_->ResizeStack(-2);  // Pops both bounds, the switch value stays
+}
+
+void DMStatementCompiler::EmitSwitchSearch(const std::vector<SwitchCaseTest>& tests, size_t begin, size_t end,
+                                           const std::string& noMatchLabel) {
+    if (end - begin <= SwitchSearchLeafTests) {
+        for (size_t i = begin; i < end; ++i) {
+            EmitSwitchTest(tests[i]);
+        }
+        return;
+    }
+    
+    // Values within the span of the lower half are searched there, all others
+    // above it. The tests are disjoint and ordered, so the span ends at the
+    // High of the last test in the lower half.
+    size_t middle = begin + (end - begin) / 2;
+    std::string lowerLabel = NewLabel();
+    EmitSwitchTest({tests[begin].Low, tests[middle - 1].High, true, std::stoi(lowerLabel.substr(6))});
+    EmitSwitchSearch(tests, middle, end, noMatchLabel);
+    EmitJump(noMatchLabel);
+    EmitLabel(lowerLabel);
+    EmitSwitchSearch(tests, begin, middle, noMatchLabel);
+}
+
 // ===== Jump Emission =====
 
 void DMStatementCompiler::EmitJump(const std::string& label) {
@@ -265,13 +530,25 @@ bool DMStatementCompiler::CompileReturn(DMASTProcStatementReturn* stmt) {
         Writer_->ResizeStack(1);  // Pushes 1 value
     }
     
-    // Emit return instruction (pops return value, but we don't track after return)
+    // Emit return instruction (pops return value). Code after it is only
+    // reached by a jump, with the stack as it was before the value
     Writer_->Emit(DreamProcOpcode::Return);
+    Writer_->ResizeStack(-1);
     
     return true;
 }
 
 bool DMStatementCompiler::CompileIf(DMASTProcStatementIf* stmt) {
+    // A condition known at compile time only keeps the branch it selects
+    auto truth = ConstantCondition(stmt->Condition.get());
+    if (truth.has_value() && !MustCompile(*truth ? stmt->ElseBody.get() : stmt->Body.get())) {
+        auto discard = [&](DMASTProcBlockInner* body) {
+            return CompileDiscarded([&] { return CompileBlockInner(body); });
+        };
+        return *truth ? CompileBlockInner(stmt->Body.get()) && discard(stmt->ElseBody.get())
+                      : discard(stmt->Body.get()) && CompileBlockInner(stmt->ElseBody.get());
+    }
+    
     // Compile condition (pushes boolean result onto stack)
     if (!ExprCompiler_->CompileExpression(stmt->Condition.get())) {
         return false;
@@ -348,6 +625,16 @@ bool DMStatementCompiler::CompileWhile(DMASTProcStatementWhile* stmt) {
     //   Jump start_label
     // end_label:
     
+    // A loop that never runs is dropped, and one that always does skips the test
+    auto truth = ConstantCondition(stmt->Condition.get());
+    if (truth == false && !MustCompile(stmt->Body.get())) {
+        std::string endLabel = NewLabel();
+        PushLoopContext(endLabel, endLabel, endLabel);
+        bool success = CompileDiscarded([&] { return CompileBlockInner(stmt->Body.get()); });
+        PopLoopContext();
+        return success;
+    }
+    
     std::string startLabel = NewLabel();
     std::string endLabel = NewLabel();
     
@@ -356,15 +643,17 @@ bool DMStatementCompiler::CompileWhile(DMASTProcStatementWhile* stmt) {
     
     EmitLabel(startLabel);
     
-    // Compile condition
-    if (!ExprCompiler_->CompileExpression(stmt->Condition.get())) {
-        PopLoopContext();
-        return false;
+    if (truth != true) {
+        // Compile condition
+        if (!ExprCompiler_->CompileExpression(stmt->Condition.get())) {
+            PopLoopContext();
+            return false;
+        }
+        
+        EmitJumpIfFalse(endLabel);
+        Writer_->ResizeStack(-1);  // JumpIfFalse pops the condition value
     }
     
-    EmitJumpIfFalse(endLabel);
-    Writer_->ResizeStack(-1);  // JumpIfFalse pops the condition value
-    
     // Compile body
     if (!CompileBlockInner(stmt->Body.get())) {
         PopLoopContext();
@@ -408,16 +697,22 @@ bool DMStatementCompiler::CompileDoWhile(DMASTProcStatementDoWhile* stmt) {
     
     EmitLabel(continueLabel);
     
-    // Compile condition
-    if (!ExprCompiler_->CompileExpression(stmt->Condition.get())) {
-        PopLoopContext();
-        return false;
+    // A condition known at compile time either always loops or never does
+    auto truth = ConstantCondition(stmt->Condition.get());
+    if (truth == true) {
+        EmitJump(startLabel);
+    } else if (!truth.has_value()) {
+        // Compile condition
+        if (!ExprCompiler_->CompileExpression(stmt->Condition.get())) {
+            PopLoopContext();
+            return false;
+        }
+        
+        EmitJumpIfTrue(startLabel);
+        // Note: EmitJumpIfTrue internally pops the condition value
+        Writer_->ResizeStack(-1);  // Account for the pop in EmitJumpIfTrue
     }
     
-    EmitJumpIfTrue(startLabel);
-    // Note: EmitJumpIfTrue internally pops the condition value
-    Writer_->ResizeStack(-1);  // Account for the pop in EmitJumpIfTrue
-    
     EmitLabel(endLabel);
     
     PopLoopContext();
@@ -439,6 +734,9 @@ bool DMStatementCompiler::CompileFor(DMASTProcStatementFor* stmt) {
     //   Jump start_label
     // end_label:
     
+    // A variable declared by the initializer is only visible in the loop
+    LocalScope scope(Proc_);
+    
     // Compile initializer
     if (stmt->Initializer) {
         if (!CompileStatement(stmt->Initializer.get())) {
@@ -508,6 +806,9 @@ bool DMStatementCompiler::CompileForRange(DMASTProcStatementForRange* stmt) {
     // The initializer should be an assignment like var/x = start or just x = start
     // We need to extract the variable to generate comparison and increment
     
+    // A variable declared by the initializer is only visible in the loop
+    LocalScope scope(Proc_);
+    
     // Compile the initializer expression (which should be a var declaration with assignment)
     if (stmt->Initializer) {
         if (!ExprCompiler_->CompileExpression(stmt->Initializer.get())) {
@@ -531,7 +832,7 @@ bool DMStatementCompiler::CompileForRange(DMASTProcStatementForRange* stmt) {
     // The initializer should be DMASTAssign
     DMASTExpression* varExpr = nullptr;
     
-    if (auto* assign = dynamic_cast<DMASTAssign*>(stmt->Initializer.get())) {
+    if (auto* assign = DMASTCast<DMASTAssign>(stmt->Initializer.get())) {
         varExpr = assign->LValue.get();
     }
     
@@ -653,10 +954,13 @@ bool DMStatementCompiler::CompileForIn(DMASTProcStatementForIn* stmt) {
     // 6. Jump to start
     // 7. End loop and destroy enumerator
     
+    // The loop variable is only visible in the loop
+    LocalScope scope(Proc_);
+    
     int enumeratorId = Proc_->GetNextEnumeratorId();
     
     // Check for range expression (start to end)
-    auto* binOp = dynamic_cast<DMASTExpressionBinary*>(stmt->List.get());
+    auto* binOp = DMASTCast<DMASTExpressionBinary>(stmt->List.get());
     if (binOp && binOp->Operator == BinaryOperator::To) {
         // Range loop: for(x in 1 to 10)
         if (!ExprCompiler_->CompileExpression(binOp->Left.get())) return false;
@@ -764,7 +1068,7 @@ bool DMStatementCompiler::CompileForIn(DMASTProcStatementForIn* stmt) {
         refCreated = true;
     }
     // Fallback: Handle legacy cases where VarDecl is not populated
-    else if (auto* pathExpr = dynamic_cast<DMASTConstantPath*>(stmt->Variable.get())) {
+    else if (auto* pathExpr = DMASTCast<DMASTConstantPath>(stmt->Variable.get())) {
         // Extract the variable name from the path (last element)
         std::string varName = pathExpr->Path.Path.GetLastElement();
         if (varName.empty()) {
@@ -793,7 +1097,7 @@ bool DMStatementCompiler::CompileForIn(DMASTProcStatementForIn* stmt) {
         outputRef = DMReference::CreateLocal(localVar->Id);
         refCreated = true;
     }
-    else if (auto* varIdent = dynamic_cast<DMASTIdentifier*>(stmt->Variable.get())) {
+    else if (auto* varIdent = DMASTCast<DMASTIdentifier>(stmt->Variable.get())) {
         // Simple identifier - check if it exists
         std::string varName = varIdent->Identifier;
         LocalVariable* localVar = Proc_->GetLocalVariable(varName);
@@ -814,15 +1118,15 @@ bool DMStatementCompiler::CompileForIn(DMASTProcStatementForIn* stmt) {
         outputRef = DMReference::CreateLocal(localVar->Id);
         refCreated = true;
     }
-    else if (auto* deref = dynamic_cast<DMASTDereference*>(stmt->Variable.get())) {
+    else if (auto* deref = DMASTCast<DMASTDereference>(stmt->Variable.get())) {
         // Field access (e.g., obj.field)
         // For now, we only support simple field access on identifiers
         // More complex cases (nested derefs, array indexing) are not yet supported
         
         // Check if the base is an identifier
-        if (auto* baseIdent = dynamic_cast<DMASTIdentifier*>(deref->Expression.get())) {
+        if (auto* baseIdent = DMASTCast<DMASTIdentifier>(deref->Expression.get())) {
             // Check if the property is an identifier
-            auto* propIdent = dynamic_cast<DMASTIdentifier*>(deref->Property.get());
+            auto* propIdent = DMASTCast<DMASTIdentifier>(deref->Property.get());
             if (!propIdent) {
                 Compiler_->ForcedError(stmt->Location_, "Field name in for-in loop must be an identifier");
                 PopLoopContext();
@@ -917,6 +1221,52 @@ bool DMStatementCompiler::CompileForIn(DMASTProcStatementForIn* stmt) {
 }
 
 bool DMStatementCompiler::CompileSwitch(DMASTProcStatementSwitch* stmt) {
+    // A constant switch value only keeps the case it selects
+    if (auto target = ConstantSwitchTarget(stmt)) {
+        bool keepCases = false;
+        for (auto& switchCase : stmt->Cases) {
+            keepCases |= switchCase.Body.get() != *target && MustCompile(switchCase.Body.get());
+        }
+        if (!keepCases) {
+            std::string endLabel = NewLabel();
+            PushLoopContext("", endLabel, "", true);
+            
+            // The rest is still checked, in the order a runtime switch compiles it:
+            // case values, the default case, then the value cases
+            bool success = CompileDiscarded([&] {
+                for (auto& switchCase : stmt->Cases) {
+                    for (auto& value : switchCase.Values) {
+                        auto* range = DMASTCast<DMASTSwitchCaseRange>(value.get());
+                        bool compiled = range ? ExprCompiler_->CompileExpression(range->RangeStart.get()) &&
+                                                    ExprCompiler_->CompileExpression(range->RangeEnd.get())
+                                              : ExprCompiler_->CompileExpression(value.get());
+                        if (!compiled) {
+                            return false;
+                        }
+                    }
+                }
+                return true;
+            });
+            std::vector<DMASTProcBlockInner*> bodies = { nullptr };
+            for (auto& switchCase : stmt->Cases) {
+                if (switchCase.Values.empty()) {
+                    bodies[0] = switchCase.Body.get();
+                } else {
+                    bodies.push_back(switchCase.Body.get());
+                }
+            }
+            for (size_t i = 0; success && i < bodies.size(); i++) {
+                DMASTProcBlockInner* body = bodies[i];
+                success = body == *target ? CompileBlockInner(body)
+                                          : CompileDiscarded([&] { return CompileBlockInner(body); });
+            }
+            
+            EmitLabel(endLabel);
+            PopLoopContext();
+            return success;
+        }
+    }
+    
     // Compile the switch value expression (leaves value on stack)
     if (!ExprCompiler_->CompileExpression(stmt->Value.get())) {
         return false;
@@ -936,19 +1286,63 @@ bool DMStatementCompiler::CompileSwitch(DMASTProcStatementSwitch* stmt) {
     std::vector<CaseInfo> valueCases;
     DMASTProcBlockInner* defaultCaseBody = nullptr;
     
-    // Process each case
+    // Give each value case a label, and collect its tests if they are all numbers
+    bool numericCases = !Compiler_->GetSettings().NoOpts;
+    bool hasRange = false;
+    std::vector<SwitchCaseTest> tests;
     for (auto& switchCase : stmt->Cases) {
         if (switchCase.Values.empty()) {
             // Empty values = default case
             defaultCaseBody = switchCase.Body.get();
-        } else {
-            // Value case - create a label for it
-            std::string caseLabel = NewLabel();
+            continue;
+        }
+        
+        std::string caseLabel = NewLabel();
+        int caseLabelId = std::stoi(caseLabel.substr(6));
+        for (auto& value : switchCase.Values) {
+            if (!numericCases) {
+                break;
+            }
+            if (auto* rangeExpr = DMASTCast<DMASTSwitchCaseRange>(value.get())) {
+                auto low = ConstantNumber(rangeExpr->RangeStart.get());
+                auto high = ConstantNumber(rangeExpr->RangeEnd.get());
+                numericCases = low.has_value() && high.has_value();
+                // A range ending below its start never matches
+                if (numericCases && *low <= *high) {
+                    tests.push_back({*low, *high, true, caseLabelId});
+                }
+                hasRange = true;
+            } else {
+                auto number = ConstantNumber(value.get());
+                numericCases = number.has_value();
+                if (numericCases) {
+                    tests.push_back({*number, *number, false, caseLabelId});
+                }
+            }
+        }
+        valueCases.push_back({caseLabel, switchCase.Body.get()});
+    }
+    
+    // A binary search compares the value with < and >, which the runtime only
+    // allows for numbers. Without a range case, a switch on a string would
+    // never reach such a comparison, so those keep the linear chain.
+    ProcTemperature temperature = Proc_ ? Proc_->Temperature : ProcTemperature::Warm;
+    if (numericCases && hasRange && tests.size() >= SwitchSearchMinTestsFor(temperature) && OrderSwitchTests(tests)) {
+        std::string noMatchLabel = NewLabel();
+        EmitSwitchSearch(tests, 0, tests.size(), noMatchLabel);
+        EmitLabel(noMatchLabel);
+    } else {
+        size_t caseIndex = 0;
+        for (auto& switchCase : stmt->Cases) {
+            if (switchCase.Values.empty()) {
+                continue;
+            }
+            int caseLabelId = std::stoi(valueCases[caseIndex++].label.substr(6));
             
             // Emit SwitchCase opcode for each value
             for (auto& value : switchCase.Values) {
                 // Check if this is a range expression
-                if (auto* rangeExpr = dynamic_cast<DMASTSwitchCaseRange*>(value.get())) {
+                if (auto* rangeExpr = DMASTCast<DMASTSwitchCaseRange>(value.get())) {
                     // Handle range: case 1 to 10
                     // Compile the lower bound
                     if (!ExprCompiler_->CompileExpression(rangeExpr->RangeStart.get())) {
@@ -965,26 +1359,34 @@ bool DMStatementCompiler::CompileSwitch(DMASTProcStatementSwitch* stmt) {
                     // Emit SwitchCaseRange opcode with the case label
                     // SwitchCaseRange pops 3 values (switch value, lower bound, upper bound)
                     // and pushes switch value back if no match
-                    int caseLabelId = std::stoi(caseLabel.substr(6));
                     Writer_->EmitJump(DreamProcOpcode::SwitchCaseRange, caseLabelId);
                     Writer_->ResizeStack(-2);  // Net -2 (pops lower and upper bounds, switch value stays)
-                } else {
-                    // Handle simple value: case 5
-                    // Compile the constant value
-                    if (!ExprCompiler_->CompileExpression(value.get())) {
-                        PopLoopContext();
-                        return false;
-                    }
-                    
-                    // Emit SwitchCase opcode with the case label
-                    // SwitchCase pops 2 values (switch value, case value), pushes switch value back if no match
-                    int caseLabelId = std::stoi(caseLabel.substr(6));
-                    Writer_->EmitJump(DreamProcOpcode::SwitchCase, caseLabelId);
-                    Writer_->ResizeStack(-1);  // Net -1 (pops case value, switch value stays)
+                    continue;
                 }
+                
+                // A constant is tested in place, without pushing it first
+                auto constant = Compiler_->GetSettings().NoOpts ? nullptr : ExprCompiler_->TryEvaluateConstant(value.get());
+                if (auto* constString = DMASTCast<DMASTConstantString>(constant.get())) {
+                    Writer_->EmitJumpWithString(DreamProcOpcode::SwitchOnString, constString->Value, caseLabelId);
+                    continue;
+                }
+                if (auto number = AsNumber(constant.get())) {
+                    Writer_->EmitJumpWithFloat(DreamProcOpcode::SwitchOnFloat, *number, caseLabelId);
+                    continue;
+                }
+                
+                // Handle simple value: case 5
+                // Compile the constant value
+                if (!ExprCompiler_->CompileExpression(value.get())) {
+                    PopLoopContext();
+                    return false;
+                }
+                
+                // Emit SwitchCase opcode with the case label
+                // SwitchCase pops 2 values (switch value, case value), pushes switch value back if no match
+                Writer_->EmitJump(DreamProcOpcode::SwitchCase, caseLabelId);
+                Writer_->ResizeStack(-1);  // Net -1 (pops case value, switch value stays)
             }
-            
-            valueCases.push_back({caseLabel, switchCase.Body.get()});
         }
     }
     
@@ -1048,6 +1450,20 @@ bool DMStatementCompiler::CompileVarDeclaration(DMASTProcStatementVarDeclaration
         
         // Check if the variable already exists
         LocalVariable* var = Proc_->GetLocalVariable(varName);
+        
+        // var/const/x = <constant> needs no storage; reads compile to the value
+        if (!var && decl.Value && effectiveTypePath) {
+            VarModifiers mods = VarModifiers::Parse(*effectiveTypePath);
+            if (mods.IsConst && !mods.IsGlobal) {
+                auto value = ExprCompiler_->TryEvaluateConstant(decl.Value.get());
+                if (auto constant = DMExpressionCompiler::ExpressionToConstant(value.get())) {
+                    Proc_->AddLocalConst(varName, mods.TypePath, std::move(*constant));
+                    continue;
+                }
+            }
+        }
+        
+        bool declared = !var;
         if (var) {
             // Variable already exists - check if we need to update type info
             // In DM, redeclaring a variable is allowed and often used to refine the type
@@ -1093,6 +1509,11 @@ bool DMStatementCompiler::CompileVarDeclaration(DMASTProcStatementVarDeclaration
             
             // Assign pops value, assigns to reference, pushes assigned value (net 0)
             // But since this is a statement, we don't care about the result
+            Writer_->Emit(DreamProcOpcode::Pop);
+            Writer_->ResizeStack(-1);
+        } else if (declared && Proc_->NeedsNullStore(var)) {
+            // The slot still holds whatever the local before it left there
+            Writer_->EmitNullStore(var->Id);
         }
     }
     
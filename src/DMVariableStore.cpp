@@ -0,0 +1,100 @@
+#include "DMVariableStore.h"
+#include "DMASTExpression.h"
+#include "DMObjectTree.h"
+#include "SortedEntries.h"
+#include <cstring>
+
+namespace DMCompiler {
+
+namespace {
+
+// Equal values, and only equal values, get the same key. Strings and objects
+// are pooled, so their IDs stand for them and every key fits in a std::string
+// without allocating.
+std::string ValueKey(const JsonValue& value) {
+    std::string key(1, static_cast<char>('0' + value.index()));
+    std::visit([&key](auto&& arg) {
+        using T = std::decay_t<decltype(arg)>;
+        if constexpr (std::is_same_v<T, bool>) {
+            key += arg ? '1' : '0';
+        } else if constexpr (std::is_same_v<T, int64_t> || std::is_same_v<T, double>) {
+            char bytes[sizeof(T)];
+            std::memcpy(bytes, &arg, sizeof(T));
+            key.append(bytes, sizeof(T));
+        } else if constexpr (std::is_same_v<T, JsonString> || std::is_same_v<T, JsonObject> ||
+                             std::is_same_v<T, ResourceRef>) {
+            uint32_t id;
+            if constexpr (std::is_same_v<T, ResourceRef>) {
+                id = static_cast<uint32_t>(arg.id);
+            } else {
+                id = arg.Id;
+            }
+            char bytes[sizeof(id)];
+            std::memcpy(bytes, &id, sizeof(id));
+            key.append(bytes, sizeof(id));
+        }
+    }, value);
+    return key;
+}
+
+JsonValue DefaultValue(DMCompiler* compiler, JsonConstants& constants, const DMVariable& var) {
+    JsonValue value = nullptr;
+    if (var.Value != nullptr && !var.Value->TryAsJsonRepresentation(compiler, constants, value)) {
+        value = nullptr;
+    }
+    return value;
+}
+
+} // namespace
+
+void DMVariableStore::Build(DMCompiler* compiler, JsonConstants& constants, const DMObjectTree& objectTree) {
+    Names_.clear();
+    NameIds_.clear();
+    Values_.clear();
+    ValueIds_.clear();
+    Defaults_.clear();
+    TypeStarts_.clear();
+    TypeStarts_.reserve(objectTree.AllObjects.size() + 1);
+
+    for (const DMObject* obj : objectTree.GetAllObjects()) {
+        TypeStarts_.push_back(static_cast<uint32_t>(Defaults_.size()));
+        for (const auto* entry : SortedEntries(obj->Variables)) {
+            Defaults_.push_back({InternName(entry->first), PoolValue(DefaultValue(compiler, constants, entry->second))});
+        }
+        for (const auto* entry : SortedEntries(obj->VariableOverrides)) {
+            if (obj->Variables.find(entry->first) != obj->Variables.end()) {
+                continue;
+            }
+            Defaults_.push_back({InternName(entry->first), PoolValue(DefaultValue(compiler, constants, entry->second))});
+        }
+    }
+    TypeStarts_.push_back(static_cast<uint32_t>(Defaults_.size()));
+}
+
+DMVariableStore::TypeDefaults DMVariableStore::GetDefaults(int typeId) const {
+    if (typeId < 0 || static_cast<size_t>(typeId) + 1 >= TypeStarts_.size()) {
+        return {nullptr, nullptr};
+    }
+    return {Defaults_.data() + TypeStarts_[typeId], Defaults_.data() + TypeStarts_[typeId + 1]};
+}
+
+uint32_t DMVariableStore::InternName(const std::string& name) {
+    auto it = NameIds_.find(name);
+    if (it != NameIds_.end()) {
+        return it->second;
+    }
+    uint32_t id = static_cast<uint32_t>(Names_.size());
+    Names_.push_back(name);
+    NameIds_.emplace(Names_.back(), id);
+    return id;
+}
+
+uint32_t DMVariableStore::PoolValue(JsonValue value) {
+    auto [it, inserted] = ValueIds_.emplace(ValueKey(value), static_cast<uint32_t>(Values_.size()));
+    if (inserted) {
+        Values_.push_back(std::move(value));
+    }
+    return it->second;
+}
+
+} // namespace DMCompiler
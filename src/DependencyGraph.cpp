@@ -0,0 +1,86 @@
+#include "DependencyGraph.h"
+#include "DreamPath.h"
+#include "JsonWriter.h"
+#include "Location.h"
+#include "TokenSerialization.h"
+
+namespace DMCompiler {
+
+DependencyGraph::File* DependencyGraph::At(const Location& location) {
+    if (location.FileId == SourceFileRegistry::UnknownFileId || location.IsInternal()) {
+        return nullptr;
+    }
+    return &Files[location.SourceFile()];
+}
+
+void DependencyGraph::AddType(const Location& location, const DreamPath& type) {
+    if (File* file = At(location)) {
+        file->Types.insert(type.ToString());
+    }
+}
+
+void DependencyGraph::AddProc(const Location& location, const DreamPath& owner, const std::string& name, bool isVerb) {
+    if (File* file = At(location)) {
+        std::string ownerPath = owner.ToString();
+        if (ownerPath == "/") {
+            ownerPath.clear();
+        }
+        file->Procs.insert(ownerPath + (isVerb ? "/verb/" : "/proc/") + name);
+    }
+}
+
+bool DependencyGraph::WriteJson(const std::string& path) const {
+    JsonWriter json;
+    auto writeNames = [&json](const std::string& key, const std::set<std::string>& names) {
+        json.WriteKey(key);
+        json.BeginArray();
+        for (const auto& name : names) {
+            json.WriteString(name);
+        }
+        json.EndArray();
+    };
+
+    json.BeginObject();
+    json.WriteKey("Files");
+    json.BeginObject();
+    for (const auto& [filePath, file] : Files) {
+        json.WriteKey(filePath);
+        json.BeginObject();
+        writeNames("Includes", file.Includes);
+        writeNames("MacrosDefined", file.MacrosDefined);
+        writeNames("MacrosUsed", file.MacrosUsed);
+        writeNames("Types", file.Types);
+        writeNames("Procs", file.Procs);
+        json.EndObject();
+    }
+    json.EndObject();
+
+    // The reverse of the above: what a changed macro reaches
+    struct MacroFiles {
+        std::set<std::string> DefinedIn;
+        std::set<std::string> UsedIn;
+    };
+    std::map<std::string, MacroFiles> macros;
+    for (const auto& [filePath, file] : Files) {
+        for (const auto& macro : file.MacrosDefined) {
+            macros[macro].DefinedIn.insert(filePath);
+        }
+        for (const auto& macro : file.MacrosUsed) {
+            macros[macro].UsedIn.insert(filePath);
+        }
+    }
+    json.WriteKey("Macros");
+    json.BeginObject();
+    for (const auto& [name, files] : macros) {
+        json.WriteKey(name);
+        json.BeginObject();
+        writeNames("DefinedIn", files.DefinedIn);
+        writeNames("UsedIn", files.UsedIn);
+        json.EndObject();
+    }
+    json.EndObject();
+    json.EndObject();
+    return WriteBinaryFileAtomic(path, json.ToString());
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,159 @@
+#include "DisasmServer.h"
+#include "LocalSocket.h"
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+json ProcJson(const DisasmProc& proc) {
+    return {
+        {"Id", proc.Id},
+        {"Name", proc.Name},
+        {"Owner", proc.OwnerPath},
+        {"OwnerTypeId", proc.OwnerTypeId},
+        {"Parameters", proc.Parameters},
+        {"IsVerb", proc.IsVerb},
+        {"MaxStackSize", proc.MaxStackSize},
+        {"BytecodeSize", proc.Bytecode.size()},
+    };
+}
+
+} // namespace
+
+DisasmServer::DisasmServer(std::string path)
+    : Path_(std::move(path))
+{
+}
+
+bool DisasmServer::Load() {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return ReloadIfChanged(true);
+}
+
+bool DisasmServer::ReloadIfChanged(bool force) {
+    std::error_code timeError;
+    std::error_code sizeError;
+    auto time = fs::last_write_time(Path_, timeError);
+    auto size = fs::file_size(Path_, sizeError);
+    if (timeError || sizeError) {
+        // Missing while a compile replaces it; the last one still answers
+        return !force;
+    }
+    if (!force && Disassembler_ && time == LoadedTime_ && size == LoadedSize_) {
+        return true;
+    }
+
+    // Recorded even if the load fails, so a broken file is tried once per change
+    LoadedTime_ = time;
+    LoadedSize_ = size;
+    auto disassembler = std::make_unique<DMDisassembler>();
+    if (!disassembler->Load(Path_)) {
+        return false;
+    }
+    Disassembler_ = std::move(disassembler);
+    return true;
+}
+
+std::string DisasmServer::Handle(const std::string& request) {
+    json reply = {{"id", nullptr}};
+    json message = json::parse(request, nullptr, false);
+    if (message.is_discarded() || !message.is_object()) {
+        reply["error"] = "Request is not a JSON object";
+        return reply.dump();
+    }
+    if (message.contains("id")) {
+        reply["id"] = message["id"];
+    }
+
+    try {
+        std::string method = message.value("method", "");
+        json params = message.value("params", json::object());
+
+        std::lock_guard<std::mutex> lock(Mutex_);
+        bool loaded = ReloadIfChanged(method == "Reload");
+        if (!Disassembler_) {
+            reply["error"] = "Failed to load compiled file: " + Path_;
+            return reply.dump();
+        }
+        const DMDisassembler& disassembler = *Disassembler_;
+
+        if (method == "Search") {
+            reply["result"] = disassembler.Search(params.at("query").get<std::string>());
+        } else if (method == "SearchStrings") {
+            json strings = json::array();
+            for (size_t index : disassembler.SearchStrings(params.at("query").get<std::string>())) {
+                json procs = json::array();
+                for (const DisasmProc* proc : disassembler.GetProcsReferencingString(index)) {
+                    procs.push_back(proc->Id);
+                }
+                strings.push_back({{"Index", index}, {"Text", disassembler.GetString(index)}, {"Procs", procs}});
+            }
+            reply["result"] = strings;
+        } else if (method == "GetType") {
+            std::string path = params.at("path").get<std::string>();
+            const DisasmType* type = disassembler.GetType(path);
+            if (!type) {
+                reply["error"] = "Type not found: " + path;
+            } else {
+                reply["result"] = {
+                    {"Id", type->Id},
+                    {"Path", type->Path},
+                    {"ParentId", type->ParentId},
+                    {"Variables", type->Variables},
+                    {"Procs", type->ProcIds},
+                };
+            }
+        } else if (method == "GetProc" || method == "DecompileProc") {
+            int procId = params.at("id").get<int>();
+            const DisasmProc* proc = disassembler.GetProc(procId);
+            if (!proc) {
+                reply["error"] = "Proc not found: " + std::to_string(procId);
+            } else if (method == "GetProc") {
+                reply["result"] = ProcJson(*proc);
+            } else {
+                reply["result"] = disassembler.DecompileProc(procId);
+            }
+        } else if (method == "Stats") {
+            auto stats = disassembler.GetStats();
+            reply["result"] = {
+                {"File", Path_},
+                {"Types", stats.TypeCount},
+                {"Procs", stats.ProcCount},
+                {"Strings", stats.StringCount},
+                {"BytecodeSize", stats.TotalBytecodeSize},
+            };
+        } else if (method == "Reload") {
+            if (loaded) {
+                reply["result"] = true;
+            } else {
+                reply["error"] = "Failed to load compiled file, keeping the last one: " + Path_;
+            }
+        } else {
+            reply["error"] = "Unknown method: " + method;
+        }
+    } catch (const json::exception& e) {
+        reply["error"] = std::string("Bad request: ") + e.what();
+    }
+    return reply.dump();
+}
+
+void DisasmServer::Serve(std::istream& in, std::ostream& out) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line == "\r") {
+            continue;
+        }
+        out << Handle(line) << std::endl;
+    }
+}
+
+bool DisasmServer::Listen(const std::string& socketPath) {
+    return LocalSocket::Serve(socketPath, [this](const std::string& request) { return Handle(request); });
+}
+
+} // namespace DMCompiler
@@ -1,9 +1,65 @@
 #include "DreamPath.h"
-#include <sstream>
-#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace DMCompiler {
 
+struct DreamPath::Node {
+    const Node* Parent;                 // Null for the root node
+    std::vector<std::string> Elements;  // Parent's elements, then this node's
+    std::string Joined;                 // Elements separated by /
+    std::unordered_map<std::string, const Node*> Children;  // Guarded by the trie's mutex
+};
+
+struct DreamPath::Trie {
+    std::shared_mutex Mutex;
+    std::deque<Node> Nodes;  // A deque never moves what it holds
+
+    Trie() {
+        Nodes.push_back({nullptr, {}, {}, {}});
+    }
+};
+
+DreamPath::Trie& DreamPath::GetTrie() {
+    static Trie trie;
+    return trie;
+}
+
+const DreamPath::Node* DreamPath::RootNode() {
+    return &GetTrie().Nodes.front();
+}
+
+const DreamPath::Node* DreamPath::Child(const Node* parent, const std::string& element) {
+    Trie& trie = GetTrie();
+    {
+        std::shared_lock lock(trie.Mutex);
+        auto it = parent->Children.find(element);
+        if (it != parent->Children.end()) {
+            return it->second;
+        }
+    }
+
+    std::unique_lock lock(trie.Mutex);
+    // Only the mutex keeps Children from changing, so nodes are handed out const
+    auto& children = const_cast<Node*>(parent)->Children;
+    auto it = children.find(element);
+    if (it != children.end()) {
+        return it->second;
+    }
+    Node node{parent, parent->Elements, parent->Joined, {}};
+    node.Elements.push_back(element);
+    if (parent->Parent != nullptr) {
+        node.Joined += '/';
+    }
+    node.Joined += element;
+    trie.Nodes.push_back(std::move(node));
+    const Node* child = &trie.Nodes.back();
+    children.emplace(element, child);
+    return child;
+}
+
 // Static paths
 DreamPath DreamPath::Root = DreamPath("/");
 DreamPath DreamPath::Datum = DreamPath("/datum");
@@ -17,17 +73,27 @@ DreamPath DreamPath::List = DreamPath("/list");
 
 DreamPath::DreamPath()
     : Type_(PathType::Absolute)
+    , Node_(RootNode())
 {
 }
 
-DreamPath::DreamPath(const std::string& pathString) {
+DreamPath::DreamPath(const std::string& pathString)
+    : Node_(RootNode())
+{
     ParseFromString(pathString);
 }
 
 DreamPath::DreamPath(PathType type, const std::vector<std::string>& elements)
     : Type_(type)
-    , Elements_(elements)
+    , Node_(RootNode())
 {
+    for (const auto& element : elements) {
+        Node_ = Child(Node_, element);
+    }
+}
+
+const std::vector<std::string>& DreamPath::GetElements() const {
+    return Node_->Elements;
 }
 
 void DreamPath::ParseFromString(const std::string& pathString) {
@@ -53,7 +119,7 @@ void DreamPath::ParseFromString(const std::string& pathString) {
     for (size_t i = (Type_ == PathType::Absolute ? 1 : 0); i < pathString.size(); ++i) {
         if (pathString[i] == '/') {
             if (!current.empty()) {
-                Elements_.push_back(current);
+                Node_ = Child(Node_, current);
                 current.clear();
             }
         } else {
@@ -62,33 +128,24 @@ void DreamPath::ParseFromString(const std::string& pathString) {
     }
     
     if (!current.empty()) {
-        Elements_.push_back(current);
+        Node_ = Child(Node_, current);
     }
 }
 
 std::string DreamPath::ToString() const {
-    std::ostringstream oss;
-    
+    std::string result;
     switch (Type_) {
         case PathType::Absolute:
-            oss << "/";
+            result = "/";
             break;
         case PathType::Relative:
-            oss << ".";
+            result = ".";
             break;
         case PathType::UpwardSearch:
-            oss << "..";
+            result = "..";
             break;
     }
-    
-    for (size_t i = 0; i < Elements_.size(); ++i) {
-        if (i > 0) {
-            oss << "/";
-        }
-        oss << Elements_[i];
-    }
-    
-    return oss.str();
+    return result + Node_->Joined;
 }
 
 DreamPath DreamPath::Combine(const DreamPath& other) const {
@@ -96,32 +153,29 @@ DreamPath DreamPath::Combine(const DreamPath& other) const {
         return other;
     }
     
-    std::vector<std::string> newElements = Elements_;
-    newElements.insert(newElements.end(), other.Elements_.begin(), other.Elements_.end());
-    
-    return DreamPath(Type_, newElements);
+    const Node* node = Node_;
+    for (const auto& element : other.Node_->Elements) {
+        node = Child(node, element);
+    }
+    return FromNode(Type_, node);
 }
 
 DreamPath DreamPath::AddToPath(const std::string& element) const {
-    std::vector<std::string> newElements = Elements_;
-    newElements.push_back(element);
-    return DreamPath(Type_, newElements);
+    return FromNode(Type_, Child(Node_, element));
 }
 
 DreamPath DreamPath::RemoveLastElement() const {
-    if (Elements_.empty()) {
+    if (Node_->Parent == nullptr) {
         return *this;
     }
-    
-    std::vector<std::string> newElements(Elements_.begin(), Elements_.end() - 1);
-    return DreamPath(Type_, newElements);
+    return FromNode(Type_, Node_->Parent);
 }
 
 std::string DreamPath::GetLastElement() const {
-    if (Elements_.empty()) {
+    if (Node_->Elements.empty()) {
         return "";
     }
-    return Elements_.back();
+    return Node_->Elements.back();
 }
 
 bool DreamPath::IsDescendantOf(const DreamPath& ancestor) const {
@@ -129,21 +183,17 @@ bool DreamPath::IsDescendantOf(const DreamPath& ancestor) const {
         return false;
     }
     
-    if (ancestor.Elements_.size() > Elements_.size()) {
+    size_t depth = Node_->Elements.size();
+    size_t ancestorDepth = ancestor.Node_->Elements.size();
+    if (ancestorDepth > depth) {
         return false;
     }
     
-    for (size_t i = 0; i < ancestor.Elements_.size(); ++i) {
-        if (ancestor.Elements_[i] != Elements_[i]) {
-            return false;
-        }
+    const Node* node = Node_;
+    for (; depth > ancestorDepth; --depth) {
+        node = node->Parent;
     }
-    
-    return true;
-}
-
-bool DreamPath::operator==(const DreamPath& other) const {
-    return Type_ == other.Type_ && Elements_ == other.Elements_;
+    return node == ancestor.Node_;
 }
 
 } // namespace DMCompiler
@@ -1,79 +1,131 @@
 #include "JsonWriter.h"
-#include <iomanip>
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <limits>
 
 namespace DMCompiler {
 
+namespace {
+
+// How each byte is written inside a JSON string: 0 as itself, 1 as \u00XX,
+// anything else as a backslash and that character
+constexpr std::array<char, 256> EscapeTable = [] {
+    std::array<char, 256> table{};
+    for (int c = 0; c < 32; ++c) {
+        table[c] = 1;
+    }
+    // Bytes past 127 were escaped wherever char is signed, as they compared below 32
+    if (std::numeric_limits<char>::is_signed) {
+        for (int c = 128; c < 256; ++c) {
+            table[c] = 1;
+        }
+    }
+    table['"'] = '"';
+    table['\\'] = '\\';
+    table['\b'] = 'b';
+    table['\f'] = 'f';
+    table['\n'] = 'n';
+    table['\r'] = 'r';
+    table['\t'] = 't';
+    return table;
+}();
+
+template <typename T>
+void AppendNumber(std::string& buffer, T value) {
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+} // namespace
+
 void JsonWriter::BeginObject() {
     WriteComma();
-    ss_ << "{\n";
+    buffer_ += "{\n";
     indent_++;
     needsComma_ = false;
 }
 
 void JsonWriter::EndObject() {
-    ss_ << "\n";
+    buffer_ += '\n';
     indent_--;
     WriteIndent();
-    ss_ << "}";
+    buffer_ += '}';
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::BeginArray() {
     WriteComma();
-    ss_ << "[\n";
+    buffer_ += "[\n";
     indent_++;
     needsComma_ = false;
 }
 
 void JsonWriter::EndArray() {
-    ss_ << "\n";
+    buffer_ += '\n';
     indent_--;
     WriteIndent();
-    ss_ << "]";
+    buffer_ += ']';
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteKey(const std::string& key) {
     WriteComma();
     WriteIndent();
-    ss_ << "\"" << EscapeString(key) << "\": ";
+    buffer_ += '"';
+    WriteEscaped(key);
+    buffer_ += "\": ";
     needsComma_ = false;
 }
 
 void JsonWriter::WriteString(const std::string& value) {
     WriteComma();
-    ss_ << "\"" << EscapeString(value) << "\"";
+    buffer_ += '"';
+    WriteEscaped(value);
+    buffer_ += '"';
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteInt(int value) {
     WriteComma();
-    ss_ << value;
+    AppendNumber(buffer_, value);
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteBool(bool value) {
     WriteComma();
-    ss_ << (value ? "true" : "false");
+    buffer_ += value ? "true" : "false";
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteNull() {
     WriteComma();
-    ss_ << "null";
+    buffer_ += "null";
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteInt64(int64_t value) {
     WriteComma();
-    ss_ << value;
+    AppendNumber(buffer_, value);
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteDouble(double value) {
     WriteComma();
-    ss_ << std::fixed << std::setprecision(6) << value;
+    // Six decimals, as the stream's std::fixed with precision 6 wrote them
+    char digits[std::numeric_limits<double>::max_exponent10 + 32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 6);
+    buffer_.append(digits, result.ptr);
     needsComma_ = true;
+    FlushIfFull();
 }
 
 void JsonWriter::WriteValue(const JsonValue& value) {
@@ -87,12 +139,12 @@ void JsonWriter::WriteValue(const JsonValue& value) {
             WriteInt64(arg);
         } else if constexpr (std::is_same_v<T, double>) {
             WriteDouble(arg);
-        } else if constexpr (std::is_same_v<T, std::string>) {
-            WriteString(arg);
-        } else if constexpr (std::is_same_v<T, std::unordered_map<std::string, std::string>>) {
-            // Handle special map case (e.g., {"type": "float_infinity"})
+        } else if constexpr (std::is_same_v<T, JsonString>) {
+            WriteString(*arg.Text);
+        } else if constexpr (std::is_same_v<T, JsonObject>) {
+            // Handle special object case (e.g., {"type": "PositiveInfinity"})
             BeginObject();
-            for (const auto& [key, val] : arg) {
+            for (const auto& [key, val] : *arg.Entries) {
                 WriteKeyValue(key, val);
             }
             EndObject();
@@ -123,54 +175,86 @@ void JsonWriter::WriteKeyValue(const std::string& key, bool value) {
 
 void JsonWriter::WriteByteArray(const std::vector<uint8_t>& bytes) {
     WriteComma();
-    ss_ << "[";
+    buffer_ += '[';
     for (size_t i = 0; i < bytes.size(); ++i) {
-        if (i > 0) ss_ << ",";
-        ss_ << static_cast<int>(bytes[i]);
+        if (i > 0) buffer_ += ',';
+        AppendNumber(buffer_, static_cast<int>(bytes[i]));
     }
-    ss_ << "]";
+    buffer_ += ']';
     needsComma_ = true;
+    FlushIfFull();
 }
 
-void JsonWriter::WriteIndent() {
-    for (int i = 0; i < indent_; ++i) {
-        ss_ << "  ";
+void JsonWriter::WriteFragment(const std::string& fragment) {
+    if (fragment.empty()) {
+        return;
+    }
+    WriteComma();
+    buffer_ += fragment;
+    needsComma_ = true;
+    FlushIfFull();
+}
+
+bool JsonWriter::Flush() {
+    if (out_ == nullptr) {
+        return true;
+    }
+    if (!buffer_.empty()) {
+        out_->write(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        buffer_.clear();
     }
+    return static_cast<bool>(*out_);
+}
+
+void JsonWriter::WriteIndent() {
+    buffer_.append(static_cast<size_t>(indent_) * 2, ' ');
 }
 
 void JsonWriter::WriteComma() {
     if (needsComma_) {
-        ss_ << ",\n";
+        buffer_ += ",\n";
     }
 }
 
-std::string JsonWriter::EscapeString(const std::string& str) {
-    std::string result;
-    result.reserve(str.size());
-    
-    for (char c : str) {
-        switch (c) {
-            case '"':  result += "\\\""; break;
-            case '\\': result += "\\\\"; break;
-            case '\b': result += "\\b"; break;
-            case '\f': result += "\\f"; break;
-            case '\n': result += "\\n"; break;
-            case '\r': result += "\\r"; break;
-            case '\t': result += "\\t"; break;
-            default:
-                if (c < 32) {
-                    // Escape control characters
-                    char buf[7];
-                    snprintf(buf, sizeof(buf), "\\u%04x", static_cast<unsigned char>(c));
-                    result += buf;
-                } else {
-                    result += c;
-                }
-                break;
+void JsonWriter::WriteEscaped(const std::string& str) {
+    static constexpr char HexDigits[] = "0123456789abcdef";
+
+    // Copy each run of bytes that need no escaping in one go
+    size_t runStart = 0;
+    for (size_t i = 0; i < str.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(str[i]);
+        char escape = EscapeTable[c];
+        if (escape == 0) {
+            continue;
+        }
+        buffer_.append(str, runStart, i - runStart);
+        runStart = i + 1;
+        if (escape == 1) {
+            char code[] = {'\\', 'u', '0', '0', HexDigits[c >> 4], HexDigits[c & 0xF]};
+            buffer_.append(code, sizeof(code));
+        } else {
+            buffer_ += '\\';
+            buffer_ += escape;
         }
     }
-    
-    return result;
+    buffer_.append(str, runStart, str.size() - runStart);
+}
+
+JsonString JsonConstants::String(std::string_view text) {
+    int id = Strings_.Intern(text);
+    return {static_cast<uint32_t>(id), &Strings_[id]};
+}
+
+JsonObject JsonConstants::Object(std::vector<std::pair<std::string, std::string>> entries) {
+    std::sort(entries.begin(), entries.end());
+    std::lock_guard<std::mutex> lock(ObjectsMutex_);
+    auto it = ObjectIds_.try_emplace(std::move(entries), static_cast<uint32_t>(ObjectIds_.size())).first;
+    return {it->second, &it->first};
+}
+
+size_t JsonConstants::ObjectCount() const {
+    std::lock_guard<std::mutex> lock(ObjectsMutex_);
+    return ObjectIds_.size();
 }
 
-} // namespace DMCompiler
\ No newline at end of file
+} // namespace DMCompiler
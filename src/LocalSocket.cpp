@@ -0,0 +1,206 @@
+#include "LocalSocket.h"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+// Undefine Windows macros that conflict with std::
+#ifdef max
+#undef max
+#endif
+#ifdef min
+#undef min
+#endif
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+constexpr SocketHandle NoSocket = INVALID_SOCKET;
+void CloseSocket(SocketHandle socket) { closesocket(socket); }
+#else
+using SocketHandle = int;
+constexpr SocketHandle NoSocket = -1;
+void CloseSocket(SocketHandle socket) { close(socket); }
+#endif
+
+// A peer hanging up mid-reply must not take the process down with SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SendFlags = MSG_NOSIGNAL;
+#else
+constexpr int SendFlags = 0;
+#endif
+
+bool StartSockets() {
+#ifdef _WIN32
+    static const bool started = [] {
+        WSADATA wsaData;
+        return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+    }();
+    return started;
+#else
+    return true;
+#endif
+}
+
+bool MakeAddress(const std::string& socketPath, sockaddr_un& address, std::string& error) {
+    address = sockaddr_un{};
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        error = "Socket path must be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters: " + socketPath;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    return true;
+}
+
+bool SendAll(SocketHandle socket, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int count = static_cast<int>(send(socket, data.data() + sent, static_cast<int>(data.size() - sent), SendFlags));
+        if (count <= 0) {
+            return false;
+        }
+        sent += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+} // namespace
+
+bool LocalSocket::Serve(const std::string& socketPath, const Handler& handler) {
+    if (!StartSockets()) {
+        std::cerr << "Error: Failed to start Winsock" << std::endl;
+        return false;
+    }
+
+    sockaddr_un address;
+    std::string error;
+    if (!MakeAddress(socketPath, address, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return false;
+    }
+    auto* socketAddress = reinterpret_cast<sockaddr*>(&address);
+
+    // Left behind by a server that did not exit cleanly, unless one still answers on it
+    std::error_code ec;
+    if (fs::exists(socketPath, ec)) {
+        SocketHandle probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool inUse = probe != NoSocket && connect(probe, socketAddress, sizeof(address)) == 0;
+        if (probe != NoSocket) {
+            CloseSocket(probe);
+        }
+        if (inUse) {
+            std::cerr << "Error: Another server is listening on " << socketPath << std::endl;
+            return false;
+        }
+        fs::remove(socketPath, ec);
+    }
+
+    SocketHandle server = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server == NoSocket || bind(server, socketAddress, sizeof(address)) != 0 || listen(server, 8) != 0) {
+        std::cerr << "Error: Cannot listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        if (server != NoSocket) {
+            CloseSocket(server);
+        }
+        return false;
+    }
+
+    while (true) {
+        SocketHandle client = accept(server, nullptr, nullptr);
+        if (client == NoSocket) {
+            continue;
+        }
+        std::thread([handler, client]() {
+            std::string pending;
+            char buffer[4096];
+            int count;
+            while ((count = static_cast<int>(recv(client, buffer, sizeof(buffer), 0))) > 0) {
+                pending.append(buffer, static_cast<size_t>(count));
+                size_t start = 0;
+                size_t end;
+                bool open = true;
+                while (open && (end = pending.find('\n', start)) != std::string::npos) {
+                    std::string line = pending.substr(start, end - start);
+                    start = end + 1;
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    if (!line.empty()) {
+                        open = SendAll(client, handler(line) + "\n");
+                    }
+                }
+                if (!open) {
+                    break;
+                }
+                pending.erase(0, start);
+            }
+            CloseSocket(client);
+        }).detach();
+    }
+}
+
+bool LocalSocket::Request(const std::string& socketPath, const std::string& request, std::string& reply,
+                          std::string& error) {
+    if (!StartSockets()) {
+        error = "Failed to start Winsock";
+        return false;
+    }
+
+    sockaddr_un address;
+    if (!MakeAddress(socketPath, address, error)) {
+        return false;
+    }
+
+    SocketHandle client = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (client == NoSocket || connect(client, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        error = "Cannot connect to " + socketPath + ": " + std::strerror(errno);
+        if (client != NoSocket) {
+            CloseSocket(client);
+        }
+        return false;
+    }
+    if (!SendAll(client, request + "\n")) {
+        error = "Failed to send the request to " + socketPath;
+        CloseSocket(client);
+        return false;
+    }
+
+    reply.clear();
+    char buffer[4096];
+    int count;
+    size_t end = std::string::npos;
+    while (end == std::string::npos && (count = static_cast<int>(recv(client, buffer, sizeof(buffer), 0))) > 0) {
+        size_t searchFrom = reply.size();
+        reply.append(buffer, static_cast<size_t>(count));
+        end = reply.find('\n', searchFrom);
+    }
+    CloseSocket(client);
+    if (end == std::string::npos) {
+        error = "The server at " + socketPath + " closed the connection without replying";
+        return false;
+    }
+    reply.erase(end);
+    if (!reply.empty() && reply.back() == '\r') {
+        reply.pop_back();
+    }
+    return true;
+}
+
+} // namespace DMCompiler
@@ -1,13 +1,70 @@
 #include "Location.h"
 #include <sstream>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
 
 namespace DMCompiler {
 
-Location Location::Internal("internal", 0, 0);
+namespace {
+
+struct FileTable {
+    std::mutex Mutex;
+    // std::deque keeps paths at stable addresses as the table grows
+    std::deque<std::string> Paths;
+    std::unordered_map<std::string_view, uint32_t> Ids;
+
+    FileTable() {
+        Add("");
+        Add("internal");
+    }
+
+    uint32_t Add(std::string_view path) {
+        const std::string& stored = Paths.emplace_back(path);
+        uint32_t id = static_cast<uint32_t>(Paths.size() - 1);
+        Ids.emplace(std::string_view(stored), id);
+        return id;
+    }
+};
+
+// Function-local static so the table exists before any static Location is built
+FileTable& GetFileTable() {
+    static FileTable table;
+    return table;
+}
+
+} // namespace
+
+uint32_t SourceFileRegistry::Register(std::string_view path) {
+    FileTable& table = GetFileTable();
+    std::lock_guard<std::mutex> lock(table.Mutex);
+    auto it = table.Ids.find(path);
+    if (it != table.Ids.end()) {
+        return it->second;
+    }
+    return table.Add(path);
+}
+
+const std::string& SourceFileRegistry::GetPath(uint32_t fileId) {
+    FileTable& table = GetFileTable();
+    std::lock_guard<std::mutex> lock(table.Mutex);
+    if (fileId >= table.Paths.size()) {
+        return table.Paths[UnknownFileId];
+    }
+    return table.Paths[fileId];
+}
+
+size_t SourceFileRegistry::Count() {
+    FileTable& table = GetFileTable();
+    std::lock_guard<std::mutex> lock(table.Mutex);
+    return table.Paths.size();
+}
+
+Location Location::Internal(SourceFileRegistry::InternalFileId, 0, 0);
 
 std::string Location::ToString() const {
     std::ostringstream oss;
-    oss << SourceFile << ":" << Line << ":" << Column;
+    oss << SourceFile() << ":" << Line << ":" << Column;
     return oss.str();
 }
 
@@ -0,0 +1,219 @@
+#include "MapCache.h"
+#include "DMMParser.h"
+#include "DMObject.h"
+#include "DMObjectTree.h"
+#include "TokenCache.h"
+#include "TokenSerialization.h"
+#include <cstdio>
+#include <filesystem>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char CacheMagic[4] = {'D', 'M', 'M', 'C'};
+static constexpr uint32_t CacheFormatVersion = 3;
+
+// What a type path resolved to, as DMMScanner sorts a cell's objects
+enum class TypeKind : uint8_t {
+    Missing, Turf, Area, Other
+};
+
+static TypeKind ResolveType(DMObjectTree& tree, const DreamPath& path, int& typeId) {
+    DMObject* turf = nullptr;
+    DMObject* area = nullptr;
+    DMObject* type = nullptr;
+    tree.TryGetDMObject(DreamPath::Turf, &turf);
+    tree.TryGetDMObject(DreamPath::Area, &area);
+    if (!tree.TryGetDMObject(path, &type) || type == nullptr) {
+        typeId = -1;
+        return TypeKind::Missing;
+    }
+    typeId = type->Id;
+    return type->IsSubtypeOf(turf) ? TypeKind::Turf : type->IsSubtypeOf(area) ? TypeKind::Area : TypeKind::Other;
+}
+
+static void WriteMapObject(BinaryWriter& writer, const MapObjectJson* object) {
+    writer.Write<int32_t>(object ? object->Type : -1);
+}
+
+static std::unique_ptr<MapObjectJson> ReadMapObject(BinaryReader& reader) {
+    int32_t type = reader.Read<int32_t>();
+    return type < 0 ? nullptr : std::make_unique<MapObjectJson>(type);
+}
+
+MapCache::MapCache(std::string directory)
+    : Directory_(std::move(directory))
+{
+    std::error_code ec;
+    fs::create_directories(Directory_, ec);
+}
+
+uint64_t MapCache::HashMap(const std::string& mapPath, std::string_view content) {
+    // The path is part of the key since the stored warnings name it
+    uint64_t hash = TokenCache::HashContent(content);
+    for (char c : mapPath) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string MapCache::EntryPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.map", static_cast<unsigned long long>(hash));
+    return (fs::path(Directory_) / name).string();
+}
+
+std::unique_ptr<DreamMapJson> MapCache::Load(uint64_t hash, DMObjectTree& tree, std::vector<std::string>& warnings) const {
+    std::string data;
+    if (!ReadBinaryFile(EntryPath(hash), data)) {
+        return nullptr;
+    }
+
+    BinaryReader reader(data);
+    if (!reader.VerifyChecksum() ||
+        !reader.Expect(CacheMagic, sizeof(CacheMagic)) ||
+        reader.Read<uint32_t>() != CacheFormatVersion ||
+        reader.Read<uint64_t>() != hash) {
+        return nullptr;
+    }
+
+    // The type tree fingerprint
+    uint32_t typeCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < typeCount && reader.Ok(); ++i) {
+        DreamPath path(reader.ReadString());
+        int32_t typeId = reader.Read<int32_t>();
+        uint8_t kind = reader.Read<uint8_t>();
+        int currentId;
+        if (static_cast<uint8_t>(ResolveType(tree, path, currentId)) != kind || currentId != typeId) {
+            return nullptr;
+        }
+    }
+
+    warnings.clear();
+    uint32_t warningCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < warningCount && reader.Ok(); ++i) {
+        warnings.push_back(reader.ReadString());
+    }
+
+    auto map = std::make_unique<DreamMapJson>();
+    map->MaxX = reader.Read<int32_t>();
+    map->MaxY = reader.Read<int32_t>();
+    map->MaxZ = reader.Read<int32_t>();
+
+    uint32_t keyCount = reader.Read<uint32_t>();
+    for (uint32_t id = 0; id < keyCount && reader.Ok(); ++id) {
+        std::string key = reader.ReadString();
+        if (map->GetCellKeyId(key) != id) {
+            return nullptr;  // Keys are distinct
+        }
+        if (reader.Read<uint8_t>() == 0) {
+            continue;
+        }
+        auto cell = std::make_unique<CellDefinitionJson>(key);
+        cell->Turf = ReadMapObject(reader);
+        cell->Area = ReadMapObject(reader);
+        uint32_t objectCount = reader.Read<uint32_t>();
+        for (uint32_t i = 0; i < objectCount && reader.Ok(); ++i) {
+            cell->Objects.push_back(std::make_unique<MapObjectJson>(reader.Read<int32_t>()));
+        }
+        cell->SkippedOverrides = reader.Read<uint32_t>();
+        map->SetCellDefinition(std::move(cell));
+    }
+
+    uint32_t blockCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < blockCount && reader.Ok(); ++i) {
+        int32_t x = reader.Read<int32_t>();
+        int32_t y = reader.Read<int32_t>();
+        int32_t z = reader.Read<int32_t>();
+        auto block = std::make_unique<MapBlockJson>(x, y, z);
+        block->Width = reader.Read<int32_t>();
+        block->Height = reader.Read<int32_t>();
+        uint32_t cellCount = reader.ReadCount(sizeof(uint32_t));
+        if (!reader.Ok()) {
+            return nullptr;
+        }
+        block->Cells.reserve(cellCount);
+        for (uint32_t cell = 0; cell < cellCount; ++cell) {
+            uint32_t keyId = reader.Read<uint32_t>();
+            if (keyId >= keyCount) {
+                return nullptr;
+            }
+            block->Cells.push_back(keyId);
+        }
+        map->Blocks.push_back(std::move(block));
+    }
+
+    if (!reader.Ok() || !reader.AtEnd()) {
+        return nullptr;
+    }
+    return map;
+}
+
+void MapCache::Store(uint64_t hash, const DreamMapJson& map, const std::vector<DreamPath>& referencedTypes,
+                     const std::vector<std::string>& warnings, DMObjectTree& tree) const {
+    BinaryWriter writer;
+    writer.WriteBytes(CacheMagic, sizeof(CacheMagic));
+    writer.Write<uint32_t>(CacheFormatVersion);
+    writer.Write<uint64_t>(hash);
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(referencedTypes.size()));
+    for (const DreamPath& path : referencedTypes) {
+        int typeId;
+        TypeKind kind = ResolveType(tree, path, typeId);
+        writer.WriteString(path.ToString());
+        writer.Write<int32_t>(typeId);
+        writer.Write<uint8_t>(static_cast<uint8_t>(kind));
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(warnings.size()));
+    for (const auto& warning : warnings) {
+        writer.WriteString(warning);
+    }
+
+    writer.Write<int32_t>(map.MaxX);
+    writer.Write<int32_t>(map.MaxY);
+    writer.Write<int32_t>(map.MaxZ);
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(map.CellKeys.size()));
+    for (size_t id = 0; id < map.CellKeys.size(); ++id) {
+        writer.WriteString(map.CellKeys[id]);
+        const CellDefinitionJson* cell = map.CellDefinitions[id].get();
+        writer.Write<uint8_t>(cell ? 1 : 0);
+        if (!cell) {
+            continue;
+        }
+        if ((cell->Turf && !cell->Turf->VarOverrides.empty()) || (cell->Area && !cell->Area->VarOverrides.empty())) {
+            return;
+        }
+        WriteMapObject(writer, cell->Turf.get());
+        WriteMapObject(writer, cell->Area.get());
+        writer.Write<uint32_t>(static_cast<uint32_t>(cell->Objects.size()));
+        for (const auto& object : cell->Objects) {
+            if (!object->VarOverrides.empty()) {
+                return;
+            }
+            writer.Write<int32_t>(object->Type);
+        }
+        writer.Write<uint32_t>(cell->SkippedOverrides);
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(map.Blocks.size()));
+    for (const auto& block : map.Blocks) {
+        writer.Write<int32_t>(block->X);
+        writer.Write<int32_t>(block->Y);
+        writer.Write<int32_t>(block->Z);
+        writer.Write<int32_t>(block->Width);
+        writer.Write<int32_t>(block->Height);
+        writer.Write<uint32_t>(static_cast<uint32_t>(block->Cells.size()));
+        writer.WriteBytes(reinterpret_cast<const char*>(block->Cells.data()), block->Cells.size() * sizeof(uint32_t));
+    }
+
+    writer.WriteChecksum();
+
+    // Written through a temporary, so concurrent compilers never see a partial entry
+    WriteBinaryFileAtomic(EntryPath(hash), writer.Data());
+}
+
+} // namespace DMCompiler
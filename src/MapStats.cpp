@@ -0,0 +1,158 @@
+#include "MapStats.h"
+#include "DMMParser.h"
+#include "DMObject.h"
+#include "DMObjectTree.h"
+#include "JsonWriter.h"
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <iomanip>
+#include <set>
+
+namespace DMCompiler {
+
+namespace {
+
+std::string TypePath(const DMObjectTree& tree, int typeId) {
+    if (typeId < 0 || static_cast<size_t>(typeId) >= tree.AllObjects.size()) {
+        return "?";
+    }
+    return tree.AllObjects[typeId]->Path.ToString();
+}
+
+// A map's types, most tiles first
+std::vector<std::pair<int, uint64_t>> SortedTypes(const MapStats::Map& map, const DMObjectTree& tree) {
+    std::vector<std::pair<int, uint64_t>> types(map.TypeTiles.begin(), map.TypeTiles.end());
+    std::sort(types.begin(), types.end(), [&](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : TypePath(tree, a.first) < TypePath(tree, b.first);
+    });
+    return types;
+}
+
+} // namespace
+
+void MapStats::Add(const std::string& path, const DreamMapJson& map) {
+    Map& stats = Maps.emplace_back();
+    stats.Path = path;
+    stats.MaxX = map.MaxX;
+    stats.MaxY = map.MaxY;
+    stats.MaxZ = map.MaxZ;
+    stats.Blocks = map.Blocks.size();
+    stats.Keys = map.CellKeys.size();
+
+    // Tiles naming each key, so each definition is looked at once
+    std::vector<uint64_t> keyTiles(map.CellKeys.size(), 0);
+    for (const auto& block : map.Blocks) {
+        for (uint32_t keyId : block->Cells) {
+            keyTiles[keyId]++;
+        }
+        stats.Tiles += block->Cells.size();
+    }
+
+    std::set<std::vector<int>> contents;
+    for (size_t id = 0; id < map.CellDefinitions.size(); ++id) {
+        const CellDefinitionJson* cell = map.CellDefinitions[id].get();
+        uint64_t tiles = keyTiles[id];
+        if (!cell) {
+            stats.UndefinedTiles += tiles;
+            stats.ObjectsPerTile[0] += tiles;
+            continue;
+        }
+        stats.DefinedKeys++;
+        stats.KeyOverrides += cell->SkippedOverrides;
+        stats.Overrides += tiles * cell->SkippedOverrides;
+        stats.Objects += tiles * cell->Objects.size();
+        stats.ObjectsPerTile[std::min(cell->Objects.size(), HistogramSize - 1)] += tiles;
+
+        std::vector<int> types{cell->Turf ? cell->Turf->Type : -1, cell->Area ? cell->Area->Type : -1};
+        for (const auto& object : cell->Objects) {
+            types.push_back(object->Type);
+        }
+        for (int type : types) {
+            if (type >= 0 && tiles > 0) {
+                stats.TypeTiles[type] += tiles;
+            }
+        }
+        contents.insert(std::move(types));
+    }
+    stats.DistinctCells = contents.size();
+}
+
+void MapStats::Report(std::ostream& out, const DMObjectTree& tree, size_t topCount) const {
+    out << "Map statistics:" << std::endl;
+    for (const Map& map : Maps) {
+        out << std::endl << "  " << map.Path << ": " << map.MaxX << "x" << map.MaxY << "x" << map.MaxZ << ", "
+            << map.Blocks << " blocks, " << map.Tiles << " tiles" << std::endl;
+        out << "    Keys: " << map.Keys << " (" << map.DefinedKeys << " defined, " << map.DistinctCells
+            << " distinct cells, " << map.UndefinedTiles << " tiles undefined)" << std::endl;
+        out << "    Objects: " << map.Objects << " (" << std::fixed << std::setprecision(2)
+            << (map.Tiles ? static_cast<double>(map.Objects) / map.Tiles : 0.0) << " per tile)" << std::endl;
+        out.unsetf(std::ios::floatfield);
+        out << "    Var overrides: " << map.Overrides << " on tiles, " << map.KeyOverrides << " in definitions"
+            << std::endl;
+
+        out << "    Objects per tile:";
+        for (size_t count = 0; count < HistogramSize; ++count) {
+            if (map.ObjectsPerTile[count] > 0) {
+                out << "  " << count << (count == HistogramSize - 1 ? "+" : "") << ": " << map.ObjectsPerTile[count];
+            }
+        }
+        out << std::endl;
+
+        auto types = SortedTypes(map, tree);
+        out << "    Most frequent types:" << std::endl;
+        for (size_t i = 0; i < types.size() && i < topCount; ++i) {
+            out << "    " << std::setw(10) << types[i].second << "  " << TypePath(tree, types[i].first) << std::endl;
+        }
+    }
+}
+
+bool MapStats::WriteJson(const std::string& path, const DMObjectTree& tree) const {
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKey("Maps");
+    json.BeginArray();
+    for (const Map& map : Maps) {
+        auto writeCount = [&](const std::string& key, uint64_t value) {
+            json.WriteKey(key);
+            json.WriteInt64(static_cast<int64_t>(value));
+        };
+        json.BeginObject();
+        json.WriteKeyValue("Path", map.Path);
+        json.WriteKeyValue("MaxX", map.MaxX);
+        json.WriteKeyValue("MaxY", map.MaxY);
+        json.WriteKeyValue("MaxZ", map.MaxZ);
+        writeCount("Blocks", map.Blocks);
+        writeCount("Tiles", map.Tiles);
+        writeCount("Keys", map.Keys);
+        writeCount("DefinedKeys", map.DefinedKeys);
+        writeCount("DistinctCells", map.DistinctCells);
+        writeCount("UndefinedTiles", map.UndefinedTiles);
+        writeCount("Objects", map.Objects);
+        writeCount("Overrides", map.Overrides);
+        writeCount("KeyOverrides", map.KeyOverrides);
+
+        // Index i counts tiles holding i objects; the last, that many or more
+        json.WriteKey("ObjectsPerTile");
+        json.BeginArray();
+        for (uint64_t tiles : map.ObjectsPerTile) {
+            json.WriteInt64(static_cast<int64_t>(tiles));
+        }
+        json.EndArray();
+
+        json.WriteKey("Types");
+        json.BeginArray();
+        for (const auto& [typeId, tiles] : SortedTypes(map, tree)) {
+            json.BeginObject();
+            json.WriteKeyValue("Path", TypePath(tree, typeId));
+            writeCount("Tiles", tiles);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return WriteBinaryFileAtomic(path, json.ToString());
+}
+
+} // namespace DMCompiler
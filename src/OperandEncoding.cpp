@@ -0,0 +1,221 @@
+#include "OperandEncoding.h"
+#include "DMReference.h"
+
+namespace DMCompiler {
+
+namespace {
+
+// Reads of locals are written with this type byte by the expression compiler
+constexpr uint8_t LocalReadReferenceType = 28;
+
+uint32_t ReadUInt32(const std::vector<uint8_t>& bytes, size_t offset) {
+    return static_cast<uint32_t>(bytes[offset]) |
+           (static_cast<uint32_t>(bytes[offset + 1]) << 8) |
+           (static_cast<uint32_t>(bytes[offset + 2]) << 16) |
+           (static_cast<uint32_t>(bytes[offset + 3]) << 24);
+}
+
+} // namespace
+
+bool IsCompactOperand(OpcodeArgType type) {
+    switch (type) {
+        case OpcodeArgType::TypeId:
+        case OpcodeArgType::String:
+        case OpcodeArgType::StackDelta:
+        case OpcodeArgType::FormatCount:
+        case OpcodeArgType::ListSize:
+        case OpcodeArgType::Resource:
+        case OpcodeArgType::ProcId:
+        case OpcodeArgType::EnumeratorId:
+        case OpcodeArgType::FilterId:
+        case OpcodeArgType::PickCount:
+        case OpcodeArgType::ConcatCount:
+        case OpcodeArgType::Int:
+            return true;
+        default:
+            return false;
+    }
+}
+
+size_t ReferenceLength(uint8_t type) {
+    switch (type) {
+        case static_cast<uint8_t>(DMReference::Type::Argument):
+        case static_cast<uint8_t>(DMReference::Type::Local):
+        case LocalReadReferenceType:
+            return 2;
+        case static_cast<uint8_t>(DMReference::Type::Global):
+        case static_cast<uint8_t>(DMReference::Type::GlobalProc):
+        case static_cast<uint8_t>(DMReference::Type::Field):
+        case static_cast<uint8_t>(DMReference::Type::SrcField):
+        case static_cast<uint8_t>(DMReference::Type::SrcProc):
+            return 5;
+        default:
+            return 1;
+    }
+}
+
+std::optional<size_t> OperandLength(OpcodeArgType type, const std::vector<uint8_t>& bytes, size_t offset,
+                                    OperandEncoding encoding) {
+    size_t length = FixedOperandSize(type);
+    if (type == OpcodeArgType::Reference) {
+        if (offset >= bytes.size()) {
+            return std::nullopt;
+        }
+        length = ReferenceLength(bytes[offset]);
+    } else if (encoding == OperandEncoding::Leb128 && IsCompactOperand(type)) {
+        size_t end = offset;
+        if (!ReadLeb128(bytes, end)) {
+            return std::nullopt;
+        }
+        length = end - offset;
+    }
+    if (offset + length > bytes.size()) {
+        return std::nullopt;
+    }
+    return length;
+}
+
+DecodedInstruction DecodeInstruction(const std::vector<uint8_t>& bytes, size_t offset, OperandEncoding encoding) {
+    DecodedInstruction instruction;
+    instruction.Opcode = static_cast<DreamProcOpcode>(bytes[offset]);
+    const OpcodeMetadata& metadata = GetOpcodeMetadata(instruction.Opcode);
+    size_t available = bytes.size() - offset;
+
+    // Every operand at its fixed size: the table has the layout already
+    if (!metadata.HasReference && (encoding == OperandEncoding::Fixed || metadata.OperandCount == 0) &&
+        metadata.FixedLength <= available) {
+        size_t position = 1;
+        for (OpcodeArgType type : {metadata.ArgType1, metadata.ArgType2, metadata.ArgType3, metadata.ArgType4}) {
+            if (type != OpcodeArgType::None) {
+                size_t length = FixedOperandSize(type);
+                instruction.Operands[instruction.OperandCount++] = {type, position, length};
+                position += length;
+            }
+        }
+        instruction.Length = metadata.FixedLength;
+        return instruction;
+    }
+
+    size_t position = 1;
+    for (OpcodeArgType type : {metadata.ArgType1, metadata.ArgType2, metadata.ArgType3, metadata.ArgType4}) {
+        if (type == OpcodeArgType::None) {
+            continue;
+        }
+        auto length = OperandLength(type, bytes, offset + position, encoding);
+        if (!length) {
+            instruction.Truncated = true;
+            position = available;
+            break;
+        }
+        instruction.Operands[instruction.OperandCount++] = {type, position, *length};
+        position += *length;
+    }
+    instruction.Length = position;
+    return instruction;
+}
+
+uint32_t ReadOperandValue(const std::vector<uint8_t>& bytes, size_t offset, const OperandSpan& operand,
+                          OperandEncoding encoding) {
+    size_t start = offset + operand.Offset;
+    if (operand.Type == OpcodeArgType::Reference) {
+        return operand.Length == 5 ? ReadUInt32(bytes, start + 1) : operand.Length == 2 ? bytes[start + 1] : 0;
+    }
+    if (encoding == OperandEncoding::Leb128 && IsCompactOperand(operand.Type)) {
+        return ReadLeb128(bytes, start).value_or(0);
+    }
+    return operand.Length >= 4 ? ReadUInt32(bytes, start) : operand.Length == 1 ? bytes[start] : 0;
+}
+
+std::optional<std::vector<OperandSpan>> SplitOperands(const BytecodeInstruction& instruction) {
+    const OpcodeMetadata& metadata = GetOpcodeMetadata(instruction.Opcode);
+    const OpcodeArgType types[] = {metadata.ArgType1, metadata.ArgType2, metadata.ArgType3, metadata.ArgType4};
+
+    size_t fixedSize = 1;
+    size_t referenceCount = 0;
+    for (OpcodeArgType type : types) {
+        fixedSize += FixedOperandSize(type);
+        referenceCount += type == OpcodeArgType::Reference;
+    }
+    const std::vector<uint8_t>& bytes = instruction.Bytes;
+    if (bytes.size() < fixedSize + referenceCount) {
+        return std::nullopt;
+    }
+    size_t referenceBytes = bytes.size() - fixedSize;
+    if (referenceCount == 0 && referenceBytes != 0) {
+        return std::nullopt;
+    }
+
+    std::vector<OperandSpan> operands;
+    size_t offset = 1;
+    for (OpcodeArgType type : types) {
+        if (type == OpcodeArgType::None) {
+            continue;
+        }
+        size_t length = FixedOperandSize(type);
+        if (type == OpcodeArgType::Reference) {
+            length = referenceCount == 1 ? referenceBytes : ReferenceLength(bytes[offset]);
+            if (length > referenceBytes) {
+                return std::nullopt;
+            }
+            referenceBytes -= length;
+        }
+        operands.push_back({type, offset, length});
+        offset += length;
+    }
+    if (referenceBytes != 0) {
+        return std::nullopt;
+    }
+    return operands;
+}
+
+void WriteLeb128(std::vector<uint8_t>& bytes, uint32_t value) {
+    while (value >= 0x80) {
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+std::optional<uint32_t> ReadLeb128(const std::vector<uint8_t>& bytes, size_t& offset) {
+    uint32_t value = 0;
+    for (int shift = 0; shift < 35 && offset < bytes.size(); shift += 7) {
+        uint8_t byte = bytes[offset++];
+        value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+bool CompactInstruction(BytecodeInstruction& instruction) {
+    auto operands = SplitOperands(instruction);
+    if (!operands) {
+        return false;
+    }
+
+    std::vector<uint8_t> bytes{instruction.Bytes[0]};
+    size_t jumpOffset = instruction.JumpOffset;
+    for (const OperandSpan& operand : *operands) {
+        bool compact = IsCompactOperand(operand.Type);
+        if (instruction.JumpLabel >= 0 && instruction.JumpOffset >= operand.Offset &&
+            instruction.JumpOffset < operand.Offset + operand.Length) {
+            // The offset Finalize() fills in has to keep its 4 bytes
+            if (compact) {
+                return false;
+            }
+            jumpOffset = bytes.size() + (instruction.JumpOffset - operand.Offset);
+        }
+        if (compact) {
+            WriteLeb128(bytes, ReadUInt32(instruction.Bytes, operand.Offset));
+        } else {
+            bytes.insert(bytes.end(), instruction.Bytes.begin() + operand.Offset,
+                         instruction.Bytes.begin() + operand.Offset + operand.Length);
+        }
+    }
+    instruction.Bytes = std::move(bytes);
+    instruction.JumpOffset = jumpOffset;
+    return true;
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,268 @@
+#include "OutputCompression.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace DMCompiler {
+namespace OutputCompression {
+
+namespace {
+
+constexpr size_t HeaderSize = 28;
+constexpr size_t MinMatch = 4;
+constexpr size_t LastLiterals = 5;   // A block always ends with this many literals
+constexpr size_t MatchLimit = 12;    // and its last match starts at least this far from the end
+constexpr size_t MaxOffset = 65535;
+constexpr unsigned HashBits = 16;
+constexpr size_t MaxRatio = 255;     // The most one byte of a block can expand into
+
+void AppendWord(std::string& out, uint32_t word) {
+    char bytes[4] = {static_cast<char>(word), static_cast<char>(word >> 8), static_cast<char>(word >> 16),
+                     static_cast<char>(word >> 24)};
+    out.append(bytes, 4);
+}
+
+uint32_t ReadWord(const char* data) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(data);
+    return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+uint32_t Read32(const uint8_t* data) {
+    uint32_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+uint32_t Hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HashBits);
+}
+
+void AppendLength(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) {
+        out += static_cast<char>(255);
+    }
+    out += static_cast<char>(length);
+}
+
+void AppendSequence(std::string& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength) {
+    size_t extraMatch = matchLength - MinMatch;
+    out += static_cast<char>(std::min<size_t>(literalCount, 15) << 4 | std::min<size_t>(extraMatch, 15));
+    if (literalCount >= 15) {
+        AppendLength(out, literalCount - 15);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literalCount);
+    out += static_cast<char>(offset);
+    out += static_cast<char>(offset >> 8);
+    if (extraMatch >= 15) {
+        AppendLength(out, extraMatch - 15);
+    }
+}
+
+void AppendLastLiterals(std::string& out, const uint8_t* literals, size_t literalCount) {
+    out += static_cast<char>(std::min<size_t>(literalCount, 15) << 4);
+    if (literalCount >= 15) {
+        AppendLength(out, literalCount - 15);
+    }
+    out.append(reinterpret_cast<const char*>(literals), literalCount);
+}
+
+// Greedy LZ4 block compression: the first earlier match a hash of the next
+// four bytes finds is taken, then stretched both ways
+std::string CompressBlock(const uint8_t* data, size_t size) {
+    std::string out;
+    out.reserve(size / 2 + 16);
+    size_t anchor = 0;
+    if (size > MatchLimit) {
+        std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+        size_t pos = 0;
+        while (pos + MatchLimit <= size) {
+            uint32_t sequence = Read32(data + pos);
+            uint32_t hash = Hash(sequence);
+            size_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(pos);
+            if (candidate >= pos || pos - candidate > MaxOffset || Read32(data + candidate) != sequence) {
+                // Step further through data that has not matched in a while
+                pos += 1 + ((pos - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = MinMatch;
+            while (pos + length < size - LastLiterals && data[candidate + length] == data[pos + length]) {
+                ++length;
+            }
+            while (pos > anchor && candidate > 0 && data[pos - 1] == data[candidate - 1]) {
+                --pos;
+                --candidate;
+                ++length;
+            }
+            AppendSequence(out, data + anchor, pos - anchor, pos - candidate, length);
+            pos += length;
+            anchor = pos;
+        }
+    }
+    AppendLastLiterals(out, data + anchor, size - anchor);
+    return out;
+}
+
+bool ReadLength(const uint8_t* data, size_t size, size_t& pos, size_t& length) {
+    uint8_t byte;
+    do {
+        if (pos >= size) {
+            return false;
+        }
+        byte = data[pos++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// Decompress one block into exactly expected bytes at out, checking every
+// length and offset against both buffers
+bool DecompressBlock(const uint8_t* data, size_t size, char* out, size_t expected) {
+    size_t pos = 0;
+    size_t written = 0;
+    while (true) {
+        if (pos >= size) {
+            return false;
+        }
+        uint8_t token = data[pos++];
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(data, size, pos, literalCount)) {
+            return false;
+        }
+        if (literalCount > size - pos || literalCount > expected - written) {
+            return false;
+        }
+        std::memcpy(out + written, data + pos, literalCount);
+        pos += literalCount;
+        written += literalCount;
+        if (pos == size) {
+            return written == expected;
+        }
+
+        if (size - pos < 2) {
+            return false;
+        }
+        size_t offset = data[pos] | data[pos + 1] << 8;
+        pos += 2;
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(data, size, pos, matchLength)) {
+            return false;
+        }
+        matchLength += MinMatch;
+        if (offset == 0 || offset > written || matchLength > expected - written) {
+            return false;
+        }
+        // Byte by byte, as a match may overlap what it copies
+        for (size_t i = 0; i < matchLength; ++i, ++written) {
+            out[written] = out[written - offset];
+        }
+    }
+}
+
+} // namespace
+
+bool IsCompressed(std::string_view data) {
+    return data.size() >= sizeof(Magic) && std::memcmp(data.data(), Magic, sizeof(Magic)) == 0;
+}
+
+std::string Compress(std::string_view data, unsigned threadCount) {
+    size_t chunkCount = (data.size() + ChunkSize - 1) / ChunkSize;
+    std::vector<std::string> chunks(chunkCount);
+    auto compressChunk = [&](size_t index) {
+        std::string_view chunk = data.substr(index * ChunkSize, ChunkSize);
+        chunks[index] = CompressBlock(reinterpret_cast<const uint8_t*>(chunk.data()), chunk.size());
+    };
+
+    size_t workerCount = std::min<size_t>(threadCount, chunkCount);
+    if (workerCount <= 1) {
+        for (size_t i = 0; i < chunkCount; ++i) {
+            compressChunk(i);
+        }
+    } else {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < workerCount; ++t) {
+            workers.emplace_back([&] {
+                for (size_t i = next++; i < chunkCount; i = next++) {
+                    compressChunk(i);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    std::string out;
+    out.append(Magic, sizeof(Magic));
+    AppendWord(out, Version);
+    AppendWord(out, CodecLz4Block);
+    AppendWord(out, ChunkSize);
+    AppendWord(out, static_cast<uint32_t>(data.size()));
+    AppendWord(out, static_cast<uint32_t>(static_cast<uint64_t>(data.size()) >> 32));
+    AppendWord(out, static_cast<uint32_t>(chunkCount));
+    // A chunk that came out no smaller is kept as it was
+    for (size_t i = 0; i < chunkCount; ++i) {
+        size_t rawSize = std::min<size_t>(ChunkSize, data.size() - i * ChunkSize);
+        if (chunks[i].size() >= rawSize) {
+            chunks[i] = std::string(data.substr(i * ChunkSize, rawSize));
+            AppendWord(out, static_cast<uint32_t>(rawSize) | StoredChunk);
+        } else {
+            AppendWord(out, static_cast<uint32_t>(chunks[i].size()));
+        }
+    }
+    for (const auto& chunk : chunks) {
+        out += chunk;
+    }
+    return out;
+}
+
+bool Decompress(std::string_view data, std::string& out) {
+    if (data.size() < HeaderSize || !IsCompressed(data) || ReadWord(data.data() + 4) != Version ||
+        ReadWord(data.data() + 8) != CodecLz4Block) {
+        return false;
+    }
+    size_t chunkSize = ReadWord(data.data() + 12);
+    uint64_t originalSize = ReadWord(data.data() + 16) | static_cast<uint64_t>(ReadWord(data.data() + 20)) << 32;
+    size_t chunkCount = ReadWord(data.data() + 24);
+    if (chunkSize == 0 || chunkSize >= StoredChunk || chunkCount != (originalSize + chunkSize - 1) / chunkSize ||
+        (data.size() - HeaderSize) / 4 < chunkCount) {
+        return false;
+    }
+
+    out.clear();
+    size_t pos = HeaderSize + chunkCount * 4;
+    for (size_t i = 0; i < chunkCount; ++i) {
+        uint32_t entry = ReadWord(data.data() + HeaderSize + i * 4);
+        size_t storedSize = entry & ~StoredChunk;
+        size_t rawSize = std::min<uint64_t>(chunkSize, originalSize - i * uint64_t(chunkSize));
+        if (storedSize > data.size() - pos) {
+            return false;
+        }
+        const char* chunk = data.data() + pos;
+        pos += storedSize;
+        if (entry & StoredChunk) {
+            if (storedSize != rawSize) {
+                return false;
+            }
+            out.append(chunk, storedSize);
+            continue;
+        }
+        // Checked before growing the output, so a bad header cannot ask for more than the file could hold
+        if (rawSize > storedSize * MaxRatio) {
+            return false;
+        }
+        size_t start = out.size();
+        out.resize(start + rawSize);
+        if (!DecompressBlock(reinterpret_cast<const uint8_t*>(chunk), storedSize, out.data() + start, rawSize)) {
+            return false;
+        }
+    }
+    return pos == data.size();
+}
+
+} // namespace OutputCompression
+} // namespace DMCompiler
@@ -0,0 +1,199 @@
+#include "ParallelLexer.h"
+#include "DMPreprocessor.h"
+#include "SourceBuffer.h"
+#include "TokenCache.h"
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <thread>
+#include <queue>
+#include <unordered_set>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+std::shared_ptr<PreLexedFiles::TokenArray> PreLexedFiles::LexFile(const std::string& path, const TokenCache* cache) {
+    std::shared_ptr<const SourceBuffer> content = LoadPreprocessorSource(path);
+    if (!content) {
+        return nullptr;
+    }
+
+    if (cache) {
+        if (auto cached = cache->Load(path, content->View())) {
+            return cached;
+        }
+    }
+
+    auto tokens = std::make_shared<TokenArray>();
+    // Whitespace emission matches what DMPreprocessor::PushFile asks for
+    DMLexer lexer(path, content, true);
+    while (true) {
+        tokens->push_back(lexer.GetNextToken());
+        if (tokens->back().Type == TokenType::EndOfFile) {
+            break;
+        }
+    }
+
+    if (cache) {
+        cache->Store(content->View(), *tokens);
+    }
+    return tokens;
+}
+
+// Collect the absolute paths of quoted/identifier #includes in a token array.
+// Paths are resolved the same way HandleIncludeDirectiveStreaming and PushFile do,
+// so the results match the keys the preprocessor looks up.
+static std::vector<std::string> FindIncludes(const std::string& path, const PreLexedFiles::TokenArray& tokens) {
+    std::vector<std::string> includes;
+    fs::path currentDir = fs::path(path).parent_path();
+
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i].Type != TokenType::DM_Preproc_Include) {
+            continue;
+        }
+
+        size_t j = i + 1;
+        while (j < tokens.size() && tokens[j].Type == TokenType::DM_Preproc_Whitespace) {
+            ++j;
+        }
+        if (j >= tokens.size()) {
+            break;
+        }
+
+        const Token& pathToken = tokens[j];
+        if (pathToken.Type != TokenType::DM_Preproc_ConstantString &&
+            pathToken.Type != TokenType::String &&
+            pathToken.Type != TokenType::Identifier) {
+            continue;  // Library includes are resolved against search paths; leave them inline
+        }
+
+        std::string filePath = pathToken.Text;
+        if (filePath.length() >= 2 && filePath.front() == '"' && filePath.back() == '"') {
+            filePath = filePath.substr(1, filePath.length() - 2);
+        }
+        filePath = FixIncludePath(filePath);
+
+        if (filePath.size() >= 4) {
+            std::string ext = filePath.substr(filePath.size() - 4);
+            if (ext == ".dmm" || ext == ".dmf") {
+                continue;  // Maps and interfaces are not preprocessed
+            }
+        }
+
+        try {
+            includes.push_back(fs::absolute(currentDir / filePath).string());
+        } catch (...) {
+            // Invalid paths are reported by the preprocessor when it reaches them
+        }
+    }
+    return includes;
+}
+
+void PreLexedFiles::LexReachable(const std::string& rootPath, unsigned threadCount, const TokenCache* cache) {
+    std::mutex queueMutex;
+    std::condition_variable queueChanged;
+    std::queue<std::string> pending;
+    std::unordered_set<std::string> seen;
+    size_t inFlight = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        for (const auto& [path, tokens] : Files_) {
+            seen.insert(path);
+        }
+    }
+    if (seen.insert(rootPath).second) {
+        pending.push(rootPath);
+    }
+
+    auto worker = [&]() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true) {
+            queueChanged.wait(lock, [&] { return !pending.empty() || inFlight == 0; });
+            if (pending.empty()) {
+                return;  // Nothing queued and no one left to queue more
+            }
+
+            std::string path = std::move(pending.front());
+            pending.pop();
+            inFlight++;
+            lock.unlock();
+
+            std::shared_ptr<TokenArray> tokens;
+            std::vector<std::string> includes;
+            std::error_code ec;
+            if (fs::is_regular_file(path, ec)) {
+                try {
+                    tokens = LexFile(path, cache);
+                } catch (const std::exception&) {
+                    // Left for the preprocessor to lex inline, where the error is reported
+                    tokens = nullptr;
+                }
+                if (tokens) {
+                    includes = FindIncludes(path, *tokens);
+                    std::lock_guard<std::mutex> filesLock(Mutex_);
+                    Files_[path] = tokens;
+                }
+            }
+
+            lock.lock();
+            for (auto& include : includes) {
+                if (seen.insert(include).second) {
+                    pending.push(std::move(include));
+                }
+            }
+            inFlight--;
+            queueChanged.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned count = std::max(threadCount, 1u);
+    threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<const PreLexedFiles::TokenArray> PreLexedFiles::Find(const std::string& absolutePath) const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    auto it = Files_.find(absolutePath);
+    return it != Files_.end() ? it->second : nullptr;
+}
+
+size_t PreLexedFiles::Size() const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Files_.size();
+}
+
+ReplayDMLexer::ReplayDMLexer(const std::string& sourceName, std::shared_ptr<const PreLexedFiles::TokenArray> tokens)
+    : DMLexer(sourceName, "")  // Empty source
+    , Tokens_(std::move(tokens))
+{
+}
+
+Token ReplayDMLexer::SkipConditionalBlock(int& depth, bool stopAtElse) {
+    // The tokens already exist, so there is nothing to gain from scanning bytes
+    return SkipConditionalTokens(depth, stopAtElse);
+}
+
+Token ReplayDMLexer::ParseNextToken() {
+    if (Index_ >= Tokens_->size()) {
+        AtEndOfSource_ = true;
+        return CreateToken(TokenType::EndOfFile, "");
+    }
+
+    const Token& token = (*Tokens_)[Index_++];
+    PreviousLocation_ = CurrentLocation_;
+    CurrentLocation_ = token.Loc;
+    if (token.Type == TokenType::EndOfFile) {
+        AtEndOfSource_ = true;
+    }
+    return token;
+}
+
+} // namespace DMCompiler
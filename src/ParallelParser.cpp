@@ -0,0 +1,206 @@
+#include "ParallelParser.h"
+#include "DMParser.h"
+#include "DMCompiler.h"
+#include "TokenStreamDMLexer.h"
+#include <algorithm>
+#include <atomic>
+#include <iterator>
+#include <thread>
+
+namespace DMCompiler {
+
+// Chunks per thread, so one slow chunk does not leave the others idle
+static constexpr size_t ChunksPerThread = 4;
+
+static bool IsPunctuator(const TokenBuffer& tokens, size_t index, std::string_view text) {
+    return tokens.TypeAt(index) == TokenType::DM_Preproc_Punctuator && tokens.TextAt(index) == text;
+}
+
+// Only lines starting with a path, a name or proc/var/verb begin a definition;
+// a line holding just "{" continues the one above it
+static bool StartsDefinition(const TokenBuffer& tokens, size_t index) {
+    switch (tokens.TypeAt(index)) {
+        case TokenType::Divide:
+        case TokenType::Slash:
+        case TokenType::Identifier:
+        case TokenType::DM_Preproc_Identifier:
+        case TokenType::Var:
+        case TokenType::Proc:
+        case TokenType::Verb:
+            return true;
+        default:
+            return IsPunctuator(tokens, index, "/");
+    }
+}
+
+ParallelParser::ParallelParser(DMCompiler* compiler, const TokenBuffer& tokens)
+    : Compiler_(compiler), Tokens_(tokens) {
+}
+
+namespace {
+
+// Tracks what FindChunkStarts() has to know about the tokens before a line to
+// tell whether a definition can start there
+class ChunkScanner {
+public:
+    // Whether tokens[index], with every token before it stepped over, is where a chunk can start
+    bool AtBoundary(const TokenBuffer& tokens, size_t index) const {
+        return index > 0 && (tokens.TypeAt(index - 1) == TokenType::Newline || tokens.TypeAt(index - 1) == TokenType::Dedent) &&
+            BracketNesting_ == 0 && BraceNesting_ == 0 && StringNesting_ == 0 && IndentDepth_ == 0 &&
+            StartsDefinition(tokens, index);
+    }
+
+    void Step(const TokenBuffer& tokens, size_t index) {
+        switch (tokens.TypeAt(index)) {
+            case TokenType::Indent:
+                IndentDepth_++;
+                break;
+            case TokenType::Dedent:
+                IndentDepth_ = std::max(IndentDepth_ - 1, 0);
+                break;
+            case TokenType::DM_Preproc_Punctuator_LeftParenthesis:
+            case TokenType::DM_Preproc_Punctuator_LeftBracket:
+            case TokenType::LeftParenthesis:
+            case TokenType::LeftBracket:
+                BracketNesting_++;
+                break;
+            case TokenType::DM_Preproc_Punctuator_RightParenthesis:
+            case TokenType::DM_Preproc_Punctuator_RightBracket:
+            case TokenType::RightParenthesis:
+            case TokenType::RightBracket:
+                BracketNesting_ = std::max(BracketNesting_ - 1, 0);
+                break;
+            case TokenType::LeftCurlyBracket:
+                BraceNesting_++;
+                break;
+            case TokenType::RightCurlyBracket:
+                BraceNesting_ = std::max(BraceNesting_ - 1, 0);
+                break;
+            case TokenType::DM_Preproc_Punctuator:
+                if (IsPunctuator(tokens, index, "{")) {
+                    BraceNesting_++;
+                } else if (IsPunctuator(tokens, index, "}")) {
+                    BraceNesting_ = std::max(BraceNesting_ - 1, 0);
+                }
+                break;
+            case TokenType::DM_Preproc_StringBegin:
+                StringNesting_++;
+                break;
+            case TokenType::DM_Preproc_StringEnd:
+                StringNesting_ = std::max(StringNesting_ - 1, 0);
+                break;
+            default:
+                break;
+        }
+    }
+
+private:
+    // Same bracket rule as TokenStreamDMLexer, which ignores indentation inside them
+    int BracketNesting_ = 0;
+    int BraceNesting_ = 0;
+    int StringNesting_ = 0;
+    // Only nonzero in a buffer that went through ResolveIndentation, where a
+    // line's indentation is no longer a whitespace token in front of it
+    int IndentDepth_ = 0;
+};
+
+} // namespace
+
+std::vector<size_t> ParallelParser::FindChunkStarts(const TokenBuffer& tokens, size_t minChunkTokens, size_t begin) {
+    std::vector<size_t> starts{begin};
+    ChunkScanner scanner;
+    for (size_t i = begin; i < tokens.size(); ++i) {
+        if (i - starts.back() >= minChunkTokens && scanner.AtBoundary(tokens, i)) {
+            starts.push_back(i);
+        }
+        scanner.Step(tokens, i);
+    }
+    return starts;
+}
+
+bool ParallelParser::IsChunkStart(const TokenBuffer& tokens, size_t index) {
+    ChunkScanner scanner;
+    for (size_t i = 0; i < index && i < tokens.size(); ++i) {
+        scanner.Step(tokens, i);
+    }
+    return index < tokens.size() && scanner.AtBoundary(tokens, index);
+}
+
+std::unique_ptr<DMASTFile> ParallelParser::Parse(unsigned threadCount, size_t minChunkTokens, size_t begin) {
+    threadCount = std::max(threadCount, 1u);
+    size_t chunkTokens = std::max((Tokens_.size() - begin) / (threadCount * ChunksPerThread), std::max<size_t>(minChunkTokens, 1));
+    std::vector<size_t> starts = FindChunkStarts(Tokens_, chunkTokens, begin);
+    ChunkCount_ = starts.size();
+    if (ChunkCount_ < 2) {
+        return nullptr;
+    }
+    starts.push_back(Tokens_.size());
+
+    std::vector<std::unique_ptr<DMASTFile>> fragments(ChunkCount_);
+    std::atomic<size_t> nextChunk{0};
+    std::atomic<bool> failed{false};
+
+    auto worker = [&]() {
+        size_t chunk;
+        while (!failed && (chunk = nextChunk++) < ChunkCount_) {
+            fragments[chunk] = ParseChunk(Compiler_, Tokens_, starts[chunk], starts[chunk + 1]);
+            if (!fragments[chunk]) {
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned count = static_cast<unsigned>(std::min<size_t>(threadCount, ChunkCount_));
+    threads.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    if (failed) {
+        return nullptr;
+    }
+
+    return Merge(std::move(fragments));
+}
+
+std::unique_ptr<DMASTFile> ParallelParser::ParseChunk(DMCompiler* compiler, const TokenBuffer& tokens, size_t begin, size_t end) {
+    TokenStreamDMLexer lexer(tokens, begin, end);
+    DMParser parser(compiler, &lexer);
+    parser.SetSuppressDiagnostics(true);
+    parser.SetDeferProcBodies(compiler && compiler->GetSettings().LazyProcBodies);
+    std::unique_ptr<DMASTFile> fragment;
+    try {
+        fragment = parser.ParseFile();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+    if (parser.HadSuppressedDiagnostics()) {
+        return nullptr;
+    }
+    return fragment;
+}
+
+std::unique_ptr<DMASTFile> ParallelParser::Merge(std::vector<std::unique_ptr<DMASTFile>> fragments) {
+    size_t statementCount = 0;
+    for (const auto& fragment : fragments) {
+        statementCount += fragment->Statements.size();
+    }
+    std::vector<std::unique_ptr<DMASTStatement>> statements;
+    statements.reserve(statementCount);
+    for (auto& fragment : fragments) {
+        std::move(fragment->Statements.begin(), fragment->Statements.end(), std::back_inserter(statements));
+        fragment->Statements.clear();
+    }
+
+    auto file = std::make_unique<DMASTFile>(fragments.front()->Location_, std::move(statements));
+    file->Arena = std::move(fragments.front()->Arena);
+    for (size_t i = 1; i < fragments.size(); ++i) {
+        file->Arena->Adopt(*fragments[i]->Arena);
+    }
+    return file;
+}
+
+} // namespace DMCompiler
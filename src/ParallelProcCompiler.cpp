@@ -0,0 +1,203 @@
+#include "ParallelProcCompiler.h"
+#include "DMCompiler.h"
+#include "DMObjectTree.h"
+#include "DMProc.h"
+#include "ProcCache.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <unordered_set>
+
+namespace DMCompiler {
+
+namespace {
+
+// What one speculative compile of a proc needed from shared state
+struct Speculation {
+    std::vector<std::string> NewStrings;  // In first-use order
+    std::unordered_set<std::string> Recorded;
+    DiagnosticBuffer Diagnostics;  // Reported in proc order once the workers are done
+    bool Abandoned = false;
+};
+
+thread_local Speculation* CurrentSpeculation = nullptr;
+
+// Run work(i) for every i below count on threadCount threads, each taking
+// the next index as it gets done with one
+template<typename Work>
+void RunWorkers(size_t count, unsigned threadCount, Work work) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        size_t index;
+        while ((index = next++) < count) {
+            work(index);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    unsigned spawned = static_cast<unsigned>(std::min<size_t>(threadCount, count));
+    threads.reserve(spawned);
+    for (unsigned i = 0; i < spawned; ++i) {
+        threads.emplace_back(worker);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void CompileSpeculatively(DMCompiler* compiler, DMProc* proc, Speculation& speculation) {
+    CurrentSpeculation = &speculation;
+    DiagnosticBuffer::Capture capture(speculation.Diagnostics);
+    try {
+        proc->Compile(compiler);
+    } catch (const std::exception&) {
+        // Thrown again, from the right place, when compiled in order
+        speculation.Abandoned = true;
+    }
+    CurrentSpeculation = nullptr;
+}
+
+} // namespace
+
+ParallelProcCompiler::ParallelProcCompiler(DMCompiler* compiler)
+    : Compiler_(compiler) {
+}
+
+bool ParallelProcCompiler::IsSpeculating() {
+    return CurrentSpeculation != nullptr;
+}
+
+bool ParallelProcCompiler::Abandon() {
+    if (CurrentSpeculation == nullptr) {
+        return false;
+    }
+    CurrentSpeculation->Abandoned = true;
+    return true;
+}
+
+std::ostream& ParallelProcCompiler::ErrorStream() {
+    ProcCache::RecordSideEffect();
+    if (!Abandon()) {
+        return std::cerr;
+    }
+    // No buffer, so everything written to it is dropped
+    static thread_local std::ostream discard(nullptr);
+    discard.clear();
+    return discard;
+}
+
+int ParallelProcCompiler::RecordNewString(std::string_view value) {
+    // The placeholder ID must not be cached
+    ProcCache::RecordSideEffect();
+    if (CurrentSpeculation->Recorded.emplace(value).second) {
+        CurrentSpeculation->NewStrings.emplace_back(value);
+    }
+    // Never ends up in the output; the proc is compiled again
+    return 0;
+}
+
+void ParallelProcCompiler::Compile(PointerRange<DMProc> procs, unsigned threadCount) {
+    RecompiledCount_ = 0;
+    AbandonedCount_ = 0;
+
+    // Parsing a deferred body reports diagnostics and reads the shared token stream
+    for (auto* proc : procs) {
+        proc->LoadDeferredBody(Compiler_);
+    }
+
+    // Procs Compile() would skip anyway keep whatever they already have
+    std::vector<DMProc*> pending;
+    pending.reserve(procs.size());
+    for (auto* proc : procs) {
+        if (!proc->IsUnsupported() && proc->Bytecode.empty()) {
+            pending.push_back(proc);
+        }
+    }
+
+    DMObjectTree* objectTree = Compiler_->GetObjectTree();
+    ProcCache* cache = Compiler_->GetProcCache();
+    if (threadCount < 2 || pending.size() < 2) {
+        for (auto* proc : pending) {
+            std::unique_ptr<ProcCache::Entry> entry = cache ? cache->Find(*proc) : nullptr;
+            if (!entry || !cache->Apply(*proc, *entry, *objectTree)) {
+                proc->Compile(Compiler_);
+            }
+        }
+        return;
+    }
+
+    // Cached procs are looked up on the workers too, and applied in order below
+    std::vector<std::unique_ptr<ProcCache::Entry>> cached(pending.size());
+    std::vector<Speculation> speculations(pending.size());
+    RunWorkers(pending.size(), threadCount, [&](size_t index) {
+        if (cache && (cached[index] = cache->Find(*pending[index]))) {
+            return;
+        }
+        CompileSpeculatively(Compiler_, pending[index], speculations[index]);
+    });
+
+    // Intern strings in the order a sequential build first uses them, and
+    // report diagnostics where it would have
+    bool checkOnly = Compiler_->GetSettings().CheckOnly;
+    std::vector<DMProc*> recompile;
+    std::vector<bool> compiled;  // False for a cached proc that could not be renumbered, which has no compile to reset
+    for (size_t i = 0; i < pending.size(); ++i) {
+        DMProc* proc = pending[i];
+        const Speculation& speculation = speculations[i];
+        if (cached[i]) {
+            // Its strings are in the table now, as compiling it would have left them
+            if (!cache->Apply(*proc, *cached[i], *objectTree)) {
+                recompile.push_back(proc);
+                compiled.push_back(false);
+            }
+        } else if (speculation.Abandoned) {
+            proc->ResetCompilation();
+            proc->Compile(Compiler_);
+            AbandonedCount_++;
+        } else {
+            Compiler_->Report(speculation.Diagnostics);
+            if (!speculation.NewStrings.empty()) {
+                for (const auto& value : speculation.NewStrings) {
+                    objectTree->AddString(value);
+                }
+                // A check keeps only the diagnostics, which no string ID changes
+                if (checkOnly) {
+                    continue;
+                }
+                recompile.push_back(proc);
+                compiled.push_back(true);
+            }
+        }
+    }
+    RecompiledCount_ = recompile.size();
+
+    // Strings are only looked up from here on
+    std::vector<Speculation> retries(recompile.size());
+    RunWorkers(recompile.size(), threadCount, [&](size_t index) {
+        if (compiled[index]) {
+            recompile[index]->ResetCompilation();
+        }
+        CompileSpeculatively(Compiler_, recompile[index], retries[index]);
+    });
+
+    // A proc that comes out differently the second time is compiled once more
+    // on its own, which can only move its new strings to the end of the table.
+    // A proc compiled before has reported its diagnostics already
+    for (size_t i = 0; i < recompile.size(); ++i) {
+        if (retries[i].Abandoned || !retries[i].NewStrings.empty()) {
+            recompile[i]->ResetCompilation();
+            if (compiled[i]) {
+                DiagnosticBuffer reported;
+                DiagnosticBuffer::Capture capture(reported);
+                recompile[i]->Compile(Compiler_);
+            } else {
+                recompile[i]->Compile(Compiler_);
+            }
+        } else if (!compiled[i]) {
+            Compiler_->Report(retries[i].Diagnostics);
+        }
+    }
+}
+
+} // namespace DMCompiler
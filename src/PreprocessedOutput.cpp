@@ -0,0 +1,98 @@
+#include "PreprocessedOutput.h"
+#include "DMConstants.h"
+#include "TokenSerialization.h"
+#include <filesystem>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char OutputMagic[4] = {'D', 'M', 'P', 'P'};
+static constexpr uint32_t OutputFormatVersion = 1;
+
+static void WriteStrings(BinaryWriter& writer, const std::vector<std::string>& strings) {
+    writer.Write<uint32_t>(static_cast<uint32_t>(strings.size()));
+    for (const auto& value : strings) {
+        writer.WriteString(value);
+    }
+}
+
+static void ReadStrings(BinaryReader& reader, std::vector<std::string>& strings) {
+    uint32_t count = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < count && reader.Ok(); ++i) {
+        strings.push_back(reader.ReadString());
+    }
+}
+
+bool PreprocessedOutput::Load(const std::string& path) {
+    std::string data;
+    if (!ReadBinaryFile(path, data)) {
+        return false;
+    }
+
+    BinaryReader reader(data);
+    if (!reader.Expect(OutputMagic, sizeof(OutputMagic)) ||
+        reader.Read<uint32_t>() != OutputFormatVersion ||
+        reader.Read<uint32_t>() != static_cast<uint32_t>(Versions::LEXER_VERSION)) {
+        return false;
+    }
+
+    uint32_t constantCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < constantCount && reader.Ok(); ++i) {
+        std::string name = reader.ReadString();
+        int value = reader.Read<int32_t>();
+        StandardConstants.emplace_back(std::move(name), value);
+    }
+
+    uint32_t pragmaCount = reader.Read<uint32_t>();
+    for (uint32_t i = 0; i < pragmaCount && reader.Ok(); ++i) {
+        auto code = static_cast<WarningCode>(reader.Read<int32_t>());
+        auto level = static_cast<ErrorLevel>(reader.Read<int32_t>());
+        Pragmas.emplace_back(code, level);
+    }
+
+    ReadStrings(reader, ResourceDirectories);
+    ReadStrings(reader, IncludedMaps);
+    IncludedInterface = reader.ReadString();
+
+    if (!ReadTokens(reader, Tokens, true, SourceFileRegistry::UnknownFileId)) {
+        *this = PreprocessedOutput();
+        return false;
+    }
+    return true;
+}
+
+bool PreprocessedOutput::Save(const std::string& path) const {
+    BinaryWriter writer;
+    writer.Reserve(64 + Tokens.size() * 24);
+    writer.WriteBytes(OutputMagic, sizeof(OutputMagic));
+    writer.Write<uint32_t>(OutputFormatVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(Versions::LEXER_VERSION));
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(StandardConstants.size()));
+    for (const auto& [name, value] : StandardConstants) {
+        writer.WriteString(name);
+        writer.Write<int32_t>(value);
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(Pragmas.size()));
+    for (const auto& [code, level] : Pragmas) {
+        writer.Write<int32_t>(static_cast<int32_t>(code));
+        writer.Write<int32_t>(static_cast<int32_t>(level));
+    }
+
+    WriteStrings(writer, ResourceDirectories);
+    WriteStrings(writer, IncludedMaps);
+    writer.WriteString(IncludedInterface);
+
+    WriteTokens(writer, Tokens, true);
+
+    std::error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent, ec);
+    }
+    return WriteBinaryFileAtomic(path, writer.Data());
+}
+
+} // namespace DMCompiler
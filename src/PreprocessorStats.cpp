@@ -0,0 +1,84 @@
+#include "PreprocessorStats.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace DMCompiler {
+
+// Sort a map's entries by a key, largest first, keeping at most count of them
+template<typename TStats, typename TKey>
+static std::vector<std::pair<const std::string*, const TStats*>> TopEntries(
+    const std::unordered_map<std::string, TStats>& entries, size_t count, TKey key) {
+    std::vector<std::pair<const std::string*, const TStats*>> sorted;
+    sorted.reserve(entries.size());
+    for (const auto& [name, stats] : entries) {
+        sorted.emplace_back(&name, &stats);
+    }
+    std::sort(sorted.begin(), sorted.end(), [&](const auto& a, const auto& b) {
+        uint64_t keyA = key(*a.second);
+        uint64_t keyB = key(*b.second);
+        return keyA != keyB ? keyA > keyB : *a.first < *b.first;
+    });
+    if (sorted.size() > count) {
+        sorted.resize(count);
+    }
+    return sorted;
+}
+
+void PreprocessorStats::Report(std::ostream& out, size_t topCount) const {
+    uint64_t totalBytes = 0;
+    uint64_t totalTokens = 0;
+    for (const auto& [path, stats] : Files) {
+        totalBytes += stats.Bytes;
+        totalTokens += stats.Tokens;
+    }
+    uint64_t totalExpansions = 0;
+    uint64_t totalProduced = 0;
+    for (const auto& [name, stats] : Macros) {
+        totalExpansions += stats.Expansions;
+        totalProduced += stats.TokensProduced;
+    }
+
+    out << "Preprocessor statistics:" << std::endl;
+    out << "  Files: " << Files.size() << " (" << totalBytes << " bytes, " << totalTokens << " lexer tokens)" << std::endl;
+    out << "  Macro expansions: " << totalExpansions << " of " << Macros.size() << " macros, producing "
+        << totalProduced << " tokens" << std::endl;
+    out << "  Inactive blocks skipped: " << SkippedBlocks << " in " << std::fixed << std::setprecision(3)
+        << SkipSeconds * 1000.0 << " ms" << std::endl;
+    out.unsetf(std::ios::floatfield);
+
+    out << std::endl << "  Files by tokens read:" << std::endl;
+    out << "    " << std::setw(10) << "tokens" << std::setw(12) << "bytes" << std::setw(8) << "fan-in"
+        << std::setw(8) << "opened" << std::setw(7) << "depth" << "  path" << std::endl;
+    for (const auto& [path, stats] : TopEntries(Files, topCount, [](const FileStats& s) { return s.Tokens; })) {
+        out << "    " << std::setw(10) << stats->Tokens << std::setw(12) << stats->Bytes << std::setw(8) << stats->IncludedBy
+            << std::setw(8) << stats->Opened << std::setw(7) << stats->MaxDepth << "  " << *path << std::endl;
+    }
+
+    // Headers named by many includes are the ones worth precompiling
+    auto byFanIn = TopEntries(Files, topCount, [](const FileStats& s) { return s.IncludedBy; });
+    if (!byFanIn.empty() && byFanIn.front().second->IncludedBy > 0) {
+        out << std::endl << "  Files by include fan-in:" << std::endl;
+        out << "    " << std::setw(8) << "fan-in" << std::setw(10) << "tokens" << "  path" << std::endl;
+    }
+    for (const auto& [path, stats] : byFanIn) {
+        if (stats->IncludedBy == 0) {
+            break;
+        }
+        out << "    " << std::setw(8) << stats->IncludedBy << std::setw(10) << stats->Tokens << "  " << *path << std::endl;
+    }
+
+    out << std::endl << "  Macros by tokens produced:" << std::endl;
+    out << "    " << std::setw(10) << "tokens" << std::setw(12) << "expansions" << "  name" << std::endl;
+    for (const auto& [name, stats] : TopEntries(Macros, topCount, [](const MacroStats& s) { return s.TokensProduced; })) {
+        out << "    " << std::setw(10) << stats->TokensProduced << std::setw(12) << stats->Expansions << "  " << *name << std::endl;
+    }
+
+    if (!DeepestChain.empty()) {
+        out << std::endl << "  Deepest include chain (" << DeepestChain.size() << " files):" << std::endl;
+        for (size_t i = 0; i < DeepestChain.size(); ++i) {
+            out << "    " << std::string(i * 2, ' ') << DeepestChain[i] << std::endl;
+        }
+    }
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,594 @@
+#include "ProcCache.h"
+#include "ASTCache.h"
+#include "DMCompiler.h"
+#include "DMConstants.h"
+#include "DMObject.h"
+#include "DMObjectTree.h"
+#include "DMProc.h"
+#include "DMReference.h"
+#include "SortedEntries.h"
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char CacheMagic[4] = {'D', 'M', 'P', 'C'};
+static constexpr uint32_t CacheFormatVersion = 3;  // 3: list indexes are ListIndex references
+
+// Stands in for the body of an __init__ proc, whose code comes from its type's vars
+static constexpr uint64_t InitializationBody = 0x696e6974ull;
+
+// ..() is a CallStatement with a reference of this type, arguments type and count
+static constexpr uint8_t SuperProcReferenceType = 7;
+static constexpr size_t SuperCallLength = 7;
+
+namespace {
+
+// Incremental FNV-1a, as the other caches hash with
+struct FingerprintHash {
+    uint64_t Value = 14695981039346656037ull;
+
+    void AddBytes(const void* data, size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            Value ^= bytes[i];
+            Value *= 1099511628211ull;
+        }
+    }
+
+    template <typename T>
+    void Add(T value) { AddBytes(&value, sizeof(T)); }
+
+    void AddString(std::string_view text) {
+        Add<uint32_t>(static_cast<uint32_t>(text.size()));
+        AddBytes(text.data(), text.size());
+    }
+
+    void AddPath(const std::optional<DreamPath>& path) {
+        Add<uint8_t>(path.has_value() ? 1 : 0);
+        if (path) {
+            AddString(path->ToString());
+        }
+    }
+
+    void AddOptional(const std::optional<std::string>& text) {
+        Add<uint8_t>(text.has_value() ? 1 : 0);
+        if (text) {
+            AddString(*text);
+        }
+    }
+
+    void AddValueType(const DMComplexValueType& type) {
+        Add<uint32_t>(static_cast<uint32_t>(type.Type));
+        AddPath(type.TypePath);
+        Add<uint8_t>(static_cast<uint8_t>((type.IsUnimplemented ? 1 : 0) | (type.IsUnsupported ? 2 : 0) |
+                                          (type.IsCompileTimeReadOnly ? 4 : 0)));
+    }
+
+    // False if the var's value cannot be hashed
+    bool AddVariable(const DMVariable& variable) {
+        AddString(variable.Name);
+        AddPath(variable.Type);
+        Add<uint8_t>(static_cast<uint8_t>((variable.IsGlobal ? 1 : 0) | (variable.IsConst ? 2 : 0) |
+                                          (variable.IsFinal ? 4 : 0) | (variable.IsTmp ? 8 : 0)));
+        AddValueType(variable.ValType);
+        uint64_t valueHash = 0;
+        if (!ASTCache::HashExpression(variable.Value, valueHash)) {
+            return false;
+        }
+        Add<uint64_t>(valueHash);
+        return true;
+    }
+
+    // What calls to a proc compile against
+    void AddSignature(const DMProc& proc) {
+        Add<int32_t>(proc.Id);
+        AddString(proc.Name);
+        Add<int32_t>(proc.OwningObject ? proc.OwningObject->Id : -1);
+        Add<uint8_t>(static_cast<uint8_t>((proc.IsVerb ? 1 : 0) | (proc.IsFinal ? 2 : 0)));
+        Add<uint8_t>(static_cast<uint8_t>(proc.Attributes));
+        Add<uint32_t>(static_cast<uint32_t>(proc.Parameters.size()));
+        for (const auto& parameter : proc.Parameters) {
+            AddString(parameter);
+            const LocalVariable* local = proc.GetLocalVariable(parameter);
+            AddPath(local ? local->Type : std::nullopt);
+            Add<uint8_t>(local && local->ExplicitValueType ? 1 : 0);
+            if (local && local->ExplicitValueType) {
+                AddValueType(*local->ExplicitValueType);
+            }
+        }
+        Add<int32_t>(proc.VerbSource ? static_cast<int32_t>(*proc.VerbSource) : -1);
+        AddOptional(proc.VerbName);
+        AddOptional(proc.VerbCategory);
+        AddOptional(proc.VerbDescription);
+        Add<int8_t>(proc.Invisibility);
+        AddOptional(proc.UnsupportedReason);
+        Add<uint32_t>(static_cast<uint32_t>(proc.SetAttributes.size()));
+        for (const auto* attribute : SortedEntries(proc.SetAttributes)) {
+            AddString(attribute->first);
+            AddString(attribute->second);
+        }
+    }
+};
+
+// Whether calls to a proc may be inlined, going by the shape
+// DMExpressionCompiler::TryInlineCall looks for: a body of one statement at most
+bool IsInlineCandidate(const DMProc& proc) {
+    return proc.AstBody != nullptr && !proc.IsVerb && proc.AstBody->SetStatements.empty() &&
+           proc.AstBody->Statements.size() <= 1;
+}
+
+std::vector<std::string> SortedUnique(std::vector<std::string> names) {
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+// Field, SrcField and SrcProc references name what they refer to by string ID
+bool IsStringReferenceType(uint8_t type) {
+    return type == static_cast<uint8_t>(DMReference::Type::Field) ||
+           type == static_cast<uint8_t>(DMReference::Type::SrcField) ||
+           type == static_cast<uint8_t>(DMReference::Type::SrcProc);
+}
+
+uint64_t HashName(const DMProc& proc) {
+    FingerprintHash hash;
+    hash.AddString(proc.OwningObject ? proc.OwningObject->Path.ToString() : std::string());
+    hash.AddString(proc.Name);
+    hash.Add<int32_t>(proc.Id);
+    return hash.Value;
+}
+
+// What the proc compiled on this thread has asked for so far
+thread_local ProcCache::Recorder* CurrentRecorder = nullptr;
+
+} // namespace
+
+ProcCache::Recorder::Recorder(ProcCache* cache, DMProc* proc)
+    : Cache_(cache), Proc_(proc), Outer_(CurrentRecorder) {
+    if (Cache_) {
+        CurrentRecorder = this;
+    }
+}
+
+ProcCache::Recorder::~Recorder() {
+    if (!Cache_) {
+        return;
+    }
+    CurrentRecorder = Outer_;
+    if (Outer_) {
+        Outer_->Storable_ = false;  // Its cached copy could not repeat this compile
+    }
+    if (!Storable_ || Proc_->Bytecode.empty() || Proc_->IsUnsupported() || std::uncaught_exceptions() > 0) {
+        return;
+    }
+
+    Entry_.Bytecode = Proc_->Bytecode;
+    Entry_.MaxStackSize = Proc_->MaxStackSize;
+    Entry_.Attributes = static_cast<uint8_t>(Proc_->Attributes);
+    if (Proc_->VerbSource) {
+        Entry_.VerbSource = static_cast<uint16_t>(*Proc_->VerbSource);
+    }
+    Entry_.VerbName = Proc_->VerbName;
+    Entry_.VerbCategory = Proc_->VerbCategory;
+    Entry_.VerbDescription = Proc_->VerbDescription;
+    Entry_.Invisibility = Proc_->Invisibility;
+    for (const auto* attribute : SortedEntries(Proc_->SetAttributes)) {
+        Entry_.SetAttributes.emplace_back(attribute->first, attribute->second);
+    }
+    Cache_->Store(*Proc_, Entry_);
+}
+
+void ProcCache::RecordString(std::string_view value, int id) {
+    Recorder* recorder = CurrentRecorder;
+    if (recorder && recorder->SeenStrings_.emplace(std::string(value), id).second) {
+        recorder->Entry_.Strings.emplace_back(std::string(value), id);
+    }
+}
+
+void ProcCache::RecordResource(const std::string& path) {
+    Recorder* recorder = CurrentRecorder;
+    if (recorder && recorder->SeenResources_.emplace(path, true).second) {
+        recorder->Entry_.Resources.push_back(path);
+    }
+}
+
+void ProcCache::RecordSideEffect() {
+    if (CurrentRecorder) {
+        CurrentRecorder->Storable_ = false;
+    }
+}
+
+bool ProcCache::Fingerprint(const DMCompiler& compiler, const DMObjectTree& tree, TreeFingerprint& fingerprint) {
+    FingerprintHash structure;
+    structure.Add<int32_t>(Versions::BYTECODE_VERSION);
+    structure.Add<int32_t>(Versions::PARSER_VERSION);
+
+    // Whatever changes how procs compile; the rest only shows in diagnostics,
+    // and a proc that reports anything is never stored
+    const DMCompilerSettings& settings = compiler.GetSettings();
+    for (bool setting : {settings.NoOpts, settings.FusedOpcodes, settings.CompactOperands, settings.VerifyStack,
+                         settings.SuppressUnimplementedWarnings, settings.SuppressUnsupportedAccessWarnings,
+                         settings.SkipAnythingTypecheck, settings.NoticesEnabled}) {
+        structure.Add<uint8_t>(setting ? 1 : 0);
+    }
+
+    structure.Add<uint32_t>(static_cast<uint32_t>(tree.AllObjects.size()));
+    for (const auto& object : tree.AllObjects) {
+        structure.Add<int32_t>(object->Id);
+        structure.AddString(object->Path.ToString());
+        structure.Add<int32_t>(object->Parent ? object->Parent->Id : -1);
+        structure.Add<int32_t>(object->InitializationProc);
+        structure.Add<uint8_t>(object->IsFromDMStandard ? 1 : 0);
+    }
+
+    // Each declaration goes in the whole tree's hash and in its name's
+    FingerprintHash whole = structure;
+    std::unordered_map<std::string, FingerprintHash> symbols;
+    auto declare = [&](const std::string& name, const FingerprintHash& declaration) {
+        whole.Add<uint64_t>(declaration.Value);
+        symbols[name].Add<uint64_t>(declaration.Value);
+    };
+    auto declareVariables = [&](char kind, int objectId, const std::unordered_map<std::string, DMVariable>& variables) {
+        for (const auto* entry : SortedEntries(variables)) {
+            FingerprintHash declaration;
+            declaration.Add<char>(kind);
+            declaration.Add<int32_t>(objectId);
+            if (!declaration.AddVariable(entry->second)) {
+                return false;
+            }
+            declare(entry->first, declaration);
+        }
+        return true;
+    };
+    auto declareNames = [&](char kind, int objectId, const std::unordered_set<std::string>& names) {
+        for (const auto* name : SortedEntries(names)) {
+            FingerprintHash declaration;
+            declaration.Add<char>(kind);
+            declaration.Add<int32_t>(objectId);
+            declare(*name, declaration);
+        }
+    };
+
+    for (const auto& object : tree.AllObjects) {
+        for (const auto* entry : SortedEntries(object->Procs)) {
+            FingerprintHash declaration;
+            declaration.Add<char>('p');
+            declaration.Add<int32_t>(object->Id);
+            for (int procId : entry->second) {
+                declaration.Add<int32_t>(procId);
+            }
+            declare(entry->first, declaration);
+        }
+        if (!declareVariables('v', object->Id, object->Variables) ||
+            !declareVariables('o', object->Id, object->VariableOverrides)) {
+            return false;
+        }
+        for (const auto* entry : SortedEntries(object->GlobalVariables)) {
+            FingerprintHash declaration;
+            declaration.Add<char>('g');
+            declaration.Add<int32_t>(object->Id);
+            declaration.Add<int32_t>(entry->second);
+            declare(entry->first, declaration);
+        }
+        declareNames('t', object->Id, object->TmpVariables);
+        declareNames('c', object->Id, object->ConstVariables);
+    }
+
+    for (size_t id = 0; id < tree.Globals.size(); ++id) {
+        FingerprintHash declaration;
+        declaration.Add<char>('G');
+        declaration.Add<uint32_t>(static_cast<uint32_t>(id));
+        if (!declaration.AddVariable(tree.Globals[id])) {
+            return false;
+        }
+        declare(tree.Globals[id].Name, declaration);
+    }
+    for (const auto* entry : SortedEntries(tree.GlobalProcs)) {
+        FingerprintHash declaration;
+        declaration.Add<char>('P');
+        declaration.Add<int32_t>(entry->second);
+        declare(entry->first, declaration);
+    }
+
+    // Signatures, which calls to a proc compile against
+    for (const auto& proc : tree.AllProcs) {
+        FingerprintHash declaration;
+        declaration.Add<char>('s');
+        declaration.AddSignature(*proc);
+        declare(proc->Name, declaration);
+    }
+
+    // A call to a proc that may be inlined compiles to what its body returns,
+    // which can be a var of its type, so that body and the symbols it names
+    // count as the proc's too
+    std::vector<std::pair<std::string, FingerprintHash>> inlineBodies;
+    for (const auto& proc : tree.AllProcs) {
+        if (!IsInlineCandidate(*proc)) {
+            continue;
+        }
+        uint64_t bodyHash;
+        std::vector<std::string> names;
+        if (!ASTCache::HashProc(proc->AstParameters, proc->AstBody, bodyHash, &names)) {
+            return false;
+        }
+        FingerprintHash declaration;
+        declaration.Add<char>('i');
+        declaration.Add<int32_t>(proc->Id);
+        declaration.Add<uint64_t>(bodyHash);
+        for (const std::string& name : SortedUnique(std::move(names))) {
+            auto symbol = symbols.find(name);
+            declaration.Add<uint64_t>(symbol != symbols.end() ? symbol->second.Value : 0);
+        }
+        inlineBodies.emplace_back(proc->Name, declaration);
+    }
+    for (const auto& [name, declaration] : inlineBodies) {
+        declare(name, declaration);
+    }
+
+    fingerprint.Whole = whole.Value;
+    fingerprint.Structure = structure.Value;
+    fingerprint.Symbols.clear();
+    fingerprint.Symbols.reserve(symbols.size());
+    for (const auto& [name, hash] : symbols) {
+        fingerprint.Symbols.emplace(name, hash.Value);
+    }
+    return true;
+}
+
+ProcCache::ProcCache(std::string directory, TreeFingerprint fingerprint, OperandEncoding encoding)
+    : Directory_(std::move(directory))
+    , Fingerprint_(std::move(fingerprint))
+    , Encoding_(encoding)
+{
+    std::error_code ec;
+    fs::create_directories(Directory_, ec);
+}
+
+bool ProcCache::Key(const DMProc& proc, uint64_t& key) const {
+    FingerprintHash hash;
+    hash.Add<uint64_t>(HashName(proc));
+    hash.Add<uint8_t>(static_cast<uint8_t>(proc.Temperature));  // From the profile, which changes how it compiles
+    if (proc.AstBody == nullptr) {
+        hash.Add<uint64_t>(Fingerprint_.Whole);
+        hash.Add<uint64_t>(InitializationBody);
+        key = hash.Value;
+        return true;
+    }
+
+    uint64_t bodyHash;
+    std::vector<std::string> names;
+    if (!ASTCache::HashProc(proc.AstParameters, proc.AstBody, bodyHash, &names)) {
+        return false;
+    }
+    names.push_back(proc.Name);  // ..() calls the proc this one overrides
+    hash.Add<uint64_t>(Fingerprint_.Structure);
+    hash.Add<uint64_t>(bodyHash);
+    for (const std::string& name : SortedUnique(std::move(names))) {
+        auto symbol = Fingerprint_.Symbols.find(name);
+        hash.Add<uint64_t>(symbol != Fingerprint_.Symbols.end() ? symbol->second : 0);
+    }
+    key = hash.Value;
+    return true;
+}
+
+std::string ProcCache::EntryPath(uint64_t nameHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.proc", static_cast<unsigned long long>(nameHash));
+    return (fs::path(Directory_) / name).string();
+}
+
+std::unique_ptr<ProcCache::Entry> ProcCache::Find(const DMProc& proc) const {
+    if (proc.AstBody == nullptr && proc.Name != "__init__") {
+        return nullptr;
+    }
+    uint64_t key;
+    std::string data;
+    if (!Key(proc, key) || !ReadBinaryFile(EntryPath(HashName(proc)), data)) {
+        return nullptr;
+    }
+
+    // Cached bytecode replaces a compile, so an entry damaged anywhere is a miss
+    BinaryReader reader(data);
+    if (!reader.VerifyChecksum() ||
+        !reader.Expect(CacheMagic, sizeof(CacheMagic)) ||
+        reader.Read<uint32_t>() != CacheFormatVersion ||
+        reader.Read<uint64_t>() != key) {
+        return nullptr;
+    }
+
+    auto entry = std::make_unique<Entry>();
+    auto readOptional = [&reader](std::optional<std::string>& value) {
+        if (reader.Read<uint8_t>() != 0) {
+            value = reader.ReadString();
+        }
+    };
+    std::string bytecode = reader.ReadString();
+    entry->Bytecode.assign(bytecode.begin(), bytecode.end());
+    entry->MaxStackSize = reader.Read<int32_t>();
+    entry->Attributes = reader.Read<uint8_t>();
+    if (reader.Read<uint8_t>() != 0) {
+        entry->VerbSource = reader.Read<uint16_t>();
+    }
+    readOptional(entry->VerbName);
+    readOptional(entry->VerbCategory);
+    readOptional(entry->VerbDescription);
+    entry->Invisibility = reader.Read<int8_t>();
+
+    uint32_t attributeCount = reader.ReadCount(2 * sizeof(uint32_t));
+    for (uint32_t i = 0; i < attributeCount && reader.Ok(); ++i) {
+        std::string attribute = reader.ReadString();
+        entry->SetAttributes.emplace_back(std::move(attribute), reader.ReadString());
+    }
+    uint32_t stringCount = reader.ReadCount(sizeof(uint32_t) + sizeof(int32_t));
+    for (uint32_t i = 0; i < stringCount && reader.Ok(); ++i) {
+        std::string value = reader.ReadString();
+        entry->Strings.emplace_back(std::move(value), reader.Read<int32_t>());
+    }
+    uint32_t resourceCount = reader.ReadCount(sizeof(uint32_t));
+    for (uint32_t i = 0; i < resourceCount && reader.Ok(); ++i) {
+        entry->Resources.push_back(reader.ReadString());
+    }
+
+    if (!reader.Ok() || !reader.AtEnd() || entry->Bytecode.empty()) {
+        return nullptr;
+    }
+    return entry;
+}
+
+bool ProcCache::Apply(DMProc& proc, const Entry& entry, DMObjectTree& tree) {
+    // All of them even if the bytecode cannot be used, as the compile that
+    // follows would have interned them right here
+    std::unordered_map<uint32_t, uint32_t> newIds;
+    for (const auto& [value, id] : entry.Strings) {
+        int newId = tree.AddString(value);
+        if (newId != id) {
+            newIds.emplace(static_cast<uint32_t>(id), static_cast<uint32_t>(newId));
+        }
+    }
+    std::vector<uint8_t> bytecode = entry.Bytecode;
+    if (!newIds.empty() && !RenumberStrings(bytecode, newIds, Encoding_)) {
+        return false;
+    }
+    for (const auto& resource : entry.Resources) {
+        tree.AddResource(resource);
+    }
+
+    proc.Bytecode = std::move(bytecode);
+    proc.MaxStackSize = entry.MaxStackSize;
+    proc.Attributes = static_cast<ProcAttributes>(entry.Attributes);
+    proc.VerbSource.reset();
+    if (entry.VerbSource) {
+        proc.VerbSource = static_cast<VerbSrc>(*entry.VerbSource);
+    }
+    proc.VerbName = entry.VerbName;
+    proc.VerbCategory = entry.VerbCategory;
+    proc.VerbDescription = entry.VerbDescription;
+    proc.Invisibility = entry.Invisibility;
+    for (const auto& [attribute, value] : entry.SetAttributes) {
+        proc.SetAttributes[attribute] = value;
+    }
+    if (!newIds.empty()) {
+        Renumbered_++;
+    }
+    Reused_++;
+    return true;
+}
+
+bool ProcCache::RenumberStrings(std::vector<uint8_t>& bytecode, const std::unordered_map<uint32_t, uint32_t>& newIds,
+                                OperandEncoding encoding) {
+    auto writeInt = [&bytecode](size_t offset, uint32_t value) {
+        for (size_t i = 0; i < 4; ++i) {
+            bytecode[offset + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    };
+
+    for (size_t pc = 0; pc < bytecode.size();) {
+        // ..() is written with a SuperProc reference the opcode table does not list, and names no string
+        if (bytecode[pc] == static_cast<uint8_t>(DreamProcOpcode::CallStatement) && pc + 1 < bytecode.size() &&
+            bytecode[pc + 1] == SuperProcReferenceType) {
+            pc += SuperCallLength;
+            continue;
+        }
+        DecodedInstruction instruction = DecodeInstruction(bytecode, pc, encoding);
+        if (instruction.Truncated || !HasOpcodeMetadata(instruction.Opcode)) {
+            return false;
+        }
+
+        for (size_t i = 0; i < instruction.OperandCount; ++i) {
+            const OperandSpan& operand = instruction.Operands[i];
+            bool longReference = operand.Type == OpcodeArgType::Reference && operand.Length == 5;
+            bool reference = longReference && IsStringReferenceType(bytecode[pc + operand.Offset]);
+            // A bare new pushes its type by string ID, and an assignment to a
+            // var of src can write its reference with GlobalProc's type byte,
+            // so these may hold one
+            bool maybeString = operand.Type == OpcodeArgType::TypeId ||
+                               (longReference && bytecode[pc + operand.Offset] ==
+                                                     static_cast<uint8_t>(DMReference::Type::GlobalProc));
+            if (operand.Type != OpcodeArgType::String && !reference && !maybeString) {
+                continue;
+            }
+            auto newId = newIds.find(ReadOperandValue(bytecode, pc, operand, encoding));
+            if (newId == newIds.end()) {
+                continue;
+            }
+            if (maybeString) {
+                return false;
+            }
+
+            size_t offset = pc + operand.Offset;
+            if (reference) {
+                writeInt(offset + 1, newId->second);
+            } else if (encoding == OperandEncoding::Leb128 && IsCompactOperand(operand.Type)) {
+                std::vector<uint8_t> encoded;
+                WriteLeb128(encoded, newId->second);
+                if (encoded.size() != operand.Length) {
+                    return false;  // Everything after it, and the jumps over it, would move
+                }
+                std::copy(encoded.begin(), encoded.end(), bytecode.begin() + static_cast<std::ptrdiff_t>(offset));
+            } else {
+                writeInt(offset, newId->second);
+            }
+        }
+        pc += instruction.Length;
+    }
+    return true;
+}
+
+void ProcCache::Store(const DMProc& proc, const Entry& entry) {
+    uint64_t key;
+    if (!Key(proc, key)) {
+        return;
+    }
+
+    auto writeOptional = [](BinaryWriter& writer, const std::optional<std::string>& value) {
+        writer.Write<uint8_t>(value.has_value() ? 1 : 0);
+        if (value) {
+            writer.WriteString(*value);
+        }
+    };
+
+    BinaryWriter writer;
+    writer.WriteBytes(CacheMagic, sizeof(CacheMagic));
+    writer.Write<uint32_t>(CacheFormatVersion);
+    writer.Write<uint64_t>(key);
+    writer.WriteString(std::string_view(reinterpret_cast<const char*>(entry.Bytecode.data()), entry.Bytecode.size()));
+    writer.Write<int32_t>(entry.MaxStackSize);
+    writer.Write<uint8_t>(entry.Attributes);
+    writer.Write<uint8_t>(entry.VerbSource.has_value() ? 1 : 0);
+    if (entry.VerbSource) {
+        writer.Write<uint16_t>(*entry.VerbSource);
+    }
+    writeOptional(writer, entry.VerbName);
+    writeOptional(writer, entry.VerbCategory);
+    writeOptional(writer, entry.VerbDescription);
+    writer.Write<int8_t>(entry.Invisibility);
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(entry.SetAttributes.size()));
+    for (const auto& [attribute, value] : entry.SetAttributes) {
+        writer.WriteString(attribute);
+        writer.WriteString(value);
+    }
+    writer.Write<uint32_t>(static_cast<uint32_t>(entry.Strings.size()));
+    for (const auto& [value, id] : entry.Strings) {
+        writer.WriteString(value);
+        writer.Write<int32_t>(id);
+    }
+    writer.Write<uint32_t>(static_cast<uint32_t>(entry.Resources.size()));
+    for (const auto& resource : entry.Resources) {
+        writer.WriteString(resource);
+    }
+    writer.WriteChecksum();
+
+    // One entry per proc, replaced when it changes, so the directory does not grow with every edit
+    if (WriteBinaryFileAtomic(EntryPath(HashName(proc)), writer.Data())) {
+        Stored_++;
+    }
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,97 @@
+#include "ProcProfile.h"
+#include "DMObject.h"
+#include "DMObjectTree.h"
+#include "DMProc.h"
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <unordered_set>
+#include <nlohmann/json.hpp>
+
+namespace DMCompiler {
+
+namespace {
+
+std::string SampleKey(const std::string& type, const std::string& name) {
+    return type + '\n' + name;
+}
+
+std::string ProcKey(const DMProc& proc) {
+    return SampleKey(proc.OwningObject ? proc.OwningObject->Path.ToString() : "/", proc.Name);
+}
+
+} // namespace
+
+std::unique_ptr<ProcProfile> ProcProfile::Load(const std::string& path, std::string& error) {
+    std::string data;
+    if (!ReadBinaryFile(path, data)) {
+        error = "Failed to read profile data: " + path;
+        return nullptr;
+    }
+    auto json = nlohmann::json::parse(data, nullptr, false);
+    if (!json.is_object() || !json.contains("Procs") || !json["Procs"].is_array()) {
+        error = "Profile data has no \"Procs\" array: " + path;
+        return nullptr;
+    }
+
+    auto profile = std::make_unique<ProcProfile>();
+    for (const auto& entry : json["Procs"]) {
+        if (!entry.is_object() || !entry.contains("Type") || !entry.contains("Name") || !entry["Type"].is_string() ||
+            !entry["Name"].is_string()) {
+            continue;
+        }
+        // The same proc listed twice, say from two runs, counts as both
+        Sample& sample = profile->Samples_[SampleKey(entry["Type"].get<std::string>(), entry["Name"].get<std::string>())];
+        if (entry.contains("Calls") && entry["Calls"].is_number_unsigned()) {
+            sample.Calls += entry["Calls"].get<uint64_t>();
+        }
+        if (entry.contains("Time") && entry["Time"].is_number() && entry["Time"].get<double>() > 0) {
+            sample.Time += entry["Time"].get<double>();
+            profile->Timed_ = true;
+        }
+    }
+    return profile;
+}
+
+void ProcProfile::Classify(DMObjectTree& tree) {
+    std::vector<std::pair<double, const std::string*>> ranked;
+    double total = 0;
+    for (const auto& [key, sample] : Samples_) {
+        if (Weigh(sample) > 0) {
+            ranked.emplace_back(Weigh(sample), &key);
+            total += Weigh(sample);
+        }
+    }
+    std::sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) {
+        return a.first != b.first ? a.first > b.first : *a.second < *b.second;
+    });
+
+    std::unordered_set<std::string> hot;
+    double covered = 0;
+    for (size_t i = 0; i < ranked.size() && covered < HotShare * total; ++i) {
+        hot.insert(*ranked[i].second);
+        covered += ranked[i].first;
+    }
+
+    HotCount_ = 0;
+    ColdCount_ = 0;
+    for (const auto& proc : tree.AllProcs) {
+        std::string key = ProcKey(*proc);
+        auto sample = Samples_.find(key);
+        if (hot.count(key)) {
+            proc->Temperature = ProcTemperature::Hot;
+            ++HotCount_;
+        } else if (sample == Samples_.end() || (sample->second.Calls == 0 && sample->second.Time <= 0)) {
+            proc->Temperature = ProcTemperature::Cold;
+            ++ColdCount_;
+        } else {
+            proc->Temperature = ProcTemperature::Warm;
+        }
+    }
+}
+
+double ProcProfile::GetWeight(const DMProc& proc) const {
+    auto sample = Samples_.find(ProcKey(proc));
+    return sample != Samples_.end() ? Weigh(sample->second) : 0;
+}
+
+} // namespace DMCompiler
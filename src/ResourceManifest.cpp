@@ -0,0 +1,264 @@
+#include "ResourceManifest.h"
+#include "JsonWriter.h"
+#include "SourceBuffer.h"
+#include "TokenSerialization.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ull;
+constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4Full;
+constexpr uint64_t Prime3 = 0x165667B19E3779F9ull;
+constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ull;
+constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ull;
+
+uint64_t RotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+// XXH64 reads its input as little-endian words
+uint64_t Read64(const unsigned char* p) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+uint32_t Read32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+           static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+}
+
+uint64_t Round(uint64_t acc, uint64_t input) {
+    acc += input * Prime2;
+    acc = RotateLeft(acc, 31);
+    return acc * Prime1;
+}
+
+uint64_t MergeRound(uint64_t acc, uint64_t value) {
+    acc ^= Round(0, value);
+    return acc * Prime1 + Prime4;
+}
+
+std::string HashToString(uint64_t hash) {
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+// What an earlier manifest said about a file
+struct PreviousEntry {
+    uint64_t Size;
+    int64_t ModifiedTime;
+    uint64_t Hash;
+};
+
+std::unordered_map<std::string, PreviousEntry> ReadPrevious(const std::string& path) {
+    std::unordered_map<std::string, PreviousEntry> previous;
+    std::string data;
+    if (path.empty() || !ReadBinaryFile(path, data)) {
+        return previous;
+    }
+    auto json = nlohmann::json::parse(data, nullptr, false);
+    if (!json.is_object() || !json.contains("Resources") || !json["Resources"].is_array()) {
+        return previous;
+    }
+    for (const auto& resource : json["Resources"]) {
+        if (!resource.is_object() || !resource.contains("File") || !resource.contains("Size") ||
+            !resource.contains("ModifiedTime") || !resource.contains("Hash") || !resource["Hash"].is_string()) {
+            continue;
+        }
+        const auto& file = resource["File"];
+        const auto& size = resource["Size"];
+        const auto& modifiedTime = resource["ModifiedTime"];
+        if (!file.is_string() || !size.is_number_integer() || !modifiedTime.is_number_integer()) {
+            continue;
+        }
+        PreviousEntry entry{size.get<uint64_t>(), modifiedTime.get<int64_t>(), 0};
+        std::string hash = resource["Hash"].get<std::string>();
+        char* end = nullptr;
+        entry.Hash = std::strtoull(hash.c_str(), &end, 16);
+        if (hash.size() == 16 && end == hash.c_str() + hash.size()) {
+            previous.emplace(file.get<std::string>(), entry);
+        }
+    }
+    return previous;
+}
+
+} // namespace
+
+uint64_t ResourceManifest::Hash(std::string_view data) {
+    const auto* p = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = p + data.size();
+    uint64_t hash;
+
+    if (data.size() >= 32) {
+        uint64_t v1 = Prime1 + Prime2;
+        uint64_t v2 = Prime2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - Prime1;
+        for (; end - p >= 32; p += 32) {
+            v1 = Round(v1, Read64(p));
+            v2 = Round(v2, Read64(p + 8));
+            v3 = Round(v3, Read64(p + 16));
+            v4 = Round(v4, Read64(p + 24));
+        }
+        hash = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+        hash = MergeRound(hash, v1);
+        hash = MergeRound(hash, v2);
+        hash = MergeRound(hash, v3);
+        hash = MergeRound(hash, v4);
+    } else {
+        hash = Prime5;
+    }
+    hash += data.size();
+
+    for (; end - p >= 8; p += 8) {
+        hash ^= Round(0, Read64(p));
+        hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+    }
+    if (end - p >= 4) {
+        hash ^= Read32(p) * Prime1;
+        hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+        p += 4;
+    }
+    for (; p < end; ++p) {
+        hash ^= *p * Prime5;
+        hash = RotateLeft(hash, 11) * Prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::vector<ResourceManifest::Entry> ResourceManifest::Build(const std::vector<std::string>& resources,
+                                                             const std::vector<std::string>& searchDirs,
+                                                             const std::string& previousPath, unsigned threadCount,
+                                                             size_t& hashedCount, ResourceHashIndex* hashes) {
+    const auto previous = ReadPrevious(previousPath);
+    std::vector<Entry> entries(resources.size());
+    std::atomic<size_t> hashed{0};
+
+    auto resolve = [&](size_t index) {
+        Entry& entry = entries[index];
+        entry.Path = resources[index];
+        for (const auto& dir : searchDirs) {
+            std::error_code ec;
+            fs::path candidate = fs::path(dir) / entry.Path;
+            if (!fs::is_regular_file(candidate, ec)) {
+                continue;
+            }
+            auto size = fs::file_size(candidate, ec);
+            auto modifiedTime = fs::last_write_time(candidate, ec);
+            if (ec) {
+                continue;
+            }
+            entry.File = candidate.lexically_normal().generic_string();
+            entry.Size = size;
+            entry.ModifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+            break;
+        }
+        if (entry.File.empty()) {
+            return;
+        }
+
+        auto it = previous.find(entry.File);
+        if (it != previous.end() && it->second.Size == entry.Size && it->second.ModifiedTime == entry.ModifiedTime) {
+            entry.Hash = it->second.Hash;
+        } else if (!hashes || !hashes->Find(entry.File, entry.Size, entry.ModifiedTime, entry.Hash)) {
+            auto buffer = SourceBuffer::FromFile(entry.File);
+            if (!buffer) {
+                entry.File.clear();
+                return;
+            }
+            entry.Hash = Hash(buffer->View());
+            entry.Size = buffer->Size();
+            hashed.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (hashes) {
+            hashes->Remember(entry);
+        }
+    };
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < entries.size(); i = next.fetch_add(1)) {
+            resolve(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount && i < entries.size(); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    hashedCount = hashed.load();
+    return entries;
+}
+
+bool ResourceManifest::Write(const std::string& path, const std::vector<Entry>& entries) {
+    JsonWriter json;
+    json.BeginObject();
+    json.WriteKey("Resources");
+    json.BeginArray();
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry& entry = entries[i];
+        json.BeginObject();
+        json.WriteKeyValue("Id", static_cast<int>(i + 1));
+        json.WriteKeyValue("Path", entry.Path);
+        if (entry.File.empty()) {
+            json.WriteKeyValue("Missing", true);
+        } else {
+            json.WriteKeyValue("File", entry.File);
+            json.WriteKey("Size");
+            json.WriteInt64(static_cast<int64_t>(entry.Size));
+            json.WriteKey("ModifiedTime");
+            json.WriteInt64(entry.ModifiedTime);
+            json.WriteKeyValue("Hash", HashToString(entry.Hash));
+        }
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+    return WriteBinaryFileAtomic(path, json.ToString());
+}
+
+bool ResourceHashIndex::Find(const std::string& file, uint64_t size, int64_t modifiedTime, uint64_t& hash) const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    auto it = Files_.find(file);
+    if (it == Files_.end() || it->second.Size != size || it->second.ModifiedTime != modifiedTime) {
+        return false;
+    }
+    hash = it->second.Hash;
+    return true;
+}
+
+void ResourceHashIndex::Remember(const ResourceManifest::Entry& entry) {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    Files_[entry.File] = entry;
+}
+
+size_t ResourceHashIndex::Size() const {
+    std::lock_guard<std::mutex> lock(Mutex_);
+    return Files_.size();
+}
+
+} // namespace DMCompiler
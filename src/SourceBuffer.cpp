@@ -0,0 +1,115 @@
+#include "SourceBuffer.h"
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace DMCompiler {
+
+SourceBuffer::~SourceBuffer() {
+#ifdef _WIN32
+    if (Mapping_) {
+        UnmapViewOfFile(Mapping_);
+    }
+    if (MappingHandle_) {
+        CloseHandle(static_cast<HANDLE>(MappingHandle_));
+    }
+    if (FileHandle_) {
+        CloseHandle(static_cast<HANDLE>(FileHandle_));
+    }
+#else
+    if (Mapping_) {
+        munmap(Mapping_, Size_);
+    }
+#endif
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::FromString(std::string content) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+    buffer->Owned_ = std::move(content);
+    buffer->Data_ = buffer->Owned_.data();
+    buffer->Size_ = buffer->Owned_.size();
+    return buffer;
+}
+
+std::shared_ptr<const SourceBuffer> SourceBuffer::FromFile(const std::string& path) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer());
+
+#ifdef _WIN32
+    std::wstring widePath(path.begin(), path.end());
+    HANDLE file = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER size;
+        if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+            HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+                if (view) {
+                    buffer->FileHandle_ = file;
+                    buffer->MappingHandle_ = mapping;
+                    buffer->Mapping_ = view;
+                    buffer->Data_ = static_cast<const char*>(view);
+                    buffer->Size_ = static_cast<size_t>(size.QuadPart);
+                    return buffer;
+                }
+                CloseHandle(mapping);
+            }
+        } else if (GetFileSizeEx(file, &size) && size.QuadPart == 0) {
+            // Empty files cannot be mapped; an empty owned buffer is equivalent
+            CloseHandle(file);
+            return buffer;
+        }
+        CloseHandle(file);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (st.st_size == 0) {
+                // Empty files cannot be mapped; an empty owned buffer is equivalent
+                close(fd);
+                return buffer;
+            }
+            void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (view != MAP_FAILED) {
+                // The mapping keeps the file referenced; the descriptor is no longer needed
+                close(fd);
+#ifdef MADV_SEQUENTIAL
+                madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+                buffer->Mapping_ = view;
+                buffer->Data_ = static_cast<const char*>(view);
+                buffer->Size_ = static_cast<size_t>(st.st_size);
+                return buffer;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    // Fall back to a plain read (special files, mapping failures, exotic filesystems)
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return nullptr;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    buffer->Owned_ = contents.str();
+    buffer->Data_ = buffer->Owned_.data();
+    buffer->Size_ = buffer->Owned_.size();
+    return buffer;
+}
+
+} // namespace DMCompiler
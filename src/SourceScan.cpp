@@ -0,0 +1,190 @@
+#include "SourceScan.h"
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DM_SCAN_AVX2 1
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define DM_SCAN_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define DM_SCAN_NEON 1
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace DMCompiler {
+
+ByteSet::ByteSet(std::initializer_list<char> bytes) {
+    for (char c : bytes) {
+        if (Count_ == MaxBytes) {
+            break;
+        }
+        Bytes_[Count_++] = c;
+    }
+}
+
+bool ByteSet::Contains(char c) const {
+    for (size_t i = 0; i < Count_; ++i) {
+        if (Bytes_[i] == c) {
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace SourceScan {
+
+#if defined(DM_SCAN_AVX2) || defined(DM_SCAN_SSE2) || defined(DM_SCAN_NEON)
+static inline unsigned CountTrailingZeros(uint64_t mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#endif
+}
+#endif
+
+#if defined(DM_SCAN_AVX2)
+
+static constexpr size_t BlockSize = 32;
+static constexpr unsigned BitsPerByte = 1;
+
+// One bit per byte of the block, set where the byte is in the set
+static inline uint64_t MatchMask(const char* block, const __m256i* needles, size_t count) {
+    __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+    __m256i matches = _mm256_setzero_si256();
+    for (size_t i = 0; i < count; ++i) {
+        matches = _mm256_or_si256(matches, _mm256_cmpeq_epi8(data, needles[i]));
+    }
+    return static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+}
+
+#define DM_SCAN_BROADCAST(needles, set) \
+    __m256i needles[ByteSet::MaxBytes]; \
+    for (size_t i = 0; i < (set).Count(); ++i) needles[i] = _mm256_set1_epi8((set).Bytes()[i])
+
+static constexpr uint64_t FullMask = 0xFFFFFFFFull;
+
+#elif defined(DM_SCAN_SSE2)
+
+static constexpr size_t BlockSize = 16;
+static constexpr unsigned BitsPerByte = 1;
+
+static inline uint64_t MatchMask(const char* block, const __m128i* needles, size_t count) {
+    __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+    __m128i matches = _mm_setzero_si128();
+    for (size_t i = 0; i < count; ++i) {
+        matches = _mm_or_si128(matches, _mm_cmpeq_epi8(data, needles[i]));
+    }
+    return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+}
+
+#define DM_SCAN_BROADCAST(needles, set) \
+    __m128i needles[ByteSet::MaxBytes]; \
+    for (size_t i = 0; i < (set).Count(); ++i) needles[i] = _mm_set1_epi8((set).Bytes()[i])
+
+static constexpr uint64_t FullMask = 0xFFFFull;
+
+#elif defined(DM_SCAN_NEON)
+
+static constexpr size_t BlockSize = 16;
+// NEON has no movemask; narrowing the compare result leaves four bits per byte
+static constexpr unsigned BitsPerByte = 4;
+
+static inline uint64_t MatchMask(const char* block, const uint8x16_t* needles, size_t count) {
+    uint8x16_t data = vld1q_u8(reinterpret_cast<const uint8_t*>(block));
+    uint8x16_t matches = vdupq_n_u8(0);
+    for (size_t i = 0; i < count; ++i) {
+        matches = vorrq_u8(matches, vceqq_u8(data, needles[i]));
+    }
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(matches), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+#define DM_SCAN_BROADCAST(needles, set) \
+    uint8x16_t needles[ByteSet::MaxBytes]; \
+    for (size_t i = 0; i < (set).Count(); ++i) needles[i] = vdupq_n_u8(static_cast<uint8_t>((set).Bytes()[i]))
+
+static constexpr uint64_t FullMask = ~0ull;
+
+#endif
+
+size_t FindFirstOf(std::string_view text, size_t begin, const ByteSet& set) {
+    const char* data = text.data();
+    size_t size = text.size();
+    size_t i = begin;
+
+#ifdef DM_SCAN_BROADCAST
+    if (i + BlockSize <= size) {
+        DM_SCAN_BROADCAST(needles, set);
+        for (; i + BlockSize <= size; i += BlockSize) {
+            uint64_t mask = MatchMask(data + i, needles, set.Count());
+            if (mask != 0) {
+                return i + CountTrailingZeros(mask) / BitsPerByte;
+            }
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (set.Contains(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+size_t FindFirstNotOf(std::string_view text, size_t begin, const ByteSet& set) {
+    const char* data = text.data();
+    size_t size = text.size();
+    size_t i = begin;
+
+    // Runs are usually a byte or two (spaces between tokens); check a few before
+    // paying for the broadcast
+    for (size_t lead = 0; lead < 4 && i < size; ++lead, ++i) {
+        if (!set.Contains(data[i])) {
+            return i;
+        }
+    }
+
+#ifdef DM_SCAN_BROADCAST
+    if (i + BlockSize <= size) {
+        DM_SCAN_BROADCAST(needles, set);
+        for (; i + BlockSize <= size; i += BlockSize) {
+            uint64_t mask = ~MatchMask(data + i, needles, set.Count()) & FullMask;
+            if (mask != 0) {
+                return i + CountTrailingZeros(mask) / BitsPerByte;
+            }
+        }
+    }
+#endif
+
+    for (; i < size; ++i) {
+        if (!set.Contains(data[i])) {
+            return i;
+        }
+    }
+    return size;
+}
+
+const char* ImplementationName() {
+#if defined(DM_SCAN_AVX2)
+    return "avx2";
+#elif defined(DM_SCAN_SSE2)
+    return "sse2";
+#elif defined(DM_SCAN_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+} // namespace SourceScan
+
+} // namespace DMCompiler
@@ -0,0 +1,279 @@
+#include "StackDepthAnalysis.h"
+#include "DMReference.h"
+#include "OpcodeDefinitions.h"
+#include "OperandEncoding.h"
+#include <algorithm>
+#include <unordered_map>
+
+namespace DMCompiler {
+
+namespace {
+
+// ..() calls are written with this type byte
+constexpr uint8_t SuperProcReferenceType = 7;
+
+// Where an instruction's operands sit in its bytes
+struct DecodedOperands {
+    struct Reference {
+        uint8_t Type;
+        size_t Length;  // Type byte included
+    };
+    std::vector<Reference> References;
+    std::optional<int32_t> Count;  // A count-taking opcode's count
+    std::optional<uint8_t> ArgumentsType;
+};
+
+bool IsCountOperand(OpcodeArgType type) {
+    switch (type) {
+        case OpcodeArgType::StackDelta:
+        case OpcodeArgType::FormatCount:
+        case OpcodeArgType::ListSize:
+        case OpcodeArgType::PickCount:
+        case OpcodeArgType::ConcatCount:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Values a reference takes off the stack when it is resolved: a field needs
+// its object and an index its list and key
+std::optional<int> ReferencePops(const DecodedOperands::Reference& reference) {
+    switch (reference.Length) {
+        case 1:
+            if (reference.Type == static_cast<uint8_t>(DMReference::Type::ListIndex)) {
+                return 2;
+            }
+            if (reference.Type <= static_cast<uint8_t>(DMReference::Type::SuperProc) ||
+                reference.Type == static_cast<uint8_t>(DMReference::Type::Callee) ||
+                reference.Type == static_cast<uint8_t>(DMReference::Type::Caller)) {
+                return 0;
+            }
+            return std::nullopt;
+        case 2:
+            if (ReferenceLength(reference.Type) == 2) {
+                return 0;
+            }
+            return std::nullopt;
+        case 5:
+            if (reference.Type == static_cast<uint8_t>(DMReference::Type::Field)) {
+                return 1;
+            }
+            if (ReferenceLength(reference.Type) == 5) {
+                return 0;
+            }
+            return std::nullopt;
+        default:
+            return std::nullopt;
+    }
+}
+
+int32_t ReadInt(const std::vector<uint8_t>& bytes, size_t offset) {
+    return static_cast<int32_t>(static_cast<uint32_t>(bytes[offset]) |
+                                (static_cast<uint32_t>(bytes[offset + 1]) << 8) |
+                                (static_cast<uint32_t>(bytes[offset + 2]) << 16) |
+                                (static_cast<uint32_t>(bytes[offset + 3]) << 24));
+}
+
+// What an instruction's operands say about the stack
+std::optional<DecodedOperands> DecodeOperands(const BytecodeInstruction& instruction) {
+    auto spans = SplitOperands(instruction);
+    if (!spans) {
+        return std::nullopt;
+    }
+    const std::vector<uint8_t>& bytes = instruction.Bytes;
+    DecodedOperands operands;
+    for (const OperandSpan& span : *spans) {
+        if (span.Type == OpcodeArgType::Reference) {
+            operands.References.push_back({bytes[span.Offset], span.Length});
+        } else if (span.Type == OpcodeArgType::ArgType) {
+            operands.ArgumentsType = bytes[span.Offset];
+        } else if (IsCountOperand(span.Type)) {
+            operands.Count = ReadInt(bytes, span.Offset);
+        }
+    }
+    return operands;
+}
+
+// Values a call takes for its arguments
+std::optional<int> ArgumentPops(const DecodedOperands& operands) {
+    if (!operands.Count || !operands.ArgumentsType || *operands.Count < 0) {
+        return std::nullopt;
+    }
+    switch (static_cast<DMCallArgumentsType>(*operands.ArgumentsType)) {
+        case DMCallArgumentsType::None:
+        case DMCallArgumentsType::FromStack:
+            return *operands.Count;
+        default:
+            // Keyed arguments take a value and a key each, but the count has
+            // the keys once; the other types leave the count to the runtime
+            return std::nullopt;
+    }
+}
+
+// ..() is written with a SuperProc reference the table does not list.
+// Without one the target is on the stack, under a call()'s own arguments.
+std::optional<int> CallStatementEffect(const BytecodeInstruction& instruction) {
+    const std::vector<uint8_t>& bytes = instruction.Bytes;
+    if (bytes.size() != 7 || bytes[1] != SuperProcReferenceType) {
+        return std::nullopt;
+    }
+    DecodedOperands operands;
+    operands.ArgumentsType = bytes[2];
+    operands.Count = ReadInt(bytes, 3);
+    auto arguments = ArgumentPops(operands);
+    return arguments ? std::optional<int>(1 - *arguments) : std::nullopt;
+}
+
+} // namespace
+
+std::optional<int> StackDepthAnalysis::StackEffect(const BytecodeInstruction& instruction) {
+    if (!HasOpcodeMetadata(instruction.Opcode)) {
+        return std::nullopt;
+    }
+    switch (instruction.Opcode) {
+        case DreamProcOpcode::CallStatement:
+            return CallStatementEffect(instruction);
+        // Written right after the opcode, in forms the table does not list
+        case DreamProcOpcode::PushNRefs:
+        case DreamProcOpcode::PushNFloats:
+        case DreamProcOpcode::PushNResources:
+        case DreamProcOpcode::PushNStrings:
+        case DreamProcOpcode::PushNOfStringFloats:
+        case DreamProcOpcode::CreateListNFloats:
+        case DreamProcOpcode::CreateListNStrings:
+        case DreamProcOpcode::CreateListNRefs:
+        case DreamProcOpcode::CreateListNResources:
+        case DreamProcOpcode::NPushFloatAssign:
+            return std::nullopt;
+        default:
+            break;
+    }
+
+    auto operands = DecodeOperands(instruction);
+    if (!operands) {
+        return std::nullopt;
+    }
+    int effect = GetOpcodeMetadata(instruction.Opcode).StackDelta;
+    for (const auto& reference : operands->References) {
+        auto pops = ReferencePops(reference);
+        if (!pops) {
+            return std::nullopt;
+        }
+        effect -= *pops;
+    }
+    if (!operands->Count) {
+        return effect;
+    }
+
+    int count = *operands->Count;
+    if (count < 0) {
+        return std::nullopt;
+    }
+    switch (instruction.Opcode) {
+        case DreamProcOpcode::CreateList:
+        case DreamProcOpcode::CreateMultidimensionalList:
+        case DreamProcOpcode::FormatString:
+        case DreamProcOpcode::PickUnweighted:
+        case DreamProcOpcode::MassConcatenation:
+            return effect + 1 - count;
+        case DreamProcOpcode::CreateAssociativeList:
+        case DreamProcOpcode::CreateStrictAssociativeList:
+        case DreamProcOpcode::PickWeighted:
+            return effect + 1 - 2 * count;
+        case DreamProcOpcode::Call:
+        case DreamProcOpcode::Rgb:
+        case DreamProcOpcode::Gradient: {
+            auto arguments = ArgumentPops(*operands);
+            return arguments ? std::optional<int>(effect + 1 - *arguments) : std::nullopt;
+        }
+        case DreamProcOpcode::DereferenceCall:
+        case DreamProcOpcode::CreateObject: {
+            // The object or type below the arguments is replaced by the result
+            auto arguments = ArgumentPops(*operands);
+            return arguments ? std::optional<int>(effect - *arguments) : std::nullopt;
+        }
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<int> StackDepthAnalysis::JumpStackEffect(const BytecodeInstruction& instruction) {
+    auto effect = StackEffect(instruction);
+    if (!effect) {
+        return std::nullopt;
+    }
+    switch (instruction.Opcode) {
+        // Jump with the value they tested, which falling through pops or assigns
+        case DreamProcOpcode::BooleanAnd:
+        case DreamProcOpcode::BooleanOr:
+        case DreamProcOpcode::JumpIfTrueReference:
+        case DreamProcOpcode::JumpIfFalseReference:
+            return *effect + 1;
+        default:
+            return effect;
+    }
+}
+
+StackDepthAnalysis::StackDepthAnalysis(const std::vector<BytecodeInstruction>& instructions)
+    : Depths_(instructions.size(), -1) {
+    if (instructions.empty()) {
+        MaxDepth_ = 0;
+        return;
+    }
+
+    std::unordered_map<int, size_t> labelIndices;
+    for (size_t i = 0; i < instructions.size(); ++i) {
+        for (int label : instructions[i].Labels) {
+            labelIndices[label] = i;
+        }
+    }
+
+    int maxDepth = 0;
+    std::vector<size_t> worklist{0};
+    Depths_[0] = 0;
+    // Falling or jumping past the last instruction returns, so only the
+    // depth itself counts there
+    auto reach = [&](size_t target, int depth) {
+        if (depth < 0) {
+            return false;
+        }
+        maxDepth = std::max(maxDepth, depth);
+        if (target >= Depths_.size()) {
+            return true;
+        }
+        if (Depths_[target] < 0) {
+            Depths_[target] = depth;
+            worklist.push_back(target);
+            return true;
+        }
+        return Depths_[target] == depth;
+    };
+
+    while (!worklist.empty()) {
+        size_t i = worklist.back();
+        worklist.pop_back();
+        const BytecodeInstruction& instruction = instructions[i];
+        int depth = Depths_[i];
+
+        bool consistent = true;
+        int effect = StackEffect(instruction).value_or(instruction.StackDelta);
+        if (!ControlFlowGraph::EndsFlow(instruction.Opcode)) {
+            consistent = reach(i + 1, depth + effect);
+        } else {
+            consistent = depth + effect >= 0;
+        }
+        if (consistent && instruction.JumpLabel >= 0) {
+            auto it = labelIndices.find(instruction.JumpLabel);
+            int jumpEffect = JumpStackEffect(instruction).value_or(instruction.StackDelta);
+            consistent = reach(it != labelIndices.end() ? it->second : instructions.size(), depth + jumpEffect);
+        }
+        if (!consistent) {
+            FailedAt_ = i;
+            return;
+        }
+    }
+    MaxDepth_ = maxDepth;
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,73 @@
+#include "TokenBuffer.h"
+
+namespace DMCompiler {
+
+StringInterner::StringInterner() {
+    // Reserve ID 0 for the empty string so default tokens need no lookup
+    Intern("");
+}
+
+uint32_t StringInterner::Intern(std::string_view text) {
+    auto it = Ids_.find(text);
+    if (it != Ids_.end()) {
+        return it->second;
+    }
+
+    const std::string& stored = Storage_.emplace_back(text);
+    std::string_view view(stored);
+    uint32_t id = static_cast<uint32_t>(Views_.size());
+    Views_.push_back(view);
+    Ids_.emplace(view, id);
+    return id;
+}
+
+void TokenBuffer::Push(const Token& token) {
+    CompactToken compact;
+    compact.Type = token.Type;
+    compact.ValueType = token.Value.ValueType;
+    compact.InDMStandard = token.Loc.InDMStandard;
+    compact.TextId = Strings_.Intern(token.Text);
+    compact.StringValueId = token.Value.ValueType == Token::TokenValue::Type::String
+        ? Strings_.Intern(token.Value.StringValue)
+        : StringInterner::EmptyId;
+    compact.FileId = token.Loc.FileId;
+    compact.Line = token.Loc.Line;
+    compact.Column = token.Loc.Column;
+    if (token.Value.ValueType == Token::TokenValue::Type::Float) {
+        compact.FloatValue = token.Value.FloatValue;
+    } else {
+        compact.IntValue = token.Value.IntValue;
+    }
+    Tokens_.push_back(compact);
+}
+
+void TokenBuffer::Append(const std::vector<Token>& tokens) {
+    Tokens_.reserve(Tokens_.size() + tokens.size());
+    for (const auto& token : tokens) {
+        Push(token);
+    }
+}
+
+Token TokenBuffer::Get(size_t index) const {
+    const CompactToken& compact = Tokens_[index];
+
+    Token::TokenValue value;
+    switch (compact.ValueType) {
+        case Token::TokenValue::Type::Int:
+            value = Token::TokenValue(compact.IntValue);
+            break;
+        case Token::TokenValue::Type::Float:
+            value = Token::TokenValue(compact.FloatValue);
+            break;
+        case Token::TokenValue::Type::String:
+            value = Token::TokenValue(std::string(Strings_.Get(compact.StringValueId)));
+            break;
+        case Token::TokenValue::Type::None:
+            break;
+    }
+
+    Location loc(compact.FileId, compact.Line, compact.Column, compact.InDMStandard);
+    return Token(compact.Type, std::string(Strings_.Get(compact.TextId)), loc, value);
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,115 @@
+#include "TokenCache.h"
+#include "DMConstants.h"
+#include "TokenSerialization.h"
+#include <cstdio>
+#include <exception>
+#include <filesystem>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+static constexpr char CacheMagic[4] = {'D', 'M', 'T', 'C'};
+static constexpr uint32_t CacheFormatVersion = 3;
+
+TokenCache::TokenCache(std::string directory, bool keepInMemory)
+    : Directory_(std::move(directory))
+    , KeepInMemory_(keepInMemory)
+{
+    std::error_code ec;
+    fs::create_directories(Directory_, ec);
+}
+
+uint64_t TokenCache::HashContent(std::string_view content) {
+    return HashBytes(content);
+}
+
+std::string TokenCache::EntryPath(uint64_t hash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tok", static_cast<unsigned long long>(hash));
+    return (fs::path(Directory_) / name).string();
+}
+
+size_t TokenCache::MemoryEntries() const {
+    std::lock_guard<std::mutex> lock(MemoryMutex_);
+    return Memory_.size();
+}
+
+void TokenCache::Remember(uint64_t hash, std::shared_ptr<const std::vector<Token>> tokens) const {
+    std::lock_guard<std::mutex> lock(MemoryMutex_);
+    Memory_.emplace(hash, std::move(tokens));
+}
+
+std::shared_ptr<std::vector<Token>> TokenCache::Load(const std::string& sourcePath, std::string_view content) const {
+    uint64_t hash = HashContent(content);
+    uint32_t fileId = SourceFileRegistry::Register(sourcePath);
+    if (KeepInMemory_) {
+        std::shared_ptr<const std::vector<Token>> remembered;
+        {
+            std::lock_guard<std::mutex> lock(MemoryMutex_);
+            auto it = Memory_.find(hash);
+            if (it != Memory_.end()) {
+                remembered = it->second;
+            }
+        }
+        // The same text may be included under another path, so the copy gets this one
+        if (remembered) {
+            auto tokens = std::make_shared<std::vector<Token>>(*remembered);
+            for (Token& token : *tokens) {
+                token.Loc.FileId = fileId;
+            }
+            return tokens;
+        }
+    }
+
+    // A damaged entry is a miss, whatever it fails with: the file is lexed again
+    try {
+        std::string data;
+        if (!ReadBinaryFile(EntryPath(hash), data)) {
+            return nullptr;
+        }
+
+        BinaryReader reader(data);
+        if (!reader.VerifyChecksum() ||
+            !reader.Expect(CacheMagic, sizeof(CacheMagic)) ||
+            reader.Read<uint32_t>() != CacheFormatVersion ||
+            reader.Read<uint32_t>() != static_cast<uint32_t>(Versions::LEXER_VERSION) ||
+            reader.Read<uint64_t>() != content.size() ||
+            reader.Read<uint64_t>() != hash) {
+            return nullptr;
+        }
+
+        auto tokens = std::make_shared<std::vector<Token>>();
+        if (!ReadTokens(reader, *tokens, false, fileId)) {
+            return nullptr;
+        }
+        if (KeepInMemory_) {
+            Remember(hash, std::make_shared<const std::vector<Token>>(*tokens));
+        }
+        return tokens;
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void TokenCache::Store(std::string_view content, const std::vector<Token>& tokens) const {
+    uint64_t hash = HashContent(content);
+    if (KeepInMemory_) {
+        Remember(hash, std::make_shared<const std::vector<Token>>(tokens));
+    }
+
+    BinaryWriter writer;
+    writer.Reserve(64 + tokens.size() * 16);
+    writer.WriteBytes(CacheMagic, sizeof(CacheMagic));
+    writer.Write<uint32_t>(CacheFormatVersion);
+    writer.Write<uint32_t>(static_cast<uint32_t>(Versions::LEXER_VERSION));
+    writer.Write<uint64_t>(content.size());
+    writer.Write<uint64_t>(hash);
+    WriteTokens(writer, tokens, false);
+    writer.WriteChecksum();
+
+    // Written through a temporary, so concurrent compilers never see a partial entry
+    WriteBinaryFileAtomic(EntryPath(hash), writer.Data());
+}
+
+} // namespace DMCompiler
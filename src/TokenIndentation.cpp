@@ -0,0 +1,103 @@
+#include "TokenIndentation.h"
+#include "TokenStreamDMLexer.h"
+#include <algorithm>
+
+namespace DMCompiler {
+
+// A token carrying no text or value, placed at another token's location
+static CompactToken MakeMarker(TokenType type, const CompactToken& at) {
+    CompactToken marker = at;
+    marker.Type = type;
+    marker.ValueType = Token::TokenValue::Type::None;
+    marker.TextId = StringInterner::EmptyId;
+    marker.StringValueId = StringInterner::EmptyId;
+    marker.IntValue = 0;
+    return marker;
+}
+
+void ResolveIndentation(TokenBuffer& tokens) {
+    if (tokens.IndentationResolved()) {
+        return;
+    }
+
+    std::vector<CompactToken> resolved;
+    resolved.reserve(tokens.size() + tokens.size() / 8);
+
+    // The streaming lexer places synthesized tokens at the location of the
+    // token before the one it just consumed, starting from its own start
+    Location start(TokenStreamDMLexer::SourceName, 1, 0);
+    CompactToken previous = MakeMarker(TokenType::Unknown, CompactToken{});
+    previous.FileId = start.FileId;
+    previous.Line = start.Line;
+    previous.Column = start.Column;
+    previous.InDMStandard = start.InDMStandard;
+    CompactToken current = previous;
+
+    std::vector<int> indentation{0};
+    int bracketNesting = 0;
+
+    size_t i = 0;
+    while (i < tokens.size()) {
+        const CompactToken& token = tokens.At(i++);
+        previous = current;
+        current = token;
+
+        switch (token.Type) {
+            case TokenType::Newline: {
+                if (bracketNesting > 0) {
+                    // Indentation is not tracked inside brackets
+                    resolved.push_back(token);
+                    break;
+                }
+
+                int level = 0;
+                if (i < tokens.size() && tokens.TypeAt(i) == TokenType::DM_Preproc_Whitespace) {
+                    level = static_cast<int>(tokens.TextAt(i).length());
+                    ++i;
+                }
+
+                if (level > indentation.back()) {
+                    indentation.push_back(level);
+                    resolved.push_back(MakeMarker(TokenType::Indent, previous));
+                    resolved.push_back(token);
+                } else {
+                    resolved.push_back(token);
+                    while (indentation.back() > level) {
+                        indentation.pop_back();
+                        resolved.push_back(MakeMarker(TokenType::Dedent, previous));
+                    }
+                }
+                break;
+            }
+            case TokenType::DM_Preproc_Punctuator_LeftParenthesis:
+            case TokenType::DM_Preproc_Punctuator_LeftBracket:
+            case TokenType::LeftParenthesis:
+            case TokenType::LeftBracket:
+                bracketNesting++;
+                resolved.push_back(token);
+                break;
+            case TokenType::DM_Preproc_Punctuator_RightParenthesis:
+            case TokenType::DM_Preproc_Punctuator_RightBracket:
+            case TokenType::RightParenthesis:
+            case TokenType::RightBracket:
+                bracketNesting = std::max(bracketNesting - 1, 0);
+                resolved.push_back(token);
+                break;
+            case TokenType::DM_Preproc_Whitespace:
+                break;
+            default:
+                resolved.push_back(token);
+                break;
+        }
+    }
+
+    while (indentation.back() > 0) {
+        indentation.pop_back();
+        resolved.push_back(MakeMarker(TokenType::Dedent, previous));
+    }
+    resolved.push_back(MakeMarker(TokenType::EndOfFile, previous));
+
+    tokens.Replace(std::move(resolved), true);
+}
+
+} // namespace DMCompiler
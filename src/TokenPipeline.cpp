@@ -0,0 +1,152 @@
+#include "TokenPipeline.h"
+#include "DMCompiler.h"
+#include "DMPreprocessor.h"
+#include "DMLexer.h"
+#include "DMConstants.h"
+#include <algorithm>
+#include <iostream>
+
+namespace DMCompiler {
+
+TokenRingBuffer::TokenRingBuffer(size_t capacity)
+    : Slots_(std::max<size_t>(capacity, 1))
+{
+}
+
+bool TokenRingBuffer::PushBatch(std::vector<Token>& tokens) {
+    size_t next = 0;
+    while (next < tokens.size()) {
+        std::unique_lock<std::mutex> lock(Mutex_);
+        NotFull_.wait(lock, [this] { return Cancelled_ || Count_ < Slots_.size(); });
+        if (Cancelled_) {
+            return false;
+        }
+
+        while (next < tokens.size() && Count_ < Slots_.size()) {
+            Slots_[(Head_ + Count_) % Slots_.size()] = std::move(tokens[next++]);
+            Count_++;
+        }
+        lock.unlock();
+        NotEmpty_.notify_one();
+    }
+    tokens.clear();
+    return true;
+}
+
+bool TokenRingBuffer::PopBatch(std::vector<Token>& out, size_t maxCount) {
+    std::unique_lock<std::mutex> lock(Mutex_);
+    NotEmpty_.wait(lock, [this] { return Closed_ || Cancelled_ || Count_ > 0; });
+    if (Count_ == 0) {
+        return false;
+    }
+
+    size_t count = std::min(Count_, maxCount);
+    for (size_t i = 0; i < count; ++i) {
+        out.push_back(std::move(Slots_[Head_]));
+        Head_ = (Head_ + 1) % Slots_.size();
+    }
+    Count_ -= count;
+    lock.unlock();
+    NotFull_.notify_one();
+    return true;
+}
+
+void TokenRingBuffer::Close() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Closed_ = true;
+    }
+    NotEmpty_.notify_all();
+}
+
+void TokenRingBuffer::Cancel() {
+    {
+        std::lock_guard<std::mutex> lock(Mutex_);
+        Cancelled_ = true;
+    }
+    NotFull_.notify_all();
+    NotEmpty_.notify_all();
+}
+
+PreprocessorPipeline::PreprocessorPipeline(DMCompiler* compiler, std::unique_ptr<DMPreprocessor> preprocessor,
+                                           std::vector<std::string> files, size_t capacity)
+    : Compiler_(compiler)
+    , Preprocessor_(std::move(preprocessor))
+    , Files_(std::move(files))
+    , Stream_(capacity)
+{
+}
+
+PreprocessorPipeline::~PreprocessorPipeline() {
+    Finish();
+}
+
+void PreprocessorPipeline::Start() {
+    Thread_ = std::thread(&PreprocessorPipeline::Run, this);
+}
+
+bool PreprocessorPipeline::Finish() {
+    if (Thread_.joinable()) {
+        // Unblocks the producer if the parser stopped before draining the stream
+        Stream_.Cancel();
+        Thread_.join();
+    }
+    return !Failed_;
+}
+
+void PreprocessorPipeline::Run() {
+    // Hand tokens over in batches to keep lock traffic low
+    const size_t batchSize = 256;
+    std::vector<Token> batch;
+    batch.reserve(batchSize);
+
+    if (!LeadingTokens_.empty()) {
+        TokenCount_ += LeadingTokens_.size();
+        if (!Stream_.PushBatch(LeadingTokens_)) {
+            return;
+        }
+    }
+
+    for (const auto& file : Files_) {
+        try {
+            if (!Preprocessor_->Initialize(file)) {
+                continue;
+            }
+
+            Token token;
+            while (Preprocessor_->ReadOutputToken(token)) {
+                batch.push_back(std::move(token));
+                if (batch.size() < batchSize) {
+                    continue;
+                }
+
+                TokenCount_ += batch.size();
+                if (TokenCount_ > static_cast<size_t>(Limits::MAX_TOKENS)) {
+                    if (Compiler_) {
+                        Compiler_->ForcedError(Location::Internal, "Token limit exceeded (" +
+                            std::to_string(Limits::MAX_TOKENS) + " tokens)");
+                    }
+                    Failed_ = true;
+                    Stream_.Close();
+                    return;
+                }
+                if (!Stream_.PushBatch(batch)) {
+                    return;
+                }
+            }
+        } catch (const std::exception& e) {
+            if (Compiler_) {
+                Compiler_->ForcedError(Location::Internal,
+                    "Error preprocessing " + file + ": " + std::string(e.what()));
+            }
+            Failed_ = true;
+            break;
+        }
+    }
+
+    TokenCount_ += batch.size();
+    Stream_.PushBatch(batch);
+    Stream_.Close();
+}
+
+} // namespace DMCompiler
@@ -0,0 +1,221 @@
+#include "TokenSerialization.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <unordered_map>
+
+namespace DMCompiler {
+
+namespace fs = std::filesystem;
+
+// Set on the value-type byte when the string value is the token text itself
+static constexpr uint8_t ValueIsTextFlag = 0x80;
+// Set on the value-type byte when the location is inside DMStandard
+static constexpr uint8_t InDMStandardFlag = 0x40;
+// Fewest bytes a token takes: type, flags, line, column and text length
+static constexpr size_t MinTokenSize = sizeof(uint16_t) + sizeof(uint8_t) + 3 * sizeof(uint32_t);
+
+void WriteTokens(BinaryWriter& writer, const std::vector<Token>& tokens, bool includeFiles) {
+    // Path table: registry file IDs are per-process, so store the paths themselves
+    std::unordered_map<uint32_t, uint32_t> fileIndices;
+    if (includeFiles) {
+        std::vector<uint32_t> files;
+        for (const auto& token : tokens) {
+            if (fileIndices.emplace(token.Loc.FileId, static_cast<uint32_t>(files.size())).second) {
+                files.push_back(token.Loc.FileId);
+            }
+        }
+        writer.Write<uint32_t>(static_cast<uint32_t>(files.size()));
+        for (uint32_t fileId : files) {
+            writer.WriteString(SourceFileRegistry::GetPath(fileId));
+        }
+    }
+
+    writer.Write<uint32_t>(static_cast<uint32_t>(tokens.size()));
+    for (const auto& token : tokens) {
+        bool valueIsText = token.Value.ValueType == Token::TokenValue::Type::String &&
+                           token.Value.StringValue == token.Text;
+        uint8_t flags = static_cast<uint8_t>(token.Value.ValueType);
+        if (valueIsText) flags |= ValueIsTextFlag;
+        if (token.Loc.InDMStandard) flags |= InDMStandardFlag;
+
+        writer.Write<uint16_t>(static_cast<uint16_t>(token.Type));
+        writer.Write<uint8_t>(flags);
+        if (includeFiles) {
+            writer.Write<uint32_t>(fileIndices[token.Loc.FileId]);
+        }
+        writer.Write<int32_t>(token.Loc.Line);
+        writer.Write<int32_t>(token.Loc.Column);
+        writer.WriteString(token.Text);
+
+        switch (token.Value.ValueType) {
+            case Token::TokenValue::Type::Int:
+                writer.Write<int64_t>(token.Value.IntValue);
+                break;
+            case Token::TokenValue::Type::Float:
+                writer.Write<double>(token.Value.FloatValue);
+                break;
+            case Token::TokenValue::Type::String:
+                if (!valueIsText) {
+                    writer.WriteString(token.Value.StringValue);
+                }
+                break;
+            case Token::TokenValue::Type::None:
+                break;
+        }
+    }
+}
+
+bool ReadTokens(BinaryReader& reader, std::vector<Token>& tokens, bool includeFiles, uint32_t defaultFileId) {
+    // Paths are registered once the whole array has been read, so a rejected file
+    // leaves nothing in the registry; until then tokens hold path indices
+    std::vector<std::string> paths;
+    if (includeFiles) {
+        uint32_t fileCount = reader.ReadCount(sizeof(uint32_t));
+        for (uint32_t i = 0; i < fileCount && reader.Ok(); ++i) {
+            paths.push_back(reader.ReadString());
+        }
+    }
+
+    uint32_t count = reader.ReadCount(MinTokenSize + (includeFiles ? sizeof(uint32_t) : 0));
+    if (!reader.Ok()) {
+        return false;
+    }
+    size_t first = tokens.size();
+    tokens.reserve(first + count);
+
+    for (uint32_t i = 0; i < count && reader.Ok(); ++i) {
+        auto type = static_cast<TokenType>(reader.Read<uint16_t>());
+        uint8_t flags = reader.Read<uint8_t>();
+        uint32_t fileId = defaultFileId;
+        if (includeFiles) {
+            fileId = reader.Read<uint32_t>();
+            if (fileId >= paths.size()) {
+                reader.Fail();
+                break;
+            }
+        }
+        int32_t line = reader.Read<int32_t>();
+        int32_t column = reader.Read<int32_t>();
+        std::string text = reader.ReadString();
+
+        Token::TokenValue value;
+        switch (static_cast<Token::TokenValue::Type>(flags & ~(ValueIsTextFlag | InDMStandardFlag))) {
+            case Token::TokenValue::Type::Int:
+                value = Token::TokenValue(reader.Read<int64_t>());
+                break;
+            case Token::TokenValue::Type::Float:
+                value = Token::TokenValue(reader.Read<double>());
+                break;
+            case Token::TokenValue::Type::String:
+                value = Token::TokenValue((flags & ValueIsTextFlag) ? text : reader.ReadString());
+                break;
+            case Token::TokenValue::Type::None:
+                break;
+            default:
+                reader.Fail();
+                break;
+        }
+
+        tokens.emplace_back(type, std::move(text), Location(fileId, line, column, (flags & InDMStandardFlag) != 0), value);
+    }
+    if (!reader.Ok() || !reader.AtEnd()) {
+        reader.Fail();
+        tokens.erase(tokens.begin() + static_cast<std::ptrdiff_t>(first), tokens.end());
+        return false;
+    }
+
+    if (includeFiles) {
+        std::vector<uint32_t> fileIds;
+        fileIds.reserve(paths.size());
+        for (const auto& path : paths) {
+            fileIds.push_back(SourceFileRegistry::Register(path));
+        }
+        for (size_t i = first; i < tokens.size(); ++i) {
+            tokens[i].Loc.FileId = fileIds[tokens[i].Loc.FileId];
+        }
+    }
+    return true;
+}
+
+bool ReadBinaryFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+bool WriteBinaryFileAtomic(const std::string& path, const std::string& contents) {
+    std::string tempPath = path + ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!file) {
+            file.close();
+            std::error_code ec;
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tempPath, path, ec);
+    if (ec) {
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool PatchBinaryFile(const std::string& path, const std::string& contents, size_t& bytesWritten) {
+    constexpr size_t BlockSize = 4096;
+    bytesWritten = 0;
+    std::string old;
+    if (!ReadBinaryFile(path, old)) {
+        return false;
+    }
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    // Each run of differing blocks is written with one seek and write
+    auto blockDiffers = [&](size_t begin) {
+        size_t length = std::min(BlockSize, contents.size() - begin);
+        return begin + length > old.size() || old.compare(begin, length, contents, begin, length) != 0;
+    };
+    for (size_t begin = 0; begin < contents.size(); begin += BlockSize) {
+        if (!blockDiffers(begin)) {
+            continue;
+        }
+        size_t end = begin + BlockSize;
+        while (end < contents.size() && blockDiffers(end)) {
+            end += BlockSize;
+        }
+        end = std::min(end, contents.size());
+        file.seekp(static_cast<std::streamoff>(begin));
+        file.write(contents.data() + begin, static_cast<std::streamsize>(end - begin));
+        bytesWritten += end - begin;
+        begin = end;
+    }
+    file.close();
+    if (!file) {
+        return false;
+    }
+    
+    std::error_code ec;
+    if (contents.size() < old.size()) {
+        fs::resize_file(path, contents.size(), ec);
+    }
+    return !ec;
+}
+
+} // namespace DMCompiler
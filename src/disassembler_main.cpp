@@ -4,19 +4,32 @@
 #include <vector>
 #include <sstream>
 #include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <thread>
 #include "DMDisassembler.h"
+#include "DisasmServer.h"
 
 // Disassembler main program
 
 void PrintHelp() {
     std::cout << "DM Disassembler for OpenDream (C++ Implementation)" << std::endl;
-    std::cout << "\nUsage: dmdisasm [file].json [command]" << std::endl;
+    std::cout << "\nUsage: dmdisasm [file].json|[file].dmbc|[file].dmz [command]" << std::endl;
+    std::cout << "       dmdisasm diff [old] [new]" << std::endl;
     std::cout << "\nCommands:" << std::endl;
     std::cout << "  crash-on-test  : Test disassembly of entire codebase (for CI)" << std::endl;
     std::cout << "  dump-all       : Dump all types and procs to stdout" << std::endl;
+    std::cout << "  ngrams [N] [top] : Most common runs of N opcodes (default 2, top 20)" << std::endl;
+    std::cout << "  profile [top]  : Opcode counts, largest types and procs, stack sizes, call fan-out" << std::endl;
+    std::cout << "  diff [old] [new] : Bytecode size and instruction changes per proc between two outputs" << std::endl;
+    std::cout << "  callgraph      : Procs unreachable from /world and verbs, recursion, deepest call chain" << std::endl;
+    std::cout << "  callgraph dot|json [path] : Write the call graph as Graphviz DOT or JSON" << std::endl;
+    std::cout << "  serve [socket] : Keep the file loaded, answering JSON line queries on a socket (stdin if none)" << std::endl;
     std::cout << "\nInteractive mode commands:" << std::endl;
     std::cout << "  help           : Show help" << std::endl;
     std::cout << "  search [name]  : Search for types/procs" << std::endl;
+    std::cout << "  strings [text] : Search the string table" << std::endl;
+    std::cout << "  refs [text]    : List procs using strings containing text" << std::endl;
     std::cout << "  select [path]  : Select a type" << std::endl;
     std::cout << "  list           : List procs of selected type" << std::endl;
     std::cout << "  decompile [#]  : Decompile proc" << std::endl;
@@ -31,11 +44,33 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    // Two outputs compared, each loaded as the one-file commands load theirs
+    if (std::string(argv[1]) == "diff") {
+        if (argc < 4) {
+            std::cerr << "Usage: dmdisasm diff [old] [new]" << std::endl;
+            return 1;
+        }
+        DMCompiler::DMDisassembler oldOutput;
+        DMCompiler::DMDisassembler newOutput;
+        for (auto [disassembler, path] : {std::make_pair(&oldOutput, argv[2]), std::make_pair(&newOutput, argv[3])}) {
+            if (!disassembler->Load(path)) {
+                std::cerr << "Error: Failed to load compiled file: " << path << std::endl;
+                return 1;
+            }
+        }
+        oldOutput.Diff(newOutput, std::cout);
+        return 0;
+    }
+    
     std::string jsonFile = argv[1];
     
     // Check file extension
-    if (jsonFile.size() < 5 || jsonFile.substr(jsonFile.size() - 5) != ".json") {
-        std::cerr << "Error: Input file must be a .json file" << std::endl;
+    auto hasExtension = [&](const std::string& extension) {
+        return jsonFile.size() >= extension.size() &&
+               jsonFile.compare(jsonFile.size() - extension.size(), extension.size(), extension) == 0;
+    };
+    if (!hasExtension(".json") && !hasExtension(".dmbc") && !hasExtension(".dmz")) {
+        std::cerr << "Error: Input file must be a .json, .dmbc or .dmz file" << std::endl;
         return 1;
     }
     
@@ -47,21 +82,36 @@ int main(int argc, char** argv) {
     }
     testFile.close();
     
+    // Before the banner, since over stdin and stdout every line is a reply
+    if (argc >= 3 && std::string(argv[2]) == "serve") {
+        DMCompiler::DisasmServer server(jsonFile);
+        if (!server.Load()) {
+            std::cerr << "Error: Failed to load compiled file" << std::endl;
+            return 1;
+        }
+        if (argc < 4) {
+            server.Serve(std::cin, std::cout);
+            return 0;
+        }
+        std::cout << "Serving " << jsonFile << " on " << argv[3] << std::endl;
+        return server.Listen(argv[3]) ? 0 : 1;
+    }
+    
     std::cout << "DM Disassembler for OpenDream (C++ Implementation)" << std::endl;
     std::cout << "Loading: " << jsonFile << std::endl;
     
     DMCompiler::DMDisassembler disassembler;
-    if (!disassembler.LoadJson(jsonFile)) {
-        std::cerr << "Error: Failed to load JSON file" << std::endl;
+    if (!disassembler.Load(jsonFile)) {
+        std::cerr << "Error: Failed to load compiled file" << std::endl;
         return 1;
     }
     
-    if (argc == 3) {
+    if (argc >= 3) {
         std::string command = argv[2];
         
         if (command == "crash-on-test") {
             std::cout << "Testing disassembly of all procs..." << std::endl;
-            int failures = disassembler.TestAll();
+            int failures = disassembler.TestAll(std::thread::hardware_concurrency());
             if (failures > 0) {
                 std::cerr << "Disassembly failed for " << failures << " procs." << std::endl;
                 return 1;
@@ -71,7 +121,91 @@ int main(int argc, char** argv) {
         }
         else if (command == "dump-all") {
             std::cout << "Dumping all types and procs..." << std::endl;
-            disassembler.DumpAll(std::cout);
+            disassembler.DumpAll(std::cout, std::thread::hardware_concurrency());
+            return 0;
+        }
+        else if (command == "ngrams") {
+            int length = argc > 3 ? std::atoi(argv[3]) : 2;
+            int top = argc > 4 ? std::atoi(argv[4]) : 20;
+            if (length < 1 || top < 1) {
+                std::cerr << "Usage: dmdisasm [file].json ngrams [N] [top]" << std::endl;
+                return 1;
+            }
+            std::cout << "Most common runs of " << length << " opcodes:" << std::endl;
+            for (const auto& [ngram, count] : disassembler.TopOpcodeNGrams(length, top)) {
+                std::cout << std::setw(8) << count << "  " << ngram << "\n";
+            }
+            return 0;
+        }
+        else if (command == "profile") {
+            int top = argc > 3 ? std::atoi(argv[3]) : 20;
+            if (top < 1) {
+                std::cerr << "Usage: dmdisasm [file].json profile [top]" << std::endl;
+                return 1;
+            }
+            auto profile = disassembler.GetProfile(top);
+            auto printList = [](const std::string& title, const std::vector<std::pair<std::string, size_t>>& entries) {
+                std::cout << "\n" << title << ":\n";
+                for (const auto& [name, count] : entries) {
+                    std::cout << std::setw(8) << count << "  " << name << "\n";
+                }
+            };
+            
+            std::cout << "\nOpcodes (" << profile.InstructionCount << " instructions):\n";
+            for (const auto& [name, count] : profile.Opcodes) {
+                std::cout << std::setw(8) << count << "  " << std::setw(6) << std::fixed << std::setprecision(2)
+                          << 100.0 * count / profile.InstructionCount << "%  " << name << "\n";
+            }
+            printList("Bytecode bytes by type", profile.TypeSizes);
+            printList("Longest procs (bytes)", profile.ProcSizes);
+            printList("Largest max stack sizes", profile.StackSizes);
+            printList("Most distinct procs called", profile.CallFanOut);
+            printList("Most common runs of 3 opcodes", profile.NGrams);
+            return 0;
+        }
+        else if (command == "callgraph") {
+            auto graph = disassembler.BuildCallGraph();
+            if (argc > 3) {
+                std::string format = argv[3];
+                if ((format != "dot" && format != "json") || argc < 5) {
+                    std::cerr << "Usage: dmdisasm [file].json callgraph dot|json [path]" << std::endl;
+                    return 1;
+                }
+                std::ofstream file(argv[4], std::ios::binary);
+                if (format == "dot") {
+                    graph.WriteDot(file);
+                } else {
+                    file << graph.ToJson() << "\n";
+                }
+                if (!file) {
+                    std::cerr << "Error: Cannot write file: " << argv[4] << std::endl;
+                    return 1;
+                }
+                std::cout << "Wrote call graph of " << graph.GetProcCount() << " procs to " << argv[4] << std::endl;
+                return 0;
+            }
+            
+            auto unreachable = graph.FindUnreachable();
+            std::cout << "\nRoots: " << graph.GetRoots().size() << " procs on /world and verbs\n";
+            std::cout << "\nUnreachable procs (" << unreachable.size() << " of " << graph.GetProcCount()
+                      << "; dynamic calls and engine hooks are not followed):\n";
+            for (int procId : unreachable) {
+                std::cout << "  [" << procId << "] " << graph.GetLabel(procId) << "\n";
+            }
+            auto groups = graph.FindRecursiveGroups();
+            std::cout << "\nRecursive groups (" << groups.size() << "):\n";
+            for (const auto& group : groups) {
+                std::cout << " ";
+                for (int procId : group) {
+                    std::cout << " " << graph.GetLabel(procId);
+                }
+                std::cout << "\n";
+            }
+            auto chain = graph.FindDeepestChain();
+            std::cout << "\nDeepest call chain (" << chain.size() << " procs):\n";
+            for (size_t i = 0; i < chain.size(); ++i) {
+                std::cout << "  " << std::string(2 * std::min(i, size_t(20)), ' ') << graph.GetLabel(chain[i]) << "\n";
+            }
             return 0;
         }
         else {
@@ -127,6 +261,28 @@ int main(int argc, char** argv) {
                 std::cout << "  ... and " << (results.size() - 20) << " more\n";
             }
         }
+        else if (cmd == "strings" || cmd == "refs") {
+            std::string query;
+            std::getline(ss >> std::ws, query);
+            if (query.empty()) {
+                std::cout << "Usage: " << cmd << " [text]" << std::endl;
+                continue;
+            }
+            
+            auto results = disassembler.SearchStrings(query);
+            std::cout << "Found " << results.size() << " strings:\n";
+            for (size_t i = 0; i < std::min(results.size(), size_t(20)); ++i) {
+                std::cout << "  [" << results[i] << "] \"" << disassembler.GetString(results[i]) << "\"\n";
+                if (cmd == "refs") {
+                    for (const auto* proc : disassembler.GetProcsReferencingString(results[i])) {
+                        std::cout << "      [" << proc->Id << "] " << proc->OwnerPath << "/" << proc->Name << "\n";
+                    }
+                }
+            }
+            if (results.size() > 20) {
+                std::cout << "  ... and " << (results.size() - 20) << " more\n";
+            }
+        }
         else if (cmd == "select") {
             std::string path;
             ss >> path;
@@ -1,13 +1,23 @@
 #include "DMCompiler.h"
+#include "BatchCompiler.h"
+#include "CompileServer.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <limits>
+#include <algorithm>
 
 void PrintHelp() {
     std::cout << "DM Compiler for OpenDream (C++ Implementation)" << std::endl;
     std::cout << "For more information please visit https://github.com/OpenDreamProject/OpenDream/wiki" << std::endl;
-    std::cout << "\nUsage: dmcompiler [options] [file].dme\n" << std::endl;
+    std::cout << "\nUsage: dmcompiler [options] [file].dme" << std::endl;
+    std::cout << "       dmcompiler --batch [FILE] [--batch-threads N] [--batch-cache DIR]" << std::endl;
+    std::cout << "       dmcompiler --server [SOCKET] [--server-cache DIR]" << std::endl;
+    std::cout << "       dmcompiler --connect [SOCKET] [options] [file].dme\n" << std::endl;
     std::cout << "Options and arguments:" << std::endl;
     std::cout << "  --help                    : Show this help" << std::endl;
     std::cout << "  --version [VER].[BUILD]   : Used to set the DM_VERSION and DM_BUILD macros" << std::endl;
@@ -18,9 +28,49 @@ void PrintHelp() {
     std::cout << "  --no-standard             : Disable built-in standard library" << std::endl;
     std::cout << "  --define [KEY=VAL]        : Add extra defines to the compilation" << std::endl;
     std::cout << "  --lib-path [PATH]         : Add a path to search for external libraries" << std::endl;
+    std::cout << "  --output [FILE]           : Write the JSON output to FILE, naming the other outputs after it" << std::endl;
     std::cout << "  --verbose                 : Show verbose output during compile" << std::endl;
     std::cout << "  --notices-enabled         : Show notice output during compile" << std::endl;
     std::cout << "  --no-opts                 : Disable compiler optimizations (debug only)" << std::endl;
+    std::cout << "  --fused-opcodes           : Fuse common opcode pairs into superinstructions" << std::endl;
+    std::cout << "  --verify-stack            : Warn where the stack depth analysis disagrees with the emitters' counts" << std::endl;
+    std::cout << "  --verify                  : Check every proc's bytecode (operand IDs, jumps, stack) before writing" << std::endl;
+    std::cout << "  --check-only              : Report errors and warnings without optimizing or writing any output" << std::endl;
+    std::cout << "  --compact-operands        : Write ID and count operands as LEB128 (needs a runtime that reads it)" << std::endl;
+    std::cout << "  --binary-output           : Also write the output in binary form, as [name].dmbc next to the JSON" << std::endl;
+    std::cout << "  --incremental-output      : Rewrite only the changed parts of an existing binary output" << std::endl;
+    std::cout << "  --locality-layout         : Store binary output code by type, each caller followed by its callees" << std::endl;
+    std::cout << "  --compress-output         : Write the output files compressed, as [file].dmz (dmdisasm reads them)" << std::endl;
+    std::cout << "  --resource-manifest       : Also write [name].resources.json with each resource's size and content hash" << std::endl;
+    std::cout << "  --stream-tokens           : Parse while preprocessing instead of buffering all tokens (warning #pragmas are ignored)" << std::endl;
+    std::cout << "  --lex-threads [N]         : Lex all included files on N threads before preprocessing" << std::endl;
+    std::cout << "  --parse-threads [N]       : Parse top-level definitions (not with --stream-tokens) and maps on N threads" << std::endl;
+    std::cout << "  --compile-threads [N]     : Compile procs on N threads (also -j [N])" << std::endl;
+    std::cout << "  --output-threads [N]      : Write types and procs to the JSON output (and compress it) on N threads" << std::endl;
+    std::cout << "  --lazy-proc-bodies        : Parse proc bodies only when compiling them (not with --stream-tokens)" << std::endl;
+    std::cout << "  --token-cache [DIR]       : Cache lexed tokens in DIR and reuse them for unchanged files" << std::endl;
+    std::cout << "  --ast-cache [DIR]         : Cache parsed definitions in DIR and reuse them for unchanged files" << std::endl;
+    std::cout << "  --map-cache [DIR]         : Cache converted maps in DIR and reuse them while they and their types are unchanged" << std::endl;
+    std::cout << "  --standard-snapshot [FILE]: Reuse preprocessed DMStandard from FILE, rebuilding it when stale" << std::endl;
+    std::cout << "  --proc-cache [DIR]        : Cache compiled procs in DIR and reuse them while they and the declarations are unchanged" << std::endl;
+    std::cout << "  --profile-data [FILE]     : Optimize hot procs for speed and cold ones for size, going by a runtime proc profile" << std::endl;
+    std::cout << "  --preproc-stats           : Report per-file, per-macro and #if skipping statistics" << std::endl;
+    std::cout << "  --map-stats               : Report tile, object and type counts for each map, also as [name].mapstats.json" << std::endl;
+    std::cout << "  --dependency-graph        : Write what each file includes, defines, expands and declares as [name].deps.json" << std::endl;
+    std::cout << "  --timings=json|trace      : Report each phase's time, memory and allocations, also as [name].timings.json or Chrome trace [name].trace.json" << std::endl;
+    std::cout << "  --compile-costs [N]       : Print the N files slowest to preprocess and parse and the N procs slowest to compile" << std::endl;
+    std::cout << "  --max-memory [MB]         : Print each phase's memory high-water mark, and fail if the peak exceeds MB when given" << std::endl;
+    std::cout << "  --strip-unused            : Drop procs unreachable from verbs, /world, hooks and maps, listed in [name].stripped.json" << std::endl;
+    std::cout << "  --emit-preprocessed [FILE]: Write the preprocessed token stream to FILE" << std::endl;
+    std::cout << "  --load-preprocessed [FILE]: Parse the token stream in FILE instead of preprocessing the input files" << std::endl;
+    std::cout << "\nBatch:" << std::endl;
+    std::cout << "  --batch [FILE]            : Compile the targets FILE lists in one process, concurrently, sharing caches" << std::endl;
+    std::cout << "  --batch-threads [N]       : Compile N targets at a time (default: one per target, up to the CPU count)" << std::endl;
+    std::cout << "  --batch-cache [DIR]       : Where the batch keeps its token cache and DMStandard snapshot (default .dmcompiler-batch)" << std::endl;
+    std::cout << "\nServer:" << std::endl;
+    std::cout << "  --server [SOCKET]         : Stay resident and compile on request, keeping caches warm (stdin/stdout without SOCKET)" << std::endl;
+    std::cout << "  --server-cache [DIR]      : Where the server keeps its caches (default .dmcompiler-server)" << std::endl;
+    std::cout << "  --connect [SOCKET]        : Have the server on SOCKET run this compile and print its output" << std::endl;
 }
 
 bool ParseArguments(int argc, char** argv, DMCompiler::DMCompilerSettings& settings) {
@@ -57,6 +107,63 @@ bool ParseArguments(int argc, char** argv, DMCompiler::DMCompilerSettings& setti
         else if (arg == "--no-opts") {
             settings.NoOpts = true;
         }
+        else if (arg == "--fused-opcodes") {
+            settings.FusedOpcodes = true;
+        }
+        else if (arg == "--verify-stack") {
+            settings.VerifyStack = true;
+        }
+        else if (arg == "--check-only") {
+            settings.CheckOnly = true;
+        }
+        else if (arg == "--verify") {
+            settings.Verify = true;
+        }
+        else if (arg == "--compact-operands") {
+            settings.CompactOperands = true;
+        }
+        else if (arg == "--binary-output") {
+            settings.BinaryOutput = true;
+        }
+        else if (arg == "--locality-layout") {
+            settings.LocalityLayout = true;
+        }
+        else if (arg == "--incremental-output") {
+            settings.IncrementalOutput = true;
+        }
+        else if (arg == "--compress-output") {
+            settings.CompressOutput = true;
+        }
+        else if (arg == "--resource-manifest") {
+            settings.ResourceManifest = true;
+        }
+        else if (arg == "--preproc-stats") {
+            settings.PreprocStats = true;
+        }
+        else if (arg == "--map-stats") {
+            settings.MapStats = true;
+        }
+        else if (arg == "--dependency-graph") {
+            settings.DependencyGraph = true;
+        }
+        else if (arg == "--timings=json" || arg == "--timings=trace") {
+            settings.Timings = arg.substr(std::strlen("--timings="));
+        }
+        else if (arg == "--strip-unused") {
+            settings.StripUnused = true;
+        }
+        else if (arg == "--emit-preprocessed" && i + 1 < argc) {
+            settings.EmitPreprocessedPath = argv[++i];
+        }
+        else if (arg == "--load-preprocessed" && i + 1 < argc) {
+            settings.LoadPreprocessedPath = argv[++i];
+        }
+        else if (arg == "--stream-tokens") {
+            settings.StreamTokens = true;
+        }
+        else if (arg == "--lazy-proc-bodies") {
+            settings.LazyProcBodies = true;
+        }
         else if (arg == "--skip-anything-typecheck") {
             settings.SkipAnythingTypecheck = true;
         }
@@ -75,6 +182,57 @@ bool ParseArguments(int argc, char** argv, DMCompiler::DMCompilerSettings& setti
                 settings.MacroDefines[define] = "1";
             }
         }
+        else if (arg == "--lex-threads" && i + 1 < argc) {
+            settings.LexThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--parse-threads" && i + 1 < argc) {
+            settings.ParseThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if ((arg == "--compile-threads" || arg == "-j") && i + 1 < argc) {
+            settings.CompileThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--output-threads" && i + 1 < argc) {
+            settings.OutputThreads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--compile-costs" && i + 1 < argc) {
+            settings.CompileCostsTop = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+        }
+        else if (arg == "--max-memory") {
+            // The limit is optional: without a number after it, only the report is printed
+            settings.MemoryReport = true;
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i + 1][0]))) {
+                char* end = nullptr;
+                errno = 0;
+                unsigned long megabytes = std::strtoul(argv[++i], &end, 10);
+                if (*end != '\0' || errno == ERANGE || megabytes > std::numeric_limits<unsigned>::max()) {
+                    std::cerr << "Error: --max-memory takes a whole number of MB, not " << argv[i] << std::endl;
+                    std::cerr << "Use --help for usage information" << std::endl;
+                    return false;
+                }
+                settings.MaxMemoryMB = static_cast<unsigned>(megabytes);
+            }
+        }
+        else if (arg == "--token-cache" && i + 1 < argc) {
+            settings.TokenCacheDir = argv[++i];
+        }
+        else if (arg == "--ast-cache" && i + 1 < argc) {
+            settings.ASTCacheDir = argv[++i];
+        }
+        else if (arg == "--map-cache" && i + 1 < argc) {
+            settings.MapCacheDir = argv[++i];
+        }
+        else if (arg == "--standard-snapshot" && i + 1 < argc) {
+            settings.StandardSnapshotPath = argv[++i];
+        }
+        else if (arg == "--proc-cache" && i + 1 < argc) {
+            settings.ProcCacheDir = argv[++i];
+        }
+        else if (arg == "--profile-data" && i + 1 < argc) {
+            settings.ProfileDataPath = argv[++i];
+        }
+        else if (arg == "--output" && i + 1 < argc) {
+            settings.OutputPath = argv[++i];
+        }
         else if (arg == "--lib-path" && i + 1 < argc) {
             settings.LibraryPaths.push_back(argv[++i]);
         }
@@ -107,6 +265,15 @@ bool ParseArguments(int argc, char** argv, DMCompiler::DMCompilerSettings& setti
     return true;
 }
 
+// Parse a command line given as a list, for a server request or batch target
+bool ParseArgumentList(const std::vector<std::string>& args, DMCompiler::DMCompilerSettings& settings) {
+    std::vector<char*> compileArgv = {const_cast<char*>("dmcompiler")};
+    for (const auto& arg : args) {
+        compileArgv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    return ParseArguments(static_cast<int>(compileArgv.size()), compileArgv.data(), settings);
+}
+
 int main(int argc, char** argv) {
     if (argc < 2) {
         std::cerr << "Error: No input files specified" << std::endl;
@@ -114,6 +281,70 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    std::string mode = argv[1];
+    if (mode == "--server") {
+        std::string socketPath;
+        std::string cacheDir = ".dmcompiler-server";
+        for (int i = 2; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--server-cache" && i + 1 < argc) {
+                cacheDir = argv[++i];
+            } else if (arg[0] != '-' && socketPath.empty()) {
+                socketPath = arg;
+            } else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return 1;
+            }
+        }
+
+        DMCompiler::CompileServer server(cacheDir, ParseArgumentList);
+        if (socketPath.empty()) {
+            server.Serve(std::cin, std::cout);
+            return 0;
+        }
+        std::cout << "Compile server listening on " << socketPath << std::endl;
+        return server.Listen(socketPath) ? 0 : 1;
+    }
+    if (mode == "--batch") {
+        if (argc < 3) {
+            std::cerr << "Error: --batch needs a batch file" << std::endl;
+            return 1;
+        }
+        std::string cacheDir = ".dmcompiler-batch";
+        unsigned threads = 0;
+        for (int i = 3; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--batch-cache" && i + 1 < argc) {
+                cacheDir = argv[++i];
+            } else if (arg == "--batch-threads" && i + 1 < argc) {
+                threads = static_cast<unsigned>(std::max(0, std::atoi(argv[++i])));
+            } else {
+                std::cerr << "Unknown argument: " << arg << std::endl;
+                return 1;
+            }
+        }
+
+        std::vector<DMCompiler::BatchCompiler::Target> targets;
+        std::string error;
+        if (!DMCompiler::BatchCompiler::LoadTargets(argv[2], targets, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            return 1;
+        }
+        DMCompiler::BatchCompiler batch(cacheDir, ParseArgumentList);
+        auto results = batch.Compile(targets, threads, std::cout);
+        bool success = std::all_of(results.begin(), results.end(),
+                                   [](const DMCompiler::BatchCompiler::Result& result) { return result.Success; });
+        return success ? 0 : 1;
+    }
+    if (mode == "--connect") {
+        if (argc < 3) {
+            std::cerr << "Error: --connect needs the server's socket" << std::endl;
+            return 1;
+        }
+        std::vector<std::string> args(argv + 3, argv + argc);
+        return DMCompiler::CompileServer::CompileRemotely(argv[2], args, std::cout) ? 0 : 1;
+    }
+
     DMCompiler::DMCompilerSettings settings;
     if (!ParseArguments(argc, argv, settings)) {
         return 1;
@@ -0,0 +1,1140 @@
+/// @file benchmarks.cpp
+/// @brief Compile-time benchmarks (scons bench) and the synthetic codebase they run on
+///
+/// Micro-benchmarks time the lexer, macro expansion, expression parsing,
+/// object tree lookups, BytecodeWriter and JsonWriter in isolation, and one
+/// benchmark compiles a generated codebase end to end. Results are written as
+/// JSON (--json) and can be checked against an earlier run (--baseline), so a
+/// compile-time regression fails the run instead of reaching a release.
+///
+/// The codebase is generated from a seed, so two runs with the same shape
+/// compile the same code: a tree of /obj types (each overriding its parent's
+/// Tick() and adding procs that loop, build strings, fill lists, expand macros
+/// and call global procs), turf and area types, and maps placing them.
+/// "dm_benchmarks generate DIR" writes it out on its own, to profile the
+/// compiler on something larger than the tests use.
+
+#include "../include/BytecodeWriter.h"
+#include "../include/DMCompiler.h"
+#include "../include/DMLexer.h"
+#include "../include/DMObject.h"
+#include "../include/DMObjectTree.h"
+#include "../include/DMParser.h"
+#include "../include/DMPreprocessor.h"
+#include "../include/DMProc.h"
+#include "../include/DreamPath.h"
+#include "../include/DreamProcOpcode.h"
+#include "../include/JsonWriter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using namespace DMCompiler;
+namespace fs = std::filesystem;
+
+namespace {
+
+// =============================================================================
+// Synthetic codebase
+// =============================================================================
+
+/// How big a codebase to generate
+struct CodebaseShape {
+    int Types = 1000;        // /obj types, in a tree eight wide
+    int Procs = 5000;        // Procs declared on those types, besides their Tick() overrides
+    int GlobalProcs = 100;
+    int Maps = 1;
+    int MapSize = 100;       // Width and height of each map, one z-level
+    int TypesPerFile = 100;
+    uint32_t Seed = 1;
+
+    void Scale(double factor) {
+        auto scale = [factor](int& count) { count = std::max(1, static_cast<int>(count * factor)); };
+        scale(Types);
+        scale(Procs);
+        scale(GlobalProcs);
+        scale(MapSize);
+    }
+};
+
+struct GeneratedFile {
+    std::string Path;  // Relative to the codebase's directory
+    std::string Contents;
+};
+
+/// Deterministic across platforms, unlike the standard distributions
+class Random {
+public:
+    explicit Random(uint32_t seed) : State_(seed * 2654435761u + 1) {}
+
+    uint32_t Next() {
+        State_ ^= State_ << 13;
+        State_ ^= State_ >> 17;
+        State_ ^= State_ << 5;
+        return State_;
+    }
+
+    int Below(int bound) { return bound <= 0 ? 0 : static_cast<int>(Next() % static_cast<uint32_t>(bound)); }
+
+private:
+    uint32_t State_;
+};
+
+const char* const Defines =
+    "#define DAMAGE_SCALE 2\n"
+    "#define MAX_HEALTH 100\n"
+    "#define FLAG(n) (1 << (n))\n"
+    "#define CLAMP(x, lo, hi) min(max(x, lo), hi)\n"
+    "#define PERCENT(a, b) ((a) * 100 / max(b, 1))\n"
+    "#define LABEL(thing, n) \"[thing] #[n]\"\n";
+const int MaxHealth = 100;  // MAX_HEALTH
+
+/// Type i is a child of type (i - 1) / 8, so the tree is a few levels deep
+std::string TypePath(int index) {
+    std::string path;
+    for (int i = index; i > 0; i = (i - 1) / 8) {
+        path = "/t" + std::to_string(i) + path;
+    }
+    return "/obj/synthetic" + path;
+}
+
+/// Procs declared on a type, spread evenly over the types
+int ProcCount(const CodebaseShape& shape, int type) {
+    return shape.Procs / shape.Types + (type < shape.Procs % shape.Types ? 1 : 0);
+}
+
+/// A proc declared on a type or an ancestor of it, for calls to resolve up the tree
+std::string InheritedProc(const CodebaseShape& shape, int type, Random& random) {
+    for (int owner = type; ; owner = (owner - 1) / 8) {
+        int count = ProcCount(shape, owner);
+        if (count > 0 && (owner == 0 || random.Below(2) == 0)) {
+            return "p" + std::to_string(owner) + "_" + std::to_string(random.Below(count));
+        }
+        if (owner == 0) {
+            return "Tick";
+        }
+    }
+}
+
+void WriteProcBody(std::ostringstream& out, const CodebaseShape& shape, int type, int proc, Random& random) {
+    int global = random.Below(shape.GlobalProcs);
+    switch (random.Below(4)) {
+    case 0:
+        out << "\t\tvar/total = amount * DAMAGE_SCALE\n"
+            << "\t\tfor(var/i = 1; i <= " << 2 + random.Below(8) << "; i++)\n"
+            << "\t\t\ttotal += CLAMP(i * " << 1 + random.Below(5) << ", 0, health)\n"
+            << "\t\tif(total > " << random.Below(MaxHealth) << ")\n"
+            << "\t\t\tflags |= FLAG(" << random.Below(16) << ")\n"
+            << "\t\telse\n"
+            << "\t\t\tticks++\n"
+            << "\t\treturn total\n";
+        break;
+    case 1:
+        out << "\t\tvar/text = LABEL(name, amount)\n"
+            << "\t\tif(amount % 2)\n"
+            << "\t\t\ttext += \" is odd\"\n"
+            << "\t\tlabel = \"[text] from t" << type << " p" << proc << "\"\n"
+            << "\t\treturn length(text) + synthetic_g" << global << "(amount)\n";
+        break;
+    case 2:
+        out << "\t\tif(!items)\n"
+            << "\t\t\titems = list()\n"
+            << "\t\tfor(var/i in 1 to " << 1 + random.Below(6) << ")\n"
+            << "\t\t\titems += i * amount\n"
+            << "\t\tvar/sum = 0\n"
+            << "\t\tfor(var/value in items)\n"
+            << "\t\t\tsum += value\n"
+            << "\t\treturn PERCENT(sum, health)\n";
+        break;
+    default:
+        out << "\t\tvar/result = " << InheritedProc(shape, type, random) << "(amount + " << random.Below(10) << ")\n"
+            << "\t\tswitch(result)\n"
+            << "\t\t\tif(0)\n"
+            << "\t\t\t\treturn synthetic_g" << global << "(health)\n"
+            << "\t\t\tif(1 to 50)\n"
+            << "\t\t\t\thealth = min(health + result, MAX_HEALTH)\n"
+            << "\t\treturn result\n";
+        break;
+    }
+}
+
+std::string GenerateTypeFile(const CodebaseShape& shape, int first, int last) {
+    std::ostringstream out;
+    for (int type = first; type < last; type++) {
+        Random random(shape.Seed * 7919u + static_cast<uint32_t>(type));
+        out << TypePath(type) << "\n"
+            << "\tname = \"t" << type << "\"\n";
+        if (type == 0) {
+            out << "\tvar/health = 50\n"
+                << "\tvar/label = \"\"\n"
+                << "\tvar/flags = 0\n"
+                << "\tvar/tmp/ticks = 0\n"
+                << "\tvar/list/items\n"
+                << "\n"
+                << "\tproc/Tick()\n"
+                << "\t\tticks++\n"
+                << "\t\treturn ticks\n";
+        } else {
+            out << "\thealth = " << 1 + random.Below(MaxHealth) << "\n"
+                << "\n"
+                << "\tTick()\n"
+                << "\t\t. = ..()\n"
+                << "\t\tif(. > " << random.Below(10) << ")\n"
+                << "\t\t\thealth = max(health - DAMAGE_SCALE, 0)\n";
+        }
+        for (int proc = 0; proc < ProcCount(shape, type); proc++) {
+            out << "\n\tproc/p" << type << "_" << proc << "(amount = " << random.Below(10) << ")\n";
+            WriteProcBody(out, shape, type, proc, random);
+        }
+        out << "\n";
+    }
+    return out.str();
+}
+
+std::string GenerateMap(const CodebaseShape& shape, int map, int floorTypes) {
+    Random random(shape.Seed * 104729u + static_cast<uint32_t>(map));
+    const std::string letters = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+    const int keyCount = 64;
+    auto key = [&](int index) {
+        return std::string{letters[index / letters.size()], letters[index % letters.size()]};
+    };
+
+    std::ostringstream out;
+    for (int i = 0; i < keyCount; i++) {
+        out << "\"" << key(i) << "\" = (";
+        if (i % 4 != 0) {
+            out << TypePath(random.Below(shape.Types)) << ",";
+        }
+        out << "/turf/synthetic/floor" << i % floorTypes << ",/area/synthetic)\n";
+    }
+    out << "\n(1,1,1) = {\"\n";
+    for (int y = 0; y < shape.MapSize; y++) {
+        for (int x = 0; x < shape.MapSize; x++) {
+            out << key(random.Below(keyCount));
+        }
+        out << "\n";
+    }
+    out << "\"}\n";
+    return out.str();
+}
+
+/// Every file of the codebase, the .dme first
+std::vector<GeneratedFile> GenerateCodebase(const CodebaseShape& shape) {
+    const int floorTypes = 8;
+    std::vector<GeneratedFile> files;
+    std::ostringstream dme;
+    dme << "// Synthetic codebase: " << shape.Types << " types, " << shape.Procs << " procs, "
+        << shape.Maps << " maps of " << shape.MapSize << "x" << shape.MapSize << "\n";
+    files.push_back({"synthetic.dme", ""});
+
+    std::ostringstream common;
+    common << Defines << "\n"
+           << "/area/synthetic\n"
+           << "\tname = \"Synthetic\"\n\n";
+    for (int i = 0; i < floorTypes; i++) {
+        common << "/turf/synthetic/floor" << i << "\n"
+               << "\tname = \"floor " << i << "\"\n\n";
+    }
+    for (int global = 0; global < shape.GlobalProcs; global++) {
+        Random random(shape.Seed * 31u + static_cast<uint32_t>(global));
+        common << "/proc/synthetic_g" << global << "(x)\n"
+               << "\tif(x > " << random.Below(50) << ")\n"
+               << "\t\treturn x - " << random.Below(10) << "\n"
+               << "\treturn x * DAMAGE_SCALE\n\n";
+    }
+    files.push_back({"code/_common.dm", common.str()});
+    dme << "#include \"code/_common.dm\"\n";
+
+    for (int first = 0; first < shape.Types; first += shape.TypesPerFile) {
+        int last = std::min(first + shape.TypesPerFile, shape.Types);
+        std::string path = "code/types_" + std::to_string(first / shape.TypesPerFile) + ".dm";
+        files.push_back({path, GenerateTypeFile(shape, first, last)});
+        dme << "#include \"" << path << "\"\n";
+    }
+    for (int map = 0; map < shape.Maps; map++) {
+        std::string path = "maps/synthetic_" + std::to_string(map) + ".dmm";
+        files.push_back({path, GenerateMap(shape, map, floorTypes)});
+        dme << "#include \"" << path << "\"\n";
+    }
+    files[0].Contents = dme.str();
+    return files;
+}
+
+bool WriteCodebase(const fs::path& directory, const std::vector<GeneratedFile>& files) {
+    for (const GeneratedFile& file : files) {
+        fs::path path = directory / file.Path;
+        std::error_code ec;
+        fs::create_directories(path.parent_path(), ec);
+        std::ofstream out(path, std::ios::binary);
+        out << file.Contents;
+        if (!out) {
+            std::cerr << "Error: Cannot write " << path.string() << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// =============================================================================
+// Benchmarks
+// =============================================================================
+
+/// What every benchmark can use, generated once
+struct BenchmarkContext {
+    CodebaseShape Shape;
+    fs::path Directory;  // Where the codebase was written
+    std::vector<GeneratedFile> Files;
+    std::string Source;  // Every .dm file, concatenated
+    std::string Build;   // The build being measured, as scons bench names it (--build)
+};
+
+/// Runs one iteration, returning how many items it processed
+using BenchmarkRun = std::function<size_t()>;
+
+struct Benchmark {
+    const char* Name;
+    const char* Unit;  // What the items are
+    std::function<BenchmarkRun(BenchmarkContext&)> Prepare;  // Setup, which is not timed
+};
+
+struct BenchmarkResult {
+    std::string Name;
+    std::string Unit;
+    size_t Items = 0;
+    std::vector<double> Ms;  // One per timed iteration
+
+    double Min() const { return *std::min_element(Ms.begin(), Ms.end()); }
+    double Mean() const {
+        double total = 0;
+        for (double ms : Ms) total += ms;
+        return total / Ms.size();
+    }
+    double Median() const {
+        std::vector<double> sorted = Ms;
+        std::sort(sorted.begin(), sorted.end());
+        size_t middle = sorted.size() / 2;
+        return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+    }
+    double ItemsPerSecond() const { return Min() > 0 ? Items * 1000.0 / Min() : 0; }
+};
+
+/// Discards std::cout and std::cerr while it lives, for code that reports progress
+class QuietConsole {
+public:
+    QuietConsole() : Out_(std::cout.rdbuf(Null_.rdbuf())), Err_(std::cerr.rdbuf(Null_.rdbuf())) {}
+    ~QuietConsole() {
+        std::cout.rdbuf(Out_);
+        std::cerr.rdbuf(Err_);
+    }
+    QuietConsole(const QuietConsole&) = delete;
+    QuietConsole& operator=(const QuietConsole&) = delete;
+
+private:
+    std::ostringstream Null_;
+    std::streambuf* Out_;
+    std::streambuf* Err_;
+};
+
+BenchmarkRun PrepareLexer(BenchmarkContext& context) {
+    return [&context]() {
+        DMLexer lexer("synthetic.dm", context.Source);
+        size_t tokens = 0;
+        while (lexer.GetNextToken().Type != TokenType::EndOfFile) {
+            tokens++;
+        }
+        return tokens;
+    };
+}
+
+BenchmarkRun PrepareMacroExpansion(BenchmarkContext& context) {
+    fs::path path = context.Directory / "bench_macros.dm";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << Defines;
+        for (int i = 0; i < context.Shape.Procs; i++) {
+            out << "var/m" << i << " = CLAMP(FLAG(" << i % 16 << ") * DAMAGE_SCALE, 0, PERCENT(" << i
+                << ", MAX_HEALTH)) + LABEL(\"m\", " << i << ")\n";
+        }
+    }
+    return [path]() {
+        DMPreprocessor preprocessor;
+        return preprocessor.Preprocess(path.string()).size();
+    };
+}
+
+BenchmarkRun PrepareParserExpressions(BenchmarkContext& context) {
+    auto expressions = std::make_shared<std::vector<std::string>>();
+    Random random(context.Shape.Seed);
+    for (int i = 0; i < context.Shape.Procs; i++) {
+        std::ostringstream out;
+        switch (i % 4) {
+        case 0:
+            out << "a * " << random.Below(100) << " + (b - c) / max(d, 1) % " << 1 + random.Below(9);
+            break;
+        case 1:
+            out << "x && !y || (z >= " << random.Below(100) << " ? list(1, 2, \"three\") : null)";
+            break;
+        case 2:
+            out << "src.items[i + " << random.Below(10) << "].Tick(usr, \"[name] #[i]\", 1 << j)";
+            break;
+        default:
+            out << "istype(thing, /obj/synthetic/t" << random.Below(100) << ") ? thing:health : -initial(health)";
+            break;
+        }
+        expressions->push_back(out.str());
+    }
+    auto compiler = std::make_shared<DMCompiler::DMCompiler>();
+    return [expressions, compiler]() {
+        QuietConsole quiet;  // The parser reports its progress
+        size_t parsed = 0;
+        for (const std::string& expression : *expressions) {
+            DMLexer lexer("bench.dm", expression);
+            DMParser parser(compiler.get(), &lexer);
+            if (parser.Expression()) {
+                parsed++;
+            }
+        }
+        return parsed;
+    };
+}
+
+BenchmarkRun PrepareObjectTreeLookups(BenchmarkContext& context) {
+    struct Lookup {
+        DreamPath Type;
+        std::string Proc;
+    };
+    auto tree = std::make_shared<DMObjectTree>();
+    auto lookups = std::make_shared<std::vector<Lookup>>();
+    const CodebaseShape& shape = context.Shape;
+    Random random(shape.Seed);
+    for (int type = 0; type < shape.Types; type++) {
+        DMObject* object = tree->GetOrCreateDMObject(DreamPath(TypePath(type)));
+        for (int proc = 0; proc < ProcCount(shape, type); proc++) {
+            std::string name = "p" + std::to_string(type) + "_" + std::to_string(proc);
+            object->AddProc(tree->CreateProc(name, object, false, Location())->Id, name);
+        }
+    }
+    tree->FreezeTypeTree();
+    for (int type = 0; type < shape.Types; type++) {
+        lookups->push_back({DreamPath(TypePath(type)), InheritedProc(shape, type, random)});
+    }
+    return [tree, lookups]() {
+        // Compiling looks the same types and procs up over and over
+        size_t found = 0;
+        for (int pass = 0; pass < 100; pass++) {
+            for (const Lookup& lookup : *lookups) {
+                int typeId;
+                DMObject* object = tree->GetType(lookup.Type);
+                found += tree->TryGetTypeId(lookup.Type, typeId) ? 1 : 0;
+                found += object && tree->GetProc(object, lookup.Proc) ? 1 : 0;
+            }
+        }
+        return found;
+    };
+}
+
+BenchmarkRun PrepareBytecodeWriter(BenchmarkContext& context) {
+    auto tree = std::make_shared<DMObjectTree>();
+    int procs = context.Shape.Procs;
+    return [tree, procs]() {
+        for (int proc = 0; proc < procs; proc++) {
+            // for(var/i = 0; i < 16; i++) label = "[i]"; return i, with dead stores for Optimize()
+            BytecodeWriter writer(tree.get());
+            OperandBytes local = {9, 0};
+            OperandBytes field = {12, 0, 0, 0, 0};
+            int loop = writer.CreateLabel();
+            int end = writer.CreateLabel();
+            writer.EmitFloat(DreamProcOpcode::PushFloat, 0);
+            writer.ResizeStack(1);
+            writer.EmitMulti(DreamProcOpcode::Assign, local);
+            writer.Emit(DreamProcOpcode::Pop);
+            writer.ResizeStack(-1);
+            writer.MarkLabel(loop);
+            writer.EmitMulti(DreamProcOpcode::PushReferenceValue, local);
+            writer.EmitFloat(DreamProcOpcode::PushFloat, 16);
+            writer.ResizeStack(2);
+            writer.Emit(DreamProcOpcode::CompareLessThan);
+            writer.ResizeStack(-1);
+            writer.EmitJump(DreamProcOpcode::JumpIfFalse, end);
+            writer.ResizeStack(-1);
+            writer.EmitString(DreamProcOpcode::PushString, "label " + std::to_string(proc % 64));
+            writer.ResizeStack(1);
+            writer.EmitMulti(DreamProcOpcode::Assign, field);
+            writer.Emit(DreamProcOpcode::Pop);
+            writer.ResizeStack(-1);
+            writer.EmitMulti(DreamProcOpcode::PushReferenceValue, local);
+            writer.EmitFloat(DreamProcOpcode::PushFloat, 1);
+            writer.ResizeStack(2);
+            writer.Emit(DreamProcOpcode::Add);
+            writer.ResizeStack(-1);
+            writer.EmitMulti(DreamProcOpcode::Assign, local);
+            writer.Emit(DreamProcOpcode::Pop);
+            writer.ResizeStack(-1);
+            writer.EmitJump(DreamProcOpcode::Jump, loop);
+            writer.MarkLabel(end);
+            writer.EmitMulti(DreamProcOpcode::PushReferenceValue, local);
+            writer.ResizeStack(1);
+            writer.Emit(DreamProcOpcode::Return);
+            writer.ResizeStack(-1);
+            writer.Optimize();
+            writer.AnalyzeStack();
+            writer.Finalize();
+        }
+        return static_cast<size_t>(procs);
+    };
+}
+
+BenchmarkRun PrepareJsonWriter(BenchmarkContext& context) {
+    int types = context.Shape.Types;
+    int procs = context.Shape.Procs;
+    return [types, procs]() {
+        // Shaped like the output's types and procs
+        std::vector<uint8_t> bytecode(64);
+        for (size_t i = 0; i < bytecode.size(); i++) {
+            bytecode[i] = static_cast<uint8_t>(i * 37);
+        }
+        JsonWriter json;
+        json.BeginObject();
+        json.WriteKey("Types");
+        json.BeginArray();
+        for (int type = 0; type < types; type++) {
+            json.BeginObject();
+            json.WriteKeyValue("Path", TypePath(type));
+            json.WriteKeyValue("Parent", type == 0 ? 0 : (type - 1) / 8);
+            json.WriteKey("Variables");
+            json.BeginObject();
+            json.WriteKeyValue("name", "t" + std::to_string(type));
+            json.WriteKeyValue("health", type % 100);
+            json.WriteKey("ratio");
+            json.WriteDouble(type / 7.0);
+            json.WriteKey("items");
+            json.WriteNull();
+            json.EndObject();
+            json.EndObject();
+        }
+        json.EndArray();
+        json.WriteKey("Procs");
+        json.BeginArray();
+        for (int proc = 0; proc < procs; proc++) {
+            json.BeginObject();
+            json.WriteKeyValue("OwningTypeId", proc % types);
+            json.WriteKeyValue("Name", "p" + std::to_string(proc));
+            json.WriteKeyValue("MaxStackSize", 4);
+            json.WriteKey("Bytecode");
+            json.WriteByteArray(bytecode);
+            json.EndObject();
+        }
+        json.EndArray();
+        json.EndObject();
+        return static_cast<size_t>(types + procs);
+    };
+}
+
+BenchmarkRun PrepareCompile(BenchmarkContext& context) {
+    fs::path dme = context.Directory / "synthetic.dme";
+    return [dme]() -> size_t {
+        DMCompilerSettings settings;
+        settings.Files.push_back(dme.string());
+        DMCompiler::DMCompiler compiler;
+        bool success;
+        {
+            QuietConsole quiet;
+            success = compiler.Compile(settings);
+        }
+        if (!success || compiler.GetErrorCount() > 0) {
+            throw std::runtime_error("The synthetic codebase did not compile (" +
+                                     std::to_string(compiler.GetErrorCount()) + " errors)");
+        }
+        return compiler.GetObjectTree()->GetAllProcs().size();
+    };
+}
+
+const std::vector<Benchmark>& Benchmarks() {
+    static const std::vector<Benchmark> benchmarks = {
+        {"lexer", "tokens", PrepareLexer},
+        {"preprocessor_macros", "tokens", PrepareMacroExpansion},
+        {"parser_expressions", "expressions", PrepareParserExpressions},
+        {"objecttree_lookups", "lookups", PrepareObjectTreeLookups},
+        {"bytecode_writer", "procs", PrepareBytecodeWriter},
+        {"json_writer", "objects", PrepareJsonWriter},
+        {"compile", "procs", PrepareCompile},
+    };
+    return benchmarks;
+}
+
+// =============================================================================
+// Results
+// =============================================================================
+
+/// ", a release build" for results that name the build they measured, else nothing
+std::string DescribeBuild(const nlohmann::json& results) {
+    std::string build = results.value("Build", "");
+    return build.empty() ? "" : ", a " + build + " build";
+}
+
+bool WriteResults(const std::string& path, const BenchmarkContext& context, const std::vector<BenchmarkResult>& results) {
+    JsonWriter json;
+    json.BeginObject();
+    if (!context.Build.empty()) {
+        json.WriteKeyValue("Build", context.Build);
+    }
+    json.WriteKey("Codebase");
+    json.BeginObject();
+    json.WriteKeyValue("Types", context.Shape.Types);
+    json.WriteKeyValue("Procs", context.Shape.Procs);
+    json.WriteKeyValue("GlobalProcs", context.Shape.GlobalProcs);
+    json.WriteKeyValue("Maps", context.Shape.Maps);
+    json.WriteKeyValue("MapSize", context.Shape.MapSize);
+    json.WriteKeyValue("Seed", static_cast<int>(context.Shape.Seed));
+    json.EndObject();
+    json.WriteKey("Benchmarks");
+    json.BeginArray();
+    for (const BenchmarkResult& result : results) {
+        json.BeginObject();
+        json.WriteKeyValue("Name", result.Name);
+        json.WriteKeyValue("Unit", result.Unit);
+        json.WriteKey("Items");
+        json.WriteInt64(static_cast<int64_t>(result.Items));
+        json.WriteKeyValue("Iterations", static_cast<int>(result.Ms.size()));
+        json.WriteKey("MinMs");
+        json.WriteDouble(result.Min());
+        json.WriteKey("MedianMs");
+        json.WriteDouble(result.Median());
+        json.WriteKey("MeanMs");
+        json.WriteDouble(result.Mean());
+        json.WriteKey("ItemsPerSecond");
+        json.WriteDouble(result.ItemsPerSecond());
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+
+    std::ofstream out(path, std::ios::binary);
+    out << json.ToString() << "\n";
+    if (!out) {
+        std::cerr << "Error: Cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// Compare each benchmark's fastest run with the baseline's
+/// @return How many are slower than the baseline by more than tolerance
+///         percent, or -1 if the baseline cannot be compared with
+int CountRegressions(const std::string& baselinePath, double tolerance, const BenchmarkContext& context,
+                     const std::vector<BenchmarkResult>& results) {
+    std::ifstream in(baselinePath, std::ios::binary);
+    nlohmann::json baseline = nlohmann::json::parse(in, nullptr, false);
+    if (baseline.is_discarded() || !baseline.contains("Benchmarks") || !baseline.contains("Codebase")) {
+        std::cerr << "Error: " << baselinePath << " is not a benchmark results file" << std::endl;
+        return -1;
+    }
+    const nlohmann::json& codebase = baseline["Codebase"];
+    const CodebaseShape& shape = context.Shape;
+    if (codebase.value("Types", 0) != shape.Types || codebase.value("Procs", 0) != shape.Procs ||
+        codebase.value("GlobalProcs", 0) != shape.GlobalProcs || codebase.value("Maps", 0) != shape.Maps ||
+        codebase.value("MapSize", 0) != shape.MapSize || codebase.value("Seed", 0) != static_cast<int>(shape.Seed)) {
+        std::cerr << "Error: " << baselinePath << " was run on a different codebase" << std::endl;
+        return -1;
+    }
+
+    int regressions = 0;
+    std::cout << "\nAgainst " << baselinePath << DescribeBuild(baseline) << " (tolerance " << tolerance << "%):"
+              << std::endl;
+    for (const BenchmarkResult& result : results) {
+        const nlohmann::json* previous = nullptr;
+        for (const nlohmann::json& entry : baseline["Benchmarks"]) {
+            if (entry.value("Name", "") == result.Name) {
+                previous = &entry;
+            }
+        }
+        if (!previous || previous->value("MinMs", 0.0) <= 0) {
+            std::cout << "  " << std::left << std::setw(22) << result.Name << std::right << "  not in the baseline"
+                      << std::endl;
+            continue;
+        }
+        double change = (result.Min() / previous->value("MinMs", 0.0) - 1) * 100;
+        bool regressed = change > tolerance;
+        regressions += regressed ? 1 : 0;
+        std::cout << "  " << std::left << std::setw(22) << result.Name << std::right << std::showpos << std::fixed
+                  << std::setprecision(1) << std::setw(9) << change << "%" << std::noshowpos
+                  << (regressed ? "  REGRESSED" : "") << std::endl;
+    }
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    return regressions;
+}
+
+// =============================================================================
+// End to end
+// =============================================================================
+
+/// One compile phase, over every timed run of dmcompiler
+struct PhaseResult {
+    std::string Name;
+    int Depth = 0;
+    std::vector<double> WallMs;
+    std::vector<double> CpuMs;
+    uint64_t PeakRssBytes = 0;  // Highest of any run
+    uint64_t Allocations = 0;   // Fewest of any run
+
+    double MinWallMs() const { return *std::min_element(WallMs.begin(), WallMs.end()); }
+    double MinCpuMs() const { return *std::min_element(CpuMs.begin(), CpuMs.end()); }
+};
+
+std::string Quote(const std::string& argument) {
+    return "\"" + argument + "\"";
+}
+
+/// Compile a codebase with dmcompiler --timings=json, its output discarded,
+/// and add what its timings file says to phases
+/// @return false if it did not compile or wrote no timings
+bool TimeCompile(const std::string& compiler, const fs::path& dme, const std::vector<std::string>& compilerArgs,
+                 std::vector<PhaseResult>& phases, double& wallMs) {
+    fs::path timingsPath = fs::path(dme).replace_extension(".timings.json");
+    std::error_code ec;
+    fs::remove(timingsPath, ec);
+
+    std::string command = Quote(compiler) + " " + Quote(dme.string()) + " --timings=json";
+    for (const std::string& argument : compilerArgs) {
+        command += " " + Quote(argument);
+    }
+#ifdef _WIN32
+    command = "\"" + command + " > NUL 2>&1\"";  // cmd strips the outer quotes
+#else
+    command += " > /dev/null 2>&1";
+#endif
+    auto start = std::chrono::steady_clock::now();
+    int status = std::system(command.c_str());
+    wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (status != 0) {
+        std::cerr << "Error: " << compiler << " failed to compile " << dme.string() << std::endl;
+        return false;
+    }
+
+    std::ifstream in(timingsPath, std::ios::binary);
+    nlohmann::json timings = nlohmann::json::parse(in, nullptr, false);
+    if (timings.is_discarded() || !timings.contains("Phases")) {
+        std::cerr << "Error: " << compiler << " wrote no timings to " << timingsPath.string() << std::endl;
+        return false;
+    }
+    size_t index = 0;
+    for (const nlohmann::json& entry : timings["Phases"]) {
+        std::string name = entry.value("Name", "");
+        // Phases are matched by position; a run that took another path starts the list over
+        if (index == phases.size() || phases[index].Name != name) {
+            phases.resize(index);
+            phases.push_back({name, entry.value("Depth", 0), {}, {}, 0, UINT64_MAX});
+        }
+        PhaseResult& phase = phases[index++];
+        phase.WallMs.push_back(entry.value("WallMs", 0.0));
+        phase.CpuMs.push_back(entry.value("CpuMs", 0.0));
+        phase.PeakRssBytes = std::max(phase.PeakRssBytes, entry.value("PeakRssBytes", uint64_t{0}));
+        phase.Allocations = std::min(phase.Allocations, entry.value("Allocations", uint64_t{0}));
+    }
+    phases.resize(index);
+    fs::remove(timingsPath, ec);
+    return true;
+}
+
+bool WriteEndToEndResults(const std::string& path, const std::string& build, const std::string& codebase,
+                          const std::vector<PhaseResult>& phases, const std::vector<double>& totalMs) {
+    JsonWriter json;
+    json.BeginObject();
+    if (!build.empty()) {
+        json.WriteKeyValue("Build", build);
+    }
+    json.WriteKeyValue("Codebase", codebase);
+    json.WriteKeyValue("Iterations", static_cast<int>(totalMs.size()));
+    json.WriteKey("TotalMs");
+    json.WriteDouble(*std::min_element(totalMs.begin(), totalMs.end()));
+    json.WriteKey("Phases");
+    json.BeginArray();
+    for (const PhaseResult& phase : phases) {
+        json.BeginObject();
+        json.WriteKeyValue("Name", phase.Name);
+        json.WriteKeyValue("Depth", phase.Depth);
+        json.WriteKey("WallMs");
+        json.WriteDouble(phase.MinWallMs());
+        json.WriteKey("CpuMs");
+        json.WriteDouble(phase.MinCpuMs());
+        json.WriteKey("PeakRssBytes");
+        json.WriteInt64(static_cast<int64_t>(phase.PeakRssBytes));
+        json.WriteKey("Allocations");
+        json.WriteInt64(static_cast<int64_t>(phase.Allocations));
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+
+    std::ofstream out(path, std::ios::binary);
+    out << json.ToString() << "\n";
+    if (!out) {
+        std::cerr << "Error: Cannot write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/// Compare each phase's fastest wall time and its peak memory with the baseline's.
+/// Phases the baseline ran in under minMs are shown but not failed, being mostly noise.
+/// @return How many figures grew by more than tolerance percent, or -1 if
+///         the baseline cannot be compared with
+int CountPhaseRegressions(const std::string& baselinePath, double tolerance, double minMs, const std::string& codebase,
+                          const std::vector<PhaseResult>& phases) {
+    std::ifstream in(baselinePath, std::ios::binary);
+    nlohmann::json baseline = nlohmann::json::parse(in, nullptr, false);
+    if (baseline.is_discarded() || !baseline.contains("Phases")) {
+        std::cerr << "Error: " << baselinePath << " is not an end-to-end results file" << std::endl;
+        return -1;
+    }
+    if (baseline.value("Codebase", "") != codebase) {
+        std::cerr << "Error: " << baselinePath << " was run on " << baseline.value("Codebase", "another codebase")
+                  << std::endl;
+        return -1;
+    }
+
+    auto change = [](double now, double before) { return before > 0 ? (now / before - 1) * 100 : 0; };
+    int regressions = 0;
+    std::cout << "\nAgainst " << baselinePath << DescribeBuild(baseline) << " (tolerance " << tolerance << "%):"
+              << std::endl;
+    std::cout << std::left << std::setw(32) << "  Phase" << std::right << std::setw(10) << "Time" << std::setw(10)
+              << "Memory" << std::endl;
+    std::cout << std::showpos << std::fixed << std::setprecision(1);
+    for (const PhaseResult& phase : phases) {
+        const nlohmann::json* previous = nullptr;
+        for (const nlohmann::json& entry : baseline["Phases"]) {
+            if (entry.value("Name", "") == phase.Name) {
+                previous = &entry;
+            }
+        }
+        std::string name = "  " + std::string(2 * phase.Depth, ' ') + phase.Name;
+        if (!previous) {
+            std::cout << std::left << std::setw(32) << name << std::right << "  not in the baseline" << std::endl;
+            continue;
+        }
+        double beforeMs = previous->value("WallMs", 0.0);
+        double timeChange = change(phase.MinWallMs(), beforeMs);
+        double memoryChange = change(static_cast<double>(phase.PeakRssBytes),
+                                     static_cast<double>(previous->value("PeakRssBytes", uint64_t{0})));
+        bool slower = beforeMs >= minMs && timeChange > tolerance;
+        bool bigger = memoryChange > tolerance;
+        regressions += (slower ? 1 : 0) + (bigger ? 1 : 0);
+        std::cout << std::left << std::setw(32) << name << std::right << std::setw(9) << timeChange << "%"
+                  << std::setw(9) << memoryChange << "%" << (slower ? "  SLOWER" : "") << (bigger ? "  BIGGER" : "")
+                  << std::endl;
+    }
+    std::cout << std::noshowpos;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+    return regressions;
+}
+
+struct EndToEndOptions {
+    std::string Dme;       // Empty for the generated codebase
+    std::string Compiler;  // Empty for the dmcompiler next to dm_benchmarks
+    std::vector<std::string> CompilerArgs;
+    std::string JsonPath;
+    std::string BaselinePath;
+    std::string Build;
+    double Tolerance = 10;
+    double MinMs = 10;
+    int Iterations = 3;
+};
+
+int RunEndToEnd(const EndToEndOptions& options, const CodebaseShape& shape, const char* argv0) {
+    std::string compiler = options.Compiler;
+    if (compiler.empty()) {
+#ifdef _WIN32
+        const char* compilerName = "dmcompiler.exe";
+#else
+        const char* compilerName = "dmcompiler";
+#endif
+        compiler = (fs::absolute(argv0).parent_path() / compilerName).lexically_normal().string();
+    }
+
+    // Baselines name the codebase by its file (or shape), so they still apply in another checkout
+    fs::path dme = options.Dme;
+    std::string codebase = dme.filename().string();
+    fs::path generated;
+    std::error_code ec;
+    if (dme.empty()) {
+        generated = fs::temp_directory_path() / ("dm_benchmarks_end_to_end_" + std::to_string(shape.Seed));
+        fs::remove_all(generated, ec);
+        if (!WriteCodebase(generated, GenerateCodebase(shape))) {
+            return 1;
+        }
+        dme = generated / "synthetic.dme";
+        codebase = "synthetic: " + std::to_string(shape.Types) + " types, " + std::to_string(shape.Procs) + " procs, " +
+                   std::to_string(shape.GlobalProcs) + " global procs, " + std::to_string(shape.Maps) + " maps of " +
+                   std::to_string(shape.MapSize) + "x" + std::to_string(shape.MapSize) + ", seed " + std::to_string(shape.Seed);
+    }
+    std::cout << "Compiling " << codebase << " with " << compiler << ", " << options.Iterations
+              << " timed runs after a warm-up" << std::endl;
+
+    std::vector<PhaseResult> phases;
+    std::vector<double> totalMs;
+    bool compiled = true;
+    for (int i = 0; i <= options.Iterations && compiled; i++) {
+        std::vector<PhaseResult> warmUp;
+        double wallMs;
+        compiled = TimeCompile(compiler, dme, options.CompilerArgs, i == 0 ? warmUp : phases, wallMs);
+        if (i > 0) {
+            totalMs.push_back(wallMs);
+        }
+    }
+    if (!generated.empty()) {
+        fs::remove_all(generated, ec);
+    }
+    if (!compiled) {
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(32) << "Phase" << std::right << std::setw(12) << "Wall ms" << std::setw(12)
+              << "CPU ms" << std::setw(14) << "Peak RSS MB" << std::setw(14) << "Allocations" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    for (const PhaseResult& phase : phases) {
+        std::cout << std::left << std::setw(32) << std::string(2 * phase.Depth, ' ') + phase.Name << std::right
+                  << std::setw(12) << phase.MinWallMs() << std::setw(12) << phase.MinCpuMs() << std::setw(14)
+                  << phase.PeakRssBytes / (1024.0 * 1024.0) << std::setw(14) << phase.Allocations << std::endl;
+    }
+    std::cout << std::left << std::setw(32) << "Process" << std::right << std::setw(12)
+              << *std::min_element(totalMs.begin(), totalMs.end()) << std::endl;
+    std::cout.unsetf(std::ios::floatfield);
+    std::cout << std::setprecision(6);
+
+    if (!options.JsonPath.empty() && !WriteEndToEndResults(options.JsonPath, options.Build, codebase, phases, totalMs)) {
+        return 1;
+    }
+    if (!options.BaselinePath.empty()) {
+        int regressions = CountPhaseRegressions(options.BaselinePath, options.Tolerance, options.MinMs, codebase, phases);
+        if (regressions > 0) {
+            std::cerr << regressions << " phase figure(s) regressed" << std::endl;
+        }
+        return regressions != 0 ? 1 : 0;
+    }
+    return 0;
+}
+
+void PrintUsage() {
+    std::cout << "Usage: dm_benchmarks [options] [name...]\n"
+              << "       dm_benchmarks generate <directory> [shape options]\n"
+              << "       dm_benchmarks end-to-end [file.dme] [options] [-- dmcompiler options]\n"
+              << "Runs the named benchmarks (all by default) on a generated codebase.\n"
+              << "end-to-end instead times each phase of dmcompiler --timings=json compiling\n"
+              << "file.dme (the generated codebase by default).\n"
+              << "Options:\n"
+              << "  --json <file>        Write the results as JSON\n"
+              << "  --baseline <file>    Fail if a benchmark is slower than in these results\n"
+              << "  --tolerance <pct>    How much slower than the baseline is allowed (default 10)\n"
+              << "  --build <name>       The build being measured, recorded in the results (e.g. lto+march=native)\n"
+              << "  --iterations <n>     Timed runs of each benchmark, after one warm-up (default 5, end-to-end 3)\n"
+              << "  --scale <factor>     Multiply the codebase's size (default 1)\n"
+              << "  --list               List the benchmarks\n"
+              << "end-to-end options:\n"
+              << "  --compiler <file>    dmcompiler to run (default: the one next to dm_benchmarks)\n"
+              << "  --min-ms <ms>        Phases the baseline ran in faster than this are not failed (default 10)\n"
+              << "Shape options:\n"
+              << "  --types <n>          /obj types (default 1000)\n"
+              << "  --procs <n>          Procs on those types (default 5000)\n"
+              << "  --global-procs <n>   Global procs (default 100)\n"
+              << "  --maps <n>           Maps (default 1)\n"
+              << "  --map-size <n>       Width and height of each map (default 100)\n"
+              << "  --seed <n>           What the code and maps are generated from (default 1)\n";
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    CodebaseShape shape;
+    std::string jsonPath;
+    std::string baselinePath;
+    std::string generateDirectory;
+    std::string build;
+    double tolerance = 10;
+    double scale = 1;
+    int iterations = 0;  // The mode's default
+    bool endToEnd = false;
+    EndToEndOptions endToEndOptions;
+    std::vector<std::string> selected;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(arg + " needs a value");
+                }
+                return argv[++i];
+            };
+            if (arg == "--help" || arg == "-h") {
+                PrintUsage();
+                return 0;
+            } else if (arg == "--list") {
+                for (const Benchmark& benchmark : Benchmarks()) {
+                    std::cout << benchmark.Name << std::endl;
+                }
+                return 0;
+            } else if (arg == "generate" && i == 1) {
+                generateDirectory = value();
+            } else if (arg == "end-to-end" && i == 1) {
+                endToEnd = true;
+            } else if (arg == "--") {
+                endToEndOptions.CompilerArgs.assign(argv + i + 1, argv + argc);
+                break;
+            } else if (arg == "--compiler") {
+                endToEndOptions.Compiler = value();
+            } else if (arg == "--min-ms") {
+                endToEndOptions.MinMs = std::stod(value());
+            } else if (arg == "--json") {
+                jsonPath = value();
+            } else if (arg == "--baseline") {
+                baselinePath = value();
+            } else if (arg == "--build") {
+                build = value();
+            } else if (arg == "--tolerance") {
+                tolerance = std::stod(value());
+            } else if (arg == "--iterations") {
+                iterations = std::max(1, std::stoi(value()));
+            } else if (arg == "--scale") {
+                scale = std::stod(value());
+            } else if (arg == "--types") {
+                shape.Types = std::max(1, std::stoi(value()));
+            } else if (arg == "--procs") {
+                shape.Procs = std::max(0, std::stoi(value()));
+            } else if (arg == "--global-procs") {
+                shape.GlobalProcs = std::max(1, std::stoi(value()));
+            } else if (arg == "--maps") {
+                shape.Maps = std::max(0, std::stoi(value()));
+            } else if (arg == "--map-size") {
+                shape.MapSize = std::max(1, std::stoi(value()));
+            } else if (arg == "--seed") {
+                shape.Seed = static_cast<uint32_t>(std::stoul(value()));
+            } else if (!arg.empty() && arg[0] == '-') {
+                throw std::invalid_argument("Unknown option " + arg);
+            } else {
+                selected.push_back(arg);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        PrintUsage();
+        return 1;
+    }
+    if (scale != 1) {
+        shape.Scale(scale);
+    }
+
+    if (endToEnd) {
+        if (selected.size() > 1) {
+            std::cerr << "Error: end-to-end compiles one codebase" << std::endl;
+            return 1;
+        }
+        endToEndOptions.Dme = selected.empty() ? "" : selected[0];
+        endToEndOptions.JsonPath = jsonPath;
+        endToEndOptions.BaselinePath = baselinePath;
+        endToEndOptions.Build = build;
+        endToEndOptions.Tolerance = tolerance;
+        if (iterations > 0) {
+            endToEndOptions.Iterations = iterations;
+        }
+        return RunEndToEnd(endToEndOptions, shape, argv[0]);
+    }
+    if (iterations == 0) {
+        iterations = 5;
+    }
+
+    if (!generateDirectory.empty()) {
+        std::vector<GeneratedFile> files = GenerateCodebase(shape);
+        if (!WriteCodebase(generateDirectory, files)) {
+            return 1;
+        }
+        std::cout << "Wrote " << files.size() << " files to " << generateDirectory << ": " << shape.Types
+                  << " types, " << shape.Procs << " procs, " << shape.Maps << " maps" << std::endl;
+        return 0;
+    }
+
+    for (const std::string& name : selected) {
+        bool known = std::any_of(Benchmarks().begin(), Benchmarks().end(),
+                                 [&](const Benchmark& benchmark) { return name == benchmark.Name; });
+        if (!known) {
+            std::cerr << "Error: Unknown benchmark " << name << " (see --list)" << std::endl;
+            return 1;
+        }
+    }
+
+    BenchmarkContext context;
+    context.Shape = shape;
+    context.Build = build;
+    context.Directory = fs::temp_directory_path() / ("dm_benchmarks_" + std::to_string(shape.Seed));
+    context.Files = GenerateCodebase(shape);
+    for (const GeneratedFile& file : context.Files) {
+        if (fs::path(file.Path).extension() == ".dm") {
+            context.Source += file.Contents;
+        }
+    }
+    std::error_code ec;
+    fs::remove_all(context.Directory, ec);
+    if (!WriteCodebase(context.Directory, context.Files)) {
+        return 1;
+    }
+
+    std::cout << "Codebase: " << shape.Types << " types, " << shape.Procs << " procs, " << shape.Maps << " maps of "
+              << shape.MapSize << "x" << shape.MapSize << ", " << context.Source.size() / 1024 << " KiB of code"
+              << std::endl;
+    std::cout << std::left << std::setw(24) << "Benchmark" << std::right << std::setw(12) << "Min ms"
+              << std::setw(12) << "Median ms" << std::setw(16) << "Items/s" << std::endl;
+
+    std::vector<BenchmarkResult> results;
+    int failures = 0;
+    for (const Benchmark& benchmark : Benchmarks()) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), benchmark.Name) == selected.end()) {
+            continue;
+        }
+        BenchmarkResult result;
+        result.Name = benchmark.Name;
+        result.Unit = benchmark.Unit;
+        try {
+            BenchmarkRun run = benchmark.Prepare(context);
+            result.Items = run();  // Warm-up
+            for (int i = 0; i < iterations; i++) {
+                auto start = std::chrono::steady_clock::now();
+                run();
+                result.Ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "FAILED: " << benchmark.Name << ": " << e.what() << std::endl;
+            failures++;
+            continue;
+        }
+        std::cout << std::left << std::setw(24) << result.Name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << result.Min() << std::setw(12) << result.Median() << std::setprecision(0)
+                  << std::setw(16) << result.ItemsPerSecond() << " " << result.Unit << std::endl;
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+        results.push_back(std::move(result));
+    }
+    fs::remove_all(context.Directory, ec);
+
+    if (!jsonPath.empty() && !WriteResults(jsonPath, context, results)) {
+        return 1;
+    }
+    if (!baselinePath.empty()) {
+        int regressions = CountRegressions(baselinePath, tolerance, context, results);
+        if (regressions > 0) {
+            std::cerr << regressions << " benchmark(s) regressed" << std::endl;
+        }
+        failures += regressions != 0 ? 1 : 0;
+    }
+    return failures > 0 ? 1 : 0;
+}
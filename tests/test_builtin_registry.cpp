@@ -1,6 +1,7 @@
 #include "DMBuiltinRegistry.h"
 #include "DMValueType.h"
 #include "DreamPath.h"
+#include "PerfectHash.h"
 #include <iostream>
 #include <cassert>
 
@@ -135,6 +136,28 @@ void TestTypeHierarchy() {
     std::cout << "Type Hierarchy OK" << std::endl;
 }
 
+void TestPerfectHash() {
+    std::cout << "Testing Perfect Hash..." << std::endl;
+    
+    constexpr std::string_view names[] = {"Add", "Remove", "Cut", "Copy", "Insert", "Swap", "Find", "Join"};
+    constexpr auto table = BuildPerfectHash(std::array<uint32_t, 8>{
+        HashName(names[0]), HashName(names[1]), HashName(names[2]), HashName(names[3]),
+        HashName(names[4]), HashName(names[5]), HashName(names[6]), HashName(names[7])});
+    static_assert(table.Complete, "distinct names always get a perfect hash");
+    
+    for (int i = 0; i < 8; ++i) {
+        assert(table.Find(HashName(names[i])) == i);
+    }
+    int missing = table.Find(HashName("Splice"));
+    assert(missing == -1 || names[missing] != "Splice");
+    
+    // Two keys with one hash cannot be told apart
+    constexpr auto clash = BuildPerfectHash(std::array<uint32_t, 2>{HashName("Add"), HashName("Add")});
+    static_assert(!clash.Complete, "equal hashes cannot be separated");
+    
+    std::cout << "Perfect Hash OK" << std::endl;
+}
+
 int main() {
     std::cout << "Running DMBuiltinRegistry tests..." << std::endl;
     
@@ -143,6 +166,7 @@ int main() {
     TestBuiltinVars();
     TestContextVars();
     TestTypeHierarchy();
+    TestPerfectHash();
     
     std::cout << "All DMBuiltinRegistry tests passed!" << std::endl;
     return 0;
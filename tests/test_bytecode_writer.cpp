@@ -1,9 +1,11 @@
 /// @file test_bytecode_writer.cpp
-/// @brief Unit tests for BytecodeWriter enhancements (filter type emission)
+/// @brief Unit tests for BytecodeWriter enhancements (filter type emission, bytecode optimization)
 
 #include "../include/BytecodeWriter.h"
+#include "../include/ControlFlowGraph.h"
 #include "../include/DreamProcOpcode.h"
 #include "../include/DreamPath.h"
+#include "../include/OperandEncoding.h"
 #include <iostream>
 #include <vector>
 #include <cassert>
@@ -107,12 +109,318 @@ TEST(TestCreateFilteredListEnumerator_NullPath) {
     EXPECT_EQ(writer.ReadInt(5), filterTypeId);
 }
 
+TEST(TestOptimizeFoldsConstantBranch) {
+    MockBytecodeWriter writer;
+    int endLabel = writer.CreateLabel();
+    
+    // if (2 < 3) return 7; return null
+    writer.EmitFloat(DreamProcOpcode::PushFloat, 2.0f);
+    writer.EmitFloat(DreamProcOpcode::PushFloat, 3.0f);
+    writer.Emit(DreamProcOpcode::CompareLessThan);
+    writer.EmitJump(DreamProcOpcode::JumpIfFalse, endLabel);
+    writer.EmitFloat(DreamProcOpcode::PushFloat, 7.0f);
+    writer.Emit(DreamProcOpcode::Return);
+    writer.MarkLabel(endLabel);
+    writer.Emit(DreamProcOpcode::PushNull);
+    writer.Emit(DreamProcOpcode::Return);
+    
+    writer.Optimize();
+    writer.Finalize();
+    
+    // ReturnFloat 7, with the return null after it unreachable
+    EXPECT_EQ(writer.GetBytecode().size(), 5);
+    EXPECT_EQ(writer.ReadOpcode(0), DreamProcOpcode::ReturnFloat);
+    EXPECT_EQ(writer.ReadInt(1), 0x40E00000);
+}
+
+TEST(TestOptimizeThreadsJumps) {
+    MockBytecodeWriter writer;
+    int hopLabel = writer.CreateLabel();
+    int bodyLabel = writer.CreateLabel();
+    
+    writer.Emit(DreamProcOpcode::PushNull);
+    writer.EmitJump(DreamProcOpcode::JumpIfFalse, hopLabel);
+    writer.MarkLabel(bodyLabel);
+    writer.Emit(DreamProcOpcode::PushNull);
+    writer.Emit(DreamProcOpcode::Return);
+    writer.MarkLabel(hopLabel);
+    writer.EmitJump(DreamProcOpcode::Jump, bodyLabel);
+    
+    writer.Optimize();
+    writer.Finalize();
+    
+    // The branch goes straight to the body, and nothing reaches the hop any more
+    EXPECT_EQ(writer.GetBytecode().size(), 8);
+    EXPECT_EQ(writer.ReadOpcode(1), DreamProcOpcode::JumpIfFalse);
+    EXPECT_EQ(writer.ReadInt(2), 0);
+    EXPECT_EQ(writer.ReadOpcode(7), DreamProcOpcode::Return);
+}
+
+TEST(TestOptimizeKeepsJumpTargets) {
+    MockBytecodeWriter writer;
+    int popLabel = writer.CreateLabel();
+    
+    // The Pop is also reached by the jump, so it cannot cancel the push
+    writer.EmitFloat(DreamProcOpcode::PushFloat, 1.0f);
+    writer.MarkLabel(popLabel);
+    writer.Emit(DreamProcOpcode::Pop);
+    writer.EmitJump(DreamProcOpcode::Jump, popLabel);
+    
+    writer.Optimize();
+    writer.Finalize();
+    
+    EXPECT_EQ(writer.GetBytecode().size(), 11);
+    EXPECT_EQ(writer.ReadOpcode(5), DreamProcOpcode::Pop);
+    EXPECT_EQ(writer.ReadInt(7), -6);
+}
+
+TEST(TestOptimizeDropsDeadStores) {
+    // var/x = 1; x = 2; return x
+    auto emitProc = [](BytecodeWriter& writer) {
+        writer.EmitFloat(DreamProcOpcode::PushFloat, 1.0f);
+        writer.ResizeStack(1);
+        writer.EmitMulti(DreamProcOpcode::AssignNoPush, {9, 0});
+        writer.ResizeStack(-1);
+        writer.EmitFloat(DreamProcOpcode::PushFloat, 2.0f);
+        writer.ResizeStack(1);
+        writer.EmitMulti(DreamProcOpcode::AssignNoPush, {9, 0});
+        writer.ResizeStack(-1);
+        writer.EmitMulti(DreamProcOpcode::ReturnReferenceValue, {28, 0});
+    };
+    
+    MockBytecodeWriter writer;
+    emitProc(writer);
+    writer.Optimize();
+    writer.Finalize();
+    EXPECT_EQ(writer.GetBytecode().size(), 11);
+    EXPECT_EQ(writer.ReadInt(1), 0x40000000);
+    EXPECT_EQ(writer.GetMaxStackSize(), 1);
+    
+    // Stores to an argument are kept
+    MockBytecodeWriter argumentWriter;
+    emitProc(argumentWriter);
+    argumentWriter.Optimize(1);
+    argumentWriter.Finalize();
+    EXPECT_EQ(argumentWriter.GetBytecode().size(), 19);
+}
+
+TEST(TestOptimizeFusesSuperinstructions) {
+    // if (x) return null; return 1
+    auto emitProc = [](BytecodeWriter& writer) {
+        int endLabel = writer.CreateLabel();
+        writer.EmitMulti(DreamProcOpcode::PushReferenceValue, {28, 0});
+        writer.EmitJump(DreamProcOpcode::JumpIfFalse, endLabel);
+        writer.Emit(DreamProcOpcode::PushNull);
+        writer.Emit(DreamProcOpcode::Return);
+        writer.MarkLabel(endLabel);
+        writer.EmitFloat(DreamProcOpcode::PushFloat, 1.0f);
+        writer.Emit(DreamProcOpcode::Return);
+    };
+    
+    MockBytecodeWriter writer;
+    emitProc(writer);
+    writer.Optimize();
+    writer.Finalize();
+    EXPECT_EQ(writer.GetBytecode().size(), 15);
+    EXPECT_EQ(writer.ReadOpcode(0), DreamProcOpcode::PushReferenceValue);
+    
+    // The fused jump reads the reference first, and still lands on the ReturnFloat
+    MockBytecodeWriter fusedWriter;
+    emitProc(fusedWriter);
+    fusedWriter.Optimize(0, true);
+    fusedWriter.Finalize();
+    EXPECT_EQ(fusedWriter.GetBytecode().size(), 14);
+    EXPECT_EQ(fusedWriter.ReadOpcode(0), DreamProcOpcode::JumpIfReferenceFalse);
+    EXPECT_EQ(fusedWriter.ReadInt(3), 2);
+    EXPECT_EQ(fusedWriter.ReadOpcode(9), DreamProcOpcode::ReturnFloat);
+}
+
+TEST(TestAnalyzeStackFollowsOpcodeTable) {
+    // return list(1, 2), with no ResizeStack() calls at all
+    MockBytecodeWriter uncounted;
+    uncounted.EmitFloat(DreamProcOpcode::PushFloat, 1.0f);
+    uncounted.EmitFloat(DreamProcOpcode::PushFloat, 2.0f);
+    uncounted.Emit(DreamProcOpcode::CreateList);
+    uncounted.AppendInt(2);
+    uncounted.Emit(DreamProcOpcode::Return);
+    EXPECT_EQ(uncounted.GetMaxStackSize(), 0);
+    EXPECT_EQ(uncounted.AnalyzeStack().empty(), false);
+    EXPECT_EQ(uncounted.GetMaxStackSize(), 2);
+    
+    // x &&= 1; return: the jump keeps x on the stack, like the assignment does
+    MockBytecodeWriter counted;
+    int endLabel = counted.CreateLabel();
+    counted.EmitJumpWithReference(DreamProcOpcode::JumpIfFalseReference, {9, 0}, endLabel);
+    counted.EmitFloat(DreamProcOpcode::PushFloat, 1.0f);
+    counted.ResizeStack(1);
+    counted.EmitMulti(DreamProcOpcode::Assign, {9, 0});
+    counted.MarkLabel(endLabel);
+    counted.Emit(DreamProcOpcode::Return);
+    counted.ResizeStack(-1);
+    EXPECT_EQ(counted.AnalyzeStack().empty(), true);
+    EXPECT_EQ(counted.GetMaxStackSize(), 1);
+}
+
+TEST(TestCompactOperands) {
+    // Jump over a push of type 300 to a push of string 0, then return
+    MockBytecodeWriter writer;
+    int label = writer.CreateLabel();
+    writer.EmitJump(DreamProcOpcode::Jump, label);
+    writer.EmitInt(DreamProcOpcode::PushType, 300);
+    writer.MarkLabel(label);
+    writer.EmitString(DreamProcOpcode::PushString, "a");
+    writer.Emit(DreamProcOpcode::Return);
+    EXPECT_EQ(writer.GetPosition(), 16);
+    
+    writer.CompactOperands();
+    writer.Finalize();
+    const auto& bytecode = writer.GetBytecode();
+    EXPECT_EQ(bytecode.size(), 11);
+    // The label keeps its 4 bytes and now skips the 3 the push of type 300 takes
+    EXPECT_EQ(writer.ReadInt(1), 3);
+    EXPECT_EQ(bytecode[5], static_cast<uint8_t>(DreamProcOpcode::PushType));
+    EXPECT_EQ(bytecode[6], 0xAC);
+    EXPECT_EQ(bytecode[7], 0x02);
+    EXPECT_EQ(bytecode[8], static_cast<uint8_t>(DreamProcOpcode::PushString));
+    EXPECT_EQ(bytecode[9], 0);
+}
+
+TEST(TestDecodeInstruction) {
+    MockBytecodeWriter writer;
+    int label = writer.CreateLabel();
+    writer.EmitJump(DreamProcOpcode::Jump, label);
+    writer.EmitInt(DreamProcOpcode::PushType, 300);
+    writer.MarkLabel(label);
+    writer.EmitMulti(DreamProcOpcode::PushReferenceValue, {28, 0});
+    writer.Emit(DreamProcOpcode::Return);
+    writer.Finalize();
+    std::vector<uint8_t> fixed = writer.GetBytecode();
+    
+    // Each instruction's operands, and the lengths add up to the bytes
+    std::vector<size_t> lengths;
+    for (size_t pc = 0; pc < fixed.size(); pc += lengths.back()) {
+        DecodedInstruction instruction = DecodeInstruction(fixed, pc, OperandEncoding::Fixed);
+        EXPECT_EQ(instruction.Truncated, false);
+        lengths.push_back(instruction.Length);
+    }
+    EXPECT_EQ(lengths.size(), 4);
+    EXPECT_EQ(lengths[0], 5);
+    EXPECT_EQ(lengths[2], 3);
+    DecodedInstruction jump = DecodeInstruction(fixed, 0, OperandEncoding::Fixed);
+    EXPECT_EQ(jump.OperandCount, 1);
+    // Jump offsets count from the end of the offset, over the push of type 300
+    EXPECT_EQ(ReadOperandValue(fixed, 0, jump.Operands[0], OperandEncoding::Fixed), 5);
+    DecodedInstruction push = DecodeInstruction(fixed, 10, OperandEncoding::Fixed);
+    EXPECT_EQ(push.Operands[0].Type == OpcodeArgType::Reference, true);
+    EXPECT_EQ(ReadOperandValue(fixed, 10, push.Operands[0], OperandEncoding::Fixed), 0);
+    
+    // The same instructions with compact operands
+    MockBytecodeWriter compactWriter;
+    label = compactWriter.CreateLabel();
+    compactWriter.EmitJump(DreamProcOpcode::Jump, label);
+    compactWriter.EmitInt(DreamProcOpcode::PushType, 300);
+    compactWriter.MarkLabel(label);
+    compactWriter.Emit(DreamProcOpcode::Return);
+    compactWriter.CompactOperands();
+    compactWriter.Finalize();
+    const auto& compact = compactWriter.GetBytecode();
+    DecodedInstruction pushType = DecodeInstruction(compact, 5, OperandEncoding::Leb128);
+    EXPECT_EQ(pushType.Length, 3);
+    EXPECT_EQ(ReadOperandValue(compact, 5, pushType.Operands[0], OperandEncoding::Leb128), 300);
+    
+    // Cut short, it takes what is left
+    std::vector<uint8_t> cut(fixed.begin(), fixed.begin() + 3);
+    DecodedInstruction truncated = DecodeInstruction(cut, 0, OperandEncoding::Fixed);
+    EXPECT_EQ(truncated.Truncated, true);
+    EXPECT_EQ(truncated.Length, 3);
+    EXPECT_EQ(truncated.OperandCount, 0);
+    
+    // Derived from the operand kinds
+    const OpcodeMetadata& metadata = GetOpcodeMetadata(DreamProcOpcode::JumpIfFalse);
+    EXPECT_EQ(metadata.HasLabel, true);
+    EXPECT_EQ(metadata.FixedLength, 5);
+    EXPECT_EQ(GetOpcodeMetadata(DreamProcOpcode::Call).HasReference, true);
+}
+
+TEST(TestPooledWriterIsReset) {
+    size_t firstSize = 0;
+    {
+        PooledBytecodeWriter writer(nullptr);
+        writer->EmitMulti(DreamProcOpcode::PushReferenceValue, {28, 0});
+        writer->ResizeStack(1);
+        writer->Emit(DreamProcOpcode::Return);
+        writer->Finalize();
+        std::vector<uint8_t> bytecode = writer->TakeBytecode();
+        firstSize = bytecode.size();
+        EXPECT_EQ(writer->GetPosition(), 0);
+    }
+    EXPECT_EQ(firstSize, 4);
+    
+    // The next proc on this thread gets the same writer back, emptied
+    PooledBytecodeWriter writer(nullptr);
+    EXPECT_EQ(writer->GetPosition(), 0);
+    EXPECT_EQ(writer->GetMaxStackSize(), 0);
+    EXPECT_EQ(writer->CreateLabel(), 0);
+    
+    // Operands past the inline bytes still come out whole
+    OperandBytes operands;
+    for (uint8_t i = 0; i < 20; ++i) {
+        operands.push_back(i);
+    }
+    writer->EmitMulti(DreamProcOpcode::PushReferenceValue, operands);
+    EXPECT_EQ(writer->GetPosition(), 21);
+    EXPECT_EQ(writer->GetBytecode()[20], 19);
+}
+
+TEST(TestControlFlowGraphLiveness) {
+    auto make = [](DreamProcOpcode opcode, std::vector<uint8_t> operands) {
+        BytecodeInstruction instruction;
+        instruction.Opcode = opcode;
+        instruction.Bytes.push_back(static_cast<uint8_t>(opcode));
+        instruction.Bytes.insert(instruction.Bytes.end(), operands.begin(), operands.end());
+        return instruction;
+    };
+    
+    // if (x) return 1; y = 2; return y
+    std::vector<BytecodeInstruction> instructions;
+    instructions.push_back(make(DreamProcOpcode::PushReferenceValue, {28, 0}));
+    instructions.push_back(make(DreamProcOpcode::JumpIfFalse, {0, 0, 0, 0}));
+    instructions.back().JumpLabel = 0;
+    instructions.back().JumpOffset = 1;
+    instructions.push_back(make(DreamProcOpcode::ReturnFloat, {0, 0, 128, 63}));
+    instructions.push_back(make(DreamProcOpcode::PushFloat, {0, 0, 0, 64}));
+    instructions.back().Labels.push_back(0);
+    instructions.push_back(make(DreamProcOpcode::AssignNoPush, {9, 1}));
+    instructions.push_back(make(DreamProcOpcode::ReturnReferenceValue, {28, 1}));
+    
+    ControlFlowGraph graph(instructions);
+    graph.ComputeLiveness();
+    const auto& blocks = graph.GetBlocks();
+    EXPECT_EQ(blocks.size(), 3);
+    EXPECT_EQ(blocks[0].Successors.size(), 2);
+    EXPECT_EQ(blocks[1].Successors.size(), 0);
+    EXPECT_EQ(graph.BlockOf(4), 2);
+    EXPECT_EQ(blocks[0].LiveIn.test(0), true);
+    EXPECT_EQ(blocks[2].LiveIn.test(1), false);
+    EXPECT_EQ(graph.LiveAfter(4).test(1), true);
+}
+
 int main() {
     std::cout << "Running Bytecode Writer Tests..." << std::endl;
     std::cout << "========================================" << std::endl;
     
     TestCreateFilteredListEnumerator();
     TestCreateFilteredListEnumerator_NullPath();
+    TestOptimizeFoldsConstantBranch();
+    TestOptimizeThreadsJumps();
+    TestOptimizeKeepsJumpTargets();
+    TestOptimizeDropsDeadStores();
+    TestOptimizeFusesSuperinstructions();
+    TestAnalyzeStackFollowsOpcodeTable();
+    TestCompactOperands();
+    TestDecodeInstruction();
+    TestPooledWriterIsReset();
+    TestControlFlowGraphLiveness();
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "Bytecode Writer Tests: " << bytecode_tests_passed << "/" << bytecode_tests_run << " passed" << std::endl;
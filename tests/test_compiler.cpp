@@ -1,7 +1,31 @@
 #include "../include/DMCompiler.h"
+#include "../include/DMObjectTree.h"
+#include "../include/DMProc.h"
+#include "../include/DMObject.h"
+#include "../include/CompiledOutput.h"
+#include "../include/JsonWriter.h"
+#include "../include/OutputCompression.h"
+#include "../include/TokenSerialization.h"
+#include "../include/ResourceManifest.h"
+#include "../include/CompileTimings.h"
+#include "../include/CompileCosts.h"
+#include "../include/BatchCompiler.h"
+#include "../include/CompileServer.h"
+#include "../include/ProcCache.h"
+#include "../include/BytecodeVerifier.h"
+#include "../include/ProcProfile.h"
+#include "../include/OperandEncoding.h"
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <sstream>
+#include <map>
+#include <cstdio>
+#include <cstddef>
+#include <functional>
+#include <cstring>
+#include <cstdlib>
+#include <limits>
 
 void TestSimpleCompilation() {
     std::cout << "Testing simple compilation..." << std::endl;
@@ -64,12 +88,2117 @@ void TestWithActualDME() {
     }
 }
 
+bool TestParallelProcCompilation() {
+    std::cout << "Testing parallel proc compilation..." << std::endl;
+    
+    // Strings first used in different procs, a resource and a proc that warns
+    std::string testFile = "test_parallel_procs.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tvar/label = \"item\"\n";
+        out << "\tproc/Describe()\n";
+        out << "\t\treturn \"a [label] here\"\n";
+        out << "proc/First()\n";
+        out << "\tvar/x = \"alpha\"\n";
+        out << "\treturn x + \"beta\"\n";
+        out << "proc/Second()\n";
+        out << "\tvar/obj/item/I = new\n";
+        out << "\treturn I.label + \"gamma\" + \"alpha\"\n";
+        out << "proc/Third()\n";
+        out << "\tvar/icon = 'third.dmi'\n";
+        out << "\treturn icon\n";
+        out << "proc/Fourth()\n";
+        out << "\tvar/obj/item/I = new\n";
+        out << "\treturn I.missing_var + \"delta\"\n";
+        out << "proc/Fifth()\n";
+        out << "\tfor (var/i in list(\"epsilon\", \"beta\"))\n";
+        out << "\t\tworld << i\n";
+        out << "proc/Sixth()\n";
+        out << "\tvar/const/limit = 1\n";
+        out << "\tlimit = 2\n";
+        out << "\treturn \"zeta\"\n";
+    }
+    
+    struct Result {
+        std::vector<std::string> Strings;
+        std::vector<std::vector<uint8_t>> Bytecode;
+        size_t Resources = 0;
+        std::vector<std::string> Messages;
+    };
+    auto compile = [&](unsigned threads) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.CompileThreads = threads;
+        
+        DMCompiler::DMCompiler compiler;
+        compiler.Compile(settings);
+        
+        Result result;
+        result.Strings = compiler.GetObjectTree()->StringTable.ToVector();
+        for (auto* proc : compiler.GetObjectTree()->GetAllProcs()) {
+            result.Bytecode.push_back(proc->Bytecode);
+        }
+        result.Resources = compiler.GetObjectTree()->Resources.size();
+        result.Messages = compiler.GetCompilerMessages();
+        return result;
+    };
+    
+    Result sequential = compile(0);
+    Result parallel = compile(4);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_parallel_procs.json");
+    
+    if (parallel.Strings != sequential.Strings) {
+        std::cerr << "FAILED: String tables differ" << std::endl;
+        return false;
+    }
+    if (parallel.Bytecode != sequential.Bytecode) {
+        std::cerr << "FAILED: Proc bytecode differs" << std::endl;
+        return false;
+    }
+    if (parallel.Resources != sequential.Resources) {
+        std::cerr << "FAILED: Resources differ" << std::endl;
+        return false;
+    }
+    if (parallel.Messages != sequential.Messages || sequential.Messages.empty()) {
+        std::cerr << "FAILED: Diagnostics differ" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Parallel proc compilation test passed!" << std::endl;
+    return true;
+}
+
+bool TestDeterministicOutput() {
+    std::cout << "Testing output order across thread counts..." << std::endl;
+    
+    // Types with vars, overrides, const and tmp vars and several procs each,
+    // across files, so every unordered container the output reads has entries
+    std::filesystem::create_directories("test_deterministic");
+    {
+        std::ofstream out("test_deterministic/game.dme");
+        out << "#include \"mobs.dm\"\n";
+        out << "#include \"items.dm\"\n";
+    }
+    for (const char* file : {"mobs", "items"}) {
+        std::ofstream out(std::string("test_deterministic/") + file + ".dm");
+        for (int i = 0; i < 12; ++i) {
+            out << "/" << (file[0] == 'm' ? "mob" : "obj") << "/" << file << i << "\n";
+            out << "\tvar/label = \"" << file << i << "\"\n";
+            out << "\tvar/const/limit = " << i << "\n";
+            out << "\tvar/tmp/cache\n";
+            out << "\tvar/weight = " << i * 2 << "\n";
+            for (int p = 0; p < 4; ++p) {
+                out << "\tproc/Act" << p << "(x)\n";
+                out << "\t\treturn \"" << file << i << "_" << p << "\" + x + label\n";
+            }
+            out << "/" << (file[0] == 'm' ? "mob" : "obj") << "/" << file << i << "/child\n";
+            out << "\tlabel = \"child" << i << "\"\n";
+            out << "\tweight = 1\n";
+        }
+        out << "var/" << file << "_count = 12\n";
+    }
+    
+    auto compile = [](unsigned threads) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back("test_deterministic/game.dme");
+        settings.NoStandard = true;
+        settings.LexThreads = threads;
+        settings.ParseThreads = threads;
+        settings.CompileThreads = threads;
+        settings.OutputThreads = threads;
+        DMCompiler::DMCompiler compiler;
+        std::string contents;
+        if (compiler.Compile(settings)) {
+            DMCompiler::ReadBinaryFile("test_deterministic/game.json", contents);
+        }
+        return contents;
+    };
+    std::string sequential = compile(0);
+    std::string parallel = compile(4);
+    std::string wide = compile(8);
+    
+    std::filesystem::remove_all("test_deterministic");
+    
+    if (sequential.empty() || sequential.find("\"items11\"") == std::string::npos) {
+        std::cerr << "FAILED: The test project did not compile" << std::endl;
+        return false;
+    }
+    if (parallel != sequential || wide != sequential) {
+        std::cerr << "FAILED: The JSON output differs between thread counts" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Output order test passed!" << std::endl;
+    return true;
+}
+
+bool TestDiagnosticBuffer() {
+    std::cout << "Testing buffered diagnostics..." << std::endl;
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::Location location("buffered.dm", 3, 1);
+    DMCompiler::DiagnosticBuffer buffer;
+    {
+        DMCompiler::DiagnosticBuffer::Capture capture(buffer);
+        compiler.Emit(DMCompiler::WarningCode::BadExpression, location, "first");
+        compiler.Emit(DMCompiler::WarningCode::BadExpression, location, "repeated");
+        compiler.ForcedError(location, "second");
+    }
+    if (buffer.GetEntries().size() != 3 || compiler.GetWarningCount() != 0 || compiler.GetErrorCount() != 0
+        || !compiler.GetCompilerMessages().empty()) {
+        std::cerr << "FAILED: Captured diagnostics were reported at once" << std::endl;
+        return false;
+    }
+    
+    // Reporting applies levels and duplicate suppression, as reporting directly would
+    compiler.Report(buffer);
+    const auto& messages = compiler.GetCompilerMessages();
+    if (compiler.GetErrorCount() != 2 || messages.size() != 2
+        || messages[0].find("first") == std::string::npos || messages[1].find("second") == std::string::npos) {
+        std::cerr << "FAILED: Buffered diagnostics were not reported in order" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Buffered diagnostics test passed!" << std::endl;
+    return true;
+}
+
+bool TestLongOperatorChain() {
+    std::cout << "Testing long operator chains..." << std::endl;
+    
+    // Generated tables chain thousands of terms, each nesting one level deeper
+    const int terms = 100000;
+    std::string testFile = "test_operator_chain.dm";
+    {
+        std::ofstream out(testFile);
+        out << "proc/Sum(v)\n\treturn v";
+        for (int i = 0; i < terms; ++i) {
+            out << " + v";
+        }
+        out << "\nproc/Constant()\n\tvar/const/C = 1\n\treturn C";
+        for (int i = 0; i < terms; ++i) {
+            out << " + C";
+        }
+        out << "\n";
+    }
+    
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    DMCompiler::DMCompiler compiler;
+    bool success = compiler.Compile(settings);
+    
+    size_t sumLength = 0;
+    size_t constantLength = 0;
+    for (auto* proc : compiler.GetObjectTree()->GetAllProcs()) {
+        if (proc->Name == "Sum") {
+            sumLength = proc->Bytecode.size();
+        } else if (proc->Name == "Constant") {
+            constantLength = proc->Bytecode.size();
+        }
+    }
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_operator_chain.json");
+    
+    if (!success || sumLength < static_cast<size_t>(terms)) {
+        std::cerr << "FAILED: The long chain did not compile" << std::endl;
+        return false;
+    }
+    // The const var folds, so the whole chain is one constant
+    if (constantLength == 0 || constantLength > 32) {
+        std::cerr << "FAILED: The chain of consts did not fold (" << constantLength << " bytes)" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Long operator chain test passed!" << std::endl;
+    return true;
+}
+
+bool TestBinaryOutput() {
+    std::cout << "Testing binary output..." << std::endl;
+    
+    std::string testFile = "test_binary_output.dm";
+    {
+        std::ofstream out(testFile);
+        out << "var/global/counter = 3\n";
+        out << "/obj/item\n";
+        out << "\tvar/label = \"item\"\n";
+        out << "\tvar/icon = 'item.dmi'\n";
+        out << "\tproc/Describe(prefix)\n";
+        out << "\t\treturn \"[prefix] [label]\"\n";
+        out << "\tverb/Use()\n";
+        out << "\t\tset category = \"Items\"\n";
+        out << "\t\tusr << label\n";
+        out << "/obj/item/sword\n";
+        out << "\tlabel = \"sword\"\n";
+        out << "\tverb/swing()\n";
+        out << "\t\tset name = \"Use\"\n";
+        out << "\t\tset hidden = 1\n";
+        out << "/obj/item/shield\n";
+        out << "\tverb/block()\n";
+        out << "proc/First()\n";
+        out << "\treturn \"alpha\"\n";
+        out << "proc/Second()\n";
+        out << "\treturn \"alpha\"\n";
+    }
+    
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::string content;
+    bool read = DMCompiler::ReadBinaryFile("test_binary_output.dmbc", content);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_binary_output.json");
+    std::filesystem::remove("test_binary_output.dmbc");
+    
+    DMCompiler::CompiledOutputView view;
+    if (!compiled || !read || !view.Open(content)) {
+        std::cerr << "FAILED: No binary output to open" << std::endl;
+        return false;
+    }
+    
+    DMCompiler::DMObjectTree* tree = compiler.GetObjectTree();
+    std::vector<std::string> strings = tree->StringTable.ToVector();
+    bool stringsMatch = view.StringCount() == strings.size();
+    for (size_t i = 0; stringsMatch && i < strings.size(); ++i) {
+        stringsMatch = view.GetString(i) == strings[i];
+    }
+    if (!stringsMatch) {
+        std::cerr << "FAILED: String tables differ" << std::endl;
+        return false;
+    }
+    
+    if (view.TypeCount() != tree->AllObjects.size() || view.ProcCount() != tree->AllProcs.size()) {
+        std::cerr << "FAILED: Type or proc counts differ" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < tree->AllObjects.size(); ++i) {
+        if (view.GetName(view.GetType(i).Path) != tree->AllObjects[i]->Path.ToString()) {
+            std::cerr << "FAILED: Type path differs for type " << i << std::endl;
+            return false;
+        }
+    }
+    for (size_t i = 0; i < tree->AllProcs.size(); ++i) {
+        DMCompiler::CompiledProc proc = view.GetProc(i);
+        const auto& bytecode = tree->AllProcs[i]->Bytecode;
+        std::string_view stored = view.GetBytecode(proc);
+        if (view.GetName(proc.Name) != tree->AllProcs[i]->Name ||
+            !std::equal(stored.begin(), stored.end(), bytecode.begin(), bytecode.end(),
+                        [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; })) {
+            std::cerr << "FAILED: Proc " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+    
+    // First() and Second() compile to the same bytecode, which is stored once
+    int first = tree->GetGlobalProcId("First");
+    int second = tree->GetGlobalProcId("Second");
+    if (first < 0 || second < 0 || view.GetProc(first).CodeOffset != view.GetProc(second).CodeOffset) {
+        std::cerr << "FAILED: Identical procs do not share bytecode" << std::endl;
+        return false;
+    }
+    
+    if (view.ResourceCount() != 1 || view.GetResource(0) != "item.dmi" || view.GetRoot().GlobalCount != tree->Globals.size()) {
+        std::cerr << "FAILED: Resources or globals differ" << std::endl;
+        return false;
+    }
+    
+    // Both verbs named Use are found by name, in proc order
+    auto [firstUse, lastUse] = view.FindVerbs("Use");
+    if (view.VerbCount() != 3 || lastUse - firstUse != 2 || view.FindVerbs("swing").first != view.FindVerbs("swing").second) {
+        std::cerr << "FAILED: Verbs are not indexed by name" << std::endl;
+        return false;
+    }
+    DMCompiler::CompiledVerb use = view.GetVerb(view.GetVerbByName(firstUse));
+    DMCompiler::CompiledVerb swing = view.GetVerb(view.GetVerbByName(firstUse + 1));
+    DMCompiler::CompiledVerb block = view.GetVerb(view.GetVerbByName(2));
+    if (view.GetName(use.Category) != "Items" || (use.Flags & DMCompiler::CompiledVerbNamedByProc) == 0 ||
+        view.GetName(view.GetProc(use.Proc).Name) != "Use" || swing.Category != DMCompiler::CompiledOutputFormat::NoName ||
+        (swing.Flags & static_cast<uint32_t>(DMCompiler::ProcAttributes::Hidden)) == 0 ||
+        view.GetName(view.GetType(swing.Type).Path) != "/obj/item/sword" || view.GetName(block.Name) != "block") {
+        std::cerr << "FAILED: Verb records differ" << std::endl;
+        return false;
+    }
+    
+    // Cut short anywhere, the file must be refused rather than read past its end
+    for (size_t size : {size_t(0), size_t(15), content.size() / 2, content.size() - 1}) {
+        if (view.Open(std::string_view(content).substr(0, size))) {
+            std::cerr << "FAILED: Opened a file cut to " << size << " bytes" << std::endl;
+            return false;
+        }
+    }
+    
+    // Nor opened when a record's list count runs past INTS, as one flipped byte could make it
+    auto sectionOffset = [&](uint32_t id) -> size_t {
+        auto word = [&](size_t at) {
+            uint32_t value;
+            std::memcpy(&value, content.data() + at, 4);
+            return value;
+        };
+        for (size_t entry = 16; entry + 24 <= content.size(); entry += 24) {
+            if (word(entry) == id) {
+                return word(entry + 8);
+            }
+        }
+        return 0;
+    };
+    using DMCompiler::CompiledOutputFormat::SectionId;
+    size_t argumentCount = sectionOffset(SectionId("PROC")) + offsetof(DMCompiler::CompiledProc, ArgumentCount);
+    size_t variableCount = sectionOffset(SectionId("TYPE")) + offsetof(DMCompiler::CompiledType, VariableCount);
+    for (size_t at : {argumentCount, variableCount}) {
+        std::string corrupt = content;
+        corrupt[at + 3] = static_cast<char>(0x7F);
+        if (view.Open(corrupt)) {
+            std::cerr << "FAILED: Opened a file with a list count at byte " << at << " past INTS" << std::endl;
+            return false;
+        }
+    }
+    
+    std::cout << "Binary output test passed!" << std::endl;
+    return true;
+}
+
+bool TestJsonWriter() {
+    std::cout << "Testing JSON writer..." << std::endl;
+    
+    // Quotes, backslashes and control characters are escaped, in keys too
+    {
+        DMCompiler::JsonWriter json;
+        json.BeginObject();
+        json.WriteKeyValue("k\"ey", std::string("a\"b\\c\n\t\r\b\f") + '\0' + "\x01\x1f/");
+        json.EndObject();
+        std::string expected = "{\n  \"k\\\"ey\": \"a\\\"b\\\\c\\n\\t\\r\\b\\f\\u0000\\u0001\\u001f/\"\n}";
+        if (json.ToString() != expected) {
+            std::cerr << "FAILED: Escaped string is " << json.ToString() << std::endl;
+            return false;
+        }
+    }
+    
+    // Bytes past 127 are escaped one by one where char is signed, as the
+    // writer always did there, and copied as they are elsewhere
+    {
+        DMCompiler::JsonWriter json;
+        json.WriteString("caf\xc3\xa9");
+        std::string expected = std::numeric_limits<char>::is_signed ? "\"caf\\u00c3\\u00a9\"" : "\"caf\xc3\xa9\"";
+        if (json.ToString() != expected) {
+            std::cerr << "FAILED: Non-ASCII string is " << json.ToString() << std::endl;
+            return false;
+        }
+    }
+    
+    // Doubles get six decimals whatever their exact value, large ones every digit
+    auto writeDouble = [](double value) {
+        DMCompiler::JsonWriter json;
+        json.WriteDouble(value);
+        return json.ToString();
+    };
+    if (writeDouble(0.1) != "0.100000" || writeDouble(1.0 / 3) != "0.333333" || writeDouble(2.5e-7) != "0.000000" ||
+        writeDouble(-0.0) != "-0.000000" || writeDouble(-2.5) != "-2.500000") {
+        std::cerr << "FAILED: Doubles are not written with six decimals" << std::endl;
+        return false;
+    }
+    std::string largest = writeDouble(-std::numeric_limits<double>::max());
+    if (largest.size() != 1 + 309 + 7 || largest.compare(largest.size() - 7, 7, ".000000") != 0 ||
+        std::strtod(largest.c_str(), nullptr) != -std::numeric_limits<double>::max()) {
+        std::cerr << "FAILED: The largest double was cut short: " << largest << std::endl;
+        return false;
+    }
+    
+    {
+        DMCompiler::JsonWriter json;
+        json.BeginArray();
+        json.WriteInt64(std::numeric_limits<int64_t>::min());
+        json.WriteInt64(std::numeric_limits<int64_t>::max());
+        json.WriteInt(std::numeric_limits<int>::min());
+        json.EndArray();
+        if (json.ToString() != "[\n-9223372036854775808,\n9223372036854775807,\n-2147483648\n]") {
+            std::cerr << "FAILED: Integer limits are written as " << json.ToString() << std::endl;
+            return false;
+        }
+    }
+    
+    // Given a stream, output past the threshold is handed on as it is written,
+    // and once flushed the stream holds what a writer without one collects
+    auto writeLarge = [](DMCompiler::JsonWriter& json) {
+        json.BeginArray();
+        std::string element(1000, 'x');
+        for (size_t written = 0; written < 3 * DMCompiler::JsonWriter::FlushThreshold; written += element.size()) {
+            json.WriteString(element);
+        }
+        json.EndArray();
+    };
+    DMCompiler::JsonWriter collected;
+    writeLarge(collected);
+    std::string whole = collected.ToString();
+    std::ostringstream stream;
+    DMCompiler::JsonWriter streamed(stream);
+    writeLarge(streamed);
+    size_t handedOn = stream.str().size();
+    if (handedOn < 2 * DMCompiler::JsonWriter::FlushThreshold || !streamed.Flush() || stream.str() != whole) {
+        std::cerr << "FAILED: Streamed output differs, or was held until Flush()" << std::endl;
+        return false;
+    }
+    if (collected.TakeString() != whole || !collected.ToString().empty()) {
+        std::cerr << "FAILED: TakeString() did not hand over the output" << std::endl;
+        return false;
+    }
+
+    // Elements written in fragments, some of them empty, come out as the
+    // same elements written in place
+    auto writeElement = [](DMCompiler::JsonWriter& json, int i) {
+        json.BeginObject();
+        json.WriteKeyValue("id", i);
+        json.WriteKey("tags");
+        json.BeginArray();
+        json.WriteString("t" + std::to_string(i));
+        json.EndArray();
+        json.EndObject();
+    };
+    DMCompiler::JsonWriter inPlace;
+    inPlace.BeginObject();
+    inPlace.WriteKey("types");
+    inPlace.BeginArray();
+    for (int i = 0; i < 5; ++i) {
+        writeElement(inPlace, i);
+    }
+    inPlace.EndArray();
+    inPlace.EndObject();
+    DMCompiler::JsonWriter fragmented;
+    fragmented.BeginObject();
+    fragmented.WriteKey("types");
+    fragmented.BeginArray();
+    for (auto run : {std::make_pair(0, 2), std::make_pair(2, 2), std::make_pair(2, 5)}) {
+        DMCompiler::JsonWriter fragment = fragmented.Fragment();
+        for (int i = run.first; i < run.second; ++i) {
+            writeElement(fragment, i);
+        }
+        fragmented.WriteFragment(fragment.TakeString());
+    }
+    fragmented.EndArray();
+    fragmented.EndObject();
+    if (fragmented.ToString() != inPlace.ToString()) {
+        std::cerr << "FAILED: Fragments wrote " << fragmented.ToString() << std::endl;
+        return false;
+    }
+    
+    std::ostringstream failing;
+    failing.setstate(std::ios::badbit);
+    DMCompiler::JsonWriter failed(failing);
+    failed.WriteNull();
+    if (failed.Flush()) {
+        std::cerr << "FAILED: Flush() did not report a failed stream" << std::endl;
+        return false;
+    }
+    
+    std::cout << "JSON writer test passed!" << std::endl;
+    return true;
+}
+
+bool TestCompressedOutput() {
+    std::cout << "Testing compressed output..." << std::endl;
+    namespace Compression = DMCompiler::OutputCompression;
+    
+    // Short, repetitive, overlapping, incompressible and many-chunk inputs
+    std::string random;
+    uint32_t seed = 12345;
+    for (int i = 0; i < 5000; ++i) {
+        seed = seed * 1103515245 + 12345;
+        random += static_cast<char>(seed >> 16);
+    }
+    std::string text;
+    for (int i = 0; text.size() < 3 * Compression::ChunkSize; ++i) {
+        text += "\"Bytecode\": [" + std::to_string(i % 97) + ",12,0,0,0],\n";
+    }
+    std::vector<std::string> inputs = {"", "a", std::string(13, 'x'), std::string(100000, 'z'),
+                                       "abcabcabcabcabcabcabcabcabc", random, text};
+    for (const auto& input : inputs) {
+        std::string compressed = Compression::Compress(input, 4);
+        std::string decompressed;
+        if (!Compression::Decompress(compressed, decompressed) || decompressed != input) {
+            std::cerr << "FAILED: Round trip of " << input.size() << " bytes" << std::endl;
+            return false;
+        }
+        if (Compression::Compress(input, 0) != compressed) {
+            std::cerr << "FAILED: Threads changed the compressed output" << std::endl;
+            return false;
+        }
+        if (!compressed.empty() && Compression::Decompress(compressed.substr(0, compressed.size() - 1), decompressed)) {
+            std::cerr << "FAILED: Decompressed a truncated file" << std::endl;
+            return false;
+        }
+    }
+    if (Compression::Compress(text, 0).size() * 4 > text.size()) {
+        std::cerr << "FAILED: Repetitive text barely compressed" << std::endl;
+        return false;
+    }
+    
+    // The compiler's compressed JSON decompresses to the JSON it writes otherwise
+    std::string testFile = "test_compressed_output.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tvar/label = \"item\"\n";
+        out << "\tproc/Describe()\n";
+        out << "\t\treturn \"a [label] here\"\n";
+    }
+    auto compile = [&](bool compress) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.CompressOutput = compress;
+        DMCompiler::DMCompiler compiler;
+        compiler.Compile(settings);
+        std::string content;
+        DMCompiler::ReadBinaryFile(compress ? "test_compressed_output.json.dmz" : "test_compressed_output.json", content);
+        return content;
+    };
+    std::string plain = compile(false);
+    std::string compressed = compile(true);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_compressed_output.json");
+    std::filesystem::remove("test_compressed_output.json.dmz");
+    
+    std::string decompressed;
+    if (plain.empty() || !Compression::IsCompressed(compressed) ||
+        !Compression::Decompress(compressed, decompressed) || decompressed != plain) {
+        std::cerr << "FAILED: Compressed JSON output differs" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Compressed output test passed!" << std::endl;
+    return true;
+}
+
+bool TestIncrementalOutput() {
+    std::cout << "Testing incremental output..." << std::endl;
+    
+    // One changed byte rewrites one block, and a shorter file is truncated
+    std::string patchFile = "test_patch.bin";
+    std::string contents(20000, 'a');
+    DMCompiler::WriteBinaryFileAtomic(patchFile, contents);
+    contents[9000] = 'b';
+    contents.resize(15000);
+    size_t bytesWritten = 0;
+    std::string patched;
+    bool ok = DMCompiler::PatchBinaryFile(patchFile, contents, bytesWritten) &&
+              DMCompiler::ReadBinaryFile(patchFile, patched);
+    std::filesystem::remove(patchFile);
+    if (!ok || patched != contents || bytesWritten != 4096) {
+        std::cerr << "FAILED: Patched file differs or wrote " << bytesWritten << " bytes" << std::endl;
+        return false;
+    }
+    
+    // A patched build matches a fresh one
+    std::string testFile = "test_incremental_output.dm";
+    auto compile = [&](const std::string& text, bool incremental) {
+        {
+            std::ofstream out(testFile);
+            out << "/obj/item\n";
+            out << "\tvar/label = \"item\"\n";
+            out << "\tproc/Describe()\n";
+            out << "\t\treturn \"" << text << "\"\n";
+        }
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.BinaryOutput = true;
+        settings.IncrementalOutput = incremental;
+        DMCompiler::DMCompiler compiler;
+        compiler.Compile(settings);
+        std::string content;
+        DMCompiler::ReadBinaryFile("test_incremental_output.dmbc", content);
+        return content;
+    };
+    compile("first", false);
+    std::string incremental = compile("second text", true);
+    std::filesystem::remove("test_incremental_output.dmbc");
+    std::string fresh = compile("second text", false);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_incremental_output.json");
+    std::filesystem::remove("test_incremental_output.dmbc");
+    
+    if (fresh.empty() || incremental != fresh) {
+        std::cerr << "FAILED: Incremental binary output differs from a fresh build" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Incremental output test passed!" << std::endl;
+    return true;
+}
+
+bool TestBinaryMapCells() {
+    std::cout << "Testing binary map cells..." << std::endl;
+    
+    // The same contents under different keys, in two maps
+    std::string testFile = "test_binary_map_cells.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/turf/floor\n";
+        out << "/area/space\n";
+        out << "#include \"test_binary_map_cells_a.dmm\"\n";
+        out << "#include \"test_binary_map_cells_b.dmm\"\n";
+    }
+    {
+        std::ofstream out("test_binary_map_cells_a.dmm");
+        out << "\"a\" = (/turf/floor,/area/space)\n";
+        out << "\"b\" = (/turf/floor)\n";
+        out << "(1,1,1) = {\"\nab\n\"}\n";
+    }
+    {
+        std::ofstream out("test_binary_map_cells_b.dmm");
+        out << "\"x\" = (/turf/floor)\n";
+        out << "\"y\" = (/turf/floor,/area/space)\n";
+        out << "(1,1,1) = {\"\nyx\n\"}\n";
+    }
+    
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::string content;
+    bool read = DMCompiler::ReadBinaryFile("test_binary_map_cells.dmbc", content);
+    
+    for (const char* file : {"test_binary_map_cells.dm", "test_binary_map_cells_a.dmm", "test_binary_map_cells_b.dmm",
+                             "test_binary_map_cells.json", "test_binary_map_cells.dmbc"}) {
+        std::filesystem::remove(file);
+    }
+    
+    DMCompiler::CompiledOutputView view;
+    if (!compiled || !read || !view.Open(content) || view.MapCount() != 2) {
+        std::cerr << "FAILED: No binary output with two maps to open" << std::endl;
+        return false;
+    }
+    
+    // The cell each grid position names, through the map's keys
+    auto gridCell = [&](size_t mapIndex, uint32_t position) {
+        DMCompiler::CompiledMap map = view.GetMap(mapIndex);
+        DMCompiler::CompiledBlock block = view.GetBlock(map.FirstBlock);
+        return view.GetCellKey(map.FirstKey + view.GetInt(block.Cells + position)).Cell;
+    };
+    uint32_t floorAndSpace = gridCell(0, 0);
+    uint32_t floorOnly = gridCell(0, 1);
+    if (floorAndSpace == floorOnly || gridCell(1, 0) != floorAndSpace || gridCell(1, 1) != floorOnly) {
+        std::cerr << "FAILED: Identical cells are not shared between maps" << std::endl;
+        return false;
+    }
+    if (view.GetCell(floorAndSpace).Area < 0 || view.GetCell(floorOnly).Area >= 0) {
+        std::cerr << "FAILED: Shared cells lost their contents" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Binary map cells test passed!" << std::endl;
+    return true;
+}
+
+bool TestStreamedMaps() {
+    std::cout << "Testing maps converted during output..." << std::endl;
+    
+    // Three maps of different widths, more than one window of two
+    std::string testFile = "test_streamed_maps.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/turf/floor\n";
+        for (int i = 0; i < 3; ++i) {
+            out << "#include \"test_streamed_maps_" << i << ".dmm\"\n";
+        }
+    }
+    for (int i = 0; i < 3; ++i) {
+        std::ofstream out("test_streamed_maps_" + std::to_string(i) + ".dmm");
+        out << "\"a\" = (/turf/floor)\n";
+        out << "(1,1,1) = {\"\n" << std::string(i + 1, 'a') << "\n\"}\n";
+    }
+    
+    auto compile = [&](unsigned threads, std::string& json, std::string& binary) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.BinaryOutput = true;
+        settings.ParseThreads = threads;
+        DMCompiler::DMCompiler compiler;
+        return compiler.Compile(settings) && DMCompiler::ReadBinaryFile("test_streamed_maps.json", json) &&
+               DMCompiler::ReadBinaryFile("test_streamed_maps.dmbc", binary);
+    };
+    std::string json, binary, windowedJson, windowedBinary;
+    bool compiled = compile(0, json, binary) && compile(2, windowedJson, windowedBinary);
+    
+    std::filesystem::remove(testFile);
+    for (int i = 0; i < 3; ++i) {
+        std::filesystem::remove("test_streamed_maps_" + std::to_string(i) + ".dmm");
+    }
+    std::filesystem::remove("test_streamed_maps.json");
+    std::filesystem::remove("test_streamed_maps.dmbc");
+    
+    DMCompiler::CompiledOutputView view;
+    if (!compiled || !view.Open(binary) || view.MapCount() != 3) {
+        std::cerr << "FAILED: No binary output with three maps to open" << std::endl;
+        return false;
+    }
+    if (windowedJson != json || windowedBinary != binary) {
+        std::cerr << "FAILED: The output differs when maps are converted two at a time" << std::endl;
+        return false;
+    }
+    
+    // In include order, each above the last
+    int32_t previousZ = 0;
+    for (size_t i = 0; i < 3; ++i) {
+        DMCompiler::CompiledMap map = view.GetMap(i);
+        int32_t z = view.GetBlock(map.FirstBlock).Z;
+        if (map.MaxX != static_cast<int32_t>(i + 1) || z <= previousZ) {
+            std::cerr << "FAILED: Map " << i << " is out of include order" << std::endl;
+            return false;
+        }
+        previousZ = z;
+    }
+    
+    std::cout << "Maps converted during output test passed!" << std::endl;
+    return true;
+}
+
+bool TestResourceManifest() {
+    std::cout << "Testing resource manifest..." << std::endl;
+    
+    using DMCompiler::ResourceManifest;
+    if (ResourceManifest::Hash("") != 0xEF46DB3751D8E999ull || ResourceManifest::Hash("abc") != 0x44BC2CF5AD770999ull ||
+        ResourceManifest::Hash("Nobody inspects the spammish repetition") != 0xFBCEA83C8A378BF1ull) {
+        std::cerr << "FAILED: XXH64 does not match the reference values" << std::endl;
+        return false;
+    }
+    
+    std::string testFile = "test_resource_manifest.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tproc/Icon()\n";
+        out << "\t\treturn 'test_resource_manifest.dmi'\n";
+        out << "\tproc/Sound()\n";
+        out << "\t\treturn 'test_resource_manifest_missing.ogg'\n";
+    }
+    std::string iconContents = "not really an icon";
+    DMCompiler::WriteBinaryFileAtomic("test_resource_manifest.dmi", iconContents);
+    
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.ResourceManifest = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::string manifest;
+    bool read = DMCompiler::ReadBinaryFile("test_resource_manifest.resources.json", manifest);
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx",
+                  static_cast<unsigned long long>(ResourceManifest::Hash(iconContents)));
+    bool listed = manifest.find(std::string("\"Hash\": \"") + hash + "\"") != std::string::npos &&
+                  manifest.find("\"Missing\": true") != std::string::npos;
+    
+    // Unchanged files keep the previous manifest's hashes; a changed one is read again
+    size_t unchangedHashed = 1;
+    size_t changedHashed = 0;
+    auto unchanged = ResourceManifest::Build({"test_resource_manifest.dmi"}, {"."},
+                                             "test_resource_manifest.resources.json", 2, unchangedHashed);
+    DMCompiler::WriteBinaryFileAtomic("test_resource_manifest.dmi", iconContents + " now");
+    auto changed = ResourceManifest::Build({"test_resource_manifest.dmi"}, {"."},
+                                           "test_resource_manifest.resources.json", 2, changedHashed);
+    
+    for (const char* file : {"test_resource_manifest.dm", "test_resource_manifest.dmi", "test_resource_manifest.json",
+                             "test_resource_manifest.resources.json"}) {
+        std::filesystem::remove(file);
+    }
+    
+    if (!compiled || !read || !listed) {
+        std::cerr << "FAILED: Manifest does not list the found and missing resources" << std::endl;
+        return false;
+    }
+    if (unchangedHashed != 0 || unchanged[0].Hash != ResourceManifest::Hash(iconContents) ||
+        changedHashed != 1 || changed[0].Hash != ResourceManifest::Hash(iconContents + " now")) {
+        std::cerr << "FAILED: Hashes were not reused for unchanged files only" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Resource manifest test passed!" << std::endl;
+    return true;
+}
+
+bool TestResourceOrder() {
+    std::cout << "Testing resource order..." << std::endl;
+    
+    // Named out of order, one of them twice
+    std::string testFile = "test_resource_order.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tproc/Icon()\n";
+        out << "\t\treturn 'zebra.dmi'\n";
+        out << "\tproc/Sound()\n";
+        out << "\t\treturn 'alarm.ogg'\n";
+        out << "\tproc/Picture()\n";
+        out << "\t\treturn 'map.png'\n";
+        out << "\tproc/Again()\n";
+        out << "\t\treturn 'zebra.dmi'\n";
+    }
+    
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::string json, binary;
+    bool read = DMCompiler::ReadBinaryFile("test_resource_order.json", json) &&
+                DMCompiler::ReadBinaryFile("test_resource_order.dmbc", binary);
+    for (const char* file : {"test_resource_order.dm", "test_resource_order.json", "test_resource_order.dmbc"}) {
+        std::filesystem::remove(file);
+    }
+    
+    DMCompiler::CompiledOutputView view;
+    if (!compiled || !read || !view.Open(binary)) {
+        std::cerr << "FAILED: No output to read the resources from" << std::endl;
+        return false;
+    }
+    
+    // Both outputs list each resource once, sorted, so their IDs agree
+    const std::vector<std::string> sorted = {"alarm.ogg", "map.png", "zebra.dmi"};
+    size_t listStart = json.find("\"Resources\"");
+    size_t previous = listStart;
+    for (const std::string& resource : sorted) {
+        size_t position = json.find("\"" + resource + "\"", listStart);
+        if (listStart == std::string::npos || position == std::string::npos || position < previous) {
+            std::cerr << "FAILED: The JSON resource list is not sorted" << std::endl;
+            return false;
+        }
+        previous = position;
+    }
+    if (view.ResourceCount() != sorted.size()) {
+        std::cerr << "FAILED: The binary output lists " << view.ResourceCount() << " resources" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        if (view.GetResource(i) != sorted[i]) {
+            std::cerr << "FAILED: Binary resource " << i << " is " << view.GetResource(i) << std::endl;
+            return false;
+        }
+    }
+    
+    std::cout << "Resource order test passed!" << std::endl;
+    return true;
+}
+
+bool TestMergedMemberTables() {
+    std::cout << "Testing merged member tables..." << std::endl;
+    
+    std::string testFile = "test_merged_members.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/mob\n";
+        out << "\tvar/hp = 10\n";
+        out << "\tproc/Attack()\n";
+        out << "\t\treturn hp\n";
+        out << "/mob/player\n";
+        out << "\tvar/level = 1\n";
+        out << "\tAttack()\n";
+        out << "\t\treturn hp * level\n";
+        out << "\tproc/Cast()\n";
+        out << "\t\treturn level\n";
+    }
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_merged_members.json");
+    
+    DMCompiler::DMObjectTree* tree = compiler.GetObjectTree();
+    DMCompiler::DMObject* mob = nullptr;
+    DMCompiler::DMObject* player = nullptr;
+    if (!compiled || !tree->TryGetDMObject(DMCompiler::DreamPath("/mob"), &mob) ||
+        !tree->TryGetDMObject(DMCompiler::DreamPath("/mob/player"), &player)) {
+        std::cerr << "FAILED: The test project did not compile" << std::endl;
+        return false;
+    }
+    
+    // Inherited members are merged in, the most derived proc winning, and
+    // asking again hands back the same table
+    const auto& variables = tree->GetAllVariables(player);
+    const auto& procs = tree->GetAllProcsForObject(player);
+    if (variables.size() != 2 || !variables.count("hp") || !variables.count("level") || procs.size() != 2 ||
+        !procs.count("Cast") || !procs.count("Attack") || procs.at("Attack")->OwningObject != player) {
+        std::cerr << "FAILED: The merged tables do not hold the inherited members" << std::endl;
+        return false;
+    }
+    if (&tree->GetAllVariables(player) != &variables || &tree->GetAllProcsForObject(player) != &procs) {
+        std::cerr << "FAILED: The merged tables were built again" << std::endl;
+        return false;
+    }
+    
+    // Kept until the tree changes, then merged again with what changed
+    mob->Variables["mana"] = DMCompiler::DMVariable(std::nullopt, "mana", false, false, false, false);
+    bool stale = !tree->GetAllVariables(player).count("mana");
+    tree->GetOrCreateDMObject(DMCompiler::DreamPath("/mob/player/admin"));
+    if (!stale || !tree->GetAllVariables(player).count("mana")) {
+        std::cerr << "FAILED: The merged tables were not kept until a type was added" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Merged member tables test passed!" << std::endl;
+    return true;
+}
+
+bool TestCompileTimings() {
+    std::cout << "Testing compile timings..." << std::endl;
+    
+    DMCompiler::CompileTimings timings;
+    {
+        auto outer = DMCompiler::CompileTimings::Time(&timings, "Outer");
+        auto inner = DMCompiler::CompileTimings::Time(&timings, "Inner");
+        std::vector<std::unique_ptr<int>> allocated;
+        for (int i = 0; i < 100; ++i) {
+            allocated.push_back(std::make_unique<int>(i));
+        }
+    }
+    auto none = DMCompiler::CompileTimings::Time(nullptr, "Ignored");
+    const auto& phases = timings.GetPhases();
+    if (phases.size() != 2 || phases[0].Depth != 0 || phases[1].Depth != 1 ||
+        phases[1].Allocations < 100 || phases[0].Allocations < phases[1].Allocations ||
+        phases[1].AllocatedBytes < 100 * sizeof(int) || phases[0].AllocatedBytes < phases[1].AllocatedBytes ||
+        phases[0].WallMs < phases[1].WallMs) {
+        std::cerr << "FAILED: Nested phases were not timed as nested" << std::endl;
+        return false;
+    }
+    
+    std::string testFile = "test_compile_timings.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/proc/test()\n";
+        out << "\treturn 1 + 2\n";
+    }
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.Timings = "trace";
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::string trace;
+    bool read = DMCompiler::ReadBinaryFile("test_compile_timings.trace.json", trace);
+    
+    settings.Timings = "json";
+    DMCompiler::DMCompiler jsonCompiler;
+    bool jsonCompiled = jsonCompiler.Compile(settings);
+    std::string report;
+    bool jsonRead = DMCompiler::ReadBinaryFile("test_compile_timings.timings.json", report);
+    for (const char* file : {"test_compile_timings.dm", "test_compile_timings.json", "test_compile_timings.trace.json",
+                             "test_compile_timings.timings.json"}) {
+        std::filesystem::remove(file);
+    }
+    
+    if (!compiled || !read || trace.find("\"traceEvents\"") == std::string::npos ||
+        trace.find("\"name\": \"DMProc::Compile\"") == std::string::npos ||
+        trace.find("\"name\": \"ConstantFolding\"") == std::string::npos) {
+        std::cerr << "FAILED: Trace does not list the compile phases" << std::endl;
+        return false;
+    }
+    
+    // The phases of a real compile that build something count what they
+    // allocated, and the report names the allocator the counts came from
+    size_t allocating = 0;
+    bool counted = jsonCompiler.GetTimings() != nullptr;
+    for (const auto& phase : counted ? jsonCompiler.GetTimings()->GetPhases() : phases) {
+        counted &= phase.Allocations == 0 || phase.AllocatedBytes > 0;
+        if (phase.Name == "PreprocessFiles" || phase.Name == "ParseFiles" || phase.Name == "BuildObjectTree" ||
+            phase.Name == "OutputJson") {
+            allocating += phase.Allocations > 0;
+        }
+    }
+    std::string allocator = std::string("\"Allocator\": \"") + DMCompiler::CompileTimings::AllocatorName() + "\"";
+    if (!jsonCompiled || !jsonRead || !counted || allocating != 4 || report.find(allocator) == std::string::npos ||
+        report.find("\"AllocatedBytes\": ") == std::string::npos) {
+        std::cerr << "FAILED: A compile's phases do not report their allocations" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Compile timings test passed!" << std::endl;
+    return true;
+}
+
+bool TestMemoryRelease() {
+    std::cout << "Testing memory release between phases..." << std::endl;
+    
+    std::string testFile = "test_memory_release.dm";
+    {
+        std::ofstream out(testFile);
+        for (int i = 0; i < 20; ++i) {
+            out << "/proc/step" << i << "(x)\n";
+            out << "\treturn x * " << i << " + " << i << "\n";
+        }
+    }
+    
+    // Compiles with stdout caught, for the --max-memory report
+    auto compile = [&](const std::function<void(DMCompiler::DMCompilerSettings&)>& configure, std::string& report,
+                       std::string& json, std::vector<std::string>& messages) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        configure(settings);
+        DMCompiler::DMCompiler compiler;
+        std::ostringstream captured;
+        std::streambuf* stdoutBuffer = std::cout.rdbuf(captured.rdbuf());
+        bool compiled = compiler.Compile(settings);
+        std::cout.rdbuf(stdoutBuffer);
+        report = captured.str();
+        json.clear();
+        DMCompiler::ReadBinaryFile("test_memory_release.json", json);
+        messages = compiler.GetCompilerMessages();
+        std::filesystem::remove("test_memory_release.json");
+        return compiled;
+    };
+    auto released = [](const std::string& report, size_t& tokens, size_t& bodies) {
+        size_t at = report.find("  Released ");
+        return at != std::string::npos &&
+               std::sscanf(report.c_str() + at, "  Released %zu preprocessed tokens after parsing and %zu proc bodies",
+                           &tokens, &bodies) == 2;
+    };
+    
+    std::string plainReport, plainJson, report, json, lazyReport, lazyJson, limitedReport, limitedJson;
+    std::vector<std::string> messages, limitedMessages;
+    bool plain = compile([](DMCompiler::DMCompilerSettings&) {}, plainReport, plainJson, messages);
+    bool reported = compile([](DMCompiler::DMCompilerSettings& settings) { settings.MemoryReport = true; },
+                            report, json, messages);
+    bool lazy = compile([](DMCompiler::DMCompilerSettings& settings) {
+        settings.MemoryReport = true;
+        settings.LazyProcBodies = true;
+    }, lazyReport, lazyJson, messages);
+    bool limited = compile([](DMCompiler::DMCompilerSettings& settings) {
+        settings.MemoryReport = true;
+        settings.MaxMemoryMB = 1;
+    }, limitedReport, limitedJson, limitedMessages);
+    std::filesystem::remove(testFile);
+    
+    // Tokens and proc bodies are dropped, whether or not bodies are parsed
+    // lazily, and the output does not change for it
+    size_t tokens = 0, bodies = 0, lazyTokens = 0, lazyBodies = 0;
+    if (!plain || !reported || !lazy || !released(report, tokens, bodies) ||
+        !released(lazyReport, lazyTokens, lazyBodies)) {
+        std::cerr << "FAILED: --max-memory did not report what was released" << std::endl;
+        return false;
+    }
+    if (tokens == 0 || bodies != 20 || lazyTokens != tokens || lazyBodies != bodies) {
+        std::cerr << "FAILED: Released " << tokens << " tokens and " << bodies << " proc bodies, lazily "
+                  << lazyTokens << " and " << lazyBodies << std::endl;
+        return false;
+    }
+    if (plainJson.empty() || json != plainJson || lazyJson != plainJson) {
+        std::cerr << "FAILED: Releasing memory changed the JSON output" << std::endl;
+        return false;
+    }
+    
+    // A budget no compile fits in fails it, naming the phase, unless this
+    // platform cannot measure memory at all
+    bool unmeasured = false, named = false;
+    for (const std::string& message : limitedMessages) {
+        unmeasured |= message.find("--max-memory cannot measure memory") != std::string::npos;
+        named |= message.find("exceeds --max-memory 1 MB, first passed in ") != std::string::npos;
+    }
+    if (unmeasured ? !limited : (limited || !named || limitedReport.find("Memory high-water marks") == std::string::npos)) {
+        std::cerr << "FAILED: An undersized --max-memory did not fail the compile, naming the phase" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Memory release test passed!" << std::endl;
+    return true;
+}
+
+bool TestCompileCosts() {
+    std::cout << "Testing compile cost attribution..." << std::endl;
+    
+    {
+        std::ofstream out("test_compile_costs.dme");
+        out << "#include \"test_compile_costs_procs.dm\"\n";
+        out << "/mob/var/health = 10\n";
+    }
+    {
+        std::ofstream out("test_compile_costs_procs.dm");
+        out << "/mob/proc/Heavy()\n";
+        for (int i = 0; i < 200; ++i) {
+            out << "\tvar/v" << i << " = " << i << " * 2 + health\n";
+        }
+        out << "/mob/proc/Light()\n";
+        out << "\treturn 1\n";
+    }
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back("test_compile_costs.dme");
+    settings.NoStandard = true;
+    settings.CompileCostsTop = 5;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    std::ostringstream report;
+    if (compiler.GetCosts()) {
+        compiler.GetCosts()->Report(report, 1);
+    }
+    std::string text = report.str();
+    for (const char* file : {"test_compile_costs.dme", "test_compile_costs_procs.dm", "test_compile_costs.json"}) {
+        std::filesystem::remove(file);
+    }
+    
+    // The 200-line proc is the slowest to compile, and its file the slowest to parse
+    if (!compiled || text.find("(2 files,") == std::string::npos ||
+        text.find("test_compile_costs_procs.dm\n") == std::string::npos ||
+        text.find("/mob/Heavy") == std::string::npos || text.find("/mob/Light") != std::string::npos) {
+        std::cerr << "FAILED: Costs were not attributed to the files and procs:\n" << text << std::endl;
+        return false;
+    }
+    
+    std::cout << "Compile cost attribution test passed!" << std::endl;
+    return true;
+}
+
+bool TestCompileServer() {
+    std::cout << "Testing compile server..." << std::endl;
+    
+    std::filesystem::remove_all("test_compile_server_cache");
+    auto writeSource = [](const char* procName) {
+        std::ofstream out("test_compile_server.dm");
+        out << "/mob\n";
+        out << "\tvar/label = \"" << procName << "\"\n";
+        out << "/mob/proc/" << procName << "()\n";
+        out << "\treturn 1\n";
+    };
+    DMCompiler::CompileServer server("test_compile_server_cache", [](const std::vector<std::string>& args,
+                                                                     DMCompiler::DMCompilerSettings& settings) {
+        settings.Files = args;
+        settings.NoStandard = true;
+        return true;
+    });
+    auto outputHas = [](const std::string& text) {
+        std::ifstream file("test_compile_server.json");
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return contents.str().find(text) != std::string::npos;
+    };
+    const std::string compile = R"({"id": 7, "method": "Compile", "params": {"args": ["test_compile_server.dm"]}})";
+    
+    // The second compile reuses the first one's cached tokens and still sees the edit
+    writeSource("First");
+    std::string first = server.Handle(compile);
+    bool firstOk = first.find("\"Success\":true") != std::string::npos && first.find("\"id\":7") != std::string::npos &&
+                   outputHas("\"First\"");
+    std::string stats = server.Handle(R"({"id": 8, "method": "Stats"})");
+    writeSource("Second");
+    std::string second = server.Handle(compile);
+    bool secondOk = second.find("\"Success\":true") != std::string::npos && outputHas("\"Second\"") &&
+                    !outputHas("\"First\"");
+    
+    {
+        std::ofstream out("test_compile_server.dm");
+        out << "/mob/proc/Broken(\n";
+    }
+    std::string failed = server.Handle(compile);
+    std::string unknown = server.Handle(R"({"id": 9, "method": "Frobnicate"})");
+    
+    for (const char* file : {"test_compile_server.dm", "test_compile_server.json"}) {
+        std::filesystem::remove(file);
+    }
+    std::filesystem::remove_all("test_compile_server_cache");
+    
+    if (!firstOk || !secondOk) {
+        std::cerr << "FAILED: Server compiles did not produce the right output:\n" << first << "\n" << second << std::endl;
+        return false;
+    }
+    // Each compile pools its own constants, so the first one's label is gone from the second's
+    auto constants = [](const std::string& reply) {
+        size_t at = reply.find("\"JsonConstants\":");
+        return at == std::string::npos ? std::string() : reply.substr(at, reply.find_first_of(",}", at) - at);
+    };
+    if (constants(first).empty() || constants(first) == "\"JsonConstants\":0" || constants(second) != constants(first)) {
+        std::cerr << "FAILED: Server compiles did not each start with an empty constant pool: " << constants(first)
+                  << ", then " << constants(second) << std::endl;
+        return false;
+    }
+    if (stats.find("\"Compiles\":1") == std::string::npos || stats.find("\"TokenFilesInMemory\":0") != std::string::npos) {
+        std::cerr << "FAILED: Server kept no tokens in memory: " << stats << std::endl;
+        return false;
+    }
+    if (failed.find("\"Success\":false") == std::string::npos || failed.find("\"Errors\":0") != std::string::npos) {
+        std::cerr << "FAILED: Broken source compiled on the server: " << failed << std::endl;
+        return false;
+    }
+    if (unknown.find("\"error\":\"Unknown method: Frobnicate\"") == std::string::npos) {
+        std::cerr << "FAILED: Unknown method was not rejected: " << unknown << std::endl;
+        return false;
+    }
+    
+    std::cout << "Compile server test passed!" << std::endl;
+    return true;
+}
+
+bool TestProcCache() {
+    std::cout << "Testing proc cache and dependency graph..." << std::endl;
+    
+    std::filesystem::remove_all("test_proc_cache_dir");
+    {
+        std::ofstream out("test_proc_cache.dme");
+        out << "#define BASE 10\n";
+        out << "#include \"test_proc_cache_procs.dm\"\n";
+    }
+    auto writeProcs = [](const char* health, const char* text) {
+        std::ofstream out("test_proc_cache_procs.dm");
+        out << "/mob\n";
+        out << "\tvar/health = " << health << "\n";
+        out << "\tproc/Heal()\n";
+        out << "\t\treturn health + BASE\n";
+        out << "\tproc/Say()\n";
+        out << "\t\tvar/text = " << text << "\n";
+        out << "\t\treturn text\n";
+        out << "\tproc/Shout()\n";
+        out << "\t\treturn \"loud\"\n";
+    };
+    auto readOutput = []() {
+        std::string output;
+        DMCompiler::ReadBinaryFile("test_proc_cache.json", output);
+        return output;
+    };
+    struct Result {
+        bool Compiled = false;
+        size_t Reused = 0;
+        size_t Renumbered = 0;
+        size_t Stored = 0;
+        std::string Output;
+    };
+    auto compile = [&](bool cached, bool dependencies = false) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back("test_proc_cache.dme");
+        settings.NoStandard = true;
+        settings.DependencyGraph = dependencies;
+        if (cached) {
+            settings.ProcCacheDir = "test_proc_cache_dir";
+        }
+        DMCompiler::DMCompiler compiler;
+        Result result;
+        result.Compiled = compiler.Compile(settings);
+        if (const DMCompiler::ProcCache* cache = compiler.GetProcCache()) {
+            result.Reused = cache->GetReusedCount();
+            result.Renumbered = cache->GetRenumberedCount();
+            result.Stored = cache->GetStoredCount();
+        }
+        result.Output = readOutput();
+        return result;
+    };
+    
+    // Compiled and stored, then all reused, then only the edited proc compiled
+    // again, Shout's string renumbered after Say's new one
+    writeProcs("BASE", "\"hello\"");
+    Result first = compile(true);
+    Result second = compile(true);
+    // A damaged entry is compiled again, and stored again, not trusted: here
+    // an entry's first opcode, past the magic, version, key and length
+    for (const auto& file : std::filesystem::directory_iterator("test_proc_cache_dir")) {
+        std::fstream entry(file.path(), std::ios::binary | std::ios::in | std::ios::out);
+        entry.seekg(4 + 4 + 8 + 4);
+        char opcode = static_cast<char>(entry.get());
+        entry.seekp(4 + 4 + 8 + 4);
+        entry.put(static_cast<char>(opcode ^ 1));
+        break;
+    }
+    Result corrupted = compile(true);
+    writeProcs("BASE", "list(\"good\", \"bye\")");
+    Result edited = compile(true);
+    Result fresh = compile(false, true);
+    // Changing health's declaration misses the procs naming it, not Say or Shout
+    writeProcs("BASE + 1", "list(\"good\", \"bye\")");
+    Result redeclared = compile(true);
+    Result redeclaredFresh = compile(false);
+    
+    std::string deps;
+    DMCompiler::ReadBinaryFile("test_proc_cache.deps.json", deps);
+    for (const char* file : {"test_proc_cache.dme", "test_proc_cache_procs.dm", "test_proc_cache.json",
+                             "test_proc_cache.deps.json"}) {
+        std::filesystem::remove(file);
+    }
+    std::filesystem::remove_all("test_proc_cache_dir");
+    
+    if (!first.Compiled || !second.Compiled || !edited.Compiled || !fresh.Compiled || !redeclared.Compiled ||
+        !redeclaredFresh.Compiled) {
+        std::cerr << "FAILED: Proc cache sources did not compile" << std::endl;
+        return false;
+    }
+    if (first.Stored == 0 || first.Reused != 0 || second.Reused != first.Stored || second.Stored != 0 ||
+        second.Output != first.Output) {
+        std::cerr << "FAILED: Unchanged procs were not reused (stored " << first.Stored << ", reused "
+                  << second.Reused << ")" << std::endl;
+        return false;
+    }
+    if (!corrupted.Compiled || corrupted.Stored != 1 || corrupted.Reused + 1 != first.Stored ||
+        corrupted.Output != first.Output) {
+        std::cerr << "FAILED: A damaged entry was not compiled again (stored " << corrupted.Stored << ", reused "
+                  << corrupted.Reused << ")" << std::endl;
+        return false;
+    }
+    if (edited.Stored != 1 || edited.Reused + 1 != first.Stored || edited.Renumbered == 0 ||
+        edited.Output != fresh.Output || edited.Output.find("good") == std::string::npos) {
+        std::cerr << "FAILED: The edited proc was not the only one compiled (stored " << edited.Stored
+                  << ", reused " << edited.Reused << ", renumbered " << edited.Renumbered << ")" << std::endl;
+        return false;
+    }
+    if (redeclared.Stored == 0 || redeclared.Reused < 2 || redeclared.Reused + redeclared.Stored != first.Stored ||
+        redeclared.Output != redeclaredFresh.Output) {
+        std::cerr << "FAILED: A changed var did not miss only the procs naming it (stored " << redeclared.Stored
+                  << ", reused " << redeclared.Reused << ")" << std::endl;
+        return false;
+    }
+    if (deps.find("test_proc_cache_procs.dm\"") == std::string::npos || deps.find("\"BASE\"") == std::string::npos ||
+        deps.find("/mob/proc/Say") == std::string::npos) {
+        std::cerr << "FAILED: Dependency graph is missing the include, macro or proc:\n" << deps << std::endl;
+        return false;
+    }
+    
+    std::cout << "Proc cache test passed!" << std::endl;
+    return true;
+}
+
+bool TestBytecodeVerifier() {
+    std::cout << "Testing the bytecode verifier..." << std::endl;
+    
+    // Short-circuits, calls, new, pick(), filtered loops and list stores all pass
+    std::string testFile = "test_bytecode_verifier.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tvar/weight = 2\n";
+        out << "\tproc/Heavy(limit)\n";
+        out << "\t\treturn weight > limit && limit || !weight\n";
+        out << "/obj/item/crate\n";
+        out << "\tHeavy(limit)\n";
+        out << "\t\treturn ..() || pick(1, 2, 3)\n";
+        out << "proc/Count(list/things)\n";
+        out << "\tvar/total = 0\n";
+        out << "\tfor (var/obj/item/I in things)\n";
+        out << "\t\tif (I.Heavy(total) && total < 10)\n";
+        out << "\t\t\ttotal++\n";
+        out << "\treturn new /obj/item(total, things)\n";
+        out << "proc/Store(list/L, i, x)\n";
+        out << "\tL[i] = x\n";
+        out << "\tL[1] += 5\n";
+        out << "\treturn Count(L)\n";
+    }
+    
+    bool passed = true;
+    for (bool compact : {false, true}) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.Verify = true;
+        settings.CompactOperands = compact;
+        settings.CompileThreads = 2;
+        DMCompiler::DMCompiler compiler;
+        if (!compiler.Compile(settings) || compiler.GetErrorCount() != 0) {
+            std::cerr << "FAILED: --verify rejected a good compile" << (compact ? " with compact operands" : "")
+                      << std::endl;
+            passed = false;
+        }
+    }
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_bytecode_verifier.json");
+    
+    using DMCompiler::DreamProcOpcode;
+    auto op = [](DreamProcOpcode opcode) { return static_cast<uint8_t>(opcode); };
+    DMCompiler::BytecodeVerifier::Tables tables;
+    tables.Strings = 10;
+    tables.Types = 2;
+    tables.Procs = 2;
+    DMCompiler::BytecodeVerifier verifier(tables, DMCompiler::OperandEncoding::Fixed);
+    
+    std::vector<uint8_t> good = {op(DreamProcOpcode::PushString), 9, 0, 0, 0, op(DreamProcOpcode::Return)};
+    std::vector<uint8_t> badString = {op(DreamProcOpcode::PushString), 10, 0, 0, 0, op(DreamProcOpcode::Return)};
+    // Jumps two bytes into the PushFloat after it
+    std::vector<uint8_t> badJump = {op(DreamProcOpcode::Jump), 2, 0, 0, 0,
+                                    op(DreamProcOpcode::PushFloat), 0, 0, 0, 0, op(DreamProcOpcode::Return)};
+    std::vector<uint8_t> underflow = {op(DreamProcOpcode::Pop)};
+    
+    std::string problem = verifier.Verify(good, 1);
+    if (!problem.empty()) {
+        std::cerr << "FAILED: Good bytecode was rejected: " << problem << std::endl;
+        passed = false;
+    }
+    if (verifier.Verify(good, 0).find("max stack size") == std::string::npos) {
+        std::cerr << "FAILED: A stack deeper than the max stack size was not reported" << std::endl;
+        passed = false;
+    }
+    if (verifier.Verify(badString, 1).find("names string 10") == std::string::npos) {
+        std::cerr << "FAILED: An out-of-range string ID was not reported" << std::endl;
+        passed = false;
+    }
+    if (verifier.Verify(badJump, 1).find("middle of the instruction at byte 5") == std::string::npos) {
+        std::cerr << "FAILED: A jump into an instruction was not reported" << std::endl;
+        passed = false;
+    }
+    if (verifier.Verify(underflow, 1).find("more values than the stack holds") == std::string::npos) {
+        std::cerr << "FAILED: A pop of an empty stack was not reported" << std::endl;
+        passed = false;
+    }
+    
+    if (passed) {
+        std::cout << "Bytecode verifier test passed!" << std::endl;
+    }
+    return passed;
+}
+
+bool TestProcProfile() {
+    std::cout << "Testing profile-guided compilation..." << std::endl;
+    
+    // The same switch in a hot, a cold and an unprofiled build
+    std::string testFile = "test_proc_profile.dm";
+    std::string profileFile = "test_proc_profile.profile.json";
+    {
+        std::ofstream out(testFile);
+        for (const char* name : {"Hot", "Cold"}) {
+            out << "/obj/proc/" << name << "(n)\n";
+            out << "\tswitch (n)\n";
+            out << "\t\tif (1) return \"a\"\n";
+            out << "\t\tif (2 to 4) return \"b\"\n";
+            out << "\t\tif (5) return \"c\"\n";
+            out << "\t\tif (7) return \"d\"\n";
+            out << "\t\tif (9) return \"e\"\n";
+            out << "\tvar/obj/O = n\n";
+            out << "\treturn O.name\n";
+        }
+        std::ofstream profile(profileFile);
+        profile << "{\"Procs\": [{\"Type\": \"/obj\", \"Name\": \"Hot\", \"Calls\": 9000, \"Time\": 40.5},\n";
+        profile << "           {\"Type\": \"/obj\", \"Name\": \"Cold\", \"Calls\": 0}]}\n";
+    }
+    
+    struct Build {
+        bool Compiled = false;
+        std::vector<uint8_t> Hot, Cold;
+        DMCompiler::ProcTemperature HotTemperature = DMCompiler::ProcTemperature::Warm;
+        DMCompiler::ProcTemperature ColdTemperature = DMCompiler::ProcTemperature::Warm;
+        uint32_t HotOffset = 0;
+    };
+    auto build = [&](bool profiled) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.BinaryOutput = true;
+        if (profiled) {
+            settings.ProfileDataPath = profileFile;
+        }
+        DMCompiler::DMCompiler compiler;
+        Build result;
+        result.Compiled = compiler.Compile(settings);
+        std::string content;
+        DMCompiler::CompiledOutputView view;
+        bool opened = DMCompiler::ReadBinaryFile("test_proc_profile.dmbc", content) && view.Open(content);
+        for (const auto& proc : compiler.GetObjectTree()->AllProcs) {
+            if (proc->Name == "Hot") {
+                result.Hot = proc->Bytecode;
+                result.HotTemperature = proc->Temperature;
+                result.HotOffset = opened ? view.GetProc(proc->Id).CodeOffset : UINT32_MAX;
+            } else if (proc->Name == "Cold") {
+                result.Cold = proc->Bytecode;
+                result.ColdTemperature = proc->Temperature;
+            }
+        }
+        return result;
+    };
+    Build plain = build(false);
+    Build profiled = build(true);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove(profileFile);
+    std::filesystem::remove("test_proc_profile.json");
+    std::filesystem::remove("test_proc_profile.dmbc");
+    
+    if (!plain.Compiled || !profiled.Compiled || profiled.HotTemperature != DMCompiler::ProcTemperature::Hot ||
+        profiled.ColdTemperature != DMCompiler::ProcTemperature::Cold) {
+        std::cerr << "FAILED: The profile did not sort the procs into hot and cold" << std::endl;
+        return false;
+    }
+    // Without a profile both compile the same; the cold one still does
+    if (plain.Hot != plain.Cold || profiled.Cold != plain.Cold) {
+        std::cerr << "FAILED: Procs the profile does not make hot compiled differently" << std::endl;
+        return false;
+    }
+    // The hot one binary-searches its 5 tests (a range test per level on top
+    // of the one for 2 to 4) and fuses its field read
+    auto count = [](const std::vector<uint8_t>& bytecode, DMCompiler::DreamProcOpcode opcode) {
+        size_t found = 0;
+        for (size_t pc = 0; pc < bytecode.size();) {
+            auto instruction = DMCompiler::DecodeInstruction(bytecode, pc, DMCompiler::OperandEncoding::Fixed);
+            found += instruction.Opcode == opcode;
+            pc += instruction.Length;
+        }
+        return found;
+    };
+    using DMCompiler::DreamProcOpcode;
+    if (count(profiled.Hot, DreamProcOpcode::SwitchCaseRange) <= count(plain.Hot, DreamProcOpcode::SwitchCaseRange) ||
+        count(profiled.Hot, DreamProcOpcode::PushRefAndDereferenceField) == 0 ||
+        count(plain.Hot, DreamProcOpcode::PushRefAndDereferenceField) != 0) {
+        std::cerr << "FAILED: The hot proc was not compiled for speed" << std::endl;
+        return false;
+    }
+    if (profiled.HotOffset != 0) {
+        std::cerr << "FAILED: The hot proc's code is not first in the binary output" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Profile-guided compilation test passed!" << std::endl;
+    return true;
+}
+
+bool TestLocalityLayout() {
+    std::cout << "Testing locality code layout..." << std::endl;
+    
+    // helper is declared last, so by ID its code lands far from its caller;
+    // its loop keeps it from being inlined
+    std::string testFile = "test_locality_layout.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/a/proc/First()\n";
+        out << "\treturn helper(2) + 1\n";
+        out << "/obj/a/proc/Second()\n";
+        out << "\treturn 2\n";
+        out << "/obj/b/proc/Other()\n";
+        out << "\treturn 3\n";
+        out << "/proc/helper(n)\n";
+        out << "\tfor (var/i in 1 to n)\n";
+        out << "\t\tworld.log << i\n";
+        out << "\treturn n\n";
+    }
+    
+    struct Layout {
+        bool Compiled = false;
+        size_t FileSize = 0;
+        std::map<std::string, DMCompiler::CompiledProc> Procs;
+    };
+    auto build = [&](bool locality) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.BinaryOutput = true;
+        settings.LocalityLayout = locality;
+        DMCompiler::DMCompiler compiler;
+        Layout result;
+        result.Compiled = compiler.Compile(settings);
+        std::string content;
+        DMCompiler::CompiledOutputView view;
+        if (result.Compiled && DMCompiler::ReadBinaryFile("test_locality_layout.dmbc", content) && view.Open(content)) {
+            result.FileSize = content.size();
+            for (const auto& proc : compiler.GetObjectTree()->AllProcs) {
+                result.Procs[proc->Name] = view.GetProc(proc->Id);
+            }
+        }
+        return result;
+    };
+    Layout plain = build(false);
+    Layout local = build(true);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_locality_layout.json");
+    std::filesystem::remove("test_locality_layout.dmbc");
+    
+    if (!plain.Compiled || !local.Compiled || local.Procs.size() != plain.Procs.size() ||
+        local.FileSize != plain.FileSize) {
+        std::cerr << "FAILED: The locality layout did not store the same code" << std::endl;
+        return false;
+    }
+    auto follows = [](const Layout& layout, const std::string& first, const std::string& next) {
+        const auto& a = layout.Procs.at(first);
+        return a.CodeOffset + a.CodeSize == layout.Procs.at(next).CodeOffset;
+    };
+    if (follows(plain, "First", "helper") || !follows(local, "First", "helper")) {
+        std::cerr << "FAILED: The callee was not stored right after its caller" << std::endl;
+        return false;
+    }
+    if (!follows(local, "helper", "Second") || !follows(local, "Second", "Other")) {
+        std::cerr << "FAILED: Procs were not stored by type" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Locality code layout test passed!" << std::endl;
+    return true;
+}
+
+bool TestInlineCalls() {
+    std::cout << "Testing call inlining..." << std::endl;
+    
+    std::string testFile = "test_inline_calls.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/proc/One()\n";
+        out << "\treturn 1\n";
+        out << "/proc/Echo(x)\n";
+        out << "\treturn x\n";
+        out << "/proc/Noisy()\n";
+        out << "\tworld.log << \"noisy\"\n";
+        out << "\treturn 1\n";
+        out << "/proc/Constant()\n";
+        out << "\treturn One()\n";
+        out << "/proc/Argument()\n";
+        out << "\treturn Echo(2)\n";
+        out << "/proc/SideEffect()\n";
+        out << "\treturn Noisy()\n";
+        out << "/mob/proc/Value()\n";
+        out << "\treturn 1\n";
+        out << "/mob/player/Value()\n";
+        out << "\treturn 2\n";
+        out << "/mob/proc/Overridden()\n";
+        out << "\treturn Value()\n";
+        out << "/obj/proc/Value()\n";
+        out << "\treturn 3\n";
+        out << "/obj/proc/NotOverridden()\n";
+        out << "\treturn Value()\n";
+        out << "/proc/Native(x) as text\n";
+        out << "/proc/CallsNative()\n";
+        out << "\treturn Native(1)\n";
+    }
+    
+    // The calls each caller still makes, by name, and with --no-opts too
+    auto build = [&](bool noOpts) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.NoOpts = noOpts;
+        DMCompiler::DMCompiler compiler;
+        std::map<std::string, size_t> calls;
+        if (!compiler.Compile(settings)) {
+            return calls;
+        }
+        for (const auto& proc : compiler.GetObjectTree()->AllProcs) {
+            size_t found = 0;
+            for (size_t pc = 0; pc < proc->Bytecode.size();) {
+                auto instruction = DMCompiler::DecodeInstruction(proc->Bytecode, pc, DMCompiler::OperandEncoding::Fixed);
+                found += instruction.Opcode == DMCompiler::DreamProcOpcode::Call ||
+                         instruction.Opcode == DMCompiler::DreamProcOpcode::DereferenceCall;
+                pc += instruction.Length;
+            }
+            calls[proc->Name] = found;
+        }
+        return calls;
+    };
+    std::map<std::string, size_t> optimized = build(false);
+    std::map<std::string, size_t> plain = build(true);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_inline_calls.json");
+    
+    const char* callers[] = {"Constant", "Argument", "SideEffect", "Overridden", "NotOverridden", "CallsNative"};
+    for (const char* caller : callers) {
+        if (plain[caller] != 1) {
+            std::cerr << "FAILED: " << caller << " does not make its call with --no-opts" << std::endl;
+            return false;
+        }
+    }
+    // A constant return is inlined, on a global proc or on src when no subtype overrides it
+    if (optimized["Constant"] != 0 || optimized["NotOverridden"] != 0) {
+        std::cerr << "FAILED: A call to a proc that returns a constant was not inlined" << std::endl;
+        return false;
+    }
+    if (optimized["Overridden"] != 1) {
+        std::cerr << "FAILED: A call to a proc a subtype overrides was inlined" << std::endl;
+        return false;
+    }
+    if (optimized["Argument"] != 1 || optimized["SideEffect"] != 1) {
+        std::cerr << "FAILED: A proc returning its argument or with side effects was inlined" << std::endl;
+        return false;
+    }
+    
+    if (optimized["CallsNative"] != 1) {
+        std::cerr << "FAILED: A call to a proc declared without a body, as DMStandard's natives are, was inlined" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Call inlining test passed!" << std::endl;
+    return true;
+}
+
+bool TestCheckOnly() {
+    std::cout << "Testing --check-only..." << std::endl;
+    
+    std::string testFile = "test_check_only.dm";
+    {
+        std::ofstream out(testFile);
+        // Errors and warnings from lowering procs, on several threads
+        for (int i = 0; i < 8; ++i) {
+            out << "/obj/t" << i << "\n";
+            out << "\tvar/const/C = " << i << "\n";
+            out << "\tproc/Run(a)\n";
+            out << "\t\tC = 2\n";
+            out << "\t\tgoto nowhere" << i << "\n";
+            out << "\t\tvar/s = \"text" << i << "\"\n";
+            out << "\t\treturn call()() + s\n";
+        }
+    }
+    
+    struct Check {
+        bool Compiled = false;
+        int Errors = 0;
+        int Warnings = 0;
+        std::vector<std::string> Messages;
+        bool WroteOutput = false;
+    };
+    auto check = [&](bool checkOnly) {
+        std::filesystem::remove("test_check_only.json");
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.CheckOnly = checkOnly;
+        settings.CompileThreads = 4;
+        DMCompiler::DMCompiler compiler;
+        Check result;
+        result.Compiled = compiler.Compile(settings);
+        result.Errors = compiler.GetErrorCount();
+        result.Warnings = compiler.GetWarningCount();
+        result.Messages = compiler.GetCompilerMessages();
+        result.WroteOutput = std::filesystem::exists("test_check_only.json");
+        return result;
+    };
+    Check full = check(false);
+    Check lint = check(true);
+    
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_check_only.json");
+    
+    if (lint.WroteOutput) {
+        std::cerr << "FAILED: --check-only wrote the output" << std::endl;
+        return false;
+    }
+    if (full.Errors == 0 || lint.Compiled || lint.Errors != full.Errors || lint.Warnings != full.Warnings ||
+        lint.Messages != full.Messages) {
+        std::cerr << "FAILED: --check-only reported " << lint.Errors << " errors and " << lint.Warnings
+                  << " warnings, a build " << full.Errors << " and " << full.Warnings << std::endl;
+        return false;
+    }
+    
+    std::cout << "--check-only test passed!" << std::endl;
+    return true;
+}
+
+bool TestDeadBranchDiagnostics() {
+    std::cout << "Testing diagnostics from dead branches..." << std::endl;
+    
+    std::string testFile = "test_dead_branches.dm";
+    {
+        std::ofstream out(testFile);
+        // Every branch here is dropped when optimizing
+        out << "/proc/Dead(x)\n";
+        out << "\tif(0)\n";
+        out << "\t\tgoto nowhere_if\n";
+        out << "\twhile(0)\n";
+        out << "\t\tgoto nowhere_while\n";
+        out << "\tswitch(2)\n";
+        out << "\t\tif(1)\n";
+        out << "\t\t\tgoto nowhere_switch\n";
+        out << "\t\tif(2)\n";
+        out << "\t\t\treturn x\n";
+        out << "\treturn x\n";
+    }
+    
+    auto check = [&](bool noOpts) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.NoOpts = noOpts;
+        settings.CheckOnly = true;
+        DMCompiler::DMCompiler compiler;
+        compiler.Compile(settings);
+        // Leave out the warning that --no-opts is on
+        std::vector<std::string> messages;
+        for (const auto& message : compiler.GetCompilerMessages()) {
+            if (message.find("--no-opts") == std::string::npos) {
+                messages.push_back(message);
+            }
+        }
+        return messages;
+    };
+    std::vector<std::string> optimized = check(false);
+    std::vector<std::string> plain = check(true);
+    
+    std::filesystem::remove(testFile);
+    
+    bool undefinedLabel = false;
+    for (const auto& message : plain) {
+        undefinedLabel |= message.find("Undefined label 'nowhere_if'") != std::string::npos;
+    }
+    if (!undefinedLabel || optimized != plain) {
+        std::cerr << "FAILED: Optimizing reported " << optimized.size() << " messages, --no-opts "
+                  << plain.size() << std::endl;
+        return false;
+    }
+    
+    std::cout << "Dead branch diagnostics test passed!" << std::endl;
+    return true;
+}
+
+bool TestStreamTokensPragma() {
+    std::cout << "Testing #pragma with --stream-tokens..." << std::endl;
+    
+    std::string testFile = "test_stream_pragma.dm";
+    {
+        std::ofstream out(testFile);
+        out << "#pragma SoftReservedKeyword error\n";
+        out << "/mob/proc/Run()\n";
+        out << "\treturn 1\n";
+    }
+    
+    auto check = [&](bool streamTokens) {
+        DMCompiler::DMCompilerSettings settings;
+        settings.Files.push_back(testFile);
+        settings.NoStandard = true;
+        settings.StreamTokens = streamTokens;
+        settings.CheckOnly = true;
+        DMCompiler::DMCompiler compiler;
+        compiler.Compile(settings);
+        return compiler.GetCompilerMessages();
+    };
+    std::vector<std::string> buffered = check(false);
+    std::vector<std::string> streamed = check(true);
+    
+    std::filesystem::remove(testFile);
+    
+    auto ignored = [](const std::vector<std::string>& messages) {
+        for (const auto& message : messages) {
+            if (message.find("ignored with --stream-tokens") != std::string::npos) {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (ignored(buffered) || !ignored(streamed)) {
+        std::cerr << "FAILED: A warning #pragma was not refused with --stream-tokens, and only then" << std::endl;
+        return false;
+    }
+    
+    std::cout << "#pragma with --stream-tokens test passed!" << std::endl;
+    return true;
+}
+
+bool TestCommandLineDefines() {
+    std::cout << "Testing command-line defines..." << std::endl;
+    
+    std::string testFile = "test_command_line_defines.dm";
+    {
+        std::ofstream out(testFile);
+        out << "/obj/item\n";
+        out << "\tvar/count = COUNT\n";
+        out << "\tvar/rate = RATE\n";
+        out << "\tvar/name = NAME\n";
+        out << "\tvar/total = COUNT + SUM\n";
+        out << "/proc/Who()\n";
+        out << "\tvar/abc = 3\n";
+        out << "\treturn WHO\n";
+        out << "#ifdef FLAG\n";
+        out << "/proc/Flagged()\n";
+        out << "\treturn 1\n";
+        out << "#endif\n";
+    }
+    
+    // Each value is used as the tokens it would be written as
+    DMCompiler::DMCompilerSettings settings;
+    settings.Files.push_back(testFile);
+    settings.NoStandard = true;
+    settings.MacroDefines["COUNT"] = "5";
+    settings.MacroDefines["RATE"] = "1.5";
+    settings.MacroDefines["NAME"] = "\"hero\"";
+    settings.MacroDefines["SUM"] = "2 * 3";
+    settings.MacroDefines["WHO"] = "abc";
+    settings.MacroDefines["FLAG"] = "";
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    std::string json;
+    DMCompiler::ReadBinaryFile("test_command_line_defines.json", json);
+    std::filesystem::remove(testFile);
+    std::filesystem::remove("test_command_line_defines.json");
+    
+    if (!compiled || compiler.GetErrorCount() != 0) {
+        std::cerr << "FAILED: A define used as a value did not compile" << std::endl;
+        return false;
+    }
+    if (json.find("\"count\": 5") == std::string::npos || json.find("\"rate\": 1.500000") == std::string::npos ||
+        json.find("\"name\": \"hero\"") == std::string::npos || json.find("\"total\": 11") == std::string::npos ||
+        json.find("\"Flagged\"") == std::string::npos) {
+        std::cerr << "FAILED: Defines did not expand to their values" << std::endl;
+        return false;
+    }
+    
+    std::cout << "Command-line defines test passed!" << std::endl;
+    return true;
+}
+
+bool TestBatchCompiler() {
+    std::cout << "Testing batch compilation..." << std::endl;
+    
+    std::filesystem::remove_all("test_batch_cache");
+    {
+        std::ofstream out("test_batch.dm");
+        out << "#ifdef UNIT_TESTS\n";
+        out << "/mob/proc/RunTests()\n";
+        out << "#else\n";
+        out << "/mob/proc/Live()\n";
+        out << "#endif\n";
+        out << "\treturn 1\n";
+    }
+    // Args are a define (or nothing), an output (or nothing) and the file
+    DMCompiler::BatchCompiler batch("test_batch_cache", [](const std::vector<std::string>& args,
+                                                           DMCompiler::DMCompilerSettings& settings) {
+        if (!args[0].empty()) {
+            settings.MacroDefines[args[0]] = "1";
+        }
+        settings.OutputPath = args[1];
+        settings.Files.push_back(args[2]);
+        settings.NoStandard = true;
+        return true;
+    });
+    // The last two targets both write test_batch.json, so one of them is refused
+    std::vector<DMCompiler::BatchCompiler::Target> targets = {
+        {"tests", {"UNIT_TESTS", "test_batch_tests.json", "test_batch.dm"}},
+        {"production", {"", "", "test_batch.dm"}},
+        {"again", {"", "test_batch.json", "test_batch.dm"}},
+    };
+    std::ostringstream out;
+    auto results = batch.Compile(targets, 2, out);
+    
+    auto read = [](const char* path) {
+        std::string contents;
+        DMCompiler::ReadBinaryFile(path, contents);
+        return contents;
+    };
+    std::string tests = read("test_batch_tests.json");
+    std::string production = read("test_batch.json");
+    for (const char* file : {"test_batch.dm", "test_batch.json", "test_batch_tests.json"}) {
+        std::filesystem::remove(file);
+    }
+    std::filesystem::remove_all("test_batch_cache");
+    
+    if (results.size() != 3 || !results[0].Success || results[1].Success == results[2].Success ||
+        results[0].Output.find("Compiling: test_batch.dm") == std::string::npos) {
+        std::cerr << "FAILED: Batch targets did not compile as expected:\n" << out.str() << std::endl;
+        return false;
+    }
+    const auto& refused = results[1].Success ? results[2] : results[1];
+    if (refused.Output.find("--output") == std::string::npos) {
+        std::cerr << "FAILED: Targets writing the same output were not told apart: " << refused.Output << std::endl;
+        return false;
+    }
+    if (tests.find("\"RunTests\"") == std::string::npos || tests.find("\"Live\"") != std::string::npos ||
+        production.find("\"Live\"") == std::string::npos || production.find("\"RunTests\"") != std::string::npos) {
+        std::cerr << "FAILED: Batch targets did not get their own defines and outputs" << std::endl;
+        return false;
+    }
+    if (out.str().find("=== tests: succeeded") == std::string::npos ||
+        out.str().find("Batch: 2 of 3 targets succeeded") == std::string::npos) {
+        std::cerr << "FAILED: Batch output is missing target results or the summary:\n" << out.str() << std::endl;
+        return false;
+    }
+    
+    std::cout << "Batch compilation test passed!" << std::endl;
+    return true;
+}
+
 int RunCompilerTests() {
     std::cout << "\n=== Running Compiler Tests ===" << std::endl;
     
     try {
         TestSimpleCompilation();
         TestWithActualDME();
+        if (!TestParallelProcCompilation()) {
+            return 1;
+        }
+        if (!TestDeterministicOutput()) {
+            return 1;
+        }
+        if (!TestDiagnosticBuffer()) {
+            return 1;
+        }
+        if (!TestLongOperatorChain()) {
+            return 1;
+        }
+        if (!TestBinaryOutput()) {
+            return 1;
+        }
+        if (!TestJsonWriter()) {
+            return 1;
+        }
+        if (!TestCompressedOutput()) {
+            return 1;
+        }
+        if (!TestIncrementalOutput()) {
+            return 1;
+        }
+        if (!TestBinaryMapCells()) {
+            return 1;
+        }
+        if (!TestStreamedMaps()) {
+            return 1;
+        }
+        if (!TestResourceManifest()) {
+            return 1;
+        }
+        if (!TestResourceOrder()) {
+            return 1;
+        }
+        if (!TestMergedMemberTables()) {
+            return 1;
+        }
+        if (!TestCompileTimings()) {
+            return 1;
+        }
+        if (!TestMemoryRelease()) {
+            return 1;
+        }
+        if (!TestCompileCosts()) {
+            return 1;
+        }
+        if (!TestCompileServer()) {
+            return 1;
+        }
+        if (!TestProcCache()) {
+            return 1;
+        }
+        if (!TestBytecodeVerifier()) {
+            return 1;
+        }
+        if (!TestProcProfile()) {
+            return 1;
+        }
+        if (!TestLocalityLayout()) {
+            return 1;
+        }
+        if (!TestInlineCalls()) {
+            return 1;
+        }
+        if (!TestCheckOnly()) {
+            return 1;
+        }
+        if (!TestDeadBranchDiagnostics()) {
+            return 1;
+        }
+        if (!TestStreamTokensPragma()) {
+            return 1;
+        }
+        if (!TestBatchCompiler()) {
+            return 1;
+        }
+        if (!TestCommandLineDefines()) {
+            return 1;
+        }
         
         std::cout << "\nCompiler tests completed!" << std::endl;
         return 0;
@@ -2,11 +2,18 @@
 /// @brief Unit tests for DMDisassembler enhancements (JSON loading, decompilation)
 
 #include "../include/DMDisassembler.h"
+#include "../include/DMCompiler.h"
+#include "../include/DisasmServer.h"
+#include "../include/OperandEncoding.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <vector>
 #include <string>
 #include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 
 using namespace DMCompiler;
 
@@ -69,7 +76,7 @@ TEST(TestLoadFromValidJson) {
     // Note: LoadJson might return false if specific required fields are missing or empty
     // but it should parse the JSON successfully.
     // We are testing the loading mechanism here.
-    bool result = disassembler.LoadJson("valid.json");
+    disassembler.LoadJson("valid.json");
     
     // If the disassembler requires more complex data to return 'true', 
     // we at least verify it doesn't crash.
@@ -82,6 +89,464 @@ TEST(TestLoadFromValidJson) {
     std::remove("valid.json");
 }
 
+TEST(TestStreamedJsonLoad) {
+    DMDisassembler disassembler;
+    
+    // Procs ahead of types, and nested values the disassembler does not read
+    std::string jsonContent = R"({
+        "Metadata": {"Version": "test"},
+        "Strings": ["a", "b"],
+        "Procs": [
+            {"Name": "Run", "OwningTypeId": 1, "Arguments": [{"Name": "x", "Type": {"Name": "nested"}}],
+             "Bytecode": [1, 2, 255], "IsVerb": true}
+        ],
+        "Types": [
+            {"Path": "/"},
+            {"Path": "/obj", "Parent": 0, "Variables": {"name": {"Procs": [[9]]}, "desc": null}, "Procs": [[0]]}
+        ],
+        "Maps": [{"Blocks": [{"Cells": ["aa"]}]}]
+    })";
+    CreateDummyJson("streamed.json", jsonContent);
+    EXPECT_TRUE(disassembler.LoadJson("streamed.json"));
+    std::remove("streamed.json");
+    
+    const auto& procs = disassembler.GetProcs();
+    const auto& types = disassembler.GetTypes();
+    EXPECT_TRUE(procs.size() == 1 && types.size() == 2);
+    if (procs.size() == 1 && types.size() == 2) {
+        EXPECT_TRUE(procs[0].OwnerPath == "/obj");
+        EXPECT_TRUE(procs[0].Parameters == std::vector<std::string>{"x"});
+        EXPECT_TRUE(procs[0].Bytecode == std::vector<uint8_t>({1, 2, 255}));
+        EXPECT_TRUE(procs[0].IsVerb);
+        EXPECT_TRUE(types[1].ParentId == 0);
+        EXPECT_TRUE(types[1].Variables == std::vector<std::string>({"desc", "name"}));
+        EXPECT_TRUE(types[1].ProcIds == std::vector<int>{0});
+        EXPECT_TRUE(disassembler.GetString(1) == "b");
+    }
+}
+
+TEST(TestLazyBinaryLoad) {
+    CreateDummyJson("lazy.dm", "/obj/item\n\tproc/Describe()\n\t\treturn \"item\"\n\tproc/Use(user)\n\t\treturn user\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("lazy.dm");
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    // Bytecode is read from the binary file on first use, the same as the JSON has it
+    DMDisassembler fromJson;
+    DMDisassembler fromBinary;
+    EXPECT_TRUE(compiled && fromJson.Load("lazy.json") && fromBinary.Load("lazy.dmbc"));
+    EXPECT_TRUE(fromBinary.GetStats().TotalBytecodeSize == fromJson.GetStats().TotalBytecodeSize);
+    for (const auto& proc : fromJson.GetProcs()) {
+        EXPECT_TRUE(fromBinary.DecompileProc(proc.Id) == fromJson.DecompileProc(proc.Id));
+        const DisasmProc* loaded = fromBinary.GetProc(proc.Id);
+        EXPECT_TRUE(loaded && loaded->Bytecode == proc.Bytecode);
+    }
+    
+    for (const char* file : {"lazy.dm", "lazy.json", "lazy.dmbc"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestParallelDumpAndTest) {
+    // Enough procs for several fragments of DumpAll's output
+    {
+        std::ofstream out("parallel.dm");
+        for (int i = 0; i < 600; ++i) {
+            out << "/obj/item" << i << "\n\tproc/Use(user)\n\t\treturn user + " << i << "\n";
+        }
+    }
+    DMCompilerSettings settings;
+    settings.Files.push_back("parallel.dm");
+    settings.NoStandard = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    DMDisassembler disassembler;
+    EXPECT_TRUE(compiled && disassembler.Load("parallel.json"));
+    std::ostringstream sequential;
+    std::ostringstream parallel;
+    disassembler.DumpAll(sequential);
+    disassembler.DumpAll(parallel, 4);
+    EXPECT_TRUE(!sequential.str().empty() && parallel.str() == sequential.str());
+    EXPECT_TRUE(disassembler.TestAll(4) == disassembler.TestAll());
+    
+    std::remove("parallel.dm");
+    std::remove("parallel.json");
+}
+
+TEST(TestIndexedSearch) {
+    CreateDummyJson("search.dm",
+                    "/obj/item\n\tvar/label = \"x\"\n\tproc/Describe()\n\t\treturn \"A shiny Widget\"\n"
+                    "\tproc/Rename()\n\t\tlabel = \"widget\"\n\t\treturn label\n"
+                    "/obj/widget_box\n\tproc/Open()\n\t\treturn 1\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("search.dm");
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    DMDisassembler disassembler;
+    EXPECT_TRUE(compiled && disassembler.Load("search.dmbc"));
+    
+    // Indexed (three or more characters) and scanned queries, types before procs
+    auto results = disassembler.Search("WIDGET");
+    EXPECT_TRUE(results.size() == 1 && results[0] == "/obj/widget_box");
+    results = disassembler.Search("re");
+    EXPECT_TRUE(std::find(results.begin(), results.end(), "/obj/item/Rename") != results.end());
+    EXPECT_TRUE(disassembler.Search("escr").size() == 1);
+    EXPECT_TRUE(disassembler.Search("nothing like it").empty());
+    
+    auto strings = disassembler.SearchStrings("shiny widget");
+    EXPECT_TRUE(strings.size() == 1 && disassembler.GetString(strings[0]) == "A shiny Widget");
+    auto users = disassembler.GetProcsReferencingString(strings[0]);
+    EXPECT_TRUE(users.size() == 1 && users[0]->Name == "Describe");
+    
+    // A field is named by its string
+    strings = disassembler.SearchStrings("label");
+    EXPECT_TRUE(strings.size() == 1);
+    users = disassembler.GetProcsReferencingString(strings.empty() ? 0 : strings[0]);
+    EXPECT_TRUE(std::any_of(users.begin(), users.end(), [](const auto* proc) { return proc->Name == "Rename"; }));
+    
+    for (const char* file : {"search.dm", "search.json", "search.dmbc"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestProfile) {
+    CreateDummyJson("profile.dm",
+                    "/proc/helper(x)\n\treturn x\n"
+                    "/obj/item\n\tvar/obj/item/other\n\tproc/Use()\n\t\thelper(1)\n\t\thelper(2)\n"
+                    "\t\tother.Describe()\n\t\treturn 1\n\tproc/Describe()\n\t\treturn \"item\"\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("profile.dm");
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    DMCompiler::DMCompiler compiler;
+    bool compiled = compiler.Compile(settings);
+    
+    DMDisassembler fromJson;
+    DMDisassembler fromBinary;
+    EXPECT_TRUE(compiled && fromJson.Load("profile.json") && fromBinary.Load("profile.dmbc"));
+    auto profile = fromJson.GetProfile(5);
+    auto binaryProfile = fromBinary.GetProfile(5);
+    
+    // Use() calls helper twice and Describe once: two distinct callees
+    EXPECT_TRUE(profile.CallFanOut.size() == 1 && profile.CallFanOut[0].first == "/obj/item/Use" &&
+                profile.CallFanOut[0].second == 2);
+    EXPECT_TRUE(!profile.ProcSizes.empty() && profile.ProcSizes[0].first == "/obj/item/Use");
+    EXPECT_TRUE(!profile.StackSizes.empty() && profile.StackSizes[0].second > 0);
+    size_t counted = 0;
+    for (const auto& [name, count] : profile.Opcodes) {
+        counted += count;
+    }
+    EXPECT_TRUE(counted == profile.InstructionCount && counted > 0);
+    EXPECT_TRUE(binaryProfile.Opcodes == profile.Opcodes && binaryProfile.TypeSizes == profile.TypeSizes &&
+                binaryProfile.StackSizes == profile.StackSizes && binaryProfile.CallFanOut == profile.CallFanOut);
+    
+    for (const char* file : {"profile.dm", "profile.json", "profile.dmbc"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestDiff) {
+    CreateDummyJson("diff_old.dm",
+                    "/obj/item\n\tproc/Use()\n\t\tvar/a = 1\n\t\tvar/b = 2\n\t\treturn a + b\n"
+                    "\tproc/Describe()\n\t\treturn \"item\"\n/obj/gone\n\tproc/Old()\n\t\treturn 0\n");
+    // Strings come in a different order, which does not count as a change
+    CreateDummyJson("diff_new.dm",
+                    "/obj/fresh\n\tproc/New()\n\t\treturn \"fresh\"\n"
+                    "/obj/item\n\tproc/Describe()\n\t\treturn \"item\"\n\tproc/Use()\n\t\tvar/a = 1\n"
+                    "\t\tvar/b = 3\n\t\treturn a + b + 1\n");
+    bool compiled = true;
+    for (const char* file : {"diff_old.dm", "diff_new.dm"}) {
+        DMCompilerSettings settings;
+        settings.Files.push_back(file);
+        settings.NoStandard = true;
+        DMCompiler::DMCompiler compiler;
+        compiled = compiler.Compile(settings) && compiled;
+    }
+    
+    DMDisassembler oldOutput;
+    DMDisassembler newOutput;
+    EXPECT_TRUE(compiled && oldOutput.Load("diff_old.json") && newOutput.Load("diff_new.json"));
+    std::ostringstream out;
+    auto summary = oldOutput.Diff(newOutput, out);
+    std::string report = out.str();
+    EXPECT_TRUE(summary.AddedTypes == 1 && summary.RemovedTypes == 1);
+    EXPECT_TRUE(summary.AddedProcs == 1 && summary.RemovedProcs == 1);
+    EXPECT_TRUE(summary.ChangedProcs == 1 && report.find("~ proc /obj/item/Use:") != std::string::npos);
+    EXPECT_TRUE(report.find("Describe") == std::string::npos);
+    EXPECT_TRUE(report.find("- proc /obj/gone/Old") != std::string::npos &&
+                report.find("+ proc /obj/fresh/New") != std::string::npos);
+    EXPECT_TRUE(summary.MatchedProcs == 2 && summary.OldBytecodeSize > 0 && summary.NewBytecodeSize > 0);
+    
+    // An output compared with itself has nothing to report but the summary
+    std::ostringstream same;
+    summary = newOutput.Diff(newOutput, same);
+    EXPECT_TRUE(summary.ChangedProcs == 0 && summary.AddedProcs == 0 && same.str().rfind("\nSummary:", 0) == 0);
+    
+    // Nor do compact operands change instructions, jumps included, only sizes
+    CreateDummyJson("diff_compact.dm", "/proc/count(n)\n\tfor(var/i = 0, i < n, i++)\n\t\tif(i > 300)\n\t\t\treturn \"many\"\n\treturn n\n");
+    DMDisassembler fixedOutput;
+    DMDisassembler compactOutput;
+    for (bool compact : {false, true}) {
+        DMCompilerSettings settings;
+        settings.Files.push_back("diff_compact.dm");
+        settings.NoStandard = true;
+        settings.CompactOperands = compact;
+        DMCompiler::DMCompiler compiler;
+        EXPECT_TRUE(compiler.Compile(settings) && (compact ? compactOutput : fixedOutput).Load("diff_compact.json"));
+    }
+    std::ostringstream encodings;
+    summary = fixedOutput.Diff(compactOutput, encodings);
+    EXPECT_TRUE(summary.ChangedProcs > 0 && summary.NewBytecodeSize < summary.OldBytecodeSize);
+    EXPECT_TRUE(encodings.str().find("\n    ") == std::string::npos);
+    
+    for (const char* file : {"diff_old.dm", "diff_old.json", "diff_new.dm", "diff_new.json", "diff_compact.dm",
+                             "diff_compact.json"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestCallGraph) {
+    CreateDummyJson("callgraph.dm",
+                    "/proc/helper(x)\n\treturn x\n/proc/ping(n)\n\treturn pong(n)\n/proc/pong(n)\n\treturn ping(n)\n"
+                    "/proc/orphan()\n\treturn orphan()\n"
+                    "/proc/later()\n\tworld.log << \"later\"\n"
+                    "/world/New()\n\tvar/obj/item/I = new /obj/item()\n\tI.Use()\n"
+                    "\tvar/list/L = list(0)\n\tL[1] = 2\n\tlater()\n\treturn ..()\n"
+                    "/obj/item\n\tproc/Use()\n\t\tDescribe()\n\t\treturn helper(1)\n"
+                    "\tproc/Describe()\n\t\treturn 0\n"
+                    "\tverb/look()\n\t\tset src in view()\n\t\treturn ping(1)\n"
+                    "/obj/item/sword\n\tDescribe()\n\t\treturn ..()\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("callgraph.dm");
+    settings.NoStandard = true;
+    DMCompiler::DMCompiler compiler;
+    DMDisassembler disassembler;
+    EXPECT_TRUE(compiler.Compile(settings) && disassembler.Load("callgraph.json"));
+    
+    CallGraph graph = disassembler.BuildCallGraph();
+    auto procNamed = [&](const std::string& label) {
+        for (size_t id = 0; id < graph.GetProcCount(); ++id) {
+            if (graph.GetLabel(static_cast<int>(id)) == label) {
+                return static_cast<int>(id);
+            }
+        }
+        return -1;
+    };
+    auto calls = [&](const std::string& caller, const std::string& callee) {
+        const auto& callees = graph.GetCallees(procNamed(caller));
+        return std::find(callees.begin(), callees.end(), procNamed(callee)) != callees.end();
+    };
+    EXPECT_TRUE(graph.GetRoots().size() == 2);
+    EXPECT_TRUE(calls("/world/New", "/obj/item/Use"));
+    // src.Describe() may run the override, whose ..() runs the original
+    EXPECT_TRUE(calls("/obj/item/Use", "/obj/item/Describe") && calls("/obj/item/Use", "/obj/item/sword/Describe"));
+    EXPECT_TRUE(calls("/obj/item/sword/Describe", "/obj/item/Describe"));
+    EXPECT_TRUE(calls("/obj/item/Use", "/proc/helper"));
+    // Calls after a store into a list are still found
+    EXPECT_TRUE(calls("/world/New", "/proc/later"));
+    
+    auto unreachable = graph.FindUnreachable();
+    EXPECT_TRUE(unreachable.size() == 1 && unreachable[0] == procNamed("/proc/orphan"));
+    auto groups = graph.FindRecursiveGroups();
+    EXPECT_TRUE(groups.size() == 2);
+    EXPECT_TRUE(groups[0] == std::vector<int>({procNamed("/proc/ping"), procNamed("/proc/pong")}));
+    EXPECT_TRUE(groups[1] == std::vector<int>({procNamed("/proc/orphan")}));
+    
+    auto chain = graph.FindDeepestChain();
+    std::vector<int> expected{procNamed("/world/New"), procNamed("/obj/item/Use"), procNamed("/obj/item/sword/Describe"),
+                              procNamed("/obj/item/Describe")};
+    EXPECT_TRUE(chain == expected);
+    
+    std::ostringstream dot;
+    graph.WriteDot(dot);
+    EXPECT_TRUE(dot.str().rfind("digraph calls {", 0) == 0 && dot.str().find("/proc/orphan\", color=gray") != std::string::npos);
+    std::string json = graph.ToJson();
+    EXPECT_TRUE(json.find("\"RecursiveGroups\"") != std::string::npos && json.find("\"DeepestChain\"") != std::string::npos);
+    
+    std::remove("callgraph.dm");
+    std::remove("callgraph.json");
+}
+
+TEST(TestStripUnused) {
+    CreateDummyJson("strip.dm",
+                    "/proc/helper(x)\n\treturn x\n/proc/orphan()\n\treturn helper(2)\n/proc/last()\n\treturn 3\n"
+                    "/proc/kept()\n\tworld.log << \"kept\"\n"
+                    "/world/New()\n\tvar/list/L = list(0)\n\tL[1] = 2\n\tkept()\n\treturn helper(1) + last()\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("strip.dm");
+    settings.NoStandard = true;
+    settings.StripUnused = true;
+    DMCompiler::DMCompiler compiler;
+    DMDisassembler disassembler;
+    EXPECT_TRUE(compiler.Compile(settings) && disassembler.Load("strip.json"));
+    
+    // The procs after orphan moved down a slot, and the calls to them with it
+    CallGraph graph = disassembler.BuildCallGraph();
+    std::vector<std::string> labels;
+    for (size_t id = 0; id < graph.GetProcCount(); ++id) {
+        labels.push_back(graph.GetLabel(static_cast<int>(id)));
+    }
+    EXPECT_TRUE(std::find(labels.begin(), labels.end(), "/proc/orphan") == labels.end());
+    EXPECT_TRUE(graph.FindUnreachable().empty() && disassembler.TestAll(1) == 0);
+    // A store into a list does not hide the call after it
+    EXPECT_TRUE(std::find(labels.begin(), labels.end(), "/proc/kept") != labels.end());
+    EXPECT_TRUE(std::none_of(compiler.GetCompilerMessages().begin(), compiler.GetCompilerMessages().end(),
+                             [](const std::string& message) { return message.find("cannot follow") != std::string::npos; }));
+    
+    std::ifstream report("strip.stripped.json");
+    std::stringstream text;
+    text << report.rdbuf();
+    EXPECT_TRUE(text.str().find("\"/proc/orphan\"") != std::string::npos);
+    report.close();
+    
+    for (const char* file : {"strip.dm", "strip.json", "strip.stripped.json"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestStripUnusedWithStandard) {
+    // The engine calls DMStandard's procs and the game's overrides of them; only
+    // dmcompiler finds DMStandard, next to itself, so this compiles with it
+    CreateDummyJson("strip_std.dm",
+                    "/mob/Login()\n\treturn ..()\n/atom/Click(location, control, params)\n\treturn 1\n"
+                    "/client/Topic(href, href_list, hsrc)\n\treturn ..()\n/proc/orphan()\n\treturn 1\n");
+#ifdef _WIN32
+    const char* command = "..\\dmcompiler.exe --strip-unused strip_std.dm";
+#else
+    const char* command = "../dmcompiler --strip-unused strip_std.dm";
+#endif
+    DMDisassembler disassembler;
+    EXPECT_TRUE(std::system(command) == 0 && disassembler.Load("strip_std.json"));
+    
+    CallGraph graph = disassembler.BuildCallGraph();
+    std::vector<std::string> labels;
+    for (size_t id = 0; id < graph.GetProcCount(); ++id) {
+        labels.push_back(graph.GetLabel(static_cast<int>(id)));
+    }
+    auto kept = [&](const char* label) { return std::find(labels.begin(), labels.end(), label) != labels.end(); };
+    EXPECT_TRUE(kept("/mob/Login") && kept("/atom/Click") && kept("/client/Topic"));
+    EXPECT_TRUE(kept("/client/Click") && kept("/proc/abs"));
+    EXPECT_FALSE(kept("/proc/orphan"));
+    
+    std::ifstream report("strip_std.stripped.json");
+    std::stringstream text;
+    text << report.rdbuf();
+    EXPECT_TRUE(text.str().find("\"/proc/orphan\"") != std::string::npos);
+    report.close();
+    
+    for (const char* file : {"strip_std.dm", "strip_std.json", "strip_std.stripped.json"}) {
+        std::remove(file);
+    }
+}
+
+TEST(TestNativeCallsWithStandard) {
+    // DMStandard declares its natives without a body; calls to them are not
+    // inlined as calls to procs that return null
+    CreateDummyJson("natives.dm", "/proc/Shout(name)\n\treturn uppertext(name)\n/proc/Nap()\n\tsleep(1)\n");
+#ifdef _WIN32
+    const char* command = "..\\dmcompiler.exe natives.dm";
+#else
+    const char* command = "../dmcompiler natives.dm";
+#endif
+    DMDisassembler disassembler;
+    EXPECT_TRUE(std::system(command) == 0 && disassembler.Load("natives.json"));
+    
+    size_t calls = 0;
+    for (const DisasmProc& proc : disassembler.GetProcs()) {
+        if (proc.Name != "Shout" && proc.Name != "Nap") {
+            continue;
+        }
+        for (size_t pc = 0; pc < proc.Bytecode.size();) {
+            DecodedInstruction instruction = DecodeInstruction(proc.Bytecode, pc, disassembler.GetOperandEncoding());
+            calls += instruction.Opcode == DreamProcOpcode::Call;
+            pc += instruction.Length;
+        }
+    }
+    EXPECT_TRUE(calls == 2);
+    
+    std::remove("natives.dm");
+    std::remove("natives.json");
+}
+
+TEST(TestVersionWithStandard) {
+    // DMStandard's world.byond_version is DM_VERSION; a batch compiles both
+    // targets one after the other, and the second must not reuse the DMStandard
+    // the first preprocessed under another --version
+    CreateDummyJson("version.dm", "/mob/Login()\n\treturn ..()\n");
+    CreateDummyJson("version.batch.json",
+                    "{\"Targets\": [{\"Args\": [\"--version\", \"515\", \"--output\", \"version_515.json\", \"version.dm\"]},\n"
+                    "             {\"Args\": [\"--version\", \"514\", \"--output\", \"version_514.json\", \"version.dm\"]}]}\n");
+#ifdef _WIN32
+    const char* command = "..\\dmcompiler.exe --batch version.batch.json --batch-threads 1 --batch-cache version_cache";
+#else
+    const char* command = "../dmcompiler --batch version.batch.json --batch-threads 1 --batch-cache version_cache";
+#endif
+    EXPECT_TRUE(std::system(command) == 0);
+    
+    auto read = [](const char* path) {
+        std::ifstream in(path);
+        std::stringstream text;
+        text << in.rdbuf();
+        return text.str();
+    };
+    std::string current = read("version_515.json");
+    std::string older = read("version_514.json");
+    EXPECT_TRUE(current.find("\"byond_version\": 515") != std::string::npos);
+    EXPECT_TRUE(older.find("\"byond_version\": 514") != std::string::npos);
+    EXPECT_FALSE(older.find("\"byond_version\": 515") != std::string::npos);
+    
+    for (const char* file : {"version.dm", "version.batch.json", "version_515.json", "version_514.json"}) {
+        std::remove(file);
+    }
+    std::filesystem::remove_all("version_cache");
+}
+
+TEST(TestServer) {
+    CreateDummyJson("serve.dm", "/mob/proc/Greet()\n\treturn \"hello\"\n");
+    DMCompilerSettings settings;
+    settings.Files.push_back("serve.dm");
+    settings.NoStandard = true;
+    settings.BinaryOutput = true;
+    DMCompiler::DMCompiler compiler;
+    EXPECT_TRUE(compiler.Compile(settings));
+    
+    DisasmServer server("serve.dmbc");
+    EXPECT_TRUE(server.Load());
+    std::string reply = server.Handle(R"({"id": 7, "method": "Search", "params": {"query": "greet"}})");
+    EXPECT_TRUE(reply.find("\"id\":7") != std::string::npos && reply.find("/mob/Greet") != std::string::npos);
+    reply = server.Handle(R"({"id": "s", "method": "SearchStrings", "params": {"query": "hello"}})");
+    EXPECT_TRUE(reply.find("\"Text\":\"hello\"") != std::string::npos);
+    EXPECT_TRUE(server.Handle(R"({"id": 1, "method": "DecompileProc", "params": {"id": 99}})").find("\"error\"") != std::string::npos);
+    EXPECT_TRUE(server.Handle("not json").find("\"error\"") != std::string::npos);
+    
+    // A new compile is picked up without being asked to
+    CreateDummyJson("serve.dm", "/mob/proc/Greet()\n\treturn \"hello\"\n/mob/proc/Wave()\n\treturn 1\n");
+    DMCompiler::DMCompiler recompiler;
+    EXPECT_TRUE(recompiler.Compile(settings));
+    reply = server.Handle(R"({"method": "Search", "params": {"query": "wave"}})");
+    EXPECT_TRUE(reply.find("/mob/Wave") != std::string::npos);
+    
+    std::stringstream in("{\"id\": 1, \"method\": \"Stats\"}\n\n{\"id\": 2, \"method\": \"Nope\"}\n");
+    std::stringstream out;
+    server.Serve(in, out);
+    std::string first;
+    std::string second;
+    std::getline(out, first);
+    std::getline(out, second);
+    EXPECT_TRUE(first.find("\"Procs\"") != std::string::npos && second.find("Unknown method") != std::string::npos);
+    
+    for (const char* file : {"serve.dm", "serve.json", "serve.dmbc"}) {
+        std::remove(file);
+    }
+}
+
 TEST(TestDecompileProc) {
     // This is a placeholder test. 
     // Real decompilation testing requires setting up a full DMProc object 
@@ -104,6 +569,18 @@ int main() {
     
     TestLoadFromInvalidJson();
     TestLoadFromValidJson();
+    TestStreamedJsonLoad();
+    TestLazyBinaryLoad();
+    TestParallelDumpAndTest();
+    TestIndexedSearch();
+    TestProfile();
+    TestDiff();
+    TestCallGraph();
+    TestStripUnused();
+    TestStripUnusedWithStandard();
+    TestNativeCallsWithStandard();
+    TestVersionWithStandard();
+    TestServer();
     TestDecompileProc();
     
     std::cout << "\n========================================" << std::endl;
@@ -1,7 +1,14 @@
 #include <iostream>
 #include <cassert>
 #include <memory>
+#include <cstdio>
+#include <filesystem>
 #include "../include/DMMParser.h"
+#include "../include/DMMScanner.h"
+#include "../include/MapCache.h"
+#include "../include/MapStats.h"
+#include "../include/TokenSerialization.h"
+#include "../include/DMObjectTree.h"
 #include "../include/DMLexer.h"
 #include "../include/DMCompiler.h"
 
@@ -106,11 +113,222 @@ void TestParseMapBlock() {
         EXPECT_EQ(block->X, 1);
         EXPECT_EQ(block->Y, 1);
         EXPECT_EQ(block->Z, 1);
+        ASSERT_NE(block->Cells.empty(), true);
+        EXPECT_EQ(map->CellKeys[block->Cells[0]], "a");
     }
     
     std::cout << "TestParseMapBlock passed!" << std::endl;
 }
 
+// Test that every kind of var override value is stepped over
+void TestParseVarOverrides() {
+    std::string dmmContent =
+        "\"a\" = (/turf/floor{name = \"floor\"; icon = 'floor.dmi'; dir = 4; density = null; step_x = 1.5},\n"
+        "/obj/thing{target = /obj/other; desc = \"a [1 + 2]\"; layer = -1})\n"
+        "\"b\" = (/turf/floor)\n"
+        "(1,1,1) = {\"\nab\n\"}";
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::DMLexer dmLexer("test.dmm", dmmContent);
+    DMCompiler::DMMParser parser(&compiler, &dmLexer, 0);
+    
+    auto map = parser.ParseMap();
+    
+    ASSERT_NE(map.get(), nullptr);
+    EXPECT_EQ(map->CellKeys.size(), static_cast<size_t>(2));
+    ASSERT_NE(map->CellDefinitions.size(), static_cast<size_t>(0));
+    ASSERT_NE(map->CellDefinitions[0].get(), nullptr);
+    EXPECT_EQ(map->CellDefinitions[0]->Name, "a");
+    ASSERT_NE(map->Blocks.size(), static_cast<size_t>(0));
+    EXPECT_EQ(map->Blocks[0]->Cells.size(), static_cast<size_t>(2));
+    
+    std::cout << "TestParseVarOverrides passed!" << std::endl;
+}
+
+// Test that the scanner reads both map layouts the way the parser does
+void TestScannerMatchesParser() {
+    std::string dmmContent =
+        "//MAP CONVERTED BY dmm2tgm.py\n"
+        "\"aa\" = (\n/obj/thing{\n\tname = \"x\";\n\tdir = 4\n\t},\n/obj/missing,\n/turf/floor,\n/area/space)\n"
+        "\"ab\" = (/obj/thing,/turf/floor{icon_state = 'a.dmi'},/area/space)\n"
+        "\"ac\" = (/obj/thing)\n"
+        "\n"
+        "(1,1,1) = {\"\naaab\nacaa\n\"}\n"
+        "(3, 1, 1) = {\"\n  ab\nac\n\"}\n";
+    
+    DMCompiler::DMCompiler compiler;
+    for (const char* path : {"/turf/floor", "/area/space", "/obj/thing"}) {
+        compiler.GetObjectTree()->GetOrCreateDMObject(DMCompiler::DreamPath(path));
+    }
+    
+    DMCompiler::DMLexer dmLexer("test.dmm", dmmContent);
+    DMCompiler::DMMParser parser(&compiler, &dmLexer, 1);
+    auto parsed = parser.ParseMap();
+    DMCompiler::DMMScanner scanner(&compiler, "test.dmm", dmmContent, 1);
+    auto scanned = scanner.ScanMap();
+    
+    ASSERT_NE(parsed.get(), nullptr);
+    ASSERT_NE(scanned.get(), nullptr);
+    EXPECT_EQ(scanned->MaxX, parsed->MaxX);
+    EXPECT_EQ(scanned->MaxY, parsed->MaxY);
+    EXPECT_EQ(scanned->MaxZ, parsed->MaxZ);
+    EXPECT_EQ(scanned->CellKeys == parsed->CellKeys, true);
+    EXPECT_EQ(scanned->CellDefinitions.size(), parsed->CellDefinitions.size());
+    for (size_t id = 0; id < parsed->CellDefinitions.size() && id < scanned->CellDefinitions.size(); ++id) {
+        const auto& cell = parsed->CellDefinitions[id];
+        const auto& scannedCell = scanned->CellDefinitions[id];
+        ASSERT_NE(cell.get(), nullptr);
+        ASSERT_NE(scannedCell.get(), nullptr);
+        EXPECT_EQ(scannedCell->Name, cell->Name);
+        EXPECT_EQ(scannedCell->Turf ? scannedCell->Turf->Type : -1, cell->Turf ? cell->Turf->Type : -1);
+        EXPECT_EQ(scannedCell->Area ? scannedCell->Area->Type : -1, cell->Area ? cell->Area->Type : -1);
+        EXPECT_EQ(scannedCell->Objects.size(), cell->Objects.size());
+        EXPECT_EQ(scannedCell->SkippedOverrides, cell->SkippedOverrides);
+    }
+    EXPECT_EQ(scanned->CellDefinitions[0]->SkippedOverrides, static_cast<uint32_t>(2));
+    EXPECT_EQ(scanned->Blocks.size(), parsed->Blocks.size());
+    for (size_t i = 0; i < parsed->Blocks.size() && i < scanned->Blocks.size(); ++i) {
+        EXPECT_EQ(scanned->Blocks[i]->X, parsed->Blocks[i]->X);
+        EXPECT_EQ(scanned->Blocks[i]->Z, parsed->Blocks[i]->Z);
+        EXPECT_EQ(scanned->Blocks[i]->Width, parsed->Blocks[i]->Width);
+        EXPECT_EQ(scanned->Blocks[i]->Height, parsed->Blocks[i]->Height);
+        EXPECT_EQ(scanned->Blocks[i]->Cells == parsed->Blocks[i]->Cells, true);
+    }
+    
+    // Scanned from z = 0 and moved up afterwards, as ConvertMaps() does
+    DMCompiler::DMMScanner unoffsetScanner(&compiler, "test.dmm", dmmContent, 0);
+    auto unoffset = unoffsetScanner.ScanMap();
+    ASSERT_NE(unoffset.get(), nullptr);
+    unoffset->OffsetZ(1);
+    EXPECT_EQ(unoffset->MaxZ, parsed->MaxZ);
+    for (size_t i = 0; i < parsed->Blocks.size() && i < unoffset->Blocks.size(); ++i) {
+        EXPECT_EQ(unoffset->Blocks[i]->Z, parsed->Blocks[i]->Z);
+    }
+    
+    std::cout << "TestScannerMatchesParser passed!" << std::endl;
+}
+
+// Test that the scanner leaves what it does not handle to the parser
+void TestScannerFallsBack() {
+    DMCompiler::DMCompiler compiler;
+    const char* exotic[] = {
+        "\"a\" = (/turf/floor{name = \"say \\\"hi\\\"\"})",   // Escaped text
+        "\"a\" = (/turf/floor{desc = \"[name]\"})",               // Embedded expression
+        "\"a\" = (/turf/floor)\n\"bb\" = (/turf/floor)",           // Key length changes
+        "\"aa\" = (/turf/floor)\n(1,1,1) = {\"\naaaa\naaa\n\"}",  // Ragged row
+        "(1,1,1) = {\"a\"}",                                      // Grid before any key
+        "\"a\" = (/turf/floor)\n(1.5,1,1) = {\"a\"}",             // Non-integer coordinate
+    };
+    for (const char* dmmContent : exotic) {
+        DMCompiler::DMMScanner scanner(&compiler, "test.dmm", dmmContent, 0);
+        EXPECT_EQ(scanner.ScanMap() == nullptr, true);
+    }
+    
+    std::cout << "TestScannerFallsBack passed!" << std::endl;
+}
+
+// Test that a cached map loads as scanned until a type it names changes
+void TestMapCacheRoundTrip() {
+    const std::string dir = "test_map_cache";
+    std::string dmmContent =
+        "\"aa\" = (/obj/thing{dir = 4},/obj/missing,/turf/floor,/area/space)\n"
+        "\"ab\" = (/turf/floor,/area/space)\n"
+        "(1,1,1) = {\"\naaab\nabab\n\"}\n";
+    
+    DMCompiler::DMCompiler compiler;
+    for (const char* path : {"/turf/floor", "/area/space", "/obj/thing"}) {
+        compiler.GetObjectTree()->GetOrCreateDMObject(DMCompiler::DreamPath(path));
+    }
+    DMCompiler::DMObjectTree& tree = *compiler.GetObjectTree();
+    
+    DMCompiler::DMMScanner scanner(&compiler, "cached.dmm", dmmContent, 0);
+    auto scanned = scanner.ScanMap();
+    ASSERT_NE(scanned.get(), nullptr);
+    
+    DMCompiler::MapCache cache(dir);
+    uint64_t hash = DMCompiler::MapCache::HashMap("cached.dmm", dmmContent);
+    std::vector<std::string> warnings;
+    EXPECT_EQ(cache.Load(hash, tree, warnings) == nullptr, true);
+    cache.Store(hash, *scanned, scanner.GetReferencedTypes(), scanner.GetWarnings(), tree);
+    
+    auto loaded = cache.Load(hash, tree, warnings);
+    ASSERT_NE(loaded.get(), nullptr);
+    EXPECT_EQ(warnings == scanner.GetWarnings(), true);
+    EXPECT_EQ(loaded->MaxX, scanned->MaxX);
+    EXPECT_EQ(loaded->MaxY, scanned->MaxY);
+    EXPECT_EQ(loaded->CellKeys == scanned->CellKeys, true);
+    for (size_t id = 0; id < scanned->CellDefinitions.size() && id < loaded->CellDefinitions.size(); ++id) {
+        const auto& cell = scanned->CellDefinitions[id];
+        const auto& loadedCell = loaded->CellDefinitions[id];
+        ASSERT_NE(loadedCell.get(), nullptr);
+        EXPECT_EQ(loadedCell->Turf ? loadedCell->Turf->Type : -1, cell->Turf ? cell->Turf->Type : -1);
+        EXPECT_EQ(loadedCell->Area ? loadedCell->Area->Type : -1, cell->Area ? cell->Area->Type : -1);
+        EXPECT_EQ(loadedCell->Objects.size(), cell->Objects.size());
+        EXPECT_EQ(loadedCell->SkippedOverrides, cell->SkippedOverrides);
+    }
+    ASSERT_NE(loaded->Blocks.size(), static_cast<size_t>(0));
+    EXPECT_EQ(loaded->Blocks[0]->Cells == scanned->Blocks[0]->Cells, true);
+    
+    // A damaged entry misses even where it would decode: here the last
+    // cell's key ID, before the checksum, swapped between "aa" and "ab"
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.map", static_cast<unsigned long long>(hash));
+    const std::string entryPath = (std::filesystem::path(dir) / name).string();
+    std::string data;
+    ASSERT_NE(DMCompiler::ReadBinaryFile(entryPath, data), false);
+    data[data.size() - sizeof(uint64_t) - sizeof(uint32_t)] ^= 0x01;
+    ASSERT_NE(DMCompiler::WriteBinaryFileAtomic(entryPath, data), false);
+    EXPECT_EQ(cache.Load(hash, tree, warnings) == nullptr, true);
+    cache.Store(hash, *scanned, scanner.GetReferencedTypes(), scanner.GetWarnings(), tree);
+    EXPECT_EQ(cache.Load(hash, tree, warnings) != nullptr, true);
+    
+    // A type the map names now exists, so the entry is stale
+    compiler.GetObjectTree()->GetOrCreateDMObject(DMCompiler::DreamPath("/obj/missing"));
+    EXPECT_EQ(cache.Load(hash, tree, warnings) == nullptr, true);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "TestMapCacheRoundTrip passed!" << std::endl;
+}
+
+// Test the per-map figures --map-stats reports
+void TestMapStats() {
+    std::string dmmContent =
+        "\"aa\" = (/obj/thing{name = \"a\"; dir = 4},/obj/thing,/turf/floor,/area/space)\n"
+        "\"ab\" = (/turf/floor,/area/space)\n"
+        "\"ac\" = (/turf/floor{dir = 1},/area/space)\n"
+        "(1,1,1) = {\"\naaab\nacad\n\"}\n";
+    
+    DMCompiler::DMCompiler compiler;
+    for (const char* path : {"/turf/floor", "/area/space", "/obj/thing"}) {
+        compiler.GetObjectTree()->GetOrCreateDMObject(DMCompiler::DreamPath(path));
+    }
+    DMCompiler::DMMScanner scanner(&compiler, "stats.dmm", dmmContent, 0);
+    auto map = scanner.ScanMap();
+    ASSERT_NE(map.get(), nullptr);
+    
+    DMCompiler::MapStats stats;
+    stats.Add("stats.dmm", *map);
+    ASSERT_NE(stats.Maps.size(), static_cast<size_t>(0));
+    const DMCompiler::MapStats::Map& figures = stats.Maps[0];
+    EXPECT_EQ(figures.Tiles, static_cast<uint64_t>(4));
+    EXPECT_EQ(figures.Keys, static_cast<uint64_t>(4));  // "ad" is only used
+    EXPECT_EQ(figures.DefinedKeys, static_cast<uint64_t>(3));
+    EXPECT_EQ(figures.DistinctCells, static_cast<uint64_t>(2));  // "ab" and "ac" differ only in overrides
+    EXPECT_EQ(figures.UndefinedTiles, static_cast<uint64_t>(1));
+    EXPECT_EQ(figures.Objects, static_cast<uint64_t>(2));
+    EXPECT_EQ(figures.ObjectsPerTile[0], static_cast<uint64_t>(3));
+    EXPECT_EQ(figures.ObjectsPerTile[2], static_cast<uint64_t>(1));
+    EXPECT_EQ(figures.Overrides, static_cast<uint64_t>(3));
+    EXPECT_EQ(figures.KeyOverrides, static_cast<uint64_t>(3));
+    
+    DMCompiler::DMObject* floor = nullptr;
+    compiler.GetObjectTree()->TryGetDMObject(DMCompiler::DreamPath("/turf/floor"), &floor);
+    ASSERT_NE(floor, nullptr);
+    EXPECT_EQ(figures.TypeTiles.at(floor->Id), static_cast<uint64_t>(3));
+    
+    std::cout << "TestMapStats passed!" << std::endl;
+}
+
 int RunDMMParserTests() {
     std::cout << "\n=== Running DMMParser Tests ===" << std::endl;
     
@@ -118,6 +336,11 @@ int RunDMMParserTests() {
     TestParseCellDefinition();
     TestParseMapWithCellOnly();
     TestParseMapBlock();
+    TestParseVarOverrides();
+    TestScannerMatchesParser();
+    TestScannerFallsBack();
+    TestMapCacheRoundTrip();
+    TestMapStats();
     
     std::cout << "\nDMMParser Tests: " << dmmparser_tests_passed << "/" << dmmparser_tests_run << " assertions passed" << std::endl;
     
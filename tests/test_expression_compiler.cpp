@@ -1,5 +1,6 @@
 #include <iostream>
 #include <cassert>
+#include <cstring>
 #include "../include/DMExpressionCompiler.h"
 #include "../include/BytecodeWriter.h"
 #include "../include/DMASTExpression.h"
@@ -141,6 +142,61 @@ bool TestCompileLocalVariable() {
     return true;
 }
 
+// Test: Const locals fold into the expressions that read them
+bool TestCompileConstLocalFolds() {
+    std::cout << "  TestCompileConstLocalFolds... ";
+    
+    DMCompiler::BytecodeWriter writer;
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::DMObject testObj(0, DMCompiler::DreamPath("/test"));
+    DMCompiler::DMProc proc(0, "test_proc", &testObj, false, DMCompiler::Location());
+    
+    // var/const/step = 2, plus an ordinary local
+    proc.AddLocalConst("step", std::nullopt, DMCompiler::Constant(static_cast<int64_t>(2)));
+    proc.AddLocalVariable("myvar");
+    
+    DMCompiler::DMExpressionCompiler exprCompiler(&compiler, &proc, &writer);
+    
+    // Create AST: step * 3
+    auto folded = std::make_unique<DMCompiler::DMASTExpressionBinary>(
+        DMCompiler::Location(),
+        DMCompiler::BinaryOperator::Multiply,
+        std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "step"),
+        std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 3)
+    );
+    bool success = exprCompiler.CompileExpression(folded.get());
+    assert(success && "Should successfully compile const multiplication");
+    
+    // Should be: PushFloat 6.0 = 5 bytes, with no local read or Multiply
+    const auto& bytecode = writer.GetBytecode();
+    assert(bytecode.size() == 5 && "Const expression should fold to one push");
+    assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushFloat));
+    float value;
+    std::memcpy(&value, &bytecode[1], sizeof(value));
+    assert(value == 6.0f && "step * 3 should fold to 6");
+    
+    // Create AST: myvar + step (only the const side becomes a literal)
+    DMCompiler::BytecodeWriter mixedWriter;
+    DMCompiler::DMExpressionCompiler mixedCompiler(&compiler, &proc, &mixedWriter);
+    auto mixed = std::make_unique<DMCompiler::DMASTExpressionBinary>(
+        DMCompiler::Location(),
+        DMCompiler::BinaryOperator::Add,
+        std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "myvar"),
+        std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "step")
+    );
+    success = mixedCompiler.CompileExpression(mixed.get());
+    assert(success && "Should successfully compile mixed addition");
+    
+    // Should be: PushReferenceValue (3) + PushFloat (5) + Add (1) = 9 bytes
+    const auto& mixedBytecode = mixedWriter.GetBytecode();
+    assert(mixedBytecode.size() == 9 && "Mixed addition should emit 9 bytes");
+    assert(mixedBytecode[3] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushFloat));
+    assert(mixedBytecode[8] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::Add));
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 // Test: Compile parameter reference
 bool TestCompileParameter() {
     std::cout << "  TestCompileParameter... ";
@@ -969,6 +1025,49 @@ bool TestCompileGlobalProcCallMultipleArgs() {
     return true;
 }
 
+// Test compiling global.proc(): a direct call by ID, not a lookup of "global" on src
+bool TestCompileGlobalDereferenceCall() {
+    std::cout << "  TestCompileGlobalDereferenceCall... ";
+    
+    DMCompiler::BytecodeWriter writer;
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::DMObject testObj(0, DMCompiler::DreamPath("/test"));
+    DMCompiler::DMProc proc(0, "test_proc", &testObj, false, DMCompiler::Location());
+    DMCompiler::DMExpressionCompiler exprCompiler(&compiler, &proc, &writer);
+    
+    auto* helperProc = compiler.GetObjectTree()->CreateProc("helper", nullptr, false, DMCompiler::Location());
+    int helperId = helperProc->Id;
+    compiler.GetObjectTree()->RegisterGlobalProc("helper", helperId);
+    
+    // Create AST: global.helper(1)
+    auto target = std::make_unique<DMCompiler::DMASTDereference>(
+        DMCompiler::Location(),
+        std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "global"),
+        DMCompiler::DereferenceType::Direct,
+        std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "helper"));
+    std::vector<std::unique_ptr<DMCompiler::DMASTCallParameter>> params;
+    params.push_back(std::make_unique<DMCompiler::DMASTCallParameter>(
+        DMCompiler::Location(), std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 1), nullptr));
+    auto expr = std::make_unique<DMCompiler::DMASTCall>(
+        DMCompiler::Location(), std::move(target), std::move(params));
+    
+    bool success = exprCompiler.CompileExpression(expr.get());
+    assert(success && "Should successfully compile global.helper(1)");
+    
+    const auto& bytecode = writer.GetBytecode();
+    
+    // Expected: PushFloat 1 (5) + Call (1) + GlobalProc ref (5) + args_type (1) + arg_count (4)
+    assert(bytecode.size() == 16 && "global.helper(1) should emit 16 bytes");
+    assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushFloat));
+    assert(bytecode[5] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::Call));
+    assert(bytecode[6] == 11 && "Should have GlobalProc type (11)");
+    assert(bytecode[7] == (helperId & 0xFF));
+    assert(bytecode[8] == ((helperId >> 8) & 0xFF));
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 // Test compiling global proc call with no args: world.tick_lag()
 bool TestCompileGlobalProcCallNoArgs() {
     std::cout << "  TestCompileGlobalProcCallNoArgs... ";
@@ -2049,21 +2148,23 @@ bool TestCompileNewPathNoArgs() {
     // - Type ID (4 bytes: int32)
     // - CreateObject opcode (1 byte: 0x2E)
     // - Argument type (1 byte: None = 0)
-    // - Argument count (1 byte: 0)
-    // Total: 8 bytes
-    if (bytecode.size() != 8) {
-        std::cout << "FAILED: Expected 8 bytes, got " << bytecode.size() << std::endl;
+    // - Argument count (4 bytes: int32 0)
+    // Total: 11 bytes
+    if (bytecode.size() != 11) {
+        std::cout << "FAILED: Expected 11 bytes, got " << bytecode.size() << std::endl;
         std::cout << "Bytecode: ";
         for (auto b : bytecode) {
             printf("%02X ", b);
         }
         std::cout << std::endl;
     }
-    assert(bytecode.size() == 8 && "New expression with no args should emit 8 bytes");
+    assert(bytecode.size() == 11 && "New expression with no args should emit 11 bytes");
     assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushType));
     assert(bytecode[5] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::CreateObject));
     assert(bytecode[6] == static_cast<uint8_t>(DMCompiler::DMCallArgumentsType::None));
-    assert(bytecode[7] == 0); // 0 arguments
+    for (size_t i = 7; i < 11; i++) {
+        assert(bytecode[i] == 0); // 0 arguments
+    }
     
     std::cout << "PASSED" << std::endl;
     return true;
@@ -2122,19 +2223,19 @@ bool TestCompileNewPathWithArgs() {
     // - PushType (3 bytes: opcode + type ID)
     // - PushString "Alice" (variable size, but we know string ID is small)
     // - PushFloat 25.0 (5 bytes)
-    // - CreateObject (3 bytes: opcode + arg type + count)
+    // - CreateObject (6 bytes: opcode + arg type + int32 count)
     // Let's just verify the key opcodes are present
     assert(bytecode.size() > 10 && "New expression with args should emit multiple bytes");
     assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushType));
     
     // Find CreateObject opcode (should be near the end)
     bool foundCreateObject = false;
-    for (size_t i = 0; i < bytecode.size() - 2; i++) {
+    for (size_t i = 0; i + 6 <= bytecode.size(); i++) {
         if (bytecode[i] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::CreateObject)) {
             foundCreateObject = true;
             // Check argument type and count
             assert(bytecode[i + 1] == static_cast<uint8_t>(DMCompiler::DMCallArgumentsType::FromStack));
-            assert(bytecode[i + 2] == 2); // 2 arguments
+            assert(bytecode[i + 2] == 2 && bytecode[i + 3] == 0 && bytecode[i + 4] == 0 && bytecode[i + 5] == 0); // 2 arguments
             break;
         }
     }
@@ -2177,7 +2278,7 @@ bool TestCompileNewPathSimple() {
     const auto& bytecode = writer.GetBytecode();
     
     // Same as TestCompileNewPathNoArgs
-    assert(bytecode.size() == 8 && "Simple new expression should emit 8 bytes");
+    assert(bytecode.size() == 11 && "Simple new expression should emit 11 bytes");
     assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushType));
     assert(bytecode[5] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::CreateObject));
     
@@ -2694,7 +2795,7 @@ bool TestCompileListIndexAssignment() {
     // 1. PushString "value"
     // 2. PushReferenceValue for 'list'
     // 3. PushReferenceValue for 'index'
-    // 4. Assign opcode with Index reference (type 13)
+    // 4. Assign opcode with a ListIndex reference
     
     bool foundPushString = false;
     bool foundAssign = false;
@@ -2705,9 +2806,10 @@ bool TestCompileListIndexAssignment() {
         }
         if (bytecode[i] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::Assign)) {
             foundAssign = true;
-            // Check that the reference type is Index (13)
+            // Check that the reference type is ListIndex
             if (i + 1 < bytecode.size()) {
-                assert(bytecode[i + 1] == 13 && "Reference type should be Index (13)");
+                assert(bytecode[i + 1] == static_cast<uint8_t>(DMCompiler::DMReference::Type::ListIndex) &&
+                       "Reference type should be ListIndex");
             }
         }
     }
@@ -3568,6 +3670,7 @@ int RunExpressionCompilerTests() {
         if (!TestCompileAddition()) failures++;
         if (!TestCompileUnaryNegation()) failures++;
         if (!TestCompileLocalVariable()) failures++;
+        if (!TestCompileConstLocalFolds()) failures++;
         if (!TestCompileParameter()) failures++;
         if (!TestCompileSpecialIdentifierSrc()) failures++;
         if (!TestCompileExpressionWithVariable()) failures++;
@@ -3583,6 +3686,7 @@ int RunExpressionCompilerTests() {
         if (!TestCompileNestedMethodCalls()) failures++;
         if (!TestCompileGlobalProcCallSimple()) failures++;
         if (!TestCompileGlobalProcCallMultipleArgs()) failures++;
+        if (!TestCompileGlobalDereferenceCall()) failures++;
         if (!TestCompileGlobalProcCallNoArgs()) failures++;
         if (!TestCompileGlobalProcInExpression()) failures++;
         if (!TestCompileEmptyList()) failures++;
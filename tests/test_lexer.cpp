@@ -1,5 +1,15 @@
 #include "../include/DMLexer.h"
+#include "../include/SourceBuffer.h"
+#include "../include/TokenBuffer.h"
+#include "../include/TokenCache.h"
+#include "../include/DMStandardSnapshot.h"
+#include "../include/PreprocessedOutput.h"
+#include "../include/TokenSerialization.h"
+#include <filesystem>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
 #include <cassert>
 
 using namespace DMCompiler;
@@ -277,6 +287,281 @@ void TestNewTokensInContext() {
     std::cout << "TestNewTokensInContext passed!" << std::endl;
 }
 
+void TestMappedSourceBuffer() {
+    // Write a file with CRLF line endings and lex it straight from the mapping
+    const std::string path = "test_mapped_source.dm";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "var x = 1\r\nvar y = 2\r\n";
+    }
+    
+    auto buffer = SourceBuffer::FromFile(path);
+    assert(buffer != nullptr);
+    assert(buffer->Size() == 22);
+    assert(buffer->View().substr(0, 3) == "var");
+    
+    DMLexer lexer(path, buffer);
+    assert(lexer.GetNextToken().Type == TokenType::Var);
+    assert(lexer.GetNextToken().Text == "x");
+    assert(lexer.GetNextToken().Type == TokenType::Assign);
+    assert(lexer.GetNextToken().Type == TokenType::Number);
+    
+    // "\r\n" is a single newline; the next line starts at line 2
+    Token newline = lexer.GetNextToken();
+    assert(newline.Type == TokenType::Newline);
+    Token var2 = lexer.GetNextToken();
+    assert(var2.Type == TokenType::Var);
+    assert(var2.Loc.Line == 2);
+    
+    // Missing files yield no buffer
+    assert(SourceBuffer::FromFile("does_not_exist.dm") == nullptr);
+    
+    buffer.reset();
+    std::remove(path.c_str());
+    
+    std::cout << "TestMappedSourceBuffer passed!" << std::endl;
+}
+
+void TestTokenBufferRoundTrip() {
+    DMLexer lexer("round_trip.dm", "var/x = 1.5\nvar/y = \"hi\"\nx = 0x10");
+    std::vector<Token> tokens;
+    for (Token token = lexer.GetNextToken(); token.Type != TokenType::EndOfFile; token = lexer.GetNextToken()) {
+        tokens.push_back(token);
+    }
+    
+    TokenBuffer buffer;
+    buffer.Append(tokens);
+    assert(buffer.size() == tokens.size());
+    
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        Token restored = buffer.Get(i);
+        assert(restored.Type == tokens[i].Type);
+        assert(restored.Text == tokens[i].Text);
+        assert(buffer.TextAt(i) == tokens[i].Text);
+        assert(restored.Loc.FileId == tokens[i].Loc.FileId);
+        assert(restored.Loc.SourceFile() == "round_trip.dm");
+        assert(restored.Loc.Line == tokens[i].Loc.Line);
+        assert(restored.Loc.Column == tokens[i].Loc.Column);
+        assert(restored.Value.ValueType == tokens[i].Value.ValueType);
+        assert(restored.Value.StringValue == tokens[i].Value.StringValue);
+        if (tokens[i].Value.ValueType == Token::TokenValue::Type::Int) {
+            assert(restored.Value.IntValue == tokens[i].Value.IntValue);
+        } else if (tokens[i].Value.ValueType == Token::TokenValue::Type::Float) {
+            assert(restored.Value.FloatValue == tokens[i].Value.FloatValue);
+        }
+    }
+    
+    // Repeated text is stored once
+    StringInterner interner;
+    assert(interner.Intern("var") == interner.Intern(std::string("var")));
+    assert(interner.Intern("") == StringInterner::EmptyId);
+    assert(interner.Get(interner.Intern("x")) == "x");
+    
+    // Paths are registered once and shared by index
+    Location a("round_trip.dm", 1, 1);
+    Location b("round_trip.dm", 7, 3);
+    assert(a.FileId == b.FileId);
+    assert(Location::Internal.IsInternal());
+    assert(!a.IsInternal());
+    assert(Location("internal", 0, 0).IsInternal());
+    assert(b.ToString() == "round_trip.dm:7:3");
+    
+    std::cout << "TestTokenBufferRoundTrip passed!" << std::endl;
+}
+
+void TestTokenCacheRoundTrip() {
+    const std::string dir = "test_token_cache";
+    const std::string source = "var/x = 1.5\nvar/y = \"hi\"\n\tx = 0x10 // note\n";
+    
+    DMLexer lexer("cached.dm", source, true);
+    std::vector<Token> tokens;
+    do {
+        tokens.push_back(lexer.GetNextToken());
+    } while (tokens.back().Type != TokenType::EndOfFile);
+    
+    TokenCache cache(dir);
+    assert(cache.Load("cached.dm", source) == nullptr);
+    cache.Store(source, tokens);
+    
+    // Entries are keyed by content, and the caller's path is attached on load
+    auto loaded = cache.Load("renamed.dm", source);
+    assert(loaded != nullptr);
+    assert(loaded->size() == tokens.size());
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        const Token& restored = (*loaded)[i];
+        assert(restored.Type == tokens[i].Type);
+        assert(restored.Text == tokens[i].Text);
+        assert(restored.Loc.Line == tokens[i].Loc.Line);
+        assert(restored.Loc.Column == tokens[i].Loc.Column);
+        assert(restored.Loc.SourceFile() == "renamed.dm");
+        assert(restored.Value.ValueType == tokens[i].Value.ValueType);
+        assert(restored.Value.StringValue == tokens[i].Value.StringValue);
+    }
+    
+    // Different content misses
+    assert(cache.Load("cached.dm", source + " ") == nullptr);
+    
+    // So does an entry whose token count is corrupt, rather than sizing
+    // the token array by it; storing again repairs the entry
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.tok", static_cast<unsigned long long>(TokenCache::HashContent(source)));
+    const std::string entryPath = (std::filesystem::path(dir) / name).string();
+    const size_t countOffset = 4 + 4 + 4 + 8 + 8;  // Past the magic, versions, content size and hash
+    {
+        std::fstream entry(entryPath, std::ios::binary | std::ios::in | std::ios::out);
+        entry.seekp(static_cast<std::streamoff>(countOffset + 3));
+        entry.put('\x7f');
+    }
+    assert(cache.Load("cached.dm", source) == nullptr);
+    cache.Store(source, tokens);
+    assert(cache.Load("cached.dm", source) != nullptr);
+    
+    // A damaged entry that would still decode misses too: here the first
+    // token's text, past its type, flags, line, column and text length
+    {
+        std::fstream entry(entryPath, std::ios::binary | std::ios::in | std::ios::out);
+        entry.seekp(static_cast<std::streamoff>(countOffset + 4 + 2 + 1 + 4 + 4 + 4));
+        entry.put('w');
+    }
+    assert(cache.Load("cached.dm", source) == nullptr);
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "TestTokenCacheRoundTrip passed!" << std::endl;
+}
+
+void TestStandardSnapshotRoundTrip() {
+    const std::string dir = "test_standard_snapshot";
+    const std::string snapshotPath = dir + "/std.snap";
+    std::filesystem::create_directories(dir + "/lib");
+    {
+        std::ofstream out(dir + "/lib/_Standard.dm");
+        out << "/datum/var/tag\n";
+    }
+    
+    const std::unordered_map<std::string, std::string> defines = {{"DM_VERSION", "515"}, {"UNIT_TESTS", "1"}};
+    DMStandardSnapshot snapshot;
+    DMLexer lexer((std::filesystem::path(dir) / "lib/_Standard.dm").string(), "/datum/var/tag\n", false);
+    do {
+        snapshot.Tokens.push_back(lexer.GetNextToken());
+    } while (snapshot.Tokens.back().Type != TokenType::EndOfFile);
+    snapshot.Constants = {{"TRUE", 1}, {"NORTH", 1}, {"SOUTH", 2}};
+    snapshot.Pragmas = {{WarningCode::UnimplementedAccess, ErrorLevel::Disabled}};
+    snapshot.ResourceDirectories = {"icons"};
+    assert(snapshot.Save(snapshotPath, dir + "/lib", defines));
+    
+    DMStandardSnapshot loaded;
+    assert(loaded.Load(snapshotPath, dir + "/lib", defines));
+    assert(loaded.Tokens.size() == snapshot.Tokens.size());
+    for (size_t i = 0; i < loaded.Tokens.size(); ++i) {
+        assert(loaded.Tokens[i].Type == snapshot.Tokens[i].Type);
+        assert(loaded.Tokens[i].Text == snapshot.Tokens[i].Text);
+        assert(loaded.Tokens[i].Loc.SourceFile() == snapshot.Tokens[i].Loc.SourceFile());
+    }
+    assert(loaded.Constants == snapshot.Constants);
+    assert(loaded.Pragmas == snapshot.Pragmas);
+    assert(loaded.ResourceDirectories == snapshot.ResourceDirectories);
+    
+    // A damaged snapshot is rejected, and registers none of its paths even
+    // when only its end is wrong: here a renamed source and a stray byte,
+    // under a checksum that matches
+    std::string data;
+    assert(ReadBinaryFile(snapshotPath, data));
+    std::string damaged = data;
+    damaged[damaged.size() / 2] ^= 0x20;
+    assert(WriteBinaryFileAtomic(snapshotPath, damaged));
+    DMStandardSnapshot corrupt;
+    assert(!corrupt.Load(snapshotPath, dir + "/lib", defines));
+    damaged = data.substr(0, data.size() - sizeof(uint64_t));
+    damaged[damaged.rfind("_Standard.dm")] = '-';
+    damaged += 'x';
+    BinaryWriter checksum;
+    checksum.WriteBytes(damaged.data(), damaged.size());
+    checksum.WriteChecksum();
+    assert(WriteBinaryFileAtomic(snapshotPath, checksum.Data()));
+    size_t registered = SourceFileRegistry::Count();
+    assert(!corrupt.Load(snapshotPath, dir + "/lib", defines));
+    assert(corrupt.Tokens.empty());
+    assert(SourceFileRegistry::Count() == registered);
+    assert(snapshot.Save(snapshotPath, dir + "/lib", defines));
+    assert(corrupt.Load(snapshotPath, dir + "/lib", defines));
+    
+    // So does building under other defines, such as another --version
+    DMStandardSnapshot otherVersion;
+    assert(!otherVersion.Load(snapshotPath, dir + "/lib", {{"DM_VERSION", "514"}, {"UNIT_TESTS", "1"}}));
+    assert(!otherVersion.Load(snapshotPath, dir + "/lib", {{"DM_VERSION", "515"}}));
+    assert(otherVersion.Load(snapshotPath, dir + "/lib", {{"UNIT_TESTS", "1"}, {"DM_VERSION", "515"}}));
+    assert(DMStandardSnapshot::StampSources(dir + "/lib", defines) == otherVersion.SourcesStamp);
+    assert(DMStandardSnapshot::StampSources(dir + "/lib", {}) != otherVersion.SourcesStamp);
+    
+    // Editing the library invalidates the snapshot
+    {
+        std::ofstream out(dir + "/lib/_Standard.dm", std::ios::app);
+        out << "/datum/var/name\n";
+    }
+    DMStandardSnapshot stale;
+    assert(!stale.Load(snapshotPath, dir + "/lib", defines));
+    
+    std::filesystem::remove_all(dir);
+    std::cout << "TestStandardSnapshotRoundTrip passed!" << std::endl;
+}
+
+void TestPreprocessedOutputRoundTrip() {
+    const std::string path = "test_preprocessed_output.dmpp";
+    
+    PreprocessedOutput output;
+    DMLexer lexer("pp_roundtrip.dm", "/obj/var/x = 1\n/obj/proc/f()\n\treturn \"a[x]b\"\n", false);
+    do {
+        output.Tokens.push_back(lexer.GetNextToken());
+    } while (output.Tokens.back().Type != TokenType::EndOfFile);
+    output.StandardConstants = {{"TRUE", 1}, {"WEST", 8}};
+    output.Pragmas = {{WarningCode::UnimplementedAccess, ErrorLevel::Disabled}};
+    output.ResourceDirectories = {"/game/icons"};
+    output.IncludedMaps = {"/game/maps/station.dmm"};
+    output.IncludedInterface = "/game/interface/skin.dmf";
+    assert(output.Save(path));
+    
+    PreprocessedOutput loaded;
+    assert(loaded.Load(path));
+    assert(loaded.Tokens.size() == output.Tokens.size());
+    for (size_t i = 0; i < loaded.Tokens.size(); ++i) {
+        assert(loaded.Tokens[i].Type == output.Tokens[i].Type);
+        assert(loaded.Tokens[i].Text == output.Tokens[i].Text);
+        assert(loaded.Tokens[i].Loc.Line == output.Tokens[i].Loc.Line);
+        assert(loaded.Tokens[i].Loc.Column == output.Tokens[i].Loc.Column);
+        assert(loaded.Tokens[i].Loc.SourceFile() == output.Tokens[i].Loc.SourceFile());
+    }
+    assert(loaded.StandardConstants == output.StandardConstants);
+    assert(loaded.Pragmas == output.Pragmas);
+    assert(loaded.ResourceDirectories == output.ResourceDirectories);
+    assert(loaded.IncludedMaps == output.IncludedMaps);
+    assert(loaded.IncludedInterface == output.IncludedInterface);
+    
+    // So is one whose token count is corrupt, without sizing anything by it.
+    // The count follows the file table, which names one source
+    std::string data;
+    assert(ReadBinaryFile(path, data));
+    std::string source = loaded.Tokens[0].Loc.SourceFile();
+    size_t countOffset = data.rfind(source) + source.size();
+    uint32_t count = 0;
+    std::memcpy(&count, data.data() + countOffset, sizeof(count));
+    assert(count == output.Tokens.size());
+    data[countOffset + 3] = '\x7f';
+    assert(WriteBinaryFileAtomic(path, data));
+    PreprocessedOutput corrupt;
+    assert(!corrupt.Load(path));
+    assert(corrupt.Tokens.empty());
+    assert(output.Save(path));
+    
+    // A truncated file is rejected rather than half-loaded
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 3);
+    PreprocessedOutput truncated;
+    assert(!truncated.Load(path));
+    assert(truncated.Tokens.empty());
+    
+    std::filesystem::remove(path);
+    std::cout << "TestPreprocessedOutputRoundTrip passed!" << std::endl;
+}
+
 int RunLexerTests() {
     std::cout << "\n=== Running Lexer Tests ===" << std::endl;
     
@@ -291,6 +576,11 @@ int RunLexerTests() {
         TestTildeOperators();
         TestNullConditionalOperators();
         TestNewTokensInContext();
+        TestMappedSourceBuffer();
+        TestTokenBufferRoundTrip();
+        TestTokenCacheRoundTrip();
+        TestStandardSnapshotRoundTrip();
+        TestPreprocessedOutputRoundTrip();
         
         std::cout << "\nAll lexer tests passed!" << std::endl;
         return 0;
@@ -3,10 +3,12 @@
 
 #include "../include/DMLexer.h"
 #include "../include/Token.h"
+#include "../include/SourceScan.h"
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cassert>
+#include <chrono>
 
 using namespace DMCompiler;
 
@@ -80,6 +82,141 @@ TEST(TestRightShift) {
     EXPECT_EQ(tokens[1].Type, TokenType::RightShift);
 }
 
+TEST(TestOperatorTable) {
+    // Every operator is recognized by longest match when surrounded by operands
+    const std::vector<std::pair<std::string, TokenType>> operators = {
+        {"||=", TokenType::OrOrAssign}, {"&&=", TokenType::AndAndAssign},
+        {"%%=", TokenType::ModuloModuloAssign}, {"...", TokenType::DotDotDot},
+        {"==", TokenType::Equals}, {"!=", TokenType::NotEquals},
+        {"<<", TokenType::LeftShift}, {"**", TokenType::Power},
+        {"::", TokenType::DoubleColon}, {":=", TokenType::AssignInto},
+        {"?:", TokenType::QuestionColon}, {"..", TokenType::DotDot},
+        {"%", TokenType::Modulo}, {"~", TokenType::BitwiseNot}
+    };
+    for (const auto& [text, type] : operators) {
+        auto tokens = Tokenize("a" + text + "b");
+        EXPECT_EQ(tokens.size(), 3);
+        EXPECT_EQ(tokens[1].Type, type);
+    }
+    
+    // "%%" is only a prefix of "%%=", so it lexes as two operators
+    auto tokens = Tokenize("a %% b");
+    EXPECT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[1].Type, TokenType::Modulo);
+    
+    // Characters outside the table are unknown tokens
+    tokens = Tokenize("a @ b");
+    EXPECT_EQ(tokens.size(), 3);
+    EXPECT_EQ(tokens[1].Type, TokenType::Unknown);
+}
+
+TEST(TestKeywordTable) {
+    auto tokens = Tokenize("var proc continue default in as throw");
+    EXPECT_EQ(tokens.size(), 7);
+    EXPECT_EQ(tokens[0].Type, TokenType::Var);
+    EXPECT_EQ(tokens[2].Type, TokenType::Continue);
+    EXPECT_EQ(tokens[3].Type, TokenType::Default);
+    EXPECT_EQ(tokens[5].Type, TokenType::As);
+    EXPECT_EQ(tokens[6].Type, TokenType::Throw);
+    
+    // Near misses stay identifiers
+    tokens = Tokenize("vars i iff Proc continues");
+    EXPECT_EQ(tokens.size(), 5);
+    for (const auto& token : tokens) {
+        EXPECT_EQ(token.Type, TokenType::Identifier);
+    }
+}
+
+TEST(TestSourceScan) {
+    // Every match position around the vector block sizes, from several start offsets
+    const ByteSet set = {'"', '\\', '['};
+    int mismatches = 0;
+    for (size_t length = 0; length < 80; ++length) {
+        for (size_t match = 0; match <= length; ++match) {
+            std::string text(length, 'x');
+            std::string spaces(length, ' ');
+            if (match < length) {
+                text[match] = '[';
+                spaces[match] = 'x';
+            }
+            for (size_t begin = 0; begin <= match; begin += 7) {
+                if (SourceScan::FindFirstOf(text, begin, set) != match) mismatches++;
+                if (SourceScan::FindFirstNotOf(spaces, begin, ByteSet{' ', '\t'}) != match) mismatches++;
+            }
+        }
+    }
+    EXPECT_EQ(mismatches, 0);
+    
+    // Bytes with the high bit set are not confused with the set
+    std::string text = "\xE2\x80\x9C" + std::string(40, '\xA0') + "\"";
+    EXPECT_EQ(SourceScan::FindFirstOf(text, 0, set), text.size() - 1);
+}
+
+TEST(TestLongRuns) {
+    // Runs longer than a vector block keep line and column bookkeeping exact
+    std::string padding(50, ' ');
+    std::string source = "a" + padding + "b // " + std::string(40, 'c') + "\n"
+                         "/* " + std::string(40, '*') + "\n" + std::string(40, ' ') + "*/ d\n"
+                         "\"" + std::string(45, 's') + "\\n\" e\n"
+                         "{\"" + std::string(40, 'm') + "\n" + std::string(5, 'm') + "\"} f";
+    auto tokens = Tokenize(source);
+    EXPECT_EQ(tokens.size(), 10);
+    EXPECT_EQ(tokens[1].Loc.Column, 51);  // b
+    EXPECT_EQ(tokens[2].Type, TokenType::Newline);
+    EXPECT_EQ(tokens[3].Loc.Line, 3);     // d (block comment lines restart at column 1)
+    EXPECT_EQ(tokens[3].Loc.Column, 44);
+    EXPECT_EQ(tokens[5].Value.StringValue.size(), 46);
+    EXPECT_EQ(tokens[6].Loc.Column, 50);  // e
+    EXPECT_EQ(tokens[8].Value.StringValue.size(), 46);
+    EXPECT_EQ(tokens[9].Loc.Line, 6);     // f
+    EXPECT_EQ(tokens[9].Loc.Column, 9);
+    
+    DMLexer lexer("test", "a" + padding + "b", true);
+    EXPECT_EQ(lexer.GetNextToken().Type, TokenType::Identifier);
+    Token whitespace = lexer.GetNextToken();
+    EXPECT_EQ(whitespace.Type, TokenType::DM_Preproc_Whitespace);
+    EXPECT_EQ(whitespace.Text.size(), 50);
+}
+
+static void ReportThroughput(const char* name, const std::string& unit) {
+    std::string source;
+    for (int i = 0; i < 20000; ++i) {
+        source += unit;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    DMLexer lexer("benchmark", source, false);
+    size_t count = 0;
+    while (lexer.GetNextToken().Type != TokenType::EndOfFile) {
+        count++;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    std::cout << "Lexer throughput (" << name << "): " << count << " tokens, "
+              << (source.size() / (1024.0 * 1024.0)) / elapsed << " MB/s ("
+              << static_cast<int>(elapsed * 1000) << " ms)" << std::endl;
+}
+
+// Not a pass/fail test: reports lexer throughput on the inputs above so
+// lexer changes can be compared run to run
+void BenchmarkLexerThroughput() {
+    std::cout << "Source scanning: " << SourceScan::ImplementationName() << std::endl;
+    ReportThroughput("code",
+        "a ||= b\na &&= b\na ~= b\na ~! b\na?.b\na?[b]\na >> b\n"
+        "/mob/proc/attack(mob/target, damage = 10)\n"
+        "\tif (target && target.health > 0)\n"
+        "\t\ttarget.health -= damage * 1.5\n"
+        "\t\tfor (var/i = 0; i < 10; i++) continue\n"
+        "\treturn src?.loc\n");
+    ReportThroughput("comments and strings",
+        "// Applies damage to the target, scaled by armour and the attacker's skill\n"
+        "/* Multipliers are looked up from the global table so that admins can\n"
+        "   tweak them at runtime without a recompile. */\n"
+        "\tdesc = \"A heavy iron sword, older than anyone in the castle can remember.\"\n"
+        "\tmessage = \"You swing at [target] and hit them for [damage] damage.\"\n"
+        "\tblurb = {\"Long description text\nthat spans several lines\nof the file\"}\n");
+}
+
 int main() {
     std::cout << "Running Lexer Token Tests..." << std::endl;
     std::cout << "========================================" << std::endl;
@@ -88,6 +225,11 @@ int main() {
     TestComparisons();
     TestNullConditionals();
     TestRightShift();
+    TestOperatorTable();
+    TestKeywordTable();
+    TestSourceScan();
+    TestLongRuns();
+    BenchmarkLexerThroughput();
     
     std::cout << "\n========================================" << std::endl;
     std::cout << "Lexer Token Tests: " << lexer_tests_passed << "/" << lexer_tests_run << " passed" << std::endl;
@@ -2,8 +2,13 @@
 #include "../include/DMObject.h"
 #include "../include/DMVariable.h"
 #include "../include/DreamPath.h"
+#include "../include/DMASTExpression.h"
+#include "../include/DMVariableStore.h"
+#include "../include/FlatHashMap.h"
 #include <iostream>
 #include <cassert>
+#include <string_view>
+#include <thread>
 
 using namespace DMCompiler;
 
@@ -55,6 +60,13 @@ int tests_passed = 0;
     } \
 } while(0)
 
+#define ASSERT_EQ(a, b) do { \
+    if (!((a) == (b))) { \
+        std::cout << "FATAL: " << __FUNCTION__ << " - Line " << __LINE__ << ": Assertion failed" << std::endl; \
+        return; \
+    } \
+} while(0)
+
 // Test root object creation
 TEST(TestRootObjectCreation) {
     DMObjectTree tree(nullptr);
@@ -174,6 +186,76 @@ TEST(TestStringTable) {
     EXPECT_EQ(tree.StringTable[id2], "world");
 }
 
+// Test interning the same strings from several threads
+TEST(TestConcurrentStringInterning) {
+    ConcurrentStringInterner strings;
+    constexpr int threadCount = 4;
+    constexpr int stringCount = 1000;
+    std::vector<std::vector<int>> ids(threadCount, std::vector<int>(stringCount));
+    
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            // Each thread goes through them in a different order
+            static const int steps[threadCount] = {1, 3, 7, 9};
+            for (int i = 0; i < stringCount; ++i) {
+                int index = (i * steps[t] + t * 250) % stringCount;
+                ids[t][index] = strings.Intern("s" + std::to_string(index));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    EXPECT_EQ(strings.Size(), static_cast<size_t>(stringCount));
+    bool consistent = true;
+    for (int i = 0; i < stringCount; ++i) {
+        for (int t = 1; t < threadCount; ++t) {
+            consistent &= ids[t][i] == ids[0][i];
+        }
+        consistent &= strings[ids[0][i]] == "s" + std::to_string(i);
+        consistent &= strings.Find(std::string_view(strings[ids[0][i]])) == ids[0][i];
+    }
+    EXPECT_TRUE(consistent);
+    EXPECT_EQ(strings.Find("missing"), -1);
+}
+
+// Test that paths made different ways, on different threads, are the same path
+TEST(TestInternedPaths) {
+    constexpr int threadCount = 4;
+    std::vector<DreamPath> made(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&, t]() {
+            made[t] = t % 2 == 0 ? DreamPath("/obj/item/weapon")
+                                 : DreamPath::Obj.Combine(DreamPath(DreamPath::PathType::Relative, {"item"})).AddToPath("weapon");
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    
+    DreamPath weapon(DreamPath::PathType::Absolute, {"obj", "item", "weapon"});
+    DreamPathHash hash;
+    for (const auto& path : made) {
+        EXPECT_EQ(path, weapon);
+        EXPECT_EQ(hash(path), hash(weapon));
+    }
+    EXPECT_EQ(weapon.ToString(), "/obj/item/weapon");
+    EXPECT_EQ(weapon.RemoveLastElement().RemoveLastElement(), DreamPath::Obj);
+    EXPECT_EQ(DreamPath::Obj.RemoveLastElement(), DreamPath::Root);
+    EXPECT_EQ(DreamPath::Root.RemoveLastElement(), DreamPath::Root);
+    EXPECT_TRUE(weapon.IsDescendantOf(DreamPath::Obj));
+    EXPECT_TRUE(weapon.IsDescendantOf(weapon));
+    EXPECT_FALSE(weapon.IsDescendantOf(DreamPath::Mob));
+    EXPECT_FALSE(DreamPath::Obj.IsDescendantOf(weapon));
+    // Same elements, different type
+    DreamPath relativeObj(DreamPath::PathType::Relative, {"obj"});
+    EXPECT_NE(relativeObj, DreamPath::Obj);
+    EXPECT_EQ(relativeObj.ToString(), ".obj");
+}
+
 // Test global variable creation
 TEST(TestGlobalVariableCreation) {
     DMObjectTree tree(nullptr);
@@ -324,6 +406,23 @@ TEST(TestProcOverride) {
     EXPECT_EQ((*playerProcs)[0], 301);
 }
 
+// Test that lookups after FreezeTypeTree() still see types added later
+TEST(TestFrozenTypeLookups) {
+    DMObjectTree tree(nullptr);
+    DMObject* mob = tree.GetOrCreateDMObject(DreamPath("/mob"));
+    DMObject* player = tree.GetOrCreateDMObject(DreamPath("/mob/player"));
+    tree.FreezeTypeTree();
+    
+    DreamPath relativeItem(DreamPath::PathType::Relative, {"item"});
+    EXPECT_EQ(tree.GetType(relativeItem, player), nullptr);
+    EXPECT_EQ(tree.GetType(relativeItem, player), nullptr);
+    EXPECT_EQ(tree.GetType(DreamPath(DreamPath::PathType::Relative, {"player"}), mob), player);
+    
+    DMObject* item = tree.GetOrCreateDMObject(DreamPath("/mob/item"));
+    EXPECT_EQ(tree.GetType(relativeItem, player), item);
+    EXPECT_TRUE(tree.UpwardSearch(player->Path, relativeItem).has_value());
+}
+
 // Test multiple proc overloads
 TEST(TestMultipleProcOverloads) {
     DMObjectTree tree(nullptr);
@@ -436,6 +535,164 @@ TEST(TestVariableOverride) {
     EXPECT_EQ(retrieved->Name, "icon");
 }
 
+// Test that the flattened member tables answer lookups as the parent chain does
+TEST(TestFlattenedMembers) {
+    DMObjectTree tree(nullptr);
+    DMObject* mob = tree.GetOrCreateDMObject(DreamPath("/mob"));
+    DMObject* player = tree.GetOrCreateDMObject(DreamPath("/mob/player"));
+    DMObject* admin = tree.GetOrCreateDMObject(DreamPath("/mob/player/admin"));
+    mob->Variables["health"] = DMVariable(std::nullopt, "health", false, false, false, false);
+    mob->AddProc(500, "Attack");
+    player->VariableOverrides["health"] = DMVariable(std::nullopt, "health", false, false, false, false);
+    player->AddProc(501, "Attack");
+    tree.FreezeTypeTree();
+    
+    ASSERT_NE(player->GetMembers(), nullptr);
+    EXPECT_EQ(admin->GetMembers(), player->GetMembers());  // Defines nothing of its own
+    EXPECT_EQ(admin->GetVariable("health"), &player->VariableOverrides["health"]);
+    EXPECT_EQ(mob->GetVariable("health"), &mob->Variables["health"]);
+    EXPECT_TRUE(admin->HasLocalVariable("health"));
+    EXPECT_FALSE(admin->HasLocalVariable("missing"));
+    EXPECT_EQ(admin->GetVariable("missing"), nullptr);
+    EXPECT_TRUE(admin->HasProc("Attack"));
+    ASSERT_NE(admin->GetProcs("Attack"), nullptr);
+    EXPECT_EQ((*admin->GetProcs("Attack"))[0], 501);
+    EXPECT_EQ((*mob->GetProcs("Attack"))[0], 500);
+    EXPECT_FALSE(mob->HasProc("health"));
+    EXPECT_EQ(tree.GetAllVariables(admin).size(), 1u);
+}
+
+// Test that the pre-order numbering agrees with the parent chain
+TEST(TestSubtypeRanges) {
+    DMObjectTree tree(nullptr);
+    DMObject* mob = tree.GetOrCreateDMObject(DreamPath("/mob"));
+    DMObject* player = tree.GetOrCreateDMObject(DreamPath("/mob/player"));
+    DMObject* item = tree.GetOrCreateDMObject(DreamPath("/obj/item"));
+    DMObject* datum = tree.GetOrCreateDMObject(DreamPath::Datum);
+    
+    EXPECT_TRUE(player->IsSubtypeOf(mob));  // Walks the chain before the freeze
+    tree.FreezeTypeTree();
+    
+    EXPECT_TRUE(player->IsSubtypeOf(mob));
+    EXPECT_TRUE(player->IsSubtypeOf(player));
+    EXPECT_TRUE(item->IsSubtypeOf(datum));
+    EXPECT_FALSE(mob->IsSubtypeOf(player));
+    EXPECT_FALSE(item->IsSubtypeOf(mob));
+    EXPECT_FALSE(item->IsSubtypeOf(nullptr));
+    bool agrees = true;
+    for (DMObject* type : tree.GetAllObjects()) {
+        for (DMObject* ancestor : tree.GetAllObjects()) {
+            bool walked = false;
+            for (const DMObject* t = type; t != nullptr; t = t->Parent) {
+                walked |= t == ancestor;
+            }
+            agrees &= type->IsSubtypeOf(ancestor) == walked;
+        }
+    }
+    EXPECT_TRUE(agrees);
+    EXPECT_EQ(tree.GetRoot()->TreeIndex, 0);
+    EXPECT_EQ(tree.GetRoot()->SubtreeEnd, static_cast<int>(tree.AllObjects.size()) - 1);
+}
+
+TEST(TestInheritedInitializationProcs) {
+    DMObjectTree tree(nullptr);
+    DMObject* mob = tree.GetOrCreateDMObject(DreamPath("/mob"));
+    DMObject* player = tree.GetOrCreateDMObject(DreamPath("/mob/player"));
+    DMObject* admin = tree.GetOrCreateDMObject(DreamPath("/mob/player/admin"));
+    DMObject* item = tree.GetOrCreateDMObject(DreamPath("/obj/item"));
+    DMASTConstantInteger health(Location::Internal, 100);
+    mob->Variables["health"] = DMVariable(std::nullopt, "health", false, false, false, false);
+    mob->Variables["health"].Value = &health;
+    admin->VariableOverrides["health"] = DMVariable(std::nullopt, "health", false, false, false, false);
+    admin->VariableOverrides["health"].Value = &health;
+    for (DMObject* type : tree.GetAllObjects()) {
+        type->CreateInitializationProc(nullptr, &tree);
+    }
+    
+    ASSERT_NE(mob->InitializationProc, -1);
+    EXPECT_EQ(player->InitializationProc, mob->InitializationProc);  // Nothing to set of its own
+    ASSERT_NE(admin->InitializationProc, -1);
+    EXPECT_NE(admin->InitializationProc, mob->InitializationProc);
+    EXPECT_EQ(item->InitializationProc, -1);
+}
+
+TEST(TestVariableStore) {
+    DMObjectTree tree(nullptr);
+    DMObject* mob = tree.GetOrCreateDMObject(DreamPath("/mob"));
+    DMObject* player = tree.GetOrCreateDMObject(DreamPath("/mob/player"));
+    DMObject* admin = tree.GetOrCreateDMObject(DreamPath("/mob/player/admin"));
+    DMASTConstantString playerName(Location::Internal, "player");
+    DMASTConstantString adminName(Location::Internal, "player");  // Equal, so pooled once
+    DMASTConstantInteger health(Location::Internal, 100);
+    mob->Variables["name"] = DMVariable(std::nullopt, "name", false, false, false, false);
+    mob->Variables["health"] = DMVariable(std::nullopt, "health", false, false, false, false);
+    mob->Variables["health"].Value = &health;
+    player->VariableOverrides["name"] = DMVariable(std::nullopt, "name", false, false, false, false);
+    player->VariableOverrides["name"].Value = &playerName;
+    admin->VariableOverrides["name"] = DMVariable(std::nullopt, "name", false, false, false, false);
+    admin->VariableOverrides["name"].Value = &adminName;
+    
+    JsonConstants constants;
+    DMVariableStore store;
+    store.Build(nullptr, constants, tree);
+    
+    DMVariableStore::TypeDefaults mobDefaults = store.GetDefaults(mob->Id);
+    ASSERT_EQ(mobDefaults.size(), 2u);
+    EXPECT_EQ(store.GetName(mobDefaults.Begin[0].Name), "health");  // By name
+    EXPECT_TRUE(std::holds_alternative<int64_t>(store.GetValue(mobDefaults.Begin[0].Value)));
+    EXPECT_TRUE(std::holds_alternative<std::nullptr_t>(store.GetValue(mobDefaults.Begin[1].Value)));
+    ASSERT_EQ(store.GetDefaults(player->Id).size(), 1u);
+    ASSERT_EQ(store.GetDefaults(admin->Id).size(), 1u);
+    EXPECT_EQ(store.GetDefaults(admin->Id).Begin[0].Value, store.GetDefaults(player->Id).Begin[0].Value);
+    EXPECT_EQ(store.GetDefaults(admin->Id).Begin[0].Name, mobDefaults.Begin[1].Name);
+    EXPECT_EQ(store.NameCount(), 2u);
+    EXPECT_EQ(store.ValueCount(), 3u);
+    EXPECT_TRUE(store.GetDefaults(tree.GetRoot()->Id).empty());
+    EXPECT_TRUE(store.GetDefaults(-1).empty());
+    
+    // Strings are handles into one pool, equal strings sharing an ID
+    const JsonValue& name = store.GetValue(store.GetDefaults(player->Id).Begin[0].Value);
+    EXPECT_TRUE(std::holds_alternative<JsonString>(name));
+    if (!std::holds_alternative<JsonString>(name)) {
+        return;
+    }
+    EXPECT_EQ(*std::get<JsonString>(name).Text, "player");
+    EXPECT_EQ(constants.String("player").Id, std::get<JsonString>(name).Id);
+    EXPECT_NE(constants.String("admin").Id, std::get<JsonString>(name).Id);
+    JsonObject backwards = constants.Object({{"b", "2"}, {"a", "1"}});
+    JsonObject forwards = constants.Object({{"a", "1"}, {"b", "2"}});
+    EXPECT_EQ(backwards.Entries, forwards.Entries);  // In any order
+    EXPECT_EQ(constants.StringCount(), 2u);
+    EXPECT_EQ(constants.ObjectCount(), 1u);
+}
+
+TEST(TestFlatHashMap) {
+    FlatHashMap<int> map;
+    EXPECT_TRUE(map.find("missing") == map.end());
+    for (int i = 0; i < 1000; ++i) {
+        map["proc" + std::to_string(i)] = i;
+    }
+    EXPECT_EQ(map.size(), 1000u);
+    EXPECT_FALSE(map.try_emplace("proc7", 70).second);  // Already there
+    EXPECT_EQ(map.begin()->first, "proc0");  // In the order added
+    for (int i = 0; i < 1000; i += 2) {
+        map.erase("proc" + std::to_string(i));
+    }
+    EXPECT_EQ(map.erase("proc0"), 0u);
+    EXPECT_EQ(map.size(), 500u);
+    bool found = true;
+    for (int i = 0; i < 1000; ++i) {
+        std::string key = "proc" + std::to_string(i);
+        auto it = map.find(std::string_view(key));
+        found &= (i % 2 == 1) ? (it != map.end() && it->second == i) : (it == map.end());
+    }
+    EXPECT_TRUE(found);
+    EXPECT_EQ(map.at("proc7"), 7);
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains("proc7"));
+}
+
 void RunObjectTreeTests() {
     std::cout << "\n=== Running DMObjectTree Tests ===" << std::endl;
     
@@ -446,6 +703,8 @@ void RunObjectTreeTests() {
     TestTryGetObject();
     TestTypeIdLookup();
     TestStringTable();
+    TestConcurrentStringInterning();
+    TestInternedPaths();
     TestGlobalVariableCreation();
     TestObjectVariables();
     TestVariableInheritance();
@@ -453,12 +712,18 @@ void RunObjectTreeTests() {
     TestObjectProcs();
     TestProcInheritance();
     TestProcOverride();
+    TestFrozenTypeLookups();
     TestMultipleProcOverloads();
     TestProcForceFirst();
     TestSpecialRootTypes();
     TestDeepHierarchy();
     TestObjectCount();
     TestVariableOverride();
+    TestFlattenedMembers();
+    TestSubtypeRanges();
+    TestInheritedInitializationProcs();
+    TestVariableStore();
+    TestFlatHashMap();
     
     std::cout << "\nObjectTree Tests: " << tests_passed << "/" << tests_run << " passed" << std::endl;
     if (tests_passed == tests_run) {
@@ -6,6 +6,16 @@
 #include "../include/DMCompiler.h"
 #include "../include/DMASTExpression.h"
 #include "../include/DMASTStatement.h"
+#include "../include/DMPreprocessor.h"
+#include "../include/ParallelParser.h"
+#include "../include/TokenStreamDMLexer.h"
+#include "../include/TokenIndentation.h"
+#include "../include/ASTCache.h"
+#include "../include/DMASTFolder.h"
+#include "../include/TokenSerialization.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 
 // Helper function to parse an expression from a string
 std::unique_ptr<DMCompiler::DMASTExpression> ParseExpression(const std::string& code) {
@@ -87,6 +97,127 @@ bool TestAddition() {
     return true;
 }
 
+// Test that node kind tags match the parsed classes
+bool TestNodeKindCast() {
+    std::cout << "  Testing node kind tags (2 + 3)..." << std::endl;
+    auto expr = ParseExpression("2 + 3");
+    
+    if (!expr || expr->Kind_ != DMCompiler::DMASTNodeKind::ExpressionBinary) {
+        std::cerr << "    FAILED: Expected a binary expression kind" << std::endl;
+        return false;
+    }
+    
+    auto* binary = DMCompiler::DMASTCast<DMCompiler::DMASTExpressionBinary>(expr.get());
+    if (!binary || binary != dynamic_cast<DMCompiler::DMASTExpressionBinary*>(expr.get())) {
+        std::cerr << "    FAILED: DMASTCast did not find the binary expression" << std::endl;
+        return false;
+    }
+    
+    // A cast to the wrong class must fail like dynamic_cast does
+    if (DMCompiler::DMASTCast<DMCompiler::DMASTExpressionUnary>(expr.get()) ||
+        DMCompiler::DMASTCast<DMCompiler::DMASTConstantFloat>(binary->Left.get()) ||
+        !DMCompiler::DMASTCast<DMCompiler::DMASTConstantInteger>(binary->Left.get())) {
+        std::cerr << "    FAILED: DMASTCast matched the wrong class" << std::endl;
+        return false;
+    }
+    
+    std::cout << "    PASSED" << std::endl;
+    return true;
+}
+
+// Helper function to parse an expression and run it through the constant folder
+std::unique_ptr<DMCompiler::DMASTExpression> FoldExpression(const std::string& code) {
+    DMCompiler::DMASTProcStatementExpression statement(DMCompiler::Location(), ParseExpression(code));
+    DMCompiler::DMASTFolder folder;
+    folder.FoldAst(&statement);
+    return std::move(statement.Expression);
+}
+
+// Test constant folding with DM number semantics
+bool TestConstantFolding() {
+    std::cout << "  Testing constant folding..." << std::endl;
+    
+    auto isInteger = [](const std::string& code, int32_t value) {
+        auto expr = FoldExpression(code);
+        auto* constant = DMCompiler::DMASTCast<DMCompiler::DMASTConstantInteger>(expr.get());
+        if (!constant || constant->Value != value) {
+            std::cerr << "    FAILED: " << code << " did not fold to " << value << std::endl;
+            return false;
+        }
+        return true;
+    };
+    auto isFloat = [](const std::string& code, float value) {
+        auto expr = FoldExpression(code);
+        auto* constant = DMCompiler::DMASTCast<DMCompiler::DMASTConstantFloat>(expr.get());
+        if (!constant || constant->Value != value) {
+            std::cerr << "    FAILED: " << code << " did not fold to " << value << std::endl;
+            return false;
+        }
+        return true;
+    };
+    auto isUnfolded = [](const std::string& code) {
+        auto expr = FoldExpression(code);
+        if (!DMCompiler::DMASTCast<DMCompiler::DMASTExpressionBinary>(expr.get())) {
+            std::cerr << "    FAILED: " << code << " should be left to the runtime" << std::endl;
+            return false;
+        }
+        return true;
+    };
+    
+    bool ok = isInteger("2 + 3 * 4", 14) && isInteger("6 / 3", 2) && isFloat("7 / 2", 3.5f) &&
+              isFloat("1.5 * 2", 3.0f) && isInteger("2 ** 10", 1024) && isInteger("7 % 3", 1) &&
+              isInteger("3 > 2", 1) && isInteger("1 != 1.0", 0) && isInteger("null == null", 1) &&
+              isInteger("5 & 3 | 8", 9) && isInteger("1 << 4", 16) && isInteger("~0", 0xFFFFFF) &&
+              isInteger("!\"\"", 1) && isInteger("(1 > 2) ? 5 : 6", 6) &&
+              // Numbers are float32, so integers past 2^24 round like they do at runtime
+              isInteger("16777217 + 0", 16777216) &&
+              isUnfolded("1 / 0") && isUnfolded("7.5 % 2") && isUnfolded("\"a\" < \"b\"") && isUnfolded("x + 1");
+    if (!ok) {
+        return false;
+    }
+    
+    auto concat = FoldExpression("\"foo\" + \"bar\"");
+    auto* text = DMCompiler::DMASTCast<DMCompiler::DMASTConstantString>(concat.get());
+    if (!text || text->Value != "foobar") {
+        std::cerr << "    FAILED: String concatenation was not folded" << std::endl;
+        return false;
+    }
+    
+    std::cout << "    PASSED" << std::endl;
+    return true;
+}
+
+// Test that constants embedded in a string format join its text
+bool TestStringFormatFolding() {
+    std::cout << "  Testing string format folding..." << std::endl;
+    
+    auto folded = FoldExpression("\"a[1]b[null]c[\"d\"][x]e\"");
+    auto* format = DMCompiler::DMASTCast<DMCompiler::DMASTStringFormat>(folded.get());
+    if (!format || format->Expressions.size() != 1 || format->StringParts.size() != 2 ||
+        format->StringParts[0] != "a1bcd" || format->StringParts[1] != "e") {
+        std::cerr << "    FAILED: Constants were not merged into the format's text" << std::endl;
+        return false;
+    }
+    
+    auto constantOnly = FoldExpression("\"[2] and [\"three\"]\"");
+    auto* text = DMCompiler::DMASTCast<DMCompiler::DMASTConstantString>(constantOnly.get());
+    if (!text || text->Value != "2 and three") {
+        std::cerr << "    FAILED: A format of constants did not become a string" << std::endl;
+        return false;
+    }
+    
+    // Floats print with the runtime's precision, and brackets would read as markers
+    auto unfolded = FoldExpression("\"[1.5][\"[]\"]\"");
+    format = DMCompiler::DMASTCast<DMCompiler::DMASTStringFormat>(unfolded.get());
+    if (!format || format->Expressions.size() != 2) {
+        std::cerr << "    FAILED: A float or bracketed text was folded into the format" << std::endl;
+        return false;
+    }
+    
+    std::cout << "    PASSED" << std::endl;
+    return true;
+}
+
 // Test operator precedence (2 + 3 * 4 should be 2 + (3 * 4))
 bool TestOperatorPrecedence() {
     std::cout << "  Testing operator precedence (2 + 3 * 4)..." << std::endl;
@@ -493,6 +624,47 @@ bool TestBitwisePrecedence() {
     return true;
 }
 
+// Test every binary precedence level in one chain, plus left associativity
+bool TestPrecedenceLadder() {
+    std::cout << "  Testing precedence ladder (a || b && c | d ^ e & f == g << h + i * j)..." << std::endl;
+    auto expr = ParseExpression("a || b && c | d ^ e & f == g << h + i * j");
+    
+    // Each operator binds tighter than the one before it, so they nest down the right side
+    const DMCompiler::BinaryOperator expected[] = {
+        DMCompiler::BinaryOperator::LogicalOr,
+        DMCompiler::BinaryOperator::LogicalAnd,
+        DMCompiler::BinaryOperator::BitwiseOr,
+        DMCompiler::BinaryOperator::BitwiseXor,
+        DMCompiler::BinaryOperator::BitwiseAnd,
+        DMCompiler::BinaryOperator::Equal,
+        DMCompiler::BinaryOperator::LeftShift,
+        DMCompiler::BinaryOperator::Add,
+        DMCompiler::BinaryOperator::Multiply
+    };
+    DMCompiler::DMASTExpression* node = expr.get();
+    for (DMCompiler::BinaryOperator op : expected) {
+        auto* binary = dynamic_cast<DMCompiler::DMASTExpressionBinary*>(node);
+        if (!binary || binary->Operator != op || !dynamic_cast<DMCompiler::DMASTIdentifier*>(binary->Left.get())) {
+            std::cerr << "    FAILED: Wrong nesting at operator " << static_cast<int>(op) << std::endl;
+            return false;
+        }
+        node = binary->Right.get();
+    }
+    
+    // Same level: (10 - 4) - 3
+    expr = ParseExpression("10 - 4 - 3");
+    auto* outer = dynamic_cast<DMCompiler::DMASTExpressionBinary*>(expr.get());
+    auto* inner = outer ? dynamic_cast<DMCompiler::DMASTExpressionBinary*>(outer->Left.get()) : nullptr;
+    auto* three = outer ? dynamic_cast<DMCompiler::DMASTConstantInteger*>(outer->Right.get()) : nullptr;
+    if (!inner || inner->Operator != DMCompiler::BinaryOperator::Subtract || !three || three->Value != 3) {
+        std::cerr << "    FAILED: Subtraction is not left-associative" << std::endl;
+        return false;
+    }
+    
+    std::cout << "    PASSED" << std::endl;
+    return true;
+}
+
 // Test simple assignment (x = 5)
 bool TestSimpleAssignment() {
     std::cout << "  Testing simple assignment (x = 5)..." << std::endl;
@@ -1665,6 +1837,147 @@ bool TestSwitchStatement() {
     return true;
 }
 
+// Test: indentation-based switch, which ends where its cases do
+bool TestIndentedSwitchStatement() {
+    std::cout << "  TestIndentedSwitchStatement... ";
+    
+    const std::string path = "test_indented_switch.dm";
+    {
+        std::ofstream out(path);
+        out << "proc/Pick(x)\n"
+            << "\tswitch(x)\n"
+            << "\t\tif(1) return 1\n"
+            << "\t\tif(2 to 3)\n"
+            << "\t\t\treturn 2\n"
+            << "\tif(x)\n"
+            << "\t\treturn 3\n"
+            << "\treturn 0";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    DMCompiler::ResolveIndentation(tokens);
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::TokenStreamDMLexer lexer(tokens);
+    DMCompiler::DMParser parser(&compiler, &lexer);
+    auto file = parser.ParseFile();
+    
+    auto* procDef = file && file->Statements.size() == 1
+        ? dynamic_cast<DMCompiler::DMASTObjectProcDefinition*>(file->Statements[0].get()) : nullptr;
+    if (!procDef || !procDef->Body || procDef->Body->Statements.size() != 3) {
+        std::cerr << "FAILED: Expected switch, if and return in the proc body" << std::endl;
+        return false;
+    }
+    
+    auto* switchStmt = dynamic_cast<DMCompiler::DMASTProcStatementSwitch*>(procDef->Body->Statements[0].get());
+    if (!switchStmt || switchStmt->Cases.size() != 2) {
+        std::cerr << "FAILED: Expected a switch with 2 cases" << std::endl;
+        return false;
+    }
+    if (switchStmt->Cases[1].Values.size() != 1 ||
+        !dynamic_cast<DMCompiler::DMASTSwitchCaseRange*>(switchStmt->Cases[1].Values[0].get())) {
+        std::cerr << "FAILED: Second case is not a range" << std::endl;
+        return false;
+    }
+    if (!dynamic_cast<DMCompiler::DMASTProcStatementIf*>(procDef->Body->Statements[1].get())) {
+        std::cerr << "FAILED: if after the switch was taken as a case" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+// Test: a var declaration cut off at the end of the file is an error, not a hang
+bool TestTruncatedVarDeclaration() {
+    std::cout << "  TestTruncatedVarDeclaration... ";
+    
+    const std::string path = "test_truncated_var.dm";
+    {
+        std::ofstream out(path);
+        out << "/proc/main()\n"
+            << "\tvar/\n";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    DMCompiler::ResolveIndentation(tokens);
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::TokenStreamDMLexer lexer(tokens);
+    DMCompiler::DMParser parser(&compiler, &lexer);
+    parser.ParseFile();
+    
+    if (compiler.GetErrorCount() == 0) {
+        std::cerr << "FAILED: Expected an error for the missing variable name" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+// Test: a statement nested past the limit is dropped with one warning, in a
+// proc body or at top level, and parsing resumes after it with the nesting
+// depth back where it was
+bool TestNestingLimitRecovery() {
+    std::cout << "  TestNestingLimitRecovery... ";
+    
+    auto nested = [](int depth) { return std::string(depth, '(') + "1" + std::string(depth, ')'); };
+    const std::string path = "test_nesting_limit.dm";
+    {
+        std::ofstream out(path);
+        out << "/proc/first()\n"
+            << "\treturn 1\n"
+            << "/proc/deep()\n"
+            << "\tvar/x = " << nested(1500) << "\n"
+            << "\treturn 2\n"
+            << "/obj\n"
+            << "\tvar/g = " << nested(1500) << "\n"
+            << "/proc/last()\n"
+            << "\tvar/y = " << nested(900) << "\n"
+            << "\treturn 3\n";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    DMCompiler::ResolveIndentation(tokens);
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::TokenStreamDMLexer lexer(tokens);
+    DMCompiler::DMParser parser(&compiler, &lexer);
+    auto file = parser.ParseFile();
+    
+    if (compiler.GetWarningCount() != 2) {
+        std::cerr << "FAILED: Expected one warning per statement past the limit, got "
+                  << compiler.GetWarningCount() << std::endl;
+        return false;
+    }
+    std::vector<std::pair<std::string, size_t>> parsed;
+    for (const auto& stmt : file->Statements) {
+        if (auto* proc = dynamic_cast<DMCompiler::DMASTObjectProcDefinition*>(stmt.get())) {
+            parsed.emplace_back(proc->Name, proc->Body ? proc->Body->Statements.size() : 0);
+        } else if (auto* obj = dynamic_cast<DMCompiler::DMASTObjectDefinition*>(stmt.get())) {
+            parsed.emplace_back(obj->Path.Path.ToString(), obj->InnerStatements.size());
+        }
+    }
+    std::vector<std::pair<std::string, size_t>> expected = {{"first", 1}, {"deep", 1}, {"last", 2}};
+    if (parsed != expected) {
+        std::cerr << "FAILED: Parsing did not resume after the statements past the limit" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 // Test: del
 bool TestDelStatement() {
     std::cout << "  TestDelStatement... ";
@@ -2435,6 +2748,27 @@ bool TestProcInObject() {
     return true;
 }
 
+bool TestProcPathInObject() {
+    std::cout << "Testing proc path in object... ";
+    
+    // Backtracking over the whole path "foo/bar" must keep all of it
+    auto stmt = ParseObjectStatement("/obj/item { foo/bar(x) { return x } }");
+    auto* objDef = dynamic_cast<DMCompiler::DMASTObjectDefinition*>(stmt.get());
+    if (!objDef || objDef->InnerStatements.size() != 1) {
+        std::cerr << "FAILED: Expected an object definition with 1 inner statement" << std::endl;
+        return false;
+    }
+    
+    auto* procDef = dynamic_cast<DMCompiler::DMASTObjectProcDefinition*>(objDef->InnerStatements[0].get());
+    if (!procDef || procDef->Name != "bar" || procDef->Parameters.size() != 1) {
+        std::cerr << "FAILED: Expected proc 'bar' with 1 parameter" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 // ============================================================================
 // Integration Tests - Parsing Complete Files
 // ============================================================================
@@ -2459,6 +2793,437 @@ bool TestParseSimpleFile() {
     return true;
 }
 
+bool TestParseFileUsesArena() {
+    std::cout << "Testing AST arena allocation... ";
+    
+    const char* source = R"(
+        /mob/proc/Add(a, b)
+            return a + b
+    )";
+    
+    auto file = ParseFile(source);
+    if (!file || !file->Arena) {
+        std::cerr << "FAILED: Parsed file has no arena" << std::endl;
+        return false;
+    }
+    if (file->Arena->BytesUsed() == 0) {
+        std::cerr << "FAILED: No nodes were allocated from the arena" << std::endl;
+        return false;
+    }
+    
+    // Nodes must be aligned, and outlive the parser that created them
+    if (file->Statements.size() != 1 ||
+        reinterpret_cast<uintptr_t>(file->Statements[0].get()) % DMCompiler::DMASTArena::Alignment != 0) {
+        std::cerr << "FAILED: Expected 1 aligned statement" << std::endl;
+        return false;
+    }
+    
+    // Expressions parsed on their own are heap-allocated and freed normally
+    auto expr = ParseExpression("1 + 2");
+    if (!dynamic_cast<DMCompiler::DMASTExpressionBinary*>(expr.get())) {
+        std::cerr << "FAILED: Expected binary expression" << std::endl;
+        return false;
+    }
+    
+    // Oversized allocations get their own chunk without wasting the current one
+    DMCompiler::DMASTArena arena;
+    void* small = arena.Allocate(24);
+    arena.Allocate(DMCompiler::DMASTArena::ChunkSize);
+    void* next = arena.Allocate(24);
+    if (arena.ChunkCount() != 2 || static_cast<char*>(next) - static_cast<char*>(small) != 32) {
+        std::cerr << "FAILED: Unexpected arena layout" << std::endl;
+        return false;
+    }
+    arena.Reset();
+    if (arena.ChunkCount() != 0 || arena.BytesUsed() != 0) {
+        std::cerr << "FAILED: Reset did not release the arena" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+bool TestParallelParseMatchesSequential() {
+    std::cout << "Testing parallel parsing... ";
+    
+    const std::string path = "test_parallel_parse.dm";
+    {
+        std::ofstream out(path);
+        out << "/obj/item\n"
+            << "\tvar/weight = 2\n"
+            << "\tproc/Use(mob/user)\n"
+            << "\t\treturn list(1,\n"
+            << "user)\n"
+            << "/mob\n"
+            << "{\n"
+            << "var/health = 100\n"
+            << "}\n"
+            << "proc/Global(a, b = 3)\n"
+            << "\treturn a * b\n"
+            << "var/global/counter = 0\n";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    
+    // Lines inside the list( ) and the braces continue the definition above them
+    std::vector<int> startLines;
+    for (size_t start : DMCompiler::ParallelParser::FindChunkStarts(tokens, 1)) {
+        startLines.push_back(tokens.Get(start).Loc.Line);
+    }
+    if (startLines != std::vector<int>{1, 6, 10, 12}) {
+        std::cerr << "FAILED: Unexpected chunk starts" << std::endl;
+        return false;
+    }
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::TokenStreamDMLexer lexer(tokens);
+    DMCompiler::DMParser parser(&compiler, &lexer);
+    auto sequential = parser.ParseFile();
+    
+    DMCompiler::ParallelParser parallelParser(&compiler, tokens);
+    auto parallel = parallelParser.Parse(4, 1);
+    if (!parallel || parallelParser.ChunkCount() != 4) {
+        std::cerr << "FAILED: Parallel parse did not split the file" << std::endl;
+        return false;
+    }
+    if (parallel->Statements.size() != sequential->Statements.size()) {
+        std::cerr << "FAILED: Expected " << sequential->Statements.size() << " statements, got "
+                  << parallel->Statements.size() << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < parallel->Statements.size(); ++i) {
+        if (parallel->Statements[i]->ToString() != sequential->Statements[i]->ToString()) {
+            std::cerr << "FAILED: Statement " << i << " differs" << std::endl;
+            return false;
+        }
+    }
+    
+    // Syntax errors are left to the sequential parser, whose recovery they depend on
+    DMCompiler::TokenBuffer broken;
+    {
+        std::ofstream out(path);
+        out << "/obj/a\n\tvar/x = (1 +\n/obj/b\n\tvar/y = 2\n/obj/c\n\tproc/f(\n";
+    }
+    broken.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    DMCompiler::ParallelParser brokenParser(&compiler, broken);
+    if (brokenParser.Parse(4, 1)) {
+        std::cerr << "FAILED: Parallel parse accepted a file with syntax errors" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+bool TestResolvedIndentationMatchesStream() {
+    std::cout << "Testing resolved indentation... ";
+    
+    const std::string path = "test_resolved_indentation.dm";
+    {
+        std::ofstream out(path);
+        out << "/obj/item\n"
+            << "\tvar/weight = 2\n"
+            << "\tproc/Use(mob/user)\n"
+            << "\t\tif(user)\n"
+            << "\t\t\treturn list(1,\n"
+            << "  user)\n"
+            << "\t\treturn 0\n"
+            << "/mob\n"
+            << "\tvar/health = 100\n"
+            << "proc/Global()\n"
+            << "\treturn 1";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    std::vector<DMCompiler::Token> preprocessed = preprocessor.Preprocess(path);
+    std::filesystem::remove(path);
+    
+    DMCompiler::TokenBuffer streamed;
+    streamed.Append(preprocessed);
+    DMCompiler::TokenBuffer resolved;
+    resolved.Append(preprocessed);
+    DMCompiler::ResolveIndentation(resolved);
+    if (!resolved.IndentationResolved()) {
+        std::cerr << "FAILED: Buffer not marked as resolved" << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < resolved.size(); ++i) {
+        if (resolved.TypeAt(i) == DMCompiler::TokenType::DM_Preproc_Whitespace) {
+            std::cerr << "FAILED: Whitespace left at token " << i << std::endl;
+            return false;
+        }
+    }
+    
+    // The lexer must hand the parser the same tokens either way, EndOfFile included
+    DMCompiler::TokenStreamDMLexer streamLexer(streamed);
+    DMCompiler::TokenStreamDMLexer resolvedLexer(resolved);
+    for (int i = 0; i < 10000; ++i) {
+        DMCompiler::Token expected = streamLexer.GetNextToken();
+        DMCompiler::Token actual = resolvedLexer.GetNextToken();
+        if (actual.Type != expected.Type || actual.Text != expected.Text ||
+            actual.Loc.FileId != expected.Loc.FileId || actual.Loc.Line != expected.Loc.Line ||
+            actual.Loc.Column != expected.Loc.Column) {
+            std::cerr << "FAILED: Token " << i << " differs" << std::endl;
+            return false;
+        }
+        if (expected.Type == DMCompiler::TokenType::EndOfFile) {
+            break;
+        }
+    }
+    
+    // Chunks can still only start at top-level definitions
+    std::vector<int> startLines;
+    for (size_t start : DMCompiler::ParallelParser::FindChunkStarts(resolved, 1)) {
+        startLines.push_back(resolved.Get(start).Loc.Line);
+    }
+    if (startLines != std::vector<int>{1, 8, 10}) {
+        std::cerr << "FAILED: Unexpected chunk starts" << std::endl;
+        return false;
+    }
+    
+    // A later start splits the stream as well as the first one does
+    std::vector<size_t> starts = DMCompiler::ParallelParser::FindChunkStarts(resolved, 1);
+    if (!DMCompiler::ParallelParser::IsChunkStart(resolved, starts[1]) ||
+        DMCompiler::ParallelParser::IsChunkStart(resolved, starts[1] + 1) ||
+        DMCompiler::ParallelParser::FindChunkStarts(resolved, 1, starts[1]) != std::vector<size_t>(starts.begin() + 1, starts.end())) {
+        std::cerr << "FAILED: Chunk starts differ when scanning from one" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+bool TestDeferredProcBodyMatchesEager() {
+    std::cout << "Testing deferred proc bodies... ";
+    
+    const std::string path = "test_deferred_proc_body.dm";
+    {
+        std::ofstream out(path);
+        out << "/obj/item\n"
+            << "\tproc/Use(mob/user)\n"
+            << "\t\tif(user)\n"
+            << "\t\t\treturn list(1,\n"
+            << "  user)\n"
+            << "\t\treturn 0\n"
+            << "\tvar/weight = 2\n"
+            << "proc/Braced() { return 2 }\n"
+            << "proc/Global()\n"
+            << "\treturn 1";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(path));
+    std::filesystem::remove(path);
+    DMCompiler::ResolveIndentation(tokens);
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::TokenStreamDMLexer eagerLexer(tokens);
+    DMCompiler::DMParser eagerParser(&compiler, &eagerLexer);
+    auto eager = eagerParser.ParseFile();
+    
+    DMCompiler::TokenStreamDMLexer lazyLexer(tokens);
+    DMCompiler::DMParser lazyParser(&compiler, &lazyLexer);
+    lazyParser.SetDeferProcBodies(true);
+    auto lazy = lazyParser.ParseFile();
+    
+    // Collect the proc definitions of both parses in source order
+    std::vector<DMCompiler::DMASTObjectProcDefinition*> eagerProcs, lazyProcs;
+    auto collect = [](DMCompiler::DMASTFile& file, std::vector<DMCompiler::DMASTObjectProcDefinition*>& procs) {
+        for (auto& stmt : file.Statements) {
+            if (auto* objDef = dynamic_cast<DMCompiler::DMASTObjectDefinition*>(stmt.get())) {
+                for (auto& inner : objDef->InnerStatements) {
+                    if (auto* procDef = dynamic_cast<DMCompiler::DMASTObjectProcDefinition*>(inner.get())) {
+                        procs.push_back(procDef);
+                    }
+                }
+            } else if (auto* procDef = dynamic_cast<DMCompiler::DMASTObjectProcDefinition*>(stmt.get())) {
+                procs.push_back(procDef);
+            }
+        }
+    };
+    collect(*eager, eagerProcs);
+    collect(*lazy, lazyProcs);
+    if (eagerProcs.size() != 3 || lazyProcs.size() != 3 || lazy->Statements.size() != eager->Statements.size()) {
+        std::cerr << "FAILED: Expected 3 procs in both parses" << std::endl;
+        return false;
+    }
+    
+    for (size_t i = 0; i < lazyProcs.size(); ++i) {
+        auto* procDef = lazyProcs[i];
+        if (procDef->Body || !procDef->HasDeferredBody()) {
+            std::cerr << "FAILED: Body of proc " << procDef->Name << " was not deferred" << std::endl;
+            return false;
+        }
+        
+        // Parsing the recorded range alone must give the body the eager parse built
+        const auto& range = procDef->DeferredBody;
+        DMCompiler::TokenStreamDMLexer bodyLexer(tokens, range.Begin, range.End);
+        DMCompiler::DMParser bodyParser(&compiler, &bodyLexer);
+        auto body = bodyParser.ParseProcBody(range.BaseIndent);
+        if (!body || !eagerProcs[i]->Body || body->ToString() != eagerProcs[i]->Body->ToString()) {
+            std::cerr << "FAILED: Deferred body of proc " << procDef->Name << " differs" << std::endl;
+            return false;
+        }
+    }
+    
+    // The statement after a deferred body must still be parsed
+    auto* objDef = dynamic_cast<DMCompiler::DMASTObjectDefinition*>(lazy->Statements[0].get());
+    if (!objDef || objDef->InnerStatements.size() != 2) {
+        std::cerr << "FAILED: Expected /obj/item to keep its var after the proc" << std::endl;
+        return false;
+    }
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+bool TestASTCacheRoundTrip() {
+    std::cout << "Testing AST cache round trip... ";
+    
+    const std::string mainPath = "test_ast_cache.dm";
+    const std::string includedPath = "test_ast_cache_included.dm";
+    const std::string cacheDir = "test_ast_cache_dir";
+    const std::string copyDir = "test_ast_cache_copy";
+    {
+        std::ofstream out(includedPath);
+        out << "/obj/item\n"
+            << "\tvar/list/contents = list(\"a\" = 1, 2)\n"
+            << "\tvar/name as text\n"
+            << "\tproc/Use(mob/user as mob, count = 2)\n"
+            << "\t\tvar/x = count > 1 ? (-count) : (count ** 2)\n"
+            << "\t\tfor(var/obj/O in user)\n"
+            << "\t\t\tdel O\n"
+            << "\t\tfor(var/i = 1 to 10 step 2)\n"
+            << "\t\t\tx += i\n"
+            << "\t\tswitch(x)\n"
+            << "\t\t\tif(1 to 5)\n"
+            << "\t\t\t\treturn \"[user.name] has [x]\"\n"
+            << "\t\t\telse\n"
+            << "\t\t\t\tspawn(5) world << new /obj/item(src)\n"
+            << "\t\ttry\n"
+            << "\t\t\tthrow x\n"
+            << "\t\tcatch(e)\n"
+            << "\t\t\twhile(x) x--\n"
+            << "\t\treturn user?.loc\n";
+    }
+    {
+        std::ofstream out(mainPath);
+        out << "#include \"" << includedPath << "\"\n"
+            << "/mob\n"
+            << "\tset name = \"mob\"\n"
+            << "\tvar/health = 100\n"
+            << "proc/Global()\n"
+            << "\tdo\n"
+            << "\t\tbreak\n"
+            << "\twhile(1)\n"
+            << "\treturn 'icon.dmi'\n";
+    }
+    
+    DMCompiler::DMPreprocessor preprocessor;
+    DMCompiler::TokenBuffer tokens;
+    tokens.Append(preprocessor.Preprocess(mainPath));
+    std::filesystem::remove(mainPath);
+    std::filesystem::remove(includedPath);
+    DMCompiler::ResolveIndentation(tokens);
+    
+    auto cleanup = [&]() {
+        std::filesystem::remove_all(cacheDir);
+        std::filesystem::remove_all(copyDir);
+    };
+    
+    // One segment per file the definitions come from
+    std::vector<DMCompiler::ASTCache::Segment> segments = DMCompiler::ASTCache::FindSegments(tokens);
+    if (segments.size() != 2 || segments[0].Begin != 0 || segments[1].End != tokens.size() ||
+        segments[0].End != segments[1].Begin || segments[0].Hash == segments[1].Hash) {
+        std::cerr << "FAILED: Expected 2 segments, got " << segments.size() << std::endl;
+        cleanup();
+        return false;
+    }
+    
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::ASTCache cache(cacheDir, false);
+    DMCompiler::ASTCache copy(copyDir, false);
+    for (const auto& segment : segments) {
+        auto parsed = DMCompiler::ParallelParser::ParseChunk(&compiler, tokens, segment.Begin, segment.End);
+        if (!parsed) {
+            std::cerr << "FAILED: Segment did not parse cleanly" << std::endl;
+            cleanup();
+            return false;
+        }
+        cache.Store(segment, *parsed);
+        
+        auto loaded = cache.Load(segment);
+        if (!loaded || !loaded->Arena || loaded->Statements.size() != parsed->Statements.size()) {
+            std::cerr << "FAILED: Stored segment did not load back" << std::endl;
+            cleanup();
+            return false;
+        }
+        // Writing the loaded tree again must give the same entry
+        copy.Store(segment, *loaded);
+    }
+    
+    size_t entries = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(cacheDir)) {
+        std::ifstream original(entry.path(), std::ios::binary);
+        std::ifstream rewritten(std::filesystem::path(copyDir) / entry.path().filename(), std::ios::binary);
+        std::string a((std::istreambuf_iterator<char>(original)), std::istreambuf_iterator<char>());
+        std::string b((std::istreambuf_iterator<char>(rewritten)), std::istreambuf_iterator<char>());
+        if (a.empty() || a != b) {
+            std::cerr << "FAILED: Entry " << entry.path().filename() << " changed after a round trip" << std::endl;
+            cleanup();
+            return false;
+        }
+        entries++;
+    }
+    if (entries != 2) {
+        std::cerr << "FAILED: Expected 2 cache entries, got " << entries << std::endl;
+        cleanup();
+        return false;
+    }
+    
+    // Other tokens or deferred bodies must not hit these entries
+    DMCompiler::ASTCache::Segment changed = segments[0];
+    changed.Hash ^= 1;
+    DMCompiler::ASTCache lazyCache(cacheDir, true);
+    if (cache.Load(changed) || lazyCache.Load(segments[0])) {
+        std::cerr << "FAILED: Cache hit for a different segment or parser mode" << std::endl;
+        cleanup();
+        return false;
+    }
+    
+    // Nor may an entry with any one byte damaged
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.ast", static_cast<unsigned long long>(segments[0].Hash));
+    const std::string entryPath = (std::filesystem::path(cacheDir) / name).string();
+    std::string data;
+    if (!DMCompiler::ReadBinaryFile(entryPath, data)) {
+        std::cerr << "FAILED: No entry at " << entryPath << std::endl;
+        cleanup();
+        return false;
+    }
+    for (size_t i = 0; i < data.size(); ++i) {
+        std::string damaged = data;
+        damaged[i] ^= 0x01;
+        DMCompiler::WriteBinaryFileAtomic(entryPath, damaged);
+        if (cache.Load(segments[0])) {
+            std::cerr << "FAILED: Entry loaded with byte " << i << " damaged" << std::endl;
+            cleanup();
+            return false;
+        }
+    }
+    
+    cleanup();
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 bool TestParseMultipleProcs() {
     std::cout << "Testing multiple procs... ";
     
@@ -2658,6 +3423,9 @@ int RunParserTests() {
     std::cout << "\nExpression Parsing Tests:" << std::endl;
     if (TestIntegerLiteral()) passed++; else failed++;
     if (TestAddition()) passed++; else failed++;
+    if (TestNodeKindCast()) passed++; else failed++;
+    if (TestConstantFolding()) passed++; else failed++;
+    if (TestStringFormatFolding()) passed++; else failed++;
     if (TestOperatorPrecedence()) passed++; else failed++;
     if (TestUnaryNegation()) passed++; else failed++;
     if (TestParentheses()) passed++; else failed++;
@@ -2680,6 +3448,7 @@ int RunParserTests() {
     if (TestLeftShift()) passed++; else failed++;
     if (TestRightShift()) passed++; else failed++;
     if (TestBitwisePrecedence()) passed++; else failed++;
+    if (TestPrecedenceLadder()) passed++; else failed++;
     
     std::cout << "\nAssignment Operator Tests:" << std::endl;
     if (TestSimpleAssignment()) passed++; else failed++;
@@ -2717,6 +3486,9 @@ int RunParserTests() {
     if (TestDoWhileStatement()) passed++; else failed++;
     if (TestForStatement()) passed++; else failed++;
     if (TestSwitchStatement()) passed++; else failed++;
+    if (TestIndentedSwitchStatement()) passed++; else failed++;
+    if (TestTruncatedVarDeclaration()) passed++; else failed++;
+    if (TestNestingLimitRecovery()) passed++; else failed++;
     if (TestBreakStatement()) passed++; else failed++;
     if (TestContinueStatement()) passed++; else failed++;
     if (TestDelStatement()) passed++; else failed++;
@@ -2748,9 +3520,15 @@ int RunParserTests() {
     if (TestObjectDefinition()) passed++; else failed++;
     if (TestNestedObjectDefinition()) passed++; else failed++;
     if (TestProcInObject()) passed++; else failed++;
+    if (TestProcPathInObject()) passed++; else failed++;
     
     std::cout << "\nIntegration Tests - Complete Files:" << std::endl;
     if (TestParseSimpleFile()) passed++; else failed++;
+    if (TestParseFileUsesArena()) passed++; else failed++;
+    if (TestParallelParseMatchesSequential()) passed++; else failed++;
+    if (TestResolvedIndentationMatchesStream()) passed++; else failed++;
+    if (TestDeferredProcBodyMatchesEager()) passed++; else failed++;
+    if (TestASTCacheRoundTrip()) passed++; else failed++;
     if (TestParseMultipleProcs()) passed++; else failed++;
     if (TestParseObjectHierarchy()) passed++; else failed++;
     if (TestParseMixedContent()) passed++; else failed++;
@@ -1,8 +1,11 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
+#include <memory>
+#include <sstream>
 #include "../include/DMPreprocessor.h"
 #include "../include/DMLexer.h"
+#include "../include/TokenPipeline.h"
 
 using namespace DMCompiler;
 
@@ -198,6 +201,307 @@ int RunPreprocessorTests() {
         }
     }
     
-    std::cout << "\n  Preprocessor tests: " << (6 - failures) << "/6 passed" << std::endl;
+    // Test 7: Pipeline streams the same tokens as batch preprocessing
+    {
+        std::cout << "  Test 7: Streaming pipeline matches Preprocess... ";
+        try {
+            std::string testFilePath = "test_files/pipeline_test.dm";
+            fs::create_directories("test_files");
+            std::ofstream testFile(testFilePath);
+            testFile << "#define VALUE 42\n";
+            testFile << "/mob\n";
+            testFile << "\tvar/x = VALUE\n";
+            testFile << "\tproc/f()\n";
+            testFile << "\t\treturn x + 1\n";
+            testFile.close();
+            
+            DMPreprocessor batchPreprocessor;
+            std::vector<Token> expected = batchPreprocessor.Preprocess(testFilePath);
+            
+            // A tiny ring forces the producer to block and wrap around repeatedly
+            PreprocessorPipeline pipeline(nullptr, std::make_unique<DMPreprocessor>(),
+                                          std::vector<std::string>{testFilePath, testFilePath}, 3);
+            pipeline.Start();
+            std::vector<Token> streamed;
+            while (pipeline.GetStream().PopBatch(streamed, 2)) {
+            }
+            bool ok = pipeline.Finish();
+            
+            bool matches = ok && !expected.empty() && streamed.size() == expected.size() * 2 &&
+                           pipeline.GetTokenCount() == streamed.size();
+            for (size_t i = 0; matches && i < streamed.size(); ++i) {
+                const Token& want = expected[i % expected.size()];
+                matches = streamed[i].Type == want.Type && streamed[i].Text == want.Text &&
+                          streamed[i].Loc.Line == want.Loc.Line;
+            }
+            
+            if (matches) {
+                std::cout << "PASSED (" << streamed.size() << " tokens)" << std::endl;
+            } else {
+                std::cout << "FAILED (streamed " << streamed.size() << " tokens, expected "
+                          << expected.size() * 2 << ")" << std::endl;
+                failures++;
+            }
+            
+            fs::remove(testFilePath);
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 8: Files lexed ahead of time on worker threads preprocess identically
+    {
+        std::cout << "  Test 8: Parallel pre-lexing matches inline lexing... ";
+        try {
+            fs::create_directories("test_files/prelex");
+            std::ofstream("test_files/prelex/root.dme") << "#include \"a.dm\"\n#include \"b.dm\"\n";
+            std::ofstream("test_files/prelex/a.dm") << "#define A 1\n/obj/a\n\tvar/x = A\n";
+            std::ofstream("test_files/prelex/b.dm") << "#ifdef A\n/obj/b\n#endif\n";
+            
+            DMPreprocessor inlinePreprocessor;
+            std::vector<Token> expected = inlinePreprocessor.Preprocess("test_files/prelex/root.dme");
+            
+            DMPreprocessor parallelPreprocessor;
+            parallelPreprocessor.SetLexThreads(4);
+            std::vector<Token> actual = parallelPreprocessor.Preprocess("test_files/prelex/root.dme");
+            
+            bool matches = !expected.empty() && actual.size() == expected.size();
+            for (size_t i = 0; matches && i < actual.size(); ++i) {
+                matches = actual[i].Type == expected[i].Type && actual[i].Text == expected[i].Text &&
+                          actual[i].Loc.FileId == expected[i].Loc.FileId && actual[i].Loc.Line == expected[i].Loc.Line;
+            }
+            
+            if (matches) {
+                std::cout << "PASSED (" << actual.size() << " tokens)" << std::endl;
+            } else {
+                std::cout << "FAILED (got " << actual.size() << " tokens, expected " << expected.size() << ")" << std::endl;
+                failures++;
+            }
+            
+            fs::remove_all("test_files/prelex");
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 9: Function-like macros substitute arguments, including macro calls inside arguments
+    {
+        std::cout << "  Test 9: Function-like macro expansion... ";
+        try {
+            std::string testFilePath = "test_files/macro_function_test.dm";
+            fs::create_directories("test_files");
+            std::ofstream testFile(testFilePath);
+            testFile << "#define ADD(a, b) (a + b)\n";
+            testFile << "#define TWICE(x) x * x\n";
+            testFile << "#define NONE() 7\n";
+            testFile << "var/x = TWICE(ADD( 1 , 2 ))\n";
+            testFile << "var/y = NONE()\n";
+            testFile.close();
+            
+            DMPreprocessor preprocessor;
+            std::vector<Token> tokens = preprocessor.Preprocess(testFilePath);
+            
+            std::string text;
+            for (const auto& token : tokens) {
+                if (token.Type != TokenType::DM_Preproc_Whitespace && token.Type != TokenType::Newline) {
+                    text += token.Text;
+                }
+            }
+            
+            std::string expected = "var/x=(1+2)*(1+2)var/y=7";
+            if (text == expected) {
+                std::cout << "PASSED" << std::endl;
+            } else {
+                std::cout << "FAILED (got \"" << text << "\", expected \"" << expected << "\")" << std::endl;
+                failures++;
+            }
+            
+            fs::remove(testFilePath);
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 10: Include-guarded files reached through another path are not read again
+    {
+        std::cout << "  Test 10: Include guards skip re-inclusion... ";
+        try {
+            fs::create_directories("test_files/guard/sub");
+            std::ofstream("test_files/guard/root.dme") << "#include \"guarded.dm\"\n#include \"sub/../guarded.dm\"\n"
+                                                       << "#include \"once.dm\"\n#include \"sub/../once.dm\"\n";
+            std::ofstream("test_files/guard/guarded.dm") << "#ifndef GUARDED_DM\n#define GUARDED_DM\n/obj/guarded\n#endif\n";
+            std::ofstream("test_files/guard/once.dm") << "#pragma once\n/obj/once\n";
+            
+            DMPreprocessor preprocessor;
+            std::vector<Token> tokens = preprocessor.Preprocess("test_files/guard/root.dme");
+            
+            int guardedCount = 0;
+            int onceCount = 0;
+            for (const auto& token : tokens) {
+                if (token.Text == "guarded") guardedCount++;
+                if (token.Text == "once") onceCount++;
+            }
+            
+            if (guardedCount == 1 && onceCount == 1) {
+                std::cout << "PASSED" << std::endl;
+            } else {
+                std::cout << "FAILED (guarded " << guardedCount << "x, once " << onceCount << "x)" << std::endl;
+                failures++;
+            }
+            
+            fs::remove_all("test_files/guard");
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 11: Raw skipping of inactive blocks agrees with skipping lexed tokens
+    {
+        std::cout << "  Test 11: Inactive blocks skip like lexed tokens... ";
+        try {
+            fs::create_directories("test_files/skip");
+            std::ofstream("test_files/skip/skip.dm")
+                << "#ifdef NOT_DEFINED\n"
+                << "var/s = \"#endif [x ? \"#endif\" : list(1)[1]] #else\"\n"
+                << "/* \n#endif\n */\n"
+                << "var/m = {\"\n#endif\n\"}\n"
+                << "var/r = 'a#endif'\n"
+                << "#if 1\n/obj/nested\n#else\n#endif\n"
+                << "#else\n"
+                << "/obj/live\n"
+                << "#endif\n"
+                << "/obj/after\n";
+            
+            DMPreprocessor rawPreprocessor;
+            std::vector<Token> expected = rawPreprocessor.Preprocess("test_files/skip/skip.dm");
+            
+            // Pre-lexed files are replayed, so their inactive blocks are skipped token by token
+            DMPreprocessor tokenPreprocessor;
+            tokenPreprocessor.SetLexThreads(1);
+            std::vector<Token> actual = tokenPreprocessor.Preprocess("test_files/skip/skip.dm");
+            
+            std::string text;
+            int afterLine = 0;
+            for (const auto& token : expected) {
+                if (token.Type != TokenType::DM_Preproc_Whitespace && token.Type != TokenType::Newline) {
+                    text += token.Text;
+                }
+                if (token.Text == "after") {
+                    afterLine = token.Loc.Line;
+                }
+            }
+            
+            bool matches = text == "/obj/live/obj/after" && afterLine == 17 && actual.size() == expected.size();
+            for (size_t i = 0; matches && i < actual.size(); ++i) {
+                matches = actual[i].Type == expected[i].Type && actual[i].Text == expected[i].Text &&
+                          actual[i].Loc.Line == expected[i].Loc.Line && actual[i].Loc.Column == expected[i].Loc.Column;
+            }
+            
+            if (matches) {
+                std::cout << "PASSED" << std::endl;
+            } else {
+                std::cout << "FAILED (got \"" << text << "\", /obj/after on line " << afterLine << ")" << std::endl;
+                failures++;
+            }
+            
+            fs::remove_all("test_files/skip");
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 12: Cached #if results are dropped when a macro they read is redefined
+    {
+        std::cout << "  Test 12: #if condition cache follows redefinitions... ";
+        try {
+            fs::create_directories("test_files/ifcache");
+            // A expands to the bare name B, which the evaluator looks up itself
+            std::ofstream("test_files/ifcache/ifcache.dm")
+                << "#define A B\n"
+                << "#define B 1\n"
+                << "#if A\n/obj/one\n#endif\n"
+                << "#if A\n/obj/two\n#endif\n"
+                << "#undef B\n"
+                << "#define B 0\n"
+                << "#if A\n/obj/three\n#endif\n"
+                << "#if !A\n/obj/four\n#endif\n";
+            
+            DMPreprocessor preprocessor;
+            std::vector<Token> tokens = preprocessor.Preprocess("test_files/ifcache/ifcache.dm");
+            
+            std::string text;
+            for (const auto& token : tokens) {
+                if (token.Type != TokenType::DM_Preproc_Whitespace && token.Type != TokenType::Newline) {
+                    text += token.Text;
+                }
+            }
+            
+            if (text == "/obj/one/obj/two/obj/four" && preprocessor.GetConditionCacheHits() == 1) {
+                std::cout << "PASSED" << std::endl;
+            } else {
+                std::cout << "FAILED (got \"" << text << "\", " << preprocessor.GetConditionCacheHits() << " cache hits)" << std::endl;
+                failures++;
+            }
+            
+            fs::remove_all("test_files/ifcache");
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    // Test 13: Statistics count includes, macro expansions and skipped blocks
+    {
+        std::cout << "  Test 13: Preprocessor statistics... ";
+        try {
+            fs::create_directories("test_files/stats");
+            std::ofstream("test_files/stats/common.dm")
+                << "#define PAIR(a, b) a + b\n"
+                << "#define ONE 1\n";
+            std::ofstream("test_files/stats/root.dm")
+                << "#include \"common.dm\"\n"
+                << "#include \"common.dm\"\n"
+                << "var/x = PAIR(ONE, ONE)\n"
+                << "#ifdef MISSING\n"
+                << "var/y = ONE\n"
+                << "#endif\n";
+            
+            auto stats = std::make_shared<PreprocessorStats>();
+            DMPreprocessor preprocessor;
+            preprocessor.SetStats(stats);
+            preprocessor.Preprocess("test_files/stats/root.dm");
+            
+            const auto& common = stats->Files[fs::absolute("test_files/stats/common.dm").string()];
+            const auto& root = stats->Files[fs::absolute("test_files/stats/root.dm").string()];
+            bool ok = common.IncludedBy == 2 && common.Opened == 1 && common.MaxDepth == 2 &&
+                      common.Bytes > 0 && common.Tokens > 0 && root.Tokens > common.Tokens &&
+                      stats->Macros["PAIR"].Expansions == 1 && stats->Macros["ONE"].Expansions == 2 &&
+                      stats->Macros["ONE"].TokensProduced == 2 &&
+                      stats->SkippedBlocks == 1 && stats->DeepestChain.size() == 2;
+            
+            std::ostringstream report;
+            stats->Report(report);
+            ok = ok && report.str().find("PAIR") != std::string::npos;
+            
+            if (ok) {
+                std::cout << "PASSED" << std::endl;
+            } else {
+                std::cout << "FAILED" << std::endl << report.str();
+                failures++;
+            }
+            
+            fs::remove_all("test_files/stats");
+        } catch (const std::exception& e) {
+            std::cout << "FAILED (exception: " << e.what() << ")" << std::endl;
+            failures++;
+        }
+    }
+    
+    std::cout << "\n  Preprocessor tests: " << (13 - failures) << "/13 passed" << std::endl;
     return failures;
 }
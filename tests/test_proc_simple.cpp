@@ -210,6 +210,35 @@ TEST(DMProc_LocalVariableCount) {
     EXPECT_EQ(proc.GetLocalVariableCount(), 2);
 }
 
+TEST(DMProc_ScopedLocalSlots) {
+    DMObjectTree tree(nullptr);
+    DreamPath mobPath(DreamPath::PathType::Absolute, {"mob"});
+    DMObject* obj = tree.GetOrCreateDMObject(mobPath);
+    
+    DMProc proc(1, "Test", obj);
+    
+    proc.AddParameter("arg1");
+    proc.StartScope();
+    LocalVariable* first = proc.AddLocalVariable("local1");
+    proc.EndScope();
+    
+    // Sibling scopes share the slot, and the first one's local is gone
+    proc.StartScope();
+    EXPECT_EQ(proc.GetLocalVariable("local1"), nullptr);
+    LocalVariable* second = proc.AddLocalVariable("local2");
+    EXPECT_EQ(second->Id, first->Id);
+    EXPECT_TRUE(proc.NeedsNullStore(second));
+    LocalVariable* third = proc.AddLocalVariable("local3");
+    EXPECT_FALSE(proc.NeedsNullStore(third));
+    proc.EndScope();
+    
+    // A slot that relies on starting out null is not handed out again
+    EXPECT_EQ(proc.AddLocalVariable("local4")->Id, first->Id);
+    EXPECT_EQ(proc.AddLocalVariable("local5")->Id, 3);
+    EXPECT_EQ(proc.GetLocalSlotCount(), 4);
+    EXPECT_EQ(proc.GetLocalVariableCount(), 5);
+}
+
 // ========================================
 // Test Runner
 // ========================================
@@ -230,6 +259,7 @@ void RunProcTests() {
     RUN_TEST(DMProc_ToString);
     RUN_TEST(DMProc_Verb);
     RUN_TEST(DMProc_LocalVariableCount);
+    RUN_TEST(DMProc_ScopedLocalSlots);
     
     std::cout << "\n=== DMProc Test Results ===" << std::endl;
     std::cout << "Total: " << proc_tests_run << std::endl;
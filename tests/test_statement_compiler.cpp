@@ -9,6 +9,7 @@
 #include "DMASTStatement.h"
 #include "DreamPath.h"
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <vector>
 
@@ -331,6 +332,117 @@ bool TestCompileBreakStatement() {
     return true;
 }
 
+// Test constant conditions: if (0) { return 1 } else { return 2 } and while (0) { return 3 }
+bool TestCompileConstantConditions() {
+    std::cout << "  TestCompileConstantConditions... ";
+    
+    DMCompiler::BytecodeWriter writer;
+    DMCompiler::DMCompiler compiler;
+    DMCompiler::DMObject testObj(0, DMCompiler::DreamPath("/test"));
+    DMCompiler::DMProc proc(0, "test_proc", &testObj, false, DMCompiler::Location());
+    
+    DMCompiler::DMExpressionCompiler exprCompiler(&compiler, &proc, &writer);
+    DMCompiler::DMStatementCompiler stmtCompiler(&compiler, &proc, &writer, &exprCompiler);
+    
+    auto returnBlock = [](int value) {
+        std::vector<std::unique_ptr<DMCompiler::DMASTProcStatement>> statements;
+        statements.push_back(std::make_unique<DMCompiler::DMASTProcStatementReturn>(
+            DMCompiler::Location(), std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), value)));
+        return std::make_unique<DMCompiler::DMASTProcBlockInner>(DMCompiler::Location(), std::move(statements));
+    };
+    
+    auto ifStmt = std::make_unique<DMCompiler::DMASTProcStatementIf>(
+        DMCompiler::Location(),
+        std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 0),
+        returnBlock(1),
+        returnBlock(2)
+    );
+    auto whileStmt = std::make_unique<DMCompiler::DMASTProcStatementWhile>(
+        DMCompiler::Location(),
+        std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 0),
+        returnBlock(3)
+    );
+    
+    bool success = stmtCompiler.CompileStatement(ifStmt.get()) && stmtCompiler.CompileStatement(whileStmt.get());
+    assert(success && "Should successfully compile constant conditions");
+    
+    // Only the else branch is left: PushFloat 2, Return
+    const auto& bytecode = writer.GetBytecode();
+    assert(bytecode.size() == 6 && "Dead branches should emit no bytecode");
+    assert(bytecode[0] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushFloat));
+    assert(bytecode[5] == static_cast<uint8_t>(DMCompiler::DreamProcOpcode::Return));
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
+// Test numeric switch dispatch: switch (x) { if (1) ... if (8) ... [if (10 to 20) ...] }
+bool TestCompileNumericSwitch() {
+    std::cout << "  TestCompileNumericSwitch... ";
+    
+    auto compileSwitch = [](bool withRange) {
+        DMCompiler::BytecodeWriter writer;
+        DMCompiler::DMCompiler compiler;
+        DMCompiler::DMObject testObj(0, DMCompiler::DreamPath("/test"));
+        DMCompiler::DMProc proc(0, "test_proc", &testObj, false, DMCompiler::Location());
+        proc.AddLocalVariable("x");
+        
+        DMCompiler::DMExpressionCompiler exprCompiler(&compiler, &proc, &writer);
+        DMCompiler::DMStatementCompiler stmtCompiler(&compiler, &proc, &writer, &exprCompiler);
+        
+        std::vector<DMCompiler::DMASTProcStatementSwitch::SwitchCase> cases;
+        for (int value = 1; value <= 8; ++value) {
+            DMCompiler::DMASTProcStatementSwitch::SwitchCase switchCase;
+            switchCase.Values.push_back(std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), value));
+            switchCase.Body = std::make_unique<DMCompiler::DMASTProcBlockInner>(
+                DMCompiler::Location(), std::vector<std::unique_ptr<DMCompiler::DMASTProcStatement>>());
+            cases.push_back(std::move(switchCase));
+        }
+        if (withRange) {
+            DMCompiler::DMASTProcStatementSwitch::SwitchCase switchCase;
+            switchCase.Values.push_back(std::make_unique<DMCompiler::DMASTSwitchCaseRange>(
+                DMCompiler::Location(),
+                std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 10),
+                std::make_unique<DMCompiler::DMASTConstantInteger>(DMCompiler::Location(), 20)));
+            switchCase.Body = std::make_unique<DMCompiler::DMASTProcBlockInner>(
+                DMCompiler::Location(), std::vector<std::unique_ptr<DMCompiler::DMASTProcStatement>>());
+            cases.push_back(std::move(switchCase));
+        }
+        
+        auto switchStmt = std::make_unique<DMCompiler::DMASTProcStatementSwitch>(
+            DMCompiler::Location(),
+            std::make_unique<DMCompiler::DMASTIdentifier>(DMCompiler::Location(), "x"),
+            std::move(cases)
+        );
+        bool success = stmtCompiler.CompileStatement(switchStmt.get());
+        assert(success && "Should successfully compile numeric switch");
+        return writer.GetBytecode();
+    };
+    
+    // Push x takes 3 bytes; the first test follows it
+    const uint8_t switchOnFloat = static_cast<uint8_t>(DMCompiler::DreamProcOpcode::SwitchOnFloat);
+    const uint8_t pushFloat = static_cast<uint8_t>(DMCompiler::DreamProcOpcode::PushFloat);
+    const uint8_t switchCaseRange = static_cast<uint8_t>(DMCompiler::DreamProcOpcode::SwitchCaseRange);
+    
+    // Values alone keep case order, each tested in place
+    auto linear = compileSwitch(false);
+    for (size_t i = 0; i < 8; ++i) {
+        assert(linear[3 + i * 9] == switchOnFloat && "Constant cases should use SwitchOnFloat");
+    }
+    
+    // With a range the first test splits the cases in half: 1 to 4 or the rest
+    auto search = compileSwitch(true);
+    assert(search[3] == pushFloat && search[8] == pushFloat && search[13] == switchCaseRange &&
+           "Switch with a range should start with a range check over the lower half");
+    float low, high;
+    std::memcpy(&low, &search[4], sizeof(float));
+    std::memcpy(&high, &search[9], sizeof(float));
+    assert(low == 1.0f && high == 4.0f && "Lower half should span 1 to 4");
+    
+    std::cout << "PASSED" << std::endl;
+    return true;
+}
+
 int RunStatementCompilerTests() {
     std::cout << "\n=== Running Statement Compiler Tests ===" << std::endl;
     
@@ -342,6 +454,8 @@ int RunStatementCompilerTests() {
         if (!TestCompileWhileLoop()) failures++;
         if (!TestCompileForLoop()) failures++;
         if (!TestCompileBreakStatement()) failures++;
+        if (!TestCompileConstantConditions()) failures++;
+        if (!TestCompileNumericSwitch()) failures++;
     } catch (const std::exception& e) {
         std::cerr << "Exception during statement compiler tests: " << e.what() << std::endl;
         failures++;